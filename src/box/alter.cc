@@ -165,6 +165,20 @@ index_opts_decode(struct index_opts *opts, const char *map,
 	if (opts->run_size_ratio <= 1)
 		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS,
 			  BOX_INDEX_FIELD_OPTS, "run_size_ratio must be > 1");
+	if (opts->compaction == vinyl_compaction_policy_MAX) {
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+			  BOX_INDEX_FIELD_OPTS, "compaction must be either "\
+			  "'tiered' or 'leveled'");
+	}
+	if (opts->hash_func == tuple_hash_version_MAX) {
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+			  BOX_INDEX_FIELD_OPTS, "hash_func must be either "\
+			  "'murmur' or 'crc32c'");
+	}
+	if (opts->value_log_threshold < 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS,
+			  BOX_INDEX_FIELD_OPTS,
+			  "value_log_threshold must be >= 0");
 }
 
 /**
@@ -207,7 +221,10 @@ index_def_new_from_tuple(struct tuple *tuple, struct space *space)
 		tuple_field_with_type_xc(tuple, BOX_INDEX_FIELD_PARTS,
 					 MP_ARRAY);
 	uint32_t part_count = mp_decode_array(&parts);
-	struct key_def *key_def = key_def_new(part_count);
+	uint32_t path_pool_size =
+		key_def_decode_path_pool_size(parts, part_count);
+	struct key_def *key_def =
+		key_def_new_with_paths(part_count, path_pool_size);
 	if (key_def == NULL)
 		diag_raise();
 	auto key_def_guard = make_scoped_guard([=] { box_key_def_delete(key_def); });
@@ -240,6 +257,11 @@ space_opts_decode(struct space_opts *opts, const char *map,
 	if (opts_decode(opts, space_opts_reg, &map, ER_WRONG_SPACE_OPTIONS,
 			BOX_SPACE_FIELD_OPTS, region) != 0)
 		diag_raise();
+	if (opts->field_map == field_map_mode_MAX) {
+		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS,
+			  BOX_SPACE_FIELD_OPTS, "field_map must be one of "\
+			  "'indexed', 'sparse' or 'full'");
+	}
 	if (opts->sql != NULL) {
 		char *sql = strdup(opts->sql);
 		if (sql == NULL) {
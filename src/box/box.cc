@@ -403,6 +403,77 @@ box_check_wal_mode(const char *mode_name)
 	return (enum wal_mode) mode;
 }
 
+static enum iproto_backend
+box_check_iproto_backend(const char *backend_name)
+{
+	assert(backend_name != NULL); /* checked in Lua */
+	int backend = strindex(iproto_backend_STRS, backend_name,
+			       IPROTO_BACKEND_MAX);
+	if (backend == IPROTO_BACKEND_MAX) {
+		tnt_raise(ClientError, ER_CFG, "iproto_backend",
+			  backend_name);
+	}
+	return (enum iproto_backend) backend;
+}
+
+static enum memtx_huge_pages
+box_check_memtx_huge_pages(const char *huge_pages)
+{
+	assert(huge_pages != NULL); /* checked in Lua */
+	int mode = strindex(memtx_huge_pages_STRS, huge_pages,
+			    MEMTX_HUGE_PAGES_MAX);
+	if (mode == MEMTX_HUGE_PAGES_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_huge_pages",
+			  huge_pages);
+	}
+	return (enum memtx_huge_pages) mode;
+}
+
+static enum memtx_numa_policy
+box_check_memtx_numa_policy(const char *policy_name)
+{
+	assert(policy_name != NULL); /* checked in Lua */
+	int policy = strindex(memtx_numa_policy_STRS, policy_name,
+			      MEMTX_NUMA_MAX);
+	if (policy == MEMTX_NUMA_MAX) {
+		tnt_raise(ClientError, ER_CFG, "memtx_numa_policy",
+			  policy_name);
+	}
+	return (enum memtx_numa_policy) policy;
+}
+
+static void
+box_check_memtx_numa_nodes(const char *nodes_list)
+{
+	struct memtx_numa_nodes nodes;
+	if (memtx_numa_nodes_parse(&nodes, nodes_list) != 0) {
+		tnt_raise(ClientError, ER_CFG, "memtx_numa_nodes",
+			  "expected a list of nodes like '0,2-3'");
+	}
+}
+
+static double
+box_check_memtx_defrag_threshold(void)
+{
+	double threshold = cfg_getd("memtx_defrag_threshold");
+	if (threshold < 0 || threshold >= 1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_defrag_threshold",
+			  "the value must be >= 0 and < 1");
+	}
+	return threshold;
+}
+
+static int64_t
+box_check_memtx_defrag_min_free(void)
+{
+	int64_t min_free = cfg_geti64("memtx_defrag_min_free");
+	if (min_free < 0) {
+		tnt_raise(ClientError, ER_CFG, "memtx_defrag_min_free",
+			  "the value must be >= 0");
+	}
+	return min_free;
+}
+
 static void
 box_check_readahead(int readahead)
 {
@@ -414,6 +485,17 @@ box_check_readahead(int readahead)
 	}
 }
 
+static double
+box_check_iproto_cursor_timeout(void)
+{
+	double timeout = cfg_getd("iproto_cursor_timeout");
+	if (timeout <= 0) {
+		tnt_raise(ClientError, ER_CFG, "iproto_cursor_timeout",
+			  "the value must be greater than 0");
+	}
+	return timeout;
+}
+
 static void
 box_check_checkpoint_count(int checkpoint_count)
 {
@@ -454,11 +536,18 @@ box_check_config()
 	box_check_replication();
 	box_check_replication_timeout();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_iproto_backend(cfg_gets("iproto_backend"));
+	box_check_iproto_cursor_timeout();
 	box_check_checkpoint_count(cfg_geti("checkpoint_count"));
 	box_check_wal_max_rows(cfg_geti64("rows_per_wal"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
+	box_check_memtx_huge_pages(cfg_gets("memtx_huge_pages"));
+	box_check_memtx_numa_policy(cfg_gets("memtx_numa_policy"));
+	box_check_memtx_numa_nodes(cfg_gets("memtx_numa_nodes"));
+	box_check_memtx_defrag_threshold();
+	box_check_memtx_defrag_min_free();
 	if (cfg_geti64("vinyl_page_size") > cfg_geti64("vinyl_range_size"))
 		tnt_raise(ClientError, ER_CFG, "vinyl_page_size",
 			  "can't be greater than vinyl_range_size");
@@ -609,6 +698,26 @@ box_set_memtx_max_tuple_size(void)
 			cfg_geti("memtx_max_tuple_size"));
 }
 
+void
+box_set_memtx_defrag_threshold(void)
+{
+	double threshold = box_check_memtx_defrag_threshold();
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_defrag_threshold(memtx, threshold);
+}
+
+void
+box_set_memtx_defrag_min_free(void)
+{
+	int64_t min_free = box_check_memtx_defrag_min_free();
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	memtx_engine_set_defrag_min_free(memtx, min_free);
+}
+
 void
 box_set_too_long_threshold(void)
 {
@@ -623,6 +732,18 @@ box_set_readahead(void)
 	iobuf_readahead = readahead;
 }
 
+void
+box_set_iproto_compression(void)
+{
+	iproto_compression = cfg_geti("iproto_compression") != 0;
+}
+
+void
+box_set_iproto_cursor_timeout(void)
+{
+	iproto_set_cursor_timeout(box_check_iproto_cursor_timeout());
+}
+
 void
 box_set_checkpoint_count(void)
 {
@@ -789,13 +910,28 @@ box_process1(struct request *request, box_tuple_t **result)
 	return process_rw(request, space, result);
 }
 
-int
-box_select(struct port *port, uint32_t space_id, uint32_t index_id,
-	   int iterator, uint32_t offset, uint32_t limit,
-	   const char *key, const char *key_end)
+/**
+ * Add a key returned by iterator_next_key() to a port
+ * as a tuple.
+ */
+static int
+port_add_key(struct port *port, const char *key, uint32_t key_size)
 {
-	(void)key_end;
+	struct tuple *tuple = tuple_new(box_tuple_format_default(),
+					key, key + key_size);
+	if (tuple == NULL)
+		return -1;
+	tuple_ref(tuple);
+	int rc = port_add_tuple(port, tuple);
+	tuple_unref(tuple);
+	return rc;
+}
 
+static int
+box_select_impl(struct port *port, uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, bool keys_only)
+{
 	rmean_collect(rmean_box, IPROTO_SELECT, 1);
 
 	if (iterator < 0 || iterator >= iterator_type_MAX) {
@@ -838,15 +974,38 @@ box_select(struct port *port, uint32_t space_id, uint32_t index_id,
 	int rc = 0;
 	uint32_t found = 0;
 	struct tuple *tuple;
-	while (found < limit) {
-		rc = iterator_next(it, &tuple);
-		if (rc != 0 || tuple == NULL)
-			break;
+	const char *tuple_key;
+	uint32_t tuple_key_size;
+	/* Keys may be extracted on the region, see iterator_next_key(). */
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	if (offset > 0 && limit > 0 && it->skip != NULL) {
+		rc = it->skip(it, offset);
+		offset = 0;
+	}
+	while (rc == 0 && found < limit) {
+		if (keys_only) {
+			rc = iterator_next_key(it, &tuple_key,
+					       &tuple_key_size);
+			if (rc != 0 || tuple_key == NULL)
+				break;
+		} else {
+			rc = iterator_next(it, &tuple);
+			if (rc != 0 || tuple == NULL)
+				break;
+		}
 		if (offset > 0) {
+			if (keys_only)
+				region_truncate(region, region_svp);
 			offset--;
 			continue;
 		}
-		rc = port_add_tuple(port, tuple);
+		if (keys_only) {
+			rc = port_add_key(port, tuple_key, tuple_key_size);
+			region_truncate(region, region_svp);
+		} else {
+			rc = port_add_tuple(port, tuple);
+		}
 		if (rc != 0)
 			break;
 		found++;
@@ -861,6 +1020,95 @@ box_select(struct port *port, uint32_t space_id, uint32_t index_id,
 	return 0;
 }
 
+int
+box_select(struct port *port, uint32_t space_id, uint32_t index_id,
+	   int iterator, uint32_t offset, uint32_t limit,
+	   const char *key, const char *key_end)
+{
+	(void)key_end;
+	return box_select_impl(port, space_id, index_id, iterator,
+			       offset, limit, key, false);
+}
+
+int
+box_select_keys(struct port *port, uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, const char *key_end)
+{
+	(void)key_end;
+	return box_select_impl(port, space_id, index_id, iterator,
+			       offset, limit, key, true);
+}
+
+int
+box_get_many(struct port *port, uint32_t space_id, uint32_t index_id,
+	     const char *keys, const char *keys_end)
+{
+	(void)keys_end;
+
+	struct space *space = space_cache_find(space_id);
+	if (space == NULL)
+		return -1;
+	if (access_check_space(space, PRIV_R) != 0)
+		return -1;
+	struct index *index = index_find(space, index_id);
+	if (index == NULL)
+		return -1;
+	if (!index->def->opts.is_unique) {
+		diag_set(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		return -1;
+	}
+
+	uint32_t count = mp_decode_array(&keys);
+	rmean_collect(rmean_box, IPROTO_SELECT, count);
+	if (count == 0)
+		return 0;
+
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	size_t size = count * (sizeof(const char *) + sizeof(struct tuple *));
+	const char **key = (const char **) region_alloc(region, size);
+	if (key == NULL) {
+		diag_set(OutOfMemory, size, "region_alloc", "keys");
+		return -1;
+	}
+	struct tuple **result = (struct tuple **) (key + count);
+	struct txn *txn;
+	int rc = -1;
+	for (uint32_t i = 0; i < count; i++) {
+		if (mp_typeof(*keys) != MP_ARRAY) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 "keys must be arrays");
+			goto out;
+		}
+		uint32_t part_count = mp_decode_array(&keys);
+		if (exact_key_validate(index->def->key_def, keys, part_count))
+			goto out;
+		key[i] = keys;
+		for (uint32_t part = 0; part < part_count; part++)
+			mp_next(&keys);
+	}
+
+	if (txn_begin_ro_stmt(space, &txn) != 0)
+		goto out;
+	if (index_get_many(index, key, count, result) != 0) {
+		txn_rollback_stmt();
+		goto out;
+	}
+	txn_commit_ro_stmt(txn);
+
+	rc = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (rc == 0)
+			rc = port_add_tuple(port, result[i]);
+		if (result[i] != NULL)
+			tuple_unref(result[i]);
+	}
+out:
+	region_truncate(region, used);
+	return rc;
+}
+
 int
 box_insert(uint32_t space_id, const char *tuple, const char *tuple_end,
 	   box_tuple_t **result)
@@ -1420,9 +1668,16 @@ engine_init()
 				    cfg_geti("force_recovery"),
 				    cfg_getd("memtx_memory"),
 				    cfg_geti("memtx_min_tuple_size"),
-				    cfg_getd("slab_alloc_factor"));
+				    cfg_getd("slab_alloc_factor"),
+				    box_check_memtx_huge_pages(
+					cfg_gets("memtx_huge_pages")),
+				    box_check_memtx_numa_policy(
+					cfg_gets("memtx_numa_policy")),
+				    cfg_gets("memtx_numa_nodes"));
 	engine_register((struct engine *)memtx);
 	box_set_memtx_max_tuple_size();
+	box_set_memtx_defrag_threshold();
+	box_set_memtx_defrag_min_free();
 
 	struct sysview_engine *sysview = sysview_engine_new_xc();
 	engine_register((struct engine *)sysview);
@@ -1601,7 +1856,7 @@ box_cfg_xc(void)
 	schema_init();
 	replication_init();
 	port_init();
-	iproto_init();
+	iproto_init(box_check_iproto_backend(cfg_gets("iproto_backend")));
 	wal_thread_start();
 
 	title("loading");
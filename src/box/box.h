@@ -150,8 +150,12 @@ void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
 void box_set_too_long_threshold(void);
 void box_set_readahead(void);
+void box_set_iproto_compression(void);
+void box_set_iproto_cursor_timeout(void);
 void box_set_checkpoint_count(void);
 void box_set_memtx_max_tuple_size(void);
+void box_set_memtx_defrag_threshold(void);
+void box_set_memtx_defrag_min_free(void);
 void box_set_vinyl_max_tuple_size(void);
 void box_set_vinyl_timeout(void);
 void box_set_replication_timeout(void);
@@ -167,6 +171,28 @@ box_select(struct port *port, uint32_t space_id, uint32_t index_id,
 	   int iterator, uint32_t offset, uint32_t limit,
 	   const char *key, const char *key_end);
 
+/*
+ * box_select_keys is private and used only by FFI.
+ * Same as box_select(), but adds to @port only the fields of
+ * each tuple that identify it in the index, see
+ * index_def_unique_key_def(). Covering memtx TREE indexes
+ * return them without reading tuples.
+ */
+API_EXPORT int
+box_select_keys(struct port *port, uint32_t space_id, uint32_t index_id,
+		int iterator, uint32_t offset, uint32_t limit,
+		const char *key, const char *key_end);
+
+/*
+ * box_get_many is private and used only by FFI.
+ * Looks up each key of MsgPack array @keys in a unique index
+ * and adds the results to @port in the same order, NULL for
+ * keys that were not found.
+ */
+API_EXPORT int
+box_get_many(struct port *port, uint32_t space_id, uint32_t index_id,
+	     const char *keys, const char *keys_end);
+
 /** \cond public */
 
 /*
@@ -134,6 +134,7 @@ box_func_reload(const char *name)
 {
 	size_t name_len = strlen(name);
 	struct func *func = access_check_func(name, name_len);
+	func_cache_version++;
 	if (func->def->language != FUNC_LANGUAGE_C || func->func == NULL)
 		return 0; /* Nothing to do */
 	if (func_reload(func) == 0)
@@ -44,6 +44,12 @@ const char *field_type_strs[] = {
 	/* [FIELD_TYPE_MAP]      = */ "map",
 };
 
+const char *field_map_mode_strs[] = {
+	/* [FIELD_MAP_INDEXED]   = */ "indexed",
+	/* [FIELD_MAP_SPARSE]    = */ "sparse",
+	/* [FIELD_MAP_FULL]      = */ "full",
+};
+
 static int64_t
 field_type_by_name_wrapper(const char *str, uint32_t len)
 {
@@ -63,6 +63,26 @@ enum field_type {
 
 extern const char *field_type_strs[];
 
+/**
+ * Which tuple fields have a slot in the tuple field map, i.e.
+ * can be accessed without decoding the preceding fields.
+ * @sa tuple_format_add_offset_slots().
+ */
+enum field_map_mode {
+	/** Only fields needed by non-sequential keys. */
+	FIELD_MAP_INDEXED = 0,
+	/**
+	 * Also every few fields, so that any field is reached
+	 * by skipping a few fields after one with a slot.
+	 */
+	FIELD_MAP_SPARSE,
+	/** All fields. */
+	FIELD_MAP_FULL,
+	field_map_mode_MAX
+};
+
+extern const char *field_map_mode_strs[];
+
 /** Check if @a new_type can store values of @an old_type. */
 bool
 field_type_is_compatible(enum field_type old_type, enum field_type new_type);
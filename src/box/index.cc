@@ -438,6 +438,8 @@ void
 iterator_create(struct iterator *it, struct index *index)
 {
 	it->next = NULL;
+	it->skip = NULL;
+	it->next_key = NULL;
 	it->free = NULL;
 	it->schema_version = schema_version;
 	it->space_id = index->def->space_id;
@@ -445,25 +447,58 @@ iterator_create(struct iterator *it, struct index *index)
 	it->index = index;
 }
 
+/**
+ * Check if the index an iterator is for is still there.
+ * Return false if the iterator must be invalidated.
+ */
+static inline bool
+iterator_check_schema(struct iterator *it)
+{
+	if (likely(it->schema_version == schema_version))
+		return true;
+	struct space *space = space_by_id(it->space_id);
+	if (space == NULL)
+		return false;
+	struct index *index = space_index(space, it->index_id);
+	if (index != it->index ||
+	    index->schema_version > it->schema_version)
+		return false;
+	it->schema_version = schema_version;
+	return true;
+}
+
 int
 iterator_next(struct iterator *it, struct tuple **ret)
 {
 	assert(it->next != NULL);
-	if (unlikely(it->schema_version != schema_version)) {
-		struct space *space = space_by_id(it->space_id);
-		if (space == NULL)
-			goto invalidate;
-		struct index *index = space_index(space, it->index_id);
-		if (index != it->index ||
-		    index->schema_version > it->schema_version)
-			goto invalidate;
-		it->schema_version = schema_version;
+	if (!iterator_check_schema(it)) {
+		*ret = NULL;
+		return 0;
 	}
 	return it->next(it, ret);
+}
 
-invalidate:
-	*ret = NULL;
-	return 0;
+int
+iterator_next_key(struct iterator *it, const char **ret, uint32_t *size)
+{
+	assert(it->next != NULL);
+	if (!iterator_check_schema(it)) {
+		*ret = NULL;
+		return 0;
+	}
+	if (it->next_key != NULL)
+		return it->next_key(it, ret, size);
+	struct tuple *tuple;
+	if (it->next(it, &tuple) != 0)
+		return -1;
+	if (tuple == NULL) {
+		*ret = NULL;
+		return 0;
+	}
+	*ret = tuple_extract_key(tuple,
+				 index_def_unique_key_def(it->index->def),
+				 size);
+	return *ret != NULL ? 0 : -1;
 }
 
 void
@@ -623,6 +658,26 @@ generic_index_get(struct index *index, const char *key,
 	return -1;
 }
 
+int
+generic_index_get_many(struct index *index, const char **keys,
+		       uint32_t count, struct tuple **result)
+{
+	uint32_t part_count = index->def->key_def->part_count;
+	for (uint32_t i = 0; i < count; i++) {
+		struct tuple *tuple;
+		if (index_get(index, keys[i], part_count, &tuple) != 0 ||
+		    (tuple != NULL && tuple_ref(tuple) != 0)) {
+			while (i-- > 0) {
+				if (result[i] != NULL)
+					tuple_unref(result[i]);
+			}
+			return -1;
+		}
+		result[i] = tuple;
+	}
+	return 0;
+}
+
 int
 generic_index_replace(struct index *index, struct tuple *old_tuple,
 		      struct tuple *new_tuple, enum dup_replace_mode mode,
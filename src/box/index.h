@@ -223,6 +223,25 @@ struct iterator {
 	 * Returns 0 on success, -1 on error.
 	 */
 	int (*next)(struct iterator *it, struct tuple **ret);
+	/**
+	 * Skip @count tuples so that the following call to next()
+	 * returns the tuple after them. May only be called before
+	 * the first next(). Optional: if NULL, tuples are skipped
+	 * by calling next() in a loop.
+	 * Returns 0 on success, -1 on error.
+	 */
+	int (*skip)(struct iterator *it, uint32_t count);
+	/**
+	 * Iterate to the next tuple, but return only its fields
+	 * indexed by index_def_unique_key_def() as a MessagePack
+	 * array in @ret (NULL if EOF) and its size in @size.
+	 * The array is valid until the next call. An iterator is
+	 * iterated either with next() or with next_key(), never
+	 * both. Optional: if NULL, iterator_next_key() extracts
+	 * the key from the tuple returned by next().
+	 * Returns 0 on success, -1 on error.
+	 */
+	int (*next_key)(struct iterator *it, const char **ret, uint32_t *size);
 	/** Destroy the iterator. */
 	void (*free)(struct iterator *);
 	/** Schema version at the time of the last index lookup. */
@@ -258,6 +277,17 @@ iterator_create(struct iterator *it, struct index *index);
 int
 iterator_next(struct iterator *it, struct tuple **ret);
 
+/**
+ * Iterate to the next tuple and return its fields indexed by
+ * index_def_unique_key_def() as a MessagePack array.
+ *
+ * The key is returned in @ret (NULL if EOF). It is valid until
+ * the next call, but may be allocated on the fiber region.
+ * Returns 0 on success, -1 on error.
+ */
+int
+iterator_next_key(struct iterator *it, const char **ret, uint32_t *size);
+
 /**
  * Destroy an iterator instance and free associated memory.
  */
@@ -359,6 +389,15 @@ struct index_vtab {
 			 const char *key, uint32_t part_count);
 	int (*get)(struct index *index, const char *key,
 		   uint32_t part_count, struct tuple **result);
+	/**
+	 * Look up @count full keys at once. Keys are passed
+	 * without MsgPack array headers. On success, @result[i]
+	 * is set to the tuple matching @keys[i] or NULL if there
+	 * is no such tuple. Found tuples are referenced, the
+	 * caller must unreference them after use.
+	 */
+	int (*get_many)(struct index *index, const char **keys,
+			uint32_t count, struct tuple **result);
 	int (*replace)(struct index *index, struct tuple *old_tuple,
 		       struct tuple *new_tuple, enum dup_replace_mode mode,
 		       struct tuple **result);
@@ -505,6 +544,13 @@ index_get(struct index *index, const char *key,
 	return index->vtab->get(index, key, part_count, result);
 }
 
+static inline int
+index_get_many(struct index *index, const char **keys,
+	       uint32_t count, struct tuple **result)
+{
+	return index->vtab->get_many(index, keys, count, result);
+}
+
 static inline int
 index_replace(struct index *index, struct tuple *old_tuple,
 	      struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -568,6 +614,8 @@ int generic_index_random(struct index *, uint32_t, struct tuple **);
 ssize_t generic_index_count(struct index *, enum iterator_type,
 			    const char *, uint32_t);
 int generic_index_get(struct index *, const char *, uint32_t, struct tuple **);
+int generic_index_get_many(struct index *, const char **, uint32_t,
+			   struct tuple **);
 int generic_index_replace(struct index *, struct tuple *, struct tuple *,
 			  enum dup_replace_mode, struct tuple **);
 struct snapshot_iterator *generic_index_create_snapshot_iterator(struct index *);
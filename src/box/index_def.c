@@ -35,6 +35,8 @@ const char *index_type_strs[] = { "HASH", "TREE", "BITSET", "RTREE" };
 
 const char *rtree_index_distance_type_strs[] = { "EUCLID", "MANHATTAN" };
 
+const char *vinyl_compaction_policy_strs[] = { "tiered", "leveled" };
+
 const struct index_opts index_opts_default = {
 	/* .unique              = */ true,
 	/* .dimension           = */ 2,
@@ -43,6 +45,11 @@ const struct index_opts index_opts_default = {
 	/* .page_size           = */ 0,
 	/* .run_count_per_level = */ 2,
 	/* .run_size_ratio      = */ 3.5,
+	/* .compaction          = */ VINYL_COMPACTION_TIERED,
+	/* .value_log_threshold = */ 0,
+	/* .rank                = */ false,
+	/* .covering            = */ false,
+	/* .hash_func           = */ TUPLE_HASH_MURMUR,
 	/* .bloom_fpr           = */ 0.05,
 	/* .lsn                 = */ 0,
 	/* .sql                 = */ NULL,
@@ -57,6 +64,14 @@ const struct opt_def index_opts_reg[] = {
 	OPT_DEF("page_size", OPT_INT64, struct index_opts, page_size),
 	OPT_DEF("run_count_per_level", OPT_INT64, struct index_opts, run_count_per_level),
 	OPT_DEF("run_size_ratio", OPT_FLOAT, struct index_opts, run_size_ratio),
+	OPT_DEF_ENUM("compaction", vinyl_compaction_policy, struct index_opts,
+		     compaction, NULL),
+	OPT_DEF("value_log_threshold", OPT_INT64, struct index_opts,
+		value_log_threshold),
+	OPT_DEF("rank", OPT_BOOL, struct index_opts, rank),
+	OPT_DEF("covering", OPT_BOOL, struct index_opts, covering),
+	OPT_DEF_ENUM("hash_func", tuple_hash_version, struct index_opts,
+		     hash_func, NULL),
 	OPT_DEF("bloom_fpr", OPT_FLOAT, struct index_opts, bloom_fpr),
 	OPT_DEF("lsn", OPT_INT64, struct index_opts, lsn),
 	OPT_DEF("sql", OPT_STRPTR, struct index_opts, sql),
@@ -201,6 +216,9 @@ index_def_change_requires_rebuild(const struct index_def *old_index_def,
 	if (old_index_def->iid != new_index_def->iid ||
 	    old_index_def->type != new_index_def->type ||
 	    old_index_def->opts.is_unique != new_index_def->opts.is_unique ||
+	    old_index_def->opts.rank != new_index_def->opts.rank ||
+	    old_index_def->opts.covering != new_index_def->opts.covering ||
+	    old_index_def->opts.hash_func != new_index_def->opts.hash_func ||
 	    !key_part_check_compatibility(old_index_def->key_def->parts,
 					  old_index_def->key_def->part_count,
 					  new_index_def->key_def->parts,
@@ -256,9 +274,16 @@ index_def_is_valid(struct index_def *index_def, const char *space_name)
 			 space_name, "too many key parts");
 		return false;
 	}
+	if (index_def->iid == 0 && index_def->key_def->is_multikey) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name, "primary key can not be multikey");
+		return false;
+	}
+	const struct key_part *multikey_part = NULL;
 	for (uint32_t i = 0; i < index_def->key_def->part_count; i++) {
-		assert(index_def->key_def->parts[i].type < field_type_MAX);
-		if (index_def->key_def->parts[i].fieldno > BOX_INDEX_FIELD_MAX) {
+		const struct key_part *part = &index_def->key_def->parts[i];
+		assert(part->type < field_type_MAX);
+		if (part->fieldno > BOX_INDEX_FIELD_MAX) {
 			diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
 				 space_name, "field no is too big");
 			return false;
@@ -268,14 +293,33 @@ index_def_is_valid(struct index_def *index_def, const char *space_name)
 			 * Courtesy to a user who could have made
 			 * a typo.
 			 */
-			if (index_def->key_def->parts[i].fieldno ==
-			    index_def->key_def->parts[j].fieldno) {
+			const struct key_part *prev =
+				&index_def->key_def->parts[j];
+			if (part->fieldno == prev->fieldno &&
+			    part->path_len == prev->path_len &&
+			    (part->path_len == 0 ||
+			     memcmp(part->path, prev->path,
+				    part->path_len) == 0)) {
 				diag_set(ClientError, ER_MODIFY_INDEX,
 					 index_def->name, space_name,
 					 "same key part is indexed twice");
 				return false;
 			}
 		}
+		if (part->multikey_len == 0)
+			continue;
+		/* All keys of a tuple are made of the same array. */
+		if (multikey_part == NULL) {
+			multikey_part = part;
+		} else if (part->fieldno != multikey_part->fieldno ||
+			   part->multikey_len != multikey_part->multikey_len ||
+			   memcmp(part->path, multikey_part->path,
+				  part->multikey_len) != 0) {
+			diag_set(ClientError, ER_MODIFY_INDEX,
+				 index_def->name, space_name,
+				 "multikey parts must refer to the same array");
+			return false;
+		}
 	}
 	return true;
 }
@@ -58,6 +58,27 @@ enum rtree_index_distance_type {
 };
 extern const char *rtree_index_distance_type_strs[];
 
+enum vinyl_compaction_policy {
+	/**
+	 * Size-tiered compaction: a level of the LSM tree may
+	 * contain up to run_count_per_level runs, which are
+	 * merged once the limit is exceeded. Cheap writes,
+	 * expensive reads.
+	 */
+	VINYL_COMPACTION_TIERED,
+	/**
+	 * Leveled compaction: each level of the LSM tree of
+	 * a range contains at most one run, which must be at
+	 * least run_size_ratio times larger than all newer runs
+	 * taken together, otherwise the runs are merged. Bounds
+	 * the number of runs a read has to look at at the cost
+	 * of higher write amplification.
+	 */
+	VINYL_COMPACTION_LEVELED,
+	vinyl_compaction_policy_MAX
+};
+extern const char *vinyl_compaction_policy_strs[];
+
 /** Index options */
 struct index_opts {
 	/**
@@ -89,6 +110,34 @@ struct index_opts {
 	 * previous one.
 	 */
 	double run_size_ratio;
+	/**
+	 * Vinyl compaction policy.
+	 */
+	enum vinyl_compaction_policy compaction;
+	/**
+	 * Minimal size of a non-indexed field to be stored in
+	 * the value log rather than in the primary index runs,
+	 * 0 disables the value log.
+	 */
+	int64_t value_log_threshold;
+	/**
+	 * Maintain subtree element counts in a memtx TREE index
+	 * so that count(), offset and rank lookups take
+	 * logarithmic time at the cost of slower updates.
+	 */
+	bool rank;
+	/**
+	 * Store a copy of the indexed fields next to each tuple
+	 * pointer in a memtx TREE index. Comparisons and selects
+	 * that need only indexed fields do not touch tuples then.
+	 */
+	bool covering;
+	/**
+	 * Function a memtx HASH index hashes keys with. PMurHash
+	 * is the default, because it determines the order in
+	 * which a full scan returns tuples.
+	 */
+	enum tuple_hash_version hash_func;
 	/* Bloom filter false positive rate. */
 	double bloom_fpr;
 	/**
@@ -141,6 +190,17 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 		       -1 : 1;
 	if (o1->run_size_ratio != o2->run_size_ratio)
 		return o1->run_size_ratio < o2->run_size_ratio ? -1 : 1;
+	if (o1->compaction != o2->compaction)
+		return o1->compaction < o2->compaction ? -1 : 1;
+	if (o1->value_log_threshold != o2->value_log_threshold)
+		return o1->value_log_threshold < o2->value_log_threshold ?
+		       -1 : 1;
+	if (o1->rank != o2->rank)
+		return o1->rank < o2->rank ? -1 : 1;
+	if (o1->covering != o2->covering)
+		return o1->covering < o2->covering ? -1 : 1;
+	if (o1->hash_func != o2->hash_func)
+		return o1->hash_func < o2->hash_func ? -1 : 1;
 	if (o1->bloom_fpr != o2->bloom_fpr)
 		return o1->bloom_fpr < o2->bloom_fpr ? -1 : 1;
 	return 0;
@@ -202,6 +262,21 @@ index_def_list_add(struct rlist *index_def_list, struct index_def *index_def)
 		rlist_add_tail_entry(index_def_list, index_def, link);
 }
 
+/**
+ * Return the key definition that identifies a tuple in the
+ * index: the index key definition for unique non-nullable
+ * indexes, the one extended with primary key parts otherwise.
+ * Unique nullable indexes may store multiple NULLs, so they
+ * need primary key parts as well.
+ */
+static inline struct key_def *
+index_def_unique_key_def(const struct index_def *def)
+{
+	if (def->opts.is_unique && !def->key_def->is_nullable)
+		return def->key_def;
+	return def->cmp_def;
+}
+
 /**
  * True, if the index change by alter requires an index rebuild.
  *
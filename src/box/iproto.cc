@@ -30,6 +30,8 @@
  */
 #include "iproto.h"
 #include <string.h>
+#include <limits.h>
+#include <sys/socket.h>
 #include <stdarg.h>
 #include <stdio.h>
 
@@ -42,14 +44,20 @@
 #include "say.h"
 #include "sio.h"
 #include "evio.h"
+#include "uring.h"
+#include "shm_channel.h"
+#include "iproto_zstd.h"
+#include "clock.h"
 #include "coio.h"
 #include "scoped_guard.h"
 #include "memory.h"
+#include "bit/bit.h"
 
 #include "port.h"
 #include "iobuf.h"
 #include "box.h"
 #include "call.h"
+#include "tuple.h"
 #include "tuple_convert.h"
 #include "session.h"
 #include "xrow.h"
@@ -58,10 +66,88 @@
 #include "iproto_constants.h"
 #include "rmean.h"
 #include "execute.h"
+#include "index.h"
+#include "txn.h" /* rmean_box */
 
 /* The number of iproto messages in flight */
 enum { IPROTO_MSG_MAX = 768 };
 
+/* Max number of requests processed in tx by one message */
+enum { IPROTO_BATCH_MAX = 32 };
+
+/*
+ * The number of requests of a connection queued in the net
+ * thread, after which the input of the connection is stopped.
+ */
+enum { IPROTO_QUEUE_MAX = 64 };
+
+/**
+ * Priority classes of requests. Requests of authenticated
+ * users are interactive, and requests of guest sessions are
+ * batch, so that an anonymous client can't delay the clients
+ * of the application, however many requests it sends.
+ */
+enum iproto_priority {
+	IPROTO_PRIORITY_INTERACTIVE = 0,
+	IPROTO_PRIORITY_BATCH = 1,
+	IPROTO_PRIORITY_MAX
+};
+
+/* The size of each ring of a shared memory channel */
+enum { IPROTO_SHM_RING_SIZE = 1024 * 1024 };
+
+enum {
+	/** Max number of open cursors of a connection. */
+	IPROTO_CURSOR_MAX = 64,
+	/**
+	 * Max size of tuples returned by a cursor at once, so
+	 * that a bulk export doesn't bloat the output buffer.
+	 */
+	IPROTO_CURSOR_CHUNK_SIZE = 1024 * 1024,
+	/** Max interval between checks for idle cursors, seconds. */
+	IPROTO_CURSOR_GC_PERIOD = 1,
+};
+
+/**
+ * A server-side cursor, see IPROTO_CURSOR_OPEN. Keeps an index
+ * iterator alive between requests, so that a big result set is
+ * fetched in chunks without repeated index lookups.
+ */
+struct iproto_cursor {
+	/** Link in iproto_connection::cursors. */
+	struct rlist in_connection;
+	/** Link in tx_cursors. */
+	struct rlist in_lru;
+	/** Connection the cursor belongs to. */
+	struct iproto_connection *connection;
+	/** Id of the cursor, unique within the connection. */
+	uint64_t id;
+	struct iterator *it;
+	/** Time the cursor was last opened or fetched from. */
+	ev_tstamp last_used;
+	/**
+	 * Set while a FETCH reads the iterator, which may yield,
+	 * e.g. on a disk read in vinyl. Other requests for the
+	 * cursor are rejected meanwhile.
+	 */
+	bool in_use;
+};
+
+/**
+ * Open cursors of all connections, least recently used first.
+ * Used only in the tx thread.
+ */
+static RLIST_HEAD(tx_cursors);
+
+double iproto_cursor_timeout = 60;
+
+/** The fiber closing idle cursors, see tx_cursor_gc_f(). */
+static struct fiber *tx_cursor_gc_fiber;
+
+const char *iproto_backend_STRS[] = { "evio", "io_uring", NULL };
+
+bool iproto_compression = false;
+
 void
 iproto_reset_input(struct ibuf *ibuf)
 {
@@ -103,6 +189,16 @@ struct iproto_msg: public cmsg
 		/* SQL request, if this is the EXECUTE request. */
 		struct sql_request sql_request;
 	};
+	/** Link in a queue of the connection, see iproto_sched. */
+	struct stailq_entry in_queue;
+	/** Time when the request was queued. */
+	ev_tstamp queue_time;
+	/**
+	 * Requests of the same connection, which follow this
+	 * one and are processed in the same tx fiber, see
+	 * iproto_sched_batch().
+	 */
+	struct stailq batch;
 	/** Output buffer to write response and flush. */
 	struct obuf *p_obuf;
 	/** Input buffer to store and discard request data. */
@@ -121,6 +217,11 @@ struct iproto_msg: public cmsg
 	 * and the connection must be closed.
 	 */
 	bool close_connection;
+	/**
+	 * Used in IPROTO_AUTH msgs, true if the session is
+	 * authenticated as a user other than guest.
+	 */
+	bool is_authenticated;
 };
 
 static struct mempool iproto_msg_pool;
@@ -134,6 +235,13 @@ iproto_msg_new(struct iproto_connection *con)
 	return msg;
 }
 
+/**
+ * Send queued requests to the tx thread, if it has room for
+ * them.
+ */
+static void
+iproto_sched_dispatch();
+
 /**
  * Resume stopped connections, if any.
  */
@@ -145,6 +253,7 @@ static inline void
 iproto_msg_delete(struct cmsg *msg)
 {
 	mempool_free(&iproto_msg_pool, msg);
+	iproto_sched_dispatch();
 	iproto_resume();
 }
 
@@ -165,6 +274,11 @@ iproto_msg_delete(struct cmsg *msg)
  */
 static struct cpipe tx_pipe;
 static struct cpipe net_pipe;
+/**
+ * A pipe from the tx thread to its own fiber pool, for
+ * requests taken out of a batch, see tx_detach_msg().
+ */
+static struct cpipe tx_detach_pipe;
 /* A pointer to the transaction processor cord. */
 struct cord *tx_cord;
 
@@ -173,10 +287,62 @@ struct rmean *rmean_net;
 enum rmean_net_name {
 	IPROTO_SENT,
 	IPROTO_RECEIVED,
+	/** Bytes given to and produced by zstd compression. */
+	IPROTO_COMPRESS_IN,
+	IPROTO_COMPRESS_OUT,
+	/** Thread CPU time spent on compression, microseconds. */
+	IPROTO_COMPRESS_TIME,
+	/** Bytes given to and produced by zstd decompression. */
+	IPROTO_DECOMPRESS_IN,
+	IPROTO_DECOMPRESS_OUT,
+	/** Thread CPU time spent on decompression, microseconds. */
+	IPROTO_DECOMPRESS_TIME,
+	/**
+	 * Requests of a priority class put to and taken from
+	 * the net thread queues, and the total time they spent
+	 * there, microseconds. Must go in the order of enum
+	 * iproto_priority, see iproto_sched_stat().
+	 */
+	IPROTO_INTERACTIVE_QUEUED,
+	IPROTO_INTERACTIVE_DEQUEUED,
+	IPROTO_INTERACTIVE_WAIT,
+	IPROTO_BATCH_QUEUED,
+	IPROTO_BATCH_DEQUEUED,
+	IPROTO_BATCH_WAIT,
+	/**
+	 * Histogram of the number of requests in messages sent
+	 * to the tx thread: TX_MSG_<n> counts messages with
+	 * [n, 2n) requests.
+	 */
+	IPROTO_TX_MSG_1,
+	IPROTO_TX_MSG_2,
+	IPROTO_TX_MSG_4,
+	IPROTO_TX_MSG_8,
+	IPROTO_TX_MSG_16,
+	IPROTO_TX_MSG_32,
 	IPROTO_LAST,
 };
 
-const char *rmean_net_strings[IPROTO_LAST] = { "SENT", "RECEIVED" };
+const char *rmean_net_strings[IPROTO_LAST] = {
+	"SENT", "RECEIVED",
+	"COMPRESS_IN", "COMPRESS_OUT", "COMPRESS_TIME",
+	"DECOMPRESS_IN", "DECOMPRESS_OUT", "DECOMPRESS_TIME",
+	"INTERACTIVE_QUEUED", "INTERACTIVE_DEQUEUED", "INTERACTIVE_WAIT",
+	"BATCH_QUEUED", "BATCH_DEQUEUED", "BATCH_WAIT",
+	"TX_MSG_1", "TX_MSG_2", "TX_MSG_4", "TX_MSG_8", "TX_MSG_16",
+	"TX_MSG_32",
+};
+
+/**
+ * Requests of a connection of one priority class, which wait
+ * to be sent to the tx thread, see iproto_sched.
+ */
+struct iproto_queue {
+	struct stailq requests;
+	/** Link in iproto_sched_class::queues. */
+	struct rlist in_sched;
+	struct iproto_connection *connection;
+};
 
 /**
  * Context of a single client connection.
@@ -249,48 +415,133 @@ struct iproto_connection
 	/* Pre-allocated disconnect msg. */
 	struct iproto_msg *disconnect;
 	struct rlist in_stop_list;
+	/**
+	 * Links in net_uring_input and net_uring_output queues,
+	 * used when the connection waits for a read or a write
+	 * to be submitted with io_uring.
+	 */
+	struct rlist in_uring_input;
+	struct rlist in_uring_output;
+	/** Output vector of a write submitted with io_uring. */
+	struct iovec *uring_iov;
+	/**
+	 * Set while a read or a write of the connection is
+	 * submitted with io_uring and hasn't completed yet.
+	 * A connection has at most one request in flight.
+	 */
+	bool uring_in_flight;
+	/**
+	 * Shared memory channel, which replaces the socket
+	 * for input and output after IPROTO_SHM_OPEN. The
+	 * socket is then only used for wakeups.
+	 */
+	struct shm_channel *shm;
+	/**
+	 * Compression of the input and the output, enabled by
+	 * IPROTO_COMPRESS.
+	 */
+	struct iproto_zstd *zstd;
+	/**
+	 * True if the session is authenticated as a user other
+	 * than guest, only such users may enable compression.
+	 * Updated in the net thread by IPROTO_AUTH replies.
+	 */
+	bool is_authenticated;
+	/**
+	 * Open cursors of the connection. Used only in the tx
+	 * thread.
+	 */
+	struct rlist cursors;
+	/** Number of open cursors. */
+	uint32_t cursor_count;
+	/** Id of the last opened cursor. */
+	uint64_t last_cursor_id;
+	/**
+	 * Requests read from the connection and not sent to
+	 * the tx thread yet, per priority class.
+	 */
+	struct iproto_queue queue[IPROTO_PRIORITY_MAX];
+	/** Number of requests in the queues. */
+	int queue_size;
 };
 
 static struct mempool iproto_connection_pool;
 static RLIST_HEAD(stopped_connections);
 
+/* {{{ io_uring backend */
+
+enum {
+	/** Max number of reads and writes submitted at once. */
+	IPROTO_URING_ENTRIES = 256,
+	/** Tag of a write in io_uring request data. */
+	IPROTO_URING_WRITE = 1,
+};
+
+/** The backend requested in box.cfg. */
+static enum iproto_backend iproto_backend;
 /**
- * Return true if we have not enough spare messages
- * in the message pool. Disconnect messages are
- * discounted: they are mostly reserved and idle.
+ * io_uring of the net thread, NULL if the connections use
+ * plain read() and writev(). With io_uring, readiness events
+ * only queue connections, and the queued reads and writes
+ * of all the connections are submitted with a single system
+ * call right before the event loop polls for new events.
+ * Completions are reaped right after the submission and,
+ * if some requests complete later, when the ring becomes
+ * readable.
  */
-static inline bool
-iproto_must_stop_input()
+static struct uring *net_uring;
+/**
+ * Set if new reads and writes are submitted with net_uring.
+ * Cleared if the kernel fails to accept requests: then the
+ * connections fall back to plain read() and writev(), while
+ * the requests in flight are still reaped from the ring.
+ */
+static bool net_uring_is_enabled;
+/**
+ * Output vectors of the writes in flight. A write may complete
+ * after later submissions, so each one takes its own vector
+ * from the free stack and puts it back on completion.
+ */
+static struct iovec (*net_uring_iov)[SMALL_OBUF_IOV_MAX + 1];
+static struct iovec **net_uring_iov_free;
+static unsigned net_uring_iov_free_count;
+/** Connections whose requests are submitted at once, in order. */
+static struct iproto_connection **net_uring_batch;
+/** Connections waiting for a read to be submitted. */
+static RLIST_HEAD(net_uring_input);
+/** Connections waiting for a write to be submitted. */
+static RLIST_HEAD(net_uring_output);
+/** Submits the queued reads and writes. */
+static struct ev_prepare net_uring_prepare;
+/** Keeps the loop from sleeping while the queues are not empty. */
+static struct ev_idle net_uring_idle;
+/** Reaps completions of requests that didn't complete at once. */
+static struct ev_io net_uring_io;
+
+static inline void
+iproto_uring_iov_put(struct iovec *iov)
 {
-	size_t connection_count = mempool_count(&iproto_connection_pool);
-	size_t request_count = mempool_count(&iproto_msg_pool);
-	return request_count > connection_count + IPROTO_MSG_MAX;
+	net_uring_iov_free[net_uring_iov_free_count++] = iov;
 }
 
-/**
- * Throttle the queue to the tx thread and ensure the fiber pool
- * in tx thread is not depleted by a flood of incoming requests:
- * resume a stopped connection only if there is a spare message
- * object in the message pool.
- */
-static void
-iproto_resume()
+/** True if reads and writes of the connection go to net_uring. */
+static inline bool
+iproto_connection_uses_uring(struct iproto_connection *con)
 {
-	/*
-	 * Most of the time we have nothing to do here: throttling
-	 * is not active.
-	 */
-	if (rlist_empty(&stopped_connections))
-		return;
-	if (iproto_must_stop_input())
-		return;
+	return net_uring_is_enabled && con->shm == NULL && con->zstd == NULL;
+}
 
-	struct iproto_connection *con;
-	con = rlist_first_entry(&stopped_connections, struct iproto_connection,
-				in_stop_list);
-	ev_feed_event(con->loop, &con->input, EV_READ);
+static inline void
+iproto_uring_queue(struct iproto_connection *con, struct rlist *link,
+		   struct rlist *queue)
+{
+	if (rlist_empty(link))
+		rlist_add_tail(queue, link);
+	ev_idle_start(con->loop, &net_uring_idle);
 }
 
+/* }}} */
+
 /**
  * A connection is idle when the client is gone
  * and there are no outstanding msgs in the msg queue.
@@ -310,7 +561,8 @@ static inline bool
 iproto_connection_is_idle(struct iproto_connection *con)
 {
 	return ibuf_used(&con->ibuf[0]) == 0 &&
-	       ibuf_used(&con->ibuf[1]) == 0;
+	       ibuf_used(&con->ibuf[1]) == 0 &&
+	       !con->uring_in_flight;
 }
 
 static inline void
@@ -381,7 +633,15 @@ tx_process_select(struct cmsg *msg);
 static void
 tx_process_sql(struct cmsg *m);
 static void
+tx_process_cursor(struct cmsg *msg);
+static void
+tx_process_batch(struct cmsg *msg);
+static void
+tx_cursor_delete(struct iproto_connection *con, struct iproto_cursor *cursor);
+static void
 net_send_msg(struct cmsg *msg);
+static void
+net_send_batch(struct cmsg *msg);
 
 static void
 tx_process_join_subscribe(struct cmsg *msg);
@@ -423,6 +683,9 @@ tx_process_disconnect(struct cmsg *m)
 		session_destroy(con->session);
 		con->session = NULL; /* safety */
 	}
+	struct iproto_cursor *cursor, *tmp;
+	rlist_foreach_entry_safe(cursor, &con->cursors, in_connection, tmp)
+		tx_cursor_delete(con, cursor);
 	/*
 	 * Got to be done in iproto thread since
 	 * that's where the memory is allocated.
@@ -469,6 +732,16 @@ static const struct cmsg_hop sql_route[] = {
 	{ net_send_msg, NULL },
 };
 
+static const struct cmsg_hop cursor_route[] = {
+	{ tx_process_cursor, &net_pipe },
+	{ net_send_msg, NULL },
+};
+
+static const struct cmsg_hop batch_route[] = {
+	{ tx_process_batch, &net_pipe },
+	{ net_send_batch, NULL },
+};
+
 static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
 	NULL,                                   /* IPROTO_OK */
 	select_route,                           /* IPROTO_SELECT */
@@ -482,6 +755,10 @@ static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
 	process1_route,                         /* IPROTO_UPSERT */
 	misc_route,                             /* IPROTO_CALL */
 	sql_route,                              /* IPROTO_EXECUTE */
+	select_route,                           /* IPROTO_GET_MANY */
+	cursor_route,                           /* IPROTO_CURSOR_OPEN */
+	cursor_route,                           /* IPROTO_CURSOR_FETCH */
+	cursor_route,                           /* IPROTO_CURSOR_CLOSE */
 };
 
 static const struct cmsg_hop sync_route[] = {
@@ -489,6 +766,271 @@ static const struct cmsg_hop sync_route[] = {
 	{ net_end_join_subscribe, NULL },
 };
 
+/* {{{ Request scheduler */
+
+/**
+ * Requests are not sent to the tx thread as soon as they are
+ * read, but are queued per connection and priority class.
+ * Once the tx thread has room for a request, the scheduler
+ * picks a class in a weighted round robin, and sends the
+ * first request of the first connection in the class, which
+ * then goes to the end of the list. So the connections of a
+ * class take turns, regardless of how many requests each
+ * of them pipelines, and a class takes the number of turns
+ * in a round given by its weight.
+ *
+ * Requests of a connection, which have the same priority,
+ * are sent in the order they are read. Consecutive requests,
+ * which don't yield in the tx thread, are sent in one message,
+ * which saves a fiber switch and a round trip via cbus per
+ * request.
+ */
+struct iproto_sched_class {
+	/** Non-empty queues of the class, one per connection. */
+	struct rlist queues;
+	/** Number of requests of the class sent in a round. */
+	int weight;
+	/** Number of requests left to send in the round. */
+	int credit;
+};
+
+static struct iproto_sched_class iproto_sched[IPROTO_PRIORITY_MAX];
+
+/** Weights of the priority classes. */
+static const int iproto_sched_weight[IPROTO_PRIORITY_MAX] = { 4, 1 };
+
+/** Number of requests queued in all connections. */
+static size_t iproto_sched_queue_size;
+
+static void
+iproto_sched_init()
+{
+	for (int i = 0; i < IPROTO_PRIORITY_MAX; i++) {
+		rlist_create(&iproto_sched[i].queues);
+		iproto_sched[i].weight = iproto_sched_weight[i];
+		iproto_sched[i].credit = iproto_sched_weight[i];
+	}
+}
+
+/** Return the statistics counter of a priority class. */
+static inline int
+iproto_sched_stat(uint32_t priority, enum rmean_net_name name)
+{
+	const int count = IPROTO_BATCH_QUEUED - IPROTO_INTERACTIVE_QUEUED;
+	return name + priority * count;
+}
+
+/**
+ * Return true if the tx thread has as many requests, as it
+ * is allowed to process concurrently, not to deplete the fiber
+ * pool (e.g. WAL writer needs a fiber to wake another fiber
+ * waiting for write to complete). Disconnect messages are
+ * discounted: they are mostly reserved and idle.
+ */
+static inline bool
+iproto_sched_tx_is_full()
+{
+	size_t connection_count = mempool_count(&iproto_connection_pool);
+	size_t request_count = mempool_count(&iproto_msg_pool);
+	return request_count - iproto_sched_queue_size >=
+	       connection_count + IPROTO_MSG_MAX;
+}
+
+/**
+ * Return true if we have not enough spare messages in the
+ * message pool: as many requests, as the tx thread may have,
+ * are waiting in the queues already. Disconnect messages are
+ * discounted: they are mostly reserved and idle.
+ */
+static inline bool
+iproto_must_stop_input()
+{
+	size_t connection_count = mempool_count(&iproto_connection_pool);
+	size_t request_count = mempool_count(&iproto_msg_pool);
+	return request_count > connection_count + 2 * IPROTO_MSG_MAX;
+}
+
+/**
+ * Return true if the connection has too many requests queued
+ * and must not read more.
+ */
+static inline bool
+iproto_connection_must_stop_input(struct iproto_connection *con)
+{
+	return con->queue_size >= IPROTO_QUEUE_MAX;
+}
+
+/**
+ * Throttle the total of queued requests and ensure the memory
+ * taken by them is bounded regardless of the number of
+ * connections: resume a stopped connection only if there is a
+ * spare message object in the message pool. Connections with
+ * a full queue are skipped, iproto_sched_dispatch() resumes
+ * them as their queues drain.
+ */
+static void
+iproto_resume()
+{
+	/*
+	 * Most of the time we have nothing to do here: throttling
+	 * is not active.
+	 */
+	if (rlist_empty(&stopped_connections))
+		return;
+	if (iproto_must_stop_input())
+		return;
+
+	struct iproto_connection *con;
+	rlist_foreach_entry(con, &stopped_connections, in_stop_list) {
+		if (! iproto_connection_must_stop_input(con)) {
+			ev_feed_event(con->loop, &con->input, EV_READ);
+			return;
+		}
+	}
+}
+
+/** Return the priority class of requests of a connection. */
+static inline uint32_t
+iproto_connection_priority(struct iproto_connection *con)
+{
+	return con->is_authenticated ? IPROTO_PRIORITY_INTERACTIVE :
+				       IPROTO_PRIORITY_BATCH;
+}
+
+/** Queue a request read from a connection. */
+static void
+iproto_sched_queue(struct iproto_connection *con, struct iproto_msg *msg)
+{
+	uint32_t priority = iproto_connection_priority(con);
+	struct iproto_queue *queue = &con->queue[priority];
+	stailq_add_tail_entry(&queue->requests, msg, in_queue);
+	if (rlist_empty(&queue->in_sched)) {
+		rlist_add_tail(&iproto_sched[priority].queues,
+			       &queue->in_sched);
+	}
+	msg->queue_time = ev_monotonic_now(con->loop);
+	con->queue_size++;
+	iproto_sched_queue_size++;
+	rmean_collect(rmean_net, iproto_sched_stat(priority,
+				IPROTO_INTERACTIVE_QUEUED), 1);
+}
+
+/**
+ * Return true if the request doesn't usually yield, and so
+ * can be processed in one tx fiber with other requests.
+ */
+static inline bool
+iproto_msg_is_batchable(struct iproto_msg *msg)
+{
+	return msg->header.type == IPROTO_SELECT ||
+	       msg->header.type == IPROTO_GET_MANY;
+}
+
+/** Take a request out of its queue. */
+static struct iproto_msg *
+iproto_sched_shift(struct iproto_queue *queue, uint32_t priority)
+{
+	struct iproto_connection *con = queue->connection;
+	struct iproto_msg *msg =
+		stailq_shift_entry(&queue->requests, struct iproto_msg,
+				   in_queue);
+	con->queue_size--;
+	iproto_sched_queue_size--;
+	ev_tstamp wait = ev_monotonic_now(con->loop) - msg->queue_time;
+	rmean_collect(rmean_net, iproto_sched_stat(priority,
+				IPROTO_INTERACTIVE_DEQUEUED), 1);
+	rmean_collect(rmean_net, iproto_sched_stat(priority,
+				IPROTO_INTERACTIVE_WAIT), wait * 1e6);
+	return msg;
+}
+
+/**
+ * Attach to @a msg the requests following it in the queue,
+ * which can be processed along with it, and route it to
+ * process them all at once. Return the number of requests
+ * in the message.
+ */
+static int
+iproto_sched_batch(struct iproto_queue *queue, uint32_t priority,
+		   struct iproto_msg *msg)
+{
+	stailq_create(&msg->batch);
+	if (! iproto_msg_is_batchable(msg))
+		return 1;
+	int count = 1;
+	while (count < IPROTO_BATCH_MAX && ! stailq_empty(&queue->requests)) {
+		struct iproto_msg *next =
+			stailq_first_entry(&queue->requests,
+					   struct iproto_msg, in_queue);
+		if (! iproto_msg_is_batchable(next))
+			break;
+		next = iproto_sched_shift(queue, priority);
+		stailq_add_tail_entry(&msg->batch, next, in_queue);
+		count++;
+	}
+	if (count > 1)
+		cmsg_init(msg, batch_route);
+	return count;
+}
+
+/**
+ * Pick the class to send a request of, starting a new round
+ * if the classes with queued requests have no credit left.
+ * Return IPROTO_PRIORITY_MAX if there are no requests.
+ */
+static uint32_t
+iproto_sched_next()
+{
+	for (int round = 0; round < 2; round++) {
+		for (uint32_t i = 0; i < IPROTO_PRIORITY_MAX; i++) {
+			if (iproto_sched[i].credit > 0 &&
+			    ! rlist_empty(&iproto_sched[i].queues))
+				return i;
+		}
+		for (uint32_t i = 0; i < IPROTO_PRIORITY_MAX; i++)
+			iproto_sched[i].credit = iproto_sched[i].weight;
+	}
+	return IPROTO_PRIORITY_MAX;
+}
+
+static void
+iproto_sched_dispatch()
+{
+	/*
+	 * Most of the time we have nothing to do here: requests
+	 * are sent as soon as they are read.
+	 */
+	if (iproto_sched_queue_size == 0)
+		return;
+	while (! iproto_sched_tx_is_full()) {
+		uint32_t priority = iproto_sched_next();
+		if (priority == IPROTO_PRIORITY_MAX)
+			break;
+		struct iproto_sched_class *sched = &iproto_sched[priority];
+		struct iproto_queue *queue =
+			rlist_shift_entry(&sched->queues, struct iproto_queue,
+					  in_sched);
+		struct iproto_connection *con = queue->connection;
+		struct iproto_msg *msg = iproto_sched_shift(queue, priority);
+		int count = iproto_sched_batch(queue, priority, msg);
+		rmean_collect(rmean_net, IPROTO_TX_MSG_1 + 31 -
+			      bit_clz_u32(count), 1);
+		/* Let the other connections go first. */
+		if (! stailq_empty(&queue->requests))
+			rlist_add_tail(&sched->queues, &queue->in_sched);
+		sched->credit--;
+		cpipe_push_input(&tx_pipe, msg);
+		/* Resume a connection stopped by a full queue. */
+		if (! rlist_empty(&con->in_stop_list) &&
+		    ! iproto_connection_must_stop_input(con) &&
+		    ! iproto_must_stop_input())
+			ev_feed_event(con->loop, &con->input, EV_READ);
+	}
+	cpipe_flush_input(&tx_pipe);
+}
+
+/* }}} */
+
 static struct iproto_connection *
 iproto_connection_new(const char *name, int fd)
 {
@@ -507,6 +1049,22 @@ iproto_connection_new(const char *name, int fd)
 	con->parse_size = 0;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
+	rlist_create(&con->in_uring_input);
+	rlist_create(&con->in_uring_output);
+	con->uring_iov = NULL;
+	con->uring_in_flight = false;
+	con->shm = NULL;
+	con->zstd = NULL;
+	con->is_authenticated = false;
+	rlist_create(&con->cursors);
+	con->cursor_count = 0;
+	con->last_cursor_id = 0;
+	for (int i = 0; i < IPROTO_PRIORITY_MAX; i++) {
+		stailq_create(&con->queue[i].requests);
+		rlist_create(&con->queue[i].in_sched);
+		con->queue[i].connection = con;
+	}
+	con->queue_size = 0;
 	/* It may be very awkward to allocate at close. */
 	con->disconnect = iproto_msg_new(con);
 	cmsg_init(con->disconnect, disconnect_route);
@@ -530,6 +1088,16 @@ iproto_connection_close(struct iproto_connection *con)
 		/* Make evio_has_fd() happy */
 		con->input.fd = con->output.fd = -1;
 		close(fd);
+		if (con->shm != NULL) {
+			shm_channel_destroy(con->shm);
+			free(con->shm);
+			con->shm = NULL;
+		}
+		if (con->zstd != NULL) {
+			iproto_zstd_destroy(con->zstd);
+			free(con->zstd);
+			con->zstd = NULL;
+		}
 		/*
 		 * Discard unparsed data, to recycle the
 		 * connection in net_send_msg() as soon as all
@@ -557,6 +1125,8 @@ iproto_connection_close(struct iproto_connection *con)
 		cpipe_push(&tx_pipe, msg);
 	}
 	rlist_del(&con->in_stop_list);
+	rlist_del(&con->in_uring_input);
+	rlist_del(&con->in_uring_output);
 }
 
 static inline struct ibuf *
@@ -696,6 +1266,10 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 	case IPROTO_UPDATE:
 	case IPROTO_DELETE:
 	case IPROTO_UPSERT:
+	case IPROTO_GET_MANY:
+	case IPROTO_CURSOR_OPEN:
+	case IPROTO_CURSOR_FETCH:
+	case IPROTO_CURSOR_CLOSE:
 		xrow_decode_dml_xc(&msg->header, &msg->dml_request,
 				   dml_request_key_map(type));
 		assert(type < sizeof(dml_route)/sizeof(*dml_route));
@@ -715,6 +1289,10 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 		cmsg_init(msg, sync_route);
 		*stop_input = true;
 		break;
+	case IPROTO_SHM_OPEN:
+	case IPROTO_COMPRESS:
+		/* Served in the net thread, see iproto_enqueue_batch(). */
+		break;
 	case IPROTO_EXECUTE:
 		xrow_decode_sql_xc(&msg->header, &msg->sql_request,
 				   &fiber()->gc);
@@ -722,6 +1300,7 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 		break;
 	case IPROTO_AUTH:
 		xrow_decode_auth_xc(&msg->header, &msg->auth_request);
+		msg->is_authenticated = false;
 		cmsg_init(msg, misc_route);
 		break;
 	default:
@@ -732,6 +1311,142 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 	return;
 }
 
+/**
+ * Return true if @a msg is the only request of the connection
+ * in flight and there is no output left to send.
+ */
+static bool
+iproto_connection_is_alone(struct iproto_connection *con,
+			   struct iproto_msg *msg)
+{
+	struct ibuf *in = msg->p_ibuf;
+	struct ibuf *other = iproto_connection_next_input(con);
+	return ibuf_used(in) == msg->len && con->parse_size == msg->len &&
+	       ibuf_used(other) == 0 && obuf_used(&con->obuf[0]) == 0 &&
+	       obuf_used(&con->obuf[1]) == 0;
+}
+
+/**
+ * Serve IPROTO_SHM_OPEN: create a shared memory channel, pass
+ * it to the client along with the response and use it instead
+ * of the socket for all subsequent input and output.
+ *
+ * The request must be the only one in flight, so that no
+ * response is left in the socket, and the channel memory
+ * descriptor can be passed only over a unix socket.
+ */
+static void
+iproto_connection_open_shm(struct iproto_connection *con,
+			   struct iproto_msg *msg)
+{
+	int fd = con->input.fd;
+	if (con->shm != NULL) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Shared memory channel is already open");
+	}
+	if (con->zstd != NULL) {
+		tnt_raise(ClientError, ER_UNSUPPORTED, "Compression",
+			  "shared memory channel");
+	}
+	if (!iproto_connection_is_alone(con, msg)) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Shared memory channel must be opened "
+			  "when there are no other requests");
+	}
+	struct sockaddr_storage addr;
+	socklen_t addrlen = sizeof(addr);
+	if (getsockname(fd, (struct sockaddr *) &addr, &addrlen) != 0)
+		tnt_raise(SocketError, fd, "getsockname");
+	if (addr.ss_family != AF_UNIX) {
+		tnt_raise(ClientError, ER_UNSUPPORTED, "TCP connection",
+			  "shared memory channel");
+	}
+	struct shm_channel *shm = (struct shm_channel *)
+		malloc(sizeof(*shm));
+	if (shm == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*shm), "malloc",
+			  "struct shm_channel");
+	}
+	int memfd = shm_channel_create(shm, fd, IPROTO_SHM_RING_SIZE);
+	if (memfd < 0) {
+		free(shm);
+		diag_raise();
+	}
+	char reply[IPROTO_HEADER_LEN + 1];
+	iproto_header_encode(reply, IPROTO_OK, msg->header.sync,
+			     ::schema_version, 1);
+	reply[IPROTO_HEADER_LEN] = 0x80; /* empty MessagePack Map */
+	int rc = shm_channel_send_fd(fd, reply, sizeof(reply), memfd);
+	close(memfd);
+	if (rc != 0) {
+		shm_channel_destroy(shm);
+		free(shm);
+		diag_raise();
+	}
+	con->shm = shm;
+	/*
+	 * Output now waits for the client to free space in
+	 * the ring, which it tells over the socket.
+	 */
+	ev_io_stop(con->loop, &con->output);
+	ev_io_set(&con->output, fd, EV_READ);
+}
+
+static ssize_t
+iproto_connection_send(struct iproto_connection *con,
+		       const struct iovec *iov, int iovcnt);
+
+/**
+ * Serve IPROTO_COMPRESS: reply and compress all subsequent
+ * input and output of the connection. The client must not
+ * send anything else until it gets the reply, which is the
+ * last uncompressed data in both directions.
+ */
+static void
+iproto_connection_open_zstd(struct iproto_connection *con,
+			    struct iproto_msg *msg)
+{
+	if (! iproto_compression) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Compression is disabled on the server");
+	}
+	if (! con->is_authenticated) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Compression requires authentication");
+	}
+	if (con->zstd != NULL) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Compression is already enabled");
+	}
+	if (!iproto_connection_is_alone(con, msg)) {
+		tnt_raise(ClientError, ER_PROTOCOL,
+			  "Compression must be enabled "
+			  "when there are no other requests");
+	}
+	struct iproto_zstd *zstd = (struct iproto_zstd *)
+		malloc(sizeof(*zstd));
+	if (zstd == NULL) {
+		tnt_raise(OutOfMemory, sizeof(*zstd), "malloc",
+			  "struct iproto_zstd");
+	}
+	if (iproto_zstd_create(zstd, IPROTO_ZSTD_LEVEL) != 0) {
+		free(zstd);
+		diag_raise();
+	}
+	char reply[IPROTO_HEADER_LEN + 1];
+	iproto_header_encode(reply, IPROTO_OK, msg->header.sync,
+			     ::schema_version, 1);
+	reply[IPROTO_HEADER_LEN] = 0x80; /* empty MessagePack Map */
+	struct iovec iov = { reply, sizeof(reply) };
+	/* The output is empty, so a short reply fits the socket. */
+	if (iproto_connection_send(con, &iov, 1) != (ssize_t) sizeof(reply)) {
+		iproto_zstd_destroy(zstd);
+		free(zstd);
+		tnt_raise(SocketError, con->output.fd, "write");
+	}
+	con->zstd = zstd;
+}
+
 /** Enqueue all requests which were read up. */
 static inline void
 iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
@@ -762,13 +1477,23 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 
 		try {
 			iproto_decode_msg(msg, &pos, reqend, &stop_input);
-			/*
-			 * This can't throw, but should not be
-			 * done in case of exception.
-			 */
-			cpipe_push_input(&tx_pipe, msg);
-			guard.is_active = false;
-			n_requests++;
+			if (msg->header.type == IPROTO_SHM_OPEN ||
+			    msg->header.type == IPROTO_COMPRESS) {
+				if (msg->header.type == IPROTO_SHM_OPEN)
+					iproto_connection_open_shm(con, msg);
+				else
+					iproto_connection_open_zstd(con, msg);
+				/* The request is served, discard it. */
+				in->rpos += msg->len;
+			} else {
+				/*
+				 * This can't throw, but should not be
+				 * done in case of exception.
+				 */
+				iproto_sched_queue(con, msg);
+				guard.is_active = false;
+				n_requests++;
+			}
 		} catch (Exception *e) {
 			/*
 			 * Do not close connection if we failed to
@@ -811,6 +1536,8 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_io_stop(con->loop, &con->output);
 		ev_io_stop(con->loop, &con->input);
+		rlist_del(&con->in_uring_input);
+		rlist_del(&con->in_uring_output);
 	} else if (n_requests != 1 || con->parse_size != 0) {
 		assert(rlist_empty(&con->in_stop_list));
 		/*
@@ -832,7 +1559,189 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_feed_event(con->loop, &con->input, EV_READ);
 	}
-	cpipe_flush_input(&tx_pipe);
+	iproto_sched_dispatch();
+}
+
+/**
+ * Read from the connection socket or from its shared memory
+ * channel. Return the same as sio_read().
+ */
+static ssize_t
+iproto_connection_recv(struct iproto_connection *con, void *buf,
+		       size_t count)
+{
+	if (con->shm == NULL)
+		return sio_read(con->input.fd, buf, count);
+	int bells = shm_channel_drain(con->shm);
+	if (bells > 0 && ev_is_active(&con->output)) {
+		/* A doorbell may tell that there is space for output. */
+		ev_feed_event(con->loop, &con->output, EV_WRITE);
+	}
+	ssize_t n = shm_channel_read(con->shm, buf, count);
+	if (n < 0 && errno == EAGAIN && bells < 0)
+		return 0; /* EOF */
+	if (n < 0 && errno != EAGAIN)
+		tnt_raise(SocketError, con->input.fd, "shm read(%zd)", count);
+	return n;
+}
+
+/**
+ * Write to the connection socket or to its shared memory
+ * channel. Return the same as sio_writev().
+ */
+static ssize_t
+iproto_connection_send(struct iproto_connection *con,
+		       const struct iovec *iov, int iovcnt)
+{
+	if (con->shm == NULL)
+		return sio_writev(con->output.fd, iov, iovcnt);
+	ssize_t n = shm_channel_writev(con->shm, iov, iovcnt);
+	if (n < 0 && errno != EAGAIN) {
+		tnt_raise(SocketError, con->output.fd, "shm writev(%d)",
+			  iovcnt);
+	}
+	return n;
+}
+
+/**
+ * Read and decompress input of a connection with compression.
+ * Return the same as sio_read().
+ */
+static ssize_t
+iproto_connection_read_zstd(struct iproto_connection *con, void *buf,
+			    size_t count)
+{
+	struct iproto_zstd *zstd = con->zstd;
+	while (true) {
+		uint64_t start = clock_thread64();
+		ssize_t n = iproto_zstd_decompress(zstd, buf, count);
+		if (n < 0)
+			diag_raise();
+		rmean_collect(rmean_net, IPROTO_DECOMPRESS_TIME,
+			      (clock_thread64() - start) / 1000);
+		if (n > 0) {
+			rmean_collect(rmean_net, IPROTO_DECOMPRESS_OUT, n);
+			/*
+			 * The rest of the input is already read, so
+			 * the socket may never wake us up for it.
+			 */
+			if (iproto_zstd_has_input(zstd))
+				ev_feed_event(con->loop, &con->input, EV_READ);
+			return n;
+		}
+		size_t size;
+		char *zbuf = iproto_zstd_input_buf(zstd, &size);
+		n = iproto_connection_recv(con, zbuf, size);
+		if (n <= 0)
+			return n;
+		rmean_collect(rmean_net, IPROTO_RECEIVED, n);
+		rmean_collect(rmean_net, IPROTO_DECOMPRESS_IN, n);
+		iproto_zstd_input_advance(zstd, n);
+	}
+}
+
+/**
+ * Send the compressed output of a connection. Return 0 if
+ * all of it is sent, -1 if the socket is not ready.
+ */
+static int
+iproto_connection_flush_zstd(struct iproto_connection *con)
+{
+	struct iproto_zstd *zstd = con->zstd;
+	while (iproto_zstd_has_output(zstd)) {
+		size_t size;
+		const char *zbuf = iproto_zstd_output_buf(zstd, &size);
+		if (size == 0) {
+			/* Finish flushing the stream. */
+			if (iproto_zstd_compress(zstd, NULL, 0) < 0)
+				diag_raise();
+			continue;
+		}
+		struct iovec iov = { (void *) zbuf, size };
+		ssize_t n = iproto_connection_send(con, &iov, 1);
+		if (n < 0)
+			return -1;
+		rmean_collect(rmean_net, IPROTO_SENT, n);
+		iproto_zstd_output_advance(zstd, n);
+	}
+	return 0;
+}
+
+/**
+ * Compress and send a part of @a iov on a connection with
+ * compression. Return the size of the consumed data, which is
+ * sent, or will be sent before any subsequent output, or -1
+ * if the socket is not ready.
+ */
+static ssize_t
+iproto_connection_writev_zstd(struct iproto_connection *con,
+			      const struct iovec *iov, int iovcnt)
+{
+	struct iproto_zstd *zstd = con->zstd;
+	if (iproto_connection_flush_zstd(con) != 0)
+		return -1;
+	uint64_t start = clock_thread64();
+	ssize_t n = iproto_zstd_compress(zstd, iov, iovcnt);
+	if (n < 0)
+		diag_raise();
+	rmean_collect(rmean_net, IPROTO_COMPRESS_TIME,
+		      (clock_thread64() - start) / 1000);
+	rmean_collect(rmean_net, IPROTO_COMPRESS_IN, n);
+	rmean_collect(rmean_net, IPROTO_COMPRESS_OUT, zstd->out_size);
+	iproto_connection_flush_zstd(con);
+	return n;
+}
+
+/**
+ * Read from the connection, decompressing the input if
+ * compression is on. Return the same as sio_read().
+ */
+static inline ssize_t
+iproto_connection_read(struct iproto_connection *con, void *buf,
+		       size_t count)
+{
+	if (con->zstd != NULL)
+		return iproto_connection_read_zstd(con, buf, count);
+	return iproto_connection_recv(con, buf, count);
+}
+
+/**
+ * Write to the connection, compressing the output if
+ * compression is on. Return the same as sio_writev().
+ */
+static inline ssize_t
+iproto_connection_writev(struct iproto_connection *con,
+			 const struct iovec *iov, int iovcnt)
+{
+	if (con->zstd != NULL)
+		return iproto_connection_writev_zstd(con, iov, iovcnt);
+	return iproto_connection_send(con, iov, iovcnt);
+}
+
+/**
+ * Handle @a nrd bytes read from the socket to the input
+ * buffer @a in, 0 stands for EOF.
+ */
+static void
+iproto_connection_on_read(struct iproto_connection *con, struct ibuf *in,
+			  ssize_t nrd)
+{
+	if (nrd == 0) {                 /* EOF */
+		iproto_connection_close(con);
+		return;
+	}
+	/*
+	 * Count statistics. Compressed input is counted as it
+	 * comes from the socket, in iproto_connection_read_zstd().
+	 */
+	if (con->zstd == NULL)
+		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
+
+	/* Update the read position and connection state. */
+	in->wpos += nrd;
+	con->parse_size += nrd;
+	/* Enqueue all requests which are fully read up. */
+	iproto_enqueue_batch(con, in);
 }
 
 static void
@@ -854,16 +1763,28 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		iproto_resume();
 	}
 	/*
-	 * Throttle if there are too many pending requests,
-	 * otherwise we might deplete the fiber pool and
-	 * deadlock (e.g. WAL writer needs a fiber to wake
-	 * another fiber waiting for write to complete).
-	 * Ignore iproto_connection->disconnect messages.
+	 * Throttle a connection, which has too many requests
+	 * waiting for the tx thread, so that a client flooding
+	 * the server is limited by the rate its requests are
+	 * served at, rather than by memory. Throttle all
+	 * connections if there are too many requests queued
+	 * in total.
 	 */
-	if (iproto_must_stop_input()) {
+	if (iproto_connection_must_stop_input(con) ||
+	    iproto_must_stop_input()) {
 		iproto_connection_stop(con);
 		return;
 	}
+	if (iproto_connection_uses_uring(con)) {
+		/* The read is submitted by iproto_uring_submit(). */
+		iproto_uring_queue(con, &con->in_uring_input,
+				   &net_uring_input);
+		return;
+	}
+	if (con->uring_in_flight) {
+		/* Proceeds when the request completes. */
+		return;
+	}
 
 	try {
 		/* Ensure we have sufficient space for the next round.  */
@@ -873,23 +1794,13 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 			return;
 		}
 		/* Read input. */
-		int nrd = sio_read(fd, in->wpos, ibuf_unused(in));
+		int nrd = iproto_connection_read(con, in->wpos,
+						 ibuf_unused(in));
 		if (nrd < 0) {                  /* Socket is not ready. */
 			ev_io_start(loop, &con->input);
 			return;
 		}
-		if (nrd == 0) {                 /* EOF */
-			iproto_connection_close(con);
-			return;
-		}
-		/* Count statistics */
-		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
-
-		/* Update the read position and connection state. */
-		in->wpos += nrd;
-		con->parse_size += nrd;
-		/* Enqueue all requests which are fully read up. */
-		iproto_enqueue_batch(con, in);
+		iproto_connection_on_read(con, in, nrd);
 	} catch (Exception *e) {
 		/* Best effort at sending the error message to the client. */
 		iproto_write_error_blocking(fd, e, 0);
@@ -898,10 +1809,13 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
-/** writev() to the socket and handle the result. */
-
-static int
-iproto_flush(struct iproto_connection *con)
+/**
+ * Find the output buffer to flush. Return NULL if there is
+ * nothing to flush.
+ * @param[out] p_ibuf Input buffer of the output buffer.
+ */
+static struct obuf *
+iproto_connection_output(struct iproto_connection *con, struct ibuf **p_ibuf)
 {
 	struct ibuf *ibuf = iproto_connection_prev_input(con);
 	struct obuf *obuf = iproto_connection_output_by_input(con, ibuf);
@@ -915,15 +1829,23 @@ iproto_flush(struct iproto_connection *con)
 		 * buffers.
 		 */
 		if (ibuf_used(ibuf) > 0 || obuf_used(obuf) == 0)
-			return 1;
+			return NULL;
 		ibuf = con->p_ibuf;
 	}
+	*p_ibuf = ibuf;
+	return obuf;
+}
 
-	int fd = con->output.fd;
+/**
+ * Fill @a iov with the data of @a obuf which is not sent yet.
+ * Return the number of vectors.
+ */
+static int
+iproto_flush_iov(struct obuf *obuf, struct iovec *iov)
+{
 	struct obuf_svp *begin = &obuf->wpos;
 	struct obuf_svp *end = &obuf->wend;
 	assert(begin->used < end->used);
-	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
 	struct iovec *src = obuf->iov;
 	int iovcnt = end->pos - begin->pos + 1;
 	/*
@@ -934,11 +1856,20 @@ iproto_flush(struct iproto_connection *con)
 	sio_add_to_iov(iov, -begin->iov_len);
 	/* *Overwrite* iov_len of the last pos as it may be garbage. */
 	iov[iovcnt-1].iov_len = end->iov_len - begin->iov_len * (iovcnt == 1);
+	return iovcnt;
+}
 
-	ssize_t nwr = sio_writev(fd, iov, iovcnt);
-
-	/* Count statistics */
-	rmean_collect(rmean_net, IPROTO_SENT, nwr);
+/**
+ * Advance the write position of @a obuf after @a nwr bytes
+ * of @a iov are written. Return 0 if the buffer is flushed,
+ * -1 otherwise.
+ */
+static int
+iproto_flush_advance(struct ibuf *ibuf, struct obuf *obuf,
+		     struct iovec *iov, ssize_t nwr)
+{
+	struct obuf_svp *begin = &obuf->wpos;
+	struct obuf_svp *end = &obuf->wend;
 	if (nwr > 0) {
 		if (begin->used + nwr == end->used) {
 			if (ibuf_used(ibuf) == 0) {
@@ -964,11 +1895,59 @@ iproto_flush(struct iproto_connection *con)
 	return -1;
 }
 
+/** writev() to the socket and handle the result. */
+
+static int
+iproto_flush(struct iproto_connection *con)
+{
+	/* Compressed output goes before anything else. */
+	if (con->zstd != NULL && iproto_connection_flush_zstd(con) != 0)
+		return -1;
+	struct ibuf *ibuf;
+	struct obuf *obuf = iproto_connection_output(con, &ibuf);
+	if (obuf == NULL)
+		return 1;
+
+	struct iovec iov[SMALL_OBUF_IOV_MAX+1];
+	int iovcnt = iproto_flush_iov(obuf, iov);
+	ssize_t nwr = iproto_connection_writev(con, iov, iovcnt);
+
+	/*
+	 * Count statistics. Compressed output is counted as it
+	 * goes to the socket, in iproto_connection_flush_zstd().
+	 */
+	if (con->zstd == NULL)
+		rmean_collect(rmean_net, IPROTO_SENT, nwr);
+	return iproto_flush_advance(ibuf, obuf, iov, nwr);
+}
+
 static void
 iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 			    int /* revents */)
 {
 	struct iproto_connection *con = (struct iproto_connection *) watcher->data;
+	if (con->shm != NULL) {
+		int bells = shm_channel_drain(con->shm);
+		if (bells < 0) {
+			/* The client is gone, nobody to send output to. */
+			iproto_connection_close(con);
+			return;
+		}
+		if (bells > 0 && ev_is_active(&con->input)) {
+			/* A doorbell may tell that there is input. */
+			ev_feed_event(con->loop, &con->input, EV_READ);
+		}
+	}
+	if (iproto_connection_uses_uring(con)) {
+		/* The write is submitted by iproto_uring_submit(). */
+		iproto_uring_queue(con, &con->in_uring_output,
+				   &net_uring_output);
+		return;
+	}
+	if (con->uring_in_flight) {
+		/* Proceeds when the request completes. */
+		return;
+	}
 
 	try {
 		int rc;
@@ -990,6 +1969,318 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
+/** Queue a read from the connection socket to net_uring. */
+static void
+iproto_connection_uring_read(struct iproto_connection *con)
+{
+	int fd = con->input.fd;
+	try {
+		struct ibuf *in = iproto_connection_input_buffer(con);
+		if (in == NULL) {
+			ev_io_stop(con->loop, &con->input);
+			return;
+		}
+		uring_read(net_uring, fd, in->wpos, ibuf_unused(in),
+			   (uintptr_t) con);
+		con->uring_in_flight = true;
+	} catch (Exception *e) {
+		iproto_write_error_blocking(fd, e, 0);
+		e->log();
+		iproto_connection_close(con);
+	}
+}
+
+/**
+ * Handle the result of a read submitted with net_uring, the
+ * same way iproto_connection_on_input() handles sio_read().
+ */
+static void
+iproto_connection_on_uring_read(struct iproto_connection *con, int nrd)
+{
+	int fd = con->input.fd;
+	try {
+		if (nrd == -ECONNRESET) {
+			nrd = 0;
+		} else if (nrd == -EAGAIN || nrd == -EWOULDBLOCK ||
+			   nrd == -EINTR) {
+			ev_io_start(con->loop, &con->input);
+			return;
+		} else if (nrd < 0) {
+			errno = -nrd;
+			tnt_raise(SocketError, fd, "read(%zd)",
+				  ibuf_unused(con->p_ibuf));
+		}
+		iproto_connection_on_read(con, con->p_ibuf, nrd);
+	} catch (Exception *e) {
+		iproto_write_error_blocking(fd, e, 0);
+		e->log();
+		iproto_connection_close(con);
+	}
+}
+
+/**
+ * Queue a write of the next output buffer to net_uring.
+ * @a iov must stay valid until the write completes.
+ */
+static void
+iproto_connection_uring_write(struct iproto_connection *con,
+			      struct iovec *iov)
+{
+	struct ibuf *ibuf;
+	struct obuf *obuf = iproto_connection_output(con, &ibuf);
+	if (obuf == NULL) {
+		if (ev_is_active(&con->output))
+			ev_io_stop(con->loop, &con->output);
+		return;
+	}
+	int iovcnt = iproto_flush_iov(obuf, iov);
+	con->uring_iov = iov;
+	con->uring_in_flight = true;
+	uring_writev(net_uring, con->output.fd, iov, MIN(iovcnt, IOV_MAX),
+		     (uintptr_t) con | IPROTO_URING_WRITE);
+}
+
+/**
+ * Handle the result of a write submitted with net_uring, the
+ * same way iproto_connection_on_output() handles iproto_flush().
+ */
+static void
+iproto_connection_on_uring_write(struct iproto_connection *con, int nwr)
+{
+	struct iovec *iov = con->uring_iov;
+	con->uring_iov = NULL;
+	try {
+		if (nwr == -EAGAIN || nwr == -EWOULDBLOCK || nwr == -EINTR) {
+			ev_io_start(con->loop, &con->output);
+			return;
+		} else if (nwr < 0) {
+			errno = -nwr;
+			tnt_raise(SocketError, con->output.fd, "writev");
+		}
+		/* Count statistics */
+		rmean_collect(rmean_net, IPROTO_SENT, nwr);
+		struct ibuf *ibuf;
+		struct obuf *obuf = iproto_connection_output(con, &ibuf);
+		assert(obuf != NULL);
+		if (iproto_flush_advance(ibuf, obuf, iov, nwr) != 0) {
+			ev_io_start(con->loop, &con->output);
+			return;
+		}
+		if (! ev_is_active(&con->input) &&
+		    rlist_empty(&con->in_stop_list)) {
+			ev_feed_event(con->loop, &con->input, EV_READ);
+		}
+		/* Flush the next output buffer, if any. */
+		if (iproto_connection_uses_uring(con))
+			iproto_uring_queue(con, &con->in_uring_output,
+					   &net_uring_output);
+		else
+			ev_feed_event(con->loop, &con->output, EV_WRITE);
+	} catch (Exception *e) {
+		e->log();
+		iproto_connection_close(con);
+	}
+}
+
+/** Handle the completions of the submitted requests. */
+static void
+iproto_uring_reap()
+{
+	uint64_t data;
+	int res;
+	while (uring_complete(net_uring, &data, &res)) {
+		struct iproto_connection *con = (struct iproto_connection *)
+			(uintptr_t) (data & ~(uint64_t) IPROTO_URING_WRITE);
+		assert(con->uring_in_flight);
+		con->uring_in_flight = false;
+		if (! evio_has_fd(&con->input)) {
+			/*
+			 * The connection was closed while the request
+			 * was in flight, destroy it if it was the last
+			 * thing it was waiting for.
+			 */
+			if (con->uring_iov != NULL) {
+				iproto_uring_iov_put(con->uring_iov);
+				con->uring_iov = NULL;
+			}
+			if (iproto_connection_is_idle(con))
+				iproto_connection_close(con);
+		} else if (data & IPROTO_URING_WRITE) {
+			struct iovec *iov = con->uring_iov;
+			iproto_connection_on_uring_write(con, res);
+			iproto_uring_iov_put(iov);
+		} else {
+			iproto_connection_on_uring_read(con, res);
+		}
+	}
+}
+
+/**
+ * Switch to plain read() and writev() after the kernel failed
+ * to accept requests of the last batch starting from
+ * @a submitted. The rejected and the queued requests are redone
+ * by the evio handlers, the accepted ones are reaped as usual.
+ */
+static void
+iproto_uring_disable(unsigned submitted, unsigned count)
+{
+	diag_log();
+	say_warn("failed to submit network I/O, "
+		 "falling back to evio iproto backend");
+	net_uring_is_enabled = false;
+	for (unsigned i = submitted; i < count; i++) {
+		struct iproto_connection *con = net_uring_batch[i];
+		con->uring_in_flight = false;
+		if (con->uring_iov != NULL) {
+			iproto_uring_iov_put(con->uring_iov);
+			con->uring_iov = NULL;
+			ev_feed_event(con->loop, &con->output, EV_WRITE);
+		} else {
+			ev_feed_event(con->loop, &con->input, EV_READ);
+		}
+	}
+	struct iproto_connection *con, *tmp;
+	rlist_foreach_entry_safe(con, &net_uring_output,
+				 in_uring_output, tmp) {
+		rlist_del(&con->in_uring_output);
+		ev_feed_event(con->loop, &con->output, EV_WRITE);
+	}
+	rlist_foreach_entry_safe(con, &net_uring_input,
+				 in_uring_input, tmp) {
+		rlist_del(&con->in_uring_input);
+		ev_feed_event(con->loop, &con->input, EV_READ);
+	}
+}
+
+/**
+ * Submit reads and writes of all the queued connections and
+ * handle their results. Invoked before the event loop polls
+ * for new events, so that all the reads and writes triggered
+ * by one loop iteration are done with a single system call.
+ *
+ * A connection has at most one request in flight: were its
+ * read and write completed together, the write could recycle
+ * the input buffer the read had just filled. The skipped
+ * request stays queued until the one in flight completes.
+ */
+static void
+iproto_uring_submit(ev_loop *loop, struct ev_prepare *, int)
+{
+	struct iproto_connection *con, *tmp;
+	while (net_uring_is_enabled) {
+		unsigned count = 0;
+		rlist_foreach_entry_safe(con, &net_uring_output,
+					 in_uring_output, tmp) {
+			if (uring_is_full(net_uring))
+				break;
+			if (con->uring_in_flight)
+				continue;
+			if (net_uring_iov_free_count == 0)
+				break;
+			rlist_del(&con->in_uring_output);
+			struct iovec *iov =
+				net_uring_iov_free[--net_uring_iov_free_count];
+			iproto_connection_uring_write(con, iov);
+			if (con->uring_in_flight)
+				net_uring_batch[count++] = con;
+			else
+				iproto_uring_iov_put(iov);
+		}
+		rlist_foreach_entry_safe(con, &net_uring_input,
+					 in_uring_input, tmp) {
+			if (uring_is_full(net_uring))
+				break;
+			if (con->uring_in_flight)
+				continue;
+			rlist_del(&con->in_uring_input);
+			iproto_connection_uring_read(con);
+			if (con->uring_in_flight)
+				net_uring_batch[count++] = con;
+		}
+		if (count == 0)
+			break;
+		unsigned submitted = uring_submit(net_uring);
+		if (submitted < count)
+			iproto_uring_disable(submitted, count);
+		iproto_uring_reap();
+	}
+	ev_idle_stop(loop, &net_uring_idle);
+}
+
+static void
+iproto_uring_on_complete(ev_loop *, struct ev_io *, int)
+{
+	iproto_uring_reap();
+}
+
+static void
+iproto_uring_idle(ev_loop *, struct ev_idle *, int)
+{
+	/* Nothing to do, the queues are flushed on prepare. */
+}
+
+/**
+ * Set up the io_uring backend in the net thread. On failure,
+ * e.g. on an old kernel, fall back to evio.
+ */
+static void
+iproto_uring_init()
+{
+	static struct uring ring;
+	if (uring_create(&ring, IPROTO_URING_ENTRIES) != 0) {
+		diag_log();
+		say_warn("io_uring is not available, "
+			 "falling back to evio iproto backend");
+		return;
+	}
+	net_uring_iov = (struct iovec (*)[SMALL_OBUF_IOV_MAX + 1])
+		calloc(ring.entries, sizeof(*net_uring_iov));
+	if (net_uring_iov == NULL) {
+		uring_destroy(&ring);
+		tnt_raise(OutOfMemory, ring.entries * sizeof(*net_uring_iov),
+			  "calloc", "net_uring_iov");
+	}
+	net_uring_iov_free = (struct iovec **)
+		calloc(ring.entries, sizeof(*net_uring_iov_free));
+	net_uring_batch = (struct iproto_connection **)
+		calloc(ring.entries, sizeof(*net_uring_batch));
+	if (net_uring_iov_free == NULL || net_uring_batch == NULL) {
+		free(net_uring_iov);
+		free(net_uring_iov_free);
+		free(net_uring_batch);
+		uring_destroy(&ring);
+		tnt_raise(OutOfMemory, ring.entries * sizeof(*net_uring_batch),
+			  "calloc", "net_uring_batch");
+	}
+	for (unsigned i = 0; i < ring.entries; i++)
+		net_uring_iov_free[i] = net_uring_iov[i];
+	net_uring_iov_free_count = ring.entries;
+	net_uring = &ring;
+	net_uring_is_enabled = true;
+	ev_prepare_init(&net_uring_prepare, iproto_uring_submit);
+	ev_prepare_start(loop(), &net_uring_prepare);
+	ev_idle_init(&net_uring_idle, iproto_uring_idle);
+	ev_io_init(&net_uring_io, iproto_uring_on_complete, ring.fd, EV_READ);
+	ev_io_start(loop(), &net_uring_io);
+	say_info("iproto uses io_uring backend");
+}
+
+static void
+iproto_uring_free()
+{
+	if (net_uring == NULL)
+		return;
+	ev_prepare_stop(loop(), &net_uring_prepare);
+	ev_idle_stop(loop(), &net_uring_idle);
+	ev_io_stop(loop(), &net_uring_io);
+	uring_destroy(net_uring);
+	free(net_uring_iov);
+	free(net_uring_iov_free);
+	free(net_uring_batch);
+	net_uring = NULL;
+	net_uring_is_enabled = false;
+}
+
 static int
 tx_check_schema(uint32_t new_schema_version)
 {
@@ -1046,10 +2337,15 @@ tx_process_select(struct cmsg *m)
 	if (tx_check_schema(msg->header.schema_version))
 		goto error;
 
-	rc = box_select(&port,
-			req->space_id, req->index_id,
-			req->iterator, req->offset, req->limit,
-			req->key, req->key_end);
+	if (msg->header.type == IPROTO_GET_MANY) {
+		rc = box_get_many(&port, req->space_id, req->index_id,
+				  req->key, req->key_end);
+	} else {
+		rc = box_select(&port,
+				req->space_id, req->index_id,
+				req->iterator, req->offset, req->limit,
+				req->key, req->key_end);
+	}
 	if (rc < 0 || iproto_prepare_select(out, &svp) != 0)
 		goto error;
 	if (port_dump(&port, out) != 0) {
@@ -1067,6 +2363,270 @@ error:
 	msg->write_end = obuf_create_svp(out);
 }
 
+/**
+ * Return true if the request reads a memtx space, and so
+ * doesn't yield. The net thread doesn't know the engine of
+ * a space, so a batch may contain SELECT and GET_MANY
+ * requests of any space, see iproto_msg_is_batchable().
+ */
+static inline bool
+tx_msg_is_memtx(struct iproto_msg *msg)
+{
+	struct space *space = space_by_id(msg->dml_request.space_id);
+	/* A missing space is reported at once. */
+	return space == NULL || space_is_memtx(space);
+}
+
+/**
+ * Route a request taken out of a batch and hand it back to
+ * the tx fiber pool, which processes it in a fiber of its
+ * own, like any request sent by the net thread. The replies
+ * may come out of order, as they do for requests processed
+ * in different fibers.
+ */
+static void
+tx_detach_msg(struct iproto_msg *msg, const struct cmsg_hop *route)
+{
+	cmsg_init(msg, route);
+	cpipe_push(&tx_detach_pipe, msg);
+}
+
+/**
+ * Process a message with a batch of requests, see
+ * iproto_sched_batch(), one by one in the same fiber, so that
+ * the replies are written to the output buffer one after
+ * another. Reads of other engines may yield, so each of them
+ * gets a fiber of its own rather than holds up the batch.
+ */
+static void
+tx_process_batch(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	struct stailq batch;
+	stailq_create(&batch);
+	stailq_concat(&batch, &msg->batch);
+	if (! tx_msg_is_memtx(msg)) {
+		/* The rest of the batch goes on in another fiber. */
+		if (! stailq_empty(&batch)) {
+			struct iproto_msg *next =
+				stailq_shift_entry(&batch, struct iproto_msg,
+						   in_queue);
+			stailq_create(&next->batch);
+			stailq_concat(&next->batch, &batch);
+			tx_detach_msg(next, batch_route);
+		}
+		tx_process_select(msg);
+		return;
+	}
+	tx_process_select(msg);
+	while (! stailq_empty(&batch)) {
+		struct iproto_msg *next =
+			stailq_shift_entry(&batch, struct iproto_msg, in_queue);
+		if (tx_msg_is_memtx(next)) {
+			tx_process_select(next);
+			stailq_add_tail_entry(&msg->batch, next, in_queue);
+		} else {
+			tx_detach_msg(next, select_route);
+		}
+	}
+}
+
+static void
+tx_cursor_delete(struct iproto_connection *con, struct iproto_cursor *cursor)
+{
+	assert(!cursor->in_use);
+	rlist_del_entry(cursor, in_connection);
+	rlist_del_entry(cursor, in_lru);
+	iterator_delete(cursor->it);
+	free(cursor);
+	con->cursor_count--;
+}
+
+static struct iproto_cursor *
+tx_cursor_open(struct iproto_connection *con, struct request *req)
+{
+	if (con->cursor_count >= IPROTO_CURSOR_MAX) {
+		diag_set(ClientError, ER_ILLEGAL_PARAMS,
+			 tt_sprintf("too many open cursors, max %d",
+				    IPROTO_CURSOR_MAX));
+		return NULL;
+	}
+	struct iproto_cursor *cursor = (struct iproto_cursor *)
+		malloc(sizeof(*cursor));
+	if (cursor == NULL) {
+		diag_set(OutOfMemory, sizeof(*cursor), "malloc",
+			 "struct iproto_cursor");
+		return NULL;
+	}
+	cursor->it = box_index_iterator(req->space_id, req->index_id,
+					req->iterator, req->key, req->key_end);
+	if (cursor->it == NULL) {
+		free(cursor);
+		return NULL;
+	}
+	cursor->connection = con;
+	cursor->id = ++con->last_cursor_id;
+	cursor->last_used = ev_monotonic_now(loop());
+	cursor->in_use = false;
+	rlist_add_tail_entry(&con->cursors, cursor, in_connection);
+	rlist_add_tail_entry(&tx_cursors, cursor, in_lru);
+	con->cursor_count++;
+	return cursor;
+}
+
+static struct iproto_cursor *
+tx_cursor_find(struct iproto_connection *con, uint64_t id)
+{
+	struct iproto_cursor *cursor;
+	rlist_foreach_entry(cursor, &con->cursors, in_connection) {
+		if (cursor->id != id)
+			continue;
+		if (cursor->in_use) {
+			diag_set(ClientError, ER_ILLEGAL_PARAMS,
+				 tt_sprintf("cursor %llu is busy",
+					    (unsigned long long) id));
+			return NULL;
+		}
+		return cursor;
+	}
+	diag_set(ClientError, ER_ILLEGAL_PARAMS,
+		 tt_sprintf("cursor %llu is not open",
+			    (unsigned long long) id));
+	return NULL;
+}
+
+/**
+ * Close cursors which have not been used for
+ * box.cfg.iproto_cursor_timeout seconds: a cursor pins an
+ * index iterator, and a vinyl iterator pins a read view.
+ */
+static int
+tx_cursor_gc_f(va_list ap)
+{
+	(void) ap;
+	while (!fiber_is_cancelled()) {
+		double timeout = iproto_cursor_timeout;
+		ev_tstamp deadline = ev_monotonic_now(loop()) - timeout;
+		struct iproto_cursor *cursor, *tmp;
+		rlist_foreach_entry_safe(cursor, &tx_cursors, in_lru, tmp) {
+			if (cursor->last_used > deadline)
+				break;
+			if (!cursor->in_use)
+				tx_cursor_delete(cursor->connection, cursor);
+		}
+		fiber_sleep(MIN(timeout, (double) IPROTO_CURSOR_GC_PERIOD));
+	}
+	return 0;
+}
+
+/**
+ * Fetch the next chunk of a cursor: at most @a limit tuples,
+ * if @a limit is not 0, and not much more than
+ * IPROTO_CURSOR_CHUNK_SIZE bytes. @a is_eof is set if the
+ * cursor is exhausted.
+ */
+static int
+tx_cursor_fetch(struct iproto_cursor *cursor, uint32_t limit,
+		struct port *port, bool *is_eof)
+{
+	rmean_collect(rmean_box, IPROTO_SELECT, 1);
+	cursor->last_used = ev_monotonic_now(loop());
+	rlist_del_entry(cursor, in_lru);
+	rlist_add_tail_entry(&tx_cursors, cursor, in_lru);
+	assert(!cursor->in_use);
+	cursor->in_use = true;
+	int rc = 0;
+	size_t size = 0;
+	uint32_t found = 0;
+	*is_eof = false;
+	while ((limit == 0 || found < limit) &&
+	       size < IPROTO_CURSOR_CHUNK_SIZE) {
+		struct tuple *tuple;
+		if (iterator_next(cursor->it, &tuple) != 0) {
+			rc = -1;
+			break;
+		}
+		if (tuple == NULL) {
+			*is_eof = true;
+			break;
+		}
+		if (port_add_tuple(port, tuple) != 0) {
+			rc = -1;
+			break;
+		}
+		size += tuple->bsize;
+		found++;
+	}
+	cursor->in_use = false;
+	return rc;
+}
+
+/**
+ * Serve IPROTO_CURSOR_OPEN, IPROTO_CURSOR_FETCH and
+ * IPROTO_CURSOR_CLOSE. A reply to OPEN and FETCH has the same
+ * DATA as a reply to SELECT, and the cursor id, if the cursor
+ * may have more tuples. An exhausted cursor is closed right
+ * away.
+ */
+static void
+tx_process_cursor(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	struct iproto_connection *con = msg->connection;
+	struct obuf *out = msg->p_obuf;
+	struct request *req = &msg->dml_request;
+	struct iproto_cursor *cursor;
+	struct obuf_svp svp;
+	struct port port;
+	bool is_eof;
+
+	tx_fiber_init(con->session, msg->header.sync);
+
+	port_create(&port);
+	auto port_guard = make_scoped_guard([&](){ port_destroy(&port); });
+
+	if (tx_check_schema(msg->header.schema_version))
+		goto error;
+
+	if (msg->header.type == IPROTO_CURSOR_OPEN)
+		cursor = tx_cursor_open(con, req);
+	else
+		cursor = tx_cursor_find(con, req->cursor_id);
+	if (cursor == NULL)
+		goto error;
+	if (msg->header.type == IPROTO_CURSOR_CLOSE) {
+		tx_cursor_delete(con, cursor);
+		if (iproto_reply_ok(out, msg->header.sync,
+				    ::schema_version) != 0)
+			goto error;
+		msg->write_end = obuf_create_svp(out);
+		return;
+	}
+	if (tx_cursor_fetch(cursor, req->limit, &port, &is_eof) != 0)
+		goto error_close;
+	if (iproto_prepare_select(out, &svp) != 0)
+		goto error_close;
+	if (port_dump(&port, out) != 0 ||
+	    iproto_reply_cursor(out, &svp, msg->header.sync,
+				::schema_version, port.size,
+				is_eof ? 0 : cursor->id) != 0) {
+		/* Discard the prepared select. */
+		obuf_rollback_to_svp(out, &svp);
+		goto error_close;
+	}
+	if (is_eof)
+		tx_cursor_delete(con, cursor);
+	msg->write_end = obuf_create_svp(out);
+	return;
+error_close:
+	/* The fetched tuples are lost, the cursor is useless. */
+	tx_cursor_delete(con, cursor);
+error:
+	iproto_reply_error(out, diag_last_error(&fiber()->diag),
+			   msg->header.sync, ::schema_version);
+	msg->write_end = obuf_create_svp(out);
+}
+
 static void
 tx_process_misc(struct cmsg *m)
 {
@@ -1089,6 +2649,9 @@ tx_process_misc(struct cmsg *m)
 			break;
 		case IPROTO_AUTH:
 			box_process_auth(&msg->auth_request, out);
+			msg->is_authenticated =
+				msg->connection->session->credentials.uid !=
+				GUEST;
 			break;
 		case IPROTO_PING:
 			iproto_reply_ok_xc(out, msg->header.sync,
@@ -1177,6 +2740,8 @@ net_send_msg(struct cmsg *m)
 	/* Discard request (see iproto_enqueue_batch()) */
 	msg->p_ibuf->rpos += msg->len;
 	msg->p_obuf->wend = msg->write_end;
+	if (msg->header.type == IPROTO_AUTH)
+		con->is_authenticated = msg->is_authenticated;
 
 	if (evio_has_fd(&con->output)) {
 		if (! ev_is_active(&con->output))
@@ -1187,6 +2752,24 @@ net_send_msg(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
+/**
+ * Complete the requests of a batch message in the order they
+ * were processed, so that the output buffer end moves forward.
+ */
+static void
+net_send_batch(struct cmsg *m)
+{
+	struct iproto_msg *msg = (struct iproto_msg *) m;
+	struct stailq batch;
+	stailq_create(&batch);
+	stailq_concat(&batch, &msg->batch);
+	net_send_msg(msg);
+	while (! stailq_empty(&batch)) {
+		msg = stailq_shift_entry(&batch, struct iproto_msg, in_queue);
+		net_send_msg(msg);
+	}
+}
+
 static void
 net_end_join_subscribe(struct cmsg *m)
 {
@@ -1329,6 +2912,7 @@ net_cord_f(va_list /* ap */)
 			  iproto_on_accept, NULL);
 
 
+	iproto_sched_init();
 	/* Init statistics counter */
 	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
 
@@ -1337,11 +2921,14 @@ net_cord_f(va_list /* ap */)
 			  "rmean", "struct rmean");
 	}
 
+	if (iproto_backend == IPROTO_BACKEND_IO_URING)
+		iproto_uring_init();
+
 	struct cbus_endpoint endpoint;
 	/* Create "net" endpoint. */
 	cbus_endpoint_create(&endpoint, "net", fiber_schedule_cb, fiber());
 	/* Create a pipe to "tx" thread. */
-	cpipe_create(&tx_pipe, "tx");
+	cpipe_create_spsc(&tx_pipe, "tx");
 	cpipe_set_max_input(&tx_pipe, IPROTO_MSG_MAX/2);
 	/* Process incomming messages. */
 	cbus_loop(&endpoint);
@@ -1355,23 +2942,40 @@ net_cord_f(va_list /* ap */)
 	if (evio_service_is_active(&binary))
 		evio_service_stop(&binary);
 
+	iproto_uring_free();
 	rmean_delete(rmean_net);
 	return 0;
 }
 
-/** Initialize the iproto subsystem and start network io thread */
 void
-iproto_init()
+iproto_init(enum iproto_backend backend)
 {
 	tx_cord = cord();
+	iproto_backend = backend;
 
 	static struct cord net_cord;
 	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
 		panic("failed to initialize iproto thread");
 
 	/* Create a pipe to "net" thread. */
-	cpipe_create(&net_pipe, "net");
+	cpipe_create_spsc(&net_pipe, "net");
 	cpipe_set_max_input(&net_pipe, IPROTO_MSG_MAX/2);
+	/* Create a pipe to the tx fiber pool. */
+	cpipe_create(&tx_detach_pipe, "tx");
+
+	tx_cursor_gc_fiber = fiber_new("iproto.cursor_gc", tx_cursor_gc_f);
+	if (tx_cursor_gc_fiber == NULL)
+		panic("failed to start iproto cursor gc fiber");
+	fiber_start(tx_cursor_gc_fiber);
+}
+
+void
+iproto_set_cursor_timeout(double timeout)
+{
+	iproto_cursor_timeout = timeout;
+	/* Apply a shorter timeout right away. */
+	if (tx_cursor_gc_fiber != NULL)
+		fiber_wakeup(tx_cursor_gc_fiber);
 }
 
 /**
@@ -30,8 +30,42 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+/** How the net thread does socket I/O, box.cfg.iproto_backend. */
+enum iproto_backend {
+	/** read() and writev() on socket readiness. */
+	IPROTO_BACKEND_EVIO = 0,
+	/**
+	 * Reads and writes of all ready connections are
+	 * submitted with a single io_uring system call per
+	 * event loop iteration.
+	 */
+	IPROTO_BACKEND_IO_URING,
+	IPROTO_BACKEND_MAX
+};
+
+extern const char *iproto_backend_STRS[];
+
+/**
+ * box.cfg.iproto_compression: whether authenticated clients
+ * may enable compression with IPROTO_COMPRESS. Set in the tx
+ * thread, read in the net thread.
+ */
+extern bool iproto_compression;
+
+/**
+ * box.cfg.iproto_cursor_timeout: a server-side cursor which
+ * is not used for this number of seconds is closed. Used only
+ * in the tx thread.
+ */
+extern double iproto_cursor_timeout;
+
+/**
+ * Initialize the iproto subsystem and start the network
+ * thread. The io_uring backend falls back to evio if it is
+ * not supported by the system.
+ */
 void
-iproto_init();
+iproto_init(enum iproto_backend backend);
 
 void
 iproto_bind(const char *uri);
@@ -39,4 +73,8 @@ iproto_bind(const char *uri);
 void
 iproto_listen();
 
+/** Set box.cfg.iproto_cursor_timeout. */
+void
+iproto_set_cursor_timeout(double timeout);
+
 #endif
@@ -61,10 +61,10 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 		/* 0x13 */	MP_UINT, /* IPROTO_OFFSET */
 		/* 0x14 */	MP_UINT, /* IPROTO_ITERATOR */
 		/* 0x15 */	MP_UINT, /* IPROTO_INDEX_BASE */
+		/* 0x16 */	MP_UINT, /* IPROTO_CURSOR_ID */
 	/* }}} */
 
 	/* {{{ unused */
-		/* 0x16 */	MP_UINT,
 		/* 0x17 */	MP_UINT,
 		/* 0x18 */	MP_UINT,
 		/* 0x19 */	MP_UINT,
@@ -104,6 +104,10 @@ const char *iproto_type_strs[] =
 	"UPSERT",
 	"CALL",
 	"EXECUTE",
+	NULL, /* GET_MANY, accounted as SELECT */
+	NULL, /* CURSOR_OPEN, accounted as SELECT */
+	NULL, /* CURSOR_FETCH, accounted as SELECT */
+	NULL, /* CURSOR_CLOSE */
 };
 
 #define bit(c) (1ULL<<IPROTO_##c)
@@ -118,6 +122,12 @@ const uint64_t iproto_body_key_map[IPROTO_TYPE_STAT_MAX] = {
 	0,                                                     /* AUTH */
 	0,                                                     /* EVAL */
 	bit(SPACE_ID) | bit(OPS) | bit(TUPLE),                 /* UPSERT */
+	0,                                                     /* CALL */
+	0,                                                     /* EXECUTE */
+	bit(SPACE_ID) | bit(KEY),                              /* GET_MANY */
+	bit(SPACE_ID) | bit(KEY),                              /* CURSOR_OPEN */
+	bit(CURSOR_ID),                                        /* CURSOR_FETCH */
+	bit(CURSOR_ID),                                        /* CURSOR_CLOSE */
 };
 #undef bit
 
@@ -144,7 +154,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"offset",           /* 0x13 */
 	"iterator",         /* 0x14 */
 	"index base",       /* 0x15 */
-	NULL,               /* 0x16 */
+	"cursor id",        /* 0x16 */
 	NULL,               /* 0x17 */
 	NULL,               /* 0x18 */
 	NULL,               /* 0x19 */
@@ -210,7 +220,9 @@ const char *vy_run_info_key_strs[VY_RUN_INFO_KEY_MAX] = {
 	"min lsn",
 	"max lsn",
 	"page count",
-	"bloom filter"
+	"bloom filter",
+	"blobs",
+	"bloom hash"
 };
 
 const char *vy_row_index_key_strs[VY_ROW_INDEX_KEY_MAX] = {
@@ -66,6 +66,8 @@ enum iproto_key {
 	IPROTO_OFFSET = 0x13,
 	IPROTO_ITERATOR = 0x14,
 	IPROTO_INDEX_BASE = 0x15,
+	/** Id of a server-side cursor, see IPROTO_CURSOR_OPEN. */
+	IPROTO_CURSOR_ID = 0x16,
 
 	/* Leave a gap between integer values and other keys */
 	IPROTO_KEY = 0x20,
@@ -121,7 +123,7 @@ enum iproto_key {
 			  bit(LSN) | bit(SCHEMA_VERSION))
 #define IPROTO_DML_BODY_BMAP (bit(SPACE_ID) | bit(INDEX_ID) | bit(LIMIT) |\
 			      bit(OFFSET) | bit(ITERATOR) | bit(INDEX_BASE) |\
-			      bit(KEY) | bit(TUPLE) | bit(OPS))
+			      bit(KEY) | bit(TUPLE) | bit(OPS) | bit(CURSOR_ID))
 
 static inline bool
 xrow_header_has_key(const char *pos, const char *end)
@@ -176,6 +178,18 @@ enum iproto_type {
 	IPROTO_CALL = 10,
 	/** Execute an SQL statement. */
 	IPROTO_EXECUTE = 11,
+	/** Look up many keys of a unique index at once. */
+	IPROTO_GET_MANY = 12,
+	/**
+	 * Open a server-side cursor over an index and fetch the
+	 * first chunk of tuples. The cursor lives until it is
+	 * exhausted, closed, or the connection is closed.
+	 */
+	IPROTO_CURSOR_OPEN = 13,
+	/** Fetch the next chunk of tuples of an open cursor. */
+	IPROTO_CURSOR_FETCH = 14,
+	/** Close a cursor before it is exhausted. */
+	IPROTO_CURSOR_CLOSE = 15,
 	/** The maximum typecode used for box.stat() */
 	IPROTO_TYPE_STAT_MAX,
 
@@ -185,6 +199,16 @@ enum iproto_type {
 	IPROTO_JOIN = 65,
 	/** Replication SUBSCRIBE command */
 	IPROTO_SUBSCRIBE = 66,
+	/**
+	 * Move a unix socket connection to a shared memory
+	 * channel, see shm_channel.h.
+	 */
+	IPROTO_SHM_OPEN = 67,
+	/**
+	 * Compress all subsequent input and output of the
+	 * connection with zstd, see iproto_zstd.h.
+	 */
+	IPROTO_COMPRESS = 68,
 
 	/** Vinyl run info stored in .index file */
 	VY_INDEX_RUN_INFO = 100,
@@ -245,6 +269,13 @@ iproto_type_is_dml(uint32_t type)
 		type == IPROTO_UPSERT;
 }
 
+/** A request to a server-side cursor. */
+static inline bool
+iproto_type_is_cursor(uint32_t type)
+{
+	return type >= IPROTO_CURSOR_OPEN && type <= IPROTO_CURSOR_CLOSE;
+}
+
 /**
  * Returns a map of mandatory members of IPROTO DML request.
  * @param type iproto type.
@@ -253,7 +284,8 @@ static inline uint64_t
 dml_request_key_map(uint32_t type)
 {
 	/** Advanced requests don't have a defined key map. */
-	assert(iproto_type_is_dml(type));
+	assert(iproto_type_is_dml(type) || type == IPROTO_GET_MANY ||
+	       iproto_type_is_cursor(type));
 	extern const uint64_t iproto_body_key_map[];
 	return iproto_body_key_map[type];
 }
@@ -266,7 +298,9 @@ dml_request_key_map(uint32_t type)
 static inline bool
 iproto_type_is_select(uint32_t type)
 {
-	return type <= IPROTO_SELECT || type == IPROTO_CALL || type == IPROTO_EVAL;
+	return type <= IPROTO_SELECT || type == IPROTO_CALL ||
+	       type == IPROTO_EVAL || type == IPROTO_GET_MANY ||
+	       iproto_type_is_cursor(type);
 }
 
 /** A common request with a mandatory and simple body (key, tuple, ops)  */
@@ -320,6 +354,10 @@ enum vy_run_info_key {
 	VY_RUN_INFO_PAGE_COUNT = 5,
 	/** Bloom filter for keys. */
 	VY_RUN_INFO_BLOOM = 6,
+	/** Blobs referenced by the run: array of [id, size]. */
+	VY_RUN_INFO_BLOBS = 7,
+	/** Version of the hash used to build the bloom filter. */
+	VY_RUN_INFO_BLOOM_HASH = 8,
 	/** The last key in this enum + 1 */
 	VY_RUN_INFO_KEY_MAX
 };
@@ -382,6 +420,19 @@ enum vy_row_index_key {
 	VY_ROW_INDEX_KEY_MAX
 };
 
+/**
+ * Xrow body keys of a Vinyl statement stored in a run, in
+ * addition to the DML request keys. Chosen beyond
+ * IPROTO_KEY_MAX so that xrow_decode_dml() skips them.
+ */
+enum vy_stmt_key {
+	/**
+	 * Set if the statement tuple contains references to
+	 * the value log, see vy_blob.h.
+	 */
+	VY_STMT_BLOB_REFS = 0x80,
+};
+
 /**
  * Return vy_page_info key name by @a key code.
  * @param key key
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "iproto_zstd.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+#include "error.h"
+#include "trivia/util.h"
+
+int
+iproto_zstd_create(struct iproto_zstd *zstd, int level)
+{
+	memset(zstd, 0, sizeof(*zstd));
+	zstd->in = (char *) malloc(IPROTO_ZSTD_BUF_SIZE);
+	zstd->out = (char *) malloc(IPROTO_ZSTD_BUF_SIZE);
+	if (zstd->in == NULL || zstd->out == NULL) {
+		diag_set(OutOfMemory, IPROTO_ZSTD_BUF_SIZE, "malloc",
+			 "zstd buffers");
+		goto error;
+	}
+	zstd->cstream = ZSTD_createCStream();
+	if (zstd->cstream == NULL ||
+	    ZSTD_isError(ZSTD_initCStream(zstd->cstream, level))) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 "failed to create context");
+		goto error;
+	}
+	zstd->dstream = ZSTD_createDStream();
+	if (zstd->dstream == NULL ||
+	    ZSTD_isError(ZSTD_initDStream(zstd->dstream))) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 "failed to create context");
+		goto error;
+	}
+	return 0;
+error:
+	iproto_zstd_destroy(zstd);
+	return -1;
+}
+
+void
+iproto_zstd_destroy(struct iproto_zstd *zstd)
+{
+	if (zstd->cstream != NULL)
+		ZSTD_freeCStream(zstd->cstream);
+	if (zstd->dstream != NULL)
+		ZSTD_freeDStream(zstd->dstream);
+	free(zstd->in);
+	free(zstd->out);
+	memset(zstd, 0, sizeof(*zstd));
+}
+
+ssize_t
+iproto_zstd_decompress(struct iproto_zstd *zstd, void *buf, size_t size)
+{
+	ZSTD_inBuffer input = {zstd->in, zstd->in_size, zstd->in_pos};
+	ZSTD_outBuffer output = {buf, size, 0};
+	size_t rc = ZSTD_decompressStream(zstd->dstream, &output, &input);
+	if (ZSTD_isError(rc)) {
+		diag_set(ClientError, ER_DECOMPRESSION,
+			 ZSTD_getErrorName(rc));
+		return -1;
+	}
+	zstd->in_pos = input.pos;
+	if (zstd->in_pos == zstd->in_size)
+		zstd->in_pos = zstd->in_size = 0;
+	zstd->in_has_more = output.pos == output.size;
+	return output.pos;
+}
+
+ssize_t
+iproto_zstd_compress(struct iproto_zstd *zstd, const struct iovec *iov,
+		     int iovcnt)
+{
+	assert(zstd->out_size == 0);
+	ZSTD_outBuffer output = {zstd->out, IPROTO_ZSTD_BUF_SIZE, 0};
+	size_t total = 0;
+	size_t rc;
+	for (int i = 0; i < iovcnt && !zstd->out_has_more &&
+	     total < IPROTO_ZSTD_CHUNK_SIZE; i++) {
+		size_t len = MIN(iov[i].iov_len,
+				 IPROTO_ZSTD_CHUNK_SIZE - total);
+		ZSTD_inBuffer input = {iov[i].iov_base, len, 0};
+		while (input.pos < input.size && output.pos < output.size) {
+			rc = ZSTD_compressStream(zstd->cstream, &output,
+						 &input);
+			if (ZSTD_isError(rc))
+				goto error;
+		}
+		total += input.pos;
+		if (input.pos < input.size)
+			break;
+	}
+	rc = ZSTD_flushStream(zstd->cstream, &output);
+	if (ZSTD_isError(rc))
+		goto error;
+	zstd->out_has_more = rc != 0;
+	zstd->out_pos = 0;
+	zstd->out_size = output.pos;
+	return total;
+error:
+	diag_set(ClientError, ER_COMPRESSION, ZSTD_getErrorName(rc));
+	return -1;
+}
@@ -0,0 +1,177 @@
+#ifndef TARANTOOL_BOX_IPROTO_ZSTD_H_INCLUDED
+#define TARANTOOL_BOX_IPROTO_ZSTD_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/**
+ * zstd stream compression of an iproto connection, enabled by
+ * IPROTO_COMPRESS. Both directions of the connection become
+ * a single zstd stream each, which is flushed every time
+ * a portion of data is sent, so that the peer can decode all
+ * it has received.
+ *
+ * The object doesn't do any I/O itself. Compressed input is
+ * read to iproto_zstd_input_buf() and decompressed with
+ * iproto_zstd_decompress(). Output is compressed with
+ * iproto_zstd_compress() and then written from
+ * iproto_zstd_output_buf().
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <zstd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+enum {
+	/** Size of the buffers of compressed input and output. */
+	IPROTO_ZSTD_BUF_SIZE = 128 * 1024,
+	/** Max size of data compressed at once. */
+	IPROTO_ZSTD_CHUNK_SIZE = 64 * 1024,
+	/** zstd level, fast, so as not to slow down the net thread. */
+	IPROTO_ZSTD_LEVEL = 1,
+};
+
+struct iproto_zstd {
+	ZSTD_CStream *cstream;
+	ZSTD_DStream *dstream;
+	/** Compressed input, [in_pos, in_size) is not decoded yet. */
+	char *in;
+	size_t in_pos;
+	size_t in_size;
+	/**
+	 * Set if the last decompression filled up the output,
+	 * so the stream may have more decompressed data.
+	 */
+	bool in_has_more;
+	/** Compressed output, [out_pos, out_size) is not sent yet. */
+	char *out;
+	size_t out_pos;
+	size_t out_size;
+	/** Set if the stream wasn't fully flushed to the output. */
+	bool out_has_more;
+};
+
+/**
+ * Create compression and decompression streams.
+ * @retval  0 Success.
+ * @retval -1 Memory error, diag is set.
+ */
+int
+iproto_zstd_create(struct iproto_zstd *zstd, int level);
+
+void
+iproto_zstd_destroy(struct iproto_zstd *zstd);
+
+/**
+ * Return true if the data read so far may have more to
+ * decompress, i.e. iproto_zstd_decompress() should be called
+ * before reading more input.
+ */
+static inline bool
+iproto_zstd_has_input(struct iproto_zstd *zstd)
+{
+	return zstd->in_pos < zstd->in_size || zstd->in_has_more;
+}
+
+/**
+ * Return the buffer to read compressed input to, and its
+ * size. Must only be used if there is nothing to decompress.
+ */
+static inline char *
+iproto_zstd_input_buf(struct iproto_zstd *zstd, size_t *size)
+{
+	*size = IPROTO_ZSTD_BUF_SIZE - zstd->in_size;
+	return zstd->in + zstd->in_size;
+}
+
+/** Account @a size bytes read to iproto_zstd_input_buf(). */
+static inline void
+iproto_zstd_input_advance(struct iproto_zstd *zstd, size_t size)
+{
+	zstd->in_size += size;
+}
+
+/**
+ * Decompress the input read so far to @a buf.
+ * @retval >0 Size of the decompressed data.
+ * @retval  0 More input is needed.
+ * @retval -1 Invalid input, diag is set.
+ */
+ssize_t
+iproto_zstd_decompress(struct iproto_zstd *zstd, void *buf, size_t size);
+
+/** Return true if there is output which is not sent yet. */
+static inline bool
+iproto_zstd_has_output(struct iproto_zstd *zstd)
+{
+	return zstd->out_pos < zstd->out_size || zstd->out_has_more;
+}
+
+/**
+ * Return compressed output to send and its size, 0 if more
+ * output must be produced with iproto_zstd_compress().
+ */
+static inline const char *
+iproto_zstd_output_buf(struct iproto_zstd *zstd, size_t *size)
+{
+	*size = zstd->out_size - zstd->out_pos;
+	return zstd->out + zstd->out_pos;
+}
+
+/** Account @a size bytes of output sent. */
+static inline void
+iproto_zstd_output_advance(struct iproto_zstd *zstd, size_t size)
+{
+	zstd->out_pos += size;
+	if (zstd->out_pos == zstd->out_size)
+		zstd->out_pos = zstd->out_size = 0;
+}
+
+/**
+ * Compress and flush at most IPROTO_ZSTD_CHUNK_SIZE bytes of
+ * @a iov to the output buffer, which must be sent out before
+ * the next call. Only finish flushing the stream if it hasn't
+ * been done by the previous call.
+ * @retval >=0 Size of the data consumed from @a iov.
+ * @retval  -1 Compression error, diag is set.
+ */
+ssize_t
+iproto_zstd_compress(struct iproto_zstd *zstd, const struct iovec *iov,
+		     int iovcnt);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_IPROTO_ZSTD_H_INCLUDED */
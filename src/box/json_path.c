@@ -0,0 +1,183 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "json_path.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <msgpuck.h>
+
+static inline bool
+json_is_key_start(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline bool
+json_is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+int
+json_lexer_next_token(struct json_lexer *lexer, struct json_token *token)
+{
+	const char *src = lexer->src;
+	uint32_t len = lexer->src_len;
+	uint32_t pos = lexer->offset;
+	if (pos == len) {
+		token->type = JSON_TOKEN_END;
+		return 0;
+	}
+	if (src[pos] == '.') {
+		uint32_t start = ++pos;
+		if (pos == len || !json_is_key_start(src[pos]))
+			return pos + 1;
+		while (pos < len && (json_is_key_start(src[pos]) ||
+				     json_is_digit(src[pos])))
+			pos++;
+		token->type = JSON_TOKEN_KEY;
+		token->key = src + start;
+		token->key_len = pos - start;
+		lexer->offset = pos;
+		return 0;
+	}
+	if (src[pos] != '[')
+		return pos + 1;
+	if (++pos == len)
+		return pos + 1;
+	if (src[pos] == '*') {
+		pos++;
+		token->type = JSON_TOKEN_ANY;
+	} else {
+		/* No leading zeros: a path has the only spelling. */
+		if (!json_is_digit(src[pos]) || src[pos] == '0')
+			return pos + 1;
+		uint64_t index = 0;
+		while (pos < len && json_is_digit(src[pos])) {
+			index = index * 10 + (src[pos] - '0');
+			if (index > UINT32_MAX)
+				return pos + 1;
+			pos++;
+		}
+		token->type = JSON_TOKEN_INDEX;
+		token->index = index - 1;
+	}
+	if (pos == len || src[pos] != ']')
+		return pos + 1;
+	lexer->offset = pos + 1;
+	return 0;
+}
+
+int
+json_path_validate(const char *path, uint32_t path_len,
+		   uint32_t *multikey_len)
+{
+	*multikey_len = 0;
+	if (path_len == 0)
+		return 1;
+	struct json_lexer lexer;
+	json_lexer_create(&lexer, path, path_len);
+	struct json_token token;
+	int rc;
+	while ((rc = json_lexer_next_token(&lexer, &token)) == 0 &&
+	       token.type != JSON_TOKEN_END) {
+		if (token.type != JSON_TOKEN_ANY)
+			continue;
+		if (*multikey_len != 0)
+			return lexer.offset;
+		*multikey_len = lexer.offset;
+	}
+	return rc;
+}
+
+/** Find a map value by a string key. */
+static const char *
+json_find_key(const char *data, const char *key, uint32_t key_len)
+{
+	if (mp_typeof(*data) != MP_MAP)
+		return NULL;
+	uint32_t count = mp_decode_map(&data);
+	for (uint32_t i = 0; i < count; i++) {
+		if (mp_typeof(*data) == MP_STR) {
+			uint32_t len;
+			const char *str = mp_decode_str(&data, &len);
+			if (len == key_len && memcmp(str, key, len) == 0)
+				return data;
+		} else {
+			mp_next(&data);
+		}
+		mp_next(&data);
+	}
+	return NULL;
+}
+
+/** Find an array item by a zero-based index. */
+static const char *
+json_find_index(const char *data, uint32_t index)
+{
+	if (mp_typeof(*data) != MP_ARRAY)
+		return NULL;
+	uint32_t count = mp_decode_array(&data);
+	if (index >= count)
+		return NULL;
+	for (uint32_t i = 0; i < index; i++)
+		mp_next(&data);
+	return data;
+}
+
+const char *
+json_path_find(const char *data, const char *path, uint32_t path_len,
+	       uint32_t multikey_idx)
+{
+	struct json_lexer lexer;
+	json_lexer_create(&lexer, path, path_len);
+	struct json_token token;
+	while (data != NULL) {
+		int rc = json_lexer_next_token(&lexer, &token);
+		assert(rc == 0);
+		(void) rc;
+		switch (token.type) {
+		case JSON_TOKEN_END:
+			return data;
+		case JSON_TOKEN_KEY:
+			data = json_find_key(data, token.key, token.key_len);
+			break;
+		case JSON_TOKEN_INDEX:
+			data = json_find_index(data, token.index);
+			break;
+		case JSON_TOKEN_ANY:
+			data = json_find_index(data, multikey_idx);
+			break;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,135 @@
+#ifndef TARANTOOL_BOX_JSON_PATH_H_INCLUDED
+#define TARANTOOL_BOX_JSON_PATH_H_INCLUDED
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * A JSON path addresses a value nested in a MessagePack map or
+ * array, e.g. a tuple field. It is a sequence of tokens:
+ *
+ * - ".name" - a map value by a string key, the key consists
+ *   of latin letters, digits and underscores and does not start
+ *   with a digit;
+ * - "[N]" - an array item, N is one-based like tuple field
+ *   numbers in Lua;
+ * - "[*]" - any array item. A path may contain at most one
+ *   such token. An index part with such a path is multikey,
+ *   i.e. it indexes a tuple under the key of each array item.
+ *
+ * For example, ".user.id", "[1].name", ".tags[*]". A path
+ * has the only spelling, so paths can be compared with memcmp.
+ */
+enum json_token_type {
+	JSON_TOKEN_END,
+	JSON_TOKEN_KEY,
+	JSON_TOKEN_INDEX,
+	JSON_TOKEN_ANY,
+};
+
+/** A single path token. */
+struct json_token {
+	enum json_token_type type;
+	/** Map key, JSON_TOKEN_KEY only. */
+	const char *key;
+	/** Length of @a key. */
+	uint32_t key_len;
+	/** Zero-based array index, JSON_TOKEN_INDEX only. */
+	uint32_t index;
+};
+
+/** Path tokenizer. */
+struct json_lexer {
+	/** Path to tokenize. */
+	const char *src;
+	/** Length of @a src. */
+	uint32_t src_len;
+	/** Offset of the next token in @a src. */
+	uint32_t offset;
+};
+
+static inline void
+json_lexer_create(struct json_lexer *lexer, const char *src,
+		  uint32_t src_len)
+{
+	lexer->src = src;
+	lexer->src_len = src_len;
+	lexer->offset = 0;
+}
+
+/**
+ * Read the next path token.
+ * @param lexer Lexer.
+ * @param[out] token Token, JSON_TOKEN_END at the end of the path.
+ *
+ * @retval  0 Success.
+ * @retval >0 One-based position of a syntax error in the path.
+ */
+int
+json_lexer_next_token(struct json_lexer *lexer, struct json_token *token);
+
+/**
+ * Check that a path is valid and non-empty.
+ * @param path Path.
+ * @param path_len Length of @a path.
+ * @param[out] multikey_len Length of the path prefix ending with
+ *             "[*]" or 0 if there is no such token.
+ *
+ * @retval  0 Success.
+ * @retval >0 One-based position of an error in the path.
+ */
+int
+json_path_validate(const char *path, uint32_t path_len,
+		   uint32_t *multikey_len);
+
+/**
+ * Find a value by a path in MessagePack data.
+ * @param data MessagePack data.
+ * @param path Valid path.
+ * @param path_len Length of @a path.
+ * @param multikey_idx Index of the array item "[*]" refers to.
+ *
+ * @retval not NULL The value.
+ * @retval     NULL There is no such value in @a data.
+ */
+const char *
+json_path_find(const char *data, const char *path, uint32_t path_len,
+	       uint32_t multikey_idx);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_JSON_PATH_H_INCLUDED */
@@ -34,6 +34,8 @@
 #include "column_mask.h"
 #include "schema_def.h"
 #include "coll_cache.h"
+#include "json_path.h"
+#include "fiber.h"
 
 struct key_part_def {
 	/** Tuple field index for this part. */
@@ -44,6 +46,8 @@ struct key_part_def {
 	uint32_t coll_id;
 	/** True if a key part can store NULLs. */
 	bool is_nullable;
+	/** JSON path to the indexed value inside the field. */
+	const char *path;
 };
 
 static const struct key_part_def key_part_def_default = {
@@ -51,6 +55,7 @@ static const struct key_part_def key_part_def_default = {
 	field_type_MAX,
 	UINT32_MAX,
 	false,
+	NULL,
 };
 
 static int64_t
@@ -65,6 +70,7 @@ const struct opt_def part_def_reg[] = {
 	OPT_DEF("field", OPT_UINT32, struct key_part_def, fieldno),
 	OPT_DEF("collation", OPT_UINT32, struct key_part_def, coll_id),
 	OPT_DEF("is_nullable", OPT_BOOL, struct key_part_def, is_nullable),
+	OPT_DEF("path", OPT_STRPTR, struct key_part_def, path),
 	OPT_END,
 };
 
@@ -86,6 +92,7 @@ enum part_option {
 	PART_OPTION_FIELD = 0,
 	PART_OPTION_TYPE = 1,
 	PART_OPTION_COLLATION = 2,
+	PART_OPTION_PATH = 3,
 	field_type_option_MAX
 };
 
@@ -93,6 +100,7 @@ const char *field_type_option_strs[] = {
 	"field",
 	"type",
 	"collation",
+	"path",
 };
 
 const uint32_t key_mp_type[] = {
@@ -113,13 +121,21 @@ const uint32_t key_mp_type[] = {
 struct key_def *
 key_def_dup(const struct key_def *src)
 {
-	size_t sz = key_def_sizeof(src->part_count);
+	size_t sz = key_def_sizeof(src->part_count, src->path_pool_size);
 	struct key_def *res = (struct key_def *)malloc(sz);
 	if (res == NULL) {
 		diag_set(OutOfMemory, sz, "malloc", "res");
 		return NULL;
 	}
 	memcpy(res, src, sz);
+	/* Paths point to the path pool of the original. */
+	for (uint32_t i = 0; i < src->part_count; i++) {
+		const char *path = src->parts[i].path;
+		if (path != NULL) {
+			res->parts[i].path = (const char *)res +
+					     (path - (const char *)src);
+		}
+	}
 	return res;
 }
 
@@ -133,9 +149,9 @@ key_def_set_cmp(struct key_def *def)
 }
 
 struct key_def *
-key_def_new(uint32_t part_count)
+key_def_new_with_paths(uint32_t part_count, uint32_t path_pool_size)
 {
-	size_t sz = key_def_sizeof(part_count);
+	size_t sz = key_def_sizeof(part_count, path_pool_size);
 	/** Use calloc() to zero comparator function pointers. */
 	struct key_def *key_def = (struct key_def *) calloc(1, sz);
 	if (key_def == NULL) {
@@ -144,9 +160,16 @@ key_def_new(uint32_t part_count)
 	}
 	key_def->part_count = part_count;
 	key_def->unique_part_count = part_count;
+	key_def->path_pool_size = path_pool_size;
 	return key_def;
 }
 
+struct key_def *
+key_def_new(uint32_t part_count)
+{
+	return key_def_new_with_paths(part_count, 0);
+}
+
 box_key_def_t *
 box_key_def_new(uint32_t *fields, uint32_t *types, uint32_t part_count)
 {
@@ -157,7 +180,8 @@ box_key_def_new(uint32_t *fields, uint32_t *types, uint32_t part_count)
 	for (uint32_t item = 0; item < part_count; ++item) {
 		key_def_set_part(key_def, item, fields[item],
 				 (enum field_type)types[item],
-				 key_part_def_default.is_nullable, NULL);
+				 key_part_def_default.is_nullable, NULL,
+				 NULL, 0);
 	}
 	return key_def;
 }
@@ -168,6 +192,17 @@ box_key_def_delete(box_key_def_t *key_def)
 	free(key_def);
 }
 
+/** Compare paths of two key parts, the whole field goes first. */
+static inline int
+key_part_path_cmp(const struct key_part *part1, const struct key_part *part2)
+{
+	if (part1->path_len != part2->path_len)
+		return part1->path_len < part2->path_len ? -1 : 1;
+	if (part1->path_len == 0)
+		return 0;
+	return memcmp(part1->path, part2->path, part1->path_len);
+}
+
 int
 key_part_cmp(const struct key_part *parts1, uint32_t part_count1,
 	     const struct key_part *parts2, uint32_t part_count2)
@@ -187,6 +222,9 @@ key_part_cmp(const struct key_part *parts1, uint32_t part_count1,
 		if (part1->is_nullable != part2->is_nullable)
 			return part1->is_nullable <
 			       part2->is_nullable ? -1 : 1;
+		int rc = key_part_path_cmp(part1, part2);
+		if (rc != 0)
+			return rc;
 	}
 	return part_count1 < part_count2 ? -1 : part_count1 > part_count2;
 }
@@ -210,21 +248,50 @@ key_part_check_compatibility(const struct key_part *old_parts,
 			return false;
 		if (old_part->is_nullable != new_part->is_nullable)
 			return false;
+		if (key_part_path_cmp(old_part, new_part) != 0)
+			return false;
 	}
 	return true;
 }
 
 void
 key_def_set_part(struct key_def *def, uint32_t part_no, uint32_t fieldno,
-		 enum field_type type, bool is_nullable, struct coll *coll)
+		 enum field_type type, bool is_nullable, struct coll *coll,
+		 const char *path, uint32_t path_len)
 {
 	assert(part_no < def->part_count);
 	assert(type < field_type_MAX);
+	struct key_part *part = &def->parts[part_no];
 	def->is_nullable |= is_nullable;
-	def->parts[part_no].is_nullable = is_nullable;
-	def->parts[part_no].fieldno = fieldno;
-	def->parts[part_no].type = type;
-	def->parts[part_no].coll = coll;
+	part->is_nullable = is_nullable;
+	part->fieldno = fieldno;
+	part->type = type;
+	part->coll = coll;
+	part->path = NULL;
+	part->path_len = 0;
+	part->multikey_len = 0;
+	part->offset_slot_cache = 0;
+	part->format_epoch = 0;
+	if (path != NULL) {
+		/* Put the path after paths of the preceding parts. */
+		char *pool = (char *)&def->parts[def->part_count];
+		for (uint32_t i = 0; i < part_no; i++) {
+			if (def->parts[i].path != NULL)
+				pool += def->parts[i].path_len + 1;
+		}
+		assert(pool + path_len + 1 <= (char *)def +
+		       key_def_sizeof(def->part_count, def->path_pool_size));
+		memcpy(pool, path, path_len);
+		pool[path_len] = '\0';
+		part->path = pool;
+		part->path_len = path_len;
+		int rc = json_path_validate(path, path_len,
+					    &part->multikey_len);
+		assert(rc == 0);
+		(void) rc;
+		def->has_json_paths = true;
+		def->is_multikey |= part->multikey_len != 0;
+	}
 	column_mask_set_fieldno(&def->column_mask, fieldno);
 	/**
 	 * When all parts are set, initialize the tuple
@@ -252,6 +319,10 @@ key_def_snprint(char *buf, int size, const struct key_def *key_def)
 		assert(part->type < field_type_MAX);
 		SNPRINT(total, snprintf, buf, size, "%d, '%s'",
 			(int)part->fieldno, field_type_strs[part->type]);
+		if (part->path != NULL) {
+			SNPRINT(total, snprintf, buf, size, ", '%s'",
+				part->path);
+		}
 		if (i < key_def->part_count - 1)
 			SNPRINT(total, snprintf, buf, size, ", ");
 	}
@@ -265,7 +336,8 @@ key_def_sizeof_parts(const struct key_def *key_def)
 	size_t size = 0;
 	for (uint32_t i = 0; i < key_def->part_count; i++) {
 		const struct key_part *part = &key_def->parts[i];
-		size += mp_sizeof_map(part->coll == NULL ? 2 : 3);
+		size += mp_sizeof_map(2 + (part->coll != NULL) +
+				      (part->path != NULL));
 		const char *opt = field_type_option_strs[PART_OPTION_FIELD];
 		size += mp_sizeof_str(strlen(opt));
 		size += mp_sizeof_uint(part->fieldno);
@@ -278,6 +350,11 @@ key_def_sizeof_parts(const struct key_def *key_def)
 			size += mp_sizeof_str(strlen(opt));
 			size += mp_sizeof_uint(part->coll->id);
 		}
+		if (part->path != NULL) {
+			opt = field_type_option_strs[PART_OPTION_PATH];
+			size += mp_sizeof_str(strlen(opt));
+			size += mp_sizeof_str(part->path_len);
+		}
 	}
 	return size;
 }
@@ -287,7 +364,8 @@ key_def_encode_parts(char *data, const struct key_def *key_def)
 {
 	for (uint32_t i = 0; i < key_def->part_count; i++) {
 		const struct key_part *part = &key_def->parts[i];
-		data = mp_encode_map(data, part->coll == NULL ? 2 : 3);
+		data = mp_encode_map(data, 2 + (part->coll != NULL) +
+					   (part->path != NULL));
 		const char *opt = field_type_option_strs[PART_OPTION_FIELD];
 		data = mp_encode_str(data, opt, strlen(opt));
 		data = mp_encode_uint(data, part->fieldno);
@@ -301,6 +379,11 @@ key_def_encode_parts(char *data, const struct key_def *key_def)
 			data = mp_encode_str(data, opt, strlen(opt));
 			data = mp_encode_uint(data, part->coll->id);
 		}
+		if (part->path != NULL) {
+			opt = field_type_option_strs[PART_OPTION_PATH];
+			data = mp_encode_str(data, opt, strlen(opt));
+			data = mp_encode_str(data, part->path, part->path_len);
+		}
 	}
 	return data;
 }
@@ -361,7 +444,7 @@ key_def_decode_parts_166(struct key_def *key_def, const char **data,
 		else
 			is_nullable = key_part_def_default.is_nullable;
 		key_def_set_part(key_def, i, field_no, field_type, is_nullable,
-				 NULL);
+				 NULL, NULL, 0);
 	}
 	return 0;
 }
@@ -374,23 +457,27 @@ key_def_decode_parts(struct key_def *key_def, const char **data,
 		return key_def_decode_parts_166(key_def, data, fields,
 						field_count);
 	}
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	uint32_t path_pool_used = 0;
+	int rc = -1;
 	for (uint32_t i = 0; i < key_def->part_count; i++) {
 		if (mp_typeof(**data) != MP_MAP) {
 			diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
 				 i + TUPLE_INDEX_BASE,
 				 "index part is expected to be a map");
-			return -1;
+			goto out;
 		}
 		struct key_part_def part = key_part_def_default;
 		if (opts_decode(&part, part_def_reg, data,
 				ER_WRONG_INDEX_OPTIONS, i + TUPLE_INDEX_BASE,
-				NULL) != 0)
-			return -1;
+				region) != 0)
+			goto out;
 		if (part.type == field_type_MAX) {
 			diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
 				 i + TUPLE_INDEX_BASE,
 				 "index part: unknown field type");
-			return -1;
+			goto out;
 		}
 		struct coll *coll = NULL;
 		if (part.coll_id != UINT32_MAX) {
@@ -399,22 +486,81 @@ key_def_decode_parts(struct key_def *key_def, const char **data,
 				diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
 					 i + 1,
 					 "collation was not found by ID");
-				return -1;
+				goto out;
+			}
+		}
+		uint32_t path_len = 0;
+		if (part.path != NULL) {
+			path_len = strlen(part.path);
+			uint32_t multikey_len;
+			if (json_path_validate(part.path, path_len,
+					       &multikey_len) != 0) {
+				diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+					 i + TUPLE_INDEX_BASE,
+					 "invalid JSON path");
+				goto out;
+			}
+			path_pool_used += path_len + 1;
+			if (path_pool_used > key_def->path_pool_size) {
+				diag_set(ClientError, ER_WRONG_INDEX_OPTIONS,
+					 i + TUPLE_INDEX_BASE,
+					 "JSON path is not expected");
+				goto out;
 			}
 		}
 		key_def_set_part(key_def, i, part.fieldno, part.type,
-				 part.is_nullable, coll);
+				 part.is_nullable, coll, part.path, path_len);
 	}
-	return 0;
+	rc = 0;
+out:
+	region_truncate(region, region_svp);
+	return rc;
+}
+
+uint32_t
+key_def_decode_path_pool_size(const char *data, uint32_t part_count)
+{
+	const char *opt = field_type_option_strs[PART_OPTION_PATH];
+	uint32_t opt_len = strlen(opt);
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (mp_typeof(*data) != MP_MAP) {
+			mp_next(&data);
+			continue;
+		}
+		uint32_t map_size = mp_decode_map(&data);
+		for (uint32_t j = 0; j < map_size; j++) {
+			if (mp_typeof(*data) != MP_STR) {
+				mp_next(&data);
+				mp_next(&data);
+				continue;
+			}
+			uint32_t key_len;
+			const char *key = mp_decode_str(&data, &key_len);
+			if (key_len == opt_len &&
+			    memcmp(key, opt, key_len) == 0 &&
+			    mp_typeof(*data) == MP_STR) {
+				uint32_t path_len;
+				mp_decode_str(&data, &path_len);
+				size += path_len + 1;
+			} else {
+				mp_next(&data);
+			}
+		}
+	}
+	return size;
 }
 
 const struct key_part *
-key_def_find(const struct key_def *key_def, uint32_t fieldno)
+key_def_find(const struct key_def *key_def, uint32_t fieldno,
+	     const char *path, uint32_t path_len)
 {
 	const struct key_part *part = key_def->parts;
 	const struct key_part *end = part + key_def->part_count;
 	for (; part != end; part++) {
-		if (part->fieldno == fieldno)
+		if (part->fieldno == fieldno && part->path_len == path_len &&
+		    (path_len == 0 ||
+		     memcmp(part->path, path, path_len) == 0))
 			return part;
 	}
 	return NULL;
@@ -428,22 +574,27 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	 * Find and remove part duplicates, i.e. parts counted
 	 * twice since they are present in both key defs.
 	 */
+	uint32_t path_pool_size = first->path_pool_size;
 	const struct key_part *part = second->parts;
 	const struct key_part *end = part + second->part_count;
 	for (; part != end; part++) {
-		if (key_def_find(first, part->fieldno))
+		if (key_def_find(first, part->fieldno, part->path,
+				 part->path_len))
 			--new_part_count;
+		else if (part->path != NULL)
+			path_pool_size += part->path_len + 1;
 	}
 
 	struct key_def *new_def;
-	new_def =  (struct key_def *)calloc(1, key_def_sizeof(new_part_count));
+	size_t sz = key_def_sizeof(new_part_count, path_pool_size);
+	new_def =  (struct key_def *)calloc(1, sz);
 	if (new_def == NULL) {
-		diag_set(OutOfMemory, key_def_sizeof(new_part_count), "malloc",
-			 "new_def");
+		diag_set(OutOfMemory, sz, "malloc", "new_def");
 		return NULL;
 	}
 	new_def->part_count = new_part_count;
 	new_def->unique_part_count = new_part_count;
+	new_def->path_pool_size = path_pool_size;
 	new_def->is_nullable = first->is_nullable || second->is_nullable;
 	/* Write position in the new key def. */
 	uint32_t pos = 0;
@@ -452,17 +603,20 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	end = part + first->part_count;
 	for (; part != end; part++) {
 		key_def_set_part(new_def, pos++, part->fieldno, part->type,
-				 part->is_nullable, part->coll);
+				 part->is_nullable, part->coll, part->path,
+				 part->path_len);
 	}
 
 	/* Set-append second key def's part to the new key def. */
 	part = second->parts;
 	end = part + second->part_count;
 	for (; part != end; part++) {
-		if (key_def_find(first, part->fieldno))
+		if (key_def_find(first, part->fieldno, part->path,
+				 part->path_len))
 			continue;
 		key_def_set_part(new_def, pos++, part->fieldno, part->type,
-				 part->is_nullable, part->coll);
+				 part->is_nullable, part->coll, part->path,
+				 part->path_len);
 	}
 	return new_def;
 }
@@ -55,6 +55,28 @@ struct key_part {
 	struct coll *coll;
 	/** True if a part can store NULLs. */
 	bool is_nullable;
+	/**
+	 * JSON path to the indexed value inside the field, see
+	 * json_path.h, or NULL if the whole field is indexed.
+	 * Points to the path pool of the key_def the part belongs
+	 * to and is zero-terminated.
+	 */
+	const char *path;
+	/** Length of @a path. */
+	uint32_t path_len;
+	/**
+	 * Length of the prefix of @a path ending with "[*]" or 0
+	 * if the part is not multikey.
+	 */
+	uint32_t multikey_len;
+	/**
+	 * Offset slot of @a path in the field map of tuples of
+	 * the format with epoch @a format_epoch, a cache for
+	 * tuple_field_by_part_raw().
+	 */
+	int32_t offset_slot_cache;
+	/** Epoch of the format @a offset_slot_cache is valid for. */
+	uint64_t format_epoch;
 };
 
 struct key_def;
@@ -85,6 +107,23 @@ typedef uint32_t (*tuple_hash_t)(const struct tuple *tuple,
 typedef uint32_t (*key_hash_t)(const char *key,
 				const struct key_def *key_def);
 
+/**
+ * Hash function used to hash tuples and keys.
+ * @sa tuple_hash_by_version().
+ */
+enum tuple_hash_version {
+	/** PMurHash32 over MsgPack fields, tuple_hash(). */
+	TUPLE_HASH_MURMUR = 0,
+	/**
+	 * CRC32C over 64-bit lanes, hardware-accelerated if the
+	 * CPU supports SSE 4.2, tuple_hash_crc32c().
+	 */
+	TUPLE_HASH_CRC32C = 1,
+	tuple_hash_version_MAX
+};
+
+extern const char *tuple_hash_version_strs[];
+
 /* Definition of a multipart key. */
 struct key_def {
 	/** @see tuple_compare() */
@@ -99,6 +138,10 @@ struct key_def {
 	tuple_hash_t tuple_hash;
 	/** @see key_hash() */
 	key_hash_t key_hash;
+	/** @see tuple_hash_crc32c() */
+	tuple_hash_t tuple_hash_crc32c;
+	/** @see key_hash_crc32c() */
+	key_hash_t key_hash_crc32c;
 	/**
 	 * Minimal part count which always is unique. For example,
 	 * if a secondary index is unique, then
@@ -109,6 +152,16 @@ struct key_def {
 	uint32_t unique_part_count;
 	/** True, if at least one part can store NULL. */
 	bool is_nullable;
+	/** True, if at least one part has a JSON path. */
+	bool has_json_paths;
+	/**
+	 * True, if at least one part has a path with "[*]", so
+	 * that a tuple has as many keys as there are items in
+	 * the array the path refers to.
+	 */
+	bool is_multikey;
+	/** Size of the pool of part paths following the parts. */
+	uint32_t path_pool_size;
 	/** Key fields mask. @sa column_mask.h for details. */
 	uint64_t column_mask;
 	/** The size of the 'parts' array. */
@@ -154,9 +207,10 @@ box_key_def_delete(box_key_def_t *key_def);
 /** \endcond public */
 
 static inline size_t
-key_def_sizeof(uint32_t part_count)
+key_def_sizeof(uint32_t part_count, uint32_t path_pool_size)
 {
-	return sizeof(struct key_def) + sizeof(struct key_part) * part_count;
+	return sizeof(struct key_def) + sizeof(struct key_part) * part_count +
+	       path_pool_size;
 }
 
 /**
@@ -166,12 +220,23 @@ struct key_def *
 key_def_new(uint32_t part_count);
 
 /**
- * Set a single key part in a key def.
+ * Allocate a new key_def with the given part count and room
+ * for part paths of total size @a path_pool_size, including
+ * terminating zeros.
+ */
+struct key_def *
+key_def_new_with_paths(uint32_t part_count, uint32_t path_pool_size);
+
+/**
+ * Set a single key part in a key def. Parts with paths must be
+ * set in order, since a path is copied to the path pool right
+ * after the paths of preceding parts.
  * @pre part_no < part_count
  */
 void
 key_def_set_part(struct key_def *def, uint32_t part_no, uint32_t fieldno,
-		 enum field_type type, bool is_nullable, struct coll *coll);
+		 enum field_type type, bool is_nullable, struct coll *coll,
+		 const char *path, uint32_t path_len);
 
 /**
  * An snprint-style function to print a key definition.
@@ -207,11 +272,19 @@ key_def_decode_parts(struct key_def *key_def, const char **data,
 		     const struct field_def *fields, uint32_t field_count);
 
 /**
- * Returns the part in index_def->parts for the specified fieldno.
- * If fieldno is not in index_def->parts returns NULL.
+ * Return the size of the path pool necessary to decode parts
+ * array with key_def_decode_parts().
+ */
+uint32_t
+key_def_decode_path_pool_size(const char *data, uint32_t part_count);
+
+/**
+ * Returns the part in index_def->parts for the specified fieldno
+ * and path. If there is no such part returns NULL.
  */
 const struct key_part *
-key_def_find(const struct key_def *key_def, uint32_t fieldno);
+key_def_find(const struct key_def *key_def, uint32_t fieldno,
+	     const char *path, uint32_t path_len);
 
 /**
  * Allocate a new key_def with a set union of key parts from
@@ -249,6 +322,8 @@ key_validate_parts(const struct key_def *key_def, const char *key,
 static inline bool
 key_def_is_sequential(const struct key_def *key_def)
 {
+	if (key_def->has_json_paths)
+		return false;
 	for (uint32_t part_id = 0; part_id < key_def->part_count; part_id++) {
 		if (key_def->parts[part_id].fieldno != part_id)
 			return false;
@@ -32,6 +32,7 @@
 #include "box/call.h"
 #include "box/error.h"
 #include "fiber.h"
+#include "assoc.h"
 
 #include "lua/utils.h"
 #include "lua/msgpack.h"
@@ -44,71 +45,328 @@
 #include "small/obuf.h"
 #include "lua_sql.h"
 
+enum {
+	/** Max number of idle Lua coroutines kept for CALL/EVAL. */
+	LUA_CALL_CORO_POOL_MAX = 64,
+	/** Max number of function names kept in the path cache. */
+	LUA_CALL_PATH_CACHE_MAX = 4096,
+};
+
+/** A Lua coroutine used to execute CALL or EVAL. */
+struct lua_call_coro {
+	struct lua_State *L;
+	/** Registry reference protecting the coroutine from GC. */
+	int ref;
+};
+
 /**
- * A helper to find a Lua function by name and put it
- * on top of the stack.
+ * A pool of Lua coroutines reused by CALL and EVAL.
+ *
+ * Creating a new coroutine with lua_newthread() and anchoring
+ * it in the registry for every request is expensive and
+ * produces a lot of garbage at high request rates. Instead,
+ * a coroutine is returned to the pool once the request it was
+ * serving completes. The pool is only accessed from the tx
+ * thread, so it needs no locking.
  */
-static int
-box_lua_find(lua_State *L, const char *name, const char *name_end)
+static struct {
+	/** Idle coroutines. */
+	struct lua_call_coro coro[LUA_CALL_CORO_POOL_MAX];
+	/** Number of idle coroutines in the pool. */
+	int size;
+} lua_call_coro_pool;
+
+/**
+ * Take a coroutine from the pool or create a new one if
+ * the pool is empty.
+ */
+static struct lua_call_coro
+lua_call_coro_get(void)
 {
-	int index = LUA_GLOBALSINDEX;
-	int objstack = 0;
-	const char *start = name, *end;
+	if (lua_call_coro_pool.size > 0)
+		return lua_call_coro_pool.coro[--lua_call_coro_pool.size];
+	struct lua_call_coro coro;
+	coro.L = lua_newthread(tarantool_L);
+	coro.ref = luaL_ref(tarantool_L, LUA_REGISTRYINDEX);
+	return coro;
+}
+
+/**
+ * Return a coroutine to the pool. A coroutine that failed
+ * is dropped, since its state is not worth trusting.
+ *
+ * The request may have changed the state of the coroutine
+ * with debug.sethook() or setfenv(0, ...), so the hook and
+ * the globals table are reset to what a new coroutine gets
+ * before the coroutine serves another request.
+ */
+static void
+lua_call_coro_put(struct lua_call_coro coro, bool is_ok)
+{
+	if (is_ok && lua_status(coro.L) == 0 &&
+	    lua_call_coro_pool.size < LUA_CALL_CORO_POOL_MAX) {
+		lua_settop(coro.L, 0);
+		lua_sethook(coro.L, NULL, 0, 0);
+		lua_pushvalue(tarantool_L, LUA_GLOBALSINDEX);
+		lua_xmove(tarantool_L, coro.L, 1);
+		lua_replace(coro.L, LUA_GLOBALSINDEX);
+		lua_call_coro_pool.coro[lua_call_coro_pool.size++] = coro;
+		return;
+	}
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, coro.ref);
+}
 
+/**
+ * A resolved function name: "a.b.c" or "a.b:c".
+ *
+ * Each entry keeps a Lua table anchored in the registry, which
+ * holds the interned pieces of the name and the values they
+ * resolved to: t[2 * i - 1] is the i-th piece and t[2 * i] is
+ * the value it resolved to, so the last value is the function
+ * itself.
+ *
+ * Lua code may rebind any of the tables on the path or the
+ * function at any time, and CALL must always see the current
+ * binding. So a cached entry is used only after each of its
+ * pieces is checked to still resolve to the same value, which
+ * is a few lookups of interned keys and no parsing or type
+ * checks. An entry which fails the check is resolved anew.
+ */
+struct lua_call_path {
+	/** Registry reference to the table with pieces and values. */
+	int ref;
+	/** Number of pieces in the name. */
+	uint32_t count;
+	/**
+	 * 1-based number of the piece which is the object of a
+	 * method call (box.something:method), or 0 if the name
+	 * is not a method call.
+	 */
+	uint32_t method;
+	/** Length of the name. */
+	uint32_t name_len;
+	/** Function name, not zero-terminated. */
+	char name[0];
+};
+
+/**
+ * Function name -> struct lua_call_path.
+ *
+ * The cache is flushed whenever a function is created, altered
+ * or dropped in _func, or reloaded with box.schema.func.reload(),
+ * see func_cache_version. When the cache is full, one entry is
+ * evicted to make room for a new one.
+ */
+static struct mh_strnptr_t *lua_call_path_cache;
+
+/** func_cache_version the path cache is valid for. */
+static uint32_t lua_call_path_cache_version;
+
+/** Drop an entry from the function path cache. */
+static void
+lua_call_path_cache_delete(mh_int_t i)
+{
+	struct lua_call_path *path = (struct lua_call_path *)
+		mh_strnptr_node(lua_call_path_cache, i)->val;
+	mh_strnptr_del(lua_call_path_cache, i, NULL);
+	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, path->ref);
+	free(path);
+}
+
+/**
+ * Look up a function name in the path cache. Flushes the cache
+ * if the set of stored functions has changed since it was
+ * filled.
+ */
+static struct lua_call_path *
+lua_call_path_cache_find(const char *name, const char *name_end)
+{
+	if (lua_call_path_cache_version != func_cache_version) {
+		while (mh_size(lua_call_path_cache) > 0)
+			lua_call_path_cache_delete(
+				mh_first(lua_call_path_cache));
+		lua_call_path_cache_version = func_cache_version;
+		return NULL;
+	}
+	mh_int_t i = mh_strnptr_find_inp(lua_call_path_cache, name,
+					 name_end - name);
+	if (i == mh_end(lua_call_path_cache))
+		return NULL;
+	return (struct lua_call_path *)
+		mh_strnptr_node(lua_call_path_cache, i)->val;
+}
+
+/**
+ * Split a function name into pieces and push a table with
+ * the pieces on top of the stack. Fills in @a count and
+ * @a method.
+ */
+static void
+lua_call_path_parse(lua_State *L, const char *name, const char *name_end,
+		    uint32_t *count, uint32_t *method)
+{
+	const char *start = name, *end;
+	*count = 0;
+	*method = 0;
+	lua_createtable(L, 4, 0);
 	while ((end = (const char *) memchr(start, '.', name_end - start))) {
-		lua_checkstack(L, 3);
 		lua_pushlstring(L, start, end - start);
-		lua_gettable(L, index);
-		if (! lua_istable(L, -1)) {
-			diag_set(ClientError, ER_NO_SUCH_PROC,
-				 name_end - name, name);
-			luaT_error(L);
-		}
+		lua_rawseti(L, -2, ++*count);
 		start = end + 1; /* next piece of a.b.c */
-		index = lua_gettop(L); /* top of the stack */
 	}
-
 	/* box.something:method */
 	if ((end = (const char *) memchr(start, ':', name_end - start))) {
-		lua_checkstack(L, 3);
 		lua_pushlstring(L, start, end - start);
-		lua_gettable(L, index);
-		if (! (lua_istable(L, -1) ||
-			lua_islightuserdata(L, -1) || lua_isuserdata(L, -1) )) {
-				diag_set(ClientError, ER_NO_SUCH_PROC,
-					  name_end - name, name);
-				luaT_error(L);
+		lua_rawseti(L, -2, ++*count);
+		*method = *count;
+		start = end + 1;
+	}
+	lua_pushlstring(L, start, name_end - start);
+	lua_rawseti(L, -2, ++*count);
+}
+
+/**
+ * Save a resolved name to the path cache. @a pieces is the
+ * stack index of the table with name pieces and the values
+ * they resolved to are at pieces + 1 .. pieces + count.
+ * Failure to cache a name is not an error: the name will be
+ * resolved again next time.
+ */
+static void
+lua_call_path_cache_put(lua_State *L, const char *name, const char *name_end,
+			int pieces, uint32_t count, uint32_t method)
+{
+	if (mh_size(lua_call_path_cache) >= LUA_CALL_PATH_CACHE_MAX)
+		lua_call_path_cache_delete(mh_first(lua_call_path_cache));
+	uint32_t name_len = name_end - name;
+	struct lua_call_path *path = (struct lua_call_path *)
+		malloc(sizeof(*path) + name_len);
+	if (path == NULL)
+		return;
+	memcpy(path->name, name, name_len);
+	path->name_len = name_len;
+	path->count = count;
+	path->method = method;
+	const struct mh_strnptr_node_t node = {
+		path->name, name_len, mh_strn_hash(name, name_len), path };
+	if (mh_strnptr_put(lua_call_path_cache, &node,
+			   NULL, NULL) == mh_end(lua_call_path_cache)) {
+		free(path);
+		return;
+	}
+	lua_createtable(L, 2 * count, 0);
+	for (uint32_t i = 1; i <= count; i++) {
+		lua_rawgeti(L, pieces, i);
+		lua_rawseti(L, -2, 2 * i - 1);
+		lua_pushvalue(L, pieces + i);
+		lua_rawseti(L, -2, 2 * i);
+	}
+	path->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+/**
+ * Push the function of a cached name, followed by the object
+ * in case of a method call, if every piece of the name still
+ * resolves to the cached value. Returns the number of pushed
+ * values or 0 if the entry is stale, in which case nothing is
+ * pushed.
+ */
+static int
+lua_call_path_push(lua_State *L, struct lua_call_path *path)
+{
+	int top = lua_gettop(L);
+	lua_checkstack(L, 5);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, path->ref);
+	int entry = top + 1;
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+	for (uint32_t i = 1; i <= path->count; i++) {
+		lua_rawgeti(L, entry, 2 * i - 1);
+		lua_gettable(L, -2);
+		lua_rawgeti(L, entry, 2 * i);
+		if (! lua_rawequal(L, -1, -2)) {
+			lua_settop(L, top);
+			return 0;
 		}
-		start = end + 1; /* next piece of a.b.c */
-		index = lua_gettop(L); /* top of the stack */
-		objstack = index;
+		lua_pop(L, 1);
+		lua_remove(L, -2); /* the value is the next container */
 	}
+	if (path->method != 0)
+		lua_rawgeti(L, entry, 2 * path->method);
+	lua_remove(L, entry);
+	return 1 + (path->method != 0);
+}
 
+/** Raise ER_NO_SUCH_PROC for a name which doesn't resolve. */
+static int
+box_lua_find_error(lua_State *L, const char *name, const char *name_end)
+{
+	diag_set(ClientError, ER_NO_SUCH_PROC, name_end - name, name);
+	return luaT_error(L);
+}
 
-	lua_pushlstring(L, start, name_end - start);
+/**
+ * A helper to find a Lua function by name and put it
+ * on top of the stack.
+ *
+ * Pushes the function, followed by the object in case of
+ * a method call, and returns the number of pushed values.
+ */
+static int
+box_lua_find(lua_State *L, const char *name, const char *name_end)
+{
+	int base = lua_gettop(L);
+	struct lua_call_path *path = lua_call_path_cache_find(name, name_end);
+	if (path != NULL) {
+		int rc = lua_call_path_push(L, path);
+		if (rc != 0)
+			return rc;
+		/* Some piece was rebound, resolve the name anew. */
+		lua_call_path_cache_delete(
+			mh_strnptr_find_inp(lua_call_path_cache, name,
+					    name_end - name));
+	}
+	uint32_t count, method;
+	lua_call_path_parse(L, name, name_end, &count, &method);
+	int pieces = base + 1;
+	int index = LUA_GLOBALSINDEX;
+	int objstack = 0;
+
+	lua_checkstack(L, count + 3);
+	for (uint32_t i = 1; i < count; i++) {
+		lua_rawgeti(L, pieces, i);
+		lua_gettable(L, index);
+		if (i == method) {
+			if (! (lua_istable(L, -1) ||
+			       lua_islightuserdata(L, -1) ||
+			       lua_isuserdata(L, -1))) {
+				box_lua_find_error(L, name, name_end);
+			}
+			objstack = lua_gettop(L);
+		} else if (! lua_istable(L, -1)) {
+			box_lua_find_error(L, name, name_end);
+		}
+		index = lua_gettop(L); /* top of the stack */
+	}
+	lua_rawgeti(L, pieces, count);
 	lua_gettable(L, index);
 	if (!lua_isfunction(L, -1) && !lua_istable(L, -1)) {
 		/* lua_call or lua_gettable would raise a type error
 		 * for us, but our own message is more verbose. */
-		diag_set(ClientError, ER_NO_SUCH_PROC,
-			  name_end - name, name);
-		luaT_error(L);
+		box_lua_find_error(L, name, name_end);
 	}
-	/* setting stack that it would contain only
-	 * the function pointer. */
-	if (index != LUA_GLOBALSINDEX) {
-		if (objstack == 0) {        /* no object, only a function */
-			lua_replace(L, 1);
-		} else if (objstack == 1) { /* just two values, swap them */
-			lua_insert(L, -2);
-		} else {		    /* long path */
-			lua_insert(L, 1);
-			lua_insert(L, 2);
-			objstack = 1;
-		}
-		lua_settop(L, 1 + objstack);
+	/* Only cache names which resolved successfully. */
+	lua_call_path_cache_put(L, name, name_end, pieces, count, method);
+	/*
+	 * Setting stack that it would contain only
+	 * the function pointer and the object.
+	 */
+	if (objstack != 0) {
+		lua_pushvalue(L, objstack);
+		lua_replace(L, base + 2);
 	}
-	return 1 + objstack;
+	lua_replace(L, base + 1);
+	lua_settop(L, base + 1 + (objstack != 0));
+	return 1 + (objstack != 0);
 }
 
 /**
@@ -127,6 +385,80 @@ lbox_call_loadproc(struct lua_State *L)
 	return box_lua_find(L, name, name + name_len);
 }
 
+/**
+ * Encode a Lua value at @a idx as a CALL result.
+ *
+ * Tuples and arrays of tuples, e.g. results of space:select(),
+ * are the most common return values, so their MessagePack is
+ * copied to the stream as is, without converting every tuple
+ * with luaL_tofield() first. The output is the same as the one
+ * of luamp_encode().
+ */
+static void
+luamp_encode_call_value(lua_State *L, struct luaL_serializer *cfg,
+			struct mpstream *stream, int idx)
+{
+	struct tuple *tuple = luaT_istuple(L, idx);
+	if (tuple != NULL) {
+		tuple_to_mpstream(tuple, stream);
+		return;
+	}
+	if (lua_type(L, idx) != LUA_TTABLE) {
+		luamp_encode(L, cfg, stream, idx);
+		return;
+	}
+	/* luaL_tofield() may replace the value with __serialize */
+	lua_pushvalue(L, idx);
+	int top = lua_gettop(L);
+	struct luaL_field field;
+	luaL_tofield(L, cfg, top, &field);
+	if (field.type != MP_ARRAY || cfg->encode_max_depth <= 0) {
+		luamp_encode_r(L, cfg, stream, &field, 0);
+		lua_pop(L, 1);
+		return;
+	}
+	uint32_t size = field.size;
+	luamp_encode_array(cfg, stream, size);
+	for (uint32_t i = 1; i <= size; i++) {
+		lua_rawgeti(L, top, i);
+		if ((tuple = luaT_istuple(L, top + 1)) != NULL) {
+			tuple_to_mpstream(tuple, stream);
+		} else {
+			luaL_tofield(L, cfg, top + 1, &field);
+			luamp_encode_r(L, cfg, stream, &field, 1);
+		}
+		lua_pop(L, 1);
+	}
+	assert(lua_gettop(L) == top);
+	lua_pop(L, 1);
+}
+
+/**
+ * Encode a value at @a idx as a tuple of a CALL_16 result:
+ * tuples and arrays are encoded as is, everything else is
+ * wrapped into an array: `scalar` => `{ scalar }`.
+ */
+static void
+luamp_encode_call_16_value(lua_State *L, struct luaL_serializer *cfg,
+			   struct mpstream *stream, int idx)
+{
+	struct tuple *tuple = luaT_istuple(L, idx);
+	if (tuple != NULL) {
+		tuple_to_mpstream(tuple, stream);
+		return;
+	}
+	struct luaL_field field;
+	luaL_tofield(L, cfg, idx, &field);
+	if (field.type != MP_ARRAY) {
+		lua_pushvalue(L, idx);
+		luamp_encode_array(cfg, stream, 1);
+		luamp_encode_r(L, cfg, stream, &field, 0);
+		lua_pop(L, 1);
+	} else {
+		luamp_encode(L, cfg, stream, idx);
+	}
+}
+
 /*
  * Encode CALL result.
  * Please read gh-291 carefully before "fixing" this code.
@@ -144,26 +476,13 @@ luamp_encode_call(lua_State *L, struct luaL_serializer *cfg,
 		 * `return 1, box.tuple.new(...), array, 3, ...`
 		 */
 		for (int i = 1; i <= nrets; ++i) {
-			struct luaL_field field;
-			luaL_tofield(L, cfg, i, &field);
-			struct tuple *tuple;
-			if (field.type == MP_EXT &&
-			    (tuple = luaT_istuple(L, i)) != NULL) {
-				/* `return ..., box.tuple.new(...), ...` */
-				tuple_to_mpstream(tuple, stream);
-			} else if (field.type != MP_ARRAY) {
-				/*
-				 * `return ..., scalar, ... =>
-				 *         ..., { scalar }, ...`
-				 */
-				lua_pushvalue(L, i);
-				luamp_encode_array(cfg, stream, 1);
-				luamp_encode_r(L, cfg, stream, &field, 0);
-				lua_pop(L, 1);
-			} else {
-				/* `return ..., array, ...` */
-				luamp_encode(L, cfg, stream, i);
-			}
+			/*
+			 * `return ..., box.tuple.new(...), ...`
+			 * `return ..., array, ...`
+			 * `return ..., scalar, ... =>
+			 *         ..., { scalar }, ...`
+			 */
+			luamp_encode_call_16_value(L, cfg, stream, i);
 		}
 		return nrets;
 	}
@@ -172,14 +491,15 @@ luamp_encode_call(lua_State *L, struct luaL_serializer *cfg,
 	/*
 	 * Inspect the first result
 	 */
-	struct luaL_field root;
-	luaL_tofield(L, cfg, 1, &root);
-	struct tuple *tuple;
-	if (root.type == MP_EXT && (tuple = luaT_istuple(L, 1)) != NULL) {
+	struct tuple *tuple = luaT_istuple(L, 1);
+	if (tuple != NULL) {
 		/* `return box.tuple()` */
 		tuple_to_mpstream(tuple, stream);
 		return 1;
-	} else if (root.type != MP_ARRAY) {
+	}
+	struct luaL_field root;
+	luaL_tofield(L, cfg, 1, &root);
+	if (root.type != MP_ARRAY) {
 		/*
 		 * `return scalar`
 		 * `return map`
@@ -201,11 +521,15 @@ luamp_encode_call(lua_State *L, struct luaL_serializer *cfg,
 	assert(root.type == MP_ARRAY && root.size > 0);
 	for (uint32_t t = 1; t <= root.size; t++) {
 		lua_rawgeti(L, 1, t);
+		if ((tuple = luaT_istuple(L, -1)) != NULL) {
+			/* Fast path for `return space:select(...)` */
+			tuple_to_mpstream(tuple, stream);
+			lua_pop(L, 1);
+			continue;
+		}
 		struct luaL_field field;
 		luaL_tofield(L, cfg, -1, &field);
-		if (field.type == MP_EXT && (tuple = luaT_istuple(L, -1))) {
-			tuple_to_mpstream(tuple, stream);
-		} else if (field.type != MP_ARRAY) {
+		if (field.type != MP_ARRAY) {
 			/* The first member of root table is not tuple/array */
 			if (t == 1) {
 				/*
@@ -250,8 +574,41 @@ struct lua_function_ctx {
 	struct obuf_svp svp;
 	/* true if `out' was changed and `svp' can be used for rollback  */
 	bool out_is_dirty;
+	/**
+	 * Results added with box.call_append() while the
+	 * function is running, already encoded to MessagePack.
+	 * They can't be written to `out' directly, because the
+	 * function may yield and let another request from the
+	 * same connection write to `out'. Created on demand.
+	 */
+	struct obuf rows;
+	/** Number of results in `rows'. */
+	uint32_t row_count;
+	/** True if `rows' has been created. */
+	bool has_rows;
 };
 
+/**
+ * Copy results added with box.call_append() to the output
+ * stream. Returns the number of copied results.
+ */
+static uint32_t
+lua_function_ctx_dump_rows(struct lua_function_ctx *ctx,
+			   struct mpstream *stream)
+{
+	if (!ctx->has_rows)
+		return 0;
+	struct obuf *rows = &ctx->rows;
+	int iovcnt = obuf_iovcnt(rows);
+	for (int i = 0; i < iovcnt; i++) {
+		size_t len = rows->iov[i].iov_len;
+		char *ptr = mpstream_reserve(stream, len);
+		memcpy(ptr, rows->iov[i].iov_base, len);
+		mpstream_advance(stream, len);
+	}
+	return ctx->row_count;
+}
+
 /**
  * Invoke a Lua stored procedure from the binary protocol
  * (implementation of 'CALL' command code).
@@ -311,16 +668,17 @@ execute_lua_call(lua_State *L)
 	mpstream_init(&stream, out, obuf_reserve_cb, obuf_alloc_cb,
 		      luamp_error, L);
 
-	int count;
+	int count = lua_function_ctx_dump_rows(ctx, &stream);
 	if (request->header->type == IPROTO_CALL_16) {
 		/* Tarantool < 1.7.1 compatibility */
-		count = luamp_encode_call(L, cfg, &stream);
+		count += luamp_encode_call(L, cfg, &stream);
 	} else {
 		assert(request->header->type == IPROTO_CALL);
-		count = lua_gettop(L);
-		for (int k = 1; k <= count; ++k) {
-			luamp_encode(L, cfg, &stream, k);
+		int nrets = lua_gettop(L);
+		for (int k = 1; k <= nrets; ++k) {
+			luamp_encode_call_value(L, cfg, &stream, k);
 		}
+		count += nrets;
 	}
 
 	mpstream_flush(&stream);
@@ -365,13 +723,15 @@ execute_lua_eval(lua_State *L)
 	struct mpstream stream;
 	mpstream_init(&stream, out, obuf_reserve_cb, obuf_alloc_cb,
 		      luamp_error, L);
+	uint32_t count = lua_function_ctx_dump_rows(ctx, &stream);
 	int nrets = lua_gettop(L);
 	for (int k = 1; k <= nrets; ++k) {
-		luamp_encode(L, luaL_msgpack_default, &stream, k);
+		luamp_encode_call_value(L, luaL_msgpack_default, &stream, k);
 	}
+	count += nrets;
 	mpstream_flush(&stream);
 	iproto_reply_select(out, svp, request->header->sync, schema_version,
-			    nrets);
+			    count);
 
 	return 0;
 }
@@ -379,12 +739,20 @@ execute_lua_eval(lua_State *L)
 static inline int
 box_process_lua(struct call_request *request, struct obuf *out, lua_CFunction handler)
 {
-	struct lua_function_ctx ctx = { request, out, {0, 0, 0}, false };
-
-	lua_State *L = lua_newthread(tarantool_L);
-	int coro_ref = luaL_ref(tarantool_L, LUA_REGISTRYINDEX);
-	int rc = luaT_cpcall(L, handler, &ctx);
-	luaL_unref(tarantool_L, LUA_REGISTRYINDEX, coro_ref);
+	struct lua_function_ctx ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.request = request;
+	ctx.out = out;
+
+	struct fiber *f = fiber();
+	void *prev_ctx = fiber_get_key(f, FIBER_KEY_LUA_CALL);
+	fiber_set_key(f, FIBER_KEY_LUA_CALL, &ctx);
+	struct lua_call_coro coro = lua_call_coro_get();
+	int rc = luaT_cpcall(coro.L, handler, &ctx);
+	lua_call_coro_put(coro, rc == 0);
+	fiber_set_key(f, FIBER_KEY_LUA_CALL, prev_ctx);
+	if (ctx.has_rows)
+		obuf_destroy(&ctx.rows);
 	if (rc != 0) {
 		if (ctx.out_is_dirty) {
 			/*
@@ -424,6 +792,77 @@ lbox_func_reload(lua_State *L)
 	return 0;
 }
 
+/**
+ * Encode the values at 2..top to the rows of the context at 1.
+ * Raises a Lua error if a value can't be encoded.
+ */
+static int
+lbox_call_append_encode(struct lua_State *L)
+{
+	struct lua_function_ctx *ctx = (struct lua_function_ctx *)
+		lua_touserdata(L, 1);
+	struct luaL_serializer *cfg = luaL_msgpack_default;
+	struct mpstream stream;
+	mpstream_init(&stream, &ctx->rows, obuf_reserve_cb, obuf_alloc_cb,
+		      luamp_error, L);
+	int top = lua_gettop(L);
+	bool is_call_16 = ctx->request->header->type == IPROTO_CALL_16;
+	for (int k = 2; k <= top; ++k) {
+		if (is_call_16)
+			luamp_encode_call_16_value(L, cfg, &stream, k);
+		else
+			luamp_encode_call_value(L, cfg, &stream, k);
+	}
+	mpstream_flush(&stream);
+	return 0;
+}
+
+/**
+ * box.call_append(value, ...): add values to the result of the
+ * CALL or EVAL being executed by the current fiber. The values
+ * are encoded to MessagePack at once, so that a function can
+ * stream a large result set without keeping it in a Lua table.
+ * Added values precede the values returned by the function.
+ *
+ * If any of the values can't be encoded, none of them is added
+ * and an error is raised.
+ */
+static int
+lbox_call_append(struct lua_State *L)
+{
+	struct lua_function_ctx *ctx = (struct lua_function_ctx *)
+		fiber_get_key(fiber(), FIBER_KEY_LUA_CALL);
+	if (ctx == NULL)
+		return luaL_error(L, "box.call_append() is only allowed "
+				  "in CALL or EVAL");
+	if (!ctx->has_rows) {
+		obuf_create(&ctx->rows, &cord()->slabc, 16 * 1024);
+		ctx->has_rows = true;
+	}
+	int count = lua_gettop(L);
+	/*
+	 * Encoding may fail half way through a value, roll back
+	 * whatever has been written then, so that the rows stay
+	 * in line with the row count.
+	 */
+	struct obuf_svp svp = obuf_create_svp(&ctx->rows);
+	lua_pushcfunction(L, lbox_call_append_encode);
+	lua_insert(L, 1);
+	lua_pushlightuserdata(L, ctx);
+	lua_insert(L, 2);
+	if (lua_pcall(L, count + 1, 0, 0) != 0) {
+		obuf_rollback_to_svp(&ctx->rows, &svp);
+		return lua_error(L);
+	}
+	ctx->row_count += count;
+	return 0;
+}
+
+static const struct luaL_Reg boxlib[] = {
+	{"call_append", lbox_call_append},
+	{NULL, NULL}
+};
+
 static const struct luaL_Reg boxlib_internal[] = {
 	{"call_loadproc",  lbox_call_loadproc},
 	{"sql_create_function",  lbox_sql_create_function},
@@ -434,6 +873,12 @@ static const struct luaL_Reg boxlib_internal[] = {
 void
 box_lua_call_init(struct lua_State *L)
 {
+	lua_call_path_cache = mh_strnptr_new();
+	if (lua_call_path_cache == NULL)
+		panic("failed to allocate Lua function path cache");
+
+	luaL_register(L, "box", boxlib);
+	lua_pop(L, 1);
 	luaL_register(L, "box.internal", boxlib_internal);
 	lua_pop(L, 1);
 
@@ -121,6 +121,25 @@ lbox_cfg_set_readahead(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_iproto_compression(struct lua_State *L)
+{
+	(void) L;
+	box_set_iproto_compression();
+	return 0;
+}
+
+static int
+lbox_cfg_set_iproto_cursor_timeout(struct lua_State *L)
+{
+	try {
+		box_set_iproto_cursor_timeout();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_io_collect_interval(struct lua_State *L)
 {
@@ -187,6 +206,28 @@ lbox_cfg_set_memtx_max_tuple_size(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_memtx_defrag_threshold(struct lua_State *L)
+{
+	try {
+		box_set_memtx_defrag_threshold();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_defrag_min_free(struct lua_State *L)
+{
+	try {
+		box_set_memtx_defrag_min_free();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_vinyl_max_tuple_size(struct lua_State *L)
 {
@@ -241,12 +282,16 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_log_level", lbox_cfg_set_log_level},
 		{"cfg_set_log_format", lbox_cfg_set_log_format},
 		{"cfg_set_readahead", lbox_cfg_set_readahead},
+		{"cfg_set_iproto_compression", lbox_cfg_set_iproto_compression},
+		{"cfg_set_iproto_cursor_timeout", lbox_cfg_set_iproto_cursor_timeout},
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
 		{"cfg_set_checkpoint_count", lbox_cfg_set_checkpoint_count},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{"cfg_set_memtx_max_tuple_size", lbox_cfg_set_memtx_max_tuple_size},
+		{"cfg_set_memtx_defrag_threshold", lbox_cfg_set_memtx_defrag_threshold},
+		{"cfg_set_memtx_defrag_min_free", lbox_cfg_set_memtx_defrag_min_free},
 		{"cfg_set_vinyl_max_tuple_size", lbox_cfg_set_vinyl_max_tuple_size},
 		{"cfg_set_vinyl_timeout", lbox_cfg_set_vinyl_timeout},
 		{"cfg_set_replication_timeout", lbox_cfg_set_replication_timeout},
@@ -11,7 +11,12 @@ local default_cfg = {
     listen              = nil,
     memtx_memory        = 256 * 1024 *1024,
     memtx_min_tuple_size = 16,
+    memtx_huge_pages    = "none",
+    memtx_numa_policy   = "default",
+    memtx_numa_nodes    = nil, -- all nodes
     memtx_max_tuple_size = 1024 * 1024,
+    memtx_defrag_threshold = 0,
+    memtx_defrag_min_free = 16 * 1024 * 1024,
     slab_alloc_factor   = 1.05,
     work_dir            = nil,
     memtx_dir           = ".",
@@ -35,6 +40,9 @@ local default_cfg = {
     log_format          = "plain",
     io_collect_interval = nil,
     readahead           = 16320,
+    iproto_backend      = "evio",
+    iproto_compression  = false,
+    iproto_cursor_timeout = 60,
     snap_io_rate_limit  = nil, -- no limit
     too_long_threshold  = 0.5,
     wal_mode            = "write",
@@ -62,7 +70,12 @@ local template_cfg = {
     listen              = 'string, number',
     memtx_memory        = 'number',
     memtx_min_tuple_size  = 'number',
+    memtx_huge_pages    = 'string',
+    memtx_numa_policy   = 'string',
+    memtx_numa_nodes    = 'string, number',
     memtx_max_tuple_size  = 'number',
+    memtx_defrag_threshold = 'number',
+    memtx_defrag_min_free = 'number',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
@@ -86,6 +99,9 @@ local template_cfg = {
     log_format          = 'string',
     io_collect_interval = 'number',
     readahead           = 'number',
+    iproto_backend      = 'string',
+    iproto_compression  = 'boolean',
+    iproto_cursor_timeout = 'number',
     snap_io_rate_limit  = 'number',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
@@ -155,10 +171,14 @@ local dynamic_cfg = {
     log_format              = private.cfg_set_log_format,
     io_collect_interval     = private.cfg_set_io_collect_interval,
     readahead               = private.cfg_set_readahead,
+    iproto_compression      = private.cfg_set_iproto_compression,
+    iproto_cursor_timeout   = private.cfg_set_iproto_cursor_timeout,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
     read_only               = private.cfg_set_read_only,
     memtx_max_tuple_size    = private.cfg_set_memtx_max_tuple_size,
+    memtx_defrag_threshold  = private.cfg_set_memtx_defrag_threshold,
+    memtx_defrag_min_free   = private.cfg_set_memtx_defrag_min_free,
     vinyl_max_tuple_size    = private.cfg_set_vinyl_max_tuple_size,
     vinyl_timeout           = private.cfg_set_vinyl_timeout,
     checkpoint_count        = private.cfg_set_checkpoint_count,
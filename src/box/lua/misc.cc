@@ -57,7 +57,8 @@ lbox_encode_tuple_on_gc(lua_State *L, int idx, size_t *p_len)
 
 /* }}} */
 
-/** {{{ Lua/C implementation of index:select(): used only by Vinyl **/
+/** {{{ Lua/C implementation of index:select() and index:get_many():
+ * used only by Vinyl **/
 
 static inline void
 lbox_port_to_table(lua_State *L, struct port *port)
@@ -65,8 +66,11 @@ lbox_port_to_table(lua_State *L, struct port *port)
 	lua_createtable(L, port->size, 0);
 	struct port_entry *entry = port->first;
 	for (size_t i = 0 ; i < port->size; i++) {
-		luaT_pushtuple(L, entry->tuple);
-		lua_rawseti(L, -2, i + 1);
+		/* Keys not found by get_many() leave holes. */
+		if (entry->tuple != NULL) {
+			luaT_pushtuple(L, entry->tuple);
+			lua_rawseti(L, -2, i + 1);
+		}
 		entry = entry->next;
 	}
 }
@@ -74,7 +78,9 @@ lbox_port_to_table(lua_State *L, struct port *port)
 static int
 lbox_select(lua_State *L)
 {
-	if (lua_gettop(L) != 6 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	int argc = lua_gettop(L);
+	if ((argc != 6 && argc != 7) ||
+		!lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
 		!lua_isnumber(L, 3) || !lua_isnumber(L, 4) || !lua_isnumber(L, 5)) {
 		return luaL_error(L, "Usage index:select(iterator, offset, "
 				  "limit, key)");
@@ -85,14 +91,19 @@ lbox_select(lua_State *L)
 	int iterator = lua_tonumber(L, 3);
 	uint32_t offset = lua_tonumber(L, 4);
 	uint32_t limit = lua_tonumber(L, 5);
+	bool keys_only = argc == 7 && lua_toboolean(L, 7);
 
 	size_t key_len;
 	const char *key = lbox_encode_tuple_on_gc(L, 6, &key_len);
 
 	struct port port;
 	port_create(&port);
-	if (box_select((struct port *) &port, space_id, index_id, iterator,
-			offset, limit, key, key + key_len) != 0) {
+	int rc = keys_only ?
+		box_select_keys(&port, space_id, index_id, iterator,
+				offset, limit, key, key + key_len) :
+		box_select(&port, space_id, index_id, iterator,
+			   offset, limit, key, key + key_len);
+	if (rc != 0) {
 		port_destroy(&port);
 		return luaT_error(L);
 	}
@@ -111,6 +122,31 @@ lbox_select(lua_State *L)
 	return 1; /* lua table with tuples */
 }
 
+static int
+lbox_get_many(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2))
+		return luaL_error(L, "Usage index:get_many(keys)");
+
+	uint32_t space_id = lua_tonumber(L, 1);
+	uint32_t index_id = lua_tonumber(L, 2);
+
+	size_t keys_len;
+	const char *keys = lbox_encode_tuple_on_gc(L, 3, &keys_len);
+
+	struct port port;
+	port_create(&port);
+	if (box_get_many(&port, space_id, index_id,
+			 keys, keys + keys_len) != 0) {
+		port_destroy(&port);
+		return luaT_error(L);
+	}
+	/* See the comment in lbox_select(). */
+	lbox_port_to_table(L, &port);
+	port_destroy(&port);
+	return 1; /* lua table with tuples */
+}
+
 /* }}} */
 
 void
@@ -118,6 +154,7 @@ box_lua_misc_init(struct lua_State *L)
 {
 	static const struct luaL_Reg boxlib_internal[] = {
 		{"select", lbox_select},
+		{"get_many", lbox_get_many},
 		{NULL, NULL}
 	};
 
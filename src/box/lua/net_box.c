@@ -30,6 +30,7 @@
  */
 #include "net_box.h"
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include <small/ibuf.h>
 #include <msgpuck.h> /* mp_store_u32() */
@@ -37,17 +38,24 @@
 
 #include "box/iproto_constants.h"
 #include "box/lua/tuple.h" /* luamp_convert_tuple() / luamp_convert_key() */
+#include "box/tuple.h"
 #include "box/xrow.h"
 
 #include "lua/msgpack.h"
 #include "third_party/base64.h"
 
 #include "coio.h"
+#include "shm_channel.h"
+#include "box/iproto_zstd.h"
 #include "box/errcode.h"
+#include "box/error.h"
 #include "lua/fiber.h"
 
 #define cfg luaL_msgpack_default
 
+static const char *netbox_shm_typename = "net.box.shm";
+static const char *netbox_zstd_typename = "net.box.zstd";
+
 static inline size_t
 netbox_prepare_request(lua_State *L, struct mpstream *stream, uint32_t r_type)
 {
@@ -121,6 +129,19 @@ netbox_encode_ping(lua_State *L)
 	return 0;
 }
 
+static int
+netbox_encode_compress(lua_State *L)
+{
+	if (lua_gettop(L) < 3)
+		return luaL_error(L, "Usage: netbox.encode_compress(ibuf, "
+				"sync, schema_version)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_COMPRESS);
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
 static int
 netbox_encode_auth(lua_State *L)
 {
@@ -268,6 +289,128 @@ netbox_encode_select(lua_State *L)
 	return 0;
 }
 
+static int
+netbox_encode_get_many(lua_State *L)
+{
+	if (lua_gettop(L) < 6)
+		return luaL_error(L, "Usage netbox.encode_get_many(ibuf, sync, "
+				  "schema_version, space_id, index_id, keys)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_GET_MANY);
+
+	luamp_encode_map(cfg, &stream, 3);
+
+	uint32_t space_id = lua_tonumber(L, 4);
+	uint32_t index_id = lua_tonumber(L, 5);
+
+	/* encode space_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_SPACE_ID);
+	luamp_encode_uint(cfg, &stream, space_id);
+
+	/* encode index_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_INDEX_ID);
+	luamp_encode_uint(cfg, &stream, index_id);
+
+	/* encode keys */
+	luamp_encode_uint(cfg, &stream, IPROTO_KEY);
+	luamp_encode_tuple(L, cfg, &stream, 6);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_cursor_open(lua_State *L)
+{
+	if (lua_gettop(L) < 8)
+		return luaL_error(L, "Usage netbox.encode_cursor_open(ibuf, "
+				  "sync, schema_version, space_id, index_id, "
+				  "iterator, limit, key)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_CURSOR_OPEN);
+
+	luamp_encode_map(cfg, &stream, 5);
+
+	uint32_t space_id = lua_tonumber(L, 4);
+	uint32_t index_id = lua_tonumber(L, 5);
+	int iterator = lua_tointeger(L, 6);
+	uint32_t limit = lua_tonumber(L, 7);
+
+	/* encode space_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_SPACE_ID);
+	luamp_encode_uint(cfg, &stream, space_id);
+
+	/* encode index_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_INDEX_ID);
+	luamp_encode_uint(cfg, &stream, index_id);
+
+	/* encode iterator */
+	luamp_encode_uint(cfg, &stream, IPROTO_ITERATOR);
+	luamp_encode_uint(cfg, &stream, iterator);
+
+	/* encode limit */
+	luamp_encode_uint(cfg, &stream, IPROTO_LIMIT);
+	luamp_encode_uint(cfg, &stream, limit);
+
+	/* encode key */
+	luamp_encode_uint(cfg, &stream, IPROTO_KEY);
+	luamp_convert_key(L, cfg, &stream, 8);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_cursor_fetch(lua_State *L)
+{
+	if (lua_gettop(L) < 5)
+		return luaL_error(L, "Usage netbox.encode_cursor_fetch(ibuf, "
+				  "sync, schema_version, cursor_id, limit)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_CURSOR_FETCH);
+
+	luamp_encode_map(cfg, &stream, 2);
+
+	uint64_t cursor_id = luaL_touint64(L, 4);
+	uint32_t limit = lua_tonumber(L, 5);
+
+	/* encode cursor_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_CURSOR_ID);
+	luamp_encode_uint(cfg, &stream, cursor_id);
+
+	/* encode limit */
+	luamp_encode_uint(cfg, &stream, IPROTO_LIMIT);
+	luamp_encode_uint(cfg, &stream, limit);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
+static int
+netbox_encode_cursor_close(lua_State *L)
+{
+	if (lua_gettop(L) < 4)
+		return luaL_error(L, "Usage netbox.encode_cursor_close(ibuf, "
+				  "sync, schema_version, cursor_id)");
+
+	struct mpstream stream;
+	size_t svp = netbox_prepare_request(L, &stream, IPROTO_CURSOR_CLOSE);
+
+	luamp_encode_map(cfg, &stream, 1);
+
+	uint64_t cursor_id = luaL_touint64(L, 4);
+
+	/* encode cursor_id */
+	luamp_encode_uint(cfg, &stream, IPROTO_CURSOR_ID);
+	luamp_encode_uint(cfg, &stream, cursor_id);
+
+	netbox_encode_request(&stream, svp);
+	return 0;
+}
+
 static inline int
 netbox_encode_insert_or_replace(lua_State *L, uint32_t reqtype)
 {
@@ -446,7 +589,283 @@ netbox_decode_greeting(lua_State *L)
 }
 
 /**
- * communicate(fd, send_buf, recv_buf, limit_or_boundary, timeout)
+ * decode_header(rpos, size)
+ *  -> required
+ *  -> required, body_rpos, status, sync, schema_version
+ *
+ * Decode the header of the packet at @a rpos, given @a size
+ * bytes are read. If the packet is not fully read, return only
+ * the number of bytes it is required to proceed, otherwise it
+ * is the size of the whole packet.
+ */
+static int
+netbox_decode_header(struct lua_State *L)
+{
+	uint32_t ctypeid;
+	const char *rpos = *(const char **) luaL_checkcdata(L, 1, &ctypeid);
+	size_t size = lua_tointeger(L, 2);
+	size_t fixheader_size = mp_sizeof_uint(UINT32_MAX);
+	if (size < fixheader_size) {
+		lua_pushinteger(L, fixheader_size);
+		return 1;
+	}
+	const char *pos = rpos;
+	if (mp_typeof(*pos) != MP_UINT) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "packet length");
+		return luaT_error(L);
+	}
+	ptrdiff_t missing = mp_check_uint(pos, rpos + size);
+	if (missing > 0) {
+		lua_pushinteger(L, size + missing);
+		return 1;
+	}
+	uint64_t len = mp_decode_uint(&pos);
+	size_t required = pos - rpos + len;
+	lua_pushinteger(L, required);
+	if (size < required)
+		return 1;
+	struct xrow_header header;
+	if (xrow_header_decode(&header, &pos, rpos + required) != 0)
+		return luaT_error(L);
+	const char *body = header.bodycnt != 0 ?
+			   (const char *) header.body[0].iov_base : pos;
+	*(const char **) luaL_pushcdata(L, ctypeid) = body;
+	lua_pushinteger(L, header.type);
+	luaL_pushuint64(L, header.sync);
+	lua_pushinteger(L, header.schema_version);
+	return 5;
+}
+
+/**
+ * Decode an array of tuples to a table of box tuples, without
+ * making a Lua table of each tuple first. Nils are skipped.
+ */
+static void
+netbox_decode_tuples(struct lua_State *L, const char **data)
+{
+	uint32_t count = mp_decode_array(data);
+	lua_createtable(L, count, 0);
+	box_tuple_format_t *format = box_tuple_format_default();
+	for (uint32_t i = 0; i < count; i++) {
+		switch (mp_typeof(**data)) {
+		case MP_ARRAY: {
+			const char *tuple = *data;
+			mp_next(data);
+			box_tuple_t *t = box_tuple_new(format, tuple, *data);
+			if (t == NULL)
+				luaT_error(L);
+			luaT_pushtuple(L, t);
+			break;
+		}
+		case MP_NIL:
+			/* get_many() returns nil for keys not found. */
+			mp_next(data);
+			continue;
+		default:
+			luamp_decode(L, cfg, data);
+			break;
+		}
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+/**
+ * decode_body(body_rpos, body_end, is_tuples)
+ *  -> data, metadata, info, cursor_id
+ *
+ * Decode the body of a successful reply. If @a is_tuples is
+ * set, the data is converted to box tuples.
+ */
+static int
+netbox_decode_body(struct lua_State *L)
+{
+	uint32_t ctypeid;
+	const char *data = *(const char **) luaL_checkcdata(L, 1, &ctypeid);
+	const char *end = *(const char **) luaL_checkcdata(L, 2, &ctypeid);
+	bool is_tuples = lua_toboolean(L, 3);
+	int top = lua_gettop(L);
+	lua_pushnil(L); /* data */
+	lua_pushnil(L); /* metadata */
+	lua_pushnil(L); /* info */
+	lua_pushnil(L); /* cursor_id */
+	/* The body is checked by decode_header(). */
+	if (data == end || mp_typeof(*data) != MP_MAP)
+		return 4;
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*data) != MP_UINT) {
+			mp_next(&data);
+			mp_next(&data);
+			continue;
+		}
+		int slot;
+		switch (mp_decode_uint(&data)) {
+		case IPROTO_DATA:
+			slot = 1;
+			break;
+		case IPROTO_METADATA:
+			slot = 2;
+			break;
+		case IPROTO_SQL_INFO:
+			slot = 3;
+			break;
+		case IPROTO_CURSOR_ID:
+			slot = 4;
+			break;
+		default:
+			mp_next(&data);
+			continue;
+		}
+		if (slot == 1 && is_tuples && mp_typeof(*data) == MP_ARRAY)
+			netbox_decode_tuples(L, &data);
+		else
+			luamp_decode(L, cfg, &data);
+		lua_replace(L, top + slot);
+	}
+	return 4;
+}
+
+/**
+ * decode_error(body_rpos, body_end) -> message
+ *
+ * Return the error message of a failed request.
+ */
+static int
+netbox_decode_error(struct lua_State *L)
+{
+	uint32_t ctypeid;
+	const char *data = *(const char **) luaL_checkcdata(L, 1, &ctypeid);
+	const char *end = *(const char **) luaL_checkcdata(L, 2, &ctypeid);
+	if (data == end || mp_typeof(*data) != MP_MAP) {
+		lua_pushnil(L);
+		return 1;
+	}
+	uint32_t map_size = mp_decode_map(&data);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*data) != MP_UINT) {
+			mp_next(&data);
+			mp_next(&data);
+			continue;
+		}
+		if (mp_decode_uint(&data) == IPROTO_ERROR &&
+		    mp_typeof(*data) == MP_STR) {
+			uint32_t len;
+			const char *str = mp_decode_str(&data, &len);
+			lua_pushlstring(L, str, len);
+			return 1;
+		}
+		mp_next(&data);
+	}
+	lua_pushnil(L);
+	return 1;
+}
+
+/** recv() from the socket or read from its shared memory channel. */
+static ssize_t
+netbox_recv(int fd, struct shm_channel *shm, void *buf, size_t size)
+{
+	if (shm == NULL)
+		return recv(fd, buf, size, 0);
+	return shm_channel_read(shm, buf, size);
+}
+
+/** send() to the socket or write to its shared memory channel. */
+static ssize_t
+netbox_send(int fd, struct shm_channel *shm, const void *buf, size_t size)
+{
+	if (shm == NULL)
+		return send(fd, buf, size, 0);
+	struct iovec iov;
+	iov.iov_base = (void *) buf;
+	iov.iov_len = size;
+	return shm_channel_writev(shm, &iov, 1);
+}
+
+/** Receive and decompress data of a connection with compression. */
+static ssize_t
+netbox_recv_zstd(int fd, struct shm_channel *shm, struct iproto_zstd *zstd,
+		 void *buf, size_t size)
+{
+	while (true) {
+		ssize_t n = iproto_zstd_decompress(zstd, buf, size);
+		if (n > 0)
+			return n;
+		if (n < 0) {
+			errno = EPROTO;
+			return -1;
+		}
+		size_t zsize;
+		char *zbuf = iproto_zstd_input_buf(zstd, &zsize);
+		n = netbox_recv(fd, shm, zbuf, zsize);
+		if (n <= 0)
+			return n;
+		iproto_zstd_input_advance(zstd, n);
+	}
+}
+
+/**
+ * Send the compressed output of a connection with compression.
+ * Return 0 if all of it is sent, -1 otherwise.
+ */
+static int
+netbox_flush_zstd(int fd, struct shm_channel *shm, struct iproto_zstd *zstd)
+{
+	while (iproto_zstd_has_output(zstd)) {
+		size_t zsize;
+		const char *zbuf = iproto_zstd_output_buf(zstd, &zsize);
+		if (zsize == 0) {
+			/* Finish flushing the stream. */
+			if (iproto_zstd_compress(zstd, NULL, 0) < 0) {
+				errno = EPROTO;
+				return -1;
+			}
+			continue;
+		}
+		ssize_t n = netbox_send(fd, shm, zbuf, zsize);
+		if (n < 0)
+			return -1;
+		iproto_zstd_output_advance(zstd, n);
+	}
+	return 0;
+}
+
+/**
+ * Compress and send a part of the data of a connection with
+ * compression. Return the size of the consumed data, which is
+ * sent or will be sent by the next call.
+ */
+static ssize_t
+netbox_send_zstd(int fd, struct shm_channel *shm, struct iproto_zstd *zstd,
+		 const void *buf, size_t size)
+{
+	if (netbox_flush_zstd(fd, shm, zstd) != 0)
+		return -1;
+	if (size == 0)
+		return 0;
+	struct iovec iov;
+	iov.iov_base = (void *) buf;
+	iov.iov_len = size;
+	ssize_t n = iproto_zstd_compress(zstd, &iov, 1);
+	if (n < 0) {
+		errno = EPROTO;
+		return -1;
+	}
+	/* Errors are reported by the next call. */
+	netbox_flush_zstd(fd, shm, zstd);
+	return n;
+}
+
+/** Return true if there is data to send. */
+static inline bool
+netbox_has_output(struct ibuf *send_buf, struct iproto_zstd *zstd)
+{
+	return ibuf_used(send_buf) != 0 ||
+	       (zstd != NULL && iproto_zstd_has_output(zstd));
+}
+
+/**
+ * communicate(fd, send_buf, recv_buf, limit_or_boundary, timeout[, shm
+ *             [, zstd]])
  *  -> errno, error
  *  -> nil, limit/boundary_pos
  *
@@ -458,6 +877,14 @@ netbox_decode_greeting(lua_State *L)
  * Instead, this function takes an fd, input and output buffer,
  * and does sending and receiving on it in a single event loop
  * interaction.
+ *
+ * If a shared memory channel, opened with shm_open(), is given,
+ * the data is sent and received through it, and the fd is only
+ * waited on for the peer's wakeups.
+ *
+ * If a compression context, created with zstd_new() after
+ * a successful IPROTO_COMPRESS request, is given, the data is
+ * compressed before sending and decompressed after receiving.
  */
 static int
 netbox_communicate(lua_State *L)
@@ -486,7 +913,25 @@ netbox_communicate(lua_State *L)
 		lua_pushstring(L, "Timeout exceeded");
 		return 2;
 	}
+	struct shm_channel *shm = NULL;
+	if (! lua_isnoneornil(L, 6)) {
+		shm = (struct shm_channel *)
+			luaL_checkudata(L, 6, netbox_shm_typename);
+		if (shm->map == NULL)
+			return luaL_error(L, "shared memory channel is closed");
+	}
+	struct iproto_zstd *zstd = NULL;
+	if (! lua_isnoneornil(L, 7)) {
+		zstd = (struct iproto_zstd *)
+			luaL_checkudata(L, 7, netbox_zstd_typename);
+		if (zstd->cstream == NULL)
+			return luaL_error(L, "compression context is destroyed");
+	}
+	bool is_peer_closed = false;
 	int revents = COIO_READ;
+	/* A wakeup tells about both space and data in the channel. */
+	if (shm != NULL)
+		revents |= COIO_WRITE;
 	while (true) {
 		/* reader serviced first */
 check_limit:
@@ -506,13 +951,23 @@ check_limit:
 			return 2;
 		}
 
+		if (shm != NULL && (revents & COIO_READ) &&
+		    shm_channel_drain(shm) < 0)
+			is_peer_closed = true;
 		while (revents & COIO_READ) {
 			void *p = ibuf_reserve(recv_buf, NETBOX_READAHEAD);
 			if (p == NULL)
 				luaL_error(L, "out of memory");
-			ssize_t rc = recv(
-				fd, recv_buf->wpos, ibuf_unused(recv_buf), 0);
-			if (rc == 0) {
+			ssize_t rc;
+			if (zstd != NULL)
+				rc = netbox_recv_zstd(fd, shm, zstd,
+						      recv_buf->wpos,
+						      ibuf_unused(recv_buf));
+			else
+				rc = netbox_recv(fd, shm, recv_buf->wpos,
+						 ibuf_unused(recv_buf));
+			if (rc == 0 || (rc < 0 && errno == EAGAIN &&
+					is_peer_closed)) {
 				lua_pushinteger(L, ER_NO_CONNECTION);
 				lua_pushstring(L, "Peer closed");
 				return 2;
@@ -525,9 +980,16 @@ check_limit:
 				goto handle_error;
 		}
 
-		while ((revents & COIO_WRITE) && ibuf_used(send_buf) != 0) {
-			ssize_t rc = send(
-				fd, send_buf->rpos, ibuf_used(send_buf), 0);
+		while ((revents & COIO_WRITE) &&
+		       netbox_has_output(send_buf, zstd)) {
+			ssize_t rc;
+			if (zstd != NULL)
+				rc = netbox_send_zstd(fd, shm, zstd,
+						      send_buf->rpos,
+						      ibuf_used(send_buf));
+			else
+				rc = netbox_send(fd, shm, send_buf->rpos,
+						 ibuf_used(send_buf));
 			if (rc >= 0)
 				send_buf->rpos += rc;
 			else if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -537,8 +999,11 @@ check_limit:
 		}
 
 		ev_tstamp deadline = ev_monotonic_now(loop()) + timeout;
-		revents = coio_wait(fd, EV_READ | (ibuf_used(send_buf) != 0 ?
-				EV_WRITE : 0), timeout);
+		revents = coio_wait(fd, EV_READ |
+				(netbox_has_output(send_buf, zstd) &&
+				 shm == NULL ? EV_WRITE : 0), timeout);
+		if (shm != NULL && revents != 0)
+			revents = COIO_READ | COIO_WRITE;
 		luaL_testcancel(L);
 		timeout = deadline - ev_monotonic_now(loop());
 		timeout = MAX(0.0, timeout);
@@ -581,6 +1046,204 @@ netbox_encode_execute(lua_State *L)
 	return 0;
 }
 
+/**
+ * shm_open(fd, sync, timeout) -> shm
+ *                             -> nil, errcode, error
+ *
+ * Ask the server to set up a shared memory channel for the
+ * connection and map the memory it passes over the socket. The
+ * connection must be idle and established over a unix socket.
+ */
+static int
+netbox_shm_open(struct lua_State *L)
+{
+	int fd = lua_tointeger(L, 1);
+	uint64_t sync = luaL_touint64(L, 2);
+	ev_tstamp timeout = TIMEOUT_INFINITY;
+	if (lua_type(L, 3) == LUA_TNUMBER)
+		timeout = lua_tonumber(L, 3);
+	ev_tstamp deadline = ev_monotonic_now(loop()) + timeout;
+
+	char request[64];
+	char *pos = request + 5;
+	pos = mp_encode_map(pos, 2);
+	pos = mp_encode_uint(pos, IPROTO_REQUEST_TYPE);
+	pos = mp_encode_uint(pos, IPROTO_SHM_OPEN);
+	pos = mp_encode_uint(pos, IPROTO_SYNC);
+	pos = mp_encode_uint(pos, sync);
+	request[0] = 0xce;
+	mp_store_u32(request + 1, pos - request - 5);
+
+	const char *wpos = request;
+	while (wpos < pos) {
+		ssize_t rc = send(fd, wpos, pos - wpos, 0);
+		if (rc >= 0) {
+			wpos += rc;
+			continue;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			goto handle_error;
+		timeout = deadline - ev_monotonic_now(loop());
+		if (timeout <= 0)
+			goto handle_timeout;
+		coio_wait(fd, EV_WRITE, timeout);
+		luaL_testcancel(L);
+	}
+
+	/*
+	 * The reply carries the channel memory, so it can't be
+	 * read by communicate(). The connection is idle, hence
+	 * nothing but the reply can arrive.
+	 */
+	char reply[1024];
+	size_t reply_size = 0, reply_len = SIZE_MAX;
+	int memfd = -1;
+	while (reply_size < reply_len) {
+		int received_fd = -1;
+		ssize_t rc = shm_channel_recv_fd(fd, reply + reply_size,
+						 sizeof(reply) - reply_size,
+						 &received_fd);
+		if (received_fd >= 0) {
+			if (memfd >= 0)
+				close(memfd);
+			memfd = received_fd;
+		}
+		if (rc == 0) {
+			errno = ECONNRESET;
+			goto handle_error;
+		} else if (rc > 0) {
+			reply_size += rc;
+		} else if (errno != EAGAIN && errno != EWOULDBLOCK &&
+			   errno != EINTR) {
+			goto handle_error;
+		} else {
+			timeout = deadline - ev_monotonic_now(loop());
+			if (timeout <= 0)
+				goto handle_timeout;
+			coio_wait(fd, EV_READ, timeout);
+			luaL_testcancel(L);
+		}
+		if (reply_len == SIZE_MAX && reply_size >= 5) {
+			if ((unsigned char) reply[0] != 0xce)
+				goto handle_protocol_error;
+			reply_len = 5 + mp_load_u32(reply + 1);
+			if (reply_len > sizeof(reply))
+				goto handle_protocol_error;
+		}
+	}
+	if (reply_size != reply_len)
+		goto handle_protocol_error;
+
+	struct xrow_header row;
+	const char *data = reply + 5;
+	if (xrow_header_decode(&row, &data, reply + reply_len) != 0)
+		goto handle_diag;
+	if (row.type != IPROTO_OK) {
+		xrow_decode_error(&row);
+		goto handle_diag;
+	}
+	if (memfd < 0)
+		goto handle_protocol_error;
+
+	struct shm_channel *shm = (struct shm_channel *)
+		lua_newuserdata(L, sizeof(*shm));
+	shm->map = NULL;
+	luaL_getmetatable(L, netbox_shm_typename);
+	lua_setmetatable(L, -2);
+	int rc = shm_channel_open(shm, fd, memfd);
+	close(memfd);
+	if (rc != 0) {
+		lua_pop(L, 1);
+		memfd = -1;
+		goto handle_diag;
+	}
+	return 1;
+handle_diag: {
+	box_error_t *e = box_error_last();
+	if (memfd >= 0)
+		close(memfd);
+	lua_pushnil(L);
+	lua_pushinteger(L, box_error_code(e));
+	lua_pushstring(L, box_error_message(e));
+	return 3;
+}
+handle_protocol_error:
+	if (memfd >= 0)
+		close(memfd);
+	lua_pushnil(L);
+	lua_pushinteger(L, ER_PROTOCOL);
+	lua_pushstring(L, "Invalid shared memory channel reply");
+	return 3;
+handle_timeout:
+	lua_pushnil(L);
+	lua_pushinteger(L, ER_TIMEOUT);
+	lua_pushstring(L, "Timeout exceeded");
+	return 3;
+handle_error:
+	if (memfd >= 0)
+		close(memfd);
+	lua_pushnil(L);
+	lua_pushinteger(L, ER_NO_CONNECTION);
+	lua_pushstring(L, strerror(errno));
+	return 3;
+}
+
+/**
+ * shm_close(shm)
+ *
+ * Unmap the memory of a shared memory channel. Done by the
+ * garbage collector as well.
+ */
+static int
+netbox_shm_close(struct lua_State *L)
+{
+	struct shm_channel *shm = (struct shm_channel *)
+		luaL_checkudata(L, 1, netbox_shm_typename);
+	shm_channel_destroy(shm);
+	return 0;
+}
+
+/**
+ * zstd_new() -> zstd
+ *        -> nil, code, message
+ *
+ * Create a compression context of a connection, to be passed
+ * to communicate() once the server has accepted IPROTO_COMPRESS.
+ */
+static int
+netbox_zstd_new(struct lua_State *L)
+{
+	struct iproto_zstd *zstd = (struct iproto_zstd *)
+		lua_newuserdata(L, sizeof(*zstd));
+	memset(zstd, 0, sizeof(*zstd));
+	luaL_getmetatable(L, netbox_zstd_typename);
+	lua_setmetatable(L, -2);
+	if (iproto_zstd_create(zstd, IPROTO_ZSTD_LEVEL) != 0) {
+		lua_pop(L, 1);
+		box_error_t *e = box_error_last();
+		lua_pushnil(L);
+		lua_pushinteger(L, box_error_code(e));
+		lua_pushstring(L, box_error_message(e));
+		return 3;
+	}
+	return 1;
+}
+
+/**
+ * zstd_delete(zstd)
+ *
+ * Free the streams of a compression context. Done by the
+ * garbage collector as well.
+ */
+static int
+netbox_zstd_delete(struct lua_State *L)
+{
+	struct iproto_zstd *zstd = (struct iproto_zstd *)
+		luaL_checkudata(L, 1, netbox_zstd_typename);
+	iproto_zstd_destroy(zstd);
+	return 0;
+}
+
 int
 luaopen_net_box(struct lua_State *L)
 {
@@ -590,6 +1253,10 @@ luaopen_net_box(struct lua_State *L)
 		{ "encode_call",    netbox_encode_call },
 		{ "encode_eval",    netbox_encode_eval },
 		{ "encode_select",  netbox_encode_select },
+		{ "encode_get_many", netbox_encode_get_many },
+		{ "encode_cursor_open", netbox_encode_cursor_open },
+		{ "encode_cursor_fetch", netbox_encode_cursor_fetch },
+		{ "encode_cursor_close", netbox_encode_cursor_close },
 		{ "encode_insert",  netbox_encode_insert },
 		{ "encode_replace", netbox_encode_replace },
 		{ "encode_delete",  netbox_encode_delete },
@@ -597,10 +1264,28 @@ luaopen_net_box(struct lua_State *L)
 		{ "encode_upsert",  netbox_encode_upsert },
 		{ "encode_execute", netbox_encode_execute},
 		{ "encode_auth",    netbox_encode_auth },
+		{ "encode_compress", netbox_encode_compress },
 		{ "decode_greeting",netbox_decode_greeting },
+		{ "decode_header",  netbox_decode_header },
+		{ "decode_body",    netbox_decode_body },
+		{ "decode_error",   netbox_decode_error },
 		{ "communicate",    netbox_communicate },
+		{ "shm_open",       netbox_shm_open },
+		{ "shm_close",      netbox_shm_close },
+		{ "zstd_new",       netbox_zstd_new },
+		{ "zstd_delete",    netbox_zstd_delete },
+		{ NULL, NULL}
+	};
+	static const luaL_Reg net_box_shm_meta[] = {
+		{ "__gc",           netbox_shm_close },
+		{ NULL, NULL}
+	};
+	luaL_register_type(L, netbox_shm_typename, net_box_shm_meta);
+	static const luaL_Reg net_box_zstd_meta[] = {
+		{ "__gc",           netbox_zstd_delete },
 		{ NULL, NULL}
 	};
+	luaL_register_type(L, netbox_zstd_typename, net_box_zstd_meta);
 	/* luaL_register_module polutes _G */
 	lua_newtable(L);
 	luaL_openlib(L, NULL, net_box_lib, 0);
@@ -4,7 +4,6 @@ local ffi      = require('ffi')
 local buffer   = require('buffer')
 local socket   = require('socket')
 local fiber    = require('fiber')
-local msgpack  = require('msgpack')
 local errno    = require('errno')
 local urilib   = require('uri')
 local internal = require('net.box.lib')
@@ -14,7 +13,6 @@ local band          = bit.band
 local max           = math.max
 local fiber_clock   = fiber.clock
 local fiber_self    = fiber.self
-local ibuf_decode   = msgpack.ibuf_decode
 
 local table_new           = require('table.new')
 local check_iterator_type = box.internal.check_iterator_type
@@ -26,22 +24,23 @@ local communicate     = internal.communicate
 local encode_auth     = internal.encode_auth
 local encode_select   = internal.encode_select
 local decode_greeting = internal.decode_greeting
+local decode_header   = internal.decode_header
+local decode_body     = internal.decode_body
+local decode_error    = internal.decode_error
+local shm_open        = internal.shm_open
+local shm_close       = internal.shm_close
+local encode_compress = internal.encode_compress
+local zstd_new        = internal.zstd_new
+local zstd_delete     = internal.zstd_delete
 
 local sequence_mt      = { __serialize = 'sequence' }
 local TIMEOUT_INFINITY = 500 * 365 * 86400
 local VSPACE_ID        = 281
 local VINDEX_ID        = 289
 
-local IPROTO_STATUS_KEY    = 0x00
 local IPROTO_ERRNO_MASK    = 0x7FFF
-local IPROTO_SYNC_KEY      = 0x01
-local IPROTO_SCHEMA_VERSION_KEY = 0x05
-local IPROTO_METADATA_KEY = 0x32
-local IPROTO_SQL_INFO_KEY = 0x43
 local IPROTO_SQL_ROW_COUNT_KEY = 0x44
 local IPROTO_FIELD_NAME_KEY = 0x29
-local IPROTO_DATA_KEY      = 0x30
-local IPROTO_ERROR_KEY     = 0x31
 local IPROTO_GREETING_SIZE = 128
 
 -- select errors from box.error
@@ -64,6 +63,10 @@ local method_codec           = {
     update  = internal.encode_update,
     upsert  = internal.encode_upsert,
     select  = internal.encode_select,
+    get_many = internal.encode_get_many,
+    cursor_open = internal.encode_cursor_open,
+    cursor_fetch = internal.encode_cursor_fetch,
+    cursor_close = internal.encode_cursor_close,
     execute = internal.encode_execute,
     -- inject raw data into connection, used by console and tests
     inject = function(buf, id, schema_version, bytes)
@@ -150,6 +153,8 @@ local function create_transport(host, port, user, password, callback)
 
     local worker_fiber
     local connection
+    local shm              -- shared memory channel, if open
+    local zstd             -- compression context, if enabled
     local send_buf         = buffer.ibuf(buffer.READAHEAD)
     local recv_buf         = buffer.ibuf(buffer.READAHEAD)
 
@@ -202,6 +207,8 @@ local function create_transport(host, port, user, password, callback)
             if not (ok or is_final_state[state]) then
                 set_state('error', E_UNKNOWN, err)
             end
+            if shm then shm_close(shm); shm = nil end
+            if zstd then zstd_delete(zstd); zstd = nil end
             if connection then
                 connection:close()
                 connection = nil
@@ -237,10 +244,10 @@ local function create_transport(host, port, user, password, callback)
         local id = next_request_id
         method_codec[method](send_buf, id, schema_version, ...)
         next_request_id = next_id(id)
-        -- reserve space for 8 keys: client, method,
+        -- reserve space for 9 keys: client, method,
         -- schema_version, buffer, errno, response, metadata,
-        -- sql_info.
-        local request = table_new(0, 8)
+        -- sql_info, cursor_id.
+        local request = table_new(0, 9)
         request.client = fiber_self()
         request.method = method
         request.schema_version = schema_version
@@ -253,7 +260,8 @@ local function create_transport(host, port, user, password, callback)
                 return E_TIMEOUT, 'Timeout exceeded'
             end
         until requests[id] == nil -- i.e. completed (beware spurious wakeups)
-        return request.errno, request.response, request.metadata, request.info
+        return request.errno, request.response, request.metadata, request.info,
+               request.cursor_id
     end
 
     local function wakeup_client(client)
@@ -262,22 +270,17 @@ local function create_transport(host, port, user, password, callback)
         end
     end
 
-    local function dispatch_response_iproto(hdr, body_rpos, body_end)
-        local id = hdr[IPROTO_SYNC_KEY]
+    local function dispatch_response_iproto(status, id, body_rpos, body_end)
         local request = requests[id]
         if request == nil then -- nobody is waiting for the response
             return
         end
         requests[id] = nil
-        local status = hdr[IPROTO_STATUS_KEY]
-        local body, body_end_check
 
         if status ~= 0 then
             -- Handle errors
-            body_end_check, body = ibuf_decode(body_rpos)
-            assert(body_end == body_end_check, "invalid xrow length")
             request.errno = band(status, IPROTO_ERRNO_MASK)
-            request.response = body[IPROTO_ERROR_KEY]
+            request.response = decode_error(body_rpos, body_end)
             wakeup_client(request.client)
             return
         end
@@ -293,12 +296,13 @@ local function create_transport(host, port, user, password, callback)
             return
         end
 
-        -- Decode xrow.body[DATA] to Lua objects
-        body_end_check, body = ibuf_decode(body_rpos)
-        assert(body_end == body_end_check, "invalid xrow length")
-        request.response = body[IPROTO_DATA_KEY]
-        request.metadata = body[IPROTO_METADATA_KEY]
-        request.info = body[IPROTO_SQL_INFO_KEY]
+        -- Decode xrow.body[DATA] to Lua objects, and to tuples
+        -- right away, unless the request returns arbitrary data
+        local method = request.method
+        local is_tuples = method ~= 'eval' and method ~= 'call_17' and
+                          method ~= 'execute'
+        request.response, request.metadata, request.info,
+            request.cursor_id = decode_body(body_rpos, body_end, is_tuples)
         wakeup_client(request.client)
     end
 
@@ -311,25 +315,19 @@ local function create_transport(host, port, user, password, callback)
     -- IO (WORKER FIBER) --
     local function send_and_recv(limit_or_boundary, timeout)
         return communicate(connection:fd(), send_buf, recv_buf,
-                           limit_or_boundary, timeout)
+                           limit_or_boundary, timeout, shm, zstd)
     end
 
+    -- Return nil, status, sync, schema_version, body_rpos, body_end
+    -- of the next response, or err, message.
     local function send_and_recv_iproto(timeout)
         local data_len = recv_buf.wpos - recv_buf.rpos
-        local required = 0
-        if data_len < 5 then
-            required = 5
-        else
-            -- PWN! insufficient input validation
-            local bufpos = recv_buf.rpos
-            local rpos, len = ibuf_decode(bufpos)
-            required = (rpos - bufpos) + len
-            if data_len >= required then
-                local body_end = rpos + len
-                local body_rpos, hdr = ibuf_decode(rpos)
-                recv_buf.rpos = body_end
-                return nil, hdr, body_rpos, body_end
-            end
+        local required, body_rpos, status, sync, schema_version =
+            decode_header(recv_buf.rpos, data_len)
+        if body_rpos ~= nil then
+            local body_end = recv_buf.rpos + required
+            recv_buf.rpos = body_end
+            return nil, status, sync, schema_version, body_rpos, body_end
         end
         local deadline = fiber_clock() + (timeout or TIMEOUT_INFINITY)
         local err, extra = send_and_recv(required, timeout)
@@ -357,7 +355,8 @@ local function create_transport(host, port, user, password, callback)
     -- tail-recursive calls to each other. Yep, Lua optimizes
     -- such calls, and yep, this is the canonical way to implement
     -- a state machine in Lua.
-    local console_sm, iproto_auth_sm, iproto_schema_sm, iproto_sm, error_sm
+    local console_sm, iproto_compress_sm, iproto_auth_sm, iproto_schema_sm
+    local iproto_sm, error_sm
 
     protocol_sm = function ()
         local tm_begin, tm = fiber.clock(), callback('fetch_connect_timeout')
@@ -392,6 +391,13 @@ local function create_transport(host, port, user, password, callback)
             set_state('active')
             return console_sm(rid)
         elseif g.protocol == 'Binary' then
+            if callback('will_open_shm') then
+                shm, err, msg = shm_open(connection:fd(), new_request_id(),
+                                         tm - (fiber.clock() - tm_begin))
+                if not shm then
+                    return error_sm(err, msg)
+                end
+            end
             return iproto_auth_sm(g.salt)
         else
             return error_sm(E_NO_CONNECTION, 'Unknown protocol: ' .. g.protocol)
@@ -418,21 +424,43 @@ local function create_transport(host, port, user, password, callback)
     iproto_auth_sm = function(salt)
         set_state('auth')
         if not user or not password then
-            set_state('fetch_schema')
-            return iproto_schema_sm()
+            return iproto_compress_sm()
         end
         encode_auth(send_buf, new_request_id(), nil, user, password, salt)
-        local err, hdr, body_rpos, body_end = send_and_recv_iproto()
+        local err, status, _, schema_version, body_rpos, body_end =
+            send_and_recv_iproto()
         if err then
-            return error_sm(err, hdr)
+            return error_sm(err, status)
+        end
+        if status ~= 0 then
+            return error_sm(E_NO_CONNECTION,
+                            decode_error(body_rpos, body_end))
         end
-        if hdr[IPROTO_STATUS_KEY] ~= 0 then
-            local body
-            body_end, body = ibuf_decode(body_rpos)
-            return error_sm(E_NO_CONNECTION, body[IPROTO_ERROR_KEY])
+        return iproto_compress_sm(schema_version)
+    end
+
+    -- The server only lets authenticated users enable compression.
+    iproto_compress_sm = function(schema_version)
+        if not callback('will_compress') then
+            set_state('fetch_schema')
+            return iproto_schema_sm(schema_version)
+        end
+        encode_compress(send_buf, new_request_id(), nil)
+        local err, status, _, _, body_rpos, body_end = send_and_recv_iproto()
+        if err then
+            return error_sm(err, status)
+        end
+        if status ~= 0 then
+            return error_sm(E_NO_CONNECTION,
+                            decode_error(body_rpos, body_end))
+        end
+        -- The reply is the last uncompressed data from the server.
+        zstd, err, msg = zstd_new()
+        if not zstd then
+            return error_sm(err, msg)
         end
         set_state('fetch_schema')
-        return iproto_schema_sm(hdr[IPROTO_SCHEMA_VERSION_KEY])
+        return iproto_schema_sm(schema_version)
     end
 
     iproto_schema_sm = function(schema_version)
@@ -452,16 +480,15 @@ local function create_transport(host, port, user, password, callback)
         schema_version = nil -- any schema_version will do provided that
                              -- it is consistent across responses
         repeat
-            local err, hdr, body_rpos, body_end = send_and_recv_iproto()
-            if err then return error_sm(err, hdr) end
-            dispatch_response_iproto(hdr, body_rpos, body_end)
-            local id = hdr[IPROTO_SYNC_KEY]
+            local err, status, id, response_schema_version, body_rpos,
+                  body_end = send_and_recv_iproto()
+            if err then return error_sm(err, status) end
+            dispatch_response_iproto(status, id, body_rpos, body_end)
             if id == select1_id or id == select2_id then
                 -- response to a schema query we've submitted
-                local status = hdr[IPROTO_STATUS_KEY]
-                local response_schema_version = hdr[IPROTO_SCHEMA_VERSION_KEY]
                 if status ~= 0 then
-                    return error_sm(E_NO_CONNECTION, body[IPROTO_ERROR_KEY])
+                    return error_sm(E_NO_CONNECTION,
+                                    decode_error(body_rpos, body_end))
                 end
                 if schema_version == nil then
                     schema_version = response_schema_version
@@ -469,9 +496,7 @@ local function create_transport(host, port, user, password, callback)
                     -- schema changed while fetching schema; restart loader
                     return iproto_schema_sm()
                 end
-                local body
-                body_end, body = ibuf_decode(body_rpos)
-                response[id] = body[IPROTO_DATA_KEY]
+                response[id] = decode_body(body_rpos, body_end, false)
             end
         until response[select1_id] and response[select2_id]
         callback('did_fetch_schema', schema_version,
@@ -481,19 +506,16 @@ local function create_transport(host, port, user, password, callback)
     end
 
     iproto_sm = function(schema_version)
-        local err, hdr, body_rpos, body_end = send_and_recv_iproto()
-        if err then return error_sm(err, hdr) end
-        dispatch_response_iproto(hdr, body_rpos, body_end)
-        local status = hdr[IPROTO_STATUS_KEY]
-        local response_schema_version = hdr[IPROTO_SCHEMA_VERSION_KEY]
+        local err, status, id, response_schema_version, body_rpos,
+              body_end = send_and_recv_iproto()
+        if err then return error_sm(err, status) end
+        dispatch_response_iproto(status, id, body_rpos, body_end)
         if response_schema_version > 0 and
            response_schema_version ~= schema_version then
             -- schema_version has been changed - start to load a new version.
             -- Sic: self.schema_version will be updated only after reload.
-            local body
-            body_end, body = ibuf_decode(body_rpos)
             set_state('fetch_schema',
-                      E_WRONG_SCHEMA_VERSION, body[IPROTO_ERROR_KEY],
+                      E_WRONG_SCHEMA_VERSION, decode_error(body_rpos, body_end),
                       response_schema_version)
             return iproto_schema_sm(schema_version)
         end
@@ -501,6 +523,8 @@ local function create_transport(host, port, user, password, callback)
     end
 
     error_sm = function(err, msg)
+        if shm then shm_close(shm); shm = nil end
+        if zstd then zstd_delete(zstd); zstd = nil end
         if connection then connection:close(); connection = nil end
         send_buf:recycle()
         recv_buf:recycle()
@@ -624,6 +648,10 @@ local function connect(...)
             remote.peer_version_id = greeting.version_id
         elseif what == 'will_fetch_schema' then
             return not opts.console
+        elseif what == 'will_open_shm' then
+            return opts.shm
+        elseif what == 'will_compress' then
+            return opts.compress
         elseif what == 'fetch_connect_timeout' then
             return opts.connect_timeout or 10
         elseif what == 'did_fetch_schema' then
@@ -737,15 +765,8 @@ function remote_methods:_request(method, opts, ...)
         if not err and buffer ~= nil then
             return res -- the length of xrow.body
         elseif not err then
-            setmetatable(res, sequence_mt)
-            local postproc = method ~= 'eval' and method ~= 'call_17'
-            if postproc then
-                local tnew = box.tuple.new
-                for i, v in pairs(res) do
-                    res[i] = tnew(v)
-                end
-            end
-            return res
+            -- Tuples are already made by the transport
+            return setmetatable(res, sequence_mt)
         elseif err == E_WRONG_SCHEMA_VERSION then
             err = nil
         end
@@ -753,6 +774,29 @@ function remote_methods:_request(method, opts, ...)
     box.error({code = err, reason = res})
 end
 
+-- Perform a cursor request, return the tuples of the reply and
+-- the id of the cursor, if it remains open.
+function remote_methods:_cursor_request(method, opts, ...)
+    local timeout = self:request_timeout(opts)
+    local perform_request = self._transport.perform_request
+    local err, res, cursor_id, _
+    repeat
+        -- Only opening a cursor depends on the schema, the open
+        -- cursor just ends if the index is altered.
+        local schema_version = method == 'cursor_open' and
+                               self.schema_version or 0
+        err, res, _, _, cursor_id = perform_request(timeout, nil, method,
+                                                    schema_version, ...)
+    until err ~= E_WRONG_SCHEMA_VERSION
+    if err then
+        box.error({code = err, reason = res})
+    end
+    if res ~= nil then
+        setmetatable(res, sequence_mt)
+    end
+    return res, cursor_id
+end
+
 function remote_methods:ping(opts)
     check_remote_arg(self, 'ping')
     local timeout = self:request_timeout(opts)
@@ -982,6 +1026,38 @@ local function one_tuple(tab)
     end
 end
 
+-- A server-side cursor, see index:cursor(). It is opened with
+-- the first fetch and closed as soon as it is exhausted.
+local cursor_methods = {}
+
+function cursor_methods:fetch(opts)
+    local res
+    if self.state == 'initial' then
+        local index = self.index
+        res, self.id = self.remote:_cursor_request('cursor_open', opts,
+                                                   index.space.id, index.id,
+                                                   self.iterator, self.chunk,
+                                                   self.key)
+    elseif self.state == 'open' then
+        res, self.id = self.remote:_cursor_request('cursor_fetch', opts,
+                                                   self.id, self.chunk)
+    else
+        res = setmetatable({}, sequence_mt)
+    end
+    self.state = self.id ~= nil and 'open' or 'closed'
+    return res
+end
+
+function cursor_methods:close(opts)
+    local state = self.state
+    self.state = 'closed'
+    if state == 'open' then
+        self.remote:_cursor_request('cursor_close', opts, self.id)
+    end
+end
+
+local cursor_mt = { __index = cursor_methods }
+
 space_metatable = function(remote)
     local methods = {}
 
@@ -1021,6 +1097,16 @@ space_metatable = function(remote)
         return check_primary_index(self):get(key, opts)
     end
 
+    function methods:get_many(keys, opts)
+        check_space_arg(self, 'get_many')
+        return check_primary_index(self):get_many(keys, opts)
+    end
+
+    function methods:cursor(key, opts)
+        check_space_arg(self, 'cursor')
+        return check_primary_index(self):cursor(key, opts)
+    end
+
     function methods:format(format)
         if format == nil then
             return self._format
@@ -1057,6 +1143,41 @@ index_metatable = function(remote)
         if res[1] ~= nil then return res[1] end
     end
 
+    function methods:get_many(keys, opts)
+        check_index_arg(self, 'get_many')
+        if type(keys) ~= 'table' then
+            box.error(E_PROC_LUA, "Usage: index:get_many({key, ...})")
+        end
+        local request = {}
+        for i = 1, table.maxn(keys) do
+            local key = keys[i]
+            if key == nil then
+                key = {}
+            elseif type(key) ~= 'table' and not box.tuple.is(key) then
+                key = {key}
+            end
+            request[i] = key
+        end
+        return remote:_request('get_many', opts, self.space.id, self.id,
+                               request)
+    end
+
+    -- Iterate over the index in chunks of at most opts.chunk
+    -- tuples, which are fetched with cursor:fetch(). The server
+    -- limits the size of a chunk and the number of open cursors
+    -- of a connection, so a cursor which isn't needed any more
+    -- must be closed with cursor:close().
+    function methods:cursor(key, opts)
+        check_index_arg(self, 'cursor')
+        local key_is_nil = (key == nil or
+                            (type(key) == 'table' and #key == 0))
+        local iterator = check_iterator_type(opts, key_is_nil)
+        local chunk = tonumber(opts and opts.chunk) or 0
+        return setmetatable({remote = remote, index = self, key = key,
+                             iterator = iterator, chunk = chunk,
+                             state = 'initial'}, cursor_mt)
+    end
+
     function methods:min(key, opts)
         check_index_arg(self, 'min')
         if opts and opts.buffer then
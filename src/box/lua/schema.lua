@@ -97,6 +97,13 @@ ffi.cdef[[
     box_select(struct port *port, uint32_t space_id, uint32_t index_id,
                int iterator, uint32_t offset, uint32_t limit,
                const char *key, const char *key_end);
+    int
+    box_select_keys(struct port *port, uint32_t space_id, uint32_t index_id,
+                    int iterator, uint32_t offset, uint32_t limit,
+                    const char *key, const char *key_end);
+    int
+    box_get_many(struct port *port, uint32_t space_id, uint32_t index_id,
+                 const char *keys, const char *keys_end);
     void password_prepare(const char *password, int len,
                           char *out, int out_len);
 ]]
@@ -359,6 +366,7 @@ box.schema.space.create = function(name, options)
         user = 'string, number',
         format = 'table',
         temporary = 'boolean',
+        field_map = 'string',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -402,6 +410,7 @@ box.schema.space.create = function(name, options)
     -- filter out global parameters from the options array
     local space_options = setmap({
         temporary = options.temporary and true or nil,
+        field_map = options.field_map,
     })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -530,6 +539,18 @@ local function update_index_parts(space_id, parts)
                 elseif k == 'is_nullable' then
                     part[k] = v
                     parts_can_be_simplified = false
+                elseif k == 'path' then
+                    if type(v) ~= 'string' then
+                        box.error(box.error.ILLEGAL_PARAMS,
+                                  "options.parts[" .. i .. "]: path (string) is expected")
+                    end
+                    -- Support {1, 'string', path = 'a.b'} shortcut
+                    local c = v:sub(1, 1)
+                    if c ~= '.' and c ~= '[' then
+                        v = '.' .. v
+                    end
+                    part[k] = v
+                    parts_can_be_simplified = false
                 else
                     part[k] = v
                     parts_can_be_simplified = false
@@ -546,6 +567,20 @@ local function update_index_parts(space_id, parts)
                     break
                 end
             end
+            -- Support {'name.a[1]', 'string'} shortcut
+            local name_len = type(part.field) == 'string' and
+                             part.path == nil and part.field:find('[.[]')
+            if name_len then
+                local name = part.field:sub(1, name_len - 1)
+                for k,v in pairs(box.space[space_id]:format()) do
+                    if v.name == name then
+                        part.path = part.field:sub(name_len)
+                        part.field = k
+                        parts_can_be_simplified = false
+                        break
+                    end
+                end
+            end
             if type(part.field) == 'string' then
                 box.error(box.error.ILLEGAL_PARAMS,
                           "options.parts[" .. i .. "]: field was not found by name '" .. part.field .. "'")
@@ -555,6 +590,11 @@ local function update_index_parts(space_id, parts)
                       "options.parts[" .. i .. "]: field (number) must be one-based")
         end
         local fmt = box.space[space_id]:format()[part.field]
+        if part.path ~= nil then
+            -- The format describes the whole field, not
+            -- the value found by the path.
+            fmt = nil
+        end
         if part.type == nil then
             if fmt and fmt.type then
                 part.type = fmt.type
@@ -604,6 +644,11 @@ local index_options = {
     distance = 'string',
     run_count_per_level = 'number',
     run_size_ratio = 'number',
+    compaction = 'string',
+    value_log_threshold = 'number',
+    rank = 'boolean',
+    covering = 'boolean',
+    hash_func = 'string',
     range_size = 'number',
     page_size = 'number',
     bloom_fpr = 'number',
@@ -697,6 +742,11 @@ box.schema.index.create = function(space_id, name, options)
             range_size = options.range_size,
             run_count_per_level = options.run_count_per_level,
             run_size_ratio = options.run_size_ratio,
+            compaction = options.compaction,
+            value_log_threshold = options.value_log_threshold,
+            rank = options.rank,
+            covering = options.covering,
+            hash_func = options.hash_func,
             bloom_fpr = options.bloom_fpr,
     }
     local field_type_aliases = {
@@ -1184,9 +1234,48 @@ function box.schema.space.bless(space)
         return internal.get(index.space_id, index.id, key)
     end
 
+    -- batched get: returns a table with a tuple or nil for each key
+    local function keify_many(keys)
+        if type(keys) ~= 'table' then
+            box.error(box.error.PROC_LUA, "Usage: index:get_many({key, ...})")
+        end
+        local ret = {}
+        for i = 1, table.maxn(keys) do
+            ret[i] = keify(keys[i])
+        end
+        return ret
+    end
+    index_mt.get_many_ffi = function(index, keys)
+        check_index_arg(index, 'get_many')
+        local keys, keys_end = tuple_encode(keify_many(keys))
+
+        builtin.port_create(port)
+        if builtin.box_get_many(port, index.space_id, index.id,
+                                keys, keys_end) ~= 0 then
+            builtin.port_destroy(port);
+            return box.error()
+        end
+
+        local ret = {}
+        local entry = port.first
+        for i=1,tonumber(port.size),1 do
+            if entry.tuple ~= nil then
+                ret[i] = tuple_bless(entry.tuple)
+            end
+            entry = entry.next
+        end
+        builtin.port_destroy(port);
+        return ret
+    end
+    index_mt.get_many_luac = function(index, keys)
+        check_index_arg(index, 'get_many')
+        return internal.get_many(index.space_id, index.id, keify_many(keys))
+    end
+
     local function check_select_opts(opts, key_is_nil)
         local offset = 0
         local limit = 4294967295
+        local keys_only = false
         local iterator = check_iterator_type(opts, key_is_nil)
         if opts ~= nil then
             if opts.offset ~= nil then
@@ -1195,17 +1284,23 @@ function box.schema.space.bless(space)
             if opts.limit ~= nil then
                 limit = opts.limit
             end
+            if opts.keys_only ~= nil then
+                keys_only = opts.keys_only
+            end
         end
-        return iterator, offset, limit
+        return iterator, offset, limit, keys_only
     end
 
     index_mt.select_ffi = function(index, key, opts)
         check_index_arg(index, 'select')
         local key, key_end = tuple_encode(key)
-        local iterator, offset, limit = check_select_opts(opts, key + 1 >= key_end)
+        local iterator, offset, limit, keys_only =
+            check_select_opts(opts, key + 1 >= key_end)
+        local box_select = keys_only and builtin.box_select_keys or
+                           builtin.box_select
 
         builtin.port_create(port)
-        if builtin.box_select(port, index.space_id,
+        if box_select(port, index.space_id,
             index.id, iterator, offset, limit, key, key_end) ~=0 then
             builtin.port_destroy(port);
             return box.error()
@@ -1224,9 +1319,10 @@ function box.schema.space.bless(space)
     index_mt.select_luac = function(index, key, opts)
         check_index_arg(index, 'select')
         local key = keify(key)
-        local iterator, offset, limit = check_select_opts(opts, #key == 0)
+        local iterator, offset, limit, keys_only =
+            check_select_opts(opts, #key == 0)
         return internal.select(index.space_id, index.id, iterator,
-            offset, limit, key)
+            offset, limit, key, keys_only)
     end
 
     index_mt.update = function(index, key, ops)
@@ -1260,7 +1356,8 @@ function box.schema.space.bless(space)
 
     -- true if reading operations may yield
     local read_yields = space.engine == 'vinyl'
-    local read_ops = {'select', 'get', 'min', 'max', 'count', 'random', 'pairs'}
+    local read_ops = {'select', 'get', 'get_many', 'min', 'max', 'count',
+                      'random', 'pairs'}
     for _, op in ipairs(read_ops) do
         if read_yields then
             -- use Lua/C implmenetation
@@ -1304,6 +1401,10 @@ function box.schema.space.bless(space)
         check_space_arg(space, 'get')
         return check_primary_index(space):get(key)
     end
+    space_mt.get_many = function(space, keys)
+        check_space_arg(space, 'get_many')
+        return check_primary_index(space):get_many(keys)
+    end
     space_mt.select = function(space, key, opts)
         check_space_arg(space, 'select')
         return check_primary_index(space):select(key, opts)
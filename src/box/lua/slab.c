@@ -41,6 +41,8 @@
 #include "small/small.h"
 #include "small/quota.h"
 #include "memory.h"
+#include "box/memtx_arena.h"
+#include "box/memtx_engine.h"
 
 extern struct small_alloc memtx_alloc;
 extern struct mempool memtx_index_extent_pool;
@@ -215,6 +217,82 @@ lbox_slab_info(struct lua_State *L)
 	lua_pushstring(L, ratio_buf);
 	lua_settable(L, -3);
 
+	struct memtx_arena_stat arena_stat;
+	memtx_arena_stat(tuple_arena, &arena_stat);
+
+	/** Pages backing the arena, box.cfg.memtx_huge_pages. */
+	lua_pushstring(L, "arena_huge_pages");
+	lua_pushstring(L, memtx_huge_pages_STRS[arena_stat.huge_pages]);
+	lua_settable(L, -3);
+
+	/**
+	 * How much of the arena is mapped with huge pages. Each
+	 * huge page takes one TLB entry instead of hundreds, so
+	 * the closer it is to arena_size, the fewer TLB misses
+	 * lookups in big indexes have.
+	 */
+	lua_pushstring(L, "arena_huge_size");
+	luaL_pushuint64(L, arena_stat.huge_size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "huge_page_size");
+	luaL_pushuint64(L, arena_stat.huge_page_size);
+	lua_settable(L, -3);
+
+	/** NUMA memory policy of the arena, box.cfg.memtx_numa_policy. */
+	lua_pushstring(L, "arena_numa_policy");
+	lua_pushstring(L, memtx_numa_policy_STRS[arena_stat.numa_policy]);
+	lua_settable(L, -3);
+
+	return 1;
+}
+
+static int
+lbox_slab_defrag_info(struct lua_State *L)
+{
+	struct memtx_engine *memtx;
+	memtx = (struct memtx_engine *)engine_by_name("memtx");
+	assert(memtx != NULL);
+	const struct memtx_defrag_stat *stat = &memtx->defrag_stat;
+	lua_newtable(L);
+
+	/**
+	 * Free share of tuple slabs, compared against
+	 * box.cfg.memtx_defrag_threshold.
+	 */
+	lua_pushstring(L, "fragmentation");
+	lua_pushnumber(L, memtx_engine_fragmentation());
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "relocated");
+	luaL_pushuint64(L, stat->relocated);
+	lua_settable(L, -3);
+
+	/** Size of tuple slabs emptied by relocation. */
+	lua_pushstring(L, "reclaimed");
+	luaL_pushuint64(L, stat->reclaimed);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "steps");
+	luaL_pushuint64(L, stat->steps);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "passes");
+	luaL_pushuint64(L, stat->passes);
+	lua_settable(L, -3);
+
+	/**
+	 * Time the tx thread was paused by defragmentation,
+	 * total and the longest step, in seconds.
+	 */
+	lua_pushstring(L, "pause_total");
+	lua_pushnumber(L, stat->pause_total);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "pause_max");
+	lua_pushnumber(L, stat->pause_max);
+	lua_settable(L, -3);
+
 	return 1;
 }
 
@@ -268,6 +346,10 @@ box_lua_slab_init(struct lua_State *L)
 	lua_pushcfunction(L, lbox_slab_check);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "defrag_info");
+	lua_pushcfunction(L, lbox_slab_defrag_info);
+	lua_settable(L, -3);
+
 	lua_settable(L, -3); /* box.slab */
 
 	lua_pushstring(L, "runtime");
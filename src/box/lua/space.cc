@@ -117,6 +117,16 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 	lua_pushboolean(L, space_is_temporary(space));
 	lua_settable(L, i);
 
+	/* space.field_map, only if differs from the default */
+	lua_pushstring(L, "field_map");
+	if (space->def->opts.field_map != FIELD_MAP_INDEXED) {
+		lua_pushstring(L, field_map_mode_strs[
+				space->def->opts.field_map]);
+	} else {
+		lua_pushnil(L);
+	}
+	lua_settable(L, i);
+
 	/* space.name */
 	lua_pushstring(L, "name");
 	lua_pushstring(L, space_name(space));
@@ -175,6 +185,20 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 			lua_pushnumber(L, index_opts->dimension);
 			lua_setfield(L, -2, "dimension");
 		}
+		if (index_def->type == TREE && index_opts->rank) {
+			lua_pushboolean(L, true);
+			lua_setfield(L, -2, "rank");
+		}
+		if (index_def->type == TREE && index_opts->covering) {
+			lua_pushboolean(L, true);
+			lua_setfield(L, -2, "covering");
+		}
+		if (index_def->type == HASH &&
+		    index_opts->hash_func != TUPLE_HASH_MURMUR) {
+			lua_pushstring(L, tuple_hash_version_strs[
+					index_opts->hash_func]);
+			lua_setfield(L, -2, "hash_func");
+		}
 
 		lua_pushstring(L, index_type_strs[index_def->type]);
 		lua_setfield(L, -2, "type");
@@ -206,6 +230,11 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 			lua_pushboolean(L, part->is_nullable);
 			lua_setfield(L, -2, "is_nullable");
 
+			if (part->path != NULL) {
+				lua_pushlstring(L, part->path, part->path_len);
+				lua_setfield(L, -2, "path");
+			}
+
 			lua_settable(L, -3); /* index[k].parts[j] */
 		}
 
@@ -232,6 +261,13 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 			lua_pushnumber(L, index_opts->run_size_ratio);
 			lua_setfield(L, -2, "run_size_ratio");
 
+			lua_pushstring(L, vinyl_compaction_policy_strs[
+					index_opts->compaction]);
+			lua_setfield(L, -2, "compaction");
+
+			lua_pushnumber(L, index_opts->value_log_threshold);
+			lua_setfield(L, -2, "value_log_threshold");
+
 			lua_pushnumber(L, index_opts->bloom_fpr);
 			lua_setfield(L, -2, "bloom_fpr");
 
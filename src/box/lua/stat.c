@@ -45,6 +45,8 @@ extern struct rmean *rmean_error;
 /** network statistics (iproto & cbus) */
 extern struct rmean *rmean_net;
 extern struct rmean *rmean_tx_wal_bus;
+/** memtx statistics */
+extern struct rmean *rmean_memtx;
 
 static void
 fill_stat_item(struct lua_State *L, int rps, int64_t total)
@@ -124,6 +126,21 @@ lbox_stat_net_call(struct lua_State *L)
 	return 1;
 }
 
+static int
+lbox_stat_memtx_index(struct lua_State *L)
+{
+	luaL_checkstring(L, -1);
+	return rmean_foreach(rmean_memtx, seek_stat_item, L);
+}
+
+static int
+lbox_stat_memtx_call(struct lua_State *L)
+{
+	lua_newtable(L);
+	rmean_foreach(rmean_memtx, set_stat_item, L);
+	return 1;
+}
+
 static const struct luaL_Reg lbox_stat_meta [] = {
 	{"__index", lbox_stat_index},
 	{"__call",  lbox_stat_call},
@@ -136,6 +153,12 @@ static const struct luaL_Reg lbox_stat_net_meta [] = {
 	{NULL, NULL}
 };
 
+static const struct luaL_Reg lbox_stat_memtx_meta [] = {
+	{"__index", lbox_stat_memtx_index},
+	{"__call",  lbox_stat_memtx_call},
+	{NULL, NULL}
+};
+
 /** Initialize box.stat package. */
 void
 box_lua_stat_init(struct lua_State *L)
@@ -158,5 +181,12 @@ box_lua_stat_init(struct lua_State *L)
 	luaL_register(L, NULL, lbox_stat_net_meta);
 	lua_setmetatable(L, -2);
 	lua_pop(L, 1); /* stat net module */
+
+	luaL_register_module(L, "box.stat.memtx", statlib);
+
+	lua_newtable(L);
+	luaL_register(L, NULL, lbox_stat_memtx_meta);
+	lua_setmetatable(L, -2);
+	lua_pop(L, 1); /* stat memtx module */
 }
 
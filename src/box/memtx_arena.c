@@ -0,0 +1,298 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_arena.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "small/slab_arena.h"
+#include "say.h"
+#include "trivia/util.h"
+
+const char *memtx_huge_pages_STRS[] = {
+	"none", "transparent", "explicit", NULL
+};
+
+const char *memtx_numa_policy_STRS[] = {
+	"default", "interleave", "bind", NULL
+};
+
+/* Not every libc has <numaif.h>, it comes with libnuma. */
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+enum {
+	NODE_MASK_BITS = 8 * sizeof(unsigned long),
+};
+
+/** Huge pages and NUMA policy memtx_arena_setup() applied. */
+static enum memtx_huge_pages arena_huge_pages = MEMTX_HUGE_PAGES_NONE;
+static enum memtx_numa_policy arena_numa_policy = MEMTX_NUMA_DEFAULT;
+
+static int
+memtx_numa_nodes_parse_list(struct memtx_numa_nodes *nodes, const char *str)
+{
+	memset(nodes, 0, sizeof(*nodes));
+	const char *pos = str;
+	while (true) {
+		char *end;
+		errno = 0;
+		unsigned long first = strtoul(pos, &end, 10);
+		if (end == pos || errno != 0)
+			return -1;
+		unsigned long last = first;
+		pos = end;
+		if (*pos == '-') {
+			pos++;
+			last = strtoul(pos, &end, 10);
+			if (end == pos || errno != 0)
+				return -1;
+			pos = end;
+		}
+		if (first > last || last >= MEMTX_NUMA_NODES_MAX)
+			return -1;
+		for (unsigned long node = first; node <= last; node++) {
+			nodes->mask[node / NODE_MASK_BITS] |=
+				1UL << (node % NODE_MASK_BITS);
+		}
+		if (*pos != ',')
+			break;
+		pos++;
+	}
+	/* Allow the trailing new line of sysfs files. */
+	return *pos == '\0' || strcmp(pos, "\n") == 0 ? 0 : -1;
+}
+
+int
+memtx_numa_nodes_parse(struct memtx_numa_nodes *nodes, const char *str)
+{
+	if (str != NULL && *str != '\0')
+		return memtx_numa_nodes_parse_list(nodes, str);
+	char buf[256];
+	FILE *f = fopen("/sys/devices/system/node/online", "r");
+	if (f != NULL) {
+		bool ok = fgets(buf, sizeof(buf), f) != NULL &&
+			  memtx_numa_nodes_parse_list(nodes, buf) == 0;
+		fclose(f);
+		if (ok)
+			return 0;
+	}
+	/* Not a NUMA system, or no sysfs. */
+	memset(nodes, 0, sizeof(*nodes));
+	nodes->mask[0] = 1;
+	return 0;
+}
+
+/**
+ * Replace the mapping of the arena with one backed by explicit
+ * huge pages. Pages of a private hugetlb mapping are reserved
+ * when it is created, so if there are not enough of them, mmap()
+ * fails right away rather than the process gets SIGBUS later.
+ * The new mapping is moved in place of the old one atomically,
+ * so the arena stays intact on failure.
+ */
+static int
+memtx_arena_map_hugetlb(void *addr, size_t size)
+{
+#if defined(MAP_HUGETLB) && defined(MREMAP_FIXED)
+	void *map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	if (mremap(map, size, size, MREMAP_MAYMOVE | MREMAP_FIXED,
+		   addr) == MAP_FAILED) {
+		int save_errno = errno;
+		munmap(map, size);
+		errno = save_errno;
+		return -1;
+	}
+	return 0;
+#else
+	(void) addr;
+	(void) size;
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+static int
+memtx_arena_madvise_huge(void *addr, size_t size)
+{
+#if defined(MADV_HUGEPAGE)
+	return madvise(addr, size, MADV_HUGEPAGE);
+#else
+	(void) addr;
+	(void) size;
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+static int
+memtx_arena_mbind(void *addr, size_t size, int mode,
+		  const struct memtx_numa_nodes *nodes)
+{
+#if defined(SYS_mbind)
+	/* The kernel wants the number of bits in the mask plus one. */
+	return syscall(SYS_mbind, addr, size, mode, nodes->mask,
+		       MEMTX_NUMA_NODES_MAX + 1, 0);
+#else
+	(void) addr;
+	(void) size;
+	(void) mode;
+	(void) nodes;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+void
+memtx_arena_setup(struct slab_arena *arena, enum memtx_huge_pages huge_pages,
+		  enum memtx_numa_policy numa_policy, const char *numa_nodes)
+{
+	void *addr = arena->arena;
+	size_t size = arena->prealloc;
+
+	if (huge_pages == MEMTX_HUGE_PAGES_EXPLICIT) {
+		if (memtx_arena_map_hugetlb(addr, size) == 0) {
+			arena_huge_pages = MEMTX_HUGE_PAGES_EXPLICIT;
+		} else {
+			say_warn("failed to back %zu bytes of memtx arena "
+				 "with explicit huge pages: %s, check "
+				 "vm.nr_hugepages; using transparent huge "
+				 "pages", size, strerror(errno));
+			huge_pages = MEMTX_HUGE_PAGES_TRANSPARENT;
+		}
+	}
+	if (huge_pages == MEMTX_HUGE_PAGES_TRANSPARENT) {
+		if (memtx_arena_madvise_huge(addr, size) == 0) {
+			arena_huge_pages = MEMTX_HUGE_PAGES_TRANSPARENT;
+		} else {
+			say_warn("failed to enable transparent huge pages "
+				 "for memtx arena: %s", strerror(errno));
+		}
+	}
+
+	if (numa_policy != MEMTX_NUMA_DEFAULT) {
+		struct memtx_numa_nodes nodes;
+		if (memtx_numa_nodes_parse(&nodes, numa_nodes) != 0)
+			unreachable(); /* checked in box.cfg */
+		int mode = numa_policy == MEMTX_NUMA_BIND ?
+			   MPOL_BIND : MPOL_INTERLEAVE;
+		if (memtx_arena_mbind(addr, size, mode, &nodes) == 0) {
+			arena_numa_policy = numa_policy;
+		} else {
+			say_warn("failed to set NUMA policy '%s' for memtx "
+				 "arena: %s",
+				 memtx_numa_policy_STRS[numa_policy],
+				 strerror(errno));
+		}
+	}
+	say_info("memtx arena uses %s huge pages and %s NUMA policy",
+		 memtx_huge_pages_STRS[arena_huge_pages],
+		 memtx_numa_policy_STRS[arena_numa_policy]);
+}
+
+/** Size of a huge page of the system, 0 if unknown. */
+static size_t
+huge_page_size(void)
+{
+	static size_t size = SIZE_MAX;
+	if (size != SIZE_MAX)
+		return size;
+	size = 0;
+	FILE *f = fopen("/proc/meminfo", "r");
+	if (f == NULL)
+		return size;
+	char line[256];
+	size_t kb;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1) {
+			size = kb * 1024;
+			break;
+		}
+	}
+	fclose(f);
+	return size;
+}
+
+/**
+ * Sum up the memory of the arena mapped with huge pages, either
+ * transparent or explicit, as reported in /proc/self/smaps.
+ */
+static size_t
+memtx_arena_huge_size(struct slab_arena *arena)
+{
+	FILE *f = fopen("/proc/self/smaps", "r");
+	if (f == NULL)
+		return 0;
+	uintptr_t arena_begin = (uintptr_t) arena->arena;
+	uintptr_t arena_end = arena_begin + arena->prealloc;
+	bool in_arena = false;
+	size_t huge_size = 0;
+	char line[1024];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		uintptr_t begin, end;
+		size_t kb;
+		if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR " ",
+			   &begin, &end) == 2) {
+			/* A header line of the next mapping. */
+			in_arena = begin < arena_end && end > arena_begin;
+		} else if (in_arena &&
+			   (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1 ||
+			    sscanf(line, "Private_Hugetlb: %zu kB", &kb) == 1 ||
+			    sscanf(line, "Shared_Hugetlb: %zu kB", &kb) == 1)) {
+			huge_size += kb * 1024;
+		}
+	}
+	fclose(f);
+	return huge_size;
+}
+
+void
+memtx_arena_stat(struct slab_arena *arena, struct memtx_arena_stat *stat)
+{
+	stat->huge_pages = arena_huge_pages;
+	stat->numa_policy = arena_numa_policy;
+	stat->huge_page_size = huge_page_size();
+	stat->huge_size = memtx_arena_huge_size(arena);
+}
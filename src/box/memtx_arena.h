@@ -0,0 +1,131 @@
+#ifndef TARANTOOL_BOX_MEMTX_ARENA_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_ARENA_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/**
+ * Placement of the memtx arena in memory: huge pages to cut TLB
+ * misses on index lookups and a NUMA memory policy to avoid
+ * remote memory accesses on multi-socket hosts. Both are set up
+ * right after the arena is mapped, before any memory of it is
+ * touched.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct slab_arena;
+
+/** Pages backing the memtx arena, box.cfg.memtx_huge_pages. */
+enum memtx_huge_pages {
+	/** Regular pages, or whatever the system THP setting is. */
+	MEMTX_HUGE_PAGES_NONE = 0,
+	/** Transparent huge pages, madvise(MADV_HUGEPAGE). */
+	MEMTX_HUGE_PAGES_TRANSPARENT,
+	/**
+	 * Huge pages reserved by the administrator with
+	 * vm.nr_hugepages. If there are not enough of them,
+	 * transparent huge pages are used.
+	 */
+	MEMTX_HUGE_PAGES_EXPLICIT,
+	MEMTX_HUGE_PAGES_MAX
+};
+
+extern const char *memtx_huge_pages_STRS[];
+
+/** NUMA memory policy of the memtx arena, box.cfg.memtx_numa_policy. */
+enum memtx_numa_policy {
+	/** Pages are allocated on the node of the touching thread. */
+	MEMTX_NUMA_DEFAULT = 0,
+	/** Pages are spread evenly over the nodes. */
+	MEMTX_NUMA_INTERLEAVE,
+	/** Pages are allocated only on the nodes. */
+	MEMTX_NUMA_BIND,
+	MEMTX_NUMA_MAX
+};
+
+extern const char *memtx_numa_policy_STRS[];
+
+enum {
+	/** Max number of NUMA nodes in box.cfg.memtx_numa_nodes. */
+	MEMTX_NUMA_NODES_MAX = 1024,
+};
+
+/** A set of NUMA nodes. */
+struct memtx_numa_nodes {
+	unsigned long mask[MEMTX_NUMA_NODES_MAX / (8 * sizeof(unsigned long))];
+};
+
+/**
+ * Parse a list of NUMA nodes like "0,2-3". An empty or NULL
+ * list stands for all online nodes of the host.
+ *
+ * @retval  0 Success.
+ * @retval -1 The list is malformed.
+ */
+int
+memtx_numa_nodes_parse(struct memtx_numa_nodes *nodes, const char *str);
+
+/** Memory placement of the memtx arena, for box.slab.info(). */
+struct memtx_arena_stat {
+	/** Huge pages actually used. */
+	enum memtx_huge_pages huge_pages;
+	/** NUMA policy actually applied. */
+	enum memtx_numa_policy numa_policy;
+	/** Size of a huge page of the system. */
+	size_t huge_page_size;
+	/** How much of the arena is backed by huge pages. */
+	size_t huge_size;
+};
+
+/**
+ * Back the memory of the arena with huge pages and apply
+ * a NUMA memory policy to it. Falls back to what the system
+ * supports with a warning in the log, so never fails.
+ *
+ * @param numa_nodes The nodes of the policy, in the format
+ *        of memtx_numa_nodes_parse(), checked by the caller.
+ */
+void
+memtx_arena_setup(struct slab_arena *arena, enum memtx_huge_pages huge_pages,
+		  enum memtx_numa_policy numa_policy, const char *numa_nodes);
+
+/** Get the memory placement of the arena. */
+void
+memtx_arena_stat(struct slab_arena *arena, struct memtx_arena_stat *stat);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_ARENA_H_INCLUDED */
@@ -450,8 +450,18 @@ memtx_bitset_index_count(struct index *base, enum iterator_type type,
 				bitset_index_count(&index->index, bit);
 	}
 
-	/* Call generic method */
-	return generic_index_count(base, type, key, part_count);
+	/*
+	 * Count matching values page by page rather than
+	 * iterating over tuples one by one.
+	 */
+	struct iterator *it = memtx_bitset_index_create_iterator(base, type,
+							key, part_count);
+	if (it == NULL)
+		return -1;
+	size_t count = bitset_iterator_count(
+			&bitset_index_iterator(it)->bitset_it);
+	iterator_delete(it);
+	return count;
 }
 
 static const struct index_vtab memtx_bitset_index_vtab = {
@@ -465,6 +475,7 @@ static const struct index_vtab memtx_bitset_index_vtab = {
 	/* .random = */ generic_index_random,
 	/* .count = */ memtx_bitset_index_count,
 	/* .get = */ generic_index_get,
+	/* .get_many = */ generic_index_get_many,
 	/* .replace = */ memtx_bitset_index_replace,
 	/* .create_iterator = */ memtx_bitset_index_create_iterator,
 	/* .create_snapshot_iterator = */
@@ -33,7 +33,11 @@
 #include "memtx_tuple.h"
 
 #include <small/mempool.h>
+#include <small/small.h>
+#include <msgpuck/msgpuck.h>
+#include <rmean.h>
 
+#include "clock.h"
 #include "coio_file.h"
 #include "tuple.h"
 #include "txn.h"
@@ -53,6 +57,7 @@
  * box.slab.info(), @sa lua/slab.cc
  */
 extern struct quota memtx_quota;
+extern struct small_alloc memtx_alloc;
 static bool memtx_index_arena_initialized = false;
 struct slab_arena memtx_arena; /* used by memtx_tuple.cc */
 static struct slab_cache memtx_index_slab_cache;
@@ -67,6 +72,12 @@ struct mempool memtx_index_extent_pool;
 static int memtx_index_num_reserved_extents;
 static void *memtx_index_reserved_extents;
 
+struct rmean *rmean_memtx;
+
+const char *rmean_memtx_strings[MEMTX_STAT_LAST] = {
+	"UPDATE_PATCH", "UPDATE_IN_PLACE"
+};
+
 static void
 txn_on_yield_or_stop(struct trigger *trigger, void *event)
 {
@@ -129,6 +140,13 @@ static void
 memtx_engine_shutdown(struct engine *engine)
 {
 	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	/*
+	 * The fiber doesn't touch the engine once it is
+	 * woken up cancelled, so the engine can be freed.
+	 */
+	if (memtx->defrag_fiber != NULL)
+		fiber_cancel(memtx->defrag_fiber);
+	free(memtx->defrag_key);
 	if (mempool_is_initialized(&memtx->tree_iterator_pool))
 		mempool_destroy(&memtx->tree_iterator_pool);
 	if (mempool_is_initialized(&memtx->rtree_iterator_pool))
@@ -139,6 +157,7 @@ memtx_engine_shutdown(struct engine *engine)
 		mempool_destroy(&memtx->bitset_iterator_pool);
 	xdir_destroy(&memtx->snap_dir);
 	free(memtx);
+	rmean_delete(rmean_memtx);
 	memtx_tuple_free();
 }
 
@@ -332,7 +351,8 @@ memtx_engine_prepare(struct engine *engine, struct txn *txn)
 static int
 memtx_engine_begin(struct engine *engine, struct txn *txn)
 {
-	(void)engine;
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	memtx->txn_count++;
 	/*
 	 * Register a trigger to rollback transaction on yield.
 	 * This must be done in begin(), since it's
@@ -376,6 +396,15 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 	struct memtx_space *memtx_space = (struct memtx_space *)space;
 	int index_count;
 
+	if (stmt->old_tuple == stmt->new_tuple) {
+		/* The tuple was updated in place, indexes are intact. */
+		memtx_space_undo_update_in_place(stmt);
+		tuple_unref(stmt->new_tuple);
+		stmt->old_tuple = NULL;
+		stmt->new_tuple = NULL;
+		return;
+	}
+
 	/* Only roll back the changes if they were made. */
 	if (stmt->engine_savepoint == NULL)
 		index_count = 0;
@@ -412,6 +441,9 @@ memtx_engine_rollback_statement(struct engine *engine, struct txn *txn,
 static void
 memtx_engine_rollback(struct engine *engine, struct txn *txn)
 {
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	assert(memtx->txn_count > 0);
+	memtx->txn_count--;
 	memtx_engine_prepare(engine, txn);
 	struct txn_stmt *stmt;
 	stailq_reverse(&txn->stmts);
@@ -422,7 +454,9 @@ memtx_engine_rollback(struct engine *engine, struct txn *txn)
 static void
 memtx_engine_commit(struct engine *engine, struct txn *txn)
 {
-	(void)engine;
+	struct memtx_engine *memtx = (struct memtx_engine *)engine;
+	assert(memtx->txn_count > 0);
+	memtx->txn_count--;
 	struct txn_stmt *stmt;
 	stailq_foreach_entry(stmt, &txn->stmts, next) {
 		if (stmt->old_tuple)
@@ -896,12 +930,271 @@ static const struct engine_vtab memtx_engine_vtab = {
 	/* .check_space_def = */ memtx_engine_check_space_def,
 };
 
+enum {
+	/** Number of tuples collected by one index lookup. */
+	MEMTX_DEFRAG_BATCH_SIZE = 64,
+};
+
+/** Max duration of a defragmentation step, in seconds. */
+static const double MEMTX_DEFRAG_STEP_TIME = 0.001;
+/** Delay between defragmentation steps, in seconds. */
+static const double MEMTX_DEFRAG_STEP_DELAY = 0.01;
+/** How often fragmentation is checked, in seconds. */
+static const double MEMTX_DEFRAG_CHECK_PERIOD = 1;
+
+static int
+memtx_small_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	(void)stats;
+	(void)cb_ctx;
+	return 0;
+}
+
+double
+memtx_engine_fragmentation(void)
+{
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_small_stats_noop_cb, NULL);
+	if (totals.total == 0)
+		return 0;
+	return (double)(totals.total - totals.used) / totals.total;
+}
+
+static bool
+memtx_defrag_is_needed(struct memtx_engine *memtx)
+{
+	if (memtx->defrag_threshold == 0 || memtx->state != MEMTX_OK ||
+	    memtx->checkpoint != NULL)
+		return false;
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_small_stats_noop_cb, NULL);
+	size_t free_size = totals.total - totals.used;
+	return free_size >= memtx->defrag_min_free &&
+	       free_size >= memtx->defrag_threshold * totals.total;
+}
+
+static bool
+memtx_defrag_space_is_eligible(struct memtx_engine *memtx,
+			       struct space *space)
+{
+	return space->engine == &memtx->base && !space_is_system(space) &&
+	       space_index(space, 0) != NULL;
+}
+
+struct memtx_defrag_space_search {
+	struct memtx_engine *memtx;
+	/** Look for a space with id no less than this. */
+	uint32_t min_id;
+	/** The space with the lowest id found so far. */
+	struct space *space;
+};
+
+static int
+memtx_defrag_find_space_cb(struct space *space, void *arg)
+{
+	struct memtx_defrag_space_search *search =
+		(struct memtx_defrag_space_search *)arg;
+	if (space_id(space) >= search->min_id &&
+	    memtx_defrag_space_is_eligible(search->memtx, space) &&
+	    (search->space == NULL ||
+	     space_id(space) < space_id(search->space)))
+		search->space = space;
+	return 0;
+}
+
+/** Set the position of the defragmentation pass. */
+static int
+memtx_defrag_set_pos(struct memtx_engine *memtx, uint32_t space_id,
+		     const char *key, uint32_t key_size)
+{
+	char *key_copy = NULL;
+	if (key != NULL) {
+		key_copy = (char *)malloc(key_size);
+		if (key_copy == NULL) {
+			diag_set(OutOfMemory, key_size, "malloc",
+				 "defragmentation key");
+			return -1;
+		}
+		memcpy(key_copy, key, key_size);
+	}
+	free(memtx->defrag_key);
+	memtx->defrag_key = key_copy;
+	memtx->defrag_space_id = space_id;
+	return 0;
+}
+
+/**
+ * Relocate a batch of tuples following the position of the
+ * defragmentation pass. Tuples are collected before they are
+ * relocated, since a tree iterator references its current tuple.
+ *
+ * @retval  0 Success.
+ * @retval  1 All spaces have been visited.
+ * @retval -1 Error.
+ */
+static int
+memtx_defrag_relocate_batch(struct memtx_engine *memtx)
+{
+	struct space *space = space_by_id(memtx->defrag_space_id);
+	if (space == NULL || !memtx_defrag_space_is_eligible(memtx, space)) {
+		struct memtx_defrag_space_search search;
+		search.memtx = memtx;
+		search.min_id = memtx->defrag_space_id;
+		search.space = NULL;
+		if (space_foreach(memtx_defrag_find_space_cb, &search) != 0)
+			return -1;
+		if (search.space == NULL)
+			return 1;
+		space = search.space;
+		if (memtx_defrag_set_pos(memtx, space_id(space), NULL, 0) != 0)
+			return -1;
+	}
+	struct index *pk = space_index(space, 0);
+	enum iterator_type type = ITER_ALL;
+	const char *key = memtx->defrag_key;
+	uint32_t part_count = 0;
+	if (key != NULL) {
+		part_count = mp_decode_array(&key);
+		type = ITER_GT;
+		if (key_validate(pk->def, type, key, part_count) != 0) {
+			/* The primary key was altered, start over. */
+			diag_clear(diag_get());
+			type = ITER_ALL;
+			key = NULL;
+			part_count = 0;
+		}
+	}
+	struct iterator *it = index_create_iterator(pk, type, key, part_count);
+	if (it == NULL)
+		return -1;
+	struct tuple *batch[MEMTX_DEFRAG_BATCH_SIZE];
+	int count = 0;
+	while (count < MEMTX_DEFRAG_BATCH_SIZE) {
+		struct tuple *tuple;
+		if (iterator_next(it, &tuple) != 0) {
+			iterator_delete(it);
+			return -1;
+		}
+		if (tuple == NULL)
+			break;
+		batch[count++] = tuple;
+	}
+	iterator_delete(it);
+	if (count == 0) {
+		/* Move on to the next space. */
+		return memtx_defrag_set_pos(memtx, space_id(space) + 1,
+					    NULL, 0);
+	}
+	uint32_t key_size;
+	const char *last_key = tuple_extract_key(batch[count - 1],
+						 pk->def->key_def, &key_size);
+	if (last_key == NULL ||
+	    memtx_defrag_set_pos(memtx, space_id(space),
+				 last_key, key_size) != 0)
+		return -1;
+	for (int i = 0; i < count; i++) {
+		int rc = memtx_space_relocate_tuple(space, batch[i]);
+		if (rc < 0)
+			return -1;
+		if (rc == 0)
+			memtx->defrag_stat.relocated++;
+	}
+	return 0;
+}
+
+/**
+ * Relocate tuples for no longer than MEMTX_DEFRAG_STEP_TIME.
+ * @retval 0 The pass isn't over yet.
+ * @retval 1 The pass is over or failed.
+ */
+static int
+memtx_defrag_step(struct memtx_engine *memtx)
+{
+	struct memtx_defrag_stat *stat = &memtx->defrag_stat;
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_small_stats_noop_cb, NULL);
+	size_t size = totals.total;
+
+	int rc;
+	double start = clock_monotonic();
+	double now;
+	do {
+		rc = memtx_defrag_relocate_batch(memtx);
+		now = clock_monotonic();
+	} while (rc == 0 && now - start < MEMTX_DEFRAG_STEP_TIME);
+	fiber_gc();
+
+	small_stats(&memtx_alloc, &totals, memtx_small_stats_noop_cb, NULL);
+	if (totals.total < size)
+		stat->reclaimed += size - totals.total;
+	stat->steps++;
+	stat->pause_total += now - start;
+	if (now - start > stat->pause_max)
+		stat->pause_max = now - start;
+
+	if (rc == 0)
+		return 0;
+	if (rc < 0) {
+		say_warn("failed to defragment memtx arena");
+		diag_log();
+	} else {
+		stat->passes++;
+	}
+	/* Start the next pass from the beginning. */
+	free(memtx->defrag_key);
+	memtx->defrag_key = NULL;
+	memtx->defrag_space_id = 0;
+	return 1;
+}
+
+/**
+ * Move tuples towards the beginning of the arena in small steps,
+ * while the free share of tuple slabs exceeds the threshold, so
+ * that slabs at the end of the arena become empty and can be
+ * reused by any size class.
+ *
+ * A copy of a tuple comes from the same mempool, which takes
+ * free slots from the lowest-addressed slab it allocates from,
+ * and a tuple is only moved if its copy lands lower. So a tuple
+ * above that slab always moves, and a pass which visits every
+ * tuple leaves no tuples above it: all the slabs at the top of
+ * the pool are emptied and released, however sparse or dense
+ * they were. A sparse slab at the bottom isn't emptied, but
+ * filled up by the tuples moved down, which removes the same
+ * amount of free space. Tuples referenced from elsewhere aren't
+ * moved and may pin their slabs until the next pass.
+ */
+static int
+memtx_defrag_f(va_list ap)
+{
+	struct memtx_engine *memtx = va_arg(ap, struct memtx_engine *);
+	/* Don't touch the engine after cancellation, see shutdown. */
+	while (!fiber_is_cancelled()) {
+		if (!memtx_defrag_is_needed(memtx)) {
+			fiber_sleep(MEMTX_DEFRAG_CHECK_PERIOD);
+			continue;
+		}
+		if (memtx->txn_count > 0) {
+			fiber_sleep(MEMTX_DEFRAG_STEP_DELAY);
+			continue;
+		}
+		if (memtx_defrag_step(memtx) == 0)
+			fiber_sleep(MEMTX_DEFRAG_STEP_DELAY);
+		else
+			fiber_sleep(MEMTX_DEFRAG_CHECK_PERIOD);
+	}
+	return 0;
+}
+
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 float alloc_factor)
+		 float alloc_factor, enum memtx_huge_pages huge_pages,
+		 enum memtx_numa_policy numa_policy, const char *numa_nodes)
 {
 	memtx_tuple_init(tuple_arena_max_size, objsize_min, alloc_factor);
+	/* Nothing has been allocated from the arena yet. */
+	memtx_arena_setup(&memtx_arena, huge_pages, numa_policy, numa_nodes);
 
 	struct memtx_engine *memtx = calloc(1, sizeof(*memtx));
 	if (memtx == NULL) {
@@ -919,11 +1212,29 @@ memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		return NULL;
 	}
 
+	rmean_memtx = rmean_new(rmean_memtx_strings, MEMTX_STAT_LAST);
+	if (rmean_memtx == NULL) {
+		diag_set(OutOfMemory, sizeof(struct rmean),
+			 "rmean", "struct rmean");
+		xdir_destroy(&memtx->snap_dir);
+		free(memtx);
+		return NULL;
+	}
+
+	memtx->defrag_fiber = fiber_new("memtx.defrag", memtx_defrag_f);
+	if (memtx->defrag_fiber == NULL) {
+		rmean_delete(rmean_memtx);
+		xdir_destroy(&memtx->snap_dir);
+		free(memtx);
+		return NULL;
+	}
+
 	memtx->state = MEMTX_INITIALIZED;
 	memtx->force_recovery = force_recovery;
 
 	memtx->base.vtab = &memtx_engine_vtab;
 	memtx->base.name = "memtx";
+	fiber_start(memtx->defrag_fiber, memtx);
 	return memtx;
 }
 
@@ -940,6 +1251,22 @@ memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size)
 	memtx_max_tuple_size = max_size;
 }
 
+void
+memtx_engine_set_defrag_threshold(struct memtx_engine *memtx,
+				  double threshold)
+{
+	memtx->defrag_threshold = threshold;
+	fiber_wakeup(memtx->defrag_fiber);
+}
+
+void
+memtx_engine_set_defrag_min_free(struct memtx_engine *memtx,
+				 size_t min_free)
+{
+	memtx->defrag_min_free = min_free;
+	fiber_wakeup(memtx->defrag_fiber);
+}
+
 /**
  * Initialize arena for indexes.
  * The arena is used for memtx_index_extent_alloc
@@ -36,6 +36,7 @@
 #include <small/mempool.h>
 
 #include "engine.h"
+#include "memtx_arena.h"
 #include "xlog.h"
 
 #if defined(__cplusplus)
@@ -79,6 +80,36 @@ enum memtx_recovery_state {
 /** Memtx extents pool, available to statistics. */
 extern struct mempool memtx_index_extent_pool;
 
+/** Memtx request statistics, see box.stat.memtx. */
+enum memtx_stat_name {
+	/** UPDATE executed by patching a copy of the old tuple. */
+	MEMTX_STAT_UPDATE_PATCH,
+	/** UPDATE executed by patching the old tuple in place. */
+	MEMTX_STAT_UPDATE_IN_PLACE,
+	MEMTX_STAT_LAST,
+};
+
+extern const char *rmean_memtx_strings[MEMTX_STAT_LAST];
+
+/** Memtx request statistics, available to box.stat.memtx. */
+extern struct rmean *rmean_memtx;
+
+/** Arena defragmentation statistics, see box.slab.defrag_info(). */
+struct memtx_defrag_stat {
+	/** Number of relocated tuples. */
+	uint64_t relocated;
+	/** Size of tuple slabs given back to the slab cache. */
+	uint64_t reclaimed;
+	/** Number of defragmentation steps made. */
+	uint64_t steps;
+	/** Number of complete passes over all spaces. */
+	uint64_t passes;
+	/** Total time the tx thread spent in steps, in seconds. */
+	double pause_total;
+	/** The longest step, in seconds. */
+	double pause_max;
+};
+
 struct memtx_engine {
 	struct engine base;
 	/** Engine recovery state. */
@@ -99,12 +130,43 @@ struct memtx_engine {
 	struct mempool hash_iterator_pool;
 	/** Memory pool for bitset index iterator. */
 	struct mempool bitset_iterator_pool;
+	/**
+	 * Number of memtx transactions in progress. Their
+	 * statements point to the tuples they insert, so
+	 * tuples aren't relocated while there are any.
+	 */
+	uint32_t txn_count;
+	/** Fiber relocating tuples to defragment the arena. */
+	struct fiber *defrag_fiber;
+	/**
+	 * Fragmentation of the tuple arena, i.e. the free share
+	 * of tuple slabs, which triggers defragmentation.
+	 * 0 if defragmentation is disabled.
+	 */
+	double defrag_threshold;
+	/**
+	 * Less free space in tuple slabs, in bytes, doesn't
+	 * trigger defragmentation, whatever the fragmentation.
+	 */
+	size_t defrag_min_free;
+	/** The space the current defragmentation pass is at. */
+	uint32_t defrag_space_id;
+	/**
+	 * Primary key of the last tuple visited in the space,
+	 * malloc()ed, or NULL if the space is to be visited
+	 * from the beginning.
+	 */
+	char *defrag_key;
+	/** Defragmentation statistics. */
+	struct memtx_defrag_stat defrag_stat;
 };
 
 struct memtx_engine *
 memtx_engine_new(const char *snap_dirname, bool force_recovery,
 		 uint64_t tuple_arena_max_size,
-		 uint32_t objsize_min, float alloc_factor);
+		 uint32_t objsize_min, float alloc_factor,
+		 enum memtx_huge_pages huge_pages,
+		 enum memtx_numa_policy numa_policy, const char *numa_nodes);
 
 int
 memtx_engine_recover_snapshot(struct memtx_engine *memtx,
@@ -116,6 +178,26 @@ memtx_engine_set_snap_io_rate_limit(struct memtx_engine *memtx, double limit);
 void
 memtx_engine_set_max_tuple_size(struct memtx_engine *memtx, size_t max_size);
 
+/**
+ * Set the fragmentation of the tuple arena, from 0 to 1, which
+ * triggers online defragmentation. 0 disables defragmentation.
+ */
+void
+memtx_engine_set_defrag_threshold(struct memtx_engine *memtx,
+				  double threshold);
+
+/**
+ * Set how much free space in tuple slabs, in bytes, is needed
+ * to trigger online defragmentation.
+ */
+void
+memtx_engine_set_defrag_min_free(struct memtx_engine *memtx,
+				 size_t min_free);
+
+/** Get the fragmentation of the tuple arena, from 0 to 1. */
+double
+memtx_engine_fragmentation(void);
+
 enum {
 	MEMTX_EXTENT_SIZE = 16 * 1024,
 	MEMTX_SLAB_SIZE = 4 * 1024 * 1024
@@ -157,12 +239,15 @@ memtx_index_extent_reserve(int num);
 static inline struct memtx_engine *
 memtx_engine_new_xc(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
-		    uint32_t objsize_min, float alloc_factor)
+		    uint32_t objsize_min, float alloc_factor,
+		    enum memtx_huge_pages huge_pages,
+		    enum memtx_numa_policy numa_policy, const char *numa_nodes)
 {
 	struct memtx_engine *memtx;
 	memtx = memtx_engine_new(snap_dirname, force_recovery,
 				 tuple_arena_max_size,
-				 objsize_min, alloc_factor);
+				 objsize_min, alloc_factor,
+				 huge_pages, numa_policy, numa_nodes);
 	if (memtx == NULL)
 		diag_raise();
 	return memtx;
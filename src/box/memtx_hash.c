@@ -67,6 +67,26 @@ equal_key(struct tuple *tuple, const char *key,
 typedef uint32_t hash_t;
 #include "salad/light.h"
 
+/**
+ * Hash a tuple with the function set by the hash_func index
+ * option. Changing the option rebuilds the index, so all
+ * tuples in the hash table are hashed the same way.
+ */
+static inline uint32_t
+memtx_hash_index_tuple_hash(struct index *base, struct tuple *tuple)
+{
+	return tuple_hash_by_version(tuple, base->def->key_def,
+				     base->def->opts.hash_func);
+}
+
+/** @sa memtx_hash_index_tuple_hash() */
+static inline uint32_t
+memtx_hash_index_key_hash(struct index *base, const char *key)
+{
+	return key_hash_by_version(key, base->def->key_def,
+				   base->def->opts.hash_func);
+}
+
 /* {{{ MemtxHash Iterators ****************************************/
 
 struct hash_iterator {
@@ -191,13 +211,71 @@ memtx_hash_index_get(struct index *base, const char *key,
 	(void) part_count;
 
 	*result = NULL;
-	uint32_t h = key_hash(key, base->def->key_def);
+	uint32_t h = memtx_hash_index_key_hash(base, key);
 	uint32_t k = light_index_find_key(index->hash_table, h, key);
 	if (k != light_index_end)
 		*result = light_index_get(index->hash_table, k);
 	return 0;
 }
 
+/**
+ * Batched lookups are pipelined: while the key at position i
+ * is hashed and its bucket is prefetched, the tuple found in
+ * the bucket of key i - GET_MANY_STEP is prefetched and key
+ * i - 2 * GET_MANY_STEP is compared with the tuple, which is
+ * hopefully in cache by then. This way cache misses of
+ * neighbouring keys overlap instead of being paid one by one.
+ */
+enum {
+	/** Distance between stages of the lookup pipeline. */
+	GET_MANY_STEP = 4,
+	/** Size of the ring of computed hashes, power of 2. */
+	GET_MANY_HASH_RING = 16,
+};
+
+static int
+memtx_hash_index_get_many(struct index *base, const char **keys,
+			  uint32_t count, struct tuple **result)
+{
+	struct memtx_hash_index *index = (struct memtx_hash_index *)base;
+	struct light_index_core *hash_table = index->hash_table;
+	assert(base->def->opts.is_unique);
+
+	uint32_t hashes[GET_MANY_HASH_RING];
+	const uint32_t mask = GET_MANY_HASH_RING - 1;
+	for (uint32_t i = 0; i < count + 2 * GET_MANY_STEP; i++) {
+		if (i < count) {
+			uint32_t h = memtx_hash_index_key_hash(base, keys[i]);
+			hashes[i & mask] = h;
+			light_index_prefetch(hash_table, h);
+		}
+		if (i >= GET_MANY_STEP && i - GET_MANY_STEP < count) {
+			uint32_t j = i - GET_MANY_STEP;
+			struct tuple *const *tuple =
+				light_index_peek(hash_table, hashes[j & mask]);
+			if (tuple != NULL)
+				prefetch(*tuple, 0);
+		}
+		if (i < 2 * GET_MANY_STEP)
+			continue;
+		uint32_t j = i - 2 * GET_MANY_STEP;
+		struct tuple *tuple = NULL;
+		uint32_t k = light_index_find_key(hash_table,
+						  hashes[j & mask], keys[j]);
+		if (k != light_index_end)
+			tuple = light_index_get(hash_table, k);
+		if (tuple != NULL && tuple_ref(tuple) != 0) {
+			while (j-- > 0) {
+				if (result[j] != NULL)
+					tuple_unref(result[j]);
+			}
+			return -1;
+		}
+		result[j] = tuple;
+	}
+	return 0;
+}
+
 static int
 memtx_hash_index_replace(struct index *base, struct tuple *old_tuple,
 			 struct tuple *new_tuple, enum dup_replace_mode mode,
@@ -207,7 +285,7 @@ memtx_hash_index_replace(struct index *base, struct tuple *old_tuple,
 	struct light_index_core *hash_table = index->hash_table;
 
 	if (new_tuple) {
-		uint32_t h = tuple_hash(new_tuple, base->def->key_def);
+		uint32_t h = memtx_hash_index_tuple_hash(base, new_tuple);
 		struct tuple *dup_tuple = NULL;
 		hash_t pos = light_index_replace(hash_table, h, new_tuple, &dup_tuple);
 		if (pos == light_index_end)
@@ -249,7 +327,7 @@ memtx_hash_index_replace(struct index *base, struct tuple *old_tuple,
 	}
 
 	if (old_tuple) {
-		uint32_t h = tuple_hash(old_tuple, base->def->key_def);
+		uint32_t h = memtx_hash_index_tuple_hash(base, old_tuple);
 		int res = light_index_delete_value(hash_table, h, old_tuple);
 		assert(res == 0); (void) res;
 	}
@@ -282,7 +360,8 @@ memtx_hash_index_create_iterator(struct index *base, enum iterator_type type,
 	case ITER_GT:
 		if (part_count != 0) {
 			light_index_iterator_key(it->hash_table, &it->iterator,
-					key_hash(key, base->def->key_def), key);
+					memtx_hash_index_key_hash(base, key),
+					key);
 			it->base.next = hash_iterator_gt;
 		} else {
 			light_index_iterator_begin(it->hash_table, &it->iterator);
@@ -296,7 +375,7 @@ memtx_hash_index_create_iterator(struct index *base, enum iterator_type type,
 	case ITER_EQ:
 		assert(part_count > 0);
 		light_index_iterator_key(it->hash_table, &it->iterator,
-				key_hash(key, base->def->key_def), key);
+				memtx_hash_index_key_hash(base, key), key);
 		it->base.next = hash_iterator_eq;
 		break;
 	default:
@@ -383,6 +462,7 @@ static const struct index_vtab memtx_hash_index_vtab = {
 	/* .random = */ memtx_hash_index_random,
 	/* .count = */ memtx_hash_index_count,
 	/* .get = */ memtx_hash_index_get,
+	/* .get_many = */ memtx_hash_index_get_many,
 	/* .replace = */ memtx_hash_index_replace,
 	/* .create_iterator = */ memtx_hash_index_create_iterator,
 	/* .create_snapshot_iterator = */
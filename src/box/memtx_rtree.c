@@ -292,6 +292,40 @@ memtx_rtree_index_begin_build(struct index *base)
 	rtree_purge(&index->tree);
 }
 
+static int
+memtx_rtree_index_reserve(struct index *base, uint32_t size_hint)
+{
+	struct memtx_rtree_index *index = (struct memtx_rtree_index *)base;
+	if (rtree_build_reserve(&index->tree, size_hint) != 0) {
+		diag_set(OutOfMemory, size_hint * index->tree.page_branch_size,
+			 "memtx_rtree_index", "reserve");
+		return -1;
+	}
+	return 0;
+}
+
+static int
+memtx_rtree_index_build_next(struct index *base, struct tuple *tuple)
+{
+	struct memtx_rtree_index *index = (struct memtx_rtree_index *)base;
+	struct rtree_rect rect;
+	if (extract_rectangle(&rect, tuple, base->def) != 0)
+		return -1;
+	if (rtree_build_add(&index->tree, &rect, tuple) != 0) {
+		diag_set(OutOfMemory, index->tree.page_branch_size,
+			 "memtx_rtree_index", "build_next");
+		return -1;
+	}
+	return 0;
+}
+
+static void
+memtx_rtree_index_end_build(struct index *base)
+{
+	struct memtx_rtree_index *index = (struct memtx_rtree_index *)base;
+	rtree_build_end(&index->tree);
+}
+
 static const struct index_vtab memtx_rtree_index_vtab = {
 	/* .destroy = */ memtx_rtree_index_destroy,
 	/* .commit_create = */ generic_index_commit_create,
@@ -303,15 +337,16 @@ static const struct index_vtab memtx_rtree_index_vtab = {
 	/* .random = */ generic_index_random,
 	/* .count = */ memtx_rtree_index_count,
 	/* .get = */ memtx_rtree_index_get,
+	/* .get_many = */ generic_index_get_many,
 	/* .replace = */ memtx_rtree_index_replace,
 	/* .create_iterator = */ memtx_rtree_index_create_iterator,
 	/* .create_snapshot_iterator = */
 		generic_index_create_snapshot_iterator,
 	/* .info = */ generic_index_info,
 	/* .begin_build = */ memtx_rtree_index_begin_build,
-	/* .reserve = */ generic_index_reserve,
-	/* .build_next = */ generic_index_build_next,
-	/* .end_build = */ generic_index_end_build,
+	/* .reserve = */ memtx_rtree_index_reserve,
+	/* .build_next = */ memtx_rtree_index_build_next,
+	/* .end_build = */ memtx_rtree_index_end_build,
 };
 
 struct memtx_rtree_index *
@@ -42,6 +42,19 @@
 #include "memtx_tuple.h"
 #include "column_mask.h"
 #include "sequence.h"
+#include "memtx_engine.h"
+#include <rmean.h>
+
+/**
+ * Undo record of an UPDATE executed in place, stored in
+ * txn_stmt::engine_savepoint.
+ */
+struct memtx_update_undo {
+	/** Patches restoring the old field values. */
+	struct tuple_update_patch *patches;
+	/** Number of patches. */
+	uint32_t patch_count;
+};
 
 static void
 memtx_space_destroy(struct space *space)
@@ -352,6 +365,183 @@ memtx_space_execute_delete(struct space *space, struct txn *txn,
 	return 0;
 }
 
+/**
+ * Check if an UPDATE may patch the old tuple in place instead of
+ * creating a new tuple. The old tuple must not be referenced by
+ * anyone but the space, including on_replace triggers and
+ * snapshots, and the update must not change indexed fields, so
+ * that indexes don't need to be changed.
+ */
+static bool
+memtx_space_can_update_in_place(struct space *space, struct tuple *tuple,
+				uint64_t column_mask)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	if (memtx_space->replace != memtx_space_replace_all_keys &&
+	    memtx_space->replace != memtx_space_replace_primary_key)
+		return false;
+	if (tuple->refs > 1 || !rlist_empty(&space->on_replace) ||
+	    !memtx_tuple_is_mutable(tuple))
+		return false;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		struct key_def *cmp_def = space->index[i]->def->cmp_def;
+		if (!key_update_can_be_skipped(cmp_def->column_mask,
+					       column_mask))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Execute an UPDATE, which only changes the values of existing
+ * fields keeping their sizes, by patching a copy of the old
+ * tuple: there is no need to build the new tuple field by field
+ * and to decode it to fill the field map. If possible, the old
+ * tuple is patched in place, see
+ * memtx_space_can_update_in_place(). Its old field values are
+ * saved to the statement to be restored on rollback.
+ *
+ * @retval  0 Success, the new tuple is in stmt->new_tuple.
+ * @retval  1 The update can't be executed this way.
+ * @retval -1 Error.
+ */
+static int
+memtx_space_update_patch(struct space *space, struct txn_stmt *stmt,
+			 struct request *request)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	struct tuple *old_tuple = stmt->old_tuple;
+	/* The field map of the copy must match the space format. */
+	struct tuple_format *format = tuple_format(old_tuple);
+	if (format != space->format)
+		return 1;
+	uint32_t bsize;
+	const char *old_data = tuple_data_range(old_tuple, &bsize);
+	struct tuple_update_patch *patches;
+	uint32_t patch_count;
+	uint64_t column_mask;
+	int rc = tuple_update_patch(region_aligned_alloc_cb, &fiber()->gc,
+				    request->tuple, request->tuple_end,
+				    old_data, old_data + bsize,
+				    request->index_base, &patches,
+				    &patch_count, &column_mask);
+	if (rc != 0)
+		return rc;
+	uint32_t patch_size = 0;
+	for (uint32_t i = 0; i < patch_count; i++) {
+		struct tuple_update_patch *patch = &patches[i];
+		patch_size += patch->size;
+		if (patch->fieldno >= format->field_count)
+			continue;
+		const struct tuple_field *field =
+			&format->fields[patch->fieldno];
+		/* Offsets of indexed nested values may change. */
+		if (field->has_paths)
+			return 1;
+		if (key_mp_type_validate(field->type,
+					 mp_typeof(*patch->value),
+					 ER_FIELD_TYPE,
+					 patch->fieldno + TUPLE_INDEX_BASE,
+					 field->is_nullable) != 0)
+			return -1;
+	}
+
+	if (memtx_space_can_update_in_place(space, old_tuple, column_mask)) {
+		/*
+		 * Save the old values in place of the new ones
+		 * applied to the tuple, so that the patches can
+		 * be used to undo the update.
+		 */
+		struct memtx_update_undo *undo =
+			region_alloc_object(&fiber()->gc,
+					    struct memtx_update_undo);
+		char *old_values = (char *) region_alloc(&fiber()->gc,
+							 patch_size);
+		if (undo == NULL || (old_values == NULL && patch_size > 0)) {
+			diag_set(OutOfMemory, patch_size, "region",
+				 "struct memtx_update_undo");
+			return -1;
+		}
+		char *data = (char *) old_data;
+		for (uint32_t i = 0; i < patch_count; i++) {
+			struct tuple_update_patch *patch = &patches[i];
+			memcpy(old_values, data + patch->offset, patch->size);
+			memcpy(data + patch->offset, patch->value,
+			       patch->size);
+			patch->value = old_values;
+			old_values += patch->size;
+		}
+		undo->patches = patches;
+		undo->patch_count = patch_count;
+		tuple_ref(old_tuple);
+		stmt->new_tuple = old_tuple;
+		stmt->engine_savepoint = undo;
+		rmean_collect(rmean_memtx, MEMTX_STAT_UPDATE_IN_PLACE, 1);
+		return 0;
+	}
+
+	stmt->new_tuple = memtx_tuple_dup(old_tuple);
+	if (stmt->new_tuple == NULL)
+		return -1;
+	tuple_ref(stmt->new_tuple);
+	char *data = (char *) tuple_data(stmt->new_tuple);
+	for (uint32_t i = 0; i < patch_count; i++) {
+		struct tuple_update_patch *patch = &patches[i];
+		memcpy(data + patch->offset, patch->value, patch->size);
+	}
+	if (memtx_space->replace(space, stmt, DUP_REPLACE) != 0)
+		return -1;
+	rmean_collect(rmean_memtx, MEMTX_STAT_UPDATE_PATCH, 1);
+	return 0;
+}
+
+void
+memtx_space_undo_update_in_place(struct txn_stmt *stmt)
+{
+	assert(stmt->old_tuple == stmt->new_tuple);
+	struct memtx_update_undo *undo =
+		(struct memtx_update_undo *) stmt->engine_savepoint;
+	char *data = (char *) tuple_data(stmt->old_tuple);
+	for (uint32_t i = 0; i < undo->patch_count; i++) {
+		struct tuple_update_patch *patch = &undo->patches[i];
+		memcpy(data + patch->offset, patch->value, patch->size);
+	}
+}
+
+int
+memtx_space_relocate_tuple(struct space *space, struct tuple *tuple)
+{
+	struct memtx_space *memtx_space = (struct memtx_space *)space;
+	/*
+	 * Don't move tuples referenced from anywhere but the
+	 * space, e.g. from Lua or a tree iterator, nor tuples
+	 * which may be read by a snapshot.
+	 */
+	if (memtx_space->replace != memtx_space_replace_all_keys ||
+	    tuple->refs > 1 || !memtx_tuple_is_mutable(tuple))
+		return 1;
+	struct tuple *copy = memtx_tuple_dup(tuple);
+	if (copy == NULL)
+		return -1;
+	if (copy > tuple) {
+		memtx_tuple_delete(tuple_format(copy), copy);
+		return 1;
+	}
+	struct txn_stmt stmt;
+	memset(&stmt, 0, sizeof(stmt));
+	stmt.space = space;
+	stmt.old_tuple = tuple;
+	stmt.new_tuple = copy;
+	if (memtx_space->replace(space, &stmt, DUP_REPLACE) != 0) {
+		memtx_tuple_delete(tuple_format(copy), copy);
+		return -1;
+	}
+	assert(stmt.old_tuple == tuple);
+	tuple_ref(copy);
+	tuple_unref(tuple);
+	return 0;
+}
+
 static int
 memtx_space_execute_update(struct space *space, struct txn *txn,
 			   struct request *request, struct tuple **result)
@@ -374,6 +564,14 @@ memtx_space_execute_update(struct space *space, struct txn *txn,
 		return 0;
 	}
 
+	int rc = memtx_space_update_patch(space, stmt, request);
+	if (rc < 0)
+		return -1;
+	if (rc == 0) {
+		*result = stmt->new_tuple;
+		return 0;
+	}
+
 	/* Update the tuple; legacy, request ops are in request->tuple */
 	uint32_t new_size = 0, bsize;
 	const char *old_data = tuple_data_range(stmt->old_tuple, &bsize);
@@ -530,6 +728,31 @@ memtx_space_check_index_def(struct space *space, struct index_def *index_def)
 			return -1;
 		}
 	}
+	if (index_def->opts.rank && index_def->type != TREE) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "rank is supported only by TREE index");
+		return -1;
+	}
+	if (index_def->opts.covering && index_def->type != TREE) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "covering is supported only by TREE index");
+		return -1;
+	}
+	if (index_def->opts.hash_func != TUPLE_HASH_MURMUR &&
+	    index_def->type != HASH) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "hash_func is supported only by HASH index");
+		return -1;
+	}
+	if (index_def->key_def->has_json_paths && index_def->type != TREE) {
+		diag_set(ClientError, ER_MODIFY_INDEX,
+			 index_def->name, space_name(space),
+			 "JSON paths are supported only by TREE index");
+		return -1;
+	}
 	switch (index_def->type) {
 	case HASH:
 		if (! index_def->opts.is_unique) {
@@ -939,6 +1162,11 @@ memtx_space_new(struct memtx_engine *memtx,
 		free(memtx_space);
 		return NULL;
 	}
+	if (tuple_format_add_offset_slots(format, def->opts.field_map) != 0) {
+		tuple_format_delete(format);
+		free(memtx_space);
+		return NULL;
+	}
 	format->exact_field_count = def->exact_field_count;
 	tuple_format_ref(format);
 
@@ -64,6 +64,30 @@ memtx_space_update_bsize(struct space *space,
 			 const struct tuple *old_tuple,
 			 const struct tuple *new_tuple);
 
+/**
+ * Restore the old tuple of an UPDATE executed in place, i.e.
+ * when stmt->old_tuple == stmt->new_tuple. Used on rollback.
+ */
+void
+memtx_space_undo_update_in_place(struct txn_stmt *stmt);
+
+/**
+ * Move a tuple of a space to a lower address in the arena,
+ * replacing it in all indexes of the space with a copy. The
+ * allocator takes free slots from the slab with the lowest
+ * address first, so relocating tuples drains slabs at the top
+ * of the arena and gives them back to the slab cache.
+ *
+ * The tuple must not be used by a transaction in progress.
+ *
+ * @retval  0 The tuple was relocated and freed.
+ * @retval  1 The tuple can't be relocated or the copy isn't
+ *            located lower, nothing is done.
+ * @retval -1 Error.
+ */
+int
+memtx_space_relocate_tuple(struct space *space, struct tuple *tuple);
+
 int
 memtx_space_replace_no_keys(struct space *, struct txn_stmt *,
 			    enum dup_replace_mode);
@@ -30,6 +30,9 @@
  */
 #include "memtx_tree.h"
 #include "memtx_engine.h"
+#include "index.h"
+#include "tuple_compare.h"
+#include "memtx_tuple.h"
 #include "space.h"
 #include "schema.h" /* space_cache_find() */
 #include "errinj.h"
@@ -38,583 +41,256 @@
 #include <third_party/qsort_arg.h>
 #include <small/mempool.h>
 
-/* {{{ Utilities. *************************************************/
-
-static int
-memtx_tree_qcompare(const void* a, const void *b, void *c)
+/**
+ * Struct that is used as a key in BPS tree definition.
+ */
+struct memtx_tree_key_data
 {
-	return tuple_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct key_def *)c);
-}
-
-/* {{{ MemtxTree Iterators ****************************************/
-struct tree_iterator {
-	struct iterator base;
-	const struct memtx_tree *tree;
-	struct index_def *index_def;
-	struct memtx_tree_iterator tree_iterator;
-	enum iterator_type type;
-	struct memtx_tree_key_data key_data;
-	struct tuple *current_tuple;
-	/** Memory pool the iterator was allocated from. */
-	struct mempool *pool;
+	/** Sequence of msgpacked search fields */
+	const char *key;
+	/** Number of msgpacked search fields */
+	uint32_t part_count;
 };
 
-static void
-tree_iterator_free(struct iterator *iterator);
-
-static inline struct tree_iterator *
-tree_iterator(struct iterator *it)
-{
-	assert(it->free == tree_iterator_free);
-	return (struct tree_iterator *) it;
-}
-
-static void
-tree_iterator_free(struct iterator *iterator)
-{
-	struct tree_iterator *it = tree_iterator(iterator);
-	if (it->current_tuple != NULL)
-		tuple_unref(it->current_tuple);
-	mempool_free(it->pool, it);
-}
-
-static int
-tree_iterator_dummie(struct iterator *iterator, struct tuple **ret)
-{
-	(void)iterator;
-	*ret = NULL;
-	return 0;
-}
-
-static int
-tree_iterator_next(struct iterator *iterator, struct tuple **ret)
-{
-	struct tuple **res;
-	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
-		it->tree_iterator =
-			memtx_tree_upper_bound_elem(it->tree, it->current_tuple,
-						    NULL);
-	else
-		memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
-	res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
-	if (res == NULL) {
-		iterator->next = tree_iterator_dummie;
-		*ret = NULL;
-	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
-	}
-	return 0;
-}
-
-static int
-tree_iterator_prev(struct iterator *iterator, struct tuple **ret)
-{
-	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
-		it->tree_iterator =
-			memtx_tree_lower_bound_elem(it->tree, it->current_tuple,
-						    NULL);
-	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
-	if (!res) {
-		iterator->next = tree_iterator_dummie;
-		*ret = NULL;
-	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
-	}
-	return 0;
-}
+enum {
+	/**
+	 * Max size of a key copy stored in a tree element.
+	 * Chosen so that the element takes 32 bytes.
+	 */
+	MEMTX_TREE_KEY_INLINE_SIZE = 20,
+};
 
-static int
-tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
-{
-	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
-		it->tree_iterator =
-			memtx_tree_upper_bound_elem(it->tree, it->current_tuple,
-						    NULL);
-	else
-		memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	/* Use user key def to save a few loops. */
-	if (!res || memtx_tree_compare_key(*res, &it->key_data,
-					   it->index_def->key_def) != 0) {
-		iterator->next = tree_iterator_dummie;
-		*ret = NULL;
-	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
-	}
-	return 0;
-}
+/**
+ * Element of a covering or multikey TREE index: a tuple with
+ * a copy of the tuple fields indexed by the tree key definition,
+ * see memtx_tuple_key_new(). Covering indexes compare the copies
+ * instead of tuples, multikey indexes tell elements of the same
+ * tuple by them.
+ */
+struct memtx_tree_key_elem {
+	/** Indexed tuple. */
+	struct tuple *tuple;
+	/**
+	 * Size of the key copy. 0 if there is no copy, which
+	 * happens in a covering index if there was not enough
+	 * memory to allocate it. The fields are read from the
+	 * tuple then.
+	 */
+	uint32_t key_size;
+	/**
+	 * The key copy if it fits, a pointer to the copy
+	 * allocated with memtx_tuple_key_new() otherwise.
+	 */
+	char key[MEMTX_TREE_KEY_INLINE_SIZE];
+};
 
-static int
-tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
+/** Return the key copy of a tree element. */
+static inline const char *
+memtx_tree_key_elem_key(const struct memtx_tree_key_elem *elem)
 {
-	struct tree_iterator *it = tree_iterator(iterator);
-	assert(it->current_tuple != NULL);
-	struct tuple **check = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	if (check == NULL || *check != it->current_tuple)
-		it->tree_iterator =
-			memtx_tree_lower_bound_elem(it->tree, it->current_tuple,
-						    NULL);
-	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	tuple_unref(it->current_tuple);
-	it->current_tuple = NULL;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	/* Use user key def to save a few loops. */
-	if (!res || memtx_tree_compare_key(*res, &it->key_data,
-					   it->index_def->key_def) != 0) {
-		iterator->next = tree_iterator_dummie;
-		*ret = NULL;
-	} else {
-		*ret = it->current_tuple = *res;
-		tuple_ref(it->current_tuple);
-	}
-	return 0;
+	assert(elem->key_size != 0);
+	if (elem->key_size <= MEMTX_TREE_KEY_INLINE_SIZE)
+		return elem->key;
+	const char *key;
+	memcpy(&key, elem->key, sizeof(key));
+	return key;
 }
 
-static void
-tree_iterator_set_next_method(struct tree_iterator *it)
+/**
+ * Return the size of memory allocated for the key copy of
+ * a tree element out of the element.
+ */
+static inline uint32_t
+memtx_tree_key_elem_copy_size(const struct memtx_tree_key_elem *elem)
 {
-	assert(it->current_tuple != NULL);
-	switch (it->type) {
-	case ITER_EQ:
-		it->base.next = tree_iterator_next_equal;
-		break;
-	case ITER_REQ:
-		it->base.next = tree_iterator_prev_equal;
-		break;
-	case ITER_ALL:
-		it->base.next = tree_iterator_next;
-		break;
-	case ITER_LT:
-	case ITER_LE:
-		it->base.next = tree_iterator_prev;
-		break;
-	case ITER_GE:
-	case ITER_GT:
-		it->base.next = tree_iterator_next;
-		break;
-	default:
-		/* The type was checked in initIterator */
-		assert(false);
-	}
+	return elem->key_size > MEMTX_TREE_KEY_INLINE_SIZE ?
+	       elem->key_size : 0;
 }
 
-static int
-tree_iterator_start(struct iterator *iterator, struct tuple **ret)
+/**
+ * Make a tree element for the key number @a multikey_idx of
+ * a tuple. Return -1 and set @a size to the size of the key copy
+ * if it could not be allocated, in which case the element has
+ * no key copy.
+ */
+static inline int
+memtx_tree_key_elem_create(struct memtx_tree_key_elem *elem,
+			   struct tuple *tuple, struct key_def *def,
+			   int multikey_idx, uint32_t *size)
 {
-	*ret = NULL;
-	struct tree_iterator *it = tree_iterator(iterator);
-	it->base.next = tree_iterator_dummie;
-	const struct memtx_tree *tree = it->tree;
-	enum iterator_type type = it->type;
-	bool exact = false;
-	assert(it->current_tuple == NULL);
-	if (it->key_data.key == 0) {
-		if (iterator_type_is_reverse(it->type))
-			it->tree_iterator = memtx_tree_iterator_last(tree);
-		else
-			it->tree_iterator = memtx_tree_iterator_first(tree);
+	elem->tuple = tuple;
+	elem->key_size = 0;
+	*size = memtx_tuple_key_size(tuple, def, multikey_idx);
+	if (*size <= MEMTX_TREE_KEY_INLINE_SIZE) {
+		memtx_tuple_key_encode(elem->key, tuple, def, multikey_idx);
 	} else {
-		if (type == ITER_ALL || type == ITER_EQ ||
-		    type == ITER_GE || type == ITER_LT) {
-			it->tree_iterator =
-				memtx_tree_lower_bound(tree, &it->key_data,
-						       &exact);
-			if (type == ITER_EQ && !exact)
-				return 0;
-		} else { // ITER_GT, ITER_REQ, ITER_LE
-			it->tree_iterator =
-				memtx_tree_upper_bound(tree, &it->key_data,
-						       &exact);
-			if (type == ITER_REQ && !exact)
-				return 0;
-		}
-		if (iterator_type_is_reverse(type)) {
-			/*
-			 * Because of limitations of tree search API we use use
-			 * lower_bound for LT search and upper_bound for LE
-			 * and REQ searches. Thus we found position to the
-			 * right of the target one. Let's make a step to the
-			 * left to reach target position.
-			 * If we found an invalid iterator all the elements in
-			 * the tree are less (less or equal) to the key, and
-			 * iterator_next call will convert the iterator to the
-			 * last position in the tree, that's what we need.
-			 */
-			memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-		}
-	}
-
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	if (!res)
-		return 0;
-	*ret = it->current_tuple = *res;
-	tuple_ref(it->current_tuple);
-	tree_iterator_set_next_method(it);
-	return 0;
-}
-
-/* }}} */
-
-/* {{{ MemtxTree  **********************************************************/
-
-static void
-memtx_tree_index_destroy(struct index *base)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	memtx_tree_destroy(&index->tree);
-	free(index->build_array);
-	free(index);
-}
-
-static ssize_t
-memtx_tree_index_size(struct index *base)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	return memtx_tree_size(&index->tree);
-}
-
-static ssize_t
-memtx_tree_index_bsize(struct index *base)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	return memtx_tree_mem_used(&index->tree);
-}
-
-static int
-memtx_tree_index_random(struct index *base, uint32_t rnd, struct tuple **result)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	struct tuple **res = memtx_tree_random(&index->tree, rnd);
-	*result = res != NULL ? *res : NULL;
-	return 0;
-}
-
-static ssize_t
-memtx_tree_index_count(struct index *base, enum iterator_type type,
-		       const char *key, uint32_t part_count)
-{
-	if (type == ITER_ALL)
-		return memtx_tree_index_size(base); /* optimization */
-	return generic_index_count(base, type, key, part_count);
-}
-
-static int
-memtx_tree_index_get(struct index *base, const char *key,
-		     uint32_t part_count, struct tuple **result)
-{
-	assert(base->def->opts.is_unique &&
-	       part_count == base->def->key_def->part_count);
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	struct memtx_tree_key_data key_data;
-	key_data.key = key;
-	key_data.part_count = part_count;
-	struct tuple **res = memtx_tree_find(&index->tree, &key_data);
-	*result = res != NULL ? *res : NULL;
-	return 0;
-}
-
-static int
-memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
-			 struct tuple *new_tuple, enum dup_replace_mode mode,
-			 struct tuple **result)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
-
-		/* Try to optimistically replace the new_tuple. */
-		int tree_res = memtx_tree_insert(&index->tree,
-						 new_tuple, &dup_tuple);
-		if (tree_res) {
-			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
-				 "memtx_tree_index", "replace");
-			return -1;
-		}
-
-		uint32_t errcode = replace_check_dup(old_tuple,
-						     dup_tuple, mode);
-		if (errcode) {
-			memtx_tree_delete(&index->tree, new_tuple);
-			if (dup_tuple)
-				memtx_tree_insert(&index->tree, dup_tuple, 0);
-			struct space *sp = space_cache_find(base->def->space_id);
-			if (sp != NULL)
-				diag_set(ClientError, errcode, base->def->name,
-					 space_name(sp));
+		char *key = memtx_tuple_key_new(tuple, def, multikey_idx,
+						size);
+		if (key == NULL)
 			return -1;
-		}
-		if (dup_tuple) {
-			*result = dup_tuple;
-			return 0;
-		}
+		memcpy(elem->key, &key, sizeof(key));
 	}
-	if (old_tuple) {
-		memtx_tree_delete(&index->tree, old_tuple);
-	}
-	*result = old_tuple;
+	elem->key_size = *size;
 	return 0;
 }
 
-static struct iterator *
-memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
-				 const char *key, uint32_t part_count)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
-
-	assert(part_count == 0 || key != NULL);
-	if (type > ITER_GT) {
-		diag_set(UnsupportedIndexFeature, base->def,
-			 "requested iterator type");
-		return NULL;
-	}
-
-	if (part_count == 0) {
-		/*
-		 * If no key is specified, downgrade equality
-		 * iterators to a full range.
-		 */
-		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
-		key = NULL;
-	}
-
-	struct tree_iterator *it = mempool_alloc(&memtx->tree_iterator_pool);
-	if (it == NULL) {
-		diag_set(OutOfMemory, sizeof(struct tree_iterator),
-			 "memtx_tree_index", "iterator");
-		return NULL;
-	}
-	iterator_create(&it->base, base);
-	it->pool = &memtx->tree_iterator_pool;
-	it->base.next = tree_iterator_start;
-	it->base.free = tree_iterator_free;
-	it->type = type;
-	it->key_data.key = key;
-	it->key_data.part_count = part_count;
-	it->index_def = base->def;
-	it->tree = &index->tree;
-	it->tree_iterator = memtx_tree_invalid_iterator();
-	it->current_tuple = NULL;
-	return (struct iterator *)it;
-}
-
-static void
-memtx_tree_index_begin_build(struct index *base)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	assert(memtx_tree_size(&index->tree) == 0);
-	(void)index;
-}
-
-static int
-memtx_tree_index_reserve(struct index *base, uint32_t size_hint)
+/**
+ * Make a tree element to look up the key number @a multikey_idx
+ * of a tuple, allocating the key copy on @a region if it does
+ * not fit in the element.
+ */
+static inline int
+memtx_tree_key_elem_create_on_region(struct memtx_tree_key_elem *elem,
+				     struct tuple *tuple, struct key_def *def,
+				     int multikey_idx, struct region *region)
 {
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	if (size_hint < index->build_array_alloc_size)
+	uint32_t size = memtx_tuple_key_size(tuple, def, multikey_idx);
+	elem->tuple = tuple;
+	elem->key_size = size;
+	if (size <= MEMTX_TREE_KEY_INLINE_SIZE) {
+		memtx_tuple_key_encode(elem->key, tuple, def, multikey_idx);
 		return 0;
-	struct tuple **tmp = (struct tuple **)realloc(index->build_array,
-						      size_hint * sizeof(*tmp));
-	if (tmp == NULL) {
-		diag_set(OutOfMemory, size_hint * sizeof(*tmp),
-			 "memtx_tree_index", "reserve");
-		return -1;
 	}
-	index->build_array = tmp;
-	index->build_array_alloc_size = size_hint;
-	return 0;
-}
-
-static int
-memtx_tree_index_build_next(struct index *base, struct tuple *tuple)
-{
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	if (index->build_array == NULL) {
-		index->build_array = (struct tuple **)malloc(MEMTX_EXTENT_SIZE);
-		if (index->build_array == NULL) {
-			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
-				 "memtx_tree_index", "build_next");
-			return -1;
-		}
-		index->build_array_alloc_size =
-			MEMTX_EXTENT_SIZE / sizeof(struct tuple*);
-	}
-	assert(index->build_array_size <= index->build_array_alloc_size);
-	if (index->build_array_size == index->build_array_alloc_size) {
-		index->build_array_alloc_size = index->build_array_alloc_size +
-					index->build_array_alloc_size / 2;
-		struct tuple **tmp = (struct tuple **)
-			realloc(index->build_array,
-				index->build_array_alloc_size * sizeof(*tmp));
-		if (tmp == NULL) {
-			diag_set(OutOfMemory, index->build_array_alloc_size *
-				 sizeof(*tmp), "memtx_tree_index", "build_next");
-			return -1;
-		}
-		index->build_array = tmp;
+	char *key = (char *)region_alloc(region, size);
+	if (key == NULL) {
+		diag_set(OutOfMemory, size, "region", "key");
+		return -1;
 	}
-	index->build_array[index->build_array_size++] = tuple;
+	memtx_tuple_key_encode(key, tuple, def, multikey_idx);
+	memcpy(elem->key, &key, sizeof(key));
 	return 0;
 }
 
-static void
-memtx_tree_index_end_build(struct index *base)
+/**
+ * Free the key copy of a tree element, if any. Return the size
+ * of freed memory allocated out of the element.
+ */
+static inline uint32_t
+memtx_tree_key_elem_destroy(struct memtx_tree_key_elem *elem)
 {
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	/** Use extended key def only for non-unique indexes. */
-	struct key_def *cmp_def = base->def->opts.is_unique ?
-			base->def->key_def : base->def->cmp_def;
-	qsort_arg(index->build_array, index->build_array_size,
-		  sizeof(struct tuple *),
-		  memtx_tree_qcompare, cmp_def);
-	memtx_tree_build(&index->tree, index->build_array,
-			 index->build_array_size);
-
-	free(index->build_array);
-	index->build_array = NULL;
-	index->build_array_size = 0;
-	index->build_array_alloc_size = 0;
+	uint32_t size = memtx_tree_key_elem_copy_size(elem);
+	if (size > 0)
+		memtx_tuple_key_delete((char *)memtx_tree_key_elem_key(elem),
+				       size);
+	elem->key_size = 0;
+	return size;
 }
 
-struct tree_snapshot_iterator {
-	struct snapshot_iterator base;
-	struct memtx_tree *tree;
-	struct memtx_tree_iterator tree_iterator;
-};
-
-static void
-tree_snapshot_iterator_free(struct snapshot_iterator *iterator)
+/** Check if two tree elements are the same. */
+static inline bool
+memtx_tree_key_elem_is_identical(struct memtx_tree_key_elem a,
+				 struct memtx_tree_key_elem b)
 {
-	assert(iterator->free == tree_snapshot_iterator_free);
-	struct tree_snapshot_iterator *it =
-		(struct tree_snapshot_iterator *)iterator;
-	struct memtx_tree *tree = (struct memtx_tree *)it->tree;
-	memtx_tree_iterator_destroy(tree, &it->tree_iterator);
-	free(iterator);
+	return a.tuple == b.tuple && a.key_size == b.key_size &&
+	       (a.key_size == 0 ||
+		memcmp(memtx_tree_key_elem_key(&a),
+		       memtx_tree_key_elem_key(&b), a.key_size) == 0);
 }
 
-static const char *
-tree_snapshot_iterator_next(struct snapshot_iterator *iterator, uint32_t *size)
+/**
+ * BPS tree element comparator for covering and multikey indexes.
+ * Compares key copies when both elements have them, so that
+ * covering indexes do not touch tuples.
+ * @param a - first element.
+ * @param b - second element.
+ * @param def - key definition.
+ * @retval 0  if a == b in terms of def.
+ * @retval <0 if a < b in terms of def.
+ * @retval >0 if a > b in terms of def.
+ */
+static inline int
+memtx_tree_key_elem_compare(struct memtx_tree_key_elem a,
+			    struct memtx_tree_key_elem b, struct key_def *def)
 {
-	assert(iterator->free == tree_snapshot_iterator_free);
-	struct tree_snapshot_iterator *it =
-		(struct tree_snapshot_iterator *)iterator;
-	struct tuple **res = memtx_tree_iterator_get_elem(it->tree,
-						&it->tree_iterator);
-	if (res == NULL)
-		return NULL;
-	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return tuple_data_range(*res, size);
+	if (a.key_size != 0 && b.key_size != 0) {
+		return extracted_key_compare(memtx_tree_key_elem_key(&a),
+					     memtx_tree_key_elem_key(&b), def);
+	}
+	return tuple_compare(a.tuple, b.tuple, def);
 }
 
 /**
- * Create an ALL iterator with personal read view so further
- * index modifications will not affect the iteration results.
- * Must be destroyed by iterator->free after usage.
+ * BPS tree element vs key comparator for covering and multikey
+ * indexes.
+ * @param elem - element to compare.
+ * @param key_data - key to compare with.
+ * @param def - key definition.
+ * @retval 0  if elem == key in terms of def.
+ * @retval <0 if elem < key in terms of def.
+ * @retval >0 if elem > key in terms of def.
  */
-static struct snapshot_iterator *
-memtx_tree_index_create_snapshot_iterator(struct index *base)
+static inline int
+memtx_tree_key_elem_compare_key(struct memtx_tree_key_elem elem,
+				const struct memtx_tree_key_data *key_data,
+				struct key_def *def)
 {
-	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
-	struct tree_snapshot_iterator *it = (struct tree_snapshot_iterator *)
-		calloc(1, sizeof(*it));
-	if (it == NULL) {
-		diag_set(OutOfMemory, sizeof(struct tree_snapshot_iterator),
-			 "memtx_tree_index", "create_snapshot_iterator");
-		return NULL;
+	if (elem.key_size != 0) {
+		return extracted_key_compare_with_key(
+				memtx_tree_key_elem_key(&elem), key_data->key,
+				key_data->part_count, def);
 	}
-
-	it->base.free = tree_snapshot_iterator_free;
-	it->base.next = tree_snapshot_iterator_next;
-	it->tree = &index->tree;
-	it->tree_iterator = memtx_tree_iterator_first(&index->tree);
-	memtx_tree_iterator_freeze(&index->tree, &it->tree_iterator);
-	return (struct snapshot_iterator *) it;
+	return tuple_compare_with_key(elem.tuple, key_data->key,
+				      key_data->part_count, def);
 }
 
-static const struct index_vtab memtx_tree_index_vtab = {
-	/* .destroy = */ memtx_tree_index_destroy,
-	/* .commit_create = */ generic_index_commit_create,
-	/* .commit_drop = */ generic_index_commit_drop,
-	/* .size = */ memtx_tree_index_size,
-	/* .bsize = */ memtx_tree_index_bsize,
-	/* .min = */ generic_index_min,
-	/* .max = */ generic_index_max,
-	/* .random = */ memtx_tree_index_random,
-	/* .count = */ memtx_tree_index_count,
-	/* .get = */ memtx_tree_index_get,
-	/* .replace = */ memtx_tree_index_replace,
-	/* .create_iterator = */ memtx_tree_index_create_iterator,
-	/* .create_snapshot_iterator = */
-		memtx_tree_index_create_snapshot_iterator,
-	/* .info = */ generic_index_info,
-	/* .begin_build = */ memtx_tree_index_begin_build,
-	/* .reserve = */ memtx_tree_index_reserve,
-	/* .build_next = */ memtx_tree_index_build_next,
-	/* .end_build = */ memtx_tree_index_end_build,
-};
-
-struct memtx_tree_index *
+/*
+ * Tree flavors. An index with the rank option pays for subtree
+ * element counts on every tree modification, so only such
+ * indexes use a tree which maintains them.
+ */
+#define MEMTX_TREE_NAME memtx_tuple_tree
+#define MEMTX_TREE_KEYED 0
+#define MEMTX_TREE_RANK 0
+#include "memtx_tree_impl.h"
+#undef MEMTX_TREE_NAME
+#undef MEMTX_TREE_KEYED
+#undef MEMTX_TREE_RANK
+
+#define MEMTX_TREE_NAME memtx_tuple_rank_tree
+#define MEMTX_TREE_KEYED 0
+#define MEMTX_TREE_RANK 1
+#include "memtx_tree_impl.h"
+#undef MEMTX_TREE_NAME
+#undef MEMTX_TREE_KEYED
+#undef MEMTX_TREE_RANK
+
+#define MEMTX_TREE_NAME memtx_key_tree
+#define MEMTX_TREE_KEYED 1
+#define MEMTX_TREE_RANK 0
+#include "memtx_tree_impl.h"
+#undef MEMTX_TREE_NAME
+#undef MEMTX_TREE_KEYED
+#undef MEMTX_TREE_RANK
+
+#define MEMTX_TREE_NAME memtx_key_rank_tree
+#define MEMTX_TREE_KEYED 1
+#define MEMTX_TREE_RANK 1
+#include "memtx_tree_impl.h"
+#undef MEMTX_TREE_NAME
+#undef MEMTX_TREE_KEYED
+#undef MEMTX_TREE_RANK
+
+struct index *
 memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def)
 {
 	memtx_index_arena_init();
 
 	if (!mempool_is_initialized(&memtx->tree_iterator_pool)) {
+		/* Iterators of all tree flavors share the pool. */
+		size_t size = MAX(
+			MAX(sizeof(struct memtx_tuple_tree_index_iterator),
+			    sizeof(struct memtx_tuple_rank_tree_index_iterator)),
+			MAX(sizeof(struct memtx_key_tree_index_iterator),
+			    sizeof(struct memtx_key_rank_tree_index_iterator)));
 		mempool_create(&memtx->tree_iterator_pool, cord_slab_cache(),
-			       sizeof(struct tree_iterator));
+			       size);
 	}
 
-	struct memtx_tree_index *index =
-		(struct memtx_tree_index *)calloc(1, sizeof(*index));
-	if (index == NULL) {
-		diag_set(OutOfMemory, sizeof(*index),
-			 "malloc", "struct memtx_tree_index");
-		return NULL;
-	}
-	if (index_create(&index->base, (struct engine *)memtx,
-			 &memtx_tree_index_vtab, def) != 0) {
-		free(index);
-		return NULL;
+	bool is_keyed = def->opts.covering || def->key_def->is_multikey;
+	if (def->opts.rank) {
+		return is_keyed ? memtx_key_rank_tree_index_new(memtx, def) :
+				  memtx_tuple_rank_tree_index_new(memtx, def);
 	}
-
-	/**
-	 * Use extended key def for non-unique and nullable
-	 * indexes. Unique, but nullable, index can store
-	 * multiple NULLs. To correctly compare these NULLs
-	 * extended key def must be used. For details @sa
-	 * tuple_compare.cc.
-	 */
-	struct key_def *cmp_def;
-	if (def->opts.is_unique && !def->key_def->is_nullable)
-		cmp_def = index->base.def->key_def;
-	else
-		cmp_def = index->base.def->cmp_def;
-	memtx_tree_create(&index->tree, cmp_def,
-			  memtx_index_extent_alloc,
-			  memtx_index_extent_free, NULL);
-	return index;
+	return is_keyed ? memtx_key_tree_index_new(memtx, def) :
+			  memtx_tuple_tree_index_new(memtx, def);
 }
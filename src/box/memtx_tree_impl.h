@@ -0,0 +1,1416 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Memtx TREE index implementation, instantiated by memtx_tree.c
+ * once per tree flavor. Only include it from there.
+ *
+ * Settings:
+ *
+ * Name of the flavor, prefix of all structures and functions:
+ * #define MEMTX_TREE_NAME memtx_tuple_tree
+ *
+ * 1 if tree elements are struct memtx_tree_key_elem, which carry
+ * a copy of the indexed fields (covering and multikey indexes),
+ * 0 if they are tuple pointers:
+ * #define MEMTX_TREE_KEYED 0
+ *
+ * 1 if the tree keeps subtree element counts in inner blocks,
+ * which gives logarithmic count() and offset (the rank index
+ * option), 0 otherwise:
+ * #define MEMTX_TREE_RANK 0
+ *
+ * The code below is written in terms of the names it would have
+ * if it were not a template: struct memtx_tree, tree_iterator,
+ * memtx_tree_index_replace() etc. They are mapped to the names
+ * of the flavor with the macros right after the tree definition.
+ */
+
+#ifndef MEMTX_TREE_NAME
+#error "MEMTX_TREE_NAME must be defined"
+#endif
+#if !defined(MEMTX_TREE_KEYED) || !defined(MEMTX_TREE_RANK)
+#error "MEMTX_TREE_KEYED and MEMTX_TREE_RANK must be defined"
+#endif
+
+#if MEMTX_TREE_KEYED
+#define memtx_tree_elem_t struct memtx_tree_key_elem
+#define memtx_tree_elem_tuple(elem) ((elem).tuple)
+#define memtx_tree_elem_compare(a, b, def) \
+	memtx_tree_key_elem_compare(a, b, def)
+#define memtx_tree_elem_compare_key(elem, key_data, def) \
+	memtx_tree_key_elem_compare_key(elem, key_data, def)
+#else
+#define memtx_tree_elem_t struct tuple *
+#define memtx_tree_elem_tuple(elem) (elem)
+#define memtx_tree_elem_compare(a, b, def) tuple_compare(a, b, def)
+#define memtx_tree_elem_compare_key(elem, key_data, def) \
+	tuple_compare_with_key(elem, (key_data)->key, \
+			       (key_data)->part_count, def)
+#endif
+
+#define BPS_TREE_NAME MEMTX_TREE_NAME
+#define BPS_TREE_BLOCK_SIZE (512)
+#define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
+#define BPS_TREE_COMPARE(a, b, arg) memtx_tree_elem_compare(a, b, arg)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_elem_compare_key(a, b, arg)
+#define bps_tree_elem_t memtx_tree_elem_t
+#define bps_tree_key_t struct memtx_tree_key_data *
+#define bps_tree_arg_t struct key_def *
+#if MEMTX_TREE_KEYED
+#define BPS_TREE_IS_IDENTICAL(a, b) memtx_tree_key_elem_is_identical(a, b)
+#endif
+#if MEMTX_TREE_RANK
+#define BPS_INNER_CARD
+#endif
+
+#include "salad/bps_tree.h"
+
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef BPS_TREE_IS_IDENTICAL
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+#undef BPS_INNER_CARD
+
+/* {{{ Names of the flavor */
+#define _memtx_tree(postfix) CONCAT3(MEMTX_TREE_NAME, _, postfix)
+
+#define memtx_tree MEMTX_TREE_NAME
+#define memtx_tree_iterator _memtx_tree(iterator)
+#define memtx_tree_create _memtx_tree(create)
+#define memtx_tree_destroy _memtx_tree(destroy)
+#define memtx_tree_build _memtx_tree(build)
+#define memtx_tree_size _memtx_tree(size)
+#define memtx_tree_mem_used _memtx_tree(mem_used)
+#define memtx_tree_random _memtx_tree(random)
+#define memtx_tree_find _memtx_tree(find)
+#define memtx_tree_insert _memtx_tree(insert)
+#define memtx_tree_delete _memtx_tree(delete)
+#define memtx_tree_delete_get _memtx_tree(delete_get)
+#define memtx_tree_lower_bound _memtx_tree(lower_bound)
+#define memtx_tree_upper_bound _memtx_tree(upper_bound)
+#define memtx_tree_lower_bound_elem _memtx_tree(lower_bound_elem)
+#define memtx_tree_upper_bound_elem _memtx_tree(upper_bound_elem)
+#define memtx_tree_lower_bound_get_offset _memtx_tree(lower_bound_get_offset)
+#define memtx_tree_upper_bound_get_offset _memtx_tree(upper_bound_get_offset)
+#define memtx_tree_enable_card _memtx_tree(enable_card)
+#define memtx_tree_invalid_iterator _memtx_tree(invalid_iterator)
+#define memtx_tree_iterator_at _memtx_tree(iterator_at)
+#define memtx_tree_iterator_first _memtx_tree(iterator_first)
+#define memtx_tree_iterator_last _memtx_tree(iterator_last)
+#define memtx_tree_iterator_next _memtx_tree(iterator_next)
+#define memtx_tree_iterator_prev _memtx_tree(iterator_prev)
+#define memtx_tree_iterator_get_elem _memtx_tree(iterator_get_elem)
+#define memtx_tree_iterator_freeze _memtx_tree(iterator_freeze)
+#define memtx_tree_iterator_destroy _memtx_tree(iterator_destroy)
+
+#define memtx_tree_qcompare _memtx_tree(qcompare)
+#define tree_iterator _memtx_tree(index_iterator)
+#define tree_iterator_free _memtx_tree(index_iterator_free)
+#define tree_iterator_reset_current _memtx_tree(index_iterator_reset_current)
+#define tree_iterator_is_positioned _memtx_tree(index_iterator_is_positioned)
+#define tree_iterator_dummie _memtx_tree(index_iterator_dummie)
+#define tree_iterator_copy_key _memtx_tree(index_iterator_copy_key)
+#define tree_iterator_set_current _memtx_tree(index_iterator_set_current)
+#define tree_iterator_bound _memtx_tree(index_iterator_bound)
+#define tree_iterator_next _memtx_tree(index_iterator_next)
+#define tree_iterator_prev _memtx_tree(index_iterator_prev)
+#define tree_iterator_next_equal _memtx_tree(index_iterator_next_equal)
+#define tree_iterator_prev_equal _memtx_tree(index_iterator_prev_equal)
+#define tree_iterator_set_next_method \
+	_memtx_tree(index_iterator_set_next_method)
+#define tree_iterator_start_at_offset \
+	_memtx_tree(index_iterator_start_at_offset)
+#define tree_iterator_start _memtx_tree(index_iterator_start)
+#define tree_iterator_skip _memtx_tree(index_iterator_skip)
+#define tree_iterator_next_key _memtx_tree(index_iterator_next_key)
+#define tree_snapshot_iterator _memtx_tree(snapshot_iterator)
+#define tree_snapshot_iterator_free _memtx_tree(snapshot_iterator_free)
+#define tree_snapshot_iterator_next _memtx_tree(snapshot_iterator_next)
+#define memtx_tree_index _memtx_tree(index)
+#define memtx_tree_index_data_new _memtx_tree(index_data_new)
+#define memtx_tree_index_data_delete _memtx_tree(index_data_delete)
+#define memtx_tree_index_destroy _memtx_tree(index_destroy)
+#define memtx_tree_index_size _memtx_tree(index_size)
+#define memtx_tree_index_bsize _memtx_tree(index_bsize)
+#define memtx_tree_index_random _memtx_tree(index_random)
+#define memtx_tree_index_count _memtx_tree(index_count)
+#define memtx_tree_index_get _memtx_tree(index_get)
+#define memtx_tree_index_replace_multikey _memtx_tree(index_replace_multikey)
+#define memtx_tree_index_replace _memtx_tree(index_replace)
+#define memtx_tree_index_create_iterator _memtx_tree(index_create_iterator)
+#define memtx_tree_index_begin_build _memtx_tree(index_begin_build)
+#define memtx_tree_index_reserve _memtx_tree(index_reserve)
+#define memtx_tree_index_build_array_append \
+	_memtx_tree(index_build_array_append)
+#define memtx_tree_index_build_next _memtx_tree(index_build_next)
+#define memtx_tree_index_end_build _memtx_tree(index_end_build)
+#define memtx_tree_index_create_snapshot_iterator \
+	_memtx_tree(index_create_snapshot_iterator)
+#define memtx_tree_index_vtab _memtx_tree(index_vtab)
+#define memtx_tree_index_new _memtx_tree(index_new)
+/* }}} */
+
+struct memtx_tree_index {
+	struct index base;
+	struct memtx_tree tree;
+	memtx_tree_elem_t *build_array;
+	size_t build_array_size, build_array_alloc_size;
+#if MEMTX_TREE_KEYED
+	/** Set if the index stores key copies, see index_opts. */
+	bool is_covering;
+	/**
+	 * Set if the index stores an element for each item of
+	 * an array indexed by a "[*]" path, see key_def.
+	 */
+	bool is_multikey;
+	/** Total size of key copies stored out of tree elements. */
+	size_t key_copy_size;
+#endif
+};
+
+/* {{{ Utilities. *************************************************/
+
+static int
+memtx_tree_qcompare(const void* a, const void *b, void *c)
+{
+	return memtx_tree_elem_compare(*(memtx_tree_elem_t *)a,
+		*(memtx_tree_elem_t *)b, (struct key_def *)c);
+}
+
+/* {{{ MemtxTree Iterators ****************************************/
+struct tree_iterator {
+	struct iterator base;
+	const struct memtx_tree *tree;
+	struct index_def *index_def;
+	struct memtx_tree_iterator tree_iterator;
+	enum iterator_type type;
+	struct memtx_tree_key_data key_data;
+	/**
+	 * Tuple the iterator is positioned at. Referenced
+	 * unless the iterator is iterated with next_key().
+	 */
+	struct tuple *current_tuple;
+#if MEMTX_TREE_KEYED
+	/**
+	 * Set if the iterator is iterated with next_key().
+	 * Such an iterator does not touch tuples of a covering
+	 * index: it copies the current key to key_buf and uses
+	 * the copy to restore its position if the tree changes.
+	 * Since tuples are not referenced, the iterator must not
+	 * be used across yields.
+	 */
+	bool keys_only;
+	/**
+	 * Fields of the current tuple indexed by the tree key
+	 * definition, encoded as a MessagePack array. Also
+	 * maintained by multikey index iterators, which can't
+	 * find their position in the tree by a tuple.
+	 */
+	char *key_buf;
+	/** Size of the key in key_buf. */
+	uint32_t key_buf_size;
+	/** Size of memory allocated for key_buf. */
+	uint32_t key_buf_capacity;
+#endif
+#if MEMTX_TREE_RANK
+	/** Number of tuples to skip on start, see tree_iterator_skip(). */
+	uint32_t offset;
+#endif
+	/** Memory pool the iterator was allocated from. */
+	struct mempool *pool;
+};
+
+static void
+tree_iterator_free(struct iterator *iterator);
+
+static inline struct tree_iterator *
+tree_iterator(struct iterator *it)
+{
+	assert(it->free == tree_iterator_free);
+	return (struct tree_iterator *) it;
+}
+
+/** Forget the current position of the iterator. */
+static inline void
+tree_iterator_reset_current(struct tree_iterator *it)
+{
+#if MEMTX_TREE_KEYED
+	if (it->current_tuple != NULL && !it->keys_only)
+		tuple_unref(it->current_tuple);
+#else
+	if (it->current_tuple != NULL)
+		tuple_unref(it->current_tuple);
+#endif
+	it->current_tuple = NULL;
+}
+
+/**
+ * Check if the tree element the iterator was positioned at is
+ * still at the same place, i.e. the tree was not modified.
+ */
+static inline bool
+tree_iterator_is_positioned(struct tree_iterator *it)
+{
+	memtx_tree_elem_t *check =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (check == NULL ||
+	    memtx_tree_elem_tuple(*check) != it->current_tuple)
+		return false;
+#if MEMTX_TREE_KEYED
+	/*
+	 * A tuple has several elements in a multikey index and
+	 * an iterator which doesn't reference tuples may see
+	 * another tuple at the address of the current one, so
+	 * check the key as well.
+	 */
+	if ((it->keys_only || it->tree->arg->is_multikey) &&
+	    check->key_size != 0) {
+		uint32_t header_size = mp_sizeof_array(it->tree->arg->part_count);
+		return check->key_size + header_size == it->key_buf_size &&
+		       memcmp(memtx_tree_key_elem_key(check),
+			      it->key_buf + header_size, check->key_size) == 0;
+	}
+#endif
+	return true;
+}
+
+static void
+tree_iterator_free(struct iterator *iterator)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	tree_iterator_reset_current(it);
+#if MEMTX_TREE_KEYED
+	free(it->key_buf);
+#endif
+	mempool_free(it->pool, it);
+}
+
+static int
+tree_iterator_dummie(struct iterator *iterator, struct tuple **ret)
+{
+	(void)iterator;
+	*ret = NULL;
+	return 0;
+}
+
+#if MEMTX_TREE_KEYED
+/**
+ * Copy the key of a tree element to key_buf.
+ */
+static int
+tree_iterator_copy_key(struct tree_iterator *it, memtx_tree_elem_t *res)
+{
+	struct key_def *def = it->tree->arg;
+	const char *key;
+	uint32_t key_size, header_size;
+	if (res->key_size != 0) {
+		key = memtx_tree_key_elem_key(res);
+		key_size = res->key_size;
+		header_size = mp_sizeof_array(def->part_count);
+	} else {
+		/* The key copy could not be allocated. */
+		key = tuple_extract_key(res->tuple, def, &key_size);
+		if (key == NULL)
+			goto fail;
+		header_size = 0;
+	}
+	if (header_size + key_size > it->key_buf_capacity) {
+		uint32_t capacity = header_size + key_size;
+		char *buf = (char *)realloc(it->key_buf, capacity);
+		if (buf == NULL) {
+			diag_set(OutOfMemory, capacity,
+				 "memtx_tree_index", "key_buf");
+			goto fail;
+		}
+		it->key_buf = buf;
+		it->key_buf_capacity = capacity;
+	}
+	char *pos = it->key_buf;
+	if (header_size > 0)
+		pos = mp_encode_array(pos, def->part_count);
+	memcpy(pos, key, key_size);
+	it->key_buf_size = header_size + key_size;
+	return 0;
+fail:
+	it->base.next = tree_iterator_dummie;
+	return -1;
+}
+#endif /* MEMTX_TREE_KEYED */
+
+/**
+ * Remember the tree element the iterator is positioned at:
+ * reference its tuple or, if the iterator returns keys,
+ * copy its key to key_buf.
+ */
+static inline int
+tree_iterator_set_current(struct tree_iterator *it, memtx_tree_elem_t *res)
+{
+	assert(it->current_tuple == NULL);
+	it->current_tuple = memtx_tree_elem_tuple(*res);
+#if MEMTX_TREE_KEYED
+	if ((it->keys_only || it->tree->arg->is_multikey) &&
+	    tree_iterator_copy_key(it, res) != 0) {
+		it->current_tuple = NULL;
+		return -1;
+	}
+	if (it->keys_only)
+		return 0;
+#endif
+	tuple_ref(it->current_tuple);
+	return 0;
+}
+
+/**
+ * Find the first element greater than the current one (@upper)
+ * or not less than it (!@upper) after the tree was modified.
+ */
+static struct memtx_tree_iterator
+tree_iterator_bound(struct tree_iterator *it, bool upper)
+{
+#if MEMTX_TREE_KEYED
+	if (it->keys_only || it->tree->arg->is_multikey) {
+		/*
+		 * The current tuple may be gone or be indexed
+		 * under several keys, use the key copy.
+		 */
+		struct memtx_tree_key_data key_data;
+		key_data.key = it->key_buf;
+		key_data.part_count = mp_decode_array(&key_data.key);
+		return upper ?
+		       memtx_tree_upper_bound(it->tree, &key_data, NULL) :
+		       memtx_tree_lower_bound(it->tree, &key_data, NULL);
+	}
+	memtx_tree_elem_t data;
+	data.tuple = it->current_tuple;
+	data.key_size = 0;
+#else
+	memtx_tree_elem_t data = it->current_tuple;
+#endif
+	return upper ? memtx_tree_upper_bound_elem(it->tree, data, NULL) :
+		       memtx_tree_lower_bound_elem(it->tree, data, NULL);
+}
+
+static int
+tree_iterator_next(struct iterator *iterator, struct tuple **ret)
+{
+	memtx_tree_elem_t *res;
+	struct tree_iterator *it = tree_iterator(iterator);
+	assert(it->current_tuple != NULL);
+	if (!tree_iterator_is_positioned(it))
+		it->tree_iterator = tree_iterator_bound(it, true);
+	else
+		memtx_tree_iterator_next(it->tree, &it->tree_iterator);
+	tree_iterator_reset_current(it);
+	res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (res == NULL) {
+		iterator->next = tree_iterator_dummie;
+		*ret = NULL;
+		return 0;
+	}
+	*ret = memtx_tree_elem_tuple(*res);
+	return tree_iterator_set_current(it, res);
+}
+
+static int
+tree_iterator_prev(struct iterator *iterator, struct tuple **ret)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	assert(it->current_tuple != NULL);
+	if (!tree_iterator_is_positioned(it))
+		it->tree_iterator = tree_iterator_bound(it, false);
+	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
+	tree_iterator_reset_current(it);
+	memtx_tree_elem_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (!res) {
+		iterator->next = tree_iterator_dummie;
+		*ret = NULL;
+		return 0;
+	}
+	*ret = memtx_tree_elem_tuple(*res);
+	return tree_iterator_set_current(it, res);
+}
+
+static int
+tree_iterator_next_equal(struct iterator *iterator, struct tuple **ret)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	assert(it->current_tuple != NULL);
+	if (!tree_iterator_is_positioned(it))
+		it->tree_iterator = tree_iterator_bound(it, true);
+	else
+		memtx_tree_iterator_next(it->tree, &it->tree_iterator);
+	tree_iterator_reset_current(it);
+	memtx_tree_elem_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	/* Use user key def to save a few loops. */
+	if (!res || memtx_tree_elem_compare_key(*res, &it->key_data,
+						it->index_def->key_def) != 0) {
+		iterator->next = tree_iterator_dummie;
+		*ret = NULL;
+		return 0;
+	}
+	*ret = memtx_tree_elem_tuple(*res);
+	return tree_iterator_set_current(it, res);
+}
+
+static int
+tree_iterator_prev_equal(struct iterator *iterator, struct tuple **ret)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	assert(it->current_tuple != NULL);
+	if (!tree_iterator_is_positioned(it))
+		it->tree_iterator = tree_iterator_bound(it, false);
+	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
+	tree_iterator_reset_current(it);
+	memtx_tree_elem_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	/* Use user key def to save a few loops. */
+	if (!res || memtx_tree_elem_compare_key(*res, &it->key_data,
+						it->index_def->key_def) != 0) {
+		iterator->next = tree_iterator_dummie;
+		*ret = NULL;
+		return 0;
+	}
+	*ret = memtx_tree_elem_tuple(*res);
+	return tree_iterator_set_current(it, res);
+}
+
+static void
+tree_iterator_set_next_method(struct tree_iterator *it)
+{
+	assert(it->current_tuple != NULL);
+	switch (it->type) {
+	case ITER_EQ:
+		it->base.next = tree_iterator_next_equal;
+		break;
+	case ITER_REQ:
+		it->base.next = tree_iterator_prev_equal;
+		break;
+	case ITER_ALL:
+		it->base.next = tree_iterator_next;
+		break;
+	case ITER_LT:
+	case ITER_LE:
+		it->base.next = tree_iterator_prev;
+		break;
+	case ITER_GE:
+	case ITER_GT:
+		it->base.next = tree_iterator_next;
+		break;
+	default:
+		/* The type was checked in initIterator */
+		assert(false);
+	}
+}
+
+#if MEMTX_TREE_RANK
+/**
+ * Position the iterator at it->offset tuples from the start
+ * using subtree element counts stored in the tree.
+ * Return false if there is no tuple at the requested offset.
+ */
+static bool
+tree_iterator_start_at_offset(struct tree_iterator *it)
+{
+	const struct memtx_tree *tree = it->tree;
+	enum iterator_type type = it->type;
+	bool exact = false;
+	size_t pos;
+	if (it->key_data.key == 0) {
+		pos = iterator_type_is_reverse(type) ?
+		      memtx_tree_size(tree) : 0;
+	} else if (type == ITER_ALL || type == ITER_EQ ||
+		   type == ITER_GE || type == ITER_LT) {
+		memtx_tree_lower_bound_get_offset(tree, &it->key_data,
+						  &exact, &pos);
+	} else { // ITER_GT, ITER_REQ, ITER_LE
+		memtx_tree_upper_bound_get_offset(tree, &it->key_data,
+						  &exact, &pos);
+	}
+	if ((type == ITER_EQ || type == ITER_REQ) && !exact)
+		return false;
+	if (iterator_type_is_reverse(type)) {
+		/* See the comment in tree_iterator_start(). */
+		if (pos <= it->offset)
+			return false;
+		pos -= (size_t)it->offset + 1;
+	} else {
+		pos += it->offset;
+	}
+	it->tree_iterator = memtx_tree_iterator_at(tree, pos);
+	if (type == ITER_EQ || type == ITER_REQ) {
+		memtx_tree_elem_t *res =
+			memtx_tree_iterator_get_elem(tree, &it->tree_iterator);
+		if (res == NULL ||
+		    memtx_tree_elem_compare_key(*res, &it->key_data,
+						tree->arg) != 0)
+			return false;
+	}
+	return true;
+}
+#endif /* MEMTX_TREE_RANK */
+
+static int
+tree_iterator_start(struct iterator *iterator, struct tuple **ret)
+{
+	*ret = NULL;
+	struct tree_iterator *it = tree_iterator(iterator);
+	it->base.next = tree_iterator_dummie;
+	const struct memtx_tree *tree = it->tree;
+	enum iterator_type type = it->type;
+	bool exact = false;
+	assert(it->current_tuple == NULL);
+#if MEMTX_TREE_RANK
+	if (it->offset > 0) {
+		if (!tree_iterator_start_at_offset(it))
+			return 0;
+	} else
+#endif
+	if (it->key_data.key == 0) {
+		if (iterator_type_is_reverse(it->type))
+			it->tree_iterator = memtx_tree_iterator_last(tree);
+		else
+			it->tree_iterator = memtx_tree_iterator_first(tree);
+	} else {
+		if (type == ITER_ALL || type == ITER_EQ ||
+		    type == ITER_GE || type == ITER_LT) {
+			it->tree_iterator =
+				memtx_tree_lower_bound(tree, &it->key_data,
+						       &exact);
+			if (type == ITER_EQ && !exact)
+				return 0;
+		} else { // ITER_GT, ITER_REQ, ITER_LE
+			it->tree_iterator =
+				memtx_tree_upper_bound(tree, &it->key_data,
+						       &exact);
+			if (type == ITER_REQ && !exact)
+				return 0;
+		}
+		if (iterator_type_is_reverse(type)) {
+			/*
+			 * Because of limitations of tree search API we use use
+			 * lower_bound for LT search and upper_bound for LE
+			 * and REQ searches. Thus we found position to the
+			 * right of the target one. Let's make a step to the
+			 * left to reach target position.
+			 * If we found an invalid iterator all the elements in
+			 * the tree are less (less or equal) to the key, and
+			 * iterator_next call will convert the iterator to the
+			 * last position in the tree, that's what we need.
+			 */
+			memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
+		}
+	}
+
+	memtx_tree_elem_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (!res)
+		return 0;
+	if (tree_iterator_set_current(it, res) != 0)
+		return -1;
+	*ret = memtx_tree_elem_tuple(*res);
+	tree_iterator_set_next_method(it);
+	return 0;
+}
+
+#if MEMTX_TREE_RANK
+static int
+tree_iterator_skip(struct iterator *iterator, uint32_t count)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	assert(it->base.next == tree_iterator_start);
+	it->offset = count;
+	return 0;
+}
+#endif /* MEMTX_TREE_RANK */
+
+#if MEMTX_TREE_KEYED
+static int
+tree_iterator_next_key(struct iterator *iterator, const char **ret,
+		       uint32_t *size)
+{
+	struct tree_iterator *it = tree_iterator(iterator);
+	assert(it->keys_only || it->current_tuple == NULL);
+	it->keys_only = true;
+	struct tuple *tuple;
+	if (iterator->next(iterator, &tuple) != 0)
+		return -1;
+	if (tuple == NULL) {
+		*ret = NULL;
+		return 0;
+	}
+	*ret = it->key_buf;
+	*size = it->key_buf_size;
+	return 0;
+}
+#endif /* MEMTX_TREE_KEYED */
+
+/* }}} */
+
+/* {{{ MemtxTree  **********************************************************/
+
+#if MEMTX_TREE_KEYED
+/**
+ * Make a tree element for a tuple. A covering index stores
+ * a copy of the indexed fields in the element. If the copy
+ * can't be allocated, the element refers to the tuple only,
+ * which is slower but correct, so that replace never fails
+ * because of the copy, e.g. on rollback.
+ */
+static inline memtx_tree_elem_t
+memtx_tree_index_data_new(struct memtx_tree_index *index, struct tuple *tuple)
+{
+	memtx_tree_elem_t data;
+	data.tuple = tuple;
+	data.key_size = 0;
+	uint32_t size;
+	if (index->is_covering &&
+	    memtx_tree_key_elem_create(&data, tuple, index->tree.arg,
+				       0, &size) == 0)
+		index->key_copy_size += memtx_tree_key_elem_copy_size(&data);
+	return data;
+}
+
+/** Free the key copy of a tree element, if any. */
+static inline void
+memtx_tree_index_data_delete(struct memtx_tree_index *index,
+			     memtx_tree_elem_t *data)
+{
+	uint32_t size = memtx_tree_key_elem_destroy(data);
+	assert(index->key_copy_size >= size);
+	index->key_copy_size -= size;
+}
+#else /* !MEMTX_TREE_KEYED */
+static inline memtx_tree_elem_t
+memtx_tree_index_data_new(struct memtx_tree_index *index, struct tuple *tuple)
+{
+	(void)index;
+	return tuple;
+}
+
+static inline void
+memtx_tree_index_data_delete(struct memtx_tree_index *index,
+			     memtx_tree_elem_t *data)
+{
+	(void)index;
+	(void)data;
+}
+#endif /* !MEMTX_TREE_KEYED */
+
+static void
+memtx_tree_index_destroy(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+#if MEMTX_TREE_KEYED
+	struct memtx_tree_iterator itr =
+		memtx_tree_iterator_first(&index->tree);
+	memtx_tree_elem_t *res;
+	while ((res = memtx_tree_iterator_get_elem(&index->tree,
+						   &itr)) != NULL) {
+		memtx_tree_index_data_delete(index, res);
+		memtx_tree_iterator_next(&index->tree, &itr);
+	}
+	for (size_t i = 0; i < index->build_array_size; i++)
+		memtx_tree_index_data_delete(index, &index->build_array[i]);
+#endif
+	memtx_tree_destroy(&index->tree);
+	free(index->build_array);
+	free(index);
+}
+
+static ssize_t
+memtx_tree_index_size(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	return memtx_tree_size(&index->tree);
+}
+
+static ssize_t
+memtx_tree_index_bsize(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+#if MEMTX_TREE_KEYED
+	return memtx_tree_mem_used(&index->tree) + index->key_copy_size;
+#else
+	return memtx_tree_mem_used(&index->tree);
+#endif
+}
+
+static int
+memtx_tree_index_random(struct index *base, uint32_t rnd, struct tuple **result)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	memtx_tree_elem_t *res = memtx_tree_random(&index->tree, rnd);
+	*result = res != NULL ? memtx_tree_elem_tuple(*res) : NULL;
+	return 0;
+}
+
+static ssize_t
+memtx_tree_index_count(struct index *base, enum iterator_type type,
+		       const char *key, uint32_t part_count)
+{
+	if (type == ITER_ALL)
+		return memtx_tree_index_size(base); /* optimization */
+#if MEMTX_TREE_RANK
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	if (part_count == 0)
+		return generic_index_count(base, type, key, part_count);
+	/*
+	 * The tree maintains subtree element counts, so the
+	 * number of matching tuples can be computed from the
+	 * positions of the key bounds.
+	 */
+	struct memtx_tree_key_data key_data;
+	key_data.key = key;
+	key_data.part_count = part_count;
+	bool exact;
+	size_t size = memtx_tree_size(&index->tree);
+	size_t lower = 0, upper = size;
+	if (type != ITER_GT && type != ITER_LE)
+		memtx_tree_lower_bound_get_offset(&index->tree, &key_data,
+						  &exact, &lower);
+	if (type != ITER_GE && type != ITER_LT)
+		memtx_tree_upper_bound_get_offset(&index->tree, &key_data,
+						  &exact, &upper);
+	switch (type) {
+	case ITER_EQ:
+	case ITER_REQ:
+		return upper - lower;
+	case ITER_GE:
+		return size - lower;
+	case ITER_GT:
+		return size - upper;
+	case ITER_LT:
+		return lower;
+	case ITER_LE:
+		return upper;
+	default:
+		break;
+	}
+#endif /* MEMTX_TREE_RANK */
+	return generic_index_count(base, type, key, part_count);
+}
+
+static int
+memtx_tree_index_get(struct index *base, const char *key,
+		     uint32_t part_count, struct tuple **result)
+{
+	assert(base->def->opts.is_unique &&
+	       part_count == base->def->key_def->part_count);
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct memtx_tree_key_data key_data;
+	key_data.key = key;
+	key_data.part_count = part_count;
+	memtx_tree_elem_t *res = memtx_tree_find(&index->tree, &key_data);
+	*result = res != NULL ? memtx_tree_elem_tuple(*res) : NULL;
+	return 0;
+}
+
+#if MEMTX_TREE_KEYED
+/**
+ * Replace a tuple in a multikey index. Unlike a tuple in an
+ * ordinary index, a tuple has an element per item of the array
+ * indexed by "[*]" here, so the elements of the old tuple are
+ * deleted first and then an element for each item of the new
+ * tuple is inserted. On error the index is restored.
+ */
+static int
+memtx_tree_index_replace_multikey(struct memtx_tree_index *index,
+				  struct tuple *old_tuple,
+				  struct tuple *new_tuple,
+				  enum dup_replace_mode mode,
+				  struct tuple **result)
+{
+	/* A multikey index is never primary. */
+	assert(mode == DUP_INSERT);
+	(void)mode;
+	struct index_def *index_def = index->base.def;
+	struct key_def *def = index->tree.arg;
+	struct region *region = &fiber()->gc;
+	size_t region_svp = region_used(region);
+	memtx_tree_elem_t *deleted = NULL, *inserted = NULL;
+	uint32_t deleted_count = 0, inserted_count = 0;
+	uint32_t count;
+	if (old_tuple != NULL) {
+		count = tuple_multikey_count(tuple_format(old_tuple),
+					     tuple_data(old_tuple),
+					     tuple_field_map(old_tuple), def);
+		deleted = (memtx_tree_elem_t *)
+			region_alloc(region, count * sizeof(*deleted));
+		if (deleted == NULL) {
+			diag_set(OutOfMemory, count * sizeof(*deleted),
+				 "region", "deleted");
+			goto fail;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			memtx_tree_elem_t old_data;
+			if (memtx_tree_key_elem_create_on_region(&old_data,
+					old_tuple, def, i, region) != 0)
+				goto rollback;
+			if (memtx_tree_delete_get(&index->tree, old_data,
+						  &deleted[deleted_count]) == 0)
+				deleted_count++;
+		}
+	}
+	if (new_tuple != NULL) {
+		count = tuple_multikey_count(tuple_format(new_tuple),
+					     tuple_data(new_tuple),
+					     tuple_field_map(new_tuple), def);
+		inserted = (memtx_tree_elem_t *)
+			region_alloc(region, count * sizeof(*inserted));
+		if (inserted == NULL) {
+			diag_set(OutOfMemory, count * sizeof(*inserted),
+				 "region", "inserted");
+			goto rollback;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			memtx_tree_elem_t new_data, dup_data;
+			uint32_t size;
+			if (memtx_tree_key_elem_create(&new_data, new_tuple,
+						       def, i, &size) != 0) {
+				diag_set(OutOfMemory, size, "memtx_tree_index",
+					 "key");
+				goto rollback;
+			}
+			index->key_copy_size +=
+				memtx_tree_key_elem_copy_size(&new_data);
+			dup_data.tuple = NULL;
+			dup_data.key_size = 0;
+			if (memtx_tree_insert(&index->tree, new_data,
+					      &dup_data) != 0) {
+				memtx_tree_index_data_delete(index, &new_data);
+				diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+					 "memtx_tree_index", "replace");
+				goto rollback;
+			}
+			if (dup_data.tuple == NULL) {
+				inserted[inserted_count++] = new_data;
+				continue;
+			}
+			/*
+			 * Either the array has equal items or
+			 * another tuple has the same key. Restore
+			 * the replaced element in both cases.
+			 */
+			memtx_tree_insert(&index->tree, dup_data, NULL);
+			memtx_tree_index_data_delete(index, &new_data);
+			if (dup_data.tuple == new_tuple)
+				continue;
+			struct space *sp = space_cache_find(index_def->space_id);
+			if (sp != NULL)
+				diag_set(ClientError, ER_TUPLE_FOUND,
+					 index_def->name, space_name(sp));
+			goto rollback;
+		}
+	}
+	for (uint32_t i = 0; i < deleted_count; i++)
+		memtx_tree_index_data_delete(index, &deleted[i]);
+	region_truncate(region, region_svp);
+	*result = old_tuple;
+	return 0;
+rollback:
+	for (uint32_t i = 0; i < inserted_count; i++) {
+		memtx_tree_delete(&index->tree, inserted[i]);
+		memtx_tree_index_data_delete(index, &inserted[i]);
+	}
+	for (uint32_t i = 0; i < deleted_count; i++) {
+		if (memtx_tree_insert(&index->tree, deleted[i], NULL) != 0)
+			panic("failed to restore a multikey index element");
+	}
+fail:
+	region_truncate(region, region_svp);
+	return -1;
+}
+#endif /* MEMTX_TREE_KEYED */
+
+static int
+memtx_tree_index_replace(struct index *base, struct tuple *old_tuple,
+			 struct tuple *new_tuple, enum dup_replace_mode mode,
+			 struct tuple **result)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+#if MEMTX_TREE_KEYED
+	if (index->is_multikey) {
+		return memtx_tree_index_replace_multikey(index, old_tuple,
+							 new_tuple, mode,
+							 result);
+	}
+#endif
+	if (new_tuple) {
+		memtx_tree_elem_t new_data =
+			memtx_tree_index_data_new(index, new_tuple);
+		memtx_tree_elem_t dup_data;
+#if MEMTX_TREE_KEYED
+		dup_data.tuple = NULL;
+		dup_data.key_size = 0;
+#else
+		dup_data = NULL;
+#endif
+
+		/* Try to optimistically replace the new_tuple. */
+		int tree_res = memtx_tree_insert(&index->tree,
+						 new_data, &dup_data);
+		if (tree_res) {
+			memtx_tree_index_data_delete(index, &new_data);
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_tree_index", "replace");
+			return -1;
+		}
+
+		struct tuple *dup_tuple = memtx_tree_elem_tuple(dup_data);
+		uint32_t errcode = replace_check_dup(old_tuple,
+						     dup_tuple, mode);
+		if (errcode) {
+			memtx_tree_delete(&index->tree, new_data);
+			memtx_tree_index_data_delete(index, &new_data);
+			if (dup_tuple != NULL)
+				memtx_tree_insert(&index->tree, dup_data, 0);
+			struct space *sp = space_cache_find(base->def->space_id);
+			if (sp != NULL)
+				diag_set(ClientError, errcode, base->def->name,
+					 space_name(sp));
+			return -1;
+		}
+		if (dup_tuple != NULL) {
+			memtx_tree_index_data_delete(index, &dup_data);
+			*result = dup_tuple;
+			return 0;
+		}
+	}
+	if (old_tuple) {
+#if MEMTX_TREE_KEYED
+		memtx_tree_elem_t old_data, deleted;
+		old_data.tuple = old_tuple;
+		old_data.key_size = 0;
+		if (memtx_tree_delete_get(&index->tree, old_data,
+					  &deleted) == 0)
+			memtx_tree_index_data_delete(index, &deleted);
+#else
+		memtx_tree_delete(&index->tree, old_tuple);
+#endif
+	}
+	*result = old_tuple;
+	return 0;
+}
+
+static struct iterator *
+memtx_tree_index_create_iterator(struct index *base, enum iterator_type type,
+				 const char *key, uint32_t part_count)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct memtx_engine *memtx = (struct memtx_engine *)base->engine;
+
+	assert(part_count == 0 || key != NULL);
+	if (type > ITER_GT) {
+		diag_set(UnsupportedIndexFeature, base->def,
+			 "requested iterator type");
+		return NULL;
+	}
+
+	if (part_count == 0) {
+		/*
+		 * If no key is specified, downgrade equality
+		 * iterators to a full range.
+		 */
+		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
+		key = NULL;
+	}
+
+	struct tree_iterator *it = mempool_alloc(&memtx->tree_iterator_pool);
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(struct tree_iterator),
+			 "memtx_tree_index", "iterator");
+		return NULL;
+	}
+	iterator_create(&it->base, base);
+	it->pool = &memtx->tree_iterator_pool;
+	it->base.next = tree_iterator_start;
+#if MEMTX_TREE_RANK
+	it->base.skip = tree_iterator_skip;
+	it->offset = 0;
+#endif
+#if MEMTX_TREE_KEYED
+	if (index->is_covering)
+		it->base.next_key = tree_iterator_next_key;
+	it->keys_only = false;
+	it->key_buf = NULL;
+	it->key_buf_size = 0;
+	it->key_buf_capacity = 0;
+#endif
+	it->base.free = tree_iterator_free;
+	it->type = type;
+	it->key_data.key = key;
+	it->key_data.part_count = part_count;
+	it->index_def = base->def;
+	it->tree = &index->tree;
+	it->tree_iterator = memtx_tree_invalid_iterator();
+	it->current_tuple = NULL;
+	return (struct iterator *)it;
+}
+
+static void
+memtx_tree_index_begin_build(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	assert(memtx_tree_size(&index->tree) == 0);
+	(void)index;
+}
+
+static int
+memtx_tree_index_reserve(struct index *base, uint32_t size_hint)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	if (size_hint < index->build_array_alloc_size)
+		return 0;
+	memtx_tree_elem_t *tmp = (memtx_tree_elem_t *)
+		realloc(index->build_array, size_hint * sizeof(*tmp));
+	if (tmp == NULL) {
+		diag_set(OutOfMemory, size_hint * sizeof(*tmp),
+			 "memtx_tree_index", "reserve");
+		return -1;
+	}
+	index->build_array = tmp;
+	index->build_array_alloc_size = size_hint;
+	return 0;
+}
+
+/** Append an element to the array the index is built from. */
+static int
+memtx_tree_index_build_array_append(struct memtx_tree_index *index,
+				    memtx_tree_elem_t data)
+{
+	if (index->build_array == NULL) {
+		index->build_array =
+			(memtx_tree_elem_t *)malloc(MEMTX_EXTENT_SIZE);
+		if (index->build_array == NULL) {
+			diag_set(OutOfMemory, MEMTX_EXTENT_SIZE,
+				 "memtx_tree_index", "build_next");
+			return -1;
+		}
+		index->build_array_alloc_size =
+			MEMTX_EXTENT_SIZE / sizeof(memtx_tree_elem_t);
+	}
+	assert(index->build_array_size <= index->build_array_alloc_size);
+	if (index->build_array_size == index->build_array_alloc_size) {
+		index->build_array_alloc_size = index->build_array_alloc_size +
+					index->build_array_alloc_size / 2;
+		memtx_tree_elem_t *tmp = (memtx_tree_elem_t *)
+			realloc(index->build_array,
+				index->build_array_alloc_size * sizeof(*tmp));
+		if (tmp == NULL) {
+			diag_set(OutOfMemory, index->build_array_alloc_size *
+				 sizeof(*tmp), "memtx_tree_index", "build_next");
+			return -1;
+		}
+		index->build_array = tmp;
+	}
+	index->build_array[index->build_array_size++] = data;
+	return 0;
+}
+
+static int
+memtx_tree_index_build_next(struct index *base, struct tuple *tuple)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+#if MEMTX_TREE_KEYED
+	if (index->is_multikey) {
+		struct key_def *def = index->tree.arg;
+		uint32_t count = tuple_multikey_count(tuple_format(tuple),
+						      tuple_data(tuple),
+						      tuple_field_map(tuple),
+						      def);
+		for (uint32_t i = 0; i < count; i++) {
+			memtx_tree_elem_t data;
+			uint32_t size;
+			if (memtx_tree_key_elem_create(&data, tuple, def,
+						       i, &size) != 0) {
+				diag_set(OutOfMemory, size, "memtx_tree_index",
+					 "build_next");
+				return -1;
+			}
+			index->key_copy_size +=
+				memtx_tree_key_elem_copy_size(&data);
+			if (memtx_tree_index_build_array_append(index,
+								data) != 0) {
+				memtx_tree_index_data_delete(index, &data);
+				return -1;
+			}
+		}
+		return 0;
+	}
+#endif
+	memtx_tree_elem_t data = memtx_tree_index_data_new(index, tuple);
+	if (memtx_tree_index_build_array_append(index, data) != 0) {
+		memtx_tree_index_data_delete(index, &data);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+memtx_tree_index_end_build(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	qsort_arg(index->build_array, index->build_array_size,
+		  sizeof(memtx_tree_elem_t),
+		  memtx_tree_qcompare, index->tree.arg);
+#if MEMTX_TREE_KEYED
+	if (index->is_multikey) {
+		/*
+		 * Equal items of an array produce equal elements,
+		 * keep only one of them. Elements of different
+		 * tuples can't be equal: the index was checked
+		 * for duplicates when the tuples were inserted.
+		 */
+		size_t size = 0;
+		for (size_t i = 0; i < index->build_array_size; i++) {
+			memtx_tree_elem_t *data = &index->build_array[i];
+			if (size > 0 &&
+			    memtx_tree_elem_compare(index->build_array[size - 1],
+						    *data, index->tree.arg) == 0) {
+				memtx_tree_index_data_delete(index, data);
+				continue;
+			}
+			index->build_array[size++] = *data;
+		}
+		index->build_array_size = size;
+	}
+#endif
+	memtx_tree_build(&index->tree, index->build_array,
+			 index->build_array_size);
+
+	free(index->build_array);
+	index->build_array = NULL;
+	index->build_array_size = 0;
+	index->build_array_alloc_size = 0;
+}
+
+struct tree_snapshot_iterator {
+	struct snapshot_iterator base;
+	struct memtx_tree *tree;
+	struct memtx_tree_iterator tree_iterator;
+};
+
+static void
+tree_snapshot_iterator_free(struct snapshot_iterator *iterator)
+{
+	assert(iterator->free == tree_snapshot_iterator_free);
+	struct tree_snapshot_iterator *it =
+		(struct tree_snapshot_iterator *)iterator;
+	struct memtx_tree *tree = (struct memtx_tree *)it->tree;
+	memtx_tree_iterator_destroy(tree, &it->tree_iterator);
+	free(iterator);
+}
+
+static const char *
+tree_snapshot_iterator_next(struct snapshot_iterator *iterator, uint32_t *size)
+{
+	assert(iterator->free == tree_snapshot_iterator_free);
+	struct tree_snapshot_iterator *it =
+		(struct tree_snapshot_iterator *)iterator;
+	memtx_tree_elem_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	if (res == NULL)
+		return NULL;
+	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
+	return tuple_data_range(memtx_tree_elem_tuple(*res), size);
+}
+
+/**
+ * Create an ALL iterator with personal read view so further
+ * index modifications will not affect the iteration results.
+ * Must be destroyed by iterator->free after usage.
+ */
+static struct snapshot_iterator *
+memtx_tree_index_create_snapshot_iterator(struct index *base)
+{
+	struct memtx_tree_index *index = (struct memtx_tree_index *)base;
+	struct tree_snapshot_iterator *it = (struct tree_snapshot_iterator *)
+		calloc(1, sizeof(*it));
+	if (it == NULL) {
+		diag_set(OutOfMemory, sizeof(struct tree_snapshot_iterator),
+			 "memtx_tree_index", "create_snapshot_iterator");
+		return NULL;
+	}
+
+	it->base.free = tree_snapshot_iterator_free;
+	it->base.next = tree_snapshot_iterator_next;
+	it->tree = &index->tree;
+	it->tree_iterator = memtx_tree_iterator_first(&index->tree);
+	memtx_tree_iterator_freeze(&index->tree, &it->tree_iterator);
+	return (struct snapshot_iterator *) it;
+}
+
+static const struct index_vtab memtx_tree_index_vtab = {
+	/* .destroy = */ memtx_tree_index_destroy,
+	/* .commit_create = */ generic_index_commit_create,
+	/* .commit_drop = */ generic_index_commit_drop,
+	/* .size = */ memtx_tree_index_size,
+	/* .bsize = */ memtx_tree_index_bsize,
+	/* .min = */ generic_index_min,
+	/* .max = */ generic_index_max,
+	/* .random = */ memtx_tree_index_random,
+	/* .count = */ memtx_tree_index_count,
+	/* .get = */ memtx_tree_index_get,
+	/* .get_many = */ generic_index_get_many,
+	/* .replace = */ memtx_tree_index_replace,
+	/* .create_iterator = */ memtx_tree_index_create_iterator,
+	/* .create_snapshot_iterator = */
+		memtx_tree_index_create_snapshot_iterator,
+	/* .info = */ generic_index_info,
+	/* .begin_build = */ memtx_tree_index_begin_build,
+	/* .reserve = */ memtx_tree_index_reserve,
+	/* .build_next = */ memtx_tree_index_build_next,
+	/* .end_build = */ memtx_tree_index_end_build,
+};
+
+static struct index *
+memtx_tree_index_new(struct memtx_engine *memtx, struct index_def *def)
+{
+	struct memtx_tree_index *index =
+		(struct memtx_tree_index *)calloc(1, sizeof(*index));
+	if (index == NULL) {
+		diag_set(OutOfMemory, sizeof(*index),
+			 "malloc", "struct memtx_tree_index");
+		return NULL;
+	}
+	if (index_create(&index->base, (struct engine *)memtx,
+			 &memtx_tree_index_vtab, def) != 0) {
+		free(index);
+		return NULL;
+	}
+
+	/**
+	 * Use extended key def for non-unique and nullable
+	 * indexes. Unique, but nullable, index can store
+	 * multiple NULLs. To correctly compare these NULLs
+	 * extended key def must be used. For details @sa
+	 * tuple_compare.cc.
+	 */
+	struct key_def *cmp_def = index_def_unique_key_def(index->base.def);
+	memtx_tree_create(&index->tree, cmp_def,
+			  memtx_index_extent_alloc,
+			  memtx_index_extent_free, NULL);
+#if MEMTX_TREE_RANK
+	memtx_tree_enable_card(&index->tree);
+#endif
+#if MEMTX_TREE_KEYED
+	index->is_covering = def->opts.covering;
+	index->is_multikey = cmp_def->is_multikey;
+#endif
+	return &index->base;
+}
+
+/* {{{ Cleanup */
+#undef memtx_tree_elem_t
+#undef memtx_tree_elem_tuple
+#undef memtx_tree_elem_compare
+#undef memtx_tree_elem_compare_key
+
+#undef _memtx_tree
+#undef memtx_tree
+#undef memtx_tree_iterator
+#undef memtx_tree_create
+#undef memtx_tree_destroy
+#undef memtx_tree_build
+#undef memtx_tree_size
+#undef memtx_tree_mem_used
+#undef memtx_tree_random
+#undef memtx_tree_find
+#undef memtx_tree_insert
+#undef memtx_tree_delete
+#undef memtx_tree_delete_get
+#undef memtx_tree_lower_bound
+#undef memtx_tree_upper_bound
+#undef memtx_tree_lower_bound_elem
+#undef memtx_tree_upper_bound_elem
+#undef memtx_tree_lower_bound_get_offset
+#undef memtx_tree_upper_bound_get_offset
+#undef memtx_tree_enable_card
+#undef memtx_tree_invalid_iterator
+#undef memtx_tree_iterator_at
+#undef memtx_tree_iterator_first
+#undef memtx_tree_iterator_last
+#undef memtx_tree_iterator_next
+#undef memtx_tree_iterator_prev
+#undef memtx_tree_iterator_get_elem
+#undef memtx_tree_iterator_freeze
+#undef memtx_tree_iterator_destroy
+
+#undef memtx_tree_qcompare
+#undef tree_iterator
+#undef tree_iterator_free
+#undef tree_iterator_reset_current
+#undef tree_iterator_is_positioned
+#undef tree_iterator_dummie
+#undef tree_iterator_copy_key
+#undef tree_iterator_set_current
+#undef tree_iterator_bound
+#undef tree_iterator_next
+#undef tree_iterator_prev
+#undef tree_iterator_next_equal
+#undef tree_iterator_prev_equal
+#undef tree_iterator_set_next_method
+#undef tree_iterator_start_at_offset
+#undef tree_iterator_start
+#undef tree_iterator_skip
+#undef tree_iterator_next_key
+#undef tree_snapshot_iterator
+#undef tree_snapshot_iterator_free
+#undef tree_snapshot_iterator_next
+#undef memtx_tree_index
+#undef memtx_tree_index_data_new
+#undef memtx_tree_index_data_delete
+#undef memtx_tree_index_destroy
+#undef memtx_tree_index_size
+#undef memtx_tree_index_bsize
+#undef memtx_tree_index_random
+#undef memtx_tree_index_count
+#undef memtx_tree_index_get
+#undef memtx_tree_index_replace_multikey
+#undef memtx_tree_index_replace
+#undef memtx_tree_index_create_iterator
+#undef memtx_tree_index_begin_build
+#undef memtx_tree_index_reserve
+#undef memtx_tree_index_build_array_append
+#undef memtx_tree_index_build_next
+#undef memtx_tree_index_end_build
+#undef memtx_tree_index_create_snapshot_iterator
+#undef memtx_tree_index_vtab
+#undef memtx_tree_index_new
+/* }}} */
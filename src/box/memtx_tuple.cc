@@ -150,6 +150,45 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	return tuple;
 }
 
+struct tuple *
+memtx_tuple_dup(const struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	size_t meta_size = tuple_format_meta_size(format);
+	size_t total = sizeof(struct memtx_tuple) + meta_size + tuple->bsize;
+	ERROR_INJECT(ERRINJ_TUPLE_ALLOC,
+		     do { diag_set(OutOfMemory, (unsigned) total,
+				   "slab allocator", "memtx_tuple"); return NULL; }
+		     while(false); );
+	struct memtx_tuple *memtx_tuple =
+		(struct memtx_tuple *) smalloc(&memtx_alloc, total);
+	if (memtx_tuple == NULL) {
+		diag_set(OutOfMemory, (unsigned) total,
+			 "slab allocator", "memtx_tuple");
+		return NULL;
+	}
+	struct tuple *dup = &memtx_tuple->base;
+	memtx_tuple->version = snapshot_version;
+	/*
+	 * The field map is copied along with the data, since
+	 * offsets of the fields are the same in the copy.
+	 */
+	memcpy(dup, tuple, sizeof(struct tuple) + meta_size + tuple->bsize);
+	dup->refs = 0;
+	tuple_format_ref(format);
+	say_debug("%s(%u) = %p", __func__, tuple->bsize, memtx_tuple);
+	return dup;
+}
+
+bool
+memtx_tuple_is_mutable(const struct tuple *tuple)
+{
+	const struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	return memtx_alloc.free_mode != SMALL_DELAYED_FREE ||
+	       memtx_tuple->version == snapshot_version;
+}
+
 void
 memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 {
@@ -167,6 +206,78 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 		smfree_delayed(&memtx_alloc, memtx_tuple, total);
 }
 
+/** Get a tuple field indexed by a key part of a key copy. */
+static inline const char *
+memtx_tuple_key_field(const struct tuple *tuple, const struct key_part *part,
+		      uint32_t multikey_idx)
+{
+	if (part->path == NULL)
+		return tuple_field(tuple, part->fieldno);
+	return tuple_field_raw_by_path(tuple_format(tuple), tuple_data(tuple),
+				       tuple_field_map(tuple), part,
+				       multikey_idx);
+}
+
+uint32_t
+memtx_tuple_key_size(const struct tuple *tuple, const struct key_def *key_def,
+		     uint32_t multikey_idx)
+{
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + key_def->part_count;
+	uint32_t bsize = 0;
+	for (; part < end; part++) {
+		const char *field = memtx_tuple_key_field(tuple, part,
+							  multikey_idx);
+		assert(field != NULL);
+		const char *field_end = field;
+		mp_next(&field_end);
+		bsize += field_end - field;
+	}
+	return bsize;
+}
+
+char *
+memtx_tuple_key_encode(char *buf, const struct tuple *tuple,
+		       const struct key_def *key_def, uint32_t multikey_idx)
+{
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + key_def->part_count;
+	for (; part < end; part++) {
+		const char *field = memtx_tuple_key_field(tuple, part,
+							  multikey_idx);
+		const char *field_end = field;
+		mp_next(&field_end);
+		memcpy(buf, field, field_end - field);
+		buf += field_end - field;
+	}
+	return buf;
+}
+
+char *
+memtx_tuple_key_new(const struct tuple *tuple, const struct key_def *key_def,
+		    uint32_t multikey_idx, uint32_t *size)
+{
+	uint32_t bsize = memtx_tuple_key_size(tuple, key_def, multikey_idx);
+	*size = bsize;
+	char *key = (char *) smalloc(&memtx_alloc, bsize);
+	if (key == NULL)
+		return NULL;
+	char *end = memtx_tuple_key_encode(key, tuple, key_def, multikey_idx);
+	assert(end == key + bsize);
+	(void) end;
+	return key;
+}
+
+void
+memtx_tuple_key_delete(char *key, uint32_t size)
+{
+	/*
+	 * Key copies are never read by snapshot iterators,
+	 * so they may be freed immediately.
+	 */
+	smfree(&memtx_alloc, key, size);
+}
+
 void
 memtx_tuple_begin_snapshot()
 {
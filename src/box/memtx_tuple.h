@@ -63,6 +63,54 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end);
 void
 memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple);
 
+/**
+ * Create a copy of a memtx tuple. The copy has the same format
+ * and field map, so this is cheaper than memtx_tuple_new() on
+ * the tuple data. Used to patch a tuple without changing field
+ * offsets, see tuple_update_patch().
+ */
+struct tuple *
+memtx_tuple_dup(const struct tuple *tuple);
+
+/**
+ * Check if the data of a tuple may be changed in place, i.e.
+ * it isn't being written to a snapshot. The caller must also
+ * make sure nobody else references the tuple.
+ */
+bool
+memtx_tuple_is_mutable(const struct tuple *tuple);
+
+/**
+ * Copy the fields of a tuple indexed by a key definition to
+ * the memtx arena. The copy is a sequence of MessagePack fields
+ * without array header. Used by covering and multikey TREE
+ * indexes, @a multikey_idx is the index of the array item
+ * multikey parts refer to.
+ * The size of the copy is returned in @a size, even if there
+ * is not enough memory, in which case NULL is returned and
+ * diag is not set.
+ */
+char *
+memtx_tuple_key_new(const struct tuple *tuple, const struct key_def *key_def,
+		    uint32_t multikey_idx, uint32_t *size);
+
+/** Return the size of a key copy, see memtx_tuple_key_new(). */
+uint32_t
+memtx_tuple_key_size(const struct tuple *tuple, const struct key_def *key_def,
+		     uint32_t multikey_idx);
+
+/**
+ * Encode a key copy, see memtx_tuple_key_new(), to @a buf of
+ * memtx_tuple_key_size() bytes. Return the end of the key.
+ */
+char *
+memtx_tuple_key_encode(char *buf, const struct tuple *tuple,
+		       const struct key_def *key_def, uint32_t multikey_idx);
+
+/** Free a key allocated with memtx_tuple_key_new(). */
+void
+memtx_tuple_key_delete(char *key, uint32_t size);
+
 /** Maximal allowed tuple size (box.cfg.memtx_max_tuple_size) */
 extern size_t memtx_max_tuple_size;
 
@@ -36,6 +36,7 @@
 #include <small/mempool.h>
 #include <fiber.h>
 #include "errinj.h"
+#include "msgpuck.h"
 
 static struct mempool port_entry_pool;
 
@@ -44,7 +45,7 @@ port_add_tuple(struct port *port, struct tuple *tuple)
 {
 	struct port_entry *e;
 	if (port->size == 0) {
-		if (tuple_ref(tuple) != 0)
+		if (tuple != NULL && tuple_ref(tuple) != 0)
 			return -1;
 		e = &port->first_entry;
 		port->first = port->last = e;
@@ -55,7 +56,7 @@ port_add_tuple(struct port *port, struct tuple *tuple)
 			diag_set(OutOfMemory, sizeof(*e), "mempool_alloc", "e");
 			return -1;
 		}
-		if (tuple_ref(tuple) != 0) {
+		if (tuple != NULL && tuple_ref(tuple) != 0) {
 			mempool_free(&port_entry_pool, e);
 			return -1;
 		}
@@ -82,12 +83,14 @@ port_destroy(struct port *port)
 	struct port_entry *e = port->first;
 	if (e == NULL)
 		return;
-	tuple_unref(e->tuple);
+	if (e->tuple != NULL)
+		tuple_unref(e->tuple);
 	e = e->next;
 	while (e != NULL) {
 		struct port_entry *cur = e;
 		e = e->next;
-		tuple_unref(cur->tuple);
+		if (cur->tuple != NULL)
+			tuple_unref(cur->tuple);
 		mempool_free(&port_entry_pool, cur);
 	}
 }
@@ -96,6 +99,16 @@ int
 port_dump(struct port *port, struct obuf *out)
 {
 	for (struct port_entry *pe = port->first; pe != NULL; pe = pe->next) {
+		if (pe->tuple == NULL) {
+			char *nil = (char *) obuf_alloc(out, mp_sizeof_nil());
+			if (nil == NULL) {
+				diag_set(OutOfMemory, mp_sizeof_nil(),
+					 "obuf_alloc", "nil");
+				return -1;
+			}
+			mp_encode_nil(nil);
+			continue;
+		}
 		if (tuple_to_obuf(pe->tuple, out) != 0)
 			return -1;
 
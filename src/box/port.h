@@ -60,6 +60,11 @@ struct obuf;
 
 struct port_entry {
 	struct port_entry *next;
+	/**
+	 * Tuple or NULL. NULL entries are added by batched
+	 * lookups for keys that were not found and are
+	 * dumped as MsgPack nil.
+	 */
 	struct tuple *tuple;
 };
 
@@ -43,6 +43,13 @@ extern "C" {
 
 extern uint32_t schema_version;
 
+/**
+ * Incremented whenever a stored function is created, altered,
+ * dropped or reloaded, so that caches of resolved functions
+ * know when to flush.
+ */
+extern uint32_t func_cache_version;
+
 /**
  * Lock of schema modification
  */
@@ -34,11 +34,14 @@
 
 const struct space_opts space_opts_default = {
 	/* .temporary = */ false,
+	/* .field_map  = */ FIELD_MAP_INDEXED,
 	/* .sql        = */ NULL,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, temporary),
+	OPT_DEF_ENUM("field_map", field_map_mode, struct space_opts,
+		     field_map, NULL),
 	OPT_DEF("sql", OPT_STRPTR, struct space_opts, sql),
 	OPT_END,
 };
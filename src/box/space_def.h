@@ -49,6 +49,11 @@ struct space_opts {
 	 * - changes are not part of a snapshot
 	 */
 	bool temporary;
+	/**
+	 * Fields of the space tuples that get an offset slot
+	 * in the tuple field map.
+	 */
+	enum field_map_mode field_map;
 	/**
 	 * SQL statement that produced this space.
 	 */
@@ -138,12 +138,17 @@ tuple_validate_raw(struct tuple_format *format, const char *tuple)
 	}
 
 	/* Check field types */
+	const char *data = tuple;
 	for (uint32_t i = 0; i < format->field_count; i++) {
 		struct tuple_field *field = &format->fields[i];
 		if (key_mp_type_validate(field->type, mp_typeof(*tuple),
 					 ER_FIELD_TYPE, i + TUPLE_INDEX_BASE,
 					 field->is_nullable))
 			return -1;
+		if (field->has_paths &&
+		    tuple_field_check_paths(format, i, tuple, data,
+					    NULL) != 0)
+			return -1;
 		mp_next(&tuple);
 	}
 	return 0;
@@ -237,6 +242,19 @@ tuple_extract_key_sequential(const struct tuple *tuple,
 	return tuple_extract_key_sequential_raw(data, NULL, key_def, key_size);
 }
 
+/**
+ * Return true if the field indexed by key part @a part_no + 1
+ * follows the field indexed by part @a part_no in tuples, so
+ * that both can be copied to a key at once.
+ */
+static inline bool
+key_def_parts_are_sequential(const struct key_def *key_def, uint32_t part_no)
+{
+	const struct key_part *part = &key_def->parts[part_no];
+	return part->path == NULL && part[1].path == NULL &&
+	       part->fieldno + 1 == part[1].fieldno;
+}
+
 /**
  * General-purpose implementation of tuple_extract_key()
  * @copydoc tuple_extract_key()
@@ -254,16 +272,15 @@ tuple_extract_key_slowpath(const struct tuple *tuple,
 	/* Calculate the key size. */
 	for (uint32_t i = 0; i < part_count; ++i) {
 		const char *field =
-			tuple_field_raw(format, data, field_map,
-					key_def->parts[i].fieldno);
+			tuple_field_by_part_raw(format, data, field_map,
+						&key_def->parts[i]);
 		const char *end = field;
 		/*
 		 * Skip sequential part in order to minimize
 		 * tuple_field_raw() calls.
 		 */
 		for (; i < key_def->part_count - 1; i++) {
-			if (key_def->parts[i].fieldno + 1 !=
-				key_def->parts[i + 1].fieldno) {
+			if (!key_def_parts_are_sequential(key_def, i)) {
 				/* End of sequential part */
 				break;
 			}
@@ -281,16 +298,15 @@ tuple_extract_key_slowpath(const struct tuple *tuple,
 	char *key_buf = mp_encode_array(key, part_count);
 	for (uint32_t i = 0; i < part_count; ++i) {
 		const char *field =
-			tuple_field_raw(format, data, field_map,
-					key_def->parts[i].fieldno);
+			tuple_field_by_part_raw(format, data, field_map,
+						&key_def->parts[i]);
 		const char *end = field;
 		/*
 		 * Skip sequential part in order to minimize
 		 * tuple_field_raw() calls
 		 */
 		for (; i < key_def->part_count - 1; i++) {
-			if (key_def->parts[i].fieldno + 1 !=
-				key_def->parts[i + 1].fieldno) {
+			if (!key_def_parts_are_sequential(key_def, i)) {
 				/* End of sequential part */
 				break;
 			}
@@ -365,13 +381,65 @@ tuple_extract_key_slowpath_raw(const char *data, const char *data_end,
 	return key;
 }
 
+/**
+ * Version of tuple_extract_key_raw() for key defs with JSON
+ * paths. Values absent in the tuple are extracted as NULLs.
+ * @copydoc tuple_extract_key_raw()
+ */
+static char *
+tuple_extract_key_by_path_raw(const char *data, const char *data_end,
+			      const struct key_def *key_def,
+			      uint32_t *key_size)
+{
+	(void) data_end;
+	/* The runtime format has no field map, fields are scanned. */
+	const struct tuple_format *format = tuple_format_runtime;
+	uint32_t part_count = key_def->part_count;
+	uint32_t bsize = mp_sizeof_array(part_count);
+	for (uint32_t i = 0; i < part_count; i++) {
+		const char *field =
+			tuple_field_by_part_raw(format, data, NULL,
+						&key_def->parts[i]);
+		const char *end = field;
+		if (field != NULL)
+			mp_next(&end);
+		bsize += field != NULL ? end - field : mp_sizeof_nil();
+	}
+	char *key = (char *) region_alloc(&fiber()->gc, bsize);
+	if (key == NULL) {
+		diag_set(OutOfMemory, bsize, "region",
+			 "tuple_extract_key_raw");
+		return NULL;
+	}
+	char *key_buf = mp_encode_array(key, part_count);
+	for (uint32_t i = 0; i < part_count; i++) {
+		const char *field =
+			tuple_field_by_part_raw(format, data, NULL,
+						&key_def->parts[i]);
+		if (field == NULL) {
+			key_buf = mp_encode_nil(key_buf);
+			continue;
+		}
+		const char *end = field;
+		mp_next(&end);
+		memcpy(key_buf, field, end - field);
+		key_buf += end - field;
+	}
+	if (key_size != NULL)
+		*key_size = (uint32_t)(key_buf - key);
+	return key;
+}
+
 /**
  * Initialize tuple_extract_key() and tuple_extract_key_raw()
  */
 void
 tuple_extract_key_set(struct key_def *key_def)
 {
-	if (key_def_is_sequential(key_def)) {
+	if (key_def->has_json_paths) {
+		key_def->tuple_extract_key = tuple_extract_key_slowpath;
+		key_def->tuple_extract_key_raw = tuple_extract_key_by_path_raw;
+	} else if (key_def_is_sequential(key_def)) {
 		key_def->tuple_extract_key = tuple_extract_key_sequential;
 		key_def->tuple_extract_key_raw = tuple_extract_key_sequential_raw;
 	} else {
@@ -425,7 +425,8 @@ tuple_compare_slowpath(const struct tuple *tuple_a, const struct tuple *tuple_b,
 	const struct key_part *part = key_def->parts;
 	const char *tuple_a_raw = tuple_data(tuple_a);
 	const char *tuple_b_raw = tuple_data(tuple_b);
-	if (key_def->part_count == 1 && part->fieldno == 0) {
+	if (key_def->part_count == 1 && part->fieldno == 0 &&
+	    part->path == NULL) {
 		mp_decode_array(&tuple_a_raw);
 		mp_decode_array(&tuple_b_raw);
 		if (! is_nullable) {
@@ -458,10 +459,10 @@ tuple_compare_slowpath(const struct tuple *tuple_a, const struct tuple *tuple_b,
 		end = part + key_def->part_count;
 
 	for (; part < end; part++) {
-		field_a = tuple_field_raw(format_a, tuple_a_raw, field_map_a,
-					  part->fieldno);
-		field_b = tuple_field_raw(format_b, tuple_b_raw, field_map_b,
-					  part->fieldno);
+		field_a = tuple_field_by_part_raw(format_a, tuple_a_raw,
+						  field_map_a, part);
+		field_b = tuple_field_by_part_raw(format_b, tuple_b_raw,
+						  field_map_b, part);
 		assert(field_a != NULL && field_b != NULL);
 		if (! is_nullable) {
 			rc = tuple_compare_field(field_a, field_b, part->type,
@@ -502,10 +503,10 @@ tuple_compare_slowpath(const struct tuple *tuple_a, const struct tuple *tuple_b,
 	 */
 	end = key_def->parts + key_def->part_count;
 	for (; part < end; ++part) {
-		field_a = tuple_field_raw(format_a, tuple_a_raw, field_map_a,
-					  part->fieldno);
-		field_b = tuple_field_raw(format_b, tuple_b_raw, field_map_b,
-					  part->fieldno);
+		field_a = tuple_field_by_part_raw(format_a, tuple_a_raw,
+						  field_map_a, part);
+		field_b = tuple_field_by_part_raw(format_b, tuple_b_raw,
+						  field_map_b, part);
 		assert(field_a != NULL && field_b != NULL);
 		rc = tuple_compare_field(field_a, field_b, part->type,
 					 part->coll);
@@ -529,8 +530,8 @@ tuple_compare_with_key_slowpath(const struct tuple *tuple, const char *key,
 	const uint32_t *field_map = tuple_field_map(tuple);
 	if (likely(part_count == 1)) {
 		const char *field;
-		field = tuple_field_raw(format, tuple_raw, field_map,
-					part->fieldno);
+		field = tuple_field_by_part_raw(format, tuple_raw, field_map,
+						part);
 		if (! is_nullable) {
 			return tuple_compare_field(field, key, part->type,
 						   part->coll);
@@ -552,8 +553,8 @@ tuple_compare_with_key_slowpath(const struct tuple *tuple, const char *key,
 	int rc;
 	for (; part < end; ++part, mp_next(&key)) {
 		const char *field;
-		field = tuple_field_raw(format, tuple_raw, field_map,
-					part->fieldno);
+		field = tuple_field_by_part_raw(format, tuple_raw, field_map,
+						part);
 		if (! is_nullable) {
 			int rc = tuple_compare_field(field, key, part->type,
 						     part->coll);
@@ -687,6 +688,63 @@ key_compare(const char *key_a, const char *key_b,
 	}
 }
 
+int
+extracted_key_compare(const char *key_a, const char *key_b,
+		      const struct key_def *key_def)
+{
+	if (! key_def->is_nullable) {
+		return key_compare_parts<false, false>(key_a, key_b,
+						       key_def->part_count,
+						       key_def);
+	}
+	/* Same as tuple_compare_slowpath<true>(), but on keys. */
+	bool was_null_met = false;
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + key_def->unique_part_count;
+	int rc;
+	for (; part < end; ++part, mp_next(&key_a), mp_next(&key_b)) {
+		enum mp_type a_type = mp_typeof(*key_a);
+		enum mp_type b_type = mp_typeof(*key_b);
+		if (a_type == MP_NIL) {
+			if (b_type != MP_NIL)
+				return -1;
+			was_null_met = true;
+		} else if (b_type == MP_NIL) {
+			return 1;
+		} else {
+			rc = tuple_compare_field_with_hint(key_a, a_type, key_b,
+							   b_type, part->type,
+							   part->coll);
+			if (rc != 0)
+				return rc;
+		}
+	}
+	if (!was_null_met)
+		return 0;
+	end = key_def->parts + key_def->part_count;
+	for (; part < end; ++part, mp_next(&key_a), mp_next(&key_b)) {
+		rc = tuple_compare_field(key_a, key_b, part->type, part->coll);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+int
+extracted_key_compare_with_key(const char *key_a, const char *key_b,
+			       uint32_t part_count,
+			       const struct key_def *key_def)
+{
+	assert(part_count <= key_def->part_count);
+	if (! key_def->is_nullable) {
+		return key_compare_parts<false, false>(key_a, key_b, part_count,
+						       key_def);
+	} else {
+		return key_compare_parts<true, false>(key_a, key_b, part_count,
+						      key_def);
+	}
+}
+
 static int
 tuple_compare_sequential(const struct tuple *tuple_a,
 			 const struct tuple *tuple_b,
@@ -724,6 +782,36 @@ tuple_compare_sequential_nullable(const struct tuple *tuple_a,
 					     key_def);
 }
 
+/**
+ * Flag of a part type in a precompiled comparator signature:
+ * the part is nullable and NULL is less than any other value.
+ */
+enum { COMPARATOR_NULLABLE = 1 << 8 };
+
+#define NULLABLE(type) ((type) | COMPARATOR_NULLABLE)
+
+/** Type of a key part in a precompiled comparator signature. */
+static inline uint32_t
+comparator_part_type(const struct key_part *part)
+{
+	return part->is_nullable ? NULLABLE(part->type) : part->type;
+}
+
+/**
+ * Compare fields of a nullable part if at least one of them
+ * is NULL. Return false if both are not NULL.
+ */
+static inline bool
+field_compare_nil(const char *field_a, const char *field_b, int *r)
+{
+	bool a_is_nil = mp_typeof(*field_a) == MP_NIL;
+	bool b_is_nil = mp_typeof(*field_b) == MP_NIL;
+	if (!a_is_nil && !b_is_nil)
+		return false;
+	*r = a_is_nil ? (b_is_nil ? 0 : -1) : 1;
+	return true;
+}
+
 template <int TYPE>
 static inline int
 field_compare(const char **field_a, const char **field_b);
@@ -735,6 +823,21 @@ field_compare<FIELD_TYPE_UNSIGNED>(const char **field_a, const char **field_b)
 	return mp_compare_uint(*field_a, *field_b);
 }
 
+template <>
+inline int
+field_compare<FIELD_TYPE_INTEGER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_integer_with_hint(*field_a, mp_typeof(**field_a),
+					    *field_b, mp_typeof(**field_b));
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_NUMBER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_number(*field_a, *field_b);
+}
+
 template <>
 inline int
 field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
@@ -748,6 +851,19 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 	return r;
 }
 
+/** Nullable parts. */
+template <int TYPE>
+inline int
+field_compare(const char **field_a, const char **field_b)
+{
+	static_assert((TYPE & COMPARATOR_NULLABLE) != 0,
+		      "no comparator for the field type");
+	int r;
+	if (field_compare_nil(*field_a, *field_b, &r))
+		return r;
+	return field_compare<TYPE & ~COMPARATOR_NULLABLE>(field_a, field_b);
+}
+
 template <int TYPE>
 static inline int
 field_compare_and_next(const char **field_a, const char **field_b);
@@ -763,6 +879,28 @@ field_compare_and_next<FIELD_TYPE_UNSIGNED>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_INTEGER>(const char **field_a,
+					   const char **field_b)
+{
+	int r = field_compare<FIELD_TYPE_INTEGER>(field_a, field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
+template <>
+inline int
+field_compare_and_next<FIELD_TYPE_NUMBER>(const char **field_a,
+					  const char **field_b)
+{
+	int r = mp_compare_number(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 template <>
 inline int
 field_compare_and_next<FIELD_TYPE_STRING>(const char **field_a,
@@ -779,9 +917,40 @@ field_compare_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	return r;
 }
 
+/** Nullable parts. */
+template <int TYPE>
+inline int
+field_compare_and_next(const char **field_a, const char **field_b)
+{
+	static_assert((TYPE & COMPARATOR_NULLABLE) != 0,
+		      "no comparator for the field type");
+	int r;
+	if (field_compare_nil(*field_a, *field_b, &r)) {
+		mp_next(field_a);
+		mp_next(field_b);
+		return r;
+	}
+	return field_compare_and_next<TYPE & ~COMPARATOR_NULLABLE>(field_a,
+								   field_b);
+}
+
 /* Tuple comparator */
 namespace /* local symbols */ {
 
+/** Check if a comparator signature has a nullable part. */
+template <int IDX, int TYPE, int ...MORE_TYPES>
+struct SignatureIsNullable
+{
+	static const bool value = (TYPE & COMPARATOR_NULLABLE) != 0 ||
+				  SignatureIsNullable<MORE_TYPES...>::value;
+};
+
+template <int IDX, int TYPE>
+struct SignatureIsNullable<IDX, TYPE>
+{
+	static const bool value = (TYPE & COMPARATOR_NULLABLE) != 0;
+};
+
 template <int IDX, int TYPE, int ...MORE_TYPES> struct FieldCompare { };
 
 /**
@@ -841,8 +1010,16 @@ struct TupleCompare
 {
 	static int compare(const struct tuple *tuple_a,
 			   const struct tuple *tuple_b,
-			   const struct key_def *)
+			   const struct key_def *key_def)
 	{
+		/*
+		 * Parts of a unique nullable index are compared
+		 * up to the first NULL, see the slow path.
+		 */
+		if (SignatureIsNullable<IDX, TYPE, MORE_TYPES...>::value &&
+		    key_def->unique_part_count < key_def->part_count)
+			return tuple_compare_slowpath<true>(tuple_a, tuple_b,
+							    key_def);
 		struct tuple_format *format_a = tuple_format(tuple_a);
 		struct tuple_format *format_b = tuple_format(tuple_b);
 		const char *field_a, *field_b;
@@ -860,8 +1037,12 @@ template <int TYPE, int ...MORE_TYPES>
 struct TupleCompare<0, TYPE, MORE_TYPES...> {
 	static int compare(const struct tuple *tuple_a,
 			   const struct tuple *tuple_b,
-			   const struct key_def *)
+			   const struct key_def *key_def)
 	{
+		if (SignatureIsNullable<0, TYPE, MORE_TYPES...>::value &&
+		    key_def->unique_part_count < key_def->part_count)
+			return tuple_compare_slowpath<true>(tuple_a, tuple_b,
+							    key_def);
 		struct tuple_format *format_a = tuple_format(tuple_a);
 		struct tuple_format *format_b = tuple_format(tuple_b);
 		const char *field_a = tuple_data(tuple_a);
@@ -883,14 +1064,42 @@ struct comparator_signature {
 
 /**
  * field1 no, field1 type, field2 no, field2 type, ...
+ * Types of nullable parts are marked with NULLABLE().
  */
 static const comparator_signature cmp_arr[] = {
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, NULLABLE(FIELD_TYPE_UNSIGNED))
+	COMPARATOR(0, NULLABLE(FIELD_TYPE_STRING))
+	COMPARATOR(0, NULLABLE(FIELD_TYPE_INTEGER))
+	COMPARATOR(0, NULLABLE(FIELD_TYPE_NUMBER))
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_NUMBER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_NUMBER)
+	/* Secondary keys over the second field. */
+	COMPARATOR(1, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(1, FIELD_TYPE_STRING  , 0, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(1, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(1, FIELD_TYPE_NUMBER  , 0, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(1, NULLABLE(FIELD_TYPE_UNSIGNED), 0, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(1, NULLABLE(FIELD_TYPE_STRING)  , 0, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(1, NULLABLE(FIELD_TYPE_INTEGER) , 0, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(1, NULLABLE(FIELD_TYPE_NUMBER)  , 0, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
@@ -899,16 +1108,18 @@ static const comparator_signature cmp_arr[] = {
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
 };
 
 #undef COMPARATOR
 
 tuple_compare_t
 tuple_compare_create(const struct key_def *def) {
-	if (def->is_nullable) {
-		if (key_def_is_sequential(def))
-			return tuple_compare_sequential_nullable;
-		return tuple_compare_slowpath<true>;
+	if (def->has_json_paths) {
+		if (def->is_nullable)
+			return tuple_compare_slowpath<true>;
+		return tuple_compare_slowpath<false>;
 	}
 	if (!key_def_has_collation(def)) {
 		/* Precalculated comparators don't use collation */
@@ -918,7 +1129,7 @@ tuple_compare_create(const struct key_def *def) {
 			for (; i < def->part_count; i++)
 				if (def->parts[i].fieldno !=
 				    cmp_arr[k].p[i * 2] ||
-				    def->parts[i].type !=
+				    comparator_part_type(&def->parts[i]) !=
 				    cmp_arr[k].p[i * 2 + 1])
 					break;
 			if (i == def->part_count &&
@@ -926,6 +1137,11 @@ tuple_compare_create(const struct key_def *def) {
 				return cmp_arr[k].f;
 		}
 	}
+	if (def->is_nullable) {
+		if (key_def_is_sequential(def))
+			return tuple_compare_sequential_nullable;
+		return tuple_compare_slowpath<true>;
+	}
 	if (key_def_is_sequential(def))
 		return tuple_compare_sequential;
 	return tuple_compare_slowpath<false>;
@@ -945,6 +1161,21 @@ field_compare_with_key<FIELD_TYPE_UNSIGNED>(const char **field, const char **key
 	return mp_compare_uint(*field, *key);
 }
 
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_INTEGER>(const char **field, const char **key)
+{
+	return mp_compare_integer_with_hint(*field, mp_typeof(**field),
+					    *key, mp_typeof(**key));
+}
+
+template <>
+inline int
+field_compare_with_key<FIELD_TYPE_NUMBER>(const char **field, const char **key)
+{
+	return mp_compare_number(*field, *key);
+}
+
 template <>
 inline int
 field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
@@ -958,6 +1189,19 @@ field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
 	return r;
 }
 
+/** Nullable parts. */
+template <int TYPE>
+inline int
+field_compare_with_key(const char **field, const char **key)
+{
+	static_assert((TYPE & COMPARATOR_NULLABLE) != 0,
+		      "no comparator for the field type");
+	int r;
+	if (field_compare_nil(*field, *key, &r))
+		return r;
+	return field_compare_with_key<TYPE & ~COMPARATOR_NULLABLE>(field, key);
+}
+
 template <int TYPE>
 static inline int
 field_compare_with_key_and_next(const char **field_a, const char **field_b);
@@ -973,6 +1217,28 @@ field_compare_with_key_and_next<FIELD_TYPE_UNSIGNED>(const char **field_a,
 	return r;
 }
 
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_INTEGER>(const char **field_a,
+						    const char **field_b)
+{
+	int r = field_compare_with_key<FIELD_TYPE_INTEGER>(field_a, field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
+template <>
+inline int
+field_compare_with_key_and_next<FIELD_TYPE_NUMBER>(const char **field_a,
+						   const char **field_b)
+{
+	int r = mp_compare_number(*field_a, *field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
+
 template <>
 inline int
 field_compare_with_key_and_next<FIELD_TYPE_STRING>(const char **field_a,
@@ -989,6 +1255,23 @@ field_compare_with_key_and_next<FIELD_TYPE_STRING>(const char **field_a,
 	return r;
 }
 
+/** Nullable parts. */
+template <int TYPE>
+inline int
+field_compare_with_key_and_next(const char **field_a, const char **field_b)
+{
+	static_assert((TYPE & COMPARATOR_NULLABLE) != 0,
+		      "no comparator for the field type");
+	int r;
+	if (field_compare_nil(*field_a, *field_b, &r)) {
+		mp_next(field_a);
+		mp_next(field_b);
+		return r;
+	}
+	return field_compare_with_key_and_next<TYPE & ~COMPARATOR_NULLABLE>(
+		field_a, field_b);
+}
+
 /* Tuple with key comparator */
 namespace /* local symbols */ {
 
@@ -1092,7 +1375,14 @@ struct comparator_with_key_signature
 #define KEY_COMPARATOR(...) \
 	{ TupleCompareWithKey<0, __VA_ARGS__>::compare, { __VA_ARGS__ } },
 
+/**
+ * A comparator is used for keys matching a prefix of its
+ * signature, so longer signatures go first.
+ */
 static const comparator_with_key_signature cmp_wk_arr[] = {
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED, 3, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING  , 3, FIELD_TYPE_STRING)
+
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
@@ -1102,10 +1392,37 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_INTEGER , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_STRING)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_NUMBER  , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_INTEGER)
+	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_NUMBER)
+	KEY_COMPARATOR(0, NULLABLE(FIELD_TYPE_UNSIGNED))
+	KEY_COMPARATOR(0, NULLABLE(FIELD_TYPE_STRING))
+	KEY_COMPARATOR(0, NULLABLE(FIELD_TYPE_INTEGER))
+	KEY_COMPARATOR(0, NULLABLE(FIELD_TYPE_NUMBER))
+
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
+
+	/* Secondary keys over the second field. */
+	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 0, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 0, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, FIELD_TYPE_INTEGER , 0, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, FIELD_TYPE_NUMBER  , 0, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, NULLABLE(FIELD_TYPE_UNSIGNED), 0, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, NULLABLE(FIELD_TYPE_STRING)  , 0, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, NULLABLE(FIELD_TYPE_INTEGER) , 0, FIELD_TYPE_UNSIGNED)
+	KEY_COMPARATOR(1, NULLABLE(FIELD_TYPE_NUMBER)  , 0, FIELD_TYPE_UNSIGNED)
 };
 
 #undef KEY_COMPARATOR
@@ -1113,10 +1430,10 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 tuple_compare_with_key_t
 tuple_compare_with_key_create(const struct key_def *def)
 {
-	if (def->is_nullable) {
-		if (key_def_is_sequential(def))
-			return tuple_compare_with_key_sequential<true>;
-		return tuple_compare_with_key_slowpath<true>;
+	if (def->has_json_paths) {
+		if (def->is_nullable)
+			return tuple_compare_with_key_slowpath<true>;
+		return tuple_compare_with_key_slowpath<false>;
 	}
 	if (!key_def_has_collation(def)) {
 		/* Precalculated comparators don't use collation */
@@ -1128,7 +1445,7 @@ tuple_compare_with_key_create(const struct key_def *def)
 			for (; i < def->part_count; i++) {
 				if (def->parts[i].fieldno !=
 				    cmp_wk_arr[k].p[i * 2] ||
-				    def->parts[i].type !=
+				    comparator_part_type(&def->parts[i]) !=
 				    cmp_wk_arr[k].p[i * 2 + 1]) {
 					break;
 				}
@@ -1137,6 +1454,11 @@ tuple_compare_with_key_create(const struct key_def *def)
 				return cmp_wk_arr[k].f;
 		}
 	}
+	if (def->is_nullable) {
+		if (key_def_is_sequential(def))
+			return tuple_compare_with_key_sequential<true>;
+		return tuple_compare_with_key_slowpath<true>;
+	}
 	if (key_def_is_sequential(def))
 		return tuple_compare_with_key_sequential<false>;
 	return tuple_compare_with_key_slowpath<false>;
@@ -72,6 +72,42 @@ int
 key_compare(const char *key_a, const char *key_b,
 	    const struct key_def *key_def);
 
+/**
+ * Compare keys that contain all parts of the key definition,
+ * e.g. copies stored in a covering index. The result is the
+ * same as of tuple_compare() called for the tuples the keys
+ * were extracted from.
+ * @param key_a key parts without MessagePack array header
+ * @param key_b key parts without MessagePack array header
+ * @param key_def key definition
+ *
+ * @retval 0  if key_a == key_b
+ * @retval <0 if key_a < key_b
+ * @retval >0 if key_a > key_b
+ */
+int
+extracted_key_compare(const char *key_a, const char *key_b,
+		      const struct key_def *key_def);
+
+/**
+ * Compare a key that contains all parts of the key definition
+ * with a search key. The result is the same as of
+ * tuple_compare_with_key() called for the tuple the key was
+ * extracted from.
+ * @param key_a key parts without MessagePack array header
+ * @param key_b key parts without MessagePack array header
+ * @param part_count the number of parts in @a key_b
+ * @param key_def key definition
+ *
+ * @retval 0  if key_a == key_b
+ * @retval <0 if key_a < key_b
+ * @retval >0 if key_a > key_b
+ */
+int
+extracted_key_compare_with_key(const char *key_a, const char *key_b,
+			       uint32_t part_count,
+			       const struct key_def *key_def);
+
 /**
  * Compare tuples using the key definition.
  * @param tuple_a first tuple
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "tuple_format.h"
+#include "json_path.h"
 
 field_name_hash_f field_name_hash;
 
@@ -61,11 +62,16 @@ struct tuple_format **tuple_formats;
 static intptr_t recycled_format_ids = FORMAT_ID_NIL;
 
 static uint32_t formats_size = 0, formats_capacity = 0;
+/** Epoch of the last created format. */
+static uint64_t formats_epoch = 0;
 
 static const struct tuple_field tuple_field_default = {
-	FIELD_TYPE_ANY, TUPLE_OFFSET_SLOT_NIL, false, NULL, false,
+	FIELD_TYPE_ANY, TUPLE_OFFSET_SLOT_NIL, false, NULL, false, false, 0,
 };
 
+/** Returned for absent values indexed by JSON paths. */
+static const char tuple_field_path_nil[] = { (char)0xc0 };
+
 /**
  * Add @a name to a name hash of @a format.
  * @param format Format to add name.
@@ -103,6 +109,93 @@ tuple_format_add_name(struct tuple_format *format, const char *name,
 	return 0;
 }
 
+/**
+ * Add a value indexed by a key part with a JSON path to a format.
+ * @param format Format.
+ * @param part Key part with a path.
+ * @param current_slot The last allocated offset slot.
+ * @param path_pos Where to copy the path string to, advanced
+ *                 if the path is new to the format.
+ *
+ * @retval -1 Type conflict.
+ * @retval  0 Success.
+ */
+static int
+tuple_format_add_path(struct tuple_format *format, const struct key_part *part,
+		      int *current_slot, char **path_pos)
+{
+	struct tuple_field *field = &format->fields[part->fieldno];
+	/* The first path token tells if the field is a map or an array. */
+	enum field_type field_type = part->path[0] == '.' ?
+				     FIELD_TYPE_MAP : FIELD_TYPE_ARRAY;
+	if (field->type == FIELD_TYPE_ANY) {
+		field->type = field_type;
+	} else if (field->type != field_type) {
+		diag_set(ClientError, ER_FIELD_TYPE_MISMATCH,
+			 part->fieldno + TUPLE_INDEX_BASE,
+			 field_type_strs[field_type],
+			 field_type_strs[field->type]);
+		return -1;
+	}
+	field->is_key_part = true;
+	field->has_paths = true;
+	/*
+	 * Values of multikey paths are looked up on each access,
+	 * store the offset of the field to start from.
+	 */
+	if (part->multikey_len != 0 && part->fieldno > 0 &&
+	    field->offset_slot == TUPLE_OFFSET_SLOT_NIL)
+		field->offset_slot = --*current_slot;
+
+	struct tuple_field_path *path = format->paths;
+	struct tuple_field_path *end = path + format->path_count;
+	for (; path < end; path++) {
+		if (path->fieldno != part->fieldno ||
+		    path->path_len != part->path_len ||
+		    memcmp(path->path, part->path, part->path_len) != 0)
+			continue;
+		if (path->type != part->type) {
+			diag_set(ClientError, ER_FIELD_TYPE_MISMATCH,
+				 part->fieldno + TUPLE_INDEX_BASE,
+				 field_type_strs[part->type],
+				 field_type_strs[path->type]);
+			return -1;
+		}
+		/* A value must satisfy all indexes using it. */
+		path->is_nullable &= part->is_nullable;
+		return 0;
+	}
+	memcpy(*path_pos, part->path, part->path_len + 1);
+	path->fieldno = part->fieldno;
+	path->path = *path_pos;
+	path->path_len = part->path_len;
+	path->multikey_len = part->multikey_len;
+	path->type = part->type;
+	path->is_nullable = part->is_nullable;
+	path->offset_slot = part->multikey_len == 0 ?
+			    --*current_slot : TUPLE_OFFSET_SLOT_NIL;
+	*path_pos += part->path_len + 1;
+	format->path_count++;
+	return 0;
+}
+
+/**
+ * Point each field without an offset slot to the closest
+ * preceding field with one, see tuple_field::anchor_fieldno.
+ */
+static void
+tuple_format_set_anchors(struct tuple_format *format)
+{
+	uint32_t anchor_fieldno = 0;
+	for (uint32_t i = 1; i < format->field_count; i++) {
+		struct tuple_field *field = &format->fields[i];
+		if (field->offset_slot != TUPLE_OFFSET_SLOT_NIL)
+			anchor_fieldno = i;
+		else
+			field->anchor_fieldno = anchor_fieldno;
+	}
+}
+
 /**
  * Extract all available type info from keys and field
  * definitions.
@@ -118,9 +211,36 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 	}
 	char *name_pos = (char *)format + sizeof(*format) +
 			 sizeof(struct tuple_field) * format->field_count;
+	/* Allocate the maximal possible number of indexed paths. */
+	uint32_t path_count = 0;
+	uint32_t paths_size = 0;
+	for (uint16_t key_no = 0; key_no < key_count; ++key_no) {
+		const struct key_def *key_def = keys[key_no];
+		for (uint32_t i = 0; i < key_def->part_count; i++) {
+			const struct key_part *part = &key_def->parts[i];
+			if (part->path == NULL)
+				continue;
+			path_count++;
+			paths_size += sizeof(struct tuple_field_path) +
+				      part->path_len + 1;
+		}
+	}
+	char *path_pos = NULL;
+	if (path_count > 0) {
+		format->paths = (struct tuple_field_path *)malloc(paths_size);
+		if (format->paths == NULL) {
+			diag_set(OutOfMemory, paths_size, "malloc",
+				 "format->paths");
+			return -1;
+		}
+		format->paths_size = paths_size;
+		path_pos = (char *)(format->paths + path_count);
+	}
 	/* Initialize defined fields */
 	for (uint32_t i = 0; i < field_count; ++i) {
 		format->fields[i].is_key_part = false;
+		format->fields[i].has_paths = false;
+		format->fields[i].anchor_fieldno = 0;
 		format->fields[i].type = fields[i].type;
 		format->fields[i].offset_slot = TUPLE_OFFSET_SLOT_NIL;
 		format->fields[i].is_nullable = fields[i].is_nullable;
@@ -147,6 +267,13 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 
 		for (; part < parts_end; part++) {
 			assert(part->fieldno < format->field_count);
+			if (part->path != NULL) {
+				if (tuple_format_add_path(format, part,
+							  &current_slot,
+							  &path_pos) != 0)
+					return -1;
+				continue;
+			}
 			struct tuple_field *field =
 				&format->fields[part->fieldno];
 			if (part->fieldno >= field_count) {
@@ -198,6 +325,7 @@ tuple_format_create(struct tuple_format *format, struct key_def * const *keys,
 		return -1;
 	}
 	format->field_map_size = field_map_size;
+	tuple_format_set_anchors(format);
 	return 0;
 }
 
@@ -294,6 +422,10 @@ tuple_format_alloc(struct key_def * const *keys, uint16_t key_count,
 	}
 	format->refs = 0;
 	format->id = FORMAT_ID_NIL;
+	format->epoch = ++formats_epoch;
+	format->path_count = 0;
+	format->paths_size = 0;
+	format->paths = NULL;
 	format->field_count = field_count;
 	format->index_field_count = index_field_count;
 	format->exact_field_count = 0;
@@ -317,6 +449,7 @@ tuple_format_destroy(struct tuple_format *format)
 		}
 		mh_strnu32_delete(format->names);
 	}
+	free(format->paths);
 }
 
 void
@@ -352,6 +485,52 @@ tuple_format_new(struct tuple_format_vtab *vtab, struct key_def * const *keys,
 	return format;
 }
 
+/**
+ * Choose the distance between fields with offset slots for
+ * FIELD_MAP_SPARSE. A slot costs 4 bytes in every tuple, while
+ * access to a field without one costs up to stride - 1 mp_next()
+ * calls. With the stride close to the square root of the field
+ * count both costs grow as the square root of the field count.
+ */
+static uint32_t
+tuple_format_sparse_stride(uint32_t field_count)
+{
+	uint32_t stride = FIELD_MAP_SPARSE_STRIDE_MIN;
+	while (stride * stride < field_count)
+		stride++;
+	return stride;
+}
+
+int
+tuple_format_add_offset_slots(struct tuple_format *format,
+			      enum field_map_mode mode)
+{
+	if (mode == FIELD_MAP_INDEXED || format->field_count == 0)
+		return 0;
+	uint32_t stride = mode == FIELD_MAP_FULL ? 1 :
+			  tuple_format_sparse_stride(format->field_count);
+	int current_slot = -(int)(format->field_map_size / sizeof(uint32_t));
+	uint32_t anchor_fieldno = 0;
+	for (uint32_t i = 1; i < format->field_count; i++) {
+		struct tuple_field *field = &format->fields[i];
+		if (field->offset_slot == TUPLE_OFFSET_SLOT_NIL &&
+		    i - anchor_fieldno >= stride)
+			field->offset_slot = --current_slot;
+		if (field->offset_slot != TUPLE_OFFSET_SLOT_NIL)
+			anchor_fieldno = i;
+	}
+	size_t field_map_size = -current_slot * sizeof(uint32_t);
+	if (field_map_size + format->extra_size > UINT16_MAX) {
+		/** tuple->data_offset is 16 bits */
+		diag_set(ClientError, ER_INDEX_FIELD_COUNT_LIMIT,
+			 -current_slot);
+		return -1;
+	}
+	format->field_map_size = field_map_size;
+	tuple_format_set_anchors(format);
+	return 0;
+}
+
 bool
 tuple_format_eq(const struct tuple_format *a, const struct tuple_format *b)
 {
@@ -367,6 +546,20 @@ tuple_format_eq(const struct tuple_format *a, const struct tuple_format *b)
 		if (a->fields[i].is_nullable != b->fields[i].is_nullable)
 			return false;
 	}
+	if (a->path_count != b->path_count)
+		return false;
+	for (uint32_t i = 0; i < a->path_count; ++i) {
+		const struct tuple_field_path *path_a = &a->paths[i];
+		const struct tuple_field_path *path_b = &b->paths[i];
+		if (path_a->fieldno != path_b->fieldno ||
+		    path_a->path_len != path_b->path_len ||
+		    memcmp(path_a->path, path_b->path, path_a->path_len) != 0)
+			return false;
+		if (path_a->type != path_b->type ||
+		    path_a->is_nullable != path_b->is_nullable ||
+		    path_a->offset_slot != path_b->offset_slot)
+			return false;
+	}
 	return true;
 }
 
@@ -387,6 +580,23 @@ tuple_format_dup(const struct tuple_format *src)
 		return NULL;
 	}
 	memcpy(format, src, total);
+	format->epoch = ++formats_epoch;
+	format->paths = NULL;
+	if (src->path_count != 0) {
+		format->paths = (struct tuple_field_path *)
+			malloc(src->paths_size);
+		if (format->paths == NULL) {
+			diag_set(OutOfMemory, src->paths_size, "malloc",
+				 "format->paths");
+			goto error_paths;
+		}
+		memcpy(format->paths, src->paths, src->paths_size);
+		/* Path strings follow the array, relocate them. */
+		for (uint32_t i = 0; i < src->path_count; ++i) {
+			format->paths[i].path = (const char *)format->paths +
+				(src->paths[i].path - (const char *)src->paths);
+		}
+	}
 	if (name_count != 0) {
 		format->names = mh_strnu32_new();
 		if (format->names == NULL) {
@@ -424,6 +634,8 @@ tuple_format_dup(const struct tuple_format *src)
 error_name_hash_reserve:
 	mh_strnu32_delete(format->names);
 error_name_hash_new:
+	free(format->paths);
+error_paths:
 	free(format);
 	return NULL;
 }
@@ -460,6 +672,9 @@ tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 	if (key_mp_type_validate(field->type, mp_type, ER_FIELD_TYPE,
 				 TUPLE_INDEX_BASE, field->is_nullable))
 		return -1;
+	if (field->has_paths &&
+	    tuple_field_check_paths(format, 0, pos, tuple, field_map) != 0)
+		return -1;
 	mp_next(&pos);
 	/* other fields...*/
 	++field;
@@ -473,11 +688,153 @@ tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 			field_map[field->offset_slot] =
 				(uint32_t) (pos - tuple);
 		}
+		if (field->has_paths &&
+		    tuple_field_check_paths(format, i, pos, tuple,
+					    field_map) != 0)
+			return -1;
 		mp_next(&pos);
 	}
 	return 0;
 }
 
+/** Check a value indexed by a path, NULL if the value is absent. */
+static inline int
+tuple_field_path_check_value(const struct tuple_field_path *path,
+			     const char *value)
+{
+	if (value == NULL) {
+		if (path->is_nullable)
+			return 0;
+		diag_set(ClientError, ER_FIELD_TYPE,
+			 path->fieldno + TUPLE_INDEX_BASE,
+			 field_type_strs[path->type]);
+		return -1;
+	}
+	return key_mp_type_validate(path->type, mp_typeof(*value),
+				    ER_FIELD_TYPE,
+				    path->fieldno + TUPLE_INDEX_BASE,
+				    path->is_nullable);
+}
+
+int
+tuple_field_check_paths(const struct tuple_format *format, uint32_t fieldno,
+			const char *field, const char *tuple,
+			uint32_t *field_map)
+{
+	const struct tuple_field_path *path = format->paths;
+	const struct tuple_field_path *end = path + format->path_count;
+	for (; path < end; path++) {
+		if (path->fieldno != fieldno)
+			continue;
+		if (path->multikey_len == 0) {
+			const char *value = json_path_find(field, path->path,
+							   path->path_len, 0);
+			if (tuple_field_path_check_value(path, value) != 0)
+				return -1;
+			if (field_map != NULL) {
+				field_map[path->offset_slot] = value == NULL ?
+					0 : (uint32_t) (value - tuple);
+			}
+			continue;
+		}
+		/* Check the value of each item of a multikey array. */
+		const char *item = json_path_find(field, path->path,
+						  path->multikey_len -
+						  strlen("[*]"), 0);
+		if (item == NULL || mp_typeof(*item) != MP_ARRAY) {
+			if (path->is_nullable &&
+			    (item == NULL || mp_typeof(*item) == MP_NIL))
+				continue;
+			diag_set(ClientError, ER_FIELD_TYPE,
+				 fieldno + TUPLE_INDEX_BASE,
+				 field_type_strs[FIELD_TYPE_ARRAY]);
+			return -1;
+		}
+		const char *suffix = path->path + path->multikey_len;
+		uint32_t suffix_len = path->path_len - path->multikey_len;
+		uint32_t count = mp_decode_array(&item);
+		for (uint32_t i = 0; i < count; i++) {
+			const char *value = json_path_find(item, suffix,
+							   suffix_len, 0);
+			if (tuple_field_path_check_value(path, value) != 0)
+				return -1;
+			mp_next(&item);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Find the offset slot of a key part path in a format. The slot
+ * is cached in the part until it is used with another format.
+ */
+static inline int32_t
+tuple_format_path_slot(const struct tuple_format *format,
+		       const struct key_part *part)
+{
+	if (likely(part->format_epoch == format->epoch))
+		return part->offset_slot_cache;
+	int32_t offset_slot = TUPLE_OFFSET_SLOT_NIL;
+	const struct tuple_field_path *path = format->paths;
+	const struct tuple_field_path *end = path + format->path_count;
+	for (; path < end; path++) {
+		if (path->fieldno == part->fieldno &&
+		    path->path_len == part->path_len &&
+		    memcmp(path->path, part->path, part->path_len) == 0) {
+			offset_slot = path->offset_slot;
+			break;
+		}
+	}
+	/* The cache is not a part of the key definition. */
+	struct key_part *cache = (struct key_part *)part;
+	cache->offset_slot_cache = offset_slot;
+	cache->format_epoch = format->epoch;
+	return offset_slot;
+}
+
+const char *
+tuple_field_raw_by_path(const struct tuple_format *format, const char *tuple,
+			const uint32_t *field_map, const struct key_part *part,
+			uint32_t multikey_idx)
+{
+	assert(part->path != NULL);
+	if (part->multikey_len == 0) {
+		int32_t offset_slot = tuple_format_path_slot(format, part);
+		if (offset_slot != TUPLE_OFFSET_SLOT_NIL) {
+			uint32_t offset = field_map[offset_slot];
+			return offset != 0 ? tuple + offset :
+			       tuple_field_path_nil;
+		}
+	}
+	/* The format does not know the path, look the value up. */
+	const char *field = tuple_field_raw(format, tuple, field_map,
+					    part->fieldno);
+	if (field != NULL) {
+		field = json_path_find(field, part->path, part->path_len,
+				       multikey_idx);
+	}
+	return field != NULL ? field : tuple_field_path_nil;
+}
+
+uint32_t
+tuple_multikey_count(const struct tuple_format *format, const char *tuple,
+		     const uint32_t *field_map, const struct key_def *key_def)
+{
+	assert(key_def->is_multikey);
+	const struct key_part *part = key_def->parts;
+	while (part->multikey_len == 0)
+		part++;
+	const char *field = tuple_field_raw(format, tuple, field_map,
+					    part->fieldno);
+	if (field == NULL)
+		return 0;
+	field = json_path_find(field, part->path,
+			       part->multikey_len - strlen("[*]"), 0);
+	if (field == NULL || mp_typeof(*field) != MP_ARRAY)
+		return 0;
+	return mp_decode_array(&field);
+}
+
 /** Destroy tuple format subsystem and free resourses */
 void
 tuple_format_free()
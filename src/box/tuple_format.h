@@ -59,6 +59,11 @@ enum { TUPLE_INDEX_BASE = 1 };
  * an offset for a field_id.
  */
 enum { TUPLE_OFFSET_SLOT_NIL = INT32_MAX };
+/**
+ * The minimal distance between fields with offset slots in
+ * a format with FIELD_MAP_SPARSE.
+ */
+enum { FIELD_MAP_SPARSE_STRIDE_MIN = 4 };
 
 struct tuple;
 struct tuple_format;
@@ -99,6 +104,39 @@ struct tuple_field {
 	char *name;
 	/** True, if a field can store NULL. */
 	bool is_nullable;
+	/** True if values nested in this field are indexed. */
+	bool has_paths;
+	/**
+	 * Number of the closest preceding field that has an
+	 * offset slot, 0 if there is none. A field without a slot
+	 * is found by skipping fields starting from that one.
+	 */
+	uint32_t anchor_fieldno;
+};
+
+/**
+ * A value nested in a tuple field and indexed by a JSON path,
+ * see key_part::path.
+ */
+struct tuple_field_path {
+	/** Number of the field the path is applied to. */
+	uint32_t fieldno;
+	/** Zero-terminated JSON path. */
+	const char *path;
+	/** Length of @a path. */
+	uint32_t path_len;
+	/** @sa key_part::multikey_len. */
+	uint32_t multikey_len;
+	/** Type of the value. */
+	enum field_type type;
+	/** True if the value can be NULL or absent. */
+	bool is_nullable;
+	/**
+	 * Offset slot of the value in the field map, or
+	 * TUPLE_OFFSET_SLOT_NIL for multikey paths, which address
+	 * many values. The slot stores 0 if the value is absent.
+	 */
+	int32_t offset_slot;
 };
 
 struct mh_strnu32_t;
@@ -141,6 +179,17 @@ struct tuple_format {
 	uint32_t field_count;
 	/** Field names hash. Key - name, value - field number. */
 	struct mh_strnu32_t *names;
+	/**
+	 * Unique identifier of the format contents, never
+	 * reused unlike @a id. See key_part::offset_slot_cache.
+	 */
+	uint64_t epoch;
+	/** Length of 'paths' array. */
+	uint32_t path_count;
+	/** Size of memory allocated for 'paths' and their strings. */
+	uint32_t paths_size;
+	/** Indexed JSON paths, followed by the path strings. */
+	struct tuple_field_path *paths;
 	/* Formats of the fields */
 	struct tuple_field fields[0];
 };
@@ -197,6 +246,22 @@ tuple_format_new(struct tuple_format_vtab *vtab, struct key_def * const *keys,
 		 const struct field_def *space_fields,
 		 uint32_t space_field_count);
 
+/**
+ * Give offset slots to fields not used by indexes, see enum
+ * field_map_mode. Only fields, which every tuple of the format
+ * has, i.e. defined in the space format or preceding an indexed
+ * field, can get a slot. Must be called before any tuple of the
+ * format is created.
+ * @param format Tuple format.
+ * @param mode Which fields should get a slot.
+ *
+ * @retval  0 Success.
+ * @retval -1 The field map is too big.
+ */
+int
+tuple_format_add_offset_slots(struct tuple_format *format,
+			      enum field_map_mode mode);
+
 /**
  * Check that two tuple formats are identical.
  * @param a format a
@@ -281,6 +346,25 @@ int
 tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 		     const char *tuple);
 
+/**
+ * Check values indexed by JSON paths inside a tuple field and,
+ * if @a field_map is not NULL, store their offsets in the field
+ * map.
+ * @param format Tuple format.
+ * @param fieldno Field number.
+ * @param field The field.
+ * @param tuple MessagePack array the field belongs to.
+ * @param field_map A pointer behind the last element of the
+ *                  field map or NULL.
+ *
+ * @retval  0 Success.
+ * @retval -1 Format error.
+ */
+int
+tuple_field_check_paths(const struct tuple_format *format, uint32_t fieldno,
+			const char *field, const char *tuple,
+			uint32_t *field_map);
+
 /**
  * Get a field at the specific position in this MessagePack array.
  * Returns a pointer to MessagePack data.
@@ -296,6 +380,7 @@ static inline const char *
 tuple_field_raw(const struct tuple_format *format, const char *tuple,
 		const uint32_t *field_map, uint32_t field_no)
 {
+	uint32_t anchor_fieldno = 0;
 	if (likely(field_no < format->field_count)) {
 		/* Indexed field */
 
@@ -304,19 +389,69 @@ tuple_field_raw(const struct tuple_format *format, const char *tuple,
 			return tuple;
 		}
 
-		int32_t offset_slot = format->fields[field_no].offset_slot;
-		if (offset_slot != TUPLE_OFFSET_SLOT_NIL)
-			return tuple + field_map[offset_slot];
+		const struct tuple_field *field = &format->fields[field_no];
+		if (field->offset_slot != TUPLE_OFFSET_SLOT_NIL)
+			return tuple + field_map[field->offset_slot];
+		anchor_fieldno = field->anchor_fieldno;
 	}
 	ERROR_INJECT(ERRINJ_TUPLE_FIELD, return NULL);
-	uint32_t field_count = mp_decode_array(&tuple);
+	const char *pos = tuple;
+	uint32_t field_count = mp_decode_array(&pos);
 	if (unlikely(field_no >= field_count))
 		return NULL;
-	for (uint32_t k = 0; k < field_no; k++)
-		mp_next(&tuple);
-	return tuple;
+	if (anchor_fieldno != 0) {
+		int32_t offset_slot =
+			format->fields[anchor_fieldno].offset_slot;
+		pos = tuple + field_map[offset_slot];
+	}
+	for (uint32_t k = anchor_fieldno; k < field_no; k++)
+		mp_next(&pos);
+	return pos;
 }
 
+/**
+ * Get a value indexed by a key part with a JSON path.
+ * @param format Tuple format.
+ * @param tuple A pointer to MessagePack array.
+ * @param field_map A pointer to the LAST element of field map.
+ * @param part Key part with a path.
+ * @param multikey_idx Index of the array item "[*]" refers to.
+ *
+ * @returns The value or MessagePack NIL if the value is absent,
+ *          which format validation allows only for nullable
+ *          parts.
+ */
+const char *
+tuple_field_raw_by_path(const struct tuple_format *format, const char *tuple,
+			const uint32_t *field_map, const struct key_part *part,
+			uint32_t multikey_idx);
+
+/**
+ * Get a value indexed by a key part. For a multikey part the
+ * value of the first array item is returned.
+ * @sa tuple_field_raw(), tuple_field_raw_by_path().
+ */
+static inline const char *
+tuple_field_by_part_raw(const struct tuple_format *format, const char *tuple,
+			const uint32_t *field_map, const struct key_part *part)
+{
+	if (likely(part->path == NULL))
+		return tuple_field_raw(format, tuple, field_map, part->fieldno);
+	return tuple_field_raw_by_path(format, tuple, field_map, part, 0);
+}
+
+/**
+ * Return the number of keys a tuple has in a multikey index,
+ * i.e. the size of the array "[*]" refers to.
+ * @param format Tuple format.
+ * @param tuple A pointer to MessagePack array.
+ * @param field_map A pointer to the LAST element of field map.
+ * @param key_def Multikey key definition.
+ */
+uint32_t
+tuple_multikey_count(const struct tuple_format *format, const char *tuple,
+		     const uint32_t *field_map, const struct key_def *key_def);
+
 /**
  * Get tuple field by its name.
  * @param format Tuple format.
@@ -31,9 +31,17 @@
 
 #include "tuple_hash.h"
 
+#include <string.h>
+
+#include "trivia/config.h"
 #include "third_party/PMurHash.h"
 #include "coll.h"
 
+extern "C" {
+#include "cpu_feature.h"
+#include "third_party/crc32.h"
+} /* extern "C" */
+
 /* Tuple and key hasher */
 namespace {
 
@@ -178,15 +186,188 @@ struct TupleHash<FIELD_TYPE_UNSIGNED> {
 	}
 };
 
+/* {{{ CRC32C hasher */
+
+#if defined(HAVE_CPUID) && defined(__x86_64__)
+/** Set if the CPU implements the SSE 4.2 crc32 instruction. */
+static const bool crc32c_hw_enabled = sse42_enabled_cpu();
+#endif
+
+/**
+ * Feed a 64-bit lane to CRC32C. The software fallback computes
+ * exactly what the crc32q instruction does, so a hash persisted
+ * in a bloom filter doesn't depend on the CPU it was built on.
+ */
+static inline uint32_t
+crc32c_lane(uint32_t crc, uint64_t lane)
+{
+#if defined(HAVE_CPUID) && defined(__x86_64__)
+	if (likely(crc32c_hw_enabled)) {
+		uint64_t res = crc;
+		__asm__("crc32q %1, %0" : "+r"(res) : "rm"(lane));
+		return res;
+	}
+#endif
+	return crc32c(crc, (const char *)&lane, sizeof(lane));
+}
+
+/** Feed a byte string prefixed with its length to CRC32C. */
+static inline uint32_t
+crc32c_bytes(uint32_t crc, const char *data, uint32_t size)
+{
+	crc = crc32c_lane(crc, size);
+	for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+		uint64_t lane;
+		memcpy(&lane, data, sizeof(lane));
+		crc = crc32c_lane(crc, lane);
+		data += sizeof(lane);
+	}
+	if (size > 0) {
+		uint64_t lane = 0;
+		memcpy(&lane, data, size);
+		crc = crc32c_lane(crc, lane);
+	}
+	return crc;
+}
+
+/**
+ * Hash a field according to its MsgPack type. Unlike the
+ * PMurHash hasher, integers are hashed by value, so that
+ * a non-compact encoding doesn't change the hash.
+ */
+static inline uint32_t
+crc32c_field(uint32_t crc, const char **field)
+{
+	switch (mp_typeof(**field)) {
+	case MP_UINT:
+		return crc32c_lane(crc, mp_decode_uint(field));
+	case MP_INT:
+		return crc32c_lane(crc, (uint64_t)mp_decode_int(field));
+	case MP_STR: {
+		uint32_t size;
+		const char *str = mp_decode_str(field, &size);
+		return crc32c_bytes(crc, str, size);
+	}
+	default: {
+		const char *f = *field;
+		mp_next(field);
+		return crc32c_bytes(crc, f, *field - f);
+	}
+	}
+}
+
+/**
+ * CRC is linear in its input. Mix the result with the MurmurHash3
+ * finalizer to spread the bits evenly, which matters for bloom
+ * filters splitting the hash into several probes.
+ */
+static inline uint32_t
+crc32c_result(uint32_t crc)
+{
+	crc ^= crc >> 16;
+	crc *= 0x85ebca6bU;
+	crc ^= crc >> 13;
+	crc *= 0xc2b2ae35U;
+	crc ^= crc >> 16;
+	return crc;
+}
+
+/*
+ * Type-specialized field hashers. They must return the same
+ * value as crc32c_field() for a field of the given type,
+ * because they are only a shortcut for it.
+ */
+template <int TYPE>
+static inline uint32_t
+field_crc32c(uint32_t crc, const char **field)
+{
+	return crc32c_field(crc, field);
+}
+
+template <>
+inline uint32_t
+field_crc32c<FIELD_TYPE_UNSIGNED>(uint32_t crc, const char **field)
+{
+	return crc32c_lane(crc, mp_decode_uint(field));
+}
+
+template <>
+inline uint32_t
+field_crc32c<FIELD_TYPE_INTEGER>(uint32_t crc, const char **field)
+{
+	if (mp_typeof(**field) == MP_UINT)
+		return crc32c_lane(crc, mp_decode_uint(field));
+	return crc32c_lane(crc, (uint64_t)mp_decode_int(field));
+}
+
+template <>
+inline uint32_t
+field_crc32c<FIELD_TYPE_STRING>(uint32_t crc, const char **field)
+{
+	uint32_t size;
+	const char *str = mp_decode_str(field, &size);
+	return crc32c_bytes(crc, str, size);
+}
+
+template <int TYPE, int ...MORE_TYPES> struct FieldCrc32c {};
+
+template <int TYPE, int TYPE2, int ...MORE_TYPES>
+struct FieldCrc32c<TYPE, TYPE2, MORE_TYPES...> {
+	static uint32_t hash(uint32_t crc, const char **field)
+	{
+		crc = field_crc32c<TYPE>(crc, field);
+		return FieldCrc32c<TYPE2, MORE_TYPES...>::hash(crc, field);
+	}
+};
+
+template <int TYPE>
+struct FieldCrc32c<TYPE> {
+	static uint32_t hash(uint32_t crc, const char **field)
+	{
+		return field_crc32c<TYPE>(crc, field);
+	}
+};
+
+template <int TYPE, int ...MORE_TYPES>
+struct KeyHashCrc32c {
+	static uint32_t hash(const char *key, const struct key_def *)
+	{
+		uint32_t crc = FieldCrc32c<TYPE, MORE_TYPES...>::
+			hash(HASH_SEED, &key);
+		return crc32c_result(crc);
+	}
+};
+
+template <int TYPE, int ...MORE_TYPES>
+struct TupleHashCrc32c {
+	static uint32_t hash(const struct tuple *tuple,
+			     const struct key_def *key_def)
+	{
+		const char *field = tuple_field(tuple, key_def->parts->fieldno);
+		uint32_t crc = FieldCrc32c<TYPE, MORE_TYPES...>::
+			hash(HASH_SEED, &field);
+		return crc32c_result(crc);
+	}
+};
+
+/* }}} CRC32C hasher */
+
 }; /* namespace { */
 
 #define HASHER(...) \
 	{ KeyHash<__VA_ARGS__>::hash, TupleHash<__VA_ARGS__>::hash, \
+	  KeyHashCrc32c<__VA_ARGS__>::hash, \
+	  TupleHashCrc32c<__VA_ARGS__>::hash, \
 		{ __VA_ARGS__, UINT32_MAX } },
 
+const char *tuple_hash_version_strs[] = { "murmur", "crc32c" };
+
 struct hasher_signature {
 	key_hash_t kf;
 	tuple_hash_t tf;
+	/** CRC32C hashers, see TUPLE_HASH_CRC32C. */
+	key_hash_t kf_crc32c;
+	tuple_hash_t tf_crc32c;
 	uint32_t p[64];
 };
 
@@ -208,6 +389,12 @@ static const hasher_signature hash_arr[] = {
 	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
 	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
 	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
+	HASHER(FIELD_TYPE_INTEGER)
+	HASHER(FIELD_TYPE_INTEGER , FIELD_TYPE_INTEGER)
+	HASHER(FIELD_TYPE_INTEGER , FIELD_TYPE_UNSIGNED)
+	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_INTEGER)
+	HASHER(FIELD_TYPE_INTEGER , FIELD_TYPE_STRING)
+	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_INTEGER)
 };
 
 #undef HASHER
@@ -218,6 +405,13 @@ tuple_hash_slowpath(const struct tuple *tuple, const struct key_def *key_def);
 uint32_t
 key_hash_slowpath(const char *key, const struct key_def *key_def);
 
+uint32_t
+tuple_hash_crc32c_slowpath(const struct tuple *tuple,
+			   const struct key_def *key_def);
+
+uint32_t
+key_hash_crc32c_slowpath(const char *key, const struct key_def *key_def);
+
 void
 tuple_hash_func_set(struct key_def *key_def) {
 	if (key_def->is_nullable)
@@ -249,6 +443,8 @@ tuple_hash_func_set(struct key_def *key_def) {
 		if (i == key_def->part_count && hash_arr[k].p[i] == UINT32_MAX){
 			key_def->tuple_hash = hash_arr[k].tf;
 			key_def->key_hash = hash_arr[k].kf;
+			key_def->tuple_hash_crc32c = hash_arr[k].tf_crc32c;
+			key_def->key_hash_crc32c = hash_arr[k].kf_crc32c;
 			return;
 		}
 	}
@@ -256,6 +452,8 @@ tuple_hash_func_set(struct key_def *key_def) {
 slowpath:
 	key_def->tuple_hash = tuple_hash_slowpath;
 	key_def->key_hash = key_hash_slowpath;
+	key_def->tuple_hash_crc32c = tuple_hash_crc32c_slowpath;
+	key_def->key_hash_crc32c = key_hash_crc32c_slowpath;
 }
 
 static uint32_t
@@ -340,3 +538,60 @@ key_hash_slowpath(const char *key, const struct key_def *key_def)
 
 	return PMurHash32_Result(h, carry, total_size);
 }
+
+static inline uint32_t
+key_hash_crc32c_part(uint32_t crc, const char **field, struct coll *coll)
+{
+	if (coll != NULL && mp_typeof(**field) == MP_STR) {
+		/*
+		 * Collation hash functions are incremental PMurHash
+		 * ones, feed their result to CRC32C as a lane.
+		 */
+		uint32_t size;
+		const char *str = mp_decode_str(field, &size);
+		uint32_t h = HASH_SEED;
+		uint32_t carry = 0;
+		size = coll->hash(str, size, &h, &carry, coll);
+		return crc32c_lane(crc, PMurHash32_Result(h, carry, size));
+	}
+	return crc32c_field(crc, field);
+}
+
+uint32_t
+tuple_hash_crc32c_slowpath(const struct tuple *tuple,
+			   const struct key_def *key_def)
+{
+	uint32_t crc = HASH_SEED;
+	const char *field = NULL;
+	for (const struct key_part *part = key_def->parts;
+	     part < key_def->parts + key_def->part_count; part++) {
+		/*
+		 * Hash sequential parts without looking up each
+		 * field with tuple_field().
+		 */
+		if (part == key_def->parts ||
+		    part[-1].fieldno + 1 != part->fieldno)
+			field = tuple_field(tuple, part->fieldno);
+		if (field == NULL) {
+			/*
+			 * A nullable field absent in the tuple is
+			 * hashed the same way as NULL in a key.
+			 */
+			const char *nil = "\xc0";
+			crc = crc32c_field(crc, &nil);
+			continue;
+		}
+		crc = key_hash_crc32c_part(crc, &field, part->coll);
+	}
+	return crc32c_result(crc);
+}
+
+uint32_t
+key_hash_crc32c_slowpath(const char *key, const struct key_def *key_def)
+{
+	uint32_t crc = HASH_SEED;
+	for (const struct key_part *part = key_def->parts;
+	     part < key_def->parts + key_def->part_count; part++)
+		crc = key_hash_crc32c_part(crc, &key, part->coll);
+	return crc32c_result(crc);
+}
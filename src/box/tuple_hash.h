@@ -68,6 +68,59 @@ key_hash(const char *key, const struct key_def *key_def)
 	return key_def->key_hash(key, key_def);
 }
 
+/**
+ * Calculate a hash value for a tuple with CRC32C. Unlike
+ * tuple_hash(), integers are hashed by value rather than by
+ * their MsgPack encoding.
+ * @param tuple - a tuple
+ * @param key_def - key_def for field description
+ * @return - hash value
+ */
+static inline uint32_t
+tuple_hash_crc32c(const struct tuple *tuple, const struct key_def *key_def)
+{
+	return key_def->tuple_hash_crc32c(tuple, key_def);
+}
+
+/**
+ * Calculate a hash value for a key with CRC32C.
+ * @sa tuple_hash_crc32c()
+ */
+static inline uint32_t
+key_hash_crc32c(const char *key, const struct key_def *key_def)
+{
+	return key_def->key_hash_crc32c(key, key_def);
+}
+
+/**
+ * Calculate a hash value for a tuple with the given hash
+ * function. Vinyl stores the version along with a bloom
+ * filter, so that a run is checked with the function it
+ * was built with.
+ */
+static inline uint32_t
+tuple_hash_by_version(const struct tuple *tuple,
+		      const struct key_def *key_def,
+		      enum tuple_hash_version version)
+{
+	if (version == TUPLE_HASH_CRC32C)
+		return tuple_hash_crc32c(tuple, key_def);
+	return tuple_hash(tuple, key_def);
+}
+
+/**
+ * Calculate a hash value for a key with the given hash function.
+ * @sa tuple_hash_by_version()
+ */
+static inline uint32_t
+key_hash_by_version(const char *key, const struct key_def *key_def,
+		    enum tuple_hash_version version)
+{
+	if (version == TUPLE_HASH_CRC32C)
+		return key_hash_crc32c(key, key_def);
+	return key_hash(key, key_def);
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -1213,6 +1213,80 @@ tuple_update_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 	return update_finish(&update, p_tuple_len);
 }
 
+int
+tuple_update_patch(tuple_update_alloc_func alloc, void *alloc_ctx,
+		   const char *expr, const char *expr_end,
+		   const char *old_data, const char *old_data_end,
+		   int index_base, struct tuple_update_patch **p_patches,
+		   uint32_t *p_patch_count, uint64_t *column_mask)
+{
+	struct tuple_update update;
+	update_init(&update, alloc, alloc_ctx, index_base);
+	const char *data = old_data;
+	uint32_t field_count = mp_decode_array(&data);
+
+	if (update_read_ops(&update, expr, expr_end, field_count) != 0)
+		return -1;
+	/* INSERT and DELETE move fields. */
+	struct update_op *op = update.ops;
+	struct update_op *ops_end = op + update.op_count;
+	for (; op < ops_end; op++) {
+		if (op->opcode == '!' || op->opcode == '#')
+			return 1;
+	}
+	if (update_do_ops(&update, data, old_data_end, field_count) != 0)
+		return -1;
+	/* SET of the field following the last one is an INSERT. */
+	if (rope_size(update.rope) != field_count)
+		return 1;
+
+	uint32_t patch_count = 0;
+	struct rope_iter it;
+	struct rope_node *node;
+	rope_iter_create(&it, update.rope);
+	for (node = rope_iter_start(&it); node; node = rope_iter_next(&it)) {
+		struct update_field *field = (struct update_field *)
+				rope_leaf_data(node);
+		if (field->op == NULL)
+			continue;
+		if (field->op->new_field_len !=
+		    (uint32_t)(field->tail - field->old))
+			return 1;
+		patch_count++;
+	}
+
+	struct tuple_update_patch *patches = (struct tuple_update_patch *)
+		alloc(alloc_ctx, patch_count * sizeof(*patches));
+	if (patches == NULL)
+		return -1;
+	struct tuple_update_patch *patch = patches;
+	uint32_t fieldno = 0;
+	for (node = rope_iter_start(&it); node; node = rope_iter_next(&it)) {
+		struct update_field *field = (struct update_field *)
+				rope_leaf_data(node);
+		op = field->op;
+		if (op != NULL) {
+			char *value = (char *) alloc(alloc_ctx,
+						     op->new_field_len);
+			if (value == NULL)
+				return -1;
+			op->meta->store(&op->arg, field->old, value);
+			patch->offset = field->old - old_data;
+			patch->size = op->new_field_len;
+			patch->fieldno = fieldno;
+			patch->value = value;
+			patch++;
+		}
+		fieldno += rope_leaf_size(node);
+	}
+	assert(patch == patches + patch_count);
+	*p_patches = patches;
+	*p_patch_count = patch_count;
+	if (column_mask)
+		*column_mask = update.column_mask;
+	return 0;
+}
+
 const char *
 tuple_upsert_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 		     const char *expr,const char *expr_end,
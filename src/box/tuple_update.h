@@ -57,6 +57,47 @@ tuple_update_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 		     uint32_t *p_new_size, int index_base,
 		     uint64_t *column_mask);
 
+/**
+ * A change of a single tuple field, which keeps the MessagePack
+ * size, and hence the position, of the field and all the fields
+ * following it. See tuple_update_patch().
+ */
+struct tuple_update_patch {
+	/** Offset of the field from the beginning of the tuple. */
+	uint32_t offset;
+	/** Size of the field before and after the change. */
+	uint32_t size;
+	/** Number of the field, 0-based. */
+	uint32_t fieldno;
+	/** The new value of the field. */
+	const char *value;
+};
+
+/**
+ * Try to execute update operations as a set of patches of the
+ * old tuple. This is possible if the operations only change the
+ * values of existing fields and every changed field keeps its
+ * size, e.g. when a counter is incremented. Applying the patches
+ * to a copy of the old tuple is much cheaper than building the
+ * new tuple field by field with tuple_update_execute().
+ *
+ * @param[out] p_patches Patches ordered by field number,
+ *             allocated with @a alloc.
+ * @param[out] p_patch_count Number of patches.
+ * @param[out] column_mask Mask of changed fields, may be NULL.
+ *
+ * @retval  0 Success.
+ * @retval  1 The update can't be executed as a set of patches,
+ *            tuple_update_execute() must be used instead.
+ * @retval -1 Error, the operations are invalid.
+ */
+int
+tuple_update_patch(tuple_update_alloc_func alloc, void *alloc_ctx,
+		   const char *expr, const char *expr_end,
+		   const char *old_data, const char *old_data_end,
+		   int index_base, struct tuple_update_patch **p_patches,
+		   uint32_t *p_patch_count, uint64_t *column_mask);
+
 const char *
 tuple_upsert_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 		     const char *expr, const char *expr_end,
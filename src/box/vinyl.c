@@ -471,6 +471,23 @@ struct vy_scheduler {
 	int dump_task_count;
 	/** Time when the current dump round started. */
 	ev_tstamp dump_start;
+	/**
+	 * Amount of memory that had to be dumped when the
+	 * current dump round was triggered. Used for estimating
+	 * the time left till the end of the dump round.
+	 */
+	size_t dump_size;
+	/**
+	 * Number of compaction tasks that were postponed, because
+	 * dump was lagging behind transactions. A task that stays
+	 * postponed until the rate limit is lifted counts once.
+	 */
+	int64_t compact_deferred;
+	/**
+	 * Set if there's a compaction task postponed due to the
+	 * rate limit. Cleared when the limit is lifted.
+	 */
+	bool compact_is_deferred;
 	/** Signaled on dump round completion. */
 	struct fiber_cond dump_cond;
 };
@@ -563,6 +580,11 @@ struct vy_task {
 	struct vy_range *range;
 	/** Run written by this task. */
 	struct vy_run *new_run;
+	/**
+	 * Writer of the blob for the new run or NULL if the index
+	 * doesn't use a value log, see vy_blob.h.
+	 */
+	struct vy_blob_writer *blob_writer;
 	/** Write iterator producing statements for the new run. */
 	struct vy_stmt_stream *wi;
 	/**
@@ -617,12 +639,68 @@ vy_task_new(struct mempool *pool, struct vy_index *index,
 static void
 vy_task_delete(struct mempool *pool, struct vy_task *task)
 {
+	if (task->blob_writer != NULL)
+		vy_blob_writer_delete(task->blob_writer);
 	vy_index_unref(task->index);
 	diag_destroy(&task->diag);
 	TRASH(task);
 	mempool_free(pool, task);
 }
 
+/** Remove a blob from an index and drop the index reference. */
+static void
+vy_task_remove_blob(struct vy_index *index, struct vy_blob *blob)
+{
+	vy_index_remove_blob(index, blob);
+	vy_blob_unref(blob);
+}
+
+/**
+ * Add the blob written by a task, if any, to the index and
+ * attach the blobs referenced by the new run to it, see
+ * vy_blob.h. On success @p_blob is set to the new blob or
+ * NULL if the task didn't write a blob.
+ */
+static int
+vy_task_add_blob(struct vy_task *task, struct vy_blob **p_blob)
+{
+	struct vy_index *index = task->index;
+	struct vy_blob_writer *writer = task->blob_writer;
+	struct vy_blob *blob = NULL;
+	if (writer != NULL && writer->fd >= 0) {
+		blob = vy_blob_new(writer->id);
+		if (blob == NULL)
+			return -1;
+		blob->fd = writer->fd;
+		blob->size = writer->size;
+		writer->fd = -1;
+		vy_index_add_blob(index, blob);
+	}
+	if (vy_run_attach_blobs(task->new_run, &index->blobs) != 0) {
+		if (blob != NULL)
+			vy_task_remove_blob(index, blob);
+		return -1;
+	}
+	*p_blob = blob;
+	return 0;
+}
+
+/**
+ * Allocate a blob writer for a dump or compaction task
+ * of the primary index.
+ */
+static int
+vy_task_new_blob_writer(struct vy_task *task)
+{
+	struct vy_index *index = task->index;
+	assert(index->id == 0);
+	task->blob_writer = vy_blob_writer_new(task->new_run->id,
+				index->env->path, index->space_id, index->id,
+				index->opts.value_log_threshold,
+				index->disk_format);
+	return task->blob_writer != NULL ? 0 : -1;
+}
+
 static int
 vy_task_dump_execute(struct vy_task *task)
 {
@@ -632,7 +710,7 @@ vy_task_dump_execute(struct vy_task *task)
 			    index->space_id, index->id, task->wi,
 			    task->page_size, index->cmp_def,
 			    index->key_def, task->max_output_count,
-			    task->bloom_fpr);
+			    task->bloom_fpr, task->blob_writer);
 }
 
 static int
@@ -645,6 +723,7 @@ vy_task_dump_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 	struct vy_mem *mem, *next_mem;
 	struct vy_slice **new_slices, *slice;
 	struct vy_range *range, *begin_range, *end_range;
+	struct vy_blob *new_blob;
 	struct tuple *min_key, *max_key;
 	int i, loops = 0;
 
@@ -714,10 +793,15 @@ vy_task_dump_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 			fiber_sleep(0);
 	}
 
+	if (vy_task_add_blob(task, &new_blob) != 0)
+		goto fail_free_slices;
+
 	/*
 	 * Log change in metadata.
 	 */
 	vy_log_tx_begin();
+	if (new_blob != NULL)
+		vy_log_create_blob(index->commit_lsn, new_blob->id);
 	vy_log_create_run(index->commit_lsn, new_run->id, dump_lsn);
 	for (range = begin_range, i = 0; range != end_range;
 	     range = vy_range_tree_next(index->tree, range), i++) {
@@ -731,8 +815,11 @@ vy_task_dump_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 			fiber_sleep(0); /* see comment above */
 	}
 	vy_log_dump_index(index->commit_lsn, dump_lsn);
-	if (vy_log_tx_commit() < 0)
+	if (vy_log_tx_commit() < 0) {
+		if (new_blob != NULL)
+			vy_task_remove_blob(index, new_blob);
 		goto fail_free_slices;
+	}
 
 	/*
 	 * Account the new run.
@@ -948,6 +1035,10 @@ vy_task_dump_new(struct vy_scheduler *scheduler, struct vy_index *index,
 	task->bloom_fpr = index->opts.bloom_fpr;
 	task->page_size = index->opts.page_size;
 
+	if (index->id == 0 && index->opts.value_log_threshold > 0 &&
+	    vy_task_new_blob_writer(task) != 0)
+		goto err_wi_sub;
+
 	index->is_dumping = true;
 	vy_scheduler_update_index(scheduler, index);
 
@@ -990,7 +1081,7 @@ vy_task_compact_execute(struct vy_task *task)
 			    index->space_id, index->id, task->wi,
 			    task->page_size, index->cmp_def,
 			    index->key_def, task->max_output_count,
-			    task->bloom_fpr);
+			    task->bloom_fpr, task->blob_writer);
 }
 
 static int
@@ -1002,6 +1093,7 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 	struct vy_slice *first_slice = task->first_slice;
 	struct vy_slice *last_slice = task->last_slice;
 	struct vy_slice *slice, *next_slice, *new_slice = NULL;
+	struct vy_blob *blob, *next_blob, *new_blob = NULL;
 	struct vy_run *run;
 
 	/*
@@ -1016,6 +1108,10 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 					 index->cmp_def);
 		if (new_slice == NULL)
 			return -1;
+		if (vy_task_add_blob(task, &new_blob) != 0) {
+			vy_slice_delete(new_slice);
+			return -1;
+		}
 	}
 
 	/*
@@ -1037,6 +1133,27 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 			break;
 	}
 
+	/*
+	 * Build the list of blobs that are not referenced by
+	 * any run any more, see vy_blob.h.
+	 */
+	RLIST_HEAD(unused_blobs);
+	rlist_foreach_entry(run, &unused_runs, in_unused) {
+		for (uint32_t i = 0; i < run->info.blob_count; i++)
+			run->blobs[i]->compacted_run_count++;
+	}
+	rlist_foreach_entry(run, &unused_runs, in_unused) {
+		for (uint32_t i = 0; i < run->info.blob_count; i++) {
+			blob = run->blobs[i];
+			if (blob->compacted_run_count == blob->run_count &&
+			    vy_blob_find(new_run->blobs,
+					 new_run->info.blob_count,
+					 blob->id) == NULL)
+				rlist_add_entry(&unused_blobs, blob, in_unused);
+			blob->compacted_run_count = 0;
+		}
+	}
+
 	/*
 	 * Log change in metadata.
 	 */
@@ -1049,6 +1166,10 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 	int64_t gc_lsn = checkpoint_last(NULL);
 	rlist_foreach_entry(run, &unused_runs, in_unused)
 		vy_log_drop_run(run->id, gc_lsn);
+	rlist_foreach_entry(blob, &unused_blobs, in_unused)
+		vy_log_drop_blob(blob->id, gc_lsn);
+	if (new_blob != NULL)
+		vy_log_create_blob(index->commit_lsn, new_blob->id);
 	if (new_slice != NULL) {
 		vy_log_create_run(index->commit_lsn, new_run->id,
 				  new_run->dump_lsn);
@@ -1057,6 +1178,11 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 				    tuple_data_or_null(new_slice->end));
 	}
 	if (vy_log_tx_commit() < 0) {
+		rlist_foreach_entry_safe(blob, &unused_blobs,
+					 in_unused, next_blob)
+			rlist_del_entry(blob, in_unused);
+		if (new_blob != NULL)
+			vy_task_remove_blob(index, new_blob);
 		if (new_slice != NULL)
 			vy_slice_delete(new_slice);
 		return -1;
@@ -1107,6 +1233,10 @@ vy_task_compact_complete(struct vy_scheduler *scheduler, struct vy_task *task)
 	 */
 	rlist_foreach_entry(run, &unused_runs, in_unused)
 		vy_index_remove_run(index, run);
+	rlist_foreach_entry_safe(blob, &unused_blobs, in_unused, next_blob) {
+		rlist_del_entry(blob, in_unused);
+		vy_task_remove_blob(index, blob);
+	}
 	rlist_foreach_entry_safe(slice, &compacted_slices,
 				 in_range, next_slice) {
 		vy_slice_wait_pinned(slice);
@@ -1228,6 +1358,30 @@ vy_task_compact_new(struct vy_scheduler *scheduler, struct vy_index *index,
 	task->bloom_fpr = index->opts.bloom_fpr;
 	task->page_size = index->opts.page_size;
 
+	if (index->id == 0 && (index->opts.value_log_threshold > 0 ||
+			       index->blob_count > 0)) {
+		if (vy_task_new_blob_writer(task) != 0)
+			goto err_wi_sub;
+		/*
+		 * References to blobs are copied as is, unless most
+		 * of a blob is garbage, in which case the values are
+		 * moved to the new blob so that the old one can be
+		 * deleted once all runs referring to it are compacted.
+		 */
+		n = range->compact_priority;
+		rlist_foreach_entry(slice, &range->slices, in_range) {
+			struct vy_run *run = slice->run;
+			for (uint32_t i = 0; i < run->info.blob_count; i++) {
+				struct vy_blob *blob = run->blobs[i];
+				if (vy_blob_writer_add_src(task->blob_writer,
+						blob, blob->used < blob->size / 2) != 0)
+					goto err_wi_sub;
+			}
+			if (--n == 0)
+				break;
+		}
+	}
+
 	/*
 	 * Remove the range we are going to compact from the heap
 	 * so that it doesn't get selected again.
@@ -1539,6 +1693,19 @@ retry:
 	return 0; /* new task */
 }
 
+/**
+ * Return true if there's a range that needs to be compacted.
+ */
+static bool
+vy_scheduler_needs_compaction(struct vy_scheduler *scheduler)
+{
+	struct heap_node *pn = vy_compact_heap_top(&scheduler->compact_heap);
+	if (pn == NULL)
+		return false;
+	struct vy_index *index = container_of(pn, struct vy_index, in_compact);
+	return vy_index_compact_priority(index) > 1;
+}
+
 static int
 vy_schedule(struct vy_scheduler *scheduler, struct vy_task **ptask)
 {
@@ -1561,6 +1728,23 @@ vy_schedule(struct vy_scheduler *scheduler, struct vy_task **ptask)
 		return 0;
 	}
 
+	if (vy_quota_is_rate_limited(&scheduler->env->quota)) {
+		/*
+		 * Dump doesn't keep up with transactions, which
+		 * are already being throttled. Don't start new
+		 * compaction tasks so as not to steal disk
+		 * bandwidth from the dump. The scheduler is woken
+		 * up by the quota timer when the limit is lifted.
+		 */
+		if (!scheduler->compact_is_deferred &&
+		    vy_scheduler_needs_compaction(scheduler)) {
+			scheduler->compact_is_deferred = true;
+			scheduler->compact_deferred++;
+		}
+		return 0;
+	}
+	scheduler->compact_is_deferred = false;
+
 	if (vy_scheduler_peek_compact(scheduler, ptask) != 0)
 		goto fail;
 	if (*ptask != NULL)
@@ -1850,6 +2034,7 @@ vy_scheduler_trigger_dump(struct vy_scheduler *scheduler)
 		 */
 		scheduler->dump_start = ev_monotonic_now(loop());
 	}
+	scheduler->dump_size = lsregion_used(&scheduler->env->stmt_env.allocator);
 	scheduler->generation++;
 }
 
@@ -1902,6 +2087,13 @@ vy_scheduler_complete_dump(struct vy_scheduler *scheduler)
 	scheduler->dump_generation = min_generation;
 	fiber_cond_signal(&scheduler->dump_cond);
 
+	/*
+	 * Memory has been freed, stop pacing transactions
+	 * until the next dump round starts.
+	 */
+	if (scheduler->dump_generation == scheduler->generation)
+		vy_quota_set_rate_limit(quota, SIZE_MAX);
+
 	/* Account dump bandwidth. */
 	struct vy_stat *stat = scheduler->env->stat;
 	ev_tstamp now = ev_monotonic_now(loop());
@@ -2009,6 +2201,8 @@ vy_info_append_memory(struct vy_env *env, struct info_handler *h)
 	info_append_int(h, "used", q->used);
 	info_append_int(h, "limit", q->limit);
 	info_append_int(h, "watermark", q->watermark);
+	info_append_int(h, "rate_limit",
+			q->rate_limit == SIZE_MAX ? 0 : q->rate_limit);
 	snprintf(buf, sizeof(buf), "%d%%", (int)(100 * q->used / q->limit));
 	info_append_str(h, "ratio", buf);
 	info_table_end(h);
@@ -2045,6 +2239,9 @@ vy_info_append_performance(struct vy_env *env, struct info_handler *h)
 	info_append_int(h, "read_view", mstats.objcount);
 
 	info_append_int(h, "dump_bandwidth", vy_stat_dump_bandwidth(stat));
+	info_append_int(h, "tx_rate_throttled", env->quota.rate_throttled);
+	info_append_int(h, "compact_deferred",
+			env->scheduler->compact_deferred);
 
 	struct vy_cache_env *ce = &env->cache_env;
 	info_table_begin(h, "cache");
@@ -2112,6 +2309,67 @@ vy_info_append_compact_stat(struct info_handler *h, const char *name,
 	info_table_end(h);
 }
 
+/**
+ * Append read, write and space amplification of an index,
+ * which help to choose the compaction policy:
+ *
+ * - read: average number of runs per range, i.e. the number
+ *   of runs a point lookup may have to look at;
+ * - write: the number of times a statement is written to disk,
+ *   i.e. bytes written by dump and compaction per byte dumped;
+ * - space: the size of all runs per the size of the oldest run
+ *   of each range, which stores the most compact version of data.
+ */
+static void
+vy_index_info_append_amplification(struct vy_index *index,
+				   struct info_handler *h)
+{
+	struct vy_index_stat *stat = &index->stat;
+	int64_t last_level_bytes = 0;
+	for (struct vy_range *range = vy_range_tree_first(index->tree);
+	     range != NULL; range = vy_range_tree_next(index->tree, range)) {
+		if (rlist_empty(&range->slices))
+			continue;
+		struct vy_slice *slice = rlist_last_entry(&range->slices,
+						struct vy_slice, in_range);
+		last_level_bytes += slice->count.bytes;
+	}
+	int64_t dumped = stat->disk.dump.out.bytes;
+	int64_t written = dumped + stat->disk.compact.out.bytes;
+
+	info_table_begin(h, "amplification");
+	info_append_double(h, "read", index->range_count == 0 ? 0 :
+			   (double)index->run_count / index->range_count);
+	info_append_double(h, "write", dumped == 0 ? 0 :
+			   (double)written / dumped);
+	info_append_double(h, "space", last_level_bytes == 0 ? 0 :
+			   (double)stat->disk.count.bytes / last_level_bytes);
+	info_table_end(h);
+}
+
+/**
+ * Append statistics of the index value log, see vy_blob.h:
+ *
+ * - count: number of blob files;
+ * - bytes: total size of blob files;
+ * - used: size of values referenced by the index runs.
+ */
+static void
+vy_index_info_append_blobs(struct vy_index *index, struct info_handler *h)
+{
+	int64_t bytes = 0, used = 0;
+	struct vy_blob *blob;
+	rlist_foreach_entry(blob, &index->blobs, in_index) {
+		bytes += blob->size;
+		used += blob->used;
+	}
+	info_table_begin(h, "blob");
+	info_append_int(h, "count", index->blob_count);
+	info_append_int(h, "bytes", bytes);
+	info_append_int(h, "used", used);
+	info_table_end(h);
+}
+
 void
 vy_index_info(struct vy_index *index, struct info_handler *h)
 {
@@ -2156,6 +2414,7 @@ vy_index_info(struct vy_index *index, struct info_handler *h)
 	info_table_end(h);
 	vy_info_append_compact_stat(h, "dump", &stat->disk.dump);
 	vy_info_append_compact_stat(h, "compact", &stat->disk.compact);
+	vy_index_info_append_blobs(index, h);
 	info_table_end(h);
 
 	info_table_begin(h, "cache");
@@ -2180,6 +2439,7 @@ vy_index_info(struct vy_index *index, struct info_handler *h)
 	info_append_int(h, "run_avg", index->run_count / index->range_count);
 	histogram_snprint(buf, sizeof(buf), index->run_hist);
 	info_append_str(h, "run_histogram", buf);
+	vy_index_info_append_amplification(index, h);
 
 	info_end(h);
 }
@@ -2347,7 +2607,7 @@ vy_index_commit_create(struct vy_env *env, struct vy_index *index, int64_t lsn)
 }
 
 /*
- * Delete all runs, ranges, and slices of a given index
+ * Delete all runs, blobs, ranges, and slices of a given index
  * from the metadata log.
  */
 static void
@@ -2369,6 +2629,9 @@ vy_log_index_prune(struct vy_index *index, int64_t gc_lsn)
 		if (++loops % VY_YIELD_LOOPS == 0)
 			fiber_sleep(0);
 	}
+	struct vy_blob *blob;
+	rlist_foreach_entry(blob, &index->blobs, in_index)
+		vy_log_drop_blob(blob->id, gc_lsn);
 }
 
 void
@@ -3837,6 +4100,48 @@ vy_get(struct vy_env *env, struct vy_tx *tx, struct vy_index *index,
 
 /** {{{ Environment */
 
+/** How often to update the quota watermark and rate limit. */
+static const ev_tstamp VY_QUOTA_UPDATE_INTERVAL = 0.1;
+
+/**
+ * Calculate the rate at which transactions may consume memory
+ * while a dump is in progress so that the dump completes before
+ * the memory limit is hit, i.e.
+ *
+ *   limit - used      dump_size - dumped
+ *   ------------ = -------------------
+ *    rate_limit       dump_bandwidth
+ *
+ * The amount of memory dumped so far is estimated from the
+ * time elapsed since the dump round started. Returns SIZE_MAX
+ * if transactions need not be paced.
+ */
+static size_t
+vy_env_tx_rate_limit(struct vy_env *e, int64_t dump_bandwidth)
+{
+	struct vy_scheduler *scheduler = e->scheduler;
+	struct vy_quota *q = &e->quota;
+	if (scheduler->dump_generation == scheduler->generation ||
+	    q->limit == SIZE_MAX || dump_bandwidth <= 0)
+		return SIZE_MAX; /* no dump in progress */
+	if (q->used >= q->limit)
+		return 0;
+	ev_tstamp elapsed = ev_monotonic_now(loop()) - scheduler->dump_start;
+	double dumped = (double)dump_bandwidth * elapsed;
+	double dump_left = (double)scheduler->dump_size - dumped;
+	/*
+	 * If the dump should have completed by now, it's the
+	 * bandwidth estimate that is wrong, not the writers.
+	 * Assume there's one timer tick worth of work left.
+	 */
+	double min_dump_left = dump_bandwidth * VY_QUOTA_UPDATE_INTERVAL;
+	if (dump_left < min_dump_left)
+		dump_left = min_dump_left;
+	double rate = (double)(q->limit - q->used) * dump_bandwidth /
+		      dump_left;
+	return rate < SIZE_MAX ? (size_t)rate : SIZE_MAX;
+}
+
 static void
 vy_env_quota_timer_cb(ev_loop *loop, ev_timer *timer, int events)
 {
@@ -3848,6 +4153,24 @@ vy_env_quota_timer_cb(ev_loop *loop, ev_timer *timer, int events)
 	int64_t tx_write_rate = vy_stat_tx_write_rate(e->stat);
 	int64_t dump_bandwidth = vy_stat_dump_bandwidth(e->stat);
 
+	/*
+	 * Pace transactions while memory is being dumped so
+	 * that they are throttled smoothly rather than stalled
+	 * all at once when the memory limit is reached.
+	 */
+	size_t rate_limit = vy_env_tx_rate_limit(e, dump_bandwidth);
+	vy_quota_set_rate_limit(&e->quota, rate_limit);
+	if (rate_limit != SIZE_MAX)
+		vy_quota_refill(&e->quota,
+				rate_limit * VY_QUOTA_UPDATE_INTERVAL);
+	/*
+	 * Compaction deferred by the scheduler may proceed now
+	 * that the rate limit is lifted.
+	 */
+	if (e->scheduler->compact_is_deferred &&
+	    !vy_quota_is_rate_limited(&e->quota))
+		fiber_cond_signal(&e->scheduler->scheduler_cond);
+
 	/*
 	 * Due to log structured nature of the lsregion allocator,
 	 * which is used for allocating statements, we cannot free
@@ -3921,7 +4244,8 @@ vy_env_new(const char *path, size_t memory, size_t cache, int read_threads,
 	vy_quota_init(&e->quota, vy_scheduler_quota_exceeded_cb,
 		                 vy_scheduler_quota_throttled_cb,
 				 vy_scheduler_quota_released_cb);
-	ev_timer_init(&e->quota_timer, vy_env_quota_timer_cb, 0, 1.);
+	ev_timer_init(&e->quota_timer, vy_env_quota_timer_cb, 0,
+		      VY_QUOTA_UPDATE_INTERVAL);
 	e->quota_timer.data = e;
 	ev_timer_start(loop(), &e->quota_timer);
 	vy_cache_env_create(&e->cache_env, slab_cache, cache);
@@ -4150,6 +4474,13 @@ struct vy_join_ctx {
 	 * is to the head of the list.
 	 */
 	struct rlist slices;
+	/**
+	 * Blobs of the current index, linked by vy_blob::in_index.
+	 * Runs refer to them, see vy_blob.h.
+	 */
+	struct rlist blobs;
+	/** Number of blobs in the list. */
+	uint32_t blob_count;
 	/**
 	 * LSN to assign to the next statement.
 	 *
@@ -4162,25 +4493,91 @@ struct vy_join_ctx {
 	int64_t lsn;
 };
 
+/** Delete all blobs of the current index from a relay context. */
+static void
+vy_join_ctx_clear_blobs(struct vy_join_ctx *ctx)
+{
+	struct vy_blob *blob, *tmp;
+	rlist_foreach_entry_safe(blob, &ctx->blobs, in_index, tmp)
+		vy_blob_unref(blob);
+	rlist_create(&ctx->blobs);
+	ctx->blob_count = 0;
+}
+
+/**
+ * Replace blob references in a REPLACE statement with values,
+ * because the replica doesn't have our blob files.
+ * On success @p_stmt is set to the resulting statement, which
+ * must be unreferenced by the caller, or NULL if the statement
+ * has no references.
+ */
+static int
+vy_join_load_blobs(struct vy_join_ctx *ctx, struct vy_blob **blobs,
+		   struct tuple *stmt, struct tuple **p_stmt)
+{
+	*p_stmt = NULL;
+	if (!vy_stmt_has_blob_refs(stmt))
+		return 0;
+	uint32_t size;
+	const char *data = tuple_data_range(stmt, &size);
+	char *buf;
+	uint32_t buf_size;
+	if (vy_blob_resolve(blobs, ctx->blob_count, data, data + size,
+			    &buf, &buf_size) != 0)
+		return -1;
+	if (buf == NULL)
+		return 0;
+	*p_stmt = vy_stmt_new_replace(ctx->format, buf, buf + buf_size);
+	free(buf);
+	if (*p_stmt == NULL)
+		return -1;
+	vy_stmt_set_lsn(*p_stmt, vy_stmt_lsn(stmt));
+	return 0;
+}
+
 static int
 vy_send_range_f(struct cbus_call_msg *cmsg)
 {
 	struct vy_join_ctx *ctx = container_of(cmsg, struct vy_join_ctx, cmsg);
 
+	struct vy_blob **blobs = NULL;
+	if (ctx->blob_count > 0) {
+		blobs = malloc(ctx->blob_count * sizeof(*blobs));
+		if (blobs == NULL) {
+			diag_set(OutOfMemory, ctx->blob_count * sizeof(*blobs),
+				 "malloc", "struct vy_blob *");
+			return -1;
+		}
+		uint32_t i = 0;
+		struct vy_blob *blob;
+		rlist_foreach_entry(blob, &ctx->blobs, in_index)
+			blobs[i++] = blob;
+	}
+
 	struct tuple *stmt;
 	int rc = ctx->wi->iface->start(ctx->wi);
 	if (rc != 0)
 		goto err;
 	while ((rc = ctx->wi->iface->next(ctx->wi, &stmt)) == 0 &&
 	       stmt != NULL) {
+		struct tuple *loaded = NULL;
+		if (blobs != NULL) {
+			rc = vy_join_load_blobs(ctx, blobs, stmt, &loaded);
+			if (rc != 0)
+				break;
+			if (loaded != NULL)
+				stmt = loaded;
+		}
 		struct xrow_header xrow;
 		rc = vy_stmt_encode_primary(stmt, ctx->key_def,
 					    ctx->space_id, &xrow);
-		if (rc != 0)
-			break;
-		/* See comment to vy_join_ctx::lsn. */
-		xrow.lsn = ++ctx->lsn;
-		rc = xstream_write(ctx->stream, &xrow);
+		if (rc == 0) {
+			/* See comment to vy_join_ctx::lsn. */
+			xrow.lsn = ++ctx->lsn;
+			rc = xstream_write(ctx->stream, &xrow);
+		}
+		if (loaded != NULL)
+			tuple_unref(loaded);
 		if (rc != 0)
 			break;
 		fiber_gc();
@@ -4188,6 +4585,7 @@ vy_send_range_f(struct cbus_call_msg *cmsg)
 err:
 	ctx->wi->iface->stop(ctx->wi);
 	fiber_gc();
+	free(blobs);
 	return rc;
 }
 
@@ -4272,6 +4670,7 @@ vy_join_cb(const struct vy_log_record *record, void *arg)
 		if (ctx->upsert_format == NULL)
 			return -1;
 		tuple_format_ref(ctx->upsert_format);
+		vy_join_ctx_clear_blobs(ctx);
 	}
 
 	/*
@@ -4281,6 +4680,19 @@ vy_join_cb(const struct vy_log_record *record, void *arg)
 	if (ctx->index_id != 0)
 		return 0;
 
+	if (record->type == VY_LOG_CREATE_BLOB && !record->is_dropped) {
+		struct vy_blob *blob = vy_blob_new(record->run_id);
+		if (blob == NULL)
+			return -1;
+		if (vy_blob_open(blob, ctx->env->path,
+				 ctx->space_id, ctx->index_id) != 0) {
+			vy_blob_unref(blob);
+			return -1;
+		}
+		rlist_add_tail_entry(&ctx->blobs, blob, in_index);
+		ctx->blob_count++;
+	}
+
 	if (record->type == VY_LOG_INSERT_SLICE) {
 		struct tuple_format *key_format = ctx->env->index_env.key_format;
 		struct tuple *begin = NULL, *end = NULL;
@@ -4292,6 +4704,8 @@ vy_join_cb(const struct vy_log_record *record, void *arg)
 		if (vy_run_recover(run, ctx->env->path,
 				   ctx->space_id, ctx->index_id) != 0)
 			goto done_slice;
+		if (vy_run_attach_blobs(run, &ctx->blobs) != 0)
+			goto done_slice;
 
 		if (record->begin != NULL) {
 			begin = vy_key_from_msgpack(key_format, record->begin);
@@ -4360,6 +4774,7 @@ vy_join(struct vy_env *env, struct vclock *vclock, struct xstream *stream)
 	ctx->env = env;
 	ctx->stream = stream;
 	rlist_create(&ctx->slices);
+	rlist_create(&ctx->blobs);
 
 	/* Start the relay cord. */
 	char name[FIBER_NAME_MAX];
@@ -4393,6 +4808,7 @@ vy_join(struct vy_env *env, struct vclock *vclock, struct xstream *stream)
 	struct vy_slice *slice, *tmp;
 	rlist_foreach_entry_safe(slice, &ctx->slices, in_join, tmp)
 		vy_slice_delete(slice);
+	vy_join_ctx_clear_blobs(ctx);
 out_join_cord:
 	cbus_stop_loop(&ctx->relay_pipe);
 	cpipe_destroy(&ctx->relay_pipe);
@@ -4425,10 +4841,30 @@ struct vy_gc_arg {
 	 */
 	uint32_t space_id;
 	uint32_t index_id;
+	/**
+	 * Set if the current run was never committed, in which
+	 * case its blob file, if any, wasn't logged and has to be
+	 * deleted along with the run files.
+	 */
+	bool is_incomplete_run;
 	/** Number of times the callback has been called. */
 	int loops;
 };
 
+/** Delete a blob file, see vy_blob.h. */
+static int
+vy_gc_blob(struct vy_gc_arg *arg, int64_t blob_id)
+{
+	char path[PATH_MAX];
+	vy_blob_snprint_path(path, sizeof(path), arg->env->path,
+			     arg->space_id, arg->index_id, blob_id);
+	if (coio_unlink(path) < 0 && errno != ENOENT) {
+		say_syserror("failed to delete file '%s'", path);
+		return -1;
+	}
+	return 0;
+}
+
 /**
  * Garbage collection callback, passed to vy_recovery_iterate().
  *
@@ -4448,14 +4884,32 @@ vy_gc_cb(const struct vy_log_record *record, void *cb_arg)
 		arg->index_id = record->index_id;
 		goto out;
 	case VY_LOG_PREPARE_RUN:
+		arg->is_incomplete_run = true;
 		if ((arg->gc_mask & VY_GC_INCOMPLETE) == 0)
 			goto out;
 		break;
+	case VY_LOG_CREATE_RUN:
+		arg->is_incomplete_run = false;
+		goto out;
 	case VY_LOG_DROP_RUN:
 		if ((arg->gc_mask & VY_GC_DROPPED) == 0 ||
 		    record->gc_lsn >= arg->gc_lsn)
 			goto out;
 		break;
+	case VY_LOG_DROP_BLOB:
+		if ((arg->gc_mask & VY_GC_DROPPED) == 0 ||
+		    record->gc_lsn >= arg->gc_lsn)
+			goto out;
+		if (vy_gc_blob(arg, record->run_id) != 0)
+			goto out;
+		vy_log_tx_begin();
+		vy_log_forget_blob(record->run_id);
+		if (vy_log_tx_commit() < 0) {
+			say_warn("failed to log vinyl blob %lld cleanup: %s",
+				 (long long)record->run_id,
+				 diag_last_error(diag_get())->errmsg);
+		}
+		goto out;
 	default:
 		goto out;
 	}
@@ -4476,6 +4930,8 @@ vy_gc_cb(const struct vy_log_record *record, void *cb_arg)
 			forget = false;
 		}
 	}
+	if (arg->is_incomplete_run && vy_gc_blob(arg, record->run_id) != 0)
+		forget = false;
 
 	if (!forget)
 		goto out;
@@ -4558,10 +5014,18 @@ vy_backup_cb(const struct vy_log_record *record, void *cb_arg)
 		arg->index_id = record->index_id;
 	}
 
+	char path[PATH_MAX];
+	if (record->type == VY_LOG_CREATE_BLOB && !record->is_dropped) {
+		vy_blob_snprint_path(path, sizeof(path), arg->env->path,
+				     arg->space_id, arg->index_id,
+				     record->run_id);
+		if (arg->cb(path, arg->cb_arg) != 0)
+			return -1;
+	}
+
 	if (record->type != VY_LOG_CREATE_RUN || record->is_dropped)
 		goto out;
 
-	char path[PATH_MAX];
 	for (int type = 0; type < vy_file_MAX; type++) {
 		vy_run_snprint_path(path, sizeof(path), arg->env->path,
 				    arg->space_id, arg->index_id,
@@ -241,6 +241,11 @@ vinyl_engine_check_space_def(struct space_def *def)
 			 def->name, "engine does not support temporary flag");
 		return -1;
 	}
+	if (def->opts.field_map != FIELD_MAP_INDEXED) {
+		diag_set(ClientError, ER_ALTER_SPACE,
+			 def->name, "engine does not support field_map");
+		return -1;
+	}
 	return 0;
 }
 
@@ -212,6 +212,26 @@ vinyl_space_check_index_def(struct space *space, struct index_def *index_def)
 			 space_name(space), "vinyl does not support collation");
 		return -1;
 	}
+	if (index_def->opts.rank) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name(space), "vinyl does not support rank");
+		return -1;
+	}
+	if (index_def->opts.covering) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name(space), "vinyl does not support covering");
+		return -1;
+	}
+	if (index_def->opts.hash_func != TUPLE_HASH_MURMUR) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name(space), "vinyl does not support hash_func");
+		return -1;
+	}
+	if (index_def->key_def->has_json_paths) {
+		diag_set(ClientError, ER_MODIFY_INDEX, index_def->name,
+			 space_name(space), "vinyl does not support JSON paths");
+		return -1;
+	}
 	return 0;
 }
 
@@ -0,0 +1,503 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "vy_blob.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <msgpuck.h>
+#include <small/region.h>
+
+#include "diag.h"
+#include "errcode.h"
+#include "fiber.h"
+#include "fio.h"
+#include "say.h"
+#include "trivia/util.h"
+#include "tuple_format.h"
+
+bool
+vy_blob_ref_decode(const char *data, struct vy_blob_ref *ref)
+{
+	if ((uint8_t)data[0] != 0xc7 ||
+	    (uint8_t)data[1] != VY_BLOB_REF_SIZE - 3 ||
+	    (uint8_t)data[2] != VY_BLOB_REF_EXT)
+		return false;
+	data += 3;
+	ref->id = mp_load_u64(&data);
+	ref->offset = mp_load_u64(&data);
+	ref->size = mp_load_u32(&data);
+	return true;
+}
+
+char *
+vy_blob_ref_encode(char *data, const struct vy_blob_ref *ref)
+{
+	data = mp_store_u8(data, 0xc7);
+	data = mp_store_u8(data, VY_BLOB_REF_SIZE - 3);
+	data = mp_store_u8(data, VY_BLOB_REF_EXT);
+	data = mp_store_u64(data, ref->id);
+	data = mp_store_u64(data, ref->offset);
+	data = mp_store_u32(data, ref->size);
+	return data;
+}
+
+int
+vy_blob_usage_add(struct vy_blob_usage **usage, uint32_t *count,
+		  int64_t id, uint64_t size)
+{
+	for (uint32_t i = 0; i < *count; i++) {
+		if ((*usage)[i].id == id) {
+			(*usage)[i].size += size;
+			return 0;
+		}
+	}
+	/*
+	 * A run refers to a few blobs at most so
+	 * there's no point in preallocating the array.
+	 */
+	size_t new_size = (*count + 1) * sizeof(**usage);
+	struct vy_blob_usage *new_usage = realloc(*usage, new_size);
+	if (new_usage == NULL) {
+		diag_set(OutOfMemory, new_size, "realloc",
+			 "struct vy_blob_usage");
+		return -1;
+	}
+	new_usage[*count].id = id;
+	new_usage[*count].size = size;
+	*usage = new_usage;
+	(*count)++;
+	return 0;
+}
+
+struct vy_blob *
+vy_blob_new(int64_t id)
+{
+	struct vy_blob *blob = calloc(1, sizeof(*blob));
+	if (blob == NULL) {
+		diag_set(OutOfMemory, sizeof(*blob), "malloc",
+			 "struct vy_blob");
+		return NULL;
+	}
+	blob->id = id;
+	blob->fd = -1;
+	blob->refs = 1;
+	rlist_create(&blob->in_index);
+	rlist_create(&blob->in_unused);
+	return blob;
+}
+
+void
+vy_blob_unref(struct vy_blob *blob)
+{
+	assert(blob->refs > 0);
+	if (--blob->refs > 0)
+		return;
+	if (blob->fd >= 0 && close(blob->fd) < 0)
+		say_syserror("close failed");
+	TRASH(blob);
+	free(blob);
+}
+
+int
+vy_blob_snprint_path(char *buf, int size, const char *dir,
+		     uint32_t space_id, uint32_t iid, int64_t blob_id)
+{
+	return snprintf(buf, size, "%s/%u/%u/%020lld.blob",
+			dir, (unsigned)space_id, (unsigned)iid,
+			(long long)blob_id);
+}
+
+int
+vy_blob_open(struct vy_blob *blob, const char *dir,
+	     uint32_t space_id, uint32_t iid)
+{
+	assert(blob->fd < 0);
+	char path[PATH_MAX];
+	vy_blob_snprint_path(path, sizeof(path), dir, space_id, iid, blob->id);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open file '%s'", path);
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		diag_set(SystemError, "failed to stat file '%s'", path);
+		close(fd);
+		return -1;
+	}
+	blob->fd = fd;
+	blob->size = st.st_size;
+	return 0;
+}
+
+struct vy_blob *
+vy_blob_find(struct vy_blob **blobs, uint32_t count, int64_t id)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		if (blobs[i] != NULL && blobs[i]->id == id)
+			return blobs[i];
+	}
+	return NULL;
+}
+
+/** Read a value referenced by @ref from @blob to @buf. */
+static int
+vy_blob_read(struct vy_blob *blob, const struct vy_blob_ref *ref, char *buf)
+{
+	ssize_t rc = fio_pread(blob->fd, buf, ref->size, ref->offset);
+	if (rc < 0) {
+		diag_set(SystemError, "failed to read from blob file");
+		return -1;
+	}
+	if ((size_t)rc != ref->size) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 tt_sprintf("Unexpected end of blob %lld",
+				    (long long)blob->id));
+		return -1;
+	}
+	const char *pos = buf;
+	if (mp_check(&pos, buf + ref->size) != 0 || pos != buf + ref->size) {
+		diag_set(ClientError, ER_INVALID_RUN_FILE,
+			 tt_sprintf("Invalid value in blob %lld",
+				    (long long)blob->id));
+		return -1;
+	}
+	return 0;
+}
+
+int
+vy_blob_resolve(struct vy_blob **blobs, uint32_t count,
+		const char *data, const char *data_end,
+		char **res, uint32_t *res_size)
+{
+	*res = NULL;
+	*res_size = 0;
+
+	/* Compute the size of the result. */
+	const char *pos = data;
+	uint32_t field_count = mp_decode_array(&pos);
+	size_t size = data_end - data;
+	bool has_refs = false;
+	for (uint32_t i = 0; i < field_count; i++) {
+		struct vy_blob_ref ref;
+		if (vy_blob_ref_decode(pos, &ref) &&
+		    vy_blob_find(blobs, count, ref.id) != NULL) {
+			size += ref.size - VY_BLOB_REF_SIZE;
+			has_refs = true;
+		}
+		mp_next(&pos);
+	}
+	if (!has_refs)
+		return 0;
+
+	char *buf = malloc(size);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "tuple");
+		return -1;
+	}
+	pos = data;
+	mp_decode_array(&pos);
+	char *w = mp_encode_array(buf, field_count);
+	for (uint32_t i = 0; i < field_count; i++) {
+		const char *field = pos;
+		mp_next(&pos);
+		struct vy_blob_ref ref;
+		struct vy_blob *blob;
+		if (vy_blob_ref_decode(field, &ref) &&
+		    (blob = vy_blob_find(blobs, count, ref.id)) != NULL) {
+			if (vy_blob_read(blob, &ref, w) != 0) {
+				free(buf);
+				return -1;
+			}
+			w += ref.size;
+		} else {
+			memcpy(w, field, pos - field);
+			w += pos - field;
+		}
+	}
+	assert(w == buf + size);
+	*res = buf;
+	*res_size = size;
+	return 0;
+}
+
+struct vy_blob_writer *
+vy_blob_writer_new(int64_t id, const char *dir, uint32_t space_id,
+		   uint32_t iid, uint64_t threshold,
+		   struct tuple_format *format)
+{
+	struct vy_blob_writer *writer = calloc(1, sizeof(*writer));
+	if (writer == NULL) {
+		diag_set(OutOfMemory, sizeof(*writer), "malloc",
+			 "struct vy_blob_writer");
+		return NULL;
+	}
+	char path[PATH_MAX];
+	vy_blob_snprint_path(path, sizeof(path), dir, space_id, iid, id);
+	writer->path = strdup(path);
+	if (writer->path == NULL) {
+		diag_set(OutOfMemory, strlen(path), "strdup", "path");
+		free(writer);
+		return NULL;
+	}
+	writer->id = id;
+	writer->fd = -1;
+	writer->threshold = threshold;
+	writer->format = format;
+	tuple_format_ref(format);
+	return writer;
+}
+
+void
+vy_blob_writer_delete(struct vy_blob_writer *writer)
+{
+	if (writer->fd >= 0 && close(writer->fd) < 0)
+		say_syserror("close failed");
+	for (uint32_t i = 0; i < writer->src_count; i++)
+		vy_blob_unref(writer->src[i].blob);
+	tuple_format_unref(writer->format);
+	free(writer->src);
+	free(writer->usage);
+	free(writer->path);
+	free(writer);
+}
+
+int
+vy_blob_writer_add_src(struct vy_blob_writer *writer,
+		       struct vy_blob *blob, bool relocate)
+{
+	for (uint32_t i = 0; i < writer->src_count; i++) {
+		if (writer->src[i].blob == blob)
+			return 0;
+	}
+	size_t size = (writer->src_count + 1) * sizeof(*writer->src);
+	struct vy_blob_writer_src *src = realloc(writer->src, size);
+	if (src == NULL) {
+		diag_set(OutOfMemory, size, "realloc",
+			 "struct vy_blob_writer_src");
+		return -1;
+	}
+	src[writer->src_count].blob = blob;
+	src[writer->src_count].relocate = relocate;
+	writer->src = src;
+	writer->src_count++;
+	vy_blob_ref(blob);
+	return 0;
+}
+
+static struct vy_blob_writer_src *
+vy_blob_writer_find_src(struct vy_blob_writer *writer, int64_t id)
+{
+	for (uint32_t i = 0; i < writer->src_count; i++) {
+		if (writer->src[i].blob->id == id)
+			return &writer->src[i];
+	}
+	return NULL;
+}
+
+/**
+ * Return true if a field may be moved to a blob, i.e.
+ * it isn't indexed and the format doesn't check its type.
+ */
+static bool
+vy_blob_writer_field_is_movable(struct vy_blob_writer *writer,
+				uint32_t fieldno)
+{
+	struct tuple_format *format = writer->format;
+	if (fieldno >= format->field_count)
+		return true;
+	const struct tuple_field *field = &format->fields[fieldno];
+	return field->type == FIELD_TYPE_ANY && !field->is_key_part;
+}
+
+/**
+ * Append a value to the output blob and fill
+ * a reference to it.
+ */
+static int
+vy_blob_writer_append(struct vy_blob_writer *writer,
+		      const char *value, uint32_t size,
+		      struct vy_blob_ref *ref)
+{
+	if (writer->fd < 0) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s.inprogress", writer->path);
+		writer->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (writer->fd < 0) {
+			diag_set(SystemError, "failed to create file '%s'",
+				 path);
+			return -1;
+		}
+	}
+	if (fio_writen(writer->fd, value, size) != 0) {
+		diag_set(SystemError, "failed to write to file '%s'",
+			 writer->path);
+		return -1;
+	}
+	ref->id = writer->id;
+	ref->offset = writer->size;
+	ref->size = size;
+	writer->size += size;
+	return 0;
+}
+
+/** Return true if any field of a MsgPack array looks like a reference. */
+static bool
+vy_blob_has_ref_lookalike(const char *data)
+{
+	struct vy_blob_ref ref;
+	uint32_t field_count = mp_decode_array(&data);
+	for (uint32_t i = 0; i < field_count; i++) {
+		if (vy_blob_ref_decode(data, &ref))
+			return true;
+		mp_next(&data);
+	}
+	return false;
+}
+
+int
+vy_blob_writer_process(struct vy_blob_writer *writer,
+		       const char *data, const char *data_end,
+		       bool has_refs, const char **res,
+		       const char **res_end, bool *res_has_refs)
+{
+	*res_has_refs = false;
+	if (!has_refs && vy_blob_has_ref_lookalike(data)) {
+		/*
+		 * The statement can't be marked as containing
+		 * references, because the user value would be
+		 * taken for one, so write it as is.
+		 */
+		*res = data;
+		*res_end = data_end;
+		return 0;
+	}
+	struct region *region = &fiber()->gc;
+	char *buf = region_alloc(region, data_end - data);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, data_end - data, "region", "tuple");
+		return -1;
+	}
+	const char *pos = data;
+	uint32_t field_count = mp_decode_array(&pos);
+	char *w = mp_encode_array(buf, field_count);
+	for (uint32_t i = 0; i < field_count; i++) {
+		const char *field = pos;
+		mp_next(&pos);
+		uint32_t size = pos - field;
+		struct vy_blob_ref ref;
+		struct vy_blob_writer_src *src;
+		if (has_refs && vy_blob_ref_decode(field, &ref) &&
+		    (src = vy_blob_writer_find_src(writer, ref.id)) != NULL) {
+			if (src->relocate) {
+				/*
+				 * Move the value to the new blob so
+				 * that the source can be dropped.
+				 */
+				size_t used = region_used(region);
+				char *value = region_alloc(region, ref.size);
+				if (value == NULL) {
+					diag_set(OutOfMemory, ref.size,
+						 "region", "value");
+					return -1;
+				}
+				if (vy_blob_read(src->blob, &ref, value) != 0 ||
+				    vy_blob_writer_append(writer, value,
+							  ref.size, &ref) != 0)
+					return -1;
+				region_truncate(region, used);
+			}
+		} else if (writer->threshold > 0 &&
+			   size >= writer->threshold &&
+			   size > VY_BLOB_REF_SIZE &&
+			   vy_blob_writer_field_is_movable(writer, i)) {
+			if (vy_blob_writer_append(writer, field,
+						  size, &ref) != 0)
+				return -1;
+		} else {
+			/* Keep the mark on references we don't copy. */
+			if (has_refs && vy_blob_ref_decode(field, &ref))
+				*res_has_refs = true;
+			memcpy(w, field, size);
+			w += size;
+			continue;
+		}
+		if (vy_blob_usage_add(&writer->usage, &writer->usage_count,
+				      ref.id, ref.size) != 0)
+			return -1;
+		w = vy_blob_ref_encode(w, &ref);
+		*res_has_refs = true;
+	}
+	assert(w <= buf + (data_end - data));
+	*res = buf;
+	*res_end = w;
+	return 0;
+}
+
+int
+vy_blob_writer_finish(struct vy_blob_writer *writer)
+{
+	if (writer->fd < 0)
+		return 0;
+	if (fsync(writer->fd) < 0) {
+		diag_set(SystemError, "failed to sync file '%s'",
+			 writer->path);
+		return -1;
+	}
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s.inprogress", writer->path);
+	if (rename(path, writer->path) < 0) {
+		diag_set(SystemError, "failed to rename file '%s'", path);
+		return -1;
+	}
+	return 0;
+}
+
+void
+vy_blob_writer_discard(struct vy_blob_writer *writer)
+{
+	if (writer->fd < 0)
+		return;
+	close(writer->fd);
+	writer->fd = -1;
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s.inprogress", writer->path);
+	if (unlink(path) < 0 && errno != ENOENT)
+		say_syserror("failed to unlink file '%s'", path);
+	if (unlink(writer->path) < 0 && errno != ENOENT)
+		say_syserror("failed to unlink file '%s'", writer->path);
+}
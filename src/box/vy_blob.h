@@ -0,0 +1,273 @@
+#ifndef INCLUDES_TARANTOOL_BOX_VY_BLOB_H
+#define INCLUDES_TARANTOOL_BOX_VY_BLOB_H
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * Value log of a vinyl index.
+ *
+ * If the primary index has value_log_threshold set, a dump or
+ * compaction task moves big non-indexed fields of REPLACE
+ * statements out of the run to a separate append-only file,
+ * called blob, and leaves a short reference in their place.
+ * Compaction copies references as is so that large values are
+ * written to disk only once. A blob is written by the same task
+ * as the run and has the same id. It is deleted when no run
+ * refers to it any more. When most of a blob becomes garbage,
+ * compaction relocates the live values referenced by the
+ * compacted runs to a new blob.
+ *
+ * A user may store a value that looks exactly like a reference,
+ * so the statements that contain references are marked in the
+ * run (VY_STMT_BLOB_REFS) and only those are ever resolved. If
+ * a statement has a user value that looks like a reference,
+ * its fields are never moved to a blob.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <small/rlist.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct tuple_format;
+
+/** MsgPack extension type used for blob references. */
+enum { VY_BLOB_REF_EXT = 0x76 };
+
+/**
+ * Size of an encoded blob reference:
+ * ext8 header + blob id (8) + offset (8) + size (4).
+ */
+enum { VY_BLOB_REF_SIZE = 3 + 8 + 8 + 4 };
+
+/** Location of a value in a blob. */
+struct vy_blob_ref {
+	/** ID of the blob the value is stored in. */
+	int64_t id;
+	/** Offset of the value in the blob file. */
+	uint64_t offset;
+	/** Size of the value. */
+	uint32_t size;
+};
+
+/**
+ * Decode a blob reference from a MsgPack field.
+ * Return true if @data looks like a reference.
+ */
+bool
+vy_blob_ref_decode(const char *data, struct vy_blob_ref *ref);
+
+/**
+ * Encode a blob reference. @data must have at least
+ * VY_BLOB_REF_SIZE bytes. Return a pointer past the end.
+ */
+char *
+vy_blob_ref_encode(char *data, const struct vy_blob_ref *ref);
+
+/** Amount of data a run refers to in a particular blob. */
+struct vy_blob_usage {
+	/** ID of the blob. */
+	int64_t id;
+	/** Total size of values referenced by the run. */
+	uint64_t size;
+};
+
+/**
+ * Account @size bytes used in blob @id in a usage array,
+ * growing it if necessary.
+ * Return 0 on success, -1 on memory allocation error.
+ */
+int
+vy_blob_usage_add(struct vy_blob_usage **usage, uint32_t *count,
+		  int64_t id, uint64_t size);
+
+/** An open blob file. */
+struct vy_blob {
+	/** Unique ID of this blob, equals ID of the run that wrote it. */
+	int64_t id;
+	/** Blob file descriptor. */
+	int fd;
+	/** Size of the blob file. */
+	uint64_t size;
+	/** Size of values referenced by the index runs. */
+	uint64_t used;
+	/** Number of index runs referring to this blob. */
+	int run_count;
+	/**
+	 * Counter used on completion of a compaction task to check
+	 * if all runs referring to the blob have been compacted.
+	 */
+	int compacted_run_count;
+	/**
+	 * Blob reference counter, the blob is deleted once it hits 0.
+	 * A new blob is created with the reference counter set to 1.
+	 * A blob is referenced by each run that refers to it.
+	 */
+	int refs;
+	/** Link in vy_index::blobs list. */
+	struct rlist in_index;
+	/** Link in the list of blobs that became unused. */
+	struct rlist in_unused;
+};
+
+/** Allocate a new blob object with the given id. */
+struct vy_blob *
+vy_blob_new(int64_t id);
+
+static inline void
+vy_blob_ref(struct vy_blob *blob)
+{
+	assert(blob->refs > 0);
+	blob->refs++;
+}
+
+/** Drop a reference to a blob, delete it if it was the last one. */
+void
+vy_blob_unref(struct vy_blob *blob);
+
+/** Return the path to a blob file. */
+int
+vy_blob_snprint_path(char *buf, int size, const char *dir,
+		     uint32_t space_id, uint32_t iid, int64_t blob_id);
+
+/** Open the file of a blob for reading. */
+int
+vy_blob_open(struct vy_blob *blob, const char *dir,
+	     uint32_t space_id, uint32_t iid);
+
+/** Look up a blob by id in an array. */
+struct vy_blob *
+vy_blob_find(struct vy_blob **blobs, uint32_t count, int64_t id);
+
+/**
+ * Replace references to the given blobs in a MsgPack array
+ * with values read from disk. Uses blocking I/O. Must only be
+ * called for statements marked as containing references.
+ *
+ * On success, @res is set to a malloc'ed buffer with the
+ * resulting array or NULL if the tuple has no references.
+ * Return 0 on success, -1 on error.
+ */
+int
+vy_blob_resolve(struct vy_blob **blobs, uint32_t count,
+		const char *data, const char *data_end,
+		char **res, uint32_t *res_size);
+
+/** A blob used as a source of a blob writer. */
+struct vy_blob_writer_src {
+	/** The source blob. */
+	struct vy_blob *blob;
+	/**
+	 * Set if values referenced in the source blob must be
+	 * copied to the output blob.
+	 */
+	bool relocate;
+};
+
+/** Writer of a new blob, used by dump and compaction tasks. */
+struct vy_blob_writer {
+	/** ID of the blob to write. */
+	int64_t id;
+	/** Path to the blob file. */
+	char *path;
+	/** Output file descriptor or -1 if nothing was written. */
+	int fd;
+	/** Number of bytes written to the output file. */
+	uint64_t size;
+	/** Minimal size of a value to be moved to the blob. */
+	uint64_t threshold;
+	/** Format of statements, used to find movable fields. */
+	struct tuple_format *format;
+	/** Blobs referred to by input statements. */
+	struct vy_blob_writer_src *src;
+	uint32_t src_count;
+	/** Blob usage of the output run. */
+	struct vy_blob_usage *usage;
+	uint32_t usage_count;
+};
+
+/** Allocate a blob writer. */
+struct vy_blob_writer *
+vy_blob_writer_new(int64_t id, const char *dir, uint32_t space_id,
+		   uint32_t iid, uint64_t threshold,
+		   struct tuple_format *format);
+
+/** Destroy a blob writer. */
+void
+vy_blob_writer_delete(struct vy_blob_writer *writer);
+
+/**
+ * Add a source blob. The writer references the blob
+ * until it is deleted.
+ */
+int
+vy_blob_writer_add_src(struct vy_blob_writer *writer,
+		       struct vy_blob *blob, bool relocate);
+
+/**
+ * Process a REPLACE statement before writing it to a run:
+ * move big fields to the output blob, relocate referenced
+ * values if required, account blob usage. The result is
+ * allocated on the fiber region and is never larger than
+ * the input.
+ *
+ * @has_refs must be set if the statement was read from a run
+ * and is marked as containing references. On return
+ * @res_has_refs is set if the result contains references and
+ * must be marked as such in the output run.
+ */
+int
+vy_blob_writer_process(struct vy_blob_writer *writer,
+		       const char *data, const char *data_end,
+		       bool has_refs, const char **res,
+		       const char **res_end, bool *res_has_refs);
+
+/**
+ * Sync the output blob and make it visible.
+ * No-op if nothing was written.
+ */
+int
+vy_blob_writer_finish(struct vy_blob_writer *writer);
+
+/** Delete the incomplete output blob file. */
+void
+vy_blob_writer_discard(struct vy_blob_writer *writer);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* INCLUDES_TARANTOOL_BOX_VY_BLOB_H */
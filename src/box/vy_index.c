@@ -219,6 +219,7 @@ vy_index_new(struct vy_index_env *index_env, struct vy_cache_env *cache_env,
 	vy_range_tree_new(index->tree);
 	vy_range_heap_create(&index->range_heap);
 	rlist_create(&index->runs);
+	rlist_create(&index->blobs);
 	index->pk = pk;
 	if (pk != NULL)
 		vy_index_ref(pk);
@@ -290,6 +291,9 @@ vy_index_delete(struct vy_index *index)
 
 	vy_range_tree_iter(index->tree, NULL, vy_range_tree_free_cb, NULL);
 	vy_range_heap_destroy(&index->range_heap);
+	struct vy_blob *blob, *next_blob;
+	rlist_foreach_entry_safe(blob, &index->blobs, in_index, next_blob)
+		vy_blob_unref(blob);
 	tuple_format_unref(index->disk_format);
 	tuple_format_unref(index->mem_format_with_colmask);
 	tuple_format_unref(index->upsert_format);
@@ -314,11 +318,13 @@ vy_index_swap(struct vy_index *old_index, struct vy_index *new_index)
 	SWAP(old_index->dump_lsn, new_index->dump_lsn);
 	SWAP(old_index->range_count, new_index->range_count);
 	SWAP(old_index->run_count, new_index->run_count);
+	SWAP(old_index->blob_count, new_index->blob_count);
 	SWAP(old_index->stat, new_index->stat);
 	SWAP(old_index->run_hist, new_index->run_hist);
 	SWAP(old_index->tree, new_index->tree);
 	SWAP(old_index->range_heap, new_index->range_heap);
 	rlist_swap(&old_index->runs, &new_index->runs);
+	rlist_swap(&old_index->blobs, &new_index->blobs);
 }
 
 int
@@ -403,6 +409,7 @@ vy_index_recovery_cb(const struct vy_log_record *record, void *cb_arg)
 	struct tuple *begin = NULL, *end = NULL;
 	struct vy_run *run;
 	struct vy_slice *slice;
+	struct vy_blob *blob;
 	bool success = false;
 
 	assert(record->type == VY_LOG_CREATE_INDEX || index->commit_lsn >= 0);
@@ -446,6 +453,22 @@ vy_index_recovery_cb(const struct vy_log_record *record, void *cb_arg)
 		 */
 		index->truncate_count = UINT64_MAX;
 		break;
+	case VY_LOG_CREATE_BLOB:
+		if (record->is_dropped)
+			break;
+		assert(record->index_lsn == index->commit_lsn);
+		blob = vy_blob_new(record->run_id);
+		if (blob == NULL)
+			goto out;
+		if (vy_blob_open(blob, index->env->path,
+				 index->space_id, index->id) != 0) {
+			vy_blob_unref(blob);
+			goto out;
+		}
+		vy_index_add_blob(index, blob);
+		break;
+	case VY_LOG_DROP_BLOB:
+		break;
 	case VY_LOG_PREPARE_RUN:
 		break;
 	case VY_LOG_CREATE_RUN:
@@ -468,6 +491,10 @@ vy_index_recovery_cb(const struct vy_log_record *record, void *cb_arg)
 			vy_run_unref(run);
 			goto out;
 		}
+		if (vy_run_attach_blobs(run, &index->blobs) != 0) {
+			vy_run_unref(run);
+			goto out;
+		}
 		struct mh_i64ptr_node_t node = { run->id, run };
 		if (mh_i64ptr_put(run_hash, &node,
 				  NULL, NULL) == mh_end(run_hash)) {
@@ -682,6 +709,11 @@ vy_index_add_run(struct vy_index *index, struct vy_run *run)
 	rlist_add_entry(&index->runs, run, in_index);
 	index->run_count++;
 	vy_disk_stmt_counter_add(&index->stat.disk.count, &run->count);
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		struct vy_blob *blob = run->blobs[i];
+		blob->run_count++;
+		blob->used += run->info.blobs[i].size;
+	}
 }
 
 void
@@ -692,6 +724,30 @@ vy_index_remove_run(struct vy_index *index, struct vy_run *run)
 	rlist_del_entry(run, in_index);
 	index->run_count--;
 	vy_disk_stmt_counter_sub(&index->stat.disk.count, &run->count);
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		struct vy_blob *blob = run->blobs[i];
+		assert(blob->run_count > 0);
+		assert(blob->used >= run->info.blobs[i].size);
+		blob->run_count--;
+		blob->used -= run->info.blobs[i].size;
+	}
+}
+
+void
+vy_index_add_blob(struct vy_index *index, struct vy_blob *blob)
+{
+	assert(rlist_empty(&blob->in_index));
+	rlist_add_tail_entry(&index->blobs, blob, in_index);
+	index->blob_count++;
+}
+
+void
+vy_index_remove_blob(struct vy_index *index, struct vy_blob *blob)
+{
+	assert(index->blob_count > 0);
+	assert(!rlist_empty(&blob->in_index));
+	rlist_del_entry(blob, in_index);
+	index->blob_count--;
 }
 
 void
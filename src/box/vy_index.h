@@ -53,6 +53,7 @@ struct histogram;
 struct lsregion;
 struct tuple;
 struct tuple_format;
+struct vy_blob;
 struct vy_index;
 struct vy_mem;
 struct vy_recovery;
@@ -214,6 +215,13 @@ struct vy_index {
 	struct rlist runs;
 	/** Number of entries in all ranges. */
 	int run_count;
+	/**
+	 * List of all blobs of this index, linked by
+	 * vy_blob->in_index, see vy_blob.h.
+	 */
+	struct rlist blobs;
+	/** Number of entries in @blobs. */
+	int blob_count;
 	/**
 	 * Histogram accounting how many ranges of the index
 	 * have a particular number of runs.
@@ -386,6 +394,20 @@ vy_index_add_run(struct vy_index *index, struct vy_run *run);
 void
 vy_index_remove_run(struct vy_index *index, struct vy_run *run);
 
+/**
+ * Add a blob to the list of blobs of an index.
+ * The index takes over the reference held by the caller.
+ */
+void
+vy_index_add_blob(struct vy_index *index, struct vy_blob *blob);
+
+/**
+ * Remove a blob from the list of blobs of an index.
+ * The caller is supposed to drop the reference.
+ */
+void
+vy_index_remove_blob(struct vy_index *index, struct vy_blob *blob);
+
 /**
  * Add a range to both the range tree and the range heap
  * of an index.
@@ -113,6 +113,9 @@ static const char *vy_log_type_name[] = {
 	[VY_LOG_DUMP_INDEX]		= "dump_index",
 	[VY_LOG_SNAPSHOT]		= "snapshot",
 	[VY_LOG_TRUNCATE_INDEX]		= "truncate_index",
+	[VY_LOG_CREATE_BLOB]		= "create_blob",
+	[VY_LOG_DROP_BLOB]		= "drop_blob",
+	[VY_LOG_FORGET_BLOB]		= "forget_blob",
 };
 
 struct vy_recovery;
@@ -179,6 +182,8 @@ struct vy_recovery {
 	struct mh_i64ptr_t *run_hash;
 	/** ID -> vy_slice_recovery_info. */
 	struct mh_i64ptr_t *slice_hash;
+	/** ID -> vy_blob_recovery_info. */
+	struct mh_i64ptr_t *blob_hash;
 	/**
 	 * Maximal vinyl object ID, according to the metadata log,
 	 * or -1 in case no vinyl objects were recovered.
@@ -213,6 +218,11 @@ struct vy_index_recovery_info {
 	 * vy_run_recovery_info::in_index.
 	 */
 	struct rlist runs;
+	/**
+	 * List of all blobs created for the index,
+	 * linked by vy_blob_recovery_info::in_index.
+	 */
+	struct rlist blobs;
 };
 
 /** Vinyl range info stored in a recovery context. */
@@ -256,6 +266,21 @@ struct vy_run_recovery_info {
 	bool is_dropped;
 };
 
+/** Blob info stored in a recovery context. */
+struct vy_blob_recovery_info {
+	/** Link in vy_index_recovery_info::blobs. */
+	struct rlist in_index;
+	/** ID of the blob. */
+	int64_t id;
+	/**
+	 * For deleted blobs: LSN of the last checkpoint
+	 * that uses this blob.
+	 */
+	int64_t gc_lsn;
+	/** True if the blob was dropped (VY_LOG_DROP_BLOB). */
+	bool is_dropped;
+};
+
 /** Slice info stored in a recovery context. */
 struct vy_slice_recovery_info {
 	/** Link in vy_range_recovery_info::slices. */
@@ -615,15 +640,16 @@ vy_log_record_decode(struct vy_log_record *record,
 			break;
 		case VY_LOG_KEY_DEF: {
 			uint32_t part_count = mp_decode_array(&pos);
+			/* Vinyl does not support JSON path parts. */
+			size_t size = key_def_sizeof(part_count, 0);
 			struct key_def *key_def =
-				region_alloc(&fiber()->gc, key_def_sizeof(part_count));
+				region_alloc(&fiber()->gc, size);
 			if (key_def == NULL) {
-				diag_set(OutOfMemory,
-					 key_def_sizeof(part_count),
+				diag_set(OutOfMemory, size,
 					 "region", "struct key_def");
 				return -1;
 			}
-			memset(key_def, 0, key_def_sizeof(part_count));
+			memset(key_def, 0, size);
 			key_def->is_nullable = false;
 			key_def->unique_part_count = part_count;
 			key_def->part_count = part_count;
@@ -705,7 +731,9 @@ vy_log_record_dup(struct region *pool, const struct vy_log_record *src)
 		memcpy((char *)dst->end, src->end, size);
 	}
 	if (src->key_def != NULL) {
-		size_t size = key_def_sizeof(src->key_def->part_count);
+		assert(!src->key_def->has_json_paths);
+		size_t size = key_def_sizeof(src->key_def->part_count,
+					     src->key_def->path_pool_size);
 		dst->key_def = region_alloc(pool, size);
 		if (dst->key_def == NULL)
 			goto err;
@@ -1289,6 +1317,17 @@ vy_recovery_lookup_run(struct vy_recovery *recovery, int64_t run_id)
 	return mh_i64ptr_node(h, k)->val;
 }
 
+/** Lookup a vinyl blob in vy_recovery::blob_hash map. */
+static struct vy_blob_recovery_info *
+vy_recovery_lookup_blob(struct vy_recovery *recovery, int64_t blob_id)
+{
+	struct mh_i64ptr_t *h = recovery->blob_hash;
+	mh_int_t k = mh_i64ptr_find(h, blob_id, NULL);
+	if (k == mh_end(h))
+		return NULL;
+	return mh_i64ptr_node(h, k)->val;
+}
+
 /** Lookup a vinyl slice in vy_recovery::slice_hash map. */
 static struct vy_slice_recovery_info *
 vy_recovery_lookup_slice(struct vy_recovery *recovery, int64_t slice_id)
@@ -1357,6 +1396,7 @@ vy_recovery_create_index(struct vy_recovery *recovery, int64_t index_lsn,
 		index->space_id = space_id;
 		rlist_create(&index->ranges);
 		rlist_create(&index->runs);
+		rlist_create(&index->blobs);
 
 		node.val = index;
 		if (mh_i64ptr_put(h, &node, NULL, NULL) == mh_end(h)) {
@@ -1450,6 +1490,15 @@ vy_recovery_drop_index(struct vy_recovery *recovery, int64_t index_lsn)
 			return -1;
 		}
 	}
+	struct vy_blob_recovery_info *blob;
+	rlist_foreach_entry(blob, &index->blobs, in_index) {
+		if (!blob->is_dropped) {
+			diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+				 tt_sprintf("Dropped index %lld has active "
+					    "blobs", (long long)index_lsn));
+			return -1;
+		}
+	}
 	index->is_dropped = true;
 	return 0;
 }
@@ -1677,6 +1726,106 @@ vy_recovery_forget_run(struct vy_recovery *recovery, int64_t run_id)
 	return 0;
 }
 
+/**
+ * Handle a VY_LOG_CREATE_BLOB log record.
+ * This function allocates a new vinyl blob with ID @blob_id,
+ * inserts it to the hash, and adds it to the list of blobs of
+ * the index with ID @index_lsn.
+ * Return 0 on success, -1 on failure (ID collision or OOM).
+ */
+static int
+vy_recovery_create_blob(struct vy_recovery *recovery, int64_t index_lsn,
+			int64_t blob_id)
+{
+	struct vy_index_recovery_info *index;
+	index = vy_recovery_lookup_index_by_lsn(recovery, index_lsn);
+	if (index == NULL) {
+		diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+			 tt_sprintf("Blob %lld created for unregistered "
+				    "index %lld", (long long)blob_id,
+				    (long long)index_lsn));
+		return -1;
+	}
+	if (vy_recovery_lookup_blob(recovery, blob_id) != NULL) {
+		diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+			 tt_sprintf("Duplicate blob id %lld",
+				    (long long)blob_id));
+		return -1;
+	}
+	struct vy_blob_recovery_info *blob = malloc(sizeof(*blob));
+	if (blob == NULL) {
+		diag_set(OutOfMemory, sizeof(*blob),
+			 "malloc", "struct vy_blob_recovery_info");
+		return -1;
+	}
+	struct mh_i64ptr_t *h = recovery->blob_hash;
+	struct mh_i64ptr_node_t node = { blob_id, blob };
+	if (mh_i64ptr_put(h, &node, NULL, NULL) == mh_end(h)) {
+		diag_set(OutOfMemory, 0, "mh_i64ptr_put",
+			 "mh_i64ptr_node_t");
+		free(blob);
+		return -1;
+	}
+	blob->id = blob_id;
+	blob->gc_lsn = -1;
+	blob->is_dropped = false;
+	rlist_add_tail_entry(&index->blobs, blob, in_index);
+	if (recovery->max_id < blob_id)
+		recovery->max_id = blob_id;
+	return 0;
+}
+
+/**
+ * Handle a VY_LOG_DROP_BLOB log record.
+ * This function marks the vinyl blob with ID @blob_id as deleted.
+ * Return 0 on success, -1 if blob not found or already deleted.
+ */
+static int
+vy_recovery_drop_blob(struct vy_recovery *recovery, int64_t blob_id,
+		      int64_t gc_lsn)
+{
+	struct vy_blob_recovery_info *blob;
+	blob = vy_recovery_lookup_blob(recovery, blob_id);
+	if (blob == NULL) {
+		diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+			 tt_sprintf("Blob %lld deleted but not registered",
+				    (long long)blob_id));
+		return -1;
+	}
+	if (blob->is_dropped) {
+		diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+			 tt_sprintf("Blob %lld deleted twice",
+				    (long long)blob_id));
+		return -1;
+	}
+	blob->is_dropped = true;
+	blob->gc_lsn = gc_lsn;
+	return 0;
+}
+
+/**
+ * Handle a VY_LOG_FORGET_BLOB log record.
+ * This function frees the vinyl blob with ID @blob_id.
+ * Return 0 on success, -1 if blob not found.
+ */
+static int
+vy_recovery_forget_blob(struct vy_recovery *recovery, int64_t blob_id)
+{
+	struct mh_i64ptr_t *h = recovery->blob_hash;
+	mh_int_t k = mh_i64ptr_find(h, blob_id, NULL);
+	if (k == mh_end(h)) {
+		diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+			 tt_sprintf("Blob %lld forgotten but not registered",
+				    (long long)blob_id));
+		return -1;
+	}
+	struct vy_blob_recovery_info *blob = mh_i64ptr_node(h, k)->val;
+	mh_i64ptr_del(h, k, NULL);
+	rlist_del_entry(blob, in_index);
+	free(blob);
+	return 0;
+}
+
 /**
  * Handle a VY_LOG_INSERT_RANGE log record.
  * This function allocates a new vinyl range with ID @range_id,
@@ -1954,6 +2103,17 @@ vy_recovery_process_record(struct vy_recovery *recovery,
 		rc = vy_recovery_truncate_index(recovery, record->index_lsn,
 						record->truncate_count);
 		break;
+	case VY_LOG_CREATE_BLOB:
+		rc = vy_recovery_create_blob(recovery, record->index_lsn,
+					     record->run_id);
+		break;
+	case VY_LOG_DROP_BLOB:
+		rc = vy_recovery_drop_blob(recovery, record->run_id,
+					   record->gc_lsn);
+		break;
+	case VY_LOG_FORGET_BLOB:
+		rc = vy_recovery_forget_blob(recovery, record->run_id);
+		break;
 	default:
 		unreachable();
 	}
@@ -1979,6 +2139,7 @@ vy_recovery_new_f(va_list ap)
 	recovery->range_hash = NULL;
 	recovery->run_hash = NULL;
 	recovery->slice_hash = NULL;
+	recovery->blob_hash = NULL;
 	recovery->max_id = -1;
 
 	recovery->index_id_hash = mh_i64ptr_new();
@@ -1986,11 +2147,13 @@ vy_recovery_new_f(va_list ap)
 	recovery->range_hash = mh_i64ptr_new();
 	recovery->run_hash = mh_i64ptr_new();
 	recovery->slice_hash = mh_i64ptr_new();
+	recovery->blob_hash = mh_i64ptr_new();
 	if (recovery->index_id_hash == NULL ||
 	    recovery->index_lsn_hash == NULL ||
 	    recovery->range_hash == NULL ||
 	    recovery->run_hash == NULL ||
-	    recovery->slice_hash == NULL) {
+	    recovery->slice_hash == NULL ||
+	    recovery->blob_hash == NULL) {
 		diag_set(OutOfMemory, 0, "mh_i64ptr_new", "mh_i64ptr_t");
 		goto fail_free;
 	}
@@ -2100,6 +2263,8 @@ vy_recovery_delete(struct vy_recovery *recovery)
 		vy_recovery_delete_hash(recovery->run_hash);
 	if (recovery->slice_hash != NULL)
 		vy_recovery_delete_hash(recovery->slice_hash);
+	if (recovery->blob_hash != NULL)
+		vy_recovery_delete_hash(recovery->blob_hash);
 	TRASH(recovery);
 	free(recovery);
 }
@@ -2120,6 +2285,7 @@ vy_recovery_iterate_index(struct vy_index_recovery_info *index,
 	struct vy_range_recovery_info *range;
 	struct vy_slice_recovery_info *slice;
 	struct vy_run_recovery_info *run;
+	struct vy_blob_recovery_info *blob;
 	struct vy_log_record record;
 
 	vy_log_record_init(&record);
@@ -2149,6 +2315,26 @@ vy_recovery_iterate_index(struct vy_index_recovery_info *index,
 			return -1;
 	}
 
+	rlist_foreach_entry(blob, &index->blobs, in_index) {
+		vy_log_record_init(&record);
+		record.type = VY_LOG_CREATE_BLOB;
+		record.index_lsn = index->index_lsn;
+		record.run_id = blob->id;
+		record.is_dropped = blob->is_dropped;
+		if (vy_recovery_cb_call(cb, cb_arg, &record) != 0)
+			return -1;
+
+		if (!blob->is_dropped)
+			continue;
+
+		vy_log_record_init(&record);
+		record.type = VY_LOG_DROP_BLOB;
+		record.run_id = blob->id;
+		record.gc_lsn = blob->gc_lsn;
+		if (vy_recovery_cb_call(cb, cb_arg, &record) != 0)
+			return -1;
+	}
+
 	rlist_foreach_entry(run, &index->runs, in_index) {
 		vy_log_record_init(&record);
 		if (run->is_incomplete) {
@@ -2221,10 +2407,11 @@ vy_recovery_iterate(struct vy_recovery *recovery,
 		index = mh_i64ptr_node(recovery->index_id_hash, i)->val;
 		/*
 		 * Purge dropped indexes that are not referenced by runs
-		 * (and thus not needed for garbage collection) from the
-		 * log on rotation.
+		 * or blobs (and thus not needed for garbage collection)
+		 * from the log on rotation.
 		 */
-		if (index->is_dropped && rlist_empty(&index->runs))
+		if (index->is_dropped && rlist_empty(&index->runs) &&
+		    rlist_empty(&index->blobs))
 			continue;
 		if (vy_recovery_iterate_index(index, cb, cb_arg) < 0)
 			return -1;
@@ -154,6 +154,31 @@ enum vy_log_record_type {
 	 * Requires vy_log_record::index_lsn, truncate_count.
 	 */
 	VY_LOG_TRUNCATE_INDEX		= 12,
+	/**
+	 * Create a blob file, see vy_blob.h.
+	 * Requires vy_log_record::index_lsn, run_id.
+	 *
+	 * A blob is written by a dump or compaction task along
+	 * with a run and has the same id, so there's no separate
+	 * "prepare" record: if a run is not committed, its blob is
+	 * removed together with it.
+	 */
+	VY_LOG_CREATE_BLOB		= 13,
+	/**
+	 * Drop a blob file.
+	 * Requires vy_log_record::run_id, gc_lsn.
+	 *
+	 * Similarly to VY_LOG_DROP_RUN, this only marks the blob
+	 * as deleted. The blob is freed by VY_LOG_FORGET_BLOB.
+	 */
+	VY_LOG_DROP_BLOB		= 14,
+	/**
+	 * Forget a blob file.
+	 * Requires vy_log_record::run_id.
+	 *
+	 * Written after the blob file has been removed.
+	 */
+	VY_LOG_FORGET_BLOB		= 15,
 
 	vy_log_record_type_MAX
 };
@@ -174,9 +199,10 @@ struct vy_log_record {
 	/** Unique ID of the run slice. */
 	int64_t slice_id;
 	/**
-	 * For VY_LOG_CREATE_RUN record: hint that the run
-	 * is dropped, i.e. there is a VY_LOG_DROP_RUN record
-	 * following this one.
+	 * For VY_LOG_CREATE_RUN and VY_LOG_CREATE_BLOB records:
+	 * hint that the run or blob is dropped, i.e. there is
+	 * a VY_LOG_DROP_RUN or VY_LOG_DROP_BLOB record following
+	 * this one.
 	 */
 	bool is_dropped;
 	/**
@@ -198,8 +224,8 @@ struct vy_log_record {
 	/** Max LSN stored on disk. */
 	int64_t dump_lsn;
 	/**
-	 * For deleted runs: LSN of the last checkpoint
-	 * that uses this run.
+	 * For deleted runs and blobs: LSN of the last checkpoint
+	 * that uses this run or blob.
 	 */
 	int64_t gc_lsn;
 	/** Index truncate count. */
@@ -371,7 +397,7 @@ typedef int
  * To ease the work done by the callback, records corresponding to
  * slices of a range always go right after the range, in the
  * chronological order, while an index's runs go after the index
- * and before its ranges.
+ * and before its ranges. Blobs go before runs.
  */
 int
 vy_recovery_iterate(struct vy_recovery *recovery,
@@ -532,6 +558,41 @@ vy_log_forget_run(int64_t run_id)
 	vy_log_write(&record);
 }
 
+/** Helper to log a blob file creation. */
+static inline void
+vy_log_create_blob(int64_t index_lsn, int64_t blob_id)
+{
+	struct vy_log_record record;
+	vy_log_record_init(&record);
+	record.type = VY_LOG_CREATE_BLOB;
+	record.index_lsn = index_lsn;
+	record.run_id = blob_id;
+	vy_log_write(&record);
+}
+
+/** Helper to log a blob file deletion. */
+static inline void
+vy_log_drop_blob(int64_t blob_id, int64_t gc_lsn)
+{
+	struct vy_log_record record;
+	vy_log_record_init(&record);
+	record.type = VY_LOG_DROP_BLOB;
+	record.run_id = blob_id;
+	record.gc_lsn = gc_lsn;
+	vy_log_write(&record);
+}
+
+/** Helper to log a blob file cleanup. */
+static inline void
+vy_log_forget_blob(int64_t blob_id)
+{
+	struct vy_log_record record;
+	vy_log_record_init(&record);
+	record.type = VY_LOG_FORGET_BLOB;
+	record.run_id = blob_id;
+	vy_log_write(&record);
+}
+
 /** Helper to log creation of a run slice. */
 static inline void
 vy_log_insert_slice(int64_t range_id, int64_t run_id, int64_t slice_id,
@@ -32,6 +32,8 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #include <tarantool_ev.h> /* ev_tstamp */
 
@@ -83,6 +85,22 @@ struct vy_quota {
 	size_t watermark;
 	/** Current memory consumption. */
 	size_t used;
+	/**
+	 * Max rate at which transactions may consume memory,
+	 * in bytes per second, or SIZE_MAX if unlimited. It is
+	 * set while memory is being dumped so as to spread
+	 * throttling of transactions over the whole dump rather
+	 * than stall all of them at once when the limit is hit.
+	 */
+	size_t rate_limit;
+	/**
+	 * Amount of memory transactions may consume before they
+	 * are throttled by the rate limit. Replenished with
+	 * vy_quota_refill(). May be negative.
+	 */
+	ssize_t rate_budget;
+	/** Number of times a transaction was throttled by rate. */
+	int64_t rate_throttled;
 	/** Used-defined callbacks. */
 	vy_quota_exceeded_f quota_exceeded_cb;
 	vy_quota_throttled_f quota_throttled_cb;
@@ -98,6 +116,9 @@ vy_quota_init(struct vy_quota *q,
 	q->limit = SIZE_MAX;
 	q->watermark = SIZE_MAX;
 	q->used = 0;
+	q->rate_limit = SIZE_MAX;
+	q->rate_budget = 0;
+	q->rate_throttled = 0;
 	q->quota_exceeded_cb = quota_exceeded_cb;
 	q->quota_throttled_cb = quota_throttled_cb;
 	q->quota_released_cb = quota_released_cb;
@@ -136,6 +157,51 @@ vy_quota_set_watermark(struct vy_quota *q, size_t watermark)
 		q->quota_exceeded_cb(q);
 }
 
+/**
+ * Set the rate at which transactions may consume memory,
+ * SIZE_MAX disables the rate limit.
+ */
+static inline void
+vy_quota_set_rate_limit(struct vy_quota *q, size_t rate_limit)
+{
+	bool was_limited = (q->rate_limit != SIZE_MAX);
+	q->rate_limit = rate_limit;
+	if (rate_limit == SIZE_MAX) {
+		q->rate_budget = 0;
+		if (was_limited && q->used < q->limit)
+			q->quota_released_cb(q);
+	}
+}
+
+/**
+ * Let transactions consume @size more bytes of memory before
+ * they are throttled by the rate limit. The budget doesn't
+ * accumulate beyond @size, so that throttled transactions
+ * can't burst through once memory is dumped slower than
+ * expected.
+ */
+static inline void
+vy_quota_refill(struct vy_quota *q, size_t size)
+{
+	if (q->rate_limit == SIZE_MAX)
+		return;
+	q->rate_budget += size;
+	if (q->rate_budget > (ssize_t)size)
+		q->rate_budget = size;
+	if (q->rate_budget >= 0 && q->used < q->limit)
+		q->quota_released_cb(q);
+}
+
+/**
+ * Return true if a transaction must wait until the rate
+ * limit budget is replenished.
+ */
+static inline bool
+vy_quota_is_rate_limited(struct vy_quota *q)
+{
+	return q->rate_limit != SIZE_MAX && q->rate_budget < 0;
+}
+
 /**
  * Consume @size bytes of memory. In contrast to vy_quota_use()
  * this function does not throttle the caller.
@@ -162,16 +228,32 @@ vy_quota_release(struct vy_quota *q, size_t size)
 
 /**
  * Try to consume @size bytes of memory, throttle the caller
- * if the limit is exceeded. @timeout specifies the maximal
- * time to wait. Return 0 on success, -1 on timeout.
+ * if the limit or the rate limit is exceeded. @timeout
+ * specifies the maximal time to wait. Return 0 on success,
+ * -1 on timeout. Note, a transaction is never failed due to
+ * the rate limit, it is only delayed.
  */
 static inline int
 vy_quota_use(struct vy_quota *q, size_t size, ev_tstamp timeout)
 {
 	vy_quota_force_use(q, size);
-	while (q->used >= q->limit && timeout > 0)
+	bool is_budgeted = (q->rate_limit != SIZE_MAX);
+	if (is_budgeted) {
+		q->rate_budget -= size;
+		if (q->rate_budget < 0)
+			q->rate_throttled++;
+	}
+	while ((q->used >= q->limit || vy_quota_is_rate_limited(q)) &&
+	       timeout > 0)
 		timeout = q->quota_throttled_cb(q, timeout);
 	if (q->used > q->limit) {
+		/*
+		 * The memory is not consumed, so give back the
+		 * rate budget taken for it, unless the budget has
+		 * been reset by lifting the rate limit meanwhile.
+		 */
+		if (is_budgeted && q->rate_limit != SIZE_MAX)
+			q->rate_budget += size;
 		vy_quota_release(q, size);
 		return -1;
 	}
@@ -288,15 +288,13 @@ vy_range_remove_slice(struct vy_range *range, struct vy_slice *slice)
  * to be compacted and sets @compact_priority to the number of runs in
  * this level and all preceding levels.
  */
-void
-vy_range_update_compact_priority(struct vy_range *range,
-				 const struct index_opts *opts)
+static void
+vy_range_update_compact_priority_tiered(struct vy_range *range,
+					const struct index_opts *opts)
 {
 	assert(opts->run_count_per_level > 0);
 	assert(opts->run_size_ratio > 1);
 
-	range->compact_priority = 0;
-
 	/* Total number of checked runs. */
 	uint32_t total_run_count = 0;
 	/* The total size of runs checked so far. */
@@ -367,6 +365,63 @@ vy_range_update_compact_priority(struct vy_range *range,
 	}
 }
 
+/**
+ * Leveled compaction policy: every level holds exactly one run,
+ * which must be at least run_size_ratio times larger than all
+ * newer runs taken together. As soon as newer runs grow beyond
+ * that, they are merged into the run. Since a range covers
+ * a disjoint part of the key space, this means that runs of
+ * the same level never overlap and a read has to look at no
+ * more than log(range size / dump size, run_size_ratio) runs.
+ *
+ * Given a range, this function finds the oldest run that is
+ * too small compared to the newer runs and sets @compact_priority
+ * to the number of runs up to and including it.
+ */
+static void
+vy_range_update_compact_priority_leveled(struct vy_range *range,
+					 const struct index_opts *opts)
+{
+	assert(opts->run_size_ratio > 1);
+
+	/* Total number of checked runs. */
+	uint32_t total_run_count = 0;
+	/* The total size of runs checked so far. */
+	uint64_t total_size = 0;
+
+	struct vy_slice *slice;
+	rlist_foreach_entry(slice, &range->slices, in_range) {
+		uint64_t size = slice->count.bytes_compressed;
+		if (total_run_count > 0 &&
+		    size < total_size * opts->run_size_ratio) {
+			/*
+			 * The run is not big enough to make
+			 * a level of its own. Merge it with all
+			 * newer runs. Since the compacted run will
+			 * be larger, check older runs against it.
+			 */
+			range->compact_priority = total_run_count + 1;
+		}
+		total_size += size;
+		total_run_count++;
+	}
+}
+
+void
+vy_range_update_compact_priority(struct vy_range *range,
+				 const struct index_opts *opts)
+{
+	range->compact_priority = 0;
+	switch (opts->compaction) {
+	case VINYL_COMPACTION_LEVELED:
+		vy_range_update_compact_priority_leveled(range, opts);
+		break;
+	default:
+		vy_range_update_compact_priority_tiered(range, opts);
+		break;
+	}
+}
+
 /**
  * Return true and set split_key accordingly if the range needs to be
  * split in two.
@@ -97,7 +97,8 @@ struct vy_range {
 	 * when compacting L3.
 	 *
 	 * This variable contains the number of runs the next
-	 * compaction of this range will include.
+	 * compaction of this range will include. How it is
+	 * computed depends on the index compaction policy.
 	 *
 	 * The lower the level is scheduled for compaction,
 	 * the bigger it tends to be because upper levels are
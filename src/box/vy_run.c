@@ -57,6 +57,8 @@ static const uint64_t vy_run_info_key_map = (1 << VY_RUN_INFO_MIN_KEY) |
 					    (1 << VY_RUN_INFO_PAGE_COUNT);
 
 enum { VY_BLOOM_VERSION = 0 };
+/** Hash function bloom filters of new runs are built with. */
+enum { VY_BLOOM_HASH = TUPLE_HASH_CRC32C };
 
 /** xlog meta type for .run files */
 #define XLOG_META_TYPE_RUN "RUN"
@@ -96,6 +98,20 @@ struct vy_page_read_task {
 	struct vy_page *page;
 };
 
+/** Cbus task for reading values referenced by a statement. */
+struct vy_blob_read_task {
+	/** parent */
+	struct cbus_call_msg base;
+	/** vy_slice with blobs - ref. counted */
+	struct vy_slice *slice;
+	/** statement to resolve - ref. counted */
+	struct tuple *stmt;
+	/** [out] statement data with values, malloc'ed */
+	char *data;
+	/** [out] size of @data */
+	uint32_t data_size;
+};
+
 /** Destructor for env->zdctx_key thread-local variable */
 static void
 vy_free_zdctx(void *arg)
@@ -260,6 +276,49 @@ vy_run_clear(struct vy_run *run)
 	run->info.min_key = NULL;
 	free(run->info.max_key);
 	run->info.max_key = NULL;
+	if (run->blobs != NULL) {
+		for (uint32_t i = 0; i < run->info.blob_count; i++) {
+			if (run->blobs[i] != NULL)
+				vy_blob_unref(run->blobs[i]);
+		}
+		free(run->blobs);
+	}
+	run->blobs = NULL;
+	free(run->info.blobs);
+	run->info.blobs = NULL;
+	run->info.blob_count = 0;
+}
+
+int
+vy_run_attach_blobs(struct vy_run *run, struct rlist *blobs)
+{
+	assert(run->blobs == NULL);
+	if (run->info.blob_count == 0)
+		return 0;
+	run->blobs = calloc(run->info.blob_count, sizeof(*run->blobs));
+	if (run->blobs == NULL) {
+		diag_set(OutOfMemory, run->info.blob_count *
+			 sizeof(*run->blobs), "calloc", "struct vy_blob *");
+		return -1;
+	}
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		int64_t id = run->info.blobs[i].id;
+		struct vy_blob *blob;
+		rlist_foreach_entry(blob, blobs, in_index) {
+			if (blob->id == id)
+				break;
+		}
+		if (&blob->in_index == blobs) {
+			diag_set(ClientError, ER_INVALID_VYLOG_FILE,
+				 tt_sprintf("Blob %lld used by run %lld "
+					    "not found", (long long)id,
+					    (long long)run->id));
+			return -1;
+		}
+		vy_blob_ref(blob);
+		run->blobs[i] = blob;
+	}
+	return 0;
 }
 
 void
@@ -579,6 +638,38 @@ vy_run_bloom_decode(struct bloom *bloom, const char **buffer,
 	return 0;
 }
 
+/**
+ * Decode the list of blobs referenced by a run.
+ * @param run_info - run info to fill.
+ * @param buffer - pointer to a buffer to decode from.
+ * @param filename - filename for error reporting.
+ * @return - 0 on success or -1 on format/memory error
+ */
+static int
+vy_run_blobs_decode(struct vy_run_info *run_info, const char **buffer,
+		    const char *filename)
+{
+	const char **pos = buffer;
+	uint32_t count = mp_decode_array(pos);
+	run_info->blobs = calloc(count, sizeof(*run_info->blobs));
+	if (run_info->blobs == NULL) {
+		diag_set(OutOfMemory, count * sizeof(*run_info->blobs),
+			 "calloc", "struct vy_blob_usage");
+		return -1;
+	}
+	run_info->blob_count = count;
+	for (uint32_t i = 0; i < count; i++) {
+		if (mp_decode_array(pos) != 2) {
+			diag_set(ClientError, ER_INVALID_INDEX_FILE, filename,
+				 "Can't decode blob usage: wrong array size");
+			return -1;
+		}
+		run_info->blobs[i].id = mp_decode_uint(pos);
+		run_info->blobs[i].size = mp_decode_uint(pos);
+	}
+	return 0;
+}
+
 /**
  * Decode the run metadata from xrow.
  *
@@ -637,6 +728,21 @@ vy_run_info_decode(struct vy_run_info *run_info,
 			else
 				return -1;
 			break;
+		case VY_RUN_INFO_BLOBS:
+			if (vy_run_blobs_decode(run_info, &pos,
+						filename) != 0)
+				return -1;
+			break;
+		case VY_RUN_INFO_BLOOM_HASH:
+			run_info->bloom_hash = mp_decode_uint(&pos);
+			if (run_info->bloom_hash >= tuple_hash_version_MAX) {
+				diag_set(ClientError, ER_INVALID_INDEX_FILE,
+					 filename, tt_sprintf("Can't decode "
+					 "run info: unknown bloom hash %u",
+					 (unsigned)run_info->bloom_hash));
+				return -1;
+			}
+			break;
 		default:
 			diag_set(ClientError, ER_INVALID_INDEX_FILE, filename,
 				"Can't decode run info: unknown key %u",
@@ -954,6 +1060,103 @@ vy_page_read_cb_free(struct cbus_call_msg *base)
 	return 0;
 }
 
+/**
+ * vinyl blob read task callback
+ */
+static int
+vy_blob_read_cb(struct cbus_call_msg *base)
+{
+	struct vy_blob_read_task *task = (struct vy_blob_read_task *)base;
+	struct vy_run *run = task->slice->run;
+	uint32_t size;
+	const char *data = tuple_data_range(task->stmt, &size);
+	return vy_blob_resolve(run->blobs, run->info.blob_count,
+			       data, data + size,
+			       &task->data, &task->data_size);
+}
+
+/**
+ * vinyl blob read task cleanup callback
+ */
+static int
+vy_blob_read_cb_free(struct cbus_call_msg *base)
+{
+	struct vy_blob_read_task *task = (struct vy_blob_read_task *)base;
+	free(task->data);
+	tuple_unref(task->stmt);
+	vy_slice_unpin(task->slice);
+	free(task);
+	return 0;
+}
+
+/**
+ * Replace blob references in a statement read from the run
+ * with the values they point to, see vy_blob.h.
+ *
+ * @retval 0 success
+ * @retval -1 memory or read error
+ */
+static NODISCARD int
+vy_run_iterator_load_blobs(struct vy_run_iterator *itr, struct tuple **stmt)
+{
+	struct vy_run_env *env = itr->run_env;
+	struct vy_slice *slice = itr->slice;
+	struct vy_run *run = slice->run;
+	char *data;
+	uint32_t data_size;
+
+	if (env->reader_pool != NULL) {
+		struct vy_blob_read_task *task = calloc(1, sizeof(*task));
+		if (task == NULL) {
+			diag_set(OutOfMemory, sizeof(*task), "malloc",
+				 "vy_blob_read_task");
+			return -1;
+		}
+		struct vy_run_reader *reader;
+		reader = &env->reader_pool[env->next_reader++];
+		env->next_reader %= env->reader_pool_size;
+
+		/* Blobs are referenced by the run, see load_page(). */
+		vy_slice_pin(slice);
+		tuple_ref(*stmt);
+		task->slice = slice;
+		task->stmt = *stmt;
+
+		int rc = cbus_call(&reader->reader_pipe, &reader->tx_pipe,
+				   &task->base, vy_blob_read_cb,
+				   vy_blob_read_cb_free, TIMEOUT_INFINITY);
+		if (!task->base.complete)
+			return -1; /* timed out or cancelled */
+
+		data = task->data;
+		data_size = task->data_size;
+		tuple_unref(task->stmt);
+		vy_slice_unpin(slice);
+		free(task);
+		if (rc != 0)
+			return -1;
+	} else {
+		uint32_t size;
+		const char *tuple = tuple_data_range(*stmt, &size);
+		if (vy_blob_resolve(run->blobs, run->info.blob_count,
+				    tuple, tuple + size,
+				    &data, &data_size) != 0)
+			return -1;
+	}
+	if (data == NULL)
+		return 0; /* no references */
+
+	struct tuple *res = vy_stmt_new_replace(itr->format, data,
+						data + data_size);
+	free(data);
+	if (res == NULL)
+		return -1;
+	vy_stmt_set_lsn(res, vy_stmt_lsn(*stmt));
+	tuple_unref(*stmt);
+	*stmt = res;
+	return 0;
+}
+
 /**
  * Get a page by the given number the cache or load it from the disk.
  *
@@ -1345,9 +1548,11 @@ vy_run_iterator_start_from(struct vy_run_iterator *itr,
 		if (vy_stmt_type(key) == IPROTO_SELECT) {
 			const char *data = tuple_data(key);
 			mp_decode_array(&data);
-			hash = key_hash(data, key_def);
+			hash = key_hash_by_version(data, key_def,
+						   run->info.bloom_hash);
 		} else {
-			hash = tuple_hash(key, key_def);
+			hash = tuple_hash_by_version(key, key_def,
+						     run->info.bloom_hash);
 		}
 		if (!bloom_possible_has(&run->info.bloom, hash)) {
 			itr->search_ended = true;
@@ -1565,6 +1770,13 @@ vy_run_iterator_get(struct vy_run_iterator *itr, struct tuple **result)
 		itr->curr_stmt_pos.page_no = UINT32_MAX;
 	}
 	int rc = vy_run_iterator_read(itr, itr->curr_pos, result);
+	if (rc == 0 && itr->slice->run->info.blob_count > 0 &&
+	    vy_stmt_has_blob_refs(*result) &&
+	    vy_run_iterator_load_blobs(itr, result) != 0) {
+		tuple_unref(*result);
+		*result = NULL;
+		rc = -1;
+	}
 	if (rc == 0) {
 		itr->curr_stmt_pos = itr->curr_pos;
 		itr->curr_stmt = *result;
@@ -1914,7 +2126,7 @@ fail:
 static int
 vy_run_dump_stmt(const struct tuple *value, struct xlog *data_xlog,
 		 struct vy_page_info *info, const struct key_def *key_def,
-		 bool is_primary)
+		 bool is_primary, struct vy_blob_writer *blob_writer)
 {
 	struct region *region = &fiber()->gc;
 	size_t used = region_used(region);
@@ -1926,6 +2138,47 @@ vy_run_dump_stmt(const struct tuple *value, struct xlog *data_xlog,
 	if (rc != 0)
 		return -1;
 
+	if (blob_writer != NULL && vy_stmt_type(value) == IPROTO_REPLACE) {
+		/* Move big fields to the blob, see vy_blob.h. */
+		assert(is_primary);
+		uint32_t size;
+		struct request request;
+		memset(&request, 0, sizeof(request));
+		request.type = IPROTO_REPLACE;
+		const char *data = tuple_data_range(value, &size);
+		bool has_refs;
+		if (vy_blob_writer_process(blob_writer, data, data + size,
+					   vy_stmt_has_blob_refs(value),
+					   &request.tuple, &request.tuple_end,
+					   &has_refs) != 0)
+			return -1;
+		if (has_refs) {
+			/* Mark the statement, see VY_STMT_BLOB_REFS. */
+			const int MAP_LEN_MAX = 8;
+			char *map = region_alloc(region, MAP_LEN_MAX);
+			if (map == NULL) {
+				diag_set(OutOfMemory, MAP_LEN_MAX,
+					 "region", "map");
+				return -1;
+			}
+			char *pos = mp_encode_map(map, 2);
+			pos = mp_encode_uint(pos, VY_STMT_BLOB_REFS);
+			pos = mp_encode_bool(pos, true);
+			pos = mp_encode_uint(pos, IPROTO_TUPLE);
+			assert(pos <= map + MAP_LEN_MAX);
+			xrow.body[0].iov_base = map;
+			xrow.body[0].iov_len = pos - map;
+			xrow.body[1].iov_base = (char *)request.tuple;
+			xrow.body[1].iov_len = request.tuple_end -
+					       request.tuple;
+			xrow.bodycnt = 2;
+		} else {
+			xrow.bodycnt = xrow_encode_dml(&request, xrow.body);
+			if (xrow.bodycnt < 0)
+				return -1;
+		}
+	}
+
 	ssize_t row_size;
 	if ((row_size = xlog_write_row(data_xlog, &xrow)) < 0)
 		return -1;
@@ -2007,7 +2260,8 @@ vy_run_write_page(struct vy_run *run, struct xlog *data_xlog,
 		  uint64_t page_size, struct bloom_spectrum *bs,
 		  const struct key_def *cmp_def,
 		  const struct key_def *key_def, bool is_primary,
-		  uint32_t *page_info_capacity)
+		  uint32_t *page_info_capacity,
+		  struct vy_blob_writer *blob_writer)
 {
 	assert(curr_stmt != NULL);
 	assert(*curr_stmt != NULL);
@@ -2055,10 +2309,12 @@ vy_run_write_page(struct vy_run *run, struct xlog *data_xlog,
 		*offset = page->unpacked_size;
 
 		if (vy_run_dump_stmt(*curr_stmt, data_xlog, page,
-				     cmp_def, is_primary) != 0)
+				     cmp_def, is_primary, blob_writer) != 0)
 			goto error_rollback;
 
-		bloom_spectrum_add(bs, tuple_hash(*curr_stmt, key_def));
+		bloom_spectrum_add(bs, tuple_hash_by_version(*curr_stmt,
+							     key_def,
+							     VY_BLOOM_HASH));
 
 		int64_t lsn = vy_stmt_lsn(*curr_stmt);
 		run->info.min_lsn = MIN(run->info.min_lsn, lsn);
@@ -2152,7 +2408,8 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 		  struct vy_stmt_stream *wi, uint64_t page_size,
 		  const struct key_def *cmp_def,
 		  const struct key_def *key_def,
-		  size_t max_output_count, double bloom_fpr)
+		  size_t max_output_count, double bloom_fpr,
+		  struct vy_blob_writer *blob_writer)
 {
 	struct tuple *stmt;
 
@@ -2194,7 +2451,8 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	do {
 		rc = vy_run_write_page(run, &data_xlog, wi, &stmt,
 				       page_size, &bs, cmp_def, key_def,
-				       iid == 0, &page_info_capacity);
+				       iid == 0, &page_info_capacity,
+				       blob_writer);
 		if (rc < 0)
 			goto err_close_xlog;
 		fiber_gc();
@@ -2210,6 +2468,7 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	fiber_gc();
 
 	bloom_spectrum_choose(&bs, &run->info.bloom);
+	run->info.bloom_hash = VY_BLOOM_HASH;
 	run->info.has_bloom = true;
 	bloom_spectrum_destroy(&bs, runtime.quota);
 	done:
@@ -2317,6 +2576,39 @@ vy_run_bloom_encode_size(const struct bloom *bloom)
 	return size;
 }
 
+/**
+ * Calculate the size needed to store the list of blobs
+ * referenced by a run.
+ */
+static size_t
+vy_run_blobs_encode_size(const struct vy_run_info *run_info)
+{
+	size_t size = mp_sizeof_array(run_info->blob_count);
+	for (uint32_t i = 0; i < run_info->blob_count; i++) {
+		size += mp_sizeof_array(2);
+		size += mp_sizeof_uint(run_info->blobs[i].id);
+		size += mp_sizeof_uint(run_info->blobs[i].size);
+	}
+	return size;
+}
+
+/**
+ * Write the list of blobs referenced by a run to given buffer.
+ * The buffer must have at least vy_run_blobs_encode_size()
+ * @return - buffer + number of bytes written.
+ */
+static char *
+vy_run_blobs_encode(const struct vy_run_info *run_info, char *buffer)
+{
+	char *pos = mp_encode_array(buffer, run_info->blob_count);
+	for (uint32_t i = 0; i < run_info->blob_count; i++) {
+		pos = mp_encode_array(pos, 2);
+		pos = mp_encode_uint(pos, run_info->blobs[i].id);
+		pos = mp_encode_uint(pos, run_info->blobs[i].size);
+	}
+	return pos;
+}
+
 /**
  * Write bloom filter to given buffer.
  * The buffer must have at least vy_run_bloom_encode_size()
@@ -2360,7 +2652,8 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	size_t max_key_size = tmp - run_info->max_key;
 
 	assert(run_info->has_bloom);
-	size_t size = mp_sizeof_map(6);
+	uint32_t key_count = run_info->blob_count > 0 ? 8 : 7;
+	size_t size = mp_sizeof_map(key_count);
 	size += mp_sizeof_uint(VY_RUN_INFO_MIN_KEY) + min_key_size;
 	size += mp_sizeof_uint(VY_RUN_INFO_MAX_KEY) + max_key_size;
 	size += mp_sizeof_uint(VY_RUN_INFO_MIN_LSN) +
@@ -2371,6 +2664,11 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 		mp_sizeof_uint(run_info->page_count);
 	size += mp_sizeof_uint(VY_RUN_INFO_BLOOM) +
 		vy_run_bloom_encode_size(&run_info->bloom);
+	size += mp_sizeof_uint(VY_RUN_INFO_BLOOM_HASH) +
+		mp_sizeof_uint(run_info->bloom_hash);
+	if (run_info->blob_count > 0)
+		size += mp_sizeof_uint(VY_RUN_INFO_BLOBS) +
+			vy_run_blobs_encode_size(run_info);
 
 	char *pos = region_alloc(&fiber()->gc, size);
 	if (pos == NULL) {
@@ -2380,7 +2678,7 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	memset(xrow, 0, sizeof(*xrow));
 	xrow->body->iov_base = pos;
 	/* encode values */
-	pos = mp_encode_map(pos, 6);
+	pos = mp_encode_map(pos, key_count);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_MIN_KEY);
 	memcpy(pos, run_info->min_key, min_key_size);
 	pos += min_key_size;
@@ -2395,6 +2693,12 @@ vy_run_info_encode(const struct vy_run_info *run_info,
 	pos = mp_encode_uint(pos, run_info->page_count);
 	pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM);
 	pos = vy_run_bloom_encode(&run_info->bloom, pos);
+	pos = mp_encode_uint(pos, VY_RUN_INFO_BLOOM_HASH);
+	pos = mp_encode_uint(pos, run_info->bloom_hash);
+	if (run_info->blob_count > 0) {
+		pos = mp_encode_uint(pos, VY_RUN_INFO_BLOBS);
+		pos = vy_run_blobs_encode(run_info, pos);
+	}
 	xrow->body->iov_len = (void *)pos - xrow->body->iov_base;
 	xrow->bodycnt = 1;
 	xrow->type = VY_INDEX_RUN_INFO;
@@ -2466,7 +2770,8 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 	     struct vy_stmt_stream *wi, uint64_t page_size,
 	     const struct key_def *cmp_def,
 	     const struct key_def *key_def,
-	     size_t max_output_count, double bloom_fpr)
+	     size_t max_output_count, double bloom_fpr,
+	     struct vy_blob_writer *blob_writer)
 {
 	ERROR_INJECT(ERRINJ_VY_RUN_WRITE,
 		     {diag_set(ClientError, ER_INJECTION,
@@ -2478,16 +2783,52 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 
 	if (vy_run_write_data(run, dirpath, space_id, iid,
 			      wi, page_size, cmp_def, key_def,
-			      max_output_count, bloom_fpr) != 0)
-		return -1;
+			      max_output_count, bloom_fpr,
+			      blob_writer) != 0)
+		goto fail;
 
 	if (vy_run_is_empty(run))
 		return 0;
 
+	if (blob_writer != NULL) {
+		/* The blob must be on disk before the run index. */
+		if (vy_blob_writer_finish(blob_writer) != 0)
+			goto fail;
+		run->info.blobs = blob_writer->usage;
+		run->info.blob_count = blob_writer->usage_count;
+		blob_writer->usage = NULL;
+		blob_writer->usage_count = 0;
+	}
+
 	if (vy_run_write_index(run, dirpath, space_id, iid) != 0)
-		return -1;
+		goto fail;
 
 	return 0;
+fail:
+	if (blob_writer != NULL)
+		vy_blob_writer_discard(blob_writer);
+	return -1;
+}
+
+/**
+ * Account blob references found in a REPLACE statement marked
+ * with VY_STMT_BLOB_REFS in the run info. Used when the run
+ * index is rebuilt.
+ */
+static int
+vy_run_acct_blob_refs(struct vy_run_info *info, const struct tuple *stmt)
+{
+	const char *pos = tuple_data(stmt);
+	uint32_t field_count = mp_decode_array(&pos);
+	for (uint32_t i = 0; i < field_count; i++) {
+		struct vy_blob_ref ref;
+		if (vy_blob_ref_decode(pos, &ref) &&
+		    vy_blob_usage_add(&info->blobs, &info->blob_count,
+				      ref.id, ref.size) != 0)
+			return -1;
+		mp_next(&pos);
+	}
+	return 0;
 }
 
 int
@@ -2597,8 +2938,16 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 						     upsert_format, iid == 0);
 		if (tuple == NULL)
 			goto close_err;
-		bloom_add(&run->info.bloom, tuple_hash(tuple, key_def));
+		bloom_add(&run->info.bloom,
+			  tuple_hash_by_version(tuple, key_def, VY_BLOOM_HASH));
+		if (vy_stmt_has_blob_refs(tuple) &&
+		    vy_run_acct_blob_refs(&run->info, tuple) != 0) {
+			tuple_unref(tuple);
+			goto close_err;
+		}
+		tuple_unref(tuple);
 	}
+	run->info.bloom_hash = VY_BLOOM_HASH;
 	run->info.has_bloom = true;
 
 	region_truncate(region, mem_used);
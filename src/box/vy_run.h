@@ -40,6 +40,7 @@
 #include "vy_stmt_iterator.h" /* struct vy_stmt_iterator */
 #include "vy_stat.h"
 #include "index_def.h"
+#include "vy_blob.h"
 
 #include "small/mempool.h"
 #include "salad/bloom.h"
@@ -85,6 +86,16 @@ struct vy_run_info {
 	bool has_bloom;
 	/** Bloom filter of all tuples in run */
 	struct bloom bloom;
+	/**
+	 * Version of the hash function the bloom filter was built
+	 * with. Runs written before the version was stored use
+	 * TUPLE_HASH_MURMUR.
+	 */
+	enum tuple_hash_version bloom_hash;
+	/** Blobs the run refers to, see vy_blob.h. */
+	struct vy_blob_usage *blobs;
+	/** Number of entries in @blobs. */
+	uint32_t blob_count;
 };
 
 /**
@@ -115,6 +126,11 @@ struct vy_run {
 	struct vy_page_info *page_info;
 	/** Run data file. */
 	int fd;
+	/**
+	 * Blobs the run refers to (reference counted), in the
+	 * same order as info.blobs. Set by vy_run_attach_blobs().
+	 */
+	struct vy_blob **blobs;
 	/** Unique ID of this run. */
 	int64_t id;
 	/** Number of statements in this run. */
@@ -365,6 +381,16 @@ vy_run_rebuild_index(struct vy_run *run, const char *dir,
 		     struct tuple_format *upsert_format,
 		     const struct index_opts *opts);
 
+/**
+ * Find the blobs a run refers to in a list linked by
+ * vy_blob::in_index and reference them.
+ * @param run - run to attach blobs to
+ * @param blobs - list of blobs of the index
+ * @return - 0 on sucess, -1 if a blob is missing
+ */
+int
+vy_run_attach_blobs(struct vy_run *run, struct rlist *blobs);
+
 enum vy_file_type {
 	VY_FILE_INDEX,
 	VY_FILE_RUN,
@@ -400,7 +426,8 @@ vy_run_write(struct vy_run *run, const char *dirpath,
 	     struct vy_stmt_stream *wi, uint64_t page_size,
 	     const struct key_def *cmp_def,
 	     const struct key_def *key_def,
-	     size_t max_output_count, double bloom_fpr);
+	     size_t max_output_count, double bloom_fpr,
+	     struct vy_blob_writer *blob_writer);
 
 /**
  * Allocate a new run slice.
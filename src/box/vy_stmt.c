@@ -128,6 +128,7 @@ vy_stmt_alloc(struct tuple_format *format, uint32_t bsize)
 	tuple->data_offset = sizeof(struct vy_stmt) + meta_size;;
 	vy_stmt_set_lsn(tuple, 0);
 	vy_stmt_set_type(tuple, 0);
+	((struct vy_stmt *) tuple)->flags = 0;
 	return tuple;
 }
 
@@ -545,6 +546,29 @@ vy_stmt_encode_secondary(const struct tuple *value,
 		return 0;
 }
 
+/**
+ * Return true if a REPLACE statement read from a run is marked
+ * as containing blob references, see VY_STMT_BLOB_REFS.
+ */
+static bool
+vy_stmt_decode_blob_refs(const struct xrow_header *xrow)
+{
+	const char *pos = xrow->body[0].iov_base;
+	uint32_t size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < size; i++) {
+		if (mp_typeof(*pos) != MP_UINT) {
+			mp_next(&pos);
+			mp_next(&pos);
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&pos);
+		if (key == VY_STMT_BLOB_REFS && mp_typeof(*pos) == MP_BOOL)
+			return mp_decode_bool(&pos);
+		mp_next(&pos);
+	}
+	return false;
+}
+
 struct tuple *
 vy_stmt_decode(struct xrow_header *xrow, const struct key_def *key_def,
 	       struct tuple_format *format,
@@ -571,6 +595,8 @@ vy_stmt_decode(struct xrow_header *xrow, const struct key_def *key_def,
 		if (is_primary) {
 			stmt = vy_stmt_new_replace(format, request.tuple,
 					    request.tuple_end);
+			if (stmt != NULL && vy_stmt_decode_blob_refs(xrow))
+				vy_stmt_set_has_blob_refs(stmt);
 		} else {
 			stmt = vy_stmt_new_surrogate_from_key(request.tuple,
 							      IPROTO_REPLACE,
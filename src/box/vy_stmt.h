@@ -126,6 +126,8 @@ struct vy_stmt {
 	struct tuple base;
 	int64_t lsn;
 	uint8_t  type; /* IPROTO_SELECT/REPLACE/UPSERT/DELETE */
+	/** Bitmask of enum vy_stmt_flag. */
+	uint8_t  flags;
 	/**
 	 * Number of UPSERT statements for the same key preceding
 	 * this statement. Used to trigger upsert squashing in the
@@ -169,6 +171,32 @@ vy_stmt_set_type(struct tuple *stmt, enum iproto_type type)
 	((struct vy_stmt *) stmt)->type = type;
 }
 
+/** Vinyl statement flags. */
+enum vy_stmt_flag {
+	/**
+	 * The statement was read from a run and its fields may
+	 * contain references to the value log, see vy_blob.h.
+	 * Fields of statements without this flag are user data
+	 * even if they look like references.
+	 */
+	VY_STMT_HAS_BLOB_REFS = 1 << 0,
+};
+
+/** Return true if the statement may contain blob references. */
+static inline bool
+vy_stmt_has_blob_refs(const struct tuple *stmt)
+{
+	return (((const struct vy_stmt *) stmt)->flags &
+		VY_STMT_HAS_BLOB_REFS) != 0;
+}
+
+/** Mark the statement as containing blob references. */
+static inline void
+vy_stmt_set_has_blob_refs(struct tuple *stmt)
+{
+	((struct vy_stmt *) stmt)->flags |= VY_STMT_HAS_BLOB_REFS;
+}
+
 /** Get upserts count of the vinyl statement. */
 static inline uint8_t
 vy_stmt_n_upserts(const struct tuple *stmt)
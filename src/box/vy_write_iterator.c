@@ -181,6 +181,14 @@ struct vy_write_iterator {
 	 * key and its tuple format is different.
 	 */
 	bool is_primary;
+	/**
+	 * Blobs referenced by the source runs. Needed to apply
+	 * UPSERTs to REPLACEs stored in runs, see vy_blob.h.
+	 * The blobs are referenced by the runs.
+	 */
+	struct vy_blob **blobs;
+	/** Number of entries in @blobs. */
+	uint32_t blob_count;
 
 	/** Length of the @read_views. */
 	int rv_count;
@@ -416,6 +424,7 @@ vy_write_iterator_close(struct vy_stmt_stream *vstream)
 	vy_write_iterator_stop(vstream);
 	tuple_format_unref(stream->format);
 	tuple_format_unref(stream->upsert_format);
+	free(stream->blobs);
 	free(stream);
 }
 
@@ -443,6 +452,22 @@ vy_write_iterator_new_slice(struct vy_stmt_stream *vstream,
 			    struct vy_slice *slice, struct vy_run_env *run_env)
 {
 	struct vy_write_iterator *stream = (struct vy_write_iterator *)vstream;
+	struct vy_run *run = slice->run;
+	for (uint32_t i = 0; i < run->info.blob_count; i++) {
+		struct vy_blob *blob = run->blobs[i];
+		if (vy_blob_find(stream->blobs, stream->blob_count,
+				 blob->id) != NULL)
+			continue;
+		size_t size = (stream->blob_count + 1) * sizeof(*stream->blobs);
+		struct vy_blob **blobs = realloc(stream->blobs, size);
+		if (blobs == NULL) {
+			diag_set(OutOfMemory, size, "realloc",
+				 "struct vy_blob *");
+			return -1;
+		}
+		blobs[stream->blob_count++] = blob;
+		stream->blobs = blobs;
+	}
 	struct vy_write_src *src = vy_write_iterator_new_src(stream);
 	if (src == NULL)
 		return -1;
@@ -700,6 +725,43 @@ next_lsn:
 	return rc;
 }
 
+/**
+ * An UPSERT may update a field that was moved to a blob so
+ * before applying it to a REPLACE read from a run, replace
+ * blob references in the REPLACE with values.
+ *
+ * @param stream Write iterator.
+ * @param stmt   The statement to apply an UPSERT to (can be NULL).
+ * @param[out] res A new statement with values or NULL if
+ *                 @stmt has no references.
+ *
+ * @retval  0 Success.
+ * @retval -1 Memory or read error.
+ */
+static NODISCARD int
+vy_write_iterator_load_blobs(struct vy_write_iterator *stream,
+			     struct tuple *stmt, struct tuple **res)
+{
+	*res = NULL;
+	if (stream->blob_count == 0 || stmt == NULL ||
+	    !vy_stmt_has_blob_refs(stmt))
+		return 0;
+	char *data;
+	uint32_t size;
+	const char *tuple = tuple_data_range(stmt, &size);
+	if (vy_blob_resolve(stream->blobs, stream->blob_count,
+			    tuple, tuple + size, &data, &size) != 0)
+		return -1;
+	if (data == NULL)
+		return 0;
+	*res = vy_stmt_new_replace(stream->format, data, data + size);
+	free(data);
+	if (*res == NULL)
+		return -1;
+	vy_stmt_set_lsn(*res, vy_stmt_lsn(stmt));
+	return 0;
+}
+
 /**
  * Apply accumulated UPSERTs in the read view with a hint from
  * a previous read view. After merge, the read view must contain
@@ -734,10 +796,15 @@ vy_read_view_merge(struct vy_write_iterator *stream, struct tuple *hint,
 	     vy_stmt_type(hint) != IPROTO_UPSERT))) {
 		assert(!stream->is_last_level || hint == NULL ||
 		       vy_stmt_type(hint) != IPROTO_UPSERT);
+		struct tuple *loaded;
+		if (vy_write_iterator_load_blobs(stream, hint, &loaded) != 0)
+			return -1;
 		struct tuple *applied =
-			vy_apply_upsert(h->tuple, hint,
+			vy_apply_upsert(h->tuple, loaded != NULL ? loaded : hint,
 					stream->cmp_def, stream->format,
 					stream->upsert_format, false);
+		if (loaded != NULL)
+			tuple_unref(loaded);
 		if (applied == NULL)
 			return -1;
 		vy_stmt_unref_if_possible(h->tuple);
@@ -750,10 +817,17 @@ vy_read_view_merge(struct vy_write_iterator *stream, struct tuple *hint,
 		assert(h->tuple != NULL &&
 		       vy_stmt_type(h->tuple) == IPROTO_UPSERT);
 		assert(result->tuple != NULL);
+		struct tuple *loaded;
+		if (vy_write_iterator_load_blobs(stream, result->tuple,
+						 &loaded) != 0)
+			return -1;
 		struct tuple *applied =
-			vy_apply_upsert(h->tuple, result->tuple,
+			vy_apply_upsert(h->tuple, loaded != NULL ?
+					loaded : result->tuple,
 					stream->cmp_def, stream->format,
 					stream->upsert_format, false);
+		if (loaded != NULL)
+			tuple_unref(loaded);
 		if (applied == NULL)
 			return -1;
 		vy_stmt_unref_if_possible(result->tuple);
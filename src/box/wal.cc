@@ -305,7 +305,7 @@ wal_thread_start()
 		panic("failed to start WAL thread");
 
 	/* Create a pipe to WAL thread. */
-	cpipe_create(&wal_thread.wal_pipe, "wal");
+	cpipe_create_spsc(&wal_thread.wal_pipe, "wal");
 	cpipe_set_max_input(&wal_thread.wal_pipe, IOV_MAX);
 }
 
@@ -696,7 +696,7 @@ wal_thread_f(va_list ap)
 	 * endpoint, to ensure that WAL messages are delivered
 	 * even when tx fiber pool is used up by net messages.
 	 */
-	cpipe_create(&wal_thread.tx_pipe, "tx_prio");
+	cpipe_create_spsc(&wal_thread.tx_pipe, "tx_prio");
 
 	cbus_loop(&endpoint);
 
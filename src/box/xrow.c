@@ -391,6 +391,29 @@ iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 	memcpy(pos + IPROTO_HEADER_LEN, &body, sizeof(body));
 }
 
+int
+iproto_reply_cursor(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
+		    uint32_t schema_version, uint32_t count,
+		    uint64_t cursor_id)
+{
+	if (cursor_id != 0) {
+		char tail[1 + 9];
+		char *end = mp_encode_uint(tail, IPROTO_CURSOR_ID);
+		end = mp_encode_uint(end, cursor_id);
+		size_t size = end - tail;
+		if (obuf_dup(buf, tail, size) != size) {
+			diag_set(OutOfMemory, size, "obuf_dup", "cursor id");
+			return -1;
+		}
+	}
+	iproto_reply_select(buf, svp, sync, schema_version, count);
+	if (cursor_id != 0) {
+		char *pos = (char *) obuf_svp_to_ptr(buf, svp);
+		*(pos + IPROTO_HEADER_LEN) = 0x82; /* DATA and CURSOR_ID */
+	}
+	return 0;
+}
+
 void
 iproto_reply_sql(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		 uint32_t schema_version, int keys)
@@ -465,6 +488,9 @@ error:
 		case IPROTO_ITERATOR:
 			request->iterator = mp_decode_uint(&value);
 			break;
+		case IPROTO_CURSOR_ID:
+			request->cursor_id = mp_decode_uint(&value);
+			break;
 		case IPROTO_TUPLE:
 			request->tuple = value;
 			request->tuple_end = data;
@@ -139,6 +139,8 @@ struct request {
 	const char *ops_end;
 	/** Base field offset for UPDATE/UPSERT, e.g. 0 for C and 1 for Lua. */
 	int index_base;
+	/** Server-side cursor id for CURSOR_FETCH/CURSOR_CLOSE. */
+	uint64_t cursor_id;
 };
 
 /**
@@ -348,6 +350,18 @@ void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t schema_version, uint32_t count);
 
+/**
+ * Finish a reply to a cursor request, prepared as a select. If
+ * @a cursor_id is not 0, i.e. the cursor remains open, it is
+ * appended to the body after the data.
+ * @retval  0 Success.
+ * @retval -1 Memory error.
+ */
+int
+iproto_reply_cursor(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
+		    uint32_t schema_version, uint32_t count,
+		    uint64_t cursor_id);
+
 /**
  * Write header of the key to a preallocated buffer by svp.
  * @param buf Buffer to write to.
@@ -51,6 +51,56 @@ struct cbus {
 /** A singleton for all cords. */
 static struct cbus cbus;
 
+enum {
+	/** Number of messages a lock-free pipe ring can hold. */
+	CBUS_RING_SIZE = 1024,
+	/** Keep the producer and consumer data apart. */
+	CBUS_RING_ALIGN = 64,
+	/** Bounds of the consumer spin before sleeping. */
+	CBUS_SPIN_MIN = 16,
+	CBUS_SPIN_MAX = 1024,
+};
+
+/**
+ * A single producer single consumer ring of messages of a
+ * lock-free pipe. The producer writes messages at tail, the
+ * consumer reads them at head, both positions only grow.
+ *
+ * When the ring is full, the producer adds messages to the
+ * overflow list under the endpoint mutex, and keeps doing so
+ * until the consumer takes the list, so that messages are
+ * delivered in order. The consumer takes the overflow list
+ * only after all messages pushed to the ring before it.
+ */
+struct cbus_ring {
+	/** Link in cbus_endpoint::rings or ::new_rings. */
+	struct rlist in_endpoint;
+	/** Messages which didn't fit, protected by the mutex. */
+	struct stailq overflow;
+	/** Set while the overflow list is in use. */
+	bool is_overflow;
+	char pad1[CBUS_RING_ALIGN];
+	/** Position of the next message to read. */
+	uint64_t head;
+	/** The tail the consumer has been notified of. */
+	uint64_t seen_tail;
+	char pad2[CBUS_RING_ALIGN - 2 * sizeof(uint64_t)];
+	/** Position of the next message to write. */
+	uint64_t tail;
+	char pad3[CBUS_RING_ALIGN - sizeof(uint64_t)];
+	struct cmsg *msgs[CBUS_RING_SIZE];
+};
+
+static inline void
+cbus_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
 const char *cbus_stat_strings[CBUS_STAT_LAST] = {
 	"EVENTS",
 	"LOCKS",
@@ -87,8 +137,9 @@ static void
 cpipe_flush_cb(ev_loop * /* loop */, struct ev_async *watcher,
 	       int /* events */);
 
-void
-cpipe_create(struct cpipe *pipe, const char *consumer)
+static void
+cpipe_create_impl(struct cpipe *pipe, const char *consumer,
+		  struct cbus_ring *ring)
 {
 	stailq_create(&pipe->input);
 
@@ -109,18 +160,56 @@ cpipe_create(struct cpipe *pipe, const char *consumer)
 	}
 	pipe->endpoint = endpoint;
 	++pipe->endpoint->n_pipes;
+	pipe->ring = ring;
+	if (ring != NULL) {
+		tt_pthread_mutex_lock(&endpoint->mutex);
+		rlist_add_tail_entry(&endpoint->new_rings, ring, in_endpoint);
+		tt_pthread_mutex_unlock(&endpoint->mutex);
+	}
 	tt_pthread_mutex_unlock(&cbus.mutex);
 }
 
+void
+cpipe_create(struct cpipe *pipe, const char *consumer)
+{
+	cpipe_create_impl(pipe, consumer, NULL);
+}
+
+void
+cpipe_create_spsc(struct cpipe *pipe, const char *consumer)
+{
+	struct cbus_ring *ring = malloc(sizeof(*ring));
+	if (ring == NULL)
+		panic("failed to allocate cbus ring");
+	stailq_create(&ring->overflow);
+	/*
+	 * Until the consumer picks up the ring at the next
+	 * fetch, it doesn't poll it, so deliver messages via
+	 * the overflow list, which wakes the consumer up.
+	 */
+	ring->is_overflow = true;
+	ring->head = ring->tail = ring->seen_tail = 0;
+	cpipe_create_impl(pipe, consumer, ring);
+}
+
 struct cmsg_poison {
 	struct cmsg msg;
 	struct cbus_endpoint *endpoint;
+	/** The ring of the destroyed pipe, freed by the consumer. */
+	struct cbus_ring *ring;
 };
 
 static void
 cbus_endpoint_poison_f(struct cmsg *msg)
 {
 	struct cbus_endpoint *endpoint = ((struct cmsg_poison *)msg)->endpoint;
+	struct cbus_ring *ring = ((struct cmsg_poison *)msg)->ring;
+	if (ring != NULL) {
+		assert(ring->head == ring->tail);
+		assert(stailq_empty(&ring->overflow));
+		rlist_del_entry(ring, in_endpoint);
+		free(ring);
+	}
 	tt_pthread_mutex_lock(&cbus.mutex);
 	assert(endpoint->n_pipes > 0);
 	--endpoint->n_pipes;
@@ -143,17 +232,28 @@ cpipe_destroy(struct cpipe *pipe)
 	struct cmsg_poison *poison = malloc(sizeof(struct cmsg_poison));
 	cmsg_init(&poison->msg, route);
 	poison->endpoint = pipe->endpoint;
+	poison->ring = pipe->ring;
 	/*
 	 * Avoid the general purpose cpipe_push_input() since
 	 * we want to control the way the poison message is
 	 * delivered.
 	 */
 	tt_pthread_mutex_lock(&endpoint->mutex);
+	/*
+	 * Messages of a lock-free pipe go after the ones
+	 * in its ring, i.e. to the overflow list.
+	 */
+	struct stailq *output = &endpoint->output;
+	if (pipe->ring != NULL) {
+		output = &pipe->ring->overflow;
+		__atomic_store_n(&pipe->ring->is_overflow, true,
+				 __ATOMIC_RELAXED);
+	}
 	/* Flush input */
-	stailq_concat(&endpoint->output, &pipe->input);
+	stailq_concat(output, &pipe->input);
 	pipe->n_input = 0;
 	/* Add the pipe shutdown message as the last one. */
-	stailq_add_tail_entry(&endpoint->output, poison, msg.fifo);
+	stailq_add_tail_entry(output, poison, msg.fifo);
 	/* Count statistics */
 	rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
 	/*
@@ -197,6 +297,113 @@ cbus_destroy(struct cbus *bus)
 	rmean_delete(bus->stats);
 }
 
+/** Move messages pushed to the ring to the output. */
+static void
+cbus_ring_fetch(struct cbus_ring *ring, struct stailq *output)
+{
+	uint64_t head = ring->head;
+	uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		struct cmsg *msg = ring->msgs[head % CBUS_RING_SIZE];
+		stailq_add_tail_entry(output, msg, fifo);
+	}
+	__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+	ring->seen_tail = tail;
+}
+
+/**
+ * Check if any ring of the endpoint got messages since the
+ * last check. Messages the consumer has been notified of but
+ * hasn't fetched yet don't count, as otherwise the consumer
+ * loop would never sleep while they are pending. Messages of
+ * the overflow list are always notified with ev_async_send().
+ */
+static bool
+cbus_endpoint_has_ring_input(struct cbus_endpoint *endpoint)
+{
+	bool has_input = false;
+	struct cbus_ring *ring;
+	rlist_foreach_entry(ring, &endpoint->rings, in_endpoint) {
+		uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST);
+		if (tail != ring->seen_tail) {
+			ring->seen_tail = tail;
+			has_input = true;
+		}
+	}
+	return has_input;
+}
+
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
+{
+	struct cbus_ring *ring;
+	tt_pthread_mutex_lock(&endpoint->mutex);
+	stailq_concat(output, &endpoint->output);
+	while (!rlist_empty(&endpoint->new_rings)) {
+		ring = rlist_shift_entry(&endpoint->new_rings,
+					 struct cbus_ring, in_endpoint);
+		rlist_add_tail_entry(&endpoint->rings, ring, in_endpoint);
+	}
+	rlist_foreach_entry(ring, &endpoint->rings, in_endpoint) {
+		if (!ring->is_overflow)
+			continue;
+		/*
+		 * The producer doesn't push to the ring while
+		 * the overflow list is in use, so everything in
+		 * the ring goes before the list.
+		 */
+		cbus_ring_fetch(ring, output);
+		stailq_concat(output, &ring->overflow);
+		__atomic_store_n(&ring->is_overflow, false, __ATOMIC_RELEASE);
+	}
+	tt_pthread_mutex_unlock(&endpoint->mutex);
+	rlist_foreach_entry(ring, &endpoint->rings, in_endpoint)
+		cbus_ring_fetch(ring, output);
+}
+
+/**
+ * Before the consumer loop blocks, poll the rings for a while:
+ * a message arriving during the spin is handled without a
+ * wakeup. The spin doubles when it catches a message and halves
+ * when it doesn't. Then announce that the consumer waits, and
+ * check the rings once again, since a producer could have pushed
+ * a message before it saw the announcement.
+ */
+static void
+cbus_endpoint_prepare_cb(ev_loop *loop, struct ev_prepare *watcher,
+			 int events)
+{
+	(void) events;
+	struct cbus_endpoint *endpoint =
+		(struct cbus_endpoint *) watcher->data;
+	if (!rlist_empty(&endpoint->rings) && ev_pending_count(loop) == 0) {
+		for (int i = 0; i < endpoint->spin; i++) {
+			if (cbus_endpoint_has_ring_input(endpoint)) {
+				endpoint->spin = MIN(endpoint->spin * 2,
+						     CBUS_SPIN_MAX);
+				ev_feed_event(loop, &endpoint->async,
+					      EV_CUSTOM);
+				return;
+			}
+			cbus_cpu_relax();
+		}
+		endpoint->spin = MAX(endpoint->spin / 2, CBUS_SPIN_MIN);
+	}
+	__atomic_store_n(&endpoint->consumer_waits, 1, __ATOMIC_SEQ_CST);
+	if (cbus_endpoint_has_ring_input(endpoint))
+		ev_feed_event(loop, &endpoint->async, EV_CUSTOM);
+}
+
+static void
+cbus_endpoint_check_cb(ev_loop *loop, struct ev_check *watcher, int events)
+{
+	(void) loop;
+	(void) events;
+	struct cbus_endpoint *endpoint =
+		(struct cbus_endpoint *) watcher->data;
+	__atomic_store_n(&endpoint->consumer_waits, 0, __ATOMIC_RELAXED);
+}
+
 /**
  * Join a new endpoint (message consumer) to the bus. The endpoint
  * must have a unique name. Wakes up all producers (@sa cpipe_create())
@@ -224,6 +431,17 @@ cbus_endpoint_create(struct cbus_endpoint *endpoint, const char *name,
 	endpoint->async.data = fetch_data;
 	ev_async_start(endpoint->consumer, &endpoint->async);
 
+	rlist_create(&endpoint->rings);
+	rlist_create(&endpoint->new_rings);
+	endpoint->consumer_waits = 0;
+	endpoint->spin = CBUS_SPIN_MIN;
+	ev_prepare_init(&endpoint->prepare, cbus_endpoint_prepare_cb);
+	endpoint->prepare.data = endpoint;
+	ev_prepare_start(endpoint->consumer, &endpoint->prepare);
+	ev_check_init(&endpoint->check, cbus_endpoint_check_cb);
+	endpoint->check.data = endpoint;
+	ev_check_start(endpoint->consumer, &endpoint->check);
+
 	rlist_add_tail(&cbus.endpoints, &endpoint->in_cbus);
 	tt_pthread_mutex_unlock(&cbus.mutex);
 	/*
@@ -265,11 +483,51 @@ cbus_endpoint_destroy(struct cbus_endpoint *endpoint,
 	tt_pthread_mutex_unlock(&endpoint->mutex);
 	tt_pthread_mutex_destroy(&endpoint->mutex);
 	ev_async_stop(endpoint->consumer, &endpoint->async);
+	ev_prepare_stop(endpoint->consumer, &endpoint->prepare);
+	ev_check_stop(endpoint->consumer, &endpoint->check);
+	assert(rlist_empty(&endpoint->rings));
+	assert(rlist_empty(&endpoint->new_rings));
 	fiber_cond_destroy(&endpoint->cond);
 	TRASH(endpoint);
 	return 0;
 }
 
+/** Flush the input of a lock-free pipe. */
+static void
+cpipe_flush_ring(struct cpipe *pipe)
+{
+	struct cbus_ring *ring = pipe->ring;
+	struct cbus_endpoint *endpoint = pipe->endpoint;
+	if (!__atomic_load_n(&ring->is_overflow, __ATOMIC_ACQUIRE)) {
+		uint64_t tail = ring->tail;
+		uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		while (tail - head < CBUS_RING_SIZE &&
+		       !stailq_empty(&pipe->input)) {
+			ring->msgs[tail % CBUS_RING_SIZE] =
+				stailq_shift_entry(&pipe->input,
+						   struct cmsg, fifo);
+			tail++;
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_SEQ_CST);
+	}
+	pipe->n_input = 0;
+	if (!stailq_empty(&pipe->input)) {
+		/* The ring is full or not picked up yet. */
+		tt_pthread_mutex_lock(&endpoint->mutex);
+		stailq_concat(&ring->overflow, &pipe->input);
+		__atomic_store_n(&ring->is_overflow, true, __ATOMIC_RELAXED);
+		rmean_collect(cbus.stats, CBUS_STAT_LOCKS, 1);
+		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
+		ev_async_send(endpoint->consumer, &endpoint->async);
+		tt_pthread_mutex_unlock(&endpoint->mutex);
+		return;
+	}
+	if (__atomic_load_n(&endpoint->consumer_waits, __ATOMIC_SEQ_CST)) {
+		rmean_collect(cbus.stats, CBUS_STAT_EVENTS, 1);
+		ev_async_send(endpoint->consumer, &endpoint->async);
+	}
+}
+
 static void
 cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 {
@@ -281,6 +539,10 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 		return;
 
 	trigger_run(&pipe->on_flush, pipe);
+	if (pipe->ring != NULL) {
+		cpipe_flush_ring(pipe);
+		return;
+	}
 	/* Trigger task processing when the queue becomes non-empty. */
 	bool output_was_empty;
 
@@ -44,6 +44,7 @@ extern "C" {
 
 struct cmsg;
 struct cpipe;
+struct cbus_ring;
 typedef void (*cmsg_f)(struct cmsg *);
 
 enum cbus_stat_name {
@@ -140,6 +141,12 @@ struct cpipe {
 	 * is not empty.
 	 */
 	struct rlist on_flush;
+	/**
+	 * The lock-free ring to pass messages to the consumer,
+	 * NULL if the pipe uses the endpoint mutex.
+	 * @sa cpipe_create_spsc().
+	 */
+	struct cbus_ring *ring;
 };
 
 /**
@@ -151,6 +158,19 @@ struct cpipe {
 void
 cpipe_create(struct cpipe *pipe, const char *consumer);
 
+/**
+ * Like cpipe_create(), but flush messages to the consumer
+ * through a single producer single consumer ring rather than
+ * under the endpoint mutex, so that a busy pipe doesn't contend
+ * with other producers and the consumer. The consumer spins on
+ * its rings for a while before going to sleep, so the producer
+ * doesn't have to wake it up with ev_async_send() when messages
+ * flow steadily. If the consumer lags behind and the ring is
+ * full, messages go to the endpoint under the mutex.
+ */
+void
+cpipe_create_spsc(struct cpipe *pipe, const char *consumer);
+
 /**
  * Deinitialize a pipe and disconnect it from the consumer.
  * Must be called by producer. Will flash queued messages.
@@ -263,18 +283,31 @@ struct cbus_endpoint {
 	uint32_t n_pipes;
 	/** Condition for endpoint destroy */
 	struct fiber_cond cond;
+	/** Rings of connected lock-free pipes. */
+	struct rlist rings;
+	/**
+	 * Rings of pipes connected since the last fetch,
+	 * protected by the mutex.
+	 */
+	struct rlist new_rings;
+	/** Spins on the rings before the consumer loop sleeps. */
+	struct ev_prepare prepare;
+	/** Resets consumer_waits once the consumer loop wakes up. */
+	struct ev_check check;
+	/**
+	 * Set while the consumer loop may sleep: a producer
+	 * must wake it up after pushing to a ring.
+	 */
+	int consumer_waits;
+	/** How many times to poll the rings before sleeping. */
+	int spin;
 };
 
 /**
  * Fetch incomming messages to output
  */
-static inline void
-cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output)
-{
-	tt_pthread_mutex_lock(&endpoint->mutex);
-	stailq_concat(output, &endpoint->output);
-	tt_pthread_mutex_unlock(&endpoint->mutex);
-}
+void
+cbus_endpoint_fetch(struct cbus_endpoint *endpoint, struct stailq *output);
 
 /** Initialize the global singleton bus. */
 void
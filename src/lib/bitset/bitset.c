@@ -51,8 +51,7 @@ bitset_destroy_iter_cb(bitset_pages_t *t, struct bitset_page *page, void *arg)
 {
 	(void) t;
 	struct bitset *bitset = (struct bitset *) arg;
-	bitset_page_destroy(page);
-	bitset->realloc(page, 0);
+	bitset_page_delete(page, bitset->realloc);
 	return NULL;
 }
 
@@ -74,9 +73,9 @@ bitset_test(struct bitset *bitset, size_t pos)
 	if (page == NULL)
 		return false;
 
-	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	return bit_test(bitset_page_data(page), pos - page->first_pos);
+	assert(page->first_pos <= pos &&
+	       pos < page->first_pos + BITSET_PAGE_BIT);
+	return bitset_page_test(page, pos - page->first_pos);
 }
 
 int
@@ -88,29 +87,33 @@ bitset_set(struct bitset *bitset, size_t pos)
 	/* Find a page in pages tree */
 	struct bitset_page *page = bitset_pages_search(&bitset->pages, &key);
 	if (page == NULL) {
-		/* Allocate a new page */
-		size_t size = bitset_page_alloc_size(bitset->realloc);
-		page = bitset->realloc(NULL, size);
+		/* Allocate a new page, start with the most compact type */
+		page = bitset_page_new(BITSET_PAGE_ARRAY, bitset->realloc);
 		if (page == NULL)
 			return -1;
 
-		bitset_page_create(page);
 		page->first_pos = key.first_pos;
 
 		/* Insert the page into pages tree */
 		bitset_pages_insert(&bitset->pages, page);
 	}
 
-	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_set(bitset_page_data(page), pos - page->first_pos);
-	if (prev) {
+	assert(page->first_pos <= pos &&
+	       pos < page->first_pos + BITSET_PAGE_BIT);
+	int rc = bitset_page_set(page, pos - page->first_pos, bitset->realloc);
+	if (rc < 0) {
+		if (page->cardinality == 0) {
+			bitset_pages_remove(&bitset->pages, page);
+			bitset_page_delete(page, bitset->realloc);
+		}
+		return -1;
+	}
+	if (rc > 0) {
 		/* Value has not changed */
 		return 1;
 	}
 
 	bitset->cardinality++;
-	page->cardinality++;
 
 	return 0;
 }
@@ -126,24 +129,21 @@ bitset_clear(struct bitset *bitset, size_t pos)
 	if (page == NULL)
 		return 0;
 
-	assert(page->first_pos <= pos && pos < page->first_pos +
-	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_clear(bitset_page_data(page), pos - page->first_pos);
-	if (!prev) {
-		return 0;
-	}
+	assert(page->first_pos <= pos &&
+	       pos < page->first_pos + BITSET_PAGE_BIT);
+	int rc = bitset_page_clear(page, pos - page->first_pos,
+				   bitset->realloc);
+	if (rc <= 0)
+		return rc;
 
 	assert(bitset->cardinality > 0);
-	assert(page->cardinality > 0);
 	bitset->cardinality--;
-	page->cardinality--;
 
 	if (page->cardinality == 0) {
 		/* Remove the page from the pages tree */
 		bitset_pages_remove(&bitset->pages, page);
 		/* Free the page */
-		bitset_page_destroy(page);
-		bitset->realloc(page, 0);
+		bitset_page_delete(page, bitset->realloc);
 	}
 
 	return 1;
@@ -156,14 +156,26 @@ void
 bitset_info(struct bitset *bitset, struct bitset_info *info)
 {
 	memset(info, 0, sizeof(*info));
+	info->page_bit = BITSET_PAGE_BIT;
 	info->page_data_size = BITSET_PAGE_DATA_SIZE;
-	info->page_total_size = bitset_page_alloc_size(bitset->realloc);
 	info->page_data_alignment = BITSET_PAGE_DATA_ALIGNMENT;
 
 	size_t cardinality_check = 0;
 	struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	while (page != NULL) {
 		info->pages++;
+		switch (page->type) {
+		case BITSET_PAGE_ARRAY:
+			info->array_pages++;
+			break;
+		case BITSET_PAGE_BITMAP:
+			info->bitmap_pages++;
+			break;
+		case BITSET_PAGE_RUN:
+			info->run_pages++;
+			break;
+		}
+		info->mem_total += bitset_page_mem_size(page, bitset->realloc);
 		cardinality_check += page->cardinality;
 		page = bitset_pages_next(&bitset->pages, page);
 	}
@@ -178,15 +190,14 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 	struct bitset_info info;
 	bitset_info(bitset, &info);
 
-	size_t PAGE_BIT = (info.page_data_size * CHAR_BIT);
+	size_t PAGE_BIT = info.page_bit;
 
 	fprintf(stream, "Bitset %p\n", bitset);
 	fprintf(stream, "{\n");
-	fprintf(stream, "    " "page_size   = %zu/%zu /* (data / total) */\n",
-		info.page_data_size, info.page_total_size);
 	fprintf(stream, "    " "page_bit    = %zu\n", PAGE_BIT);
-	fprintf(stream, "    " "pages       = %zu\n", info.pages);
-
+	fprintf(stream, "    " "pages       = %zu "
+		"/* array: %zu, bitmap: %zu, run: %zu */\n", info.pages,
+		info.array_pages, info.bitmap_pages, info.run_pages);
 
 	size_t cardinality = bitset_cardinality(bitset);
 	size_t capacity = PAGE_BIT * info.pages;
@@ -204,10 +215,8 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		fprintf(stream, "    "
 			"utilization = undefined\n");
 	}
-	size_t mem_data  = info.page_data_size * info.pages;
-	size_t mem_total = info.page_total_size * info.pages;
+	size_t mem_total = info.mem_total;
 
-	fprintf(stream, "    " "mem_data    = %zu bytes\n", mem_data);
 	fprintf(stream, "    " "mem_total   = %zu bytes "
 		"/* data + padding + tree */\n", mem_total);
 	if (cardinality > 0) {
@@ -225,14 +234,15 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 	fprintf(stream, "    " "pages = {\n");
 
+	static const char *type_strs[] = { "array", "bitmap", "run" };
 	for (struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	     page != NULL; page = bitset_pages_next(&bitset->pages, page)) {
 
-		size_t page_last_pos = page->first_pos
-				+ BITSET_PAGE_DATA_SIZE * CHAR_BIT;
+		size_t page_last_pos = page->first_pos + PAGE_BIT;
 
-		fprintf(stream, "        " "[%zu, %zu) ",
-			page->first_pos, page_last_pos);
+		fprintf(stream, "        " "[%zu, %zu) %s ",
+			page->first_pos, page_last_pos,
+			type_strs[page->type]);
 
 		fprintf(stream, "utilization = %8.4f%% (%zu/%zu)",
 			(float) page->cardinality * 1e2 / PAGE_BIT,
@@ -246,12 +256,9 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "vals = {");
 
-		size_t pos = 0;
-		struct bit_iterator it;
-		bit_iterator_init(&it, bitset_page_data(page),
-			      BITSET_PAGE_DATA_SIZE, true);
-		while ( (pos = bit_iterator_next(&it)) != SIZE_MAX) {
-			fprintf(stream, "%zu, ", page->first_pos + pos);
+		for (size_t pos = 0; pos < PAGE_BIT; pos++) {
+			if (bitset_page_test(page, pos))
+				fprintf(stream, "%zu, ", page->first_pos + pos);
 		}
 
 		fprintf(stream, "}\n");
@@ -263,4 +270,3 @@ exit:
 	fprintf(stream, "}\n");
 }
 #endif /* defined(DEBUG) */
-
@@ -41,6 +41,11 @@
  * by \a size_t position number.  Initially all bits are set to
  * false. You can use any values in range [0,SIZE_MAX).  The
  * container grows automatically.
+ *
+ * Bits are split into pages of 2^16 positions.  A page is kept
+ * in a tree of pages and stores its bits in a sorted array of
+ * offsets, in a bitmap or in an array of runs, whichever is the
+ * most compact for the data, like Roaring bitmaps do.
  */
 
 #include "bit/bit.h"
@@ -66,11 +71,31 @@ extern "C" {
 #endif /* defined(__cplusplus) */
 
 /** @cond false */
+/**
+ * A page covers BITSET_PAGE_BIT consecutive positions and keeps
+ * them in one of the following containers depending on the data:
+ */
+enum bitset_page_type {
+	/** A sorted array of 16-bit offsets, for sparse pages */
+	BITSET_PAGE_ARRAY = 0,
+	/** A plain bitmap, for dense pages */
+	BITSET_PAGE_BITMAP = 1,
+	/** A sorted array of runs of set bits, for clustered pages */
+	BITSET_PAGE_RUN = 2,
+};
+
 struct bitset_page {
 	size_t first_pos;
 	rb_node(struct bitset_page) node;
 	size_t cardinality;
-	uint8_t data[0];
+	/** Container type, see enum bitset_page_type */
+	uint32_t type;
+	/** Number of values (array) or runs (run) in the container */
+	uint32_t size;
+	/** Number of allocated array or run slots */
+	uint32_t capacity;
+	/** Container payload */
+	void *data;
 };
 
 typedef rb_tree(struct bitset_page) bitset_pages_t;
@@ -151,12 +176,20 @@ bitset_cardinality(const struct bitset *bitset) {
 struct bitset_info {
 	/** Number of allocated pages */
 	size_t pages;
-	/** Data (payload) size of one page (in bytes) */
+	/** Number of pages stored as sorted arrays */
+	size_t array_pages;
+	/** Number of pages stored as bitmaps */
+	size_t bitmap_pages;
+	/** Number of pages stored as arrays of runs */
+	size_t run_pages;
+	/** Number of bits covered by one page */
+	size_t page_bit;
+	/** Data (payload) size of one bitmap page (in bytes) */
 	size_t page_data_size;
-	/** Full size of one page (in bytes, including padding and tree data) */
-	size_t page_total_size;
 	/** A multiplier by which an address of page data is aligned **/
 	size_t page_data_alignment;
+	/** Memory used by all pages (in bytes, including tree data) */
+	size_t mem_total;
 };
 
 /**
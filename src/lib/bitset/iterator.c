@@ -81,15 +81,11 @@ bitset_iterator_destroy(struct bitset_iterator *it)
 		it->realloc(it->conjs, 0);
 	}
 
-	if (it->page != NULL) {
-		bitset_page_destroy(it->page);
-		it->realloc(it->page, 0);
-	}
+	if (it->page != NULL)
+		bitset_page_delete(it->page, it->realloc);
 
-	if (it->page_tmp != NULL) {
-		bitset_page_destroy(it->page_tmp);
-		it->realloc(it->page_tmp, 0);
-	}
+	if (it->page_tmp != NULL)
+		bitset_page_delete(it->page_tmp, it->realloc);
 
 	memset(it, 0, sizeof(*it));
 }
@@ -183,25 +179,18 @@ bitset_iterator_init(struct bitset_iterator *it, struct bitset_expr *expr,
 		assert(p_bitsets != NULL);
 	}
 
-	size_t page_alloc_size = bitset_page_alloc_size(it->realloc);
-	if (it->page != NULL) {
-		bitset_page_destroy(it->page);
-	} else {
-		it->page = it->realloc(NULL, page_alloc_size);
+	if (it->page == NULL) {
+		it->page = bitset_page_new(BITSET_PAGE_BITMAP, it->realloc);
+		if (it->page == NULL)
+			return -1;
 	}
 
-	bitset_page_create(it->page);
-
-	if (it->page_tmp != NULL) {
-		bitset_page_destroy(it->page_tmp);
-	} else {
-		it->page_tmp = it->realloc(NULL, page_alloc_size);
+	if (it->page_tmp == NULL) {
+		it->page_tmp = bitset_page_new(BITSET_PAGE_BITMAP, it->realloc);
 		if (it->page_tmp == NULL)
 			return -1;
 	}
 
-	bitset_page_create(it->page_tmp);
-
 	if (bitset_iterator_reserve(it, expr->size) != 0)
 		return -1;
 
@@ -235,7 +224,7 @@ static void
 bitset_iterator_conj_rewind(struct bitset_iterator_conj *conj, size_t pos)
 {
 	assert(conj != NULL);
-	assert(pos % (BITSET_PAGE_DATA_SIZE * CHAR_BIT) == 0);
+	assert(pos % BITSET_PAGE_BIT == 0);
 	assert(conj->page_first_pos <= pos);
 
 	if (conj->size == 0) {
@@ -296,21 +285,71 @@ bitset_iterator_conj_cmp(const void *p1, const void *p2)
 	}
 }
 
+/**
+ * Find a non-negated array page in the conjunction. Return the
+ * one with the least number of values or NULL if there is none.
+ */
+static struct bitset_page *
+bitset_iterator_conj_array_page(struct bitset_iterator_conj *conj)
+{
+	struct bitset_page *min = NULL;
+	for (size_t b = 0; b < conj->size; b++) {
+		struct bitset_page *page = conj->pages[b];
+		if (conj->pre_nots[b] || page->type != BITSET_PAGE_ARRAY)
+			continue;
+		if (min == NULL || page->cardinality < min->cardinality)
+			min = page;
+	}
+	return min;
+}
+
+/**
+ * Calculate the conjunction on the current page and OR the result
+ * with @a dst. @a tmp is used as a scratch page.
+ */
 static void
 bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
-				  struct bitset_page *dst)
+				  struct bitset_page *dst,
+				  struct bitset_page *tmp)
 {
 	assert(conj != NULL);
 	assert(dst != NULL);
 	assert(conj->size > 0);
 	assert(conj->page_first_pos != SIZE_MAX);
 
-	bitset_page_set_ones(dst);
+	struct bitset_page *array = bitset_iterator_conj_array_page(conj);
+	if (array != NULL) {
+		/*
+		 * The result is a subset of a sparse page, so it is
+		 * cheaper to test each of its values against other
+		 * pages than to process whole bitmaps.
+		 */
+		const uint16_t *values = (const uint16_t *) array->data;
+		void *data = bitset_page_data(dst);
+		for (uint32_t i = 0; i < array->size; i++) {
+			size_t b;
+			for (b = 0; b < conj->size; b++) {
+				struct bitset_page *page = conj->pages[b];
+				if (page == array)
+					continue;
+				bool set = page != NULL &&
+					page->first_pos == conj->page_first_pos &&
+					bitset_page_test(page, values[i]);
+				if (set == conj->pre_nots[b])
+					break;
+			}
+			if (b == conj->size)
+				bit_set(data, values[i]);
+		}
+		return;
+	}
+
+	bitset_page_set_ones(tmp);
 	for (size_t b = 0; b < conj->size; b++) {
 		if (!conj->pre_nots[b]) {
 			/* conj->pages[b] is rewinded to conj->page_first_pos */
 			assert(conj->pages[b]->first_pos == conj->page_first_pos);
-			bitset_page_and(dst, conj->pages[b]);
+			bitset_page_and(tmp, conj->pages[b]);
 		} else {
 			/*
 			 * If page is NULL or its position is not equal
@@ -324,9 +363,11 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 			    conj->pages[b]->first_pos != conj->page_first_pos)
 				continue;
 
-			bitset_page_nand(dst, conj->pages[b]);
+			bitset_page_nand(tmp, conj->pages[b]);
 		}
 	}
+	/* OR page from conjunction with the result */
+	bitset_page_bitmap_or(dst, tmp);
 }
 
 static void
@@ -351,10 +392,8 @@ bitset_iterator_prepare_page(struct bitset_iterator *it)
 		if (it->conjs[c].page_first_pos > it->page->first_pos)
 			break;
 
-		/* Get result from conj */
-		bitset_iterator_conj_prepare_page(&it->conjs[c], it->page_tmp);
-		/* OR page from conjunction with it->page */
-		bitset_page_or(it->page, it->page_tmp);
+		bitset_iterator_conj_prepare_page(&it->conjs[c], it->page,
+						  it->page_tmp);
 	}
 
 	/* Init the bit iterator on it->page */
@@ -369,6 +408,7 @@ bitset_iterator_first_page(struct bitset_iterator *it)
 
 	/* Rewind all conjunctions to first positions */
 	for (size_t c = 0; c < it->size; c++) {
+		it->conjs[c].page_first_pos = 0;
 		bitset_iterator_conj_rewind(&it->conjs[c], 0);
 	}
 
@@ -381,7 +421,7 @@ bitset_iterator_next_page(struct bitset_iterator *it)
 {
 	assert(it != NULL);
 
-	size_t PAGE_BIT = BITSET_PAGE_DATA_SIZE * CHAR_BIT;
+	size_t PAGE_BIT = BITSET_PAGE_BIT;
 	size_t pos = it->page->first_pos;
 
 	/* Rewind all conjunctions that at the current position to the
@@ -425,3 +465,18 @@ bitset_iterator_next(struct bitset_iterator *it)
 		bitset_iterator_next_page(it);
 	}
 }
+
+size_t
+bitset_iterator_count(struct bitset_iterator *it)
+{
+	assert(it != NULL);
+
+	size_t count = 0;
+	bitset_iterator_first_page(it);
+	while (it->page->first_pos != SIZE_MAX) {
+		count += bitset_page_bitmap_count(it->page);
+		bitset_iterator_next_page(it);
+	}
+	bitset_iterator_first_page(it);
+	return count;
+}
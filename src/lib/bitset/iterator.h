@@ -135,6 +135,16 @@ bitset_iterator_rewind(struct bitset_iterator *it);
 size_t
 bitset_iterator_next(struct bitset_iterator *it);
 
+/**
+ * @brief Count the number of positions where the expression
+ * evaluates to true. The result is calculated page by page
+ * without iterating over individual bits. \a it is rewound.
+ * @param it bitset iterator
+ * @return the number of bits in the result set
+ */
+size_t
+bitset_iterator_count(struct bitset_iterator *it);
+
 #if defined(__cplusplus)
 }
 #endif /* defined(__cplusplus) */
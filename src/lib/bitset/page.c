@@ -33,20 +33,26 @@
 #include "bitset/bitset.h"
 
 extern inline size_t
-bitset_page_alloc_size(void *(*realloc_arg)(void *ptr, size_t size));
+bitset_page_bitmap_alloc_size(void *(*realloc_arg)(void *ptr, size_t size));
 
 extern inline void *
-bitset_page_data(struct bitset_page *page);
+bitset_page_data_align(void *data);
 
-extern inline void
-bitset_page_create(struct bitset_page *page);
-
-extern inline void
-bitset_page_destroy(struct bitset_page *page);
+extern inline void *
+bitset_page_data(const struct bitset_page *page);
 
 extern inline size_t
 bitset_page_first_pos(size_t pos);
 
+extern inline uint32_t
+bitset_page_array_find(const struct bitset_page *page, size_t pos);
+
+extern inline uint32_t
+bitset_page_run_find(const struct bitset_page *page, size_t pos);
+
+extern inline bool
+bitset_page_test(const struct bitset_page *page, size_t pos);
+
 extern inline void
 bitset_page_set_zeros(struct bitset_page *page);
 
@@ -54,23 +60,507 @@ extern inline void
 bitset_page_set_ones(struct bitset_page *page);
 
 extern inline void
-bitset_page_and(struct bitset_page *dst, struct bitset_page *src);
+bitset_page_bitmap_and(struct bitset_page *dst, const struct bitset_page *src);
 
 extern inline void
-bitset_page_nand(struct bitset_page *dst, struct bitset_page *src);
+bitset_page_bitmap_nand(struct bitset_page *dst, const struct bitset_page *src);
 
 extern inline void
-bitset_page_or(struct bitset_page *dst, struct bitset_page *src);
+bitset_page_bitmap_or(struct bitset_page *dst, const struct bitset_page *src);
+
+/** Initial number of slots in an array or a run page */
+const uint32_t PAGE_DEFAULT_CAPACITY = 4;
+
+/** Set or clear bits [first, last] in a bitmap */
+static void
+bitmap_fill(void *data, size_t first, size_t last, bool value)
+{
+	const size_t bits_per_word = CHAR_BIT * sizeof(unsigned long);
+	unsigned long *words = (unsigned long *) data;
+	size_t first_word = first / bits_per_word;
+	size_t last_word = last / bits_per_word;
+	unsigned long first_mask = ~0UL << (first % bits_per_word);
+	unsigned long last_mask = ~0UL >> (bits_per_word - 1 - last % bits_per_word);
+	if (first_word == last_word)
+		first_mask &= last_mask;
+	if (value)
+		words[first_word] |= first_mask;
+	else
+		words[first_word] &= ~first_mask;
+	if (first_word == last_word)
+		return;
+	memset(words + first_word + 1, value ? -1 : 0,
+	       (last_word - first_word - 1) * sizeof(*words));
+	if (value)
+		words[last_word] |= last_mask;
+	else
+		words[last_word] &= ~last_mask;
+}
+
+static void *
+bitmap_alloc(void *(*realloc_arg)(void *ptr, size_t size))
+{
+	size_t size = bitset_page_bitmap_alloc_size(realloc_arg);
+	void *data = realloc_arg(NULL, size);
+	if (data != NULL)
+		memset(data, 0, size);
+	return data;
+}
+
+struct bitset_page *
+bitset_page_new(enum bitset_page_type type,
+		void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(type == BITSET_PAGE_ARRAY || type == BITSET_PAGE_BITMAP);
+	struct bitset_page *page = realloc_arg(NULL, sizeof(*page));
+	if (page == NULL)
+		return NULL;
+	memset(page, 0, sizeof(*page));
+	page->type = type;
+	if (type == BITSET_PAGE_BITMAP) {
+		page->data = bitmap_alloc(realloc_arg);
+		if (page->data == NULL) {
+			realloc_arg(page, 0);
+			return NULL;
+		}
+	}
+	return page;
+}
+
+void
+bitset_page_delete(struct bitset_page *page,
+		   void *(*realloc_arg)(void *ptr, size_t size))
+{
+	if (page->data != NULL)
+		realloc_arg(page->data, 0);
+	realloc_arg(page, 0);
+}
+
+size_t
+bitset_page_mem_size(const struct bitset_page *page,
+		     void *(*realloc_arg)(void *ptr, size_t size))
+{
+	size_t size = sizeof(*page);
+	switch (page->type) {
+	case BITSET_PAGE_BITMAP:
+		size += bitset_page_bitmap_alloc_size(realloc_arg);
+		break;
+	case BITSET_PAGE_ARRAY:
+		size += page->capacity * sizeof(uint16_t);
+		break;
+	case BITSET_PAGE_RUN:
+		size += page->capacity * sizeof(struct bitset_page_run);
+		break;
+	default:
+		assert(false);
+	}
+	return size;
+}
+
+/**
+ * Make sure an array or a run page has room for one more
+ * slot of @a slot_size bytes.
+ */
+static int
+page_reserve(struct bitset_page *page, size_t slot_size,
+	     void *(*realloc_arg)(void *ptr, size_t size))
+{
+	if (page->size < page->capacity)
+		return 0;
+	uint32_t capacity = page->capacity > 0 ?
+			    page->capacity * 2 : PAGE_DEFAULT_CAPACITY;
+	void *data = realloc_arg(page->data, capacity * slot_size);
+	if (data == NULL)
+		return -1;
+	page->data = data;
+	page->capacity = capacity;
+	return 0;
+}
+
+/** Replace the data of @a page with a bitmap */
+static void
+page_set_bitmap(struct bitset_page *page, void *bitmap,
+		void *(*realloc_arg)(void *ptr, size_t size))
+{
+	if (page->data != NULL)
+		realloc_arg(page->data, 0);
+	page->type = BITSET_PAGE_BITMAP;
+	page->data = bitmap;
+	page->size = 0;
+	page->capacity = 0;
+}
+
+/**
+ * Convert a full array page to a run page if the values are
+ * clustered or to a bitmap page otherwise.
+ */
+static int
+page_array_convert(struct bitset_page *page,
+		   void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(page->type == BITSET_PAGE_ARRAY);
+	const uint16_t *values = (const uint16_t *) page->data;
+	uint32_t run_count = page->size > 0 ? 1 : 0;
+	for (uint32_t i = 1; i < page->size; i++) {
+		if (values[i] != values[i - 1] + 1)
+			run_count++;
+	}
+	if (run_count < BITSET_PAGE_RUN_MAX / 2) {
+		/* Leave some room for new runs */
+		uint32_t capacity = run_count * 2;
+		struct bitset_page_run *runs = realloc_arg(NULL,
+					capacity * sizeof(*runs));
+		if (runs == NULL)
+			return -1;
+		uint32_t r = 0;
+		for (uint32_t i = 0; i < page->size; i++) {
+			if (i > 0 && values[i] == values[i - 1] + 1) {
+				runs[r - 1].last = values[i];
+				continue;
+			}
+			runs[r].first = runs[r].last = values[i];
+			r++;
+		}
+		assert(r == run_count);
+		realloc_arg(page->data, 0);
+		page->type = BITSET_PAGE_RUN;
+		page->data = runs;
+		page->size = run_count;
+		page->capacity = capacity;
+		return 0;
+	}
+	void *bitmap = bitmap_alloc(realloc_arg);
+	if (bitmap == NULL)
+		return -1;
+	void *data = bitset_page_data_align(bitmap);
+	for (uint32_t i = 0; i < page->size; i++)
+		bit_set(data, values[i]);
+	page_set_bitmap(page, bitmap, realloc_arg);
+	return 0;
+}
+
+/** Convert a run page to a bitmap page */
+static int
+page_run_convert(struct bitset_page *page,
+		 void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(page->type == BITSET_PAGE_RUN);
+	void *bitmap = bitmap_alloc(realloc_arg);
+	if (bitmap == NULL)
+		return -1;
+	void *data = bitset_page_data_align(bitmap);
+	const struct bitset_page_run *runs =
+		(const struct bitset_page_run *) page->data;
+	for (uint32_t i = 0; i < page->size; i++)
+		bitmap_fill(data, runs[i].first, runs[i].last, true);
+	page_set_bitmap(page, bitmap, realloc_arg);
+	return 0;
+}
+
+/** Convert a sparse bitmap page to an array page */
+static int
+page_bitmap_convert(struct bitset_page *page,
+		    void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(page->type == BITSET_PAGE_BITMAP);
+	assert(page->cardinality <= BITSET_PAGE_ARRAY_MAX);
+	uint32_t capacity = page->cardinality * 2;
+	if (capacity > BITSET_PAGE_ARRAY_MAX)
+		capacity = BITSET_PAGE_ARRAY_MAX;
+	if (capacity < PAGE_DEFAULT_CAPACITY)
+		capacity = PAGE_DEFAULT_CAPACITY;
+	uint16_t *values = realloc_arg(NULL, capacity * sizeof(*values));
+	if (values == NULL)
+		return -1;
+	uint32_t size = 0;
+	struct bit_iterator it;
+	bit_iterator_init(&it, bitset_page_data(page),
+			  BITSET_PAGE_DATA_SIZE, true);
+	size_t pos;
+	while ((pos = bit_iterator_next(&it)) != SIZE_MAX)
+		values[size++] = pos;
+	assert(size == page->cardinality);
+	realloc_arg(page->data, 0);
+	page->type = BITSET_PAGE_ARRAY;
+	page->data = values;
+	page->size = size;
+	page->capacity = capacity;
+	return 0;
+}
+
+static int
+page_run_set(struct bitset_page *page, size_t pos,
+	     void *(*realloc_arg)(void *ptr, size_t size))
+{
+	uint32_t i = bitset_page_run_find(page, pos);
+	struct bitset_page_run *runs = (struct bitset_page_run *) page->data;
+	if (i > 0 && runs[i - 1].last >= pos)
+		return 1;
+	bool join_prev = i > 0 && (size_t) runs[i - 1].last + 1 == pos;
+	bool join_next = i < page->size && runs[i].first == pos + 1;
+	if (join_prev && join_next) {
+		runs[i - 1].last = runs[i].last;
+		memmove(runs + i, runs + i + 1,
+			(page->size - i - 1) * sizeof(*runs));
+		page->size--;
+	} else if (join_prev) {
+		runs[i - 1].last = pos;
+	} else if (join_next) {
+		runs[i].first = pos;
+	} else if (page->size == BITSET_PAGE_RUN_MAX) {
+		if (page_run_convert(page, realloc_arg) != 0)
+			return -1;
+		bit_set(bitset_page_data(page), pos);
+	} else {
+		if (page_reserve(page, sizeof(*runs), realloc_arg) != 0)
+			return -1;
+		runs = (struct bitset_page_run *) page->data;
+		memmove(runs + i + 1, runs + i,
+			(page->size - i) * sizeof(*runs));
+		runs[i].first = runs[i].last = pos;
+		page->size++;
+	}
+	return 0;
+}
+
+static int
+page_array_set(struct bitset_page *page, size_t pos,
+	       void *(*realloc_arg)(void *ptr, size_t size))
+{
+	uint32_t i = bitset_page_array_find(page, pos);
+	uint16_t *values = (uint16_t *) page->data;
+	if (i < page->size && values[i] == pos)
+		return 1;
+	if (page->size == BITSET_PAGE_ARRAY_MAX) {
+		if (page_array_convert(page, realloc_arg) != 0)
+			return -1;
+		if (page->type == BITSET_PAGE_RUN)
+			return page_run_set(page, pos, realloc_arg);
+		bit_set(bitset_page_data(page), pos);
+		return 0;
+	}
+	if (page_reserve(page, sizeof(*values), realloc_arg) != 0)
+		return -1;
+	values = (uint16_t *) page->data;
+	memmove(values + i + 1, values + i,
+		(page->size - i) * sizeof(*values));
+	values[i] = pos;
+	page->size++;
+	return 0;
+}
+
+int
+bitset_page_set(struct bitset_page *page, size_t pos,
+		void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(pos < BITSET_PAGE_BIT);
+	int rc;
+	switch (page->type) {
+	case BITSET_PAGE_BITMAP:
+		rc = bit_set(bitset_page_data(page), pos) ? 1 : 0;
+		break;
+	case BITSET_PAGE_ARRAY:
+		rc = page_array_set(page, pos, realloc_arg);
+		break;
+	case BITSET_PAGE_RUN:
+		rc = page_run_set(page, pos, realloc_arg);
+		break;
+	default:
+		assert(false);
+		return -1;
+	}
+	if (rc == 0)
+		page->cardinality++;
+	return rc;
+}
+
+static int
+page_array_clear(struct bitset_page *page, size_t pos)
+{
+	uint32_t i = bitset_page_array_find(page, pos);
+	uint16_t *values = (uint16_t *) page->data;
+	if (i == page->size || values[i] != pos)
+		return 0;
+	memmove(values + i, values + i + 1,
+		(page->size - i - 1) * sizeof(*values));
+	page->size--;
+	return 1;
+}
+
+static int
+page_run_clear(struct bitset_page *page, size_t pos,
+	       void *(*realloc_arg)(void *ptr, size_t size))
+{
+	uint32_t i = bitset_page_run_find(page, pos);
+	struct bitset_page_run *runs = (struct bitset_page_run *) page->data;
+	if (i == 0 || runs[i - 1].last < pos)
+		return 0;
+	struct bitset_page_run *run = &runs[i - 1];
+	if (run->first == run->last) {
+		memmove(runs + i - 1, runs + i,
+			(page->size - i) * sizeof(*runs));
+		page->size--;
+	} else if (run->first == pos) {
+		run->first++;
+	} else if (run->last == pos) {
+		run->last--;
+	} else if (page->size == BITSET_PAGE_RUN_MAX) {
+		if (page_run_convert(page, realloc_arg) != 0)
+			return -1;
+		bit_clear(bitset_page_data(page), pos);
+	} else {
+		/* Split the run in two */
+		if (page_reserve(page, sizeof(*runs), realloc_arg) != 0)
+			return -1;
+		runs = (struct bitset_page_run *) page->data;
+		memmove(runs + i + 1, runs + i,
+			(page->size - i) * sizeof(*runs));
+		runs[i].first = pos + 1;
+		runs[i].last = runs[i - 1].last;
+		runs[i - 1].last = pos - 1;
+		page->size++;
+	}
+	return 1;
+}
+
+int
+bitset_page_clear(struct bitset_page *page, size_t pos,
+		  void *(*realloc_arg)(void *ptr, size_t size))
+{
+	assert(pos < BITSET_PAGE_BIT);
+	int rc;
+	switch (page->type) {
+	case BITSET_PAGE_BITMAP:
+		rc = bit_clear(bitset_page_data(page), pos) ? 1 : 0;
+		break;
+	case BITSET_PAGE_ARRAY:
+		rc = page_array_clear(page, pos);
+		break;
+	case BITSET_PAGE_RUN:
+		rc = page_run_clear(page, pos, realloc_arg);
+		break;
+	default:
+		assert(false);
+		return -1;
+	}
+	if (rc != 1)
+		return rc;
+	assert(page->cardinality > 0);
+	page->cardinality--;
+	/*
+	 * Switch back to an array when the bitmap becomes sparse.
+	 * Use a lower threshold than the one used for the opposite
+	 * conversion so that a page does not flip its type back and
+	 * forth. Failure to convert is not an error.
+	 */
+	if (page->type == BITSET_PAGE_BITMAP && page->cardinality > 0 &&
+	    page->cardinality <= BITSET_PAGE_ARRAY_MAX / 4)
+		page_bitmap_convert(page, realloc_arg);
+	return 1;
+}
+
+size_t
+bitset_page_bitmap_count(const struct bitset_page *page)
+{
+	const uint64_t *words = (const uint64_t *) bitset_page_data(page);
+	size_t count = 0;
+	for (size_t i = 0; i < BITSET_PAGE_DATA_SIZE / sizeof(*words); i++)
+		count += bit_count_u64(words[i]);
+	return count;
+}
+
+void
+bitset_page_and(struct bitset_page *dst, const struct bitset_page *src)
+{
+	void *data = bitset_page_data(dst);
+	/* Clear everything between set bits of the source */
+	size_t next = 0;
+	switch (src->type) {
+	case BITSET_PAGE_BITMAP:
+		bitset_page_bitmap_and(dst, src);
+		return;
+	case BITSET_PAGE_ARRAY: {
+		const uint16_t *values = (const uint16_t *) src->data;
+		for (uint32_t i = 0; i < src->size; i++) {
+			if (values[i] > next)
+				bitmap_fill(data, next, values[i] - 1, false);
+			next = values[i] + 1;
+		}
+		break;
+	}
+	case BITSET_PAGE_RUN: {
+		const struct bitset_page_run *runs =
+			(const struct bitset_page_run *) src->data;
+		for (uint32_t i = 0; i < src->size; i++) {
+			if (runs[i].first > next)
+				bitmap_fill(data, next, runs[i].first - 1, false);
+			next = runs[i].last + 1;
+		}
+		break;
+	}
+	default:
+		assert(false);
+	}
+	if (next < BITSET_PAGE_BIT)
+		bitmap_fill(data, next, BITSET_PAGE_BIT - 1, false);
+}
+
+/** Set bits of @a dst that are set in @a src to @a value */
+static void
+page_fill(struct bitset_page *dst, const struct bitset_page *src, bool value)
+{
+	void *data = bitset_page_data(dst);
+	switch (src->type) {
+	case BITSET_PAGE_ARRAY: {
+		const uint16_t *values = (const uint16_t *) src->data;
+		for (uint32_t i = 0; i < src->size; i++) {
+			if (value)
+				bit_set(data, values[i]);
+			else
+				bit_clear(data, values[i]);
+		}
+		break;
+	}
+	case BITSET_PAGE_RUN: {
+		const struct bitset_page_run *runs =
+			(const struct bitset_page_run *) src->data;
+		for (uint32_t i = 0; i < src->size; i++)
+			bitmap_fill(data, runs[i].first, runs[i].last, value);
+		break;
+	}
+	default:
+		assert(false);
+	}
+}
+
+void
+bitset_page_nand(struct bitset_page *dst, const struct bitset_page *src)
+{
+	if (src->type == BITSET_PAGE_BITMAP)
+		bitset_page_bitmap_nand(dst, src);
+	else
+		page_fill(dst, src, false);
+}
+
+void
+bitset_page_or(struct bitset_page *dst, const struct bitset_page *src)
+{
+	if (src->type == BITSET_PAGE_BITMAP)
+		bitset_page_bitmap_or(dst, src);
+	else
+		page_fill(dst, src, true);
+}
 
 #if defined(DEBUG)
 void
 bitset_page_dump(struct bitset_page *page, FILE *stream)
 {
-	fprintf(stream, "Page %zu:\n", page->first_pos);
-	char *d = bitset_page_data(page);
-	for (int i = 0; i < BITSET_PAGE_DATA_SIZE; i++) {
-		fprintf(stream, "%x ", *d);
-		d++;
+	static const char *type_strs[] = { "array", "bitmap", "run" };
+	fprintf(stream, "Page %zu (%s):\n", page->first_pos,
+		type_strs[page->type]);
+	for (size_t pos = 0; pos < BITSET_PAGE_BIT; pos++) {
+		if (bitset_page_test(page, pos))
+			fprintf(stream, "%zu ", pos);
 	}
 	fprintf(stream, "\n--\n");
 }
@@ -54,8 +54,23 @@ extern "C" {
 #endif /* defined(__cplusplus) */
 
 enum {
-	/** How many bytes to store in one page */
-	BITSET_PAGE_DATA_SIZE = 160
+	/** How many bits to store in one page */
+	BITSET_PAGE_BIT = 1 << 16,
+	/** How many bytes to store in one bitmap page */
+	BITSET_PAGE_DATA_SIZE = BITSET_PAGE_BIT / CHAR_BIT,
+	/**
+	 * Max number of values in an array page. An array of
+	 * this size takes as much memory as a bitmap page does.
+	 */
+	BITSET_PAGE_ARRAY_MAX = BITSET_PAGE_DATA_SIZE / sizeof(uint16_t),
+	/** Max number of runs in a run page, same reasoning */
+	BITSET_PAGE_RUN_MAX = BITSET_PAGE_DATA_SIZE / (2 * sizeof(uint16_t)),
+};
+
+/** A run of set bits [first, last] in a run page */
+struct bitset_page_run {
+	uint16_t first;
+	uint16_t last;
 };
 
 #if defined(ENABLE_AVX)
@@ -88,51 +103,168 @@ typedef uint32_t bitset_word_t;
 #define MALLOC_ALIGNMENT 8
 #endif /* aligned malloc */
 
+/**
+ * Size of a memory block to allocate for the data of a bitmap page.
+ */
 inline size_t
-bitset_page_alloc_size(void *(*realloc_arg)(void *ptr, size_t size))
+bitset_page_bitmap_alloc_size(void *(*realloc_arg)(void *ptr, size_t size))
 {
 	if (BITSET_PAGE_DATA_ALIGNMENT <= 1 || (
 		(MALLOC_ALIGNMENT % BITSET_PAGE_DATA_ALIGNMENT == 0) &&
-		(sizeof(struct bitset_page) % BITSET_PAGE_DATA_ALIGNMENT == 0) &&
 		(realloc_arg == realloc))) {
 
 		/* Alignment is not needed */
-		return sizeof(struct bitset_page) + BITSET_PAGE_DATA_SIZE;
+		return BITSET_PAGE_DATA_SIZE;
 	}
 
-	return sizeof(struct bitset_page) + BITSET_PAGE_DATA_SIZE +
-			BITSET_PAGE_DATA_ALIGNMENT;
+	return BITSET_PAGE_DATA_SIZE + BITSET_PAGE_DATA_ALIGNMENT;
 }
 
 #undef MALLOC_ALIGNMENT
 
+/**
+ * Align a memory block allocated for bitmap data.
+ */
 inline void *
-bitset_page_data(struct bitset_page *page)
+bitset_page_data_align(void *data)
 {
-	uintptr_t r = (uintptr_t) (page->data + BITSET_PAGE_DATA_ALIGNMENT - 1);
+	uintptr_t r = (uintptr_t) ((char *) data +
+				   BITSET_PAGE_DATA_ALIGNMENT - 1);
 	return (void *) (r & ~((uintptr_t) BITSET_PAGE_DATA_ALIGNMENT - 1));
 }
 
-inline void
-bitset_page_create(struct bitset_page *page)
+/**
+ * Aligned data of a bitmap page.
+ */
+inline void *
+bitset_page_data(const struct bitset_page *page)
 {
-	size_t size = ((char *) bitset_page_data(page) - (char *) page)
-			+ BITSET_PAGE_DATA_SIZE;
-	memset(page, 0, size);
+	assert(page->type == BITSET_PAGE_BITMAP);
+	return bitset_page_data_align(page->data);
 }
 
-inline void
-bitset_page_destroy(struct bitset_page *page)
+inline size_t
+bitset_page_first_pos(size_t pos) {
+	return pos - (pos % BITSET_PAGE_BIT);
+}
+
+/**
+ * Return the index of the first value >= @a pos in an array page.
+ */
+inline uint32_t
+bitset_page_array_find(const struct bitset_page *page, size_t pos)
 {
-	(void) page;
-	/* nothing */
+	assert(page->type == BITSET_PAGE_ARRAY);
+	const uint16_t *values = (const uint16_t *) page->data;
+	uint32_t begin = 0, end = page->size;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (values[mid] < pos)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
 }
 
-inline size_t
-bitset_page_first_pos(size_t pos) {
-	return pos - (pos % (BITSET_PAGE_DATA_SIZE * CHAR_BIT));
+/**
+ * Return the index of the first run that starts after @a pos
+ * in a run page.
+ */
+inline uint32_t
+bitset_page_run_find(const struct bitset_page *page, size_t pos)
+{
+	assert(page->type == BITSET_PAGE_RUN);
+	const struct bitset_page_run *runs =
+		(const struct bitset_page_run *) page->data;
+	uint32_t begin = 0, end = page->size;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (runs[mid].first <= pos)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
+}
+
+/**
+ * Test bit @a pos (relative to the page start) in @a page.
+ */
+inline bool
+bitset_page_test(const struct bitset_page *page, size_t pos)
+{
+	assert(pos < BITSET_PAGE_BIT);
+	switch (page->type) {
+	case BITSET_PAGE_BITMAP:
+		return bit_test(bitset_page_data(page), pos);
+	case BITSET_PAGE_ARRAY: {
+		uint32_t i = bitset_page_array_find(page, pos);
+		return i < page->size && ((uint16_t *) page->data)[i] == pos;
+	}
+	case BITSET_PAGE_RUN: {
+		uint32_t i = bitset_page_run_find(page, pos);
+		return i > 0 &&
+		       ((struct bitset_page_run *) page->data)[i - 1].last >= pos;
+	}
+	default:
+		assert(false);
+		return false;
+	}
 }
 
+/**
+ * Allocate a new empty page of the given type.
+ * Return NULL on memory allocation error.
+ */
+struct bitset_page *
+bitset_page_new(enum bitset_page_type type,
+		void *(*realloc_arg)(void *ptr, size_t size));
+
+/**
+ * Free a page allocated with bitset_page_new().
+ */
+void
+bitset_page_delete(struct bitset_page *page,
+		   void *(*realloc_arg)(void *ptr, size_t size));
+
+/**
+ * Return the amount of memory used by @a page.
+ */
+size_t
+bitset_page_mem_size(const struct bitset_page *page,
+		     void *(*realloc_arg)(void *ptr, size_t size));
+
+/**
+ * Set bit @a pos (relative to the page start) in @a page.
+ * The page may change its type to store the data more compactly.
+ * @retval 1 if the bit was already set
+ * @retval 0 if the bit was not set
+ * @retval -1 on memory error, the page is left intact
+ */
+int
+bitset_page_set(struct bitset_page *page, size_t pos,
+		void *(*realloc_arg)(void *ptr, size_t size));
+
+/**
+ * Clear bit @a pos (relative to the page start) in @a page.
+ * The page may change its type to store the data more compactly.
+ * @retval 1 if the bit was set
+ * @retval 0 if the bit was not set
+ * @retval -1 on memory error, the page is left intact
+ */
+int
+bitset_page_clear(struct bitset_page *page, size_t pos,
+		  void *(*realloc_arg)(void *ptr, size_t size));
+
+/**
+ * Return the number of set bits in a bitmap page, recalculating
+ * it from the data. Used on pages filled by bitset_page_and() and
+ * friends that do not maintain the page cardinality.
+ */
+size_t
+bitset_page_bitmap_count(const struct bitset_page *page);
+
 inline void
 bitset_page_set_zeros(struct bitset_page *page)
 {
@@ -147,8 +279,14 @@ bitset_page_set_ones(struct bitset_page *page)
 	memset(data, -1, BITSET_PAGE_DATA_SIZE);
 }
 
+/*
+ * Bulk operations on pages. The destination is always a bitmap
+ * page while the source can be of any type. Two bitmaps are
+ * processed a vector word at a time.
+ */
+
 inline void
-bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
+bitset_page_bitmap_and(struct bitset_page *dst, const struct bitset_page *src)
 {
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
@@ -161,7 +299,7 @@ bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 }
 
 inline void
-bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
+bitset_page_bitmap_nand(struct bitset_page *dst, const struct bitset_page *src)
 {
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
@@ -174,7 +312,7 @@ bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 }
 
 inline void
-bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
+bitset_page_bitmap_or(struct bitset_page *dst, const struct bitset_page *src)
 {
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
@@ -186,6 +324,18 @@ bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
 	}
 }
 
+/** dst = dst AND src */
+void
+bitset_page_and(struct bitset_page *dst, const struct bitset_page *src);
+
+/** dst = dst AND NOT src */
+void
+bitset_page_nand(struct bitset_page *dst, const struct bitset_page *src);
+
+/** dst = dst OR src */
+void
+bitset_page_or(struct bitset_page *dst, const struct bitset_page *src);
+
 #if defined(DEBUG)
 void
 bitset_page_dump(struct bitset_page *page, FILE *stream);
@@ -141,6 +141,7 @@
  * int bps_tree_insert_get_iterator(tree, new_elem, replaced_elem,
  * 				    inserted_iterator)
  * int bps_tree_delete(tree, elem);
+ * int bps_tree_delete_get(tree, elem, deleted_elem);
  * size_t bps_tree_size(tree);
  * size_t bps_tree_mem_used(tree);
  * bps_tree_elem_t *bps_tree_random(tree, rnd);
@@ -163,6 +164,13 @@
  * bool bps_tree_iterator_prev(tree, itr);
  * void bps_tree_iterator_freeze(tree, itr);
  * void bps_tree_iterator_destroy(tree, itr);
+ * // order statistics (only if BPS_INNER_CARD is defined):
+ * void bps_tree_enable_card(tree);
+ * struct bps_tree_iterator bps_tree_lower_bound_get_offset(tree, key, exact,
+ *							   offset);
+ * struct bps_tree_iterator bps_tree_upper_bound_get_offset(tree, key, exact,
+ *							   offset);
+ * struct bps_tree_iterator bps_tree_iterator_at(tree, offset);
  */
 /* }}} */
 
@@ -274,6 +282,18 @@
 #error "BPS_TREE_COMPARE_KEY must be defined"
 #endif
 
+/**
+ * Function to check that two elements are the same, used only
+ * by debug self-checks. Must be defined if elements can't be
+ * compared with ==, e.g. if they are structures.
+ * Example:
+ * #define BPS_TREE_IS_IDENTICAL(a, b) ((a).id == (b).id)
+ */
+#ifndef BPS_TREE_IS_IDENTICAL
+#define BPS_TREE_IS_IDENTICAL(a, b) ((a) == (b))
+#define BPS_TREE_IS_IDENTICAL_DEFAULT
+#endif
+
 /**
  * A switch to define the type of search in an array elements.
  * By default, bps_tree uses binary search to find a particular
@@ -283,6 +303,18 @@
  * #define BPS_BLOCK_LINEAR_SEARCH
  */
 
+/**
+ * A switch that enables order statistics. If it is defined, every
+ * inner block stores the number of elements in the subtree of each
+ * child, so that the tree can find the offset of an element and an
+ * element by offset in logarithmic time. Counters are maintained
+ * only after bps_tree_enable_card() is called for a tree instance.
+ * Note that the counters reduce the fanout of inner blocks.
+ * A tree with counters enabled can't hold more than UINT32_MAX
+ * elements. To turn it on,
+ * #define BPS_INNER_CARD
+ */
+
 /**
  * A switch that enables collection of executions of different
  * branches of code. Used only for debug purposes, I hope you
@@ -295,6 +327,7 @@
 /* {{{ BPS-tree internal settings */
 typedef int16_t bps_tree_pos_t;
 typedef uint32_t bps_tree_block_id_t;
+typedef uint32_t bps_tree_card_t;
 /* }}} */
 
 /* {{{ Compile time utils */
@@ -352,6 +385,7 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_insert _api_name(insert)
 #define bps_tree_insert_get_iterator _api_name(insert_get_iterator)
 #define bps_tree_delete _api_name(delete)
+#define bps_tree_delete_get _api_name(delete_get)
 #define bps_tree_size _api_name(size)
 #define bps_tree_mem_used _api_name(mem_used)
 #define bps_tree_random _api_name(random)
@@ -374,6 +408,10 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_print _api_name(print)
 #define bps_tree_debug_check_internal_functions \
 	_api_name(debug_check_internal_functions)
+#define bps_tree_enable_card _api_name(enable_card)
+#define bps_tree_lower_bound_get_offset _api_name(lower_bound_get_offset)
+#define bps_tree_upper_bound_get_offset _api_name(upper_bound_get_offset)
+#define bps_tree_iterator_at _api_name(iterator_at)
 
 #define bps_tree_max_sizes _bps_tree(max_sizes)
 #define BPS_TREE_MAX_COUNT_IN_LEAF _BPS_TREE(MAX_COUNT_IN_LEAF)
@@ -405,6 +443,13 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_touch_leaf_path_max_elem _bps_tree(touch_leaf_path_max_elem)
 #define bps_tree_touch_path _bps_tree(touch_path_max_elem)
 #define bps_tree_process_replace _bps_tree(process_replace)
+#define bps_tree_block_card _bps_tree(block_card)
+#define bps_tree_card_set _bps_tree(card_set)
+#define bps_tree_card_refresh _bps_tree(card_refresh)
+#define bps_tree_card_update _bps_tree(card_update)
+#define bps_tree_card_fixup _bps_tree(card_fixup)
+#define bps_tree_card_build _bps_tree(card_build)
+#define bps_tree_inner_card_prefix _bps_tree(inner_card_prefix)
 #define bps_tree_debug_memmove _bps_tree(debug_memmove)
 #define bps_tree_insert_into_leaf _bps_tree(insert_into_leaf)
 #define bps_tree_insert_into_inner _bps_tree(insert_into_inner)
@@ -510,6 +555,10 @@ struct bps_tree {
 	bps_tree_elem_t max_elem;
 	/* Special allocator of blocks and their IDs */
 	struct matras matras;
+#ifdef BPS_INNER_CARD
+	/* True if inner blocks count elements in child subtrees */
+	bool card_enabled;
+#endif
 #ifdef BPS_TREE_DEBUG_BRANCH_VISIT
 	/* Bit masks of different branches visits */
 	uint32_t debug_insert_leaf_branches_mask;
@@ -634,6 +683,19 @@ bps_tree_insert_get_iterator(struct bps_tree *tree, bps_tree_elem_t new_elem,
 static inline int
 bps_tree_delete(struct bps_tree *tree, bps_tree_elem_t elem);
 
+/**
+ * @brief Delete an element from a tree and return a copy of the
+ *  element that was stored in the tree. Useful when elements that
+ *  compare equal may differ, e.g. carry a payload.
+ * @param tree - pointer to a tree
+ * @param elem - the element to delete
+ * @param deleted_elem - the deleted element is stored here
+ * @return - 0 on success or -1 if the element was not found in tree
+ */
+static inline int
+bps_tree_delete_get(struct bps_tree *tree, bps_tree_elem_t elem,
+		    bps_tree_elem_t *deleted_elem);
+
 /**
  * @brief Get size of tree, i.e. count of elements in tree
  * @param tree - pointer to a tree
@@ -834,6 +896,51 @@ bps_tree_iterator_freeze(struct bps_tree *tree, struct bps_tree_iterator *itr);
 static inline void
 bps_tree_iterator_destroy(struct bps_tree *tree, struct bps_tree_iterator *itr);
 
+#ifdef BPS_INNER_CARD
+
+/**
+ * @brief Make the tree count elements in subtrees of inner blocks.
+ *  If the tree is not empty, the counters are calculated from scratch,
+ *  so it's cheaper to call the function right after creation.
+ * @param tree - pointer to a tree
+ */
+static inline void
+bps_tree_enable_card(struct bps_tree *tree);
+
+/**
+ * @sa bps_tree_lower_bound + new parameter:
+ * @param[out] offset - number of elements that are less than the key,
+ *  i.e. position of the returned iterator in the tree. Equals to the
+ *  size of the tree if the returned iterator is invalid.
+ */
+static inline struct bps_tree_iterator
+bps_tree_lower_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset);
+
+/**
+ * @sa bps_tree_upper_bound + new parameter:
+ * @param[out] offset - number of elements that are less than or equal
+ *  to the key, i.e. position of the returned iterator in the tree.
+ *  Equals to the size of the tree if the returned iterator is invalid.
+ */
+static inline struct bps_tree_iterator
+bps_tree_upper_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset);
+
+/**
+ * @brief Get an iterator to the element at the given position
+ *  in ascending order.
+ * @param tree - pointer to a tree
+ * @param offset - number of elements preceding the element
+ * @return - Iterator. Invalid if offset >= size of the tree.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset);
+
+#endif /* BPS_INNER_CARD */
+
 #ifndef BPS_TREE_NO_DEBUG
 
 /**
@@ -884,6 +991,18 @@ bps_tree_debug_check_internal_functions(bool assertme);
 /* Same as BPS_TREE_MEMMOVE but takes count of values instead of memory size */
 #define BPS_TREE_DATAMOVE(dst, src, num, dst_bck, src_bck) \
 	BPS_TREE_MEMMOVE(dst, src, (num) * sizeof((dst)[0]), dst_bck, src_bck)
+#ifdef BPS_INNER_CARD
+/* Size of a subtree counter stored in an inner block per child */
+#define BPS_TREE_CARD_SIZE sizeof(bps_tree_card_t)
+/* Move subtree counters along with child IDs of inner blocks */
+#define BPS_TREE_CARDMOVE(dst, dst_pos, src, src_pos, num) \
+	memmove((dst)->child_cards + (dst_pos), \
+		(src)->child_cards + (src_pos), \
+		(num) * sizeof(bps_tree_card_t))
+#else
+#define BPS_TREE_CARD_SIZE 0
+#define BPS_TREE_CARDMOVE(dst, dst_pos, src, src_pos, num) ((void)0)
+#endif
 
 /**
  * Types of a block
@@ -914,7 +1033,8 @@ enum bps_tree_max_sizes {
 		/ sizeof(bps_tree_elem_t),
 	BPS_TREE_MAX_COUNT_IN_INNER =
 		(BPS_TREE_BLOCK_SIZE - sizeof(struct bps_block))
-		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)),
+		/ (sizeof(bps_tree_elem_t) + sizeof(bps_tree_block_id_t)
+		   + BPS_TREE_CARD_SIZE),
 	BPS_TREE_MAX_DEPTH = 16
 };
 
@@ -960,6 +1080,10 @@ struct bps_inner {
 	bps_tree_elem_t elems[BPS_TREE_MAX_COUNT_IN_INNER - 1];
 	/* Corresponding child IDs */
 	bps_tree_block_id_t child_ids[BPS_TREE_MAX_COUNT_IN_INNER];
+#ifdef BPS_INNER_CARD
+	/* Numbers of elements in the corresponding child subtrees */
+	bps_tree_card_t child_cards[BPS_TREE_MAX_COUNT_IN_INNER];
+#endif
 };
 
 /**
@@ -1062,6 +1186,9 @@ bps_tree_create(struct bps_tree *tree, bps_tree_arg_t arg,
 	tree->garbage_head_id = (bps_tree_block_id_t)(-1);
 	tree->arg = arg;
 	memset(&tree->max_elem, 0, sizeof(tree->max_elem));
+#ifdef BPS_INNER_CARD
+	tree->card_enabled = false;
+#endif
 
 	matras_create(&tree->matras,
 		      BPS_TREE_EXTENT_SIZE, BPS_TREE_BLOCK_SIZE,
@@ -1081,6 +1208,14 @@ bps_tree_create(struct bps_tree *tree, bps_tree_arg_t arg,
 #endif
 }
 
+#ifdef BPS_INNER_CARD
+/**
+ * bps_tree_card_build declaration. See definition for details.
+ */
+static inline size_t
+bps_tree_card_build(struct bps_tree *tree, bps_tree_block_id_t id);
+#endif
+
 /**
  * @brief Fills a new (asserted) tree with values from sorted array.
  *  Elements are copied from the array. Array is not checked to be sorted!
@@ -1099,6 +1234,10 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 	assert(tree->matras.head.block_count == 0);
 	if (array_size == 0)
 		return 0;
+#ifdef BPS_INNER_CARD
+	if (tree->card_enabled && array_size > UINT32_MAX)
+		return -1;
+#endif
 	bps_tree_block_id_t leaf_count = (array_size +
 		BPS_TREE_MAX_COUNT_IN_LEAF - 1) / BPS_TREE_MAX_COUNT_IN_LEAF;
 
@@ -1220,6 +1359,10 @@ bps_tree_build(struct bps_tree *tree, bps_tree_elem_t *sorted_array,
 	} else {
 		tree->root_id = root_if_inner_id;
 	}
+#ifdef BPS_INNER_CARD
+	if (tree->card_enabled)
+		bps_tree_card_build(tree, tree->root_id);
+#endif
 	return 0;
 }
 
@@ -1948,6 +2091,187 @@ bps_tree_approximate_count(const struct bps_tree *tree, bps_tree_key_t key)
 	return result;
 }
 
+#ifdef BPS_INNER_CARD
+
+/**
+ * @brief Make the tree count elements in subtrees of inner blocks.
+ *  If the tree is not empty, the counters are calculated from scratch,
+ *  so it's cheaper to call the function right after creation.
+ * @param tree - pointer to a tree
+ */
+static inline void
+bps_tree_enable_card(struct bps_tree *tree)
+{
+	assert(tree->size <= UINT32_MAX);
+	if (tree->card_enabled)
+		return;
+	tree->card_enabled = true;
+	if (tree->root_id != (bps_tree_block_id_t)(-1))
+		bps_tree_card_build(tree, tree->root_id);
+}
+
+/**
+ * @brief Get the number of elements in the subtrees of the first
+ *  children of an inner block.
+ */
+static inline size_t
+bps_tree_inner_card_prefix(struct bps_inner *inner, bps_tree_pos_t count)
+{
+	size_t card = 0;
+	for (bps_tree_pos_t i = 0; i < count; i++)
+		card += inner->child_cards[i];
+	return card;
+}
+
+/**
+ * @sa bps_tree_lower_bound + new parameter:
+ * @param[out] offset - number of elements that are less than the key,
+ *  i.e. position of the returned iterator in the tree. Equals to the
+ *  size of the tree if the returned iterator is invalid.
+ */
+static inline struct bps_tree_iterator
+bps_tree_lower_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset)
+{
+	assert(tree->card_enabled);
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	*offset = 0;
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_ins_point_key(tree, inner->elems,
+						  inner->header.size - 1,
+						  key, exact);
+		*offset += bps_tree_inner_card_prefix(inner, pos);
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_ins_point_key(tree, leaf->elems, leaf->header.size,
+					  key, exact);
+	*offset += pos;
+	if (pos >= leaf->header.size) {
+		res.block_id = leaf->next_id;
+		res.pos = 0;
+	} else {
+		res.block_id = block_id;
+		res.pos = pos;
+	}
+	return res;
+}
+
+/**
+ * @sa bps_tree_upper_bound + new parameter:
+ * @param[out] offset - number of elements that are less than or equal
+ *  to the key, i.e. position of the returned iterator in the tree.
+ *  Equals to the size of the tree if the returned iterator is invalid.
+ */
+static inline struct bps_tree_iterator
+bps_tree_upper_bound_get_offset(const struct bps_tree *tree,
+				bps_tree_key_t key, bool *exact,
+				size_t *offset)
+{
+	assert(tree->card_enabled);
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	bool local_result;
+	if (!exact)
+		exact = &local_result;
+	*exact = false;
+	*offset = 0;
+	bool exact_test;
+	if (tree->root_id == (bps_tree_block_id_t)(-1)) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos;
+		pos = bps_tree_find_after_ins_point_key(tree, inner->elems,
+							inner->header.size - 1,
+							key, &exact_test);
+		if (exact_test)
+			*exact = true;
+		*offset += bps_tree_inner_card_prefix(inner, pos);
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+
+	struct bps_leaf *leaf = (struct bps_leaf *)block;
+	bps_tree_pos_t pos;
+	pos = bps_tree_find_after_ins_point_key(tree, leaf->elems,
+						leaf->header.size,
+						key, &exact_test);
+	if (exact_test)
+		*exact = true;
+	*offset += pos;
+	if (pos >= leaf->header.size) {
+		res.block_id = leaf->next_id;
+		res.pos = 0;
+	} else {
+		res.block_id = block_id;
+		res.pos = pos;
+	}
+	return res;
+}
+
+/**
+ * @brief Get an iterator to the element at the given position
+ *  in ascending order.
+ * @param tree - pointer to a tree
+ * @param offset - number of elements preceding the element
+ * @return - Iterator. Invalid if offset >= size of the tree.
+ */
+static inline struct bps_tree_iterator
+bps_tree_iterator_at(const struct bps_tree *tree, size_t offset)
+{
+	assert(tree->card_enabled);
+	struct bps_tree_iterator res;
+	matras_head_read_view(&res.view);
+	if (offset >= tree->size) {
+		res.block_id = (bps_tree_block_id_t)(-1);
+		res.pos = 0;
+		return res;
+	}
+	struct bps_block *block = bps_tree_root(tree);
+	bps_tree_block_id_t block_id = tree->root_id;
+	for (bps_tree_block_id_t i = 0; i < tree->depth - 1; i++) {
+		struct bps_inner *inner = (struct bps_inner *)block;
+		bps_tree_pos_t pos = 0;
+		while (offset >= inner->child_cards[pos]) {
+			offset -= inner->child_cards[pos];
+			pos++;
+			assert(pos < inner->header.size);
+		}
+		block_id = inner->child_ids[pos];
+		block = bps_tree_restore_block(tree, block_id);
+	}
+	assert(offset < (size_t)block->size);
+	res.block_id = block_id;
+	res.pos = (bps_tree_pos_t)offset;
+	return res;
+}
+
+#endif /* BPS_INNER_CARD */
+
 /**
  * @brief Get a pointer to the element pointed by iterator.
  *  If iterator is detected as broken, it is invalidated and NULL returned.
@@ -2350,6 +2674,148 @@ bps_tree_process_replace(struct bps_tree *tree,
 	return true;
 }
 
+#ifdef BPS_INNER_CARD
+
+/**
+ * @brief Get the number of elements in the subtree of a block.
+ *  Takes the counters of an inner block for granted.
+ */
+static inline size_t
+bps_tree_block_card(const struct bps_tree *tree, bps_tree_block_id_t id)
+{
+	struct bps_block *block = bps_tree_restore_block(tree, id);
+	if (block->type == BPS_TREE_BT_LEAF)
+		return block->size;
+	assert(block->type == BPS_TREE_BT_INNER);
+	struct bps_inner *inner = (struct bps_inner *)block;
+	size_t card = 0;
+	for (bps_tree_pos_t i = 0; i < block->size; i++)
+		card += inner->child_cards[i];
+	return card;
+}
+
+/**
+ * @brief Set the counter of a child just inserted into an inner block.
+ */
+static inline void
+bps_tree_card_set(struct bps_tree *tree, struct bps_inner *inner,
+		  bps_tree_pos_t pos, bps_tree_block_id_t block_id)
+{
+	if (tree->card_enabled)
+		inner->child_cards[pos] = bps_tree_block_card(tree, block_id);
+}
+
+/**
+ * @brief Recalculate counters of the children of an inner block
+ *  around the given position. Rebalancing of the B*-tree moves data
+ *  only between a block and (at most) two siblings on each side, so
+ *  that's enough to fix the block after the children were changed.
+ *  The block must be touched.
+ */
+static inline void
+bps_tree_card_refresh(struct bps_tree *tree, struct bps_inner *inner,
+		      bps_tree_pos_t pos)
+{
+	if (!tree->card_enabled)
+		return;
+	bps_tree_pos_t begin = pos > 2 ? pos - 2 : 0;
+	bps_tree_pos_t end = pos + 3 < inner->header.size ?
+			     pos + 3 : inner->header.size;
+	for (bps_tree_pos_t i = begin; i < end; i++)
+		inner->child_cards[i] =
+			bps_tree_block_card(tree, inner->child_ids[i]);
+}
+
+/**
+ * @brief Add delta to the counters of a child at the given position
+ *  and of all its ancestors up to the root.
+ */
+static inline void
+bps_tree_card_update(struct bps_tree *tree,
+		     struct bps_inner_path_elem *path_elem,
+		     bps_tree_pos_t pos, int delta)
+{
+	if (!tree->card_enabled)
+		return;
+	for (; path_elem != NULL; path_elem = path_elem->parent) {
+		path_elem->block = (struct bps_inner *)
+			bps_tree_touch_block(tree, path_elem->block_id);
+		path_elem->block->child_cards[pos] += delta;
+		pos = path_elem->pos_in_parent;
+	}
+}
+
+/**
+ * @brief Fix counters after a modification of children of a path
+ *  element that changed the number of elements in its subtree by
+ *  delta without changing the set of its siblings.
+ */
+static inline void
+bps_tree_card_fixup(struct bps_tree *tree,
+		    struct bps_inner_path_elem *path_elem,
+		    bps_tree_pos_t pos, int delta)
+{
+	if (!tree->card_enabled || path_elem == NULL)
+		return;
+	bps_tree_card_refresh(tree, path_elem->block, pos);
+	bps_tree_card_update(tree, path_elem->parent,
+			     path_elem->pos_in_parent, delta);
+}
+
+/**
+ * @brief Recursively calculate all counters of a subtree.
+ * @return - the number of elements in the subtree.
+ */
+static inline size_t
+bps_tree_card_build(struct bps_tree *tree, bps_tree_block_id_t id)
+{
+	struct bps_block *block = bps_tree_touch_block(tree, id);
+	if (block->type == BPS_TREE_BT_LEAF)
+		return block->size;
+	struct bps_inner *inner = (struct bps_inner *)block;
+	size_t card = 0;
+	for (bps_tree_pos_t i = 0; i < block->size; i++) {
+		inner->child_cards[i] =
+			bps_tree_card_build(tree, inner->child_ids[i]);
+		card += inner->child_cards[i];
+	}
+	return card;
+}
+
+#else /* BPS_INNER_CARD */
+
+static inline void
+bps_tree_card_set(struct bps_tree *tree, struct bps_inner *inner,
+		  bps_tree_pos_t pos, bps_tree_block_id_t block_id)
+{
+	(void)tree; (void)inner; (void)pos; (void)block_id;
+}
+
+static inline void
+bps_tree_card_refresh(struct bps_tree *tree, struct bps_inner *inner,
+		      bps_tree_pos_t pos)
+{
+	(void)tree; (void)inner; (void)pos;
+}
+
+static inline void
+bps_tree_card_update(struct bps_tree *tree,
+		     struct bps_inner_path_elem *path_elem,
+		     bps_tree_pos_t pos, int delta)
+{
+	(void)tree; (void)path_elem; (void)pos; (void)delta;
+}
+
+static inline void
+bps_tree_card_fixup(struct bps_tree *tree,
+		    struct bps_inner_path_elem *path_elem,
+		    bps_tree_pos_t pos, int delta)
+{
+	(void)tree; (void)path_elem; (void)pos; (void)delta;
+}
+
+#endif /* BPS_INNER_CARD */
+
 #ifndef NDEBUG
 /**
  * @brief Debug memmove, checks for overflow
@@ -2504,12 +2970,15 @@ bps_tree_insert_into_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos + 1,
 				  inner->child_ids + pos,
 				  inner->header.size - pos, inner, inner);
+		BPS_TREE_CARDMOVE(inner, pos + 1, inner, pos,
+				  inner->header.size - pos);
 	} else {
 		if (pos > 0)
 			inner->elems[pos - 1] = *inner_path_elem->max_elem_copy;
 		*inner_path_elem->max_elem_copy = max_elem;
 	}
 	inner->child_ids[pos] = block_id;
+	bps_tree_card_set(tree, inner, pos, block_id);
 
 	inner->header.size++;
 }
@@ -2568,6 +3037,8 @@ bps_tree_delete_from_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(inner->child_ids + pos,
 				  inner->child_ids + pos + 1,
 				  inner->header.size - 1 - pos, inner, inner);
+		BPS_TREE_CARDMOVE(inner, pos, inner, pos + 1,
+				  inner->header.size - 1 - pos);
 	} else if (pos > 0) {
 		*inner_path_elem->max_elem_copy = inner->elems[pos - 1];
 	}
@@ -2639,8 +3110,10 @@ bps_tree_move_elems_to_right_inner(struct bps_tree *tree,
 
 	BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
 			  b->header.size, b, b);
+	BPS_TREE_CARDMOVE(b, num, b, 0, b->header.size);
 	BPS_TREE_DATAMOVE(b->child_ids, a->child_ids + a->header.size - num,
 			  num, b, a);
+	BPS_TREE_CARDMOVE(b, 0, a, a->header.size - num, num);
 
 	if (!move_to_empty)
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
@@ -2719,8 +3192,10 @@ bps_tree_move_elems_to_left_inner(struct bps_tree *tree,
 
 	BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
 			  num, a, b);
+	BPS_TREE_CARDMOVE(a, a->header.size, b, 0, num);
 	BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
 			  b->header.size - num, b, b);
+	BPS_TREE_CARDMOVE(b, 0, b, num, b->header.size - num);
 
 	if (!move_to_empty)
 		a->elems[a->header.size - 1] =
@@ -2843,6 +3318,7 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 	if (!move_to_empty) {
 		BPS_TREE_DATAMOVE(b->child_ids + num, b->child_ids,
 				  b->header.size, b, b);
+		BPS_TREE_CARDMOVE(b, num, b, 0, b->header.size);
 		BPS_TREE_DATAMOVE(b->elems + num, b->elems,
 				  b->header.size - 1, b, b);
 	}
@@ -2853,9 +3329,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num,
 				  num, b, a);
+		BPS_TREE_CARDMOVE(b, 0, a, a->header.size - num, num);
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
+		BPS_TREE_CARDMOVE(a, pos + 1, a, pos, mid_part_size - num);
 		a->child_ids[pos] = block_id;
+		bps_tree_card_set(tree, a, pos, block_id);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2875,9 +3354,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num,
 				  num, b, a);
+		BPS_TREE_CARDMOVE(b, 0, a, a->header.size - num, num);
 		BPS_TREE_DATAMOVE(a->child_ids + pos + 1, a->child_ids + pos,
 				  mid_part_size - num, a, a);
+		BPS_TREE_CARDMOVE(a, pos + 1, a, pos, mid_part_size - num);
 		a->child_ids[pos] = block_id;
+		bps_tree_card_set(tree, a, pos, block_id);
 
 		BPS_TREE_DATAMOVE(b->elems, a->elems + a->header.size - num,
 				  num - 1, b, a);
@@ -2894,9 +3376,12 @@ bps_tree_insert_and_move_elems_to_right_inner(struct bps_tree *tree,
 		BPS_TREE_DATAMOVE(b->child_ids,
 				  a->child_ids + a->header.size - num + 1,
 				  new_pos, b, a);
+		BPS_TREE_CARDMOVE(b, 0, a, a->header.size - num + 1, new_pos);
 		b->child_ids[new_pos] = block_id;
+		bps_tree_card_set(tree, b, new_pos, block_id);
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  a->child_ids + pos, mid_part_size, b, a);
+		BPS_TREE_CARDMOVE(b, new_pos + 1, a, pos, mid_part_size);
 
 		if (pos == a->header.size) {
 			/* +1 */
@@ -3048,12 +3533,16 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		bps_tree_pos_t new_pos = pos - num; /* Can be 0 */
 		BPS_TREE_DATAMOVE(a->child_ids + a->header.size, b->child_ids,
 				  num, a, b);
+		BPS_TREE_CARDMOVE(a, a->header.size, b, 0, num);
 		BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num,
 				  new_pos, b, b);
+		BPS_TREE_CARDMOVE(b, 0, b, num, new_pos);
 		b->child_ids[new_pos] = block_id;
+		bps_tree_card_set(tree, b, new_pos, block_id);
 		BPS_TREE_DATAMOVE(b->child_ids + new_pos + 1,
 				  b->child_ids + pos,
 				  b->header.size - pos, b, b);
+		BPS_TREE_CARDMOVE(b, new_pos + 1, b, pos, b->header.size - pos);
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -3089,12 +3578,18 @@ bps_tree_insert_and_move_elems_to_left_inner(struct bps_tree *tree,
 		bps_tree_pos_t new_pos = a->header.size + pos; /* Can be 0 */
 		BPS_TREE_DATAMOVE(a->child_ids + a->header.size,
 				  b->child_ids, pos, a, b);
+		BPS_TREE_CARDMOVE(a, a->header.size, b, 0, pos);
 		a->child_ids[new_pos] = block_id;
+		bps_tree_card_set(tree, a, new_pos, block_id);
 		BPS_TREE_DATAMOVE(a->child_ids + new_pos + 1,
 				  b->child_ids + pos, num - 1 - pos, a, b);
-		if (!move_all)
+		BPS_TREE_CARDMOVE(a, new_pos + 1, b, pos, num - 1 - pos);
+		if (!move_all) {
 			BPS_TREE_DATAMOVE(b->child_ids, b->child_ids + num - 1,
 					  b->header.size - num + 1, b, b);
+			BPS_TREE_CARDMOVE(b, 0, b, num - 1,
+					  b->header.size - num + 1);
+		}
 
 		if (!move_to_empty)
 			a->elems[a->header.size - 1] =
@@ -3345,8 +3840,14 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 			     bps_tree_block_id_t *inserted_in_block,
 			     bps_tree_pos_t *inserted_in_pos)
 {
+#ifdef BPS_INNER_CARD
+	if (tree->card_enabled && tree->size >= UINT32_MAX)
+		return -1;
+#endif
 	if (bps_tree_leaf_free_size(leaf_path_elem->block)) {
 		bps_tree_insert_into_leaf(tree, leaf_path_elem, new_elem);
+		bps_tree_card_update(tree, leaf_path_elem->parent,
+				     leaf_path_elem->pos_in_parent, 1);
 		BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x0);
 		*inserted_in_block = leaf_path_elem->block_id;
 		*inserted_in_pos = leaf_path_elem->insertion_point;
@@ -3376,6 +3877,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 				bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x1);
 			*inserted_in_block = inserted_ext->block_id;
 			*inserted_in_pos = inserted_ext->insertion_point;
@@ -3387,6 +3890,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 				bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x2);
 			*inserted_in_block = inserted_ext->block_id;
 			*inserted_in_pos = inserted_ext->insertion_point;
@@ -3400,6 +3905,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 				bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x3);
 			*inserted_in_block = inserted_ext->block_id;
 			*inserted_in_pos = inserted_ext->insertion_point;
@@ -3419,6 +3926,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 				bps_tree_insert_and_move_elems_to_left_leaf(tree,
 					&left_ext, leaf_path_elem,
 					move_count, new_elem);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x4);
 			*inserted_in_block = inserted_ext->block_id;
 			*inserted_in_pos = inserted_ext->insertion_point;
@@ -3432,6 +3941,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 				bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x5);
 			*inserted_in_block = inserted_ext->block_id;
 			*inserted_in_pos = inserted_ext->insertion_point;
@@ -3451,6 +3962,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 				bps_tree_insert_and_move_elems_to_right_leaf(tree,
 					leaf_path_elem, &right_ext,
 					move_count, new_elem);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0x6);
 			*inserted_in_block = inserted_ext->block_id;
 			*inserted_in_pos = inserted_ext->insertion_point;
@@ -3705,6 +4218,7 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
 		new_root->elems[0] = tree->max_elem;
+		bps_tree_card_refresh(tree, new_root, 0);
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
 		tree->depth++;
@@ -3717,6 +4231,8 @@ bps_tree_process_insert_leaf(struct bps_tree *tree,
 	*inserted_in_block = inserted_ext->block_id;
 	*inserted_in_pos = inserted_ext->insertion_point;
 	assert(leaf_path_elem->parent);
+	bps_tree_card_refresh(tree, leaf_path_elem->parent->block,
+			      leaf_path_elem->pos_in_parent);
 	BPS_TREE_BRANCH_TRACE(tree, insert_leaf, 1 << 0xD);
 	return bps_tree_process_insert_inner(tree, leaf_path_elem->parent,
 			new_block_id, new_path_elem.pos_in_parent,
@@ -3736,6 +4252,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 	if (bps_tree_inner_free_size(inner_path_elem->block)) {
 		bps_tree_insert_into_inner(tree, inner_path_elem,
 					   block_id, pos, max_elem);
+		bps_tree_card_update(tree, inner_path_elem->parent,
+				     inner_path_elem->pos_in_parent, 1);
 		BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x0);
 		return 0;
 	}
@@ -3759,6 +4277,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem, move_count,
 					block_id, pos, max_elem);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x1);
 			return 0;
 		} else if (bps_tree_inner_free_size(right_ext.block) > 0) {
@@ -3767,6 +4287,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count, block_id, pos, max_elem);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x2);
 			return 0;
 		}
@@ -3777,6 +4299,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem,
 					move_count, block_id, pos, max_elem);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x3);
 			return 0;
 		}
@@ -3793,6 +4317,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_left_inner(tree,
 					&left_ext, inner_path_elem, move_count,
 					block_id, pos, max_elem);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x4);
 			return 0;
 		}
@@ -3803,6 +4329,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count, block_id, pos, max_elem);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x5);
 			return 0;
 		}
@@ -3819,6 +4347,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 			bps_tree_insert_and_move_elems_to_right_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count, block_id, pos, max_elem);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, 1);
 			BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0x6);
 			return 0;
 		}
@@ -4025,6 +4555,7 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		new_root->child_ids[0] = tree->root_id;
 		new_root->child_ids[1] = new_block_id;
 		new_root->elems[0] = tree->max_elem;
+		bps_tree_card_refresh(tree, new_root, 0);
 		tree->root_id = new_root_id;
 		tree->max_elem = new_max_elem;
 		tree->depth++;
@@ -4032,6 +4563,8 @@ bps_tree_process_insert_inner(struct bps_tree *tree,
 		return 0;
 	}
 	assert(inner_path_elem->parent);
+	bps_tree_card_refresh(tree, inner_path_elem->parent->block,
+			      inner_path_elem->pos_in_parent);
 	BPS_TREE_BRANCH_TRACE(tree, insert_inner, 1 << 0xD);
 	return bps_tree_process_insert_inner(tree, inner_path_elem->parent,
 			new_block_id, new_path_elem.pos_in_parent,
@@ -4057,6 +4590,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 
 	if (leaf_path_elem->block->header.size >=
 	    BPS_TREE_MAX_COUNT_IN_LEAF * 2 / 3) {
+		bps_tree_card_update(tree, leaf_path_elem->parent,
+				     leaf_path_elem->pos_in_parent, -1);
 		BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x0);
 		return;
 	}
@@ -4082,6 +4617,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(left_ext.block) / 2;
 			bps_tree_move_elems_to_right_leaf(tree, &left_ext,
 					leaf_path_elem, move_count);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x1);
 			return;
 		} else if (bps_tree_leaf_overmin_size(right_ext.block) > 0) {
@@ -4089,6 +4626,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(right_ext.block) / 2;
 			bps_tree_move_elems_to_left_leaf(tree, leaf_path_elem,
 					&right_ext, move_count);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x2);
 			return;
 		}
@@ -4098,6 +4637,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				bps_tree_leaf_overmin_size(left_ext.block) / 2;
 			bps_tree_move_elems_to_right_leaf(tree, &left_ext,
 					leaf_path_elem, move_count);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x3);
 			return;
 		}
@@ -4113,6 +4654,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 					leaf_path_elem, move_count1);
 			bps_tree_move_elems_to_right_leaf(tree, &left_left_ext,
 					&left_ext, move_count2);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x4);
 			return;
 		}
@@ -4123,6 +4666,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_left_leaf(tree, leaf_path_elem,
 					&right_ext, move_count);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x5);
 			return;
 		}
@@ -4138,6 +4683,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 					&right_ext, move_count1);
 			bps_tree_move_elems_to_left_leaf(tree, &right_ext,
 					&right_right_ext, move_count2);
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x6);
 			return;
 		}
@@ -4173,6 +4720,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 	} else if (has_left_ext) {
 		if (leaf_path_elem->block->header.size +
 		    left_ext.block->header.size > BPS_TREE_MAX_COUNT_IN_LEAF) {
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xA);
 			return;
 		}
@@ -4183,6 +4732,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 	} else if (has_right_ext) {
 		if (leaf_path_elem->block->header.size +
 		    right_ext.block->header.size > BPS_TREE_MAX_COUNT_IN_LEAF) {
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xC);
 			return;
 		}
@@ -4192,6 +4743,8 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 		BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xD);
 	} else {
 		if (leaf_path_elem->block->header.size > 0) {
+			bps_tree_card_fixup(tree, leaf_path_elem->parent,
+					    leaf_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0xE);
 			return;
 		}
@@ -4226,9 +4779,11 @@ bps_tree_process_delete_leaf(struct bps_tree *tree,
 		next_block->prev_id = leaf->prev_id;
 	}
 
+	assert(leaf_path_elem->parent);
+	bps_tree_card_refresh(tree, leaf_path_elem->parent->block,
+			      leaf_path_elem->pos_in_parent);
 	bps_tree_dispose_leaf(tree, leaf_path_elem->block,
 			leaf_path_elem->block_id);
-	assert(leaf_path_elem->parent);
 	bps_tree_process_delete_inner(tree, leaf_path_elem->parent);
 	BPS_TREE_BRANCH_TRACE(tree, delete_leaf, 1 << 0x10);
 }
@@ -4245,6 +4800,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 
 	if (inner_path_elem->block->header.size >=
 	    BPS_TREE_MAX_COUNT_IN_INNER * 2 / 3) {
+		bps_tree_card_update(tree, inner_path_elem->parent,
+				     inner_path_elem->pos_in_parent, -1);
 		BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x0);
 		return;
 	}
@@ -4269,6 +4826,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_right_inner(tree, &left_ext,
 					inner_path_elem, move_count);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x1);
 			return;
 		} else if (bps_tree_inner_overmin_size(right_ext.block) > 0) {
@@ -4278,6 +4837,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 			bps_tree_move_elems_to_left_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x2);
 			return;
 		}
@@ -4288,6 +4849,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 				/ 2;
 			bps_tree_move_elems_to_right_inner(tree, &left_ext,
 					inner_path_elem, move_count);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x3);
 			return;
 		}
@@ -4304,6 +4867,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 					inner_path_elem, move_count1);
 			bps_tree_move_elems_to_right_inner(tree,
 					&left_left_ext, &left_ext, move_count2);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x4);
 			return;
 		}
@@ -4315,6 +4880,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 			bps_tree_move_elems_to_left_inner(tree,
 					inner_path_elem, &right_ext,
 					move_count);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x5);
 			return;
 		}
@@ -4331,6 +4898,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 					&right_ext, move_count1);
 			bps_tree_move_elems_to_left_inner(tree, &right_ext,
 					&right_right_ext, move_count2);
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x6);
 			return;
 		}
@@ -4366,6 +4935,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 	} else if (has_left_ext) {
 		if (inner_path_elem->block->header.size +
 		    left_ext.block->header.size > BPS_TREE_MAX_COUNT_IN_INNER) {
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xA);
 			//throw 1;
 			return;
@@ -4378,6 +4949,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 		if (inner_path_elem->block->header.size +
 		    right_ext.block->header.size >
 		    BPS_TREE_MAX_COUNT_IN_INNER) {
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xC);
 			//throw 2;
 			return;
@@ -4388,6 +4961,8 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 		BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xD);
 	} else {
 		if (inner_path_elem->block->header.size > 1) {
+			bps_tree_card_fixup(tree, inner_path_elem->parent,
+					    inner_path_elem->pos_in_parent, -1);
 			BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0xE);
 			return;
 		}
@@ -4402,9 +4977,11 @@ bps_tree_process_delete_inner(struct bps_tree *tree,
 	}
 	assert(inner_path_elem->block->header.size == 0);
 
+	assert(inner_path_elem->parent);
+	bps_tree_card_refresh(tree, inner_path_elem->parent->block,
+			      inner_path_elem->pos_in_parent);
 	bps_tree_dispose_inner(tree, inner_path_elem->block,
 			inner_path_elem->block_id);
-	assert(inner_path_elem->parent);
 	bps_tree_process_delete_inner(tree, inner_path_elem->parent);
 	BPS_TREE_BRANCH_TRACE(tree, delete_inner, 1 << 0x10);
 }
@@ -4508,6 +5085,34 @@ bps_tree_delete(struct bps_tree *tree, bps_tree_elem_t elem)
 	return 0;
 }
 
+/**
+ * @brief Delete an element from a tree and return a copy of the
+ *  element that was stored in the tree.
+ * @param tree - pointer to a tree
+ * @param elem - the element to delete
+ * @param deleted_elem - the deleted element is stored here
+ * @return - 0 on success or -1 if the element was not found in tree
+ */
+static inline int
+bps_tree_delete_get(struct bps_tree *tree, bps_tree_elem_t elem,
+		    bps_tree_elem_t *deleted_elem)
+{
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return -1;
+	struct bps_inner_path_elem path[BPS_TREE_MAX_DEPTH];
+	struct bps_leaf_path_elem leaf_path_elem;
+	bool exact;
+	bps_tree_collect_path(tree, elem, path, &leaf_path_elem, &exact);
+
+	if (!exact)
+		return -1;
+
+	*deleted_elem =
+		leaf_path_elem.block->elems[leaf_path_elem.insertion_point];
+	bps_tree_process_delete_leaf(tree, &leaf_path_elem);
+	return 0;
+}
+
 /**
  * @brief Recursively find a maximum element in subtree.
  * Used only for debug purposes
@@ -4592,7 +5197,8 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 						       inner->child_ids[i]);
 			bps_tree_elem_t calc_max_elem =
 				bps_tree_debug_find_max_elem(tree, tmp_block);
-			if (inner->elems[i] != calc_max_elem)
+			if (!BPS_TREE_IS_IDENTICAL(inner->elems[i],
+						   calc_max_elem))
 				result |= 0x4000;
 		}
 		if (block->size > 1) {
@@ -4619,13 +5225,21 @@ bps_tree_debug_check_block(const struct bps_tree *tree, struct bps_block *block,
 				result |= 0x4000000;
 		}
 
-		for (bps_tree_pos_t i = 0; i < block->size; i++)
+		for (bps_tree_pos_t i = 0; i < block->size; i++) {
+			size_t prev_count = *calc_count;
 			result |= bps_tree_debug_check_block(tree,
 				bps_tree_restore_block(tree,
 						       inner->child_ids[i]),
 				inner->child_ids[i], level - 1, calc_count,
 				expected_prev_id, expected_this_id,
 				check_fullness_next);
+#ifdef BPS_INNER_CARD
+			if (tree->card_enabled &&
+			    inner->child_cards[i] != *calc_count - prev_count)
+				result |= 0x8000000;
+#endif
+			(void)prev_count;
+		}
 		return result;
 	}
 }
@@ -4651,7 +5265,8 @@ bps_tree_debug_check(const struct bps_tree *tree)
 		return result;
 	}
 	struct bps_block *root = bps_tree_root(tree);
-	if (tree->max_elem != bps_tree_debug_find_max_elem(tree, root))
+	if (!BPS_TREE_IS_IDENTICAL(tree->max_elem,
+				   bps_tree_debug_find_max_elem(tree, root)))
 		result |= 0x8;
 	size_t calc_count = 0;
 	bps_tree_block_id_t expected_prev_id = (bps_tree_block_id_t)(-1);
@@ -5017,12 +5632,14 @@ bps_tree_debug_check_move_to_right_leaf(struct bps_tree *tree, bool assertme)
 				}
 
 				if (a.header.size)
-					if (ma != a.elems[a.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(ma,
+						a.elems[a.header.size - 1])) {
 						result |= (1 << 5);
 						assert(!assertme);
 					}
 				if (b.header.size)
-					if (mb != b.elems[b.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(mb,
+						b.elems[b.header.size - 1])) {
 						result |= (1 << 5);
 						assert(!assertme);
 					}
@@ -5114,12 +5731,14 @@ bps_tree_debug_check_move_to_left_leaf(struct bps_tree *tree, bool assertme)
 				}
 
 				if (a.header.size)
-					if (ma != a.elems[a.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(ma,
+						a.elems[a.header.size - 1])) {
 						result |= (1 << 7);
 						assert(!assertme);
 					}
 				if (b.header.size)
-					if (mb != b.elems[b.header.size - 1]) {
+					if (!BPS_TREE_IS_IDENTICAL(mb,
+						b.elems[b.header.size - 1])) {
 						result |= (1 << 7);
 						assert(!assertme);
 					}
@@ -5225,16 +5844,16 @@ bps_tree_debug_check_insert_and_move_to_right_leaf(struct bps_tree *tree,
 					}
 
 					if (i - u + 1)
-						if (ma
-							!= a.elems[a.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(ma,
+							a.elems[a.header.size
+								- 1])) {
 							result |= (1 << 9);
 							assert(!assertme);
 						}
 					if (j + u)
-						if (mb
-							!= b.elems[b.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(mb,
+							b.elems[b.header.size
+								- 1])) {
 							result |= (1 << 9);
 							assert(!assertme);
 						}
@@ -5341,16 +5960,16 @@ bps_tree_debug_check_insert_and_move_to_left_leaf(struct bps_tree *tree,
 					}
 
 					if (i + u)
-						if (ma
-							!= a.elems[a.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(ma,
+							a.elems[a.header.size
+								- 1])) {
 							result |= (1 << 11);
 							assert(!assertme);
 						}
 					if (j - u + 1)
-						if (mb
-							!= b.elems[b.header.size
-								- 1]) {
+						if (!BPS_TREE_IS_IDENTICAL(mb,
+							b.elems[b.header.size
+								- 1])) {
 							result |= (1 << 11);
 							assert(!assertme);
 						}
@@ -5976,6 +6595,9 @@ bps_tree_debug_check_internal_functions(bool assertme)
 
 	struct bps_tree tree;
 	tree.root_id = (bps_tree_block_id_t) -1;
+#ifdef BPS_INNER_CARD
+	tree.card_enabled = false;
+#endif
 
 	result |= bps_tree_debug_check_insert_into_leaf(&tree, assertme);
 	result |= bps_tree_debug_check_delete_from_leaf(&tree, assertme);
@@ -6001,6 +6623,8 @@ bps_tree_debug_check_internal_functions(bool assertme)
 
 #undef BPS_TREE_MEMMOVE
 #undef BPS_TREE_DATAMOVE
+#undef BPS_TREE_CARD_SIZE
+#undef BPS_TREE_CARDMOVE
 #undef BPS_TREE_BRANCH_TRACE
 
 /* {{{ Macros for custom naming of structs and functions */
@@ -6010,6 +6634,11 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef _BPS_TREE
 #undef _bps_tree_name
 
+#ifdef BPS_TREE_IS_IDENTICAL_DEFAULT
+#undef BPS_TREE_IS_IDENTICAL
+#undef BPS_TREE_IS_IDENTICAL_DEFAULT
+#endif
+
 #undef bps_tree
 #undef bps_block
 #undef bps_leaf
@@ -6025,6 +6654,7 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_find
 #undef bps_tree_insert
 #undef bps_tree_delete
+#undef bps_tree_delete_get
 #undef bps_tree_size
 #undef bps_tree_mem_used
 #undef bps_tree_random
@@ -6046,6 +6676,10 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_debug_check
 #undef bps_tree_print
 #undef bps_tree_debug_check_internal_functions
+#undef bps_tree_enable_card
+#undef bps_tree_lower_bound_get_offset
+#undef bps_tree_upper_bound_get_offset
+#undef bps_tree_iterator_at
 
 #undef bps_tree_max_sizes
 #undef BPS_TREE_MAX_COUNT_IN_LEAF
@@ -6077,6 +6711,13 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_touch_leaf_path_max_elem
 #undef bps_tree_touch_path
 #undef bps_tree_process_replace
+#undef bps_tree_block_card
+#undef bps_tree_card_set
+#undef bps_tree_card_refresh
+#undef bps_tree_card_update
+#undef bps_tree_card_fixup
+#undef bps_tree_card_build
+#undef bps_tree_inner_card_prefix
 #undef bps_tree_debug_memmove
 #undef bps_tree_insert_into_leaf
 #undef bps_tree_insert_into_inner
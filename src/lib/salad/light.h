@@ -227,6 +227,26 @@ LIGHT(find)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE data);
 static inline uint32_t
 LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE data);
 
+/**
+ * @brief Prefetch the record a lookup by given hash starts with.
+ * Used to pipeline lookups of many keys, see LIGHT(peek).
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be looked up
+ */
+static inline void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash);
+
+/**
+ * @brief Get the value of the first record with given hash
+ * in the chain the hash belongs to. The value is not compared
+ * with any key and must only be used as a prefetch hint.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be looked up
+ * @return pointer to the value or NULL if nothing found
+ */
+static inline const LIGHT_DATA_TYPE *
+LIGHT(peek)(const struct LIGHT(core) *ht, uint32_t hash);
+
 /**
  * @brief Insert a record with given hash and value
  * @param ht - pointer to a hash table struct
@@ -451,6 +471,47 @@ LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE key)
 	return LIGHT(end);
 }
 
+/**
+ * @brief Prefetch the record a lookup by given hash starts with.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be looked up
+ */
+static inline void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash)
+{
+	if (ht->count == 0)
+		return;
+	uint32_t slot = LIGHT(slot)(ht, hash);
+	__builtin_prefetch(matras_get(&ht->mtable, slot), 0);
+}
+
+/**
+ * @brief Get the value of the first record with given hash
+ * in the chain the hash belongs to.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to be looked up
+ * @return pointer to the value or NULL if nothing found
+ */
+static inline const LIGHT_DATA_TYPE *
+LIGHT(peek)(const struct LIGHT(core) *ht, uint32_t hash)
+{
+	if (ht->count == 0)
+		return NULL;
+	uint32_t slot = LIGHT(slot)(ht, hash);
+	struct LIGHT(record) *record = (struct LIGHT(record) *)
+		matras_get(&ht->mtable, slot);
+	if (record->next == slot)
+		return NULL;
+	while (record->hash != hash) {
+		slot = record->next;
+		if (slot == LIGHT(end))
+			return NULL;
+		record = (struct LIGHT(record) *)
+			matras_get(&ht->mtable, slot);
+	}
+	return &record->value;
+}
+
 /**
  * @brief Replace a record with given hash and value
  * @param ht - pointer to a hash table struct
@@ -30,10 +30,12 @@
  */
 #include "rtree.h"
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <limits.h>
 #include <stddef.h>
 #include <sys/types.h>
+#include "third_party/qsort_arg.h"
 
 /*------------------------------------------------------------------------- */
 /* R-tree internal structures definition */
@@ -132,6 +134,31 @@ rtree_set2dp(struct rtree_rect *rect, coord_t x, coord_t y)
 	rect->coords[3] = y;
 }
 
+static coord_t
+rtree_min(coord_t a, coord_t b)
+{
+	return a < b ? a : b;
+}
+
+static coord_t
+rtree_max(coord_t a, coord_t b)
+{
+	return a > b ? a : b;
+}
+
+/*
+ * Distance from a point to a rectangle along one axis.
+ * At most one of the two terms is not zero. The function
+ * has no branches so that the compiler can turn the loops
+ * below into conditional moves and vector instructions.
+ */
+static sq_coord_t
+rtree_coord_neigh_distance(const coord_t *coords, coord_t neigh_coord)
+{
+	return (sq_coord_t)rtree_max(coords[0] - neigh_coord, 0) +
+	       (sq_coord_t)rtree_max(neigh_coord - coords[1], 0);
+}
+
 /* Manhattan distance */
 static sq_coord_t
 rtree_rect_neigh_distance(const struct rtree_rect *rect,
@@ -140,15 +167,8 @@ rtree_rect_neigh_distance(const struct rtree_rect *rect,
 {
 	sq_coord_t result = 0;
 	for (int i = dimension; --i >= 0; ) {
-		const coord_t *coords = &rect->coords[2 * i];
-		coord_t neigh_coord = neigh_rect->coords[2 * i];
-		if (neigh_coord < coords[0]) {
-			sq_coord_t diff = (sq_coord_t)(neigh_coord - coords[0]);
-			result += -diff;
-		} else if (neigh_coord > coords[1]) {
-			sq_coord_t diff = (sq_coord_t)(neigh_coord - coords[1]);
-			result += diff;
-		}
+		result += rtree_coord_neigh_distance(&rect->coords[2 * i],
+						     neigh_rect->coords[2 * i]);
 	}
 	return result;
 }
@@ -161,15 +181,10 @@ rtree_rect_neigh_distance2(const struct rtree_rect *rect,
 {
 	sq_coord_t result = 0;
 	for (int i = dimension; --i >= 0; ) {
-		const coord_t *coords = &rect->coords[2 * i];
-		coord_t neigh_coord = neigh_rect->coords[2 * i];
-		if (neigh_coord < coords[0]) {
-			sq_coord_t diff = (sq_coord_t)(neigh_coord - coords[0]);
-			result += diff * diff;
-		} else if (neigh_coord > coords[1]) {
-			sq_coord_t diff = (sq_coord_t)(neigh_coord - coords[1]);
-			result += diff * diff;
-		}
+		sq_coord_t diff =
+			rtree_coord_neigh_distance(&rect->coords[2 * i],
+						   neigh_rect->coords[2 * i]);
+		result += diff * diff;
 	}
 	return result;
 }
@@ -210,18 +225,6 @@ rtree_rect_add(struct rtree_rect *to, const struct rtree_rect *item,
 	}
 }
 
-static coord_t
-rtree_min(coord_t a, coord_t b)
-{
-	return a < b ? a : b;
-}
-
-static coord_t
-rtree_max(coord_t a, coord_t b)
-{
-	return a > b ? a : b;
-}
-
 static void
 rtree_rect_cover(const struct rtree_rect *item1,
 		 const struct rtree_rect *item2,
@@ -261,13 +264,19 @@ rtree_rect_intersects_rect(const struct rtree_rect *rt1,
 			   const struct rtree_rect *rt2,
 			   unsigned dimension)
 {
+	/*
+	 * Check all axes without early exit: the branch is
+	 * unpredictable while scanning a page, and evaluating
+	 * a few more comparisons is cheaper than a misprediction.
+	 */
+	bool result = true;
 	for (int i = dimension; --i >= 0; ) {
 		const coord_t *coords1 = &rt1->coords[2 * i];
 		const coord_t *coords2 = &rt2->coords[2 * i];
-		if (coords1[0] > coords2[1] || coords1[1] < coords2[0])
-			return false;
+		result &= !(coords1[0] > coords2[1]) &
+			  !(coords1[1] < coords2[0]);
 	}
-	return true;
+	return result;
 }
 
 static bool
@@ -861,28 +870,52 @@ rtree_iterator_init(struct rtree_iterator *itr)
 	itr->page_pos = INT_MAX;
 }
 
+/*
+ * Calculate distances from a point to all branches of a page.
+ * The distance type is checked once per page rather than once
+ * per branch, so the inner loops are straight-line code.
+ */
+static void
+rtree_page_neigh_distances(const struct rtree *tree,
+			   const struct rtree_page *page,
+			   const struct rtree_rect *point,
+			   sq_coord_t *distances)
+{
+	unsigned d = tree->dimension;
+	if (tree->distance_type == RTREE_EUCLID) {
+		for (unsigned i = 0; i < page->n; i++) {
+			struct rtree_page_branch *b;
+			b = rtree_branch_get(tree, page, i);
+			distances[i] = rtree_rect_neigh_distance2(&b->rect,
+								  point, d);
+		}
+	} else {
+		for (unsigned i = 0; i < page->n; i++) {
+			struct rtree_page_branch *b;
+			b = rtree_branch_get(tree, page, i);
+			distances[i] = rtree_rect_neigh_distance(&b->rect,
+								 point, d);
+		}
+	}
+}
+
 static void
 rtree_iterator_process_neigh(struct rtree_iterator *itr,
 			     struct rtree_neighbor *neighbor)
 {
-	unsigned d = itr->tree->dimension;
 	void *child = neighbor->child;
 	struct rtree_page *pg = (struct rtree_page *)child;
 	int level = neighbor->level;
 	rtree_iterator_free_neighbor(itr, neighbor);
+	sq_coord_t distances[RTREE_MAXIMUM_BRANCHES_IN_PAGE];
+	assert(pg->n <= RTREE_MAXIMUM_BRANCHES_IN_PAGE);
+	rtree_page_neigh_distances(itr->tree, pg, &itr->rect, distances);
 	for (int i = 0, n = pg->n; i < n; i++) {
 		struct rtree_page_branch *b;
 		b = rtree_branch_get(itr->tree, pg, i);
-		coord_t distance;
-		if (itr->tree->distance_type == RTREE_EUCLID)
-			distance = rtree_rect_neigh_distance2(&b->rect,
-							      &itr->rect, d);
-		else
-			distance = rtree_rect_neigh_distance(&b->rect,
-							     &itr->rect, d);
 		struct rtree_neighbor *neigh =
 			rtree_iterator_new_neighbor(itr, b->data.page,
-						    distance, level - 1);
+						    distances[i], level - 1);
 		rtnt_insert(&itr->neigh_tree, neigh);
 	}
 }
@@ -951,6 +984,9 @@ rtree_init(struct rtree *tree, unsigned dimension, uint32_t extent_size,
 	tree->version = 0;
 	tree->n_pages = 0;
 	tree->free_pages = 0;
+	tree->build_buf = NULL;
+	tree->build_count = 0;
+	tree->build_capacity = 0;
 
 	tree->dimension = dimension;
 	tree->distance_type = distance_type;
@@ -1129,6 +1165,10 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_purge(struct rtree *tree)
 {
+	free(tree->build_buf);
+	tree->build_buf = NULL;
+	tree->build_count = 0;
+	tree->build_capacity = 0;
 	if (tree->root != NULL) {
 		rtree_page_purge(tree, tree->root, tree->height);
 		tree->root = NULL;
@@ -1149,6 +1189,212 @@ rtree_number_of_records(const struct rtree *tree) {
 	return tree->n_records;
 }
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk loading */
+/*------------------------------------------------------------------------- */
+
+/*
+ * Records are accumulated in the build buffer as page branches,
+ * i.e. tree->page_branch_size bytes each, so that they can be
+ * copied to the tree pages as is. The same buffer is reused to
+ * store branches of the upper levels while building the tree
+ * bottom-up.
+ */
+
+int
+rtree_build_reserve(struct rtree *tree, unsigned count)
+{
+	if (count <= tree->build_capacity)
+		return 0;
+	char *buf = (char *)realloc(tree->build_buf,
+				    (size_t)count * tree->page_branch_size);
+	if (buf == NULL)
+		return -1;
+	tree->build_buf = buf;
+	tree->build_capacity = count;
+	return 0;
+}
+
+int
+rtree_build_add(struct rtree *tree, const struct rtree_rect *rect,
+		record_t obj)
+{
+	assert(tree->root == NULL);
+	if (tree->build_count == tree->build_capacity) {
+		unsigned capacity = tree->build_capacity * 2;
+		if (capacity < RTREE_MAXIMUM_BRANCHES_IN_PAGE)
+			capacity = RTREE_MAXIMUM_BRANCHES_IN_PAGE;
+		if (rtree_build_reserve(tree, capacity) != 0)
+			return -1;
+	}
+	struct rtree_page_branch *b = (struct rtree_page_branch *)
+		(tree->build_buf + (size_t)tree->build_count *
+		 tree->page_branch_size);
+	b->data.record = obj;
+	rtree_rect_copy(&b->rect, rect, tree->dimension);
+	tree->build_count++;
+	return 0;
+}
+
+static int
+rtree_build_branch_cmp(const void *a, const void *b, void *arg)
+{
+	unsigned axis = *(unsigned *)arg;
+	const coord_t *c1 = ((const struct rtree_page_branch *)a)->rect.coords;
+	const coord_t *c2 = ((const struct rtree_page_branch *)b)->rect.coords;
+	/* Compare doubled centers to avoid division. */
+	coord_t m1 = c1[2 * axis] + c1[2 * axis + 1];
+	coord_t m2 = c2[2 * axis] + c2[2 * axis + 1];
+	return m1 < m2 ? -1 : m1 > m2 ? 1 : 0;
+}
+
+/* Index of the first of @count branches that goes to page @page. */
+static size_t
+rtree_build_page_begin(unsigned count, unsigned page_count, unsigned page)
+{
+	return (uint64_t)page * count / page_count;
+}
+
+/* Minimal s such that s ^ k >= n. */
+static unsigned
+rtree_build_slab_count(unsigned n, unsigned k)
+{
+	unsigned s = 1;
+	while (true) {
+		uint64_t p = 1;
+		for (unsigned i = 0; i < k && p < n; i++)
+			p *= s;
+		if (p >= n)
+			return s;
+		s++;
+	}
+}
+
+/*
+ * Sort-Tile-Recursive: order the branches that go to pages
+ * [@lo, @hi) so that each page covers a compact tile of space.
+ * The branches are sorted by the center along @axis and cut
+ * into slabs of whole pages, then each slab is tiled along
+ * the next axis.
+ */
+static void
+rtree_build_tile(struct rtree *tree, unsigned count, unsigned page_count,
+		 unsigned lo, unsigned hi, unsigned axis)
+{
+	size_t bs = tree->page_branch_size;
+	size_t begin = rtree_build_page_begin(count, page_count, lo);
+	size_t end = rtree_build_page_begin(count, page_count, hi);
+	qsort_arg(tree->build_buf + begin * bs, end - begin, bs,
+		  rtree_build_branch_cmp, &axis);
+	unsigned pages = hi - lo;
+	if (axis + 1 == tree->dimension || pages <= 1)
+		return;
+	unsigned slabs = rtree_build_slab_count(pages,
+						tree->dimension - axis);
+	for (unsigned s = 0; s < slabs; s++) {
+		unsigned slab_lo = lo + (uint64_t)pages * s / slabs;
+		unsigned slab_hi = lo + (uint64_t)pages * (s + 1) / slabs;
+		if (slab_lo < slab_hi)
+			rtree_build_tile(tree, count, page_count,
+					 slab_lo, slab_hi, axis + 1);
+	}
+}
+
+/*
+ * Put branches to the tree level by level, starting from leaves.
+ * Return false if pages can't be allocated.
+ */
+static bool
+rtree_build_pages(struct rtree *tree)
+{
+	unsigned count = tree->build_count;
+	unsigned max_fill = tree->page_max_fill;
+	unsigned total_pages = 0;
+	for (unsigned n = count; ; ) {
+		n = (n + max_fill - 1) / max_fill;
+		total_pages += n;
+		if (n == 1)
+			break;
+	}
+	/* Allocate all pages in advance to be able to fall back. */
+	struct rtree_page **pages = (struct rtree_page **)
+		malloc(total_pages * sizeof(*pages));
+	unsigned allocated = 0;
+	if (pages != NULL) {
+		for (; allocated < total_pages; allocated++) {
+			pages[allocated] = rtree_page_alloc(tree);
+			if (pages[allocated] == NULL)
+				break;
+		}
+	}
+	if (pages == NULL || allocated < total_pages) {
+		for (unsigned i = 0; i < allocated; i++)
+			rtree_page_free(tree, pages[i]);
+		free(pages);
+		return false;
+	}
+	size_t bs = tree->page_branch_size;
+	unsigned next_page = 0;
+	unsigned height = 0;
+	unsigned n = count;
+	while (true) {
+		unsigned page_count = (n + max_fill - 1) / max_fill;
+		if (page_count > 1)
+			rtree_build_tile(tree, n, page_count,
+					 0, page_count, 0);
+		for (unsigned i = 0; i < page_count; i++) {
+			struct rtree_page *page = pages[next_page++];
+			size_t begin, end;
+			begin = rtree_build_page_begin(n, page_count, i);
+			end = rtree_build_page_begin(n, page_count, i + 1);
+			page->n = end - begin;
+			memcpy(page->data, tree->build_buf + begin * bs,
+			       page->n * bs);
+			/*
+			 * Branches of page i have been copied, so it's
+			 * safe to overwrite the i-th branch, because
+			 * begin >= i.
+			 */
+			struct rtree_page_branch *b =
+				(struct rtree_page_branch *)
+				(tree->build_buf + i * bs);
+			rtree_page_cover(tree, page, &b->rect);
+			b->data.page = page;
+		}
+		height++;
+		if (page_count == 1)
+			break;
+		n = page_count;
+	}
+	assert(next_page == total_pages);
+	tree->root = pages[total_pages - 1];
+	tree->height = height;
+	tree->n_pages += total_pages;
+	tree->n_records = count;
+	tree->version++;
+	free(pages);
+	return true;
+}
+
+void
+rtree_build_end(struct rtree *tree)
+{
+	assert(tree->root == NULL);
+	if (tree->build_count > 0 && !rtree_build_pages(tree)) {
+		/* Out of memory, fall back on insertion. */
+		for (unsigned i = 0; i < tree->build_count; i++) {
+			struct rtree_page_branch *b =
+				(struct rtree_page_branch *)(tree->build_buf +
+					(size_t)i * tree->page_branch_size);
+			rtree_insert(tree, &b->rect, b->data.record);
+		}
+	}
+	free(tree->build_buf);
+	tree->build_buf = NULL;
+	tree->build_count = 0;
+	tree->build_capacity = 0;
+}
+
 #if 0
 #include <stdio.h>
 void
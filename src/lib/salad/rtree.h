@@ -152,6 +152,12 @@ struct rtree
 	void *free_pages;
 	/* Distance type */
 	enum rtree_distance_type distance_type;
+	/* Records added by rtree_build_add(), see rtree_build_end() */
+	char *build_buf;
+	/* Number of records in the build buffer */
+	unsigned build_count;
+	/* Number of records the build buffer can hold */
+	unsigned build_capacity;
 };
 
 /* Struct for iteration and retrieving rtree values */
@@ -285,6 +291,39 @@ rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 bool
 rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Reserve space in the build buffer of a tree
+ * @param tree - pointer to a tree
+ * @param count - expected number of records
+ * @return 0 on success, -1 on memory allocation error
+ */
+int
+rtree_build_reserve(struct rtree *tree, unsigned count);
+
+/**
+ * @brief Add a record to the build buffer of an empty tree.
+ * The record is not visible until rtree_build_end() is called.
+ * @param tree - pointer to a tree
+ * @param rect - rectangle of the record
+ * @param obj - record to add
+ * @return 0 on success, -1 on memory allocation error
+ */
+int
+rtree_build_add(struct rtree *tree, const struct rtree_rect *rect,
+		record_t obj);
+
+/**
+ * @brief Bulk load records added by rtree_build_add() into the
+ * tree with Sort-Tile-Recursive algorithm. Pages of the resulting
+ * tree are filled evenly and almost completely, which is much
+ * faster than inserting records one by one and gives better
+ * search performance. If pages can't be allocated, the records
+ * are inserted one by one.
+ * @param tree - pointer to a tree
+ */
+void
+rtree_build_end(struct rtree *tree);
+
 /**
  * @brief Size of memory used by tree
  * @param tree - pointer to a tree
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "shm_channel.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "trivia/config.h"
+#include "trivia/util.h"
+#include "diag.h"
+
+enum {
+	SHM_CHANNEL_MAGIC = 0x4d485354, /* "TSHM" */
+	/** Keep the reader and the writer on own cache lines. */
+	SHM_CHANNEL_ALIGN = 64,
+	SHM_CHANNEL_RING_SIZE_MIN = 4096,
+};
+
+/** The beginning of the shared memory. */
+struct shm_channel_header {
+	uint32_t magic;
+	uint32_t ring_size;
+	char pad[SHM_CHANNEL_ALIGN - 8];
+};
+
+/**
+ * A ring in shared memory. The positions grow monotonically,
+ * the offset in the data is the position modulo the ring size.
+ * The peer may write anything to the shared memory, so the
+ * positions are validated before use, and the ring size is
+ * taken from struct shm_channel.
+ */
+struct shm_ring {
+	/** Number of bytes ever read, advanced by the reader. */
+	uint64_t rpos;
+	/** Set by the reader waiting for data. */
+	uint32_t reader_waits;
+	char pad1[SHM_CHANNEL_ALIGN - 12];
+	/** Number of bytes ever written, advanced by the writer. */
+	uint64_t wpos;
+	/** Set by the writer waiting for space. */
+	uint32_t writer_waits;
+	char pad2[SHM_CHANNEL_ALIGN - 12];
+	char data[0];
+};
+
+static size_t
+shm_channel_map_size(size_t ring_size)
+{
+	return sizeof(struct shm_channel_header) +
+	       2 * (sizeof(struct shm_ring) + ring_size);
+}
+
+static void
+shm_channel_attach(struct shm_channel *channel, int fd, void *map,
+		   size_t map_size, size_t ring_size, bool is_creator)
+{
+	char *first = (char *) map + sizeof(struct shm_channel_header);
+	char *second = first + sizeof(struct shm_ring) + ring_size;
+	channel->map = map;
+	channel->map_size = map_size;
+	channel->ring_size = ring_size;
+	channel->fd = fd;
+	channel->in = (struct shm_ring *) (is_creator ? first : second);
+	channel->out = (struct shm_ring *) (is_creator ? second : first);
+}
+
+int
+shm_channel_create(struct shm_channel *channel, int fd, size_t ring_size)
+{
+#if defined(HAVE_MEMFD_CREATE)
+	size_t size = SHM_CHANNEL_RING_SIZE_MIN;
+	while (size < ring_size && size <= UINT32_MAX / 2)
+		size *= 2;
+	ring_size = size;
+	size_t map_size = shm_channel_map_size(ring_size);
+	int memfd = memfd_create("tarantool-shm", MFD_CLOEXEC);
+	if (memfd < 0) {
+		diag_set(SystemError, "memfd_create");
+		return -1;
+	}
+	if (ftruncate(memfd, map_size) != 0) {
+		diag_set(SystemError, "failed to allocate shared memory");
+		close(memfd);
+		return -1;
+	}
+	void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 memfd, 0);
+	if (map == MAP_FAILED) {
+		diag_set(SystemError, "failed to map shared memory");
+		close(memfd);
+		return -1;
+	}
+	/* The memory is zero-filled by ftruncate(). */
+	struct shm_channel_header *header = (struct shm_channel_header *) map;
+	header->magic = SHM_CHANNEL_MAGIC;
+	header->ring_size = ring_size;
+	shm_channel_attach(channel, fd, map, map_size, ring_size, true);
+	return memfd;
+#else
+	(void) channel;
+	(void) fd;
+	(void) ring_size;
+	errno = ENOSYS;
+	diag_set(SystemError, "shared memory channel is not supported");
+	return -1;
+#endif
+}
+
+int
+shm_channel_open(struct shm_channel *channel, int fd, int memfd)
+{
+	struct stat st;
+	if (fstat(memfd, &st) != 0) {
+		diag_set(SystemError, "fstat");
+		return -1;
+	}
+	size_t map_size = st.st_size;
+	if (map_size < sizeof(struct shm_channel_header))
+		goto invalid;
+	void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 memfd, 0);
+	if (map == MAP_FAILED) {
+		diag_set(SystemError, "failed to map shared memory");
+		return -1;
+	}
+	struct shm_channel_header *header = (struct shm_channel_header *) map;
+	size_t ring_size = header->ring_size;
+	if (header->magic != SHM_CHANNEL_MAGIC ||
+	    ring_size < SHM_CHANNEL_RING_SIZE_MIN ||
+	    (ring_size & (ring_size - 1)) != 0 ||
+	    shm_channel_map_size(ring_size) != map_size) {
+		munmap(map, map_size);
+		goto invalid;
+	}
+	shm_channel_attach(channel, fd, map, map_size, ring_size, false);
+	return 0;
+invalid:
+	errno = EPROTO;
+	diag_set(SystemError, "invalid shared memory channel");
+	return -1;
+}
+
+void
+shm_channel_destroy(struct shm_channel *channel)
+{
+	if (channel->map != NULL)
+		munmap(channel->map, channel->map_size);
+	channel->map = NULL;
+	channel->in = channel->out = NULL;
+}
+
+/** Wake up the peer. */
+static int
+shm_channel_notify(struct shm_channel *channel)
+{
+	char bell = 0;
+	if (send(channel->fd, &bell, 1, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+	    errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+		/*
+		 * A full socket buffer is fine: it is full
+		 * of doorbells the peer has not seen yet.
+		 */
+		return -1;
+	}
+	return 0;
+}
+
+int
+shm_channel_drain(struct shm_channel *channel)
+{
+	char buf[64];
+	int count = 0;
+	while (true) {
+		ssize_t n = recv(channel->fd, buf, sizeof(buf), MSG_DONTWAIT);
+		if (n > 0) {
+			count += n;
+			continue;
+		}
+		if (n == 0)
+			return -1;
+		if (errno == EINTR)
+			continue;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return count;
+		return -1;
+	}
+}
+
+/**
+ * Copy data from the ring and wake up the writer if it waits
+ * for space. Return the number of bytes read.
+ */
+static ssize_t
+shm_ring_read(struct shm_channel *channel, char *buf, size_t size)
+{
+	struct shm_ring *ring = channel->in;
+	size_t ring_size = channel->ring_size;
+	uint64_t rpos = __atomic_load_n(&ring->rpos, __ATOMIC_RELAXED);
+	uint64_t wpos = __atomic_load_n(&ring->wpos, __ATOMIC_ACQUIRE);
+	if (wpos - rpos > ring_size) {
+		errno = EPROTO;
+		return -1;
+	}
+	size_t n = MIN(size, wpos - rpos);
+	if (n == 0)
+		return 0;
+	size_t offset = rpos & (ring_size - 1);
+	size_t head = MIN(n, ring_size - offset);
+	memcpy(buf, ring->data + offset, head);
+	memcpy(buf + head, ring->data, n - head);
+	__atomic_store_n(&ring->rpos, rpos + n, __ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&ring->writer_waits, 0, __ATOMIC_SEQ_CST) &&
+	    shm_channel_notify(channel) != 0)
+		return -1;
+	return n;
+}
+
+ssize_t
+shm_channel_read(struct shm_channel *channel, void *buf, size_t size)
+{
+	ssize_t n = shm_ring_read(channel, (char *) buf, size);
+	if (n != 0)
+		return n;
+	/*
+	 * Announce the wait and look at the ring once again,
+	 * to not miss data written before the announcement.
+	 */
+	__atomic_store_n(&channel->in->reader_waits, 1, __ATOMIC_SEQ_CST);
+	n = shm_ring_read(channel, (char *) buf, size);
+	if (n != 0)
+		return n;
+	errno = EAGAIN;
+	return -1;
+}
+
+/**
+ * Copy as much of @a iov as fits to the ring and wake up the
+ * reader if it waits for data. Return the number of bytes
+ * written.
+ */
+static ssize_t
+shm_ring_writev(struct shm_channel *channel, const struct iovec *iov,
+		int iovcnt)
+{
+	struct shm_ring *ring = channel->out;
+	size_t ring_size = channel->ring_size;
+	uint64_t wpos = __atomic_load_n(&ring->wpos, __ATOMIC_RELAXED);
+	uint64_t rpos = __atomic_load_n(&ring->rpos, __ATOMIC_SEQ_CST);
+	if (wpos - rpos > ring_size) {
+		errno = EPROTO;
+		return -1;
+	}
+	size_t space = ring_size - (wpos - rpos);
+	size_t n = 0;
+	for (int i = 0; i < iovcnt && n < space; i++) {
+		size_t len = MIN(iov[i].iov_len, space - n);
+		size_t offset = (wpos + n) & (ring_size - 1);
+		size_t head = MIN(len, ring_size - offset);
+		const char *src = (const char *) iov[i].iov_base;
+		memcpy(ring->data + offset, src, head);
+		memcpy(ring->data, src + head, len - head);
+		n += len;
+	}
+	if (n == 0)
+		return 0;
+	__atomic_store_n(&ring->wpos, wpos + n, __ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&ring->reader_waits, 0, __ATOMIC_SEQ_CST) &&
+	    shm_channel_notify(channel) != 0)
+		return -1;
+	return n;
+}
+
+ssize_t
+shm_channel_writev(struct shm_channel *channel, const struct iovec *iov,
+		   int iovcnt)
+{
+	ssize_t n = shm_ring_writev(channel, iov, iovcnt);
+	if (n != 0)
+		return n;
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+	if (size == 0)
+		return 0;
+	/* See shm_channel_read(). */
+	__atomic_store_n(&channel->out->writer_waits, 1, __ATOMIC_SEQ_CST);
+	n = shm_ring_writev(channel, iov, iovcnt);
+	if (n != 0)
+		return n;
+	errno = EAGAIN;
+	return -1;
+}
+
+/**
+ * Ancillary data with a descriptor, the header makes the
+ * buffer aligned as CMSG_FIRSTHDR() expects.
+ */
+union shm_channel_control {
+	struct cmsghdr cmsg;
+	char buf[CMSG_SPACE(sizeof(int))];
+};
+
+int
+shm_channel_send_fd(int fd, const void *data, size_t size, int memfd)
+{
+	struct iovec iov;
+	iov.iov_base = (void *) data;
+	iov.iov_len = size;
+	union shm_channel_control control;
+	memset(&control, 0, sizeof(control));
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+	ssize_t n = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (n < 0) {
+		diag_set(SystemError, "sendmsg");
+		return -1;
+	}
+	if ((size_t) n != size) {
+		/* The socket buffer of a fresh connection is empty. */
+		errno = EAGAIN;
+		diag_set(SystemError, "sendmsg");
+		return -1;
+	}
+	return 0;
+}
+
+ssize_t
+shm_channel_recv_fd(int fd, void *buf, size_t size, int *memfd)
+{
+	struct iovec iov;
+	iov.iov_base = buf;
+	iov.iov_len = size;
+	union shm_channel_control control;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	ssize_t n = recvmsg(fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+	if (n < 0)
+		return n;
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+	     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SCM_RIGHTS &&
+		    cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+			memcpy(memfd, CMSG_DATA(cmsg), sizeof(int));
+		}
+	}
+	return n;
+}
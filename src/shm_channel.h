@@ -0,0 +1,168 @@
+#ifndef TARANTOOL_SHM_CHANNEL_H_INCLUDED
+#define TARANTOOL_SHM_CHANNEL_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/**
+ * A byte stream channel between two processes on the same
+ * host, made of two single producer single consumer rings in
+ * shared memory, one per direction.
+ *
+ * The channel is attached to a connected unix socket, which
+ * is used to pass the shared memory descriptor, as a doorbell
+ * and to detect that the peer is gone. A side only rings the
+ * doorbell, i.e. sends a byte to the socket, if the peer has
+ * announced that it waits for data or space in a ring, so a
+ * busy channel does no system calls at all. A side waiting
+ * for the peer polls the socket for input, consumes the
+ * doorbells with shm_channel_drain() and calls
+ * shm_channel_read() or shm_channel_writev() again.
+ *
+ * The doorbell is not an eventfd: an eventfd is not closed
+ * when the peer dies, so the waiting side would have to poll
+ * the socket as well, and every connection would need two
+ * watchers. Doorbells are rare anyway, and a socket buffer
+ * full of them only means that the peer has not woken up yet.
+ *
+ * The server side creates the channel with shm_channel_create()
+ * and passes the returned descriptor to the client with
+ * shm_channel_send_fd(), the client receives it with
+ * shm_channel_recv_fd() and maps it with shm_channel_open().
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct shm_ring;
+
+struct shm_channel {
+	/** Shared memory with both rings. */
+	void *map;
+	size_t map_size;
+	/** The ring to read from. */
+	struct shm_ring *in;
+	/** The ring to write to. */
+	struct shm_ring *out;
+	/** Size of each ring, a power of two. */
+	size_t ring_size;
+	/** Unix socket connected to the peer. */
+	int fd;
+};
+
+/**
+ * Create a channel on a unix socket @a fd, with rings of
+ * @a ring_size bytes, rounded up to a power of two.
+ * The side creating the channel reads from the first ring
+ * and writes to the second one.
+ * @return Shared memory descriptor, to be passed to the peer
+ *         and closed, or -1 on error, diag is set.
+ */
+int
+shm_channel_create(struct shm_channel *channel, int fd, size_t ring_size);
+
+/**
+ * Attach to a channel created by the peer with
+ * shm_channel_create(). @a memfd may be closed afterwards.
+ * @retval 0 Success.
+ * @retval -1 Error, diag is set.
+ */
+int
+shm_channel_open(struct shm_channel *channel, int fd, int memfd);
+
+/**
+ * Unmap the channel memory. The socket is not closed, closing
+ * it tells the peer that the channel is gone.
+ */
+void
+shm_channel_destroy(struct shm_channel *channel);
+
+/**
+ * Read at most @a size bytes from the channel.
+ * @retval >0 Number of bytes read.
+ * @retval -1 errno is EAGAIN if there is no data: wait until
+ *            the socket becomes readable, call
+ *            shm_channel_drain() and retry. Otherwise it is
+ *            a socket error.
+ */
+ssize_t
+shm_channel_read(struct shm_channel *channel, void *buf, size_t size);
+
+/**
+ * Write as much of @a iov as fits to the channel.
+ * @retval >=0 Number of bytes written.
+ * @retval  -1 errno is EAGAIN if the ring is full: wait until
+ *             the socket becomes readable. Otherwise it is a
+ *             socket error, e.g. EPIPE if the peer is gone.
+ */
+ssize_t
+shm_channel_writev(struct shm_channel *channel, const struct iovec *iov,
+		   int iovcnt);
+
+/**
+ * Consume the doorbells sent by the peer, must be called
+ * whenever the socket becomes readable. A doorbell tells
+ * that there is data or space in a ring, so both reading and
+ * writing may be retried.
+ * @retval >0 Number of doorbells consumed.
+ * @retval  0 Nothing to consume.
+ * @retval -1 The peer has closed the socket. The data it has
+ *            written may be still read from the channel.
+ */
+int
+shm_channel_drain(struct shm_channel *channel);
+
+/**
+ * Send @a size bytes of @a data together with descriptor
+ * @a memfd over a unix socket, without blocking.
+ * @retval 0 Success.
+ * @retval -1 Error, diag is set.
+ */
+int
+shm_channel_send_fd(int fd, const void *data, size_t size, int memfd);
+
+/**
+ * Receive at most @a size bytes from a unix socket, without
+ * blocking. If the data is accompanied by a descriptor, it is
+ * returned in @a memfd, which is left intact otherwise.
+ * @return The same as recv().
+ */
+ssize_t
+shm_channel_recv_fd(int fd, void *buf, size_t size, int *memfd);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_SHM_CHANNEL_H_INCLUDED */
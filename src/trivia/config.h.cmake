@@ -167,6 +167,9 @@
 #cmakedefine HAVE_SCHED_YIELD 1
 #cmakedefine HAVE_POSIX_FADVISE 1
 #cmakedefine HAVE_MREMAP 1
+#cmakedefine HAVE_MEMFD_CREATE 1
+/** io_uring kernel interface - Linux 5.1+ */
+#cmakedefine HAVE_IO_URING 1
 
 #cmakedefine HAVE_PRCTL_H 1
 
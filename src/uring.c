@@ -0,0 +1,373 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "uring.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diag.h"
+
+#if defined(HAVE_IO_URING)
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#if !defined(RWF_NOWAIT)
+#define RWF_NOWAIT 0x00000008
+#endif
+
+/*
+ * liburing is not widely packaged yet, and the part of it we
+ * need is tiny, so the ring is set up with raw system calls.
+ */
+static inline int
+sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+		   unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+static int
+uring_probe_nowait(struct uring *ring);
+
+int
+uring_create(struct uring *ring, unsigned entries)
+{
+	memset(ring, 0, sizeof(*ring));
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring->fd = sys_io_uring_setup(entries, &params);
+	if (ring->fd < 0) {
+		diag_set(SystemError, "io_uring_setup");
+		return -1;
+	}
+	ring->entries = params.sq_entries;
+	ring->iov = (struct iovec *) calloc(ring->entries, sizeof(*ring->iov));
+	if (ring->iov == NULL) {
+		diag_set(OutOfMemory, ring->entries * sizeof(*ring->iov),
+			 "calloc", "ring->iov");
+		uring_destroy(ring);
+		return -1;
+	}
+
+	ring->sq_ring_size = params.sq_off.array +
+			     params.sq_entries * sizeof(unsigned);
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+			     MAP_SHARED | MAP_POPULATE, ring->fd,
+			     IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		ring->sq_ring = NULL;
+		goto error;
+	}
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd,
+			  IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		goto error;
+	}
+	ring->cq_ring_size = params.cq_off.cqes +
+			     params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+			     MAP_SHARED | MAP_POPULATE, ring->fd,
+			     IORING_OFF_CQ_RING);
+	if (ring->cq_ring == MAP_FAILED) {
+		ring->cq_ring = NULL;
+		goto error;
+	}
+
+	char *sq = (char *) ring->sq_ring;
+	ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+	char *cq = (char *) ring->cq_ring;
+	ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+	if (uring_probe_nowait(ring) != 0) {
+		uring_destroy(ring);
+		return -1;
+	}
+	return 0;
+error:
+	diag_set(SystemError, "failed to map io_uring");
+	uring_destroy(ring);
+	return -1;
+}
+
+void
+uring_destroy(struct uring *ring)
+{
+	if (ring->cq_ring != NULL)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sqes != NULL)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->sq_ring != NULL)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	free(ring->iov);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	ring->fd = -1;
+}
+
+/*
+ * All requests are issued with RWF_NOWAIT: otherwise the kernel
+ * ignores O_NONBLOCK of a socket and makes a worker thread wait
+ * for it to become ready. Support of the flag is checked by
+ * uring_probe_nowait() when the ring is created.
+ */
+
+/**
+ * Get the next free submission queue entry. The entry is
+ * published to the kernel only by uring_submit(), which
+ * moves the tail of the submission queue.
+ */
+static struct io_uring_sqe *
+uring_get_sqe(struct uring *ring, uint64_t data)
+{
+	assert(!uring_is_full(ring));
+	unsigned index = (*ring->sq_tail + ring->count) & *ring->sq_mask;
+	ring->count++;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = data;
+	ring->sq_array[index] = index;
+	return sqe;
+}
+
+void
+uring_read(struct uring *ring, int fd, void *buf, size_t count,
+	   uint64_t data)
+{
+	/*
+	 * IORING_OP_READ is available only since Linux 5.6, so
+	 * use a vector of one buffer, which is kept in the ring
+	 * until the request completes.
+	 */
+	unsigned index = (*ring->sq_tail + ring->count) & *ring->sq_mask;
+	struct iovec *iov = &ring->iov[index];
+	iov->iov_base = buf;
+	iov->iov_len = count;
+	struct io_uring_sqe *sqe = uring_get_sqe(ring, data);
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t) iov;
+	sqe->len = 1;
+	sqe->rw_flags = RWF_NOWAIT;
+}
+
+void
+uring_writev(struct uring *ring, int fd, const struct iovec *iov,
+	     int iovcnt, uint64_t data)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(ring, data);
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t) iov;
+	sqe->len = iovcnt;
+	sqe->rw_flags = RWF_NOWAIT;
+}
+
+unsigned
+uring_submit(struct uring *ring)
+{
+	unsigned count = ring->count;
+	if (count == 0)
+		return 0;
+	/* Publish the queued entries to the kernel. */
+	__atomic_store_n(ring->sq_tail, *ring->sq_tail + count,
+			 __ATOMIC_RELEASE);
+	ring->count = 0;
+	unsigned submitted = 0;
+	while (submitted < count) {
+		int rc = sys_io_uring_enter(ring->fd, count - submitted,
+					    0, 0);
+		if (rc > 0) {
+			submitted += rc;
+			continue;
+		}
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc == 0)
+			errno = EAGAIN;
+		diag_set(SystemError, "io_uring_enter");
+		/*
+		 * The kernel consumes entries in order, so the
+		 * rejected ones are at the tail. Take them back
+		 * so that they aren't submitted by a later call.
+		 */
+		__atomic_store_n(ring->sq_tail,
+				 *ring->sq_tail - (count - submitted),
+				 __ATOMIC_RELEASE);
+		break;
+	}
+	return submitted;
+}
+
+/** Wait until there's at least one completion to fetch. */
+static int
+uring_wait(struct uring *ring)
+{
+	while (sys_io_uring_enter(ring->fd, 0, 1,
+				  IORING_ENTER_GETEVENTS) < 0) {
+		if (errno != EINTR) {
+			diag_set(SystemError, "io_uring_enter");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Check that a read from an empty socket issued with RWF_NOWAIT
+ * fails with -EAGAIN rather than blocks. Kernels that don't
+ * support the flag for sockets either fail the request with
+ * -EOPNOTSUPP or -EINVAL, which would drop every connection,
+ * or punt it to a worker thread, which would tie a kernel
+ * thread to each idle connection.
+ */
+static int
+uring_probe_nowait(struct uring *ring)
+{
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) != 0) {
+		diag_set(SystemError, "socketpair");
+		return -1;
+	}
+	int rc = -1;
+	char buf = 0;
+	uint64_t data;
+	int res;
+	uring_read(ring, sv[0], &buf, 1, 0);
+	if (uring_submit(ring) != 1)
+		goto out;
+	if (!uring_complete(ring, &data, &res)) {
+		/* The read is blocked, wake it up. */
+		if (write(sv[1], &buf, 1) != 1) {
+			diag_set(SystemError, "write");
+			goto out;
+		}
+		if (uring_wait(ring) != 0 ||
+		    !uring_complete(ring, &data, &res))
+			goto out;
+	}
+	if (res != -EAGAIN) {
+		errno = res < 0 ? -res : EOPNOTSUPP;
+		diag_set(SystemError, "io_uring doesn't support "
+			 "RWF_NOWAIT for sockets");
+		goto out;
+	}
+	rc = 0;
+out:
+	close(sv[0]);
+	close(sv[1]);
+	return rc;
+}
+
+bool
+uring_complete(struct uring *ring, uint64_t *data, int *res)
+{
+	unsigned head = *ring->cq_head;
+	if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+	struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+	*data = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+#else /* !defined(HAVE_IO_URING) */
+
+int
+uring_create(struct uring *ring, unsigned entries)
+{
+	(void) entries;
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+	errno = ENOSYS;
+	diag_set(SystemError, "io_uring is not supported");
+	return -1;
+}
+
+void
+uring_destroy(struct uring *ring)
+{
+	(void) ring;
+}
+
+void
+uring_read(struct uring *ring, int fd, void *buf, size_t count,
+	   uint64_t data)
+{
+	(void) ring; (void) fd; (void) buf; (void) count; (void) data;
+	unreachable();
+}
+
+void
+uring_writev(struct uring *ring, int fd, const struct iovec *iov,
+	     int iovcnt, uint64_t data)
+{
+	(void) ring; (void) fd; (void) iov; (void) iovcnt; (void) data;
+	unreachable();
+}
+
+unsigned
+uring_submit(struct uring *ring)
+{
+	(void) ring;
+	unreachable();
+	return 0;
+}
+
+bool
+uring_complete(struct uring *ring, uint64_t *data, int *res)
+{
+	(void) ring; (void) data; (void) res;
+	return false;
+}
+
+#endif /* defined(HAVE_IO_URING) */
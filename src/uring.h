@@ -0,0 +1,156 @@
+#ifndef TARANTOOL_URING_H_INCLUDED
+#define TARANTOOL_URING_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/**
+ * A minimal wrapper over Linux io_uring, used to batch socket
+ * reads and writes of many descriptors into a single system
+ * call. Requests are queued with uring_read() and uring_writev()
+ * and then submitted together with uring_submit(), which doesn't
+ * wait for them to complete. Completions are fetched with
+ * uring_complete(), the ring descriptor becomes readable when
+ * there are completions to fetch.
+ *
+ * Only non-blocking descriptors are supposed to be used with
+ * the ring: requests are issued with RWF_NOWAIT, so a request
+ * that would block completes with -EAGAIN and the caller is
+ * expected to wait for readiness in the event loop as usual.
+ * Socket requests usually complete right within uring_submit().
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "trivia/config.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+struct uring {
+	/** Ring file descriptor, -1 if the ring is not created. */
+	int fd;
+	/** Number of submission queue entries. */
+	unsigned entries;
+	/** Number of requests queued since the last submit. */
+	unsigned count;
+	/** Submission queue ring, mapped from the kernel. */
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	/** Submission queue entries, mapped from the kernel. */
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	/** Completion queue ring, mapped from the kernel. */
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+	/** Buffers of queued reads, one per submission entry. */
+	struct iovec *iov;
+};
+
+/**
+ * Create a ring with the given number of submission queue
+ * entries, rounded up to a power of two by the kernel.
+ * Return -1 and set diag if io_uring is not available,
+ * including the case when it is not supported by the build
+ * or the kernel doesn't support RWF_NOWAIT for sockets.
+ */
+int
+uring_create(struct uring *ring, unsigned entries);
+
+/** Destroy a ring, created with uring_create(). */
+void
+uring_destroy(struct uring *ring);
+
+/** True if no more requests can be queued before a submit. */
+static inline bool
+uring_is_full(struct uring *ring)
+{
+	return ring->count == ring->entries;
+}
+
+/**
+ * Queue a read of at most @a count bytes from @a fd to @a buf.
+ * @a data is passed back with the completion.
+ * The ring must not be full.
+ */
+void
+uring_read(struct uring *ring, int fd, void *buf, size_t count,
+	   uint64_t data);
+
+/**
+ * Queue a writev() of @a iovcnt buffers to @a fd. The iovec
+ * array must stay valid until the request completes.
+ * @a data is passed back with the completion.
+ * The ring must not be full.
+ */
+void
+uring_writev(struct uring *ring, int fd, const struct iovec *iov,
+	     int iovcnt, uint64_t data);
+
+/**
+ * Submit all queued requests, normally with a single system
+ * call. Doesn't wait for the requests to complete.
+ *
+ * Return the number of submitted requests. If it is less than
+ * the number of queued requests, the kernel failed to accept
+ * the rest: they are dropped and diag is set. Requests are
+ * accepted in the order they were queued.
+ */
+unsigned
+uring_submit(struct uring *ring);
+
+/**
+ * Fetch a completion of a submitted request.
+ * @param[out] data Data passed to the request.
+ * @param[out] res Result of the request: number of bytes
+ *             transferred or a negated errno value.
+ * @retval true A completion is fetched.
+ * @retval false There are no more completions.
+ */
+bool
+uring_complete(struct uring *ring, uint64_t *data, int *res);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_URING_H_INCLUDED */
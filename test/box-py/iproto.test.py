@@ -417,8 +417,61 @@ resp = test_request(header, body)
 print "Sync: ", resp['header'][IPROTO_SYNC]
 print "Retcode: ", resp['body'][IPROTO_DATA]
 
+#
+# Pipelined selects are processed in tx by one message.
+#
+query = ''
+for sync in range(200, 204):
+    header = msgpack.dumps({ IPROTO_CODE: REQUEST_TYPE_SELECT,
+                             IPROTO_SYNC: sync })
+    body = msgpack.dumps({ IPROTO_SPACE_ID: 568, IPROTO_KEY: [1] })
+    query += msgpack.dumps(len(header) + len(body)) + header + body
+s.send(query)
+for sync in range(200, 204):
+    resp = receive_response()
+    print "Sync: ", resp['header'][IPROTO_SYNC], resp['body'][IPROTO_DATA]
+
+#
+# Reads of vinyl spaces may yield, so tx processes them in
+# fibers of their own and their replies may come out of order.
+#
+admin("vinyl = box.schema.space.create('test_vinyl', { id = 569, engine = 'vinyl' })")
+admin("_ = vinyl:create_index('pk')")
+admin("_ = vinyl:replace{1, 'vinyl'}")
+query = ''
+for sync in range(300, 306):
+    header = msgpack.dumps({ IPROTO_CODE: REQUEST_TYPE_SELECT,
+                             IPROTO_SYNC: sync })
+    body = msgpack.dumps({ IPROTO_SPACE_ID: 568 + sync % 2,
+                           IPROTO_KEY: [1] })
+    query += msgpack.dumps(len(header) + len(body)) + header + body
+s.send(query)
+replies = {}
+for sync in range(300, 306):
+    resp = receive_response()
+    replies[resp['header'][IPROTO_SYNC]] = resp['body'][IPROTO_DATA]
+for sync in sorted(replies):
+    print "Sync: ", sync, replies[sync]
+
 c.close()
 
+#
+# Requests of guest sessions are batch, and requests of
+# authenticated users are interactive.
+#
+admin("box.stat.net.BATCH_QUEUED.total > 0")
+admin("box.stat.net.BATCH_DEQUEUED.total == box.stat.net.BATCH_QUEUED.total")
+admin("interactive = box.stat.net.INTERACTIVE_QUEUED.total")
+admin("box.schema.user.create('test', { password = 'test' })")
+admin("c = require('net.box').connect(box.cfg.listen, { user = 'test', password = 'test' })")
+admin("c:ping()")
+admin("c:close()")
+admin("box.stat.net.INTERACTIVE_QUEUED.total > interactive")
+admin("box.stat.net.INTERACTIVE_DEQUEUED.total == box.stat.net.INTERACTIVE_QUEUED.total")
+admin("box.schema.user.drop('test')")
+admin("box.stat.net.TX_MSG_4.total > 0")
+admin("vinyl:drop()")
+
 admin("box.schema.user.revoke('guest', 'read,write,execute', 'universe')")
 
 admin("space:drop()")
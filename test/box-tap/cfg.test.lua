@@ -4,7 +4,7 @@ local tap = require('tap')
 local test = tap.test('cfg')
 local socket = require('socket')
 local fio = require('fio')
-test:plan(70)
+test:plan(73)
 
 --------------------------------------------------------------------------------
 -- Invalid values
@@ -31,6 +31,9 @@ invalid('listen', '//!')
 invalid('log', ':')
 invalid('log', 'syslog:xxx=')
 invalid('log_level', 'unknown')
+invalid('memtx_numa_nodes', '3-1')
+invalid('memtx_numa_nodes', '0,,1')
+invalid('memtx_numa_nodes', '99999')
 
 test:is(type(box.cfg), 'function', 'box is not started')
 
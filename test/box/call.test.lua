@@ -237,6 +237,90 @@ conn:call("return_sparse4")
 conn:eval("return return_sparse4()")
 conn:call_16("return_sparse4")
 
+--
+-- Lua function names are resolved on every CALL: rebinding
+-- a function or a table on its path must be visible at once.
+--
+test_ns = { sub = { f = function() return 1 end } }
+conn:call("test_ns.sub.f")
+test_ns.sub.f = function() return 2 end
+conn:call("test_ns.sub.f")
+test_ns.sub = { f = function() return 3 end }
+conn:call("test_ns.sub.f")
+test_ns.obj = { x = 4 }
+function test_ns.obj:get() return self.x end
+conn:call("test_ns.obj:get")
+test_ns.obj = { x = 5, get = test_ns.obj.get }
+conn:call("test_ns.obj:get")
+test_ns.sub = nil
+conn:call("test_ns.sub.f")
+test_ns.sub = { f = function() return 6 end }
+conn:call("test_ns.sub.f")
+-- DDL doesn't affect resolution of names.
+s = box.schema.space.create('call_name_test')
+conn:call("test_ns.sub.f")
+conn:call("test_ns.obj:get")
+s:drop()
+conn:call("test_ns.obj:get")
+test_ns = nil
+
+--
+-- Cached functions are resolved anew after _func changes and
+-- box.schema.func.reload().
+--
+test_ns = { f = function() return 1 end }
+box.schema.func.create('test_ns.f')
+conn:call("test_ns.f")
+test_ns.f = function() return 2 end
+box.schema.func.reload('test_ns.f')
+conn:call("test_ns.f")
+box.schema.func.drop('test_ns.f')
+conn:call("test_ns.f")
+test_ns = nil
+conn:call("test_ns.f")
+
+--
+-- A pooled coroutine doesn't keep the hook or the globals
+-- table set by a previous request.
+--
+conn:eval("debug.sethook(function() end, 'c') setfenv(0, {}) return 1")
+conn:eval("return debug.gethook() == nil")
+conn:eval("return type(box)")
+
+--
+-- Consecutive requests reuse a coroutine, unless a request
+-- fails, and concurrent requests get coroutines of their own.
+--
+conn:eval("coro = coroutine.running()")
+conn:eval("return coroutine.running() == coro")
+conn:eval("coro = coroutine.running() error('fail', 0)")
+conn:eval("return coroutine.running() == coro")
+coro = nil
+fiber = require('fiber')
+function echo(x) fiber.sleep(0.01) return x end
+ch = fiber.channel(100)
+for i = 1, 100 do fiber.create(function() ch:put(conn:call('echo', {i}) == i) end) end
+ok = true
+for i = 1, 100 do ok = ch:get() and ok end
+ok
+echo = nil
+--
+-- box.call_append() adds results before the returned values.
+--
+function stream_rows() box.call_append(1, {2, 3}) box.call_append(box.tuple.new(4, 5), {box.tuple.new(6)}) return 7 end
+conn:call("stream_rows")
+conn:eval("return stream_rows()")
+conn:call_16("stream_rows")
+function stream_error() box.call_append(1) error("stream error", 0) end
+conn:call("stream_error")
+conn:call("stream_rows")
+-- A value which can't be encoded doesn't corrupt the reply.
+function stream_bad() box.call_append(1) local ok = pcall(box.call_append, 2, {3, string.rep('x', 100000), function() end}) return ok, 4 end
+conn:call("stream_bad")
+conn:eval("return stream_bad()")
+conn:call_16("stream_bad")
+box.call_append(1)
+
 conn:close()
 require('msgpack').cfg { encode_sparse_safe = sparse_safe }
 
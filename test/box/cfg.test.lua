@@ -26,6 +26,13 @@ box.cfg{memtx_memory = "100500"}
 box.cfg{vinyl = "vinyl"}
 box.cfg{vinyl_write_threads = "threads"}
 
+-- memtx_defrag_threshold is a share of free memory
+box.cfg{memtx_defrag_threshold = 1}
+box.cfg{memtx_defrag_threshold = -0.5}
+box.cfg{memtx_defrag_threshold = 0.5}
+box.cfg.memtx_defrag_threshold
+box.cfg{memtx_defrag_threshold = 0}
+box.cfg{memtx_defrag_min_free = -1}
 
 --------------------------------------------------------------------------------
 -- Test of default cfg options
@@ -0,0 +1,79 @@
+test_run = require('test_run').new()
+--
+-- Space option field_map makes tuples store offsets of fields
+-- not used by indexes, so that such fields are accessed without
+-- decoding all the preceding ones. Check that fields are found
+-- correctly whatever offsets a tuple stores.
+--
+format = {}
+for i = 1, 60 do format[i] = {name = 'f' .. i, type = 'any'} end
+test_run:cmd("setopt delimiter ';'")
+function make_tuple(i)
+    local t = {i}
+    for j = 2, 60 do
+        if j == 30 then
+            t[j] = i * 7
+        elseif j == 45 then
+            t[j] = 's' .. i
+        elseif j % 3 == 0 then
+            t[j] = string.rep('x', j)
+        elseif j % 3 == 1 then
+            t[j] = {j, i}
+        else
+            t[j] = i * j
+        end
+    end
+    return t
+end;
+function field_equal(a, b)
+    if type(b) == 'table' then
+        return type(a) == 'table' and a[1] == b[1] and a[2] == b[2]
+    end
+    return a == b
+end;
+function check(s)
+    for i = 1, 100 do
+        local t = s:get(i)
+        local e = make_tuple(i)
+        for j = 1, 61 do
+            if not field_equal(t[j], e[j]) then
+                return {i, j}
+            end
+        end
+        if not field_equal(t.f40, e[40]) then
+            return {i, 'f40'}
+        end
+    end
+    return true
+end;
+spaces = {};
+for _, mode in ipairs({'indexed', 'sparse', 'full'}) do
+    local s = box.schema.space.create('test_' .. mode,
+                                      {field_map = mode, format = format})
+    s:create_index('pk')
+    s:create_index('sk', {parts = {30, 'unsigned', 45, 'string'}})
+    for i = 1, 100 do
+        s:insert(make_tuple(i))
+    end
+    spaces[mode] = s
+end;
+test_run:cmd("setopt delimiter ''");
+spaces.indexed.field_map
+spaces.sparse.field_map
+spaces.full.field_map
+check(spaces.indexed)
+check(spaces.sparse)
+check(spaces.full)
+spaces.sparse.index.sk:get{35, 's5'}[50] == spaces.indexed:get(5)[50]
+spaces.full.index.sk:get{35, 's5'}[50] == spaces.indexed:get(5)[50]
+spaces.full:update(5, {{'+', 50, 1}, {'=', 52, 'new'}})[50]
+spaces.full:get(5)[52]
+spaces.full:get(5)[51]:len()
+spaces.sparse:update(5, {{'+', 50, 1}, {'=', 52, 'new'}})[50]
+spaces.sparse:get(5)[52]
+spaces.sparse:get(5)[51]:len()
+for _, s in pairs(spaces) do s:drop() end
+
+-- Only memtx supports the option.
+box.schema.space.create('test', {field_map = 'dense'})
+box.schema.space.create('test', {engine = 'vinyl', field_map = 'full'})
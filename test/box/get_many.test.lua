@@ -0,0 +1,53 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- index:get_many() looks up a batch of keys in a unique index
+-- and returns a tuple or nil for each key in request order.
+--
+test_run:cmd("setopt delimiter ';'")
+function ids(res, count)
+    local ret = {}
+    for i = 1, count do
+        ret[i] = res[i] ~= nil and tostring(res[i][1]) or 'nil'
+    end
+    return table.concat(ret, ' ')
+end;
+test_run:cmd("setopt delimiter ''");
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {type = 'hash'})
+_ = s:create_index('tree', {parts = {2, 'unsigned'}})
+_ = s:create_index('multi', {parts = {3, 'unsigned'}, unique = false})
+
+s:get_many({})
+s:get_many({1, 2, 3})
+for i = 1, 1000 do s:insert{i, 2000 - i, i % 10} end
+
+ids(s:get_many({1, 1001, 500, {1000}, 0, 7}), 6)
+ids(s.index.tree:get_many({1999, 1, 1500, {1000}}), 4)
+
+-- results are the same as returned by get()
+keys = {}
+for i = 1, 2000, 3 do table.insert(keys, i) end
+res = s:get_many(keys)
+ok = true
+for i, key in ipairs(keys) do if res[i] ~= s:get(key) then ok = false end end
+ok
+
+-- errors
+s.index.multi:get_many({1})
+s:get_many({{1, 2}})
+s:get_many({'abc'})
+s:get_many(1)
+
+-- net.box
+box.schema.user.grant('guest', 'read', 'space', 'test')
+cn = require('net.box').connect(box.cfg.listen)
+ids(cn.space.test:get_many({1, 1001, 500, 0, 7}), 5)
+ids(cn.space.test.index.tree:get_many({1999, 1, 1500}), 3)
+cn.space.test.index.multi:get_many({1})
+cn:close()
+box.schema.user.revoke('guest', 'read', 'space', 'test')
+
+s:drop()
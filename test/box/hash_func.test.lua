@@ -0,0 +1,39 @@
+--
+-- A HASH index with hash_func = 'crc32c' hashes keys with
+-- CRC32C over 64-bit lanes instead of PMurHash.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk', {type = 'hash', hash_func = 'crc32c'})
+_ = s:create_index('sk', {type = 'hash', parts = {2, 'string', 3, 'integer'}, hash_func = 'crc32c'})
+s.index.pk.hash_func
+s.index.sk.hash_func
+for i = 1, 1000 do s:replace{i, 'str' .. i, -i} end
+s:count()
+s:get(10)
+s.index.sk:get{'str20', -20}
+s.index.sk:get{'str20', 20}
+s:delete(10)
+s:get(10)
+s.index.sk:get{'str10', -10}
+s:replace{10, 'a long string, longer than a single lane', 2^40}
+s.index.sk:get{'a long string, longer than a single lane', 2^40}
+
+-- Changing the option rebuilds the index.
+s.index.sk:alter{hash_func = 'murmur'}
+s.index.sk.hash_func
+s.index.sk:get{'str20', -20}
+s.index.sk:get{'a long string, longer than a single lane', 2^40}
+s.index.pk:alter{hash_func = 'murmur'}
+s:get(20)
+s:count()
+s:drop()
+
+-- Only memtx HASH indexes support hash_func.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+s:create_index('sk', {hash_func = 'crc32c'})
+s:create_index('sk', {type = 'hash', hash_func = 'xxhash'})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {hash_func = 'crc32c'})
+s:drop()
@@ -0,0 +1,57 @@
+net_box = require('net.box')
+--
+-- A connection can be switched to zstd compression of the
+-- traffic in both directions.
+--
+box.schema.user.create('test', {password = 'test'})
+box.schema.user.grant('test', 'read,write,execute', 'universe')
+opts = {user = 'test', password = 'test', compress = true}
+-- Compression is disabled by default.
+box.cfg.iproto_compression
+c = net_box.connect(box.cfg.listen, opts)
+c.state
+c.error
+box.cfg{iproto_compression = true}
+-- Only authenticated users can enable compression.
+c = net_box.connect(box.cfg.listen, {compress = true})
+c.state
+c.error
+c = net_box.connect(box.cfg.listen, {user = 'guest', compress = true})
+c.state
+c.error
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+compress_in = box.stat.net.COMPRESS_IN.total
+decompress_out = box.stat.net.DECOMPRESS_OUT.total
+c = net_box.connect(box.cfg.listen, opts)
+c.state
+c:ping()
+c.space.test:insert{1, 'a'}
+c.space.test:select{}
+c:call('box.space.test:count')
+-- A tuple, which is bigger than a compression chunk.
+big = string.rep('x', 1024 * 1024)
+#c.space.test:replace{2, big}[2]
+#c.space.test:get{2}[2]
+s:get{2}[2] == big
+-- SENT and RECEIVED count the compressed traffic.
+received = box.stat.net.RECEIVED.total
+_ = c.space.test:replace{3, big}
+box.stat.net.RECEIVED.total - received < #big / 10
+sent = box.stat.net.SENT.total
+_ = c.space.test:get{3}
+box.stat.net.SENT.total - sent < #big / 10
+-- Requests of several fibers are served.
+fiber = require('fiber')
+ch = fiber.channel(10)
+for i = 1, 10 do fiber.create(function() ch:put(c.space.test:replace{i + 10}) end) end
+for i = 1, 10 do ch:get() end
+c.space.test:count()
+box.stat.net.COMPRESS_IN.total > compress_in
+box.stat.net.DECOMPRESS_OUT.total > decompress_out
+-- Compressed output is smaller.
+box.stat.net.COMPRESS_OUT.total < box.stat.net.COMPRESS_IN.total
+c:close()
+s:drop()
+box.schema.user.drop('test')
+box.cfg{iproto_compression = false}
@@ -0,0 +1,64 @@
+net_box = require('net.box')
+--
+-- Server-side cursors fetch a big result set in chunks.
+--
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+for i = 1, 10 do s:replace{i, i % 3} end
+c = net_box.connect(box.cfg.listen)
+cur = c.space.test:cursor(nil, {chunk = 4})
+cur.state
+cur:fetch()
+cur.state, cur.id
+cur:fetch()
+-- The cursor is closed as soon as it is exhausted.
+cur:fetch()
+cur.state, cur.id
+cur:fetch()
+cur = c.space.test.index.sk:cursor(1, {iterator = 'GE', chunk = 3})
+cur:fetch()
+-- The cursor sees changes made between fetches.
+s:replace{11, 2}
+s:delete{7}
+cur:fetch()
+cur:close()
+cur.state
+cur:fetch()
+-- A cursor without chunk size returns all tuples at once.
+cur = c.space.test:cursor({5}, {iterator = 'LT'})
+cur:fetch()
+cur.state
+-- Errors.
+c.space.test:cursor('x'):fetch()
+c:_cursor_request('cursor_fetch', nil, 100, 1)
+c:_cursor_request('cursor_close', nil, 100)
+-- The number of open cursors is limited.
+cursors = {}
+for i = 1, 64 do cursors[i] = c.space.test:cursor(nil, {chunk = 1}) cursors[i]:fetch() end
+c.space.test:cursor(nil, {chunk = 1}):fetch()
+for i = 1, 64 do cursors[i]:close() end
+-- A cursor ends if its index is dropped.
+cur = c.space.test.index.sk:cursor(nil, {chunk = 1})
+#cur:fetch()
+s.index.sk:drop()
+cur:fetch()
+cur.state
+-- Idle cursors are closed after box.cfg.iproto_cursor_timeout.
+fiber = require('fiber')
+box.cfg.iproto_cursor_timeout
+box.cfg{iproto_cursor_timeout = 0}
+box.cfg{iproto_cursor_timeout = 0.1}
+cur = c.space.test:cursor(nil, {chunk = 1})
+#cur:fetch()
+cur.id
+fiber.sleep(0.5)
+cur:fetch()
+box.cfg{iproto_cursor_timeout = 60}
+-- Cursors are closed with the connection.
+cur = c.space.test:cursor(nil, {chunk = 1})
+#cur:fetch()
+c:close()
+s:drop()
+box.schema.user.revoke('guest', 'read,write,execute', 'universe')
@@ -0,0 +1,28 @@
+net_box = require('net.box')
+--
+-- A connection over a unix socket can move requests and replies
+-- to a shared memory channel.
+--
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+c = net_box.connect(box.cfg.listen, {shm = true})
+c.state
+c:ping()
+c.space.test:insert{1, 'a'}
+c.space.test:select{}
+c:call('box.space.test:count')
+-- A tuple, which is bigger than the ring, goes in parts.
+big = string.rep('x', 3 * 1024 * 1024)
+#c.space.test:replace{2, big}[2]
+#c.space.test:get{2}[2]
+s:get{2}[2] == big
+-- Requests of several fibers are served.
+fiber = require('fiber')
+ch = fiber.channel(10)
+for i = 1, 10 do fiber.create(function() ch:put(c.space.test:replace{i + 10}) end) end
+for i = 1, 10 do ch:get() end
+c.space.test:count()
+c:close()
+s:drop()
+box.schema.user.revoke('guest', 'read,write,execute', 'universe')
@@ -0,0 +1,91 @@
+env = require('test_run')
+test_run = env.new()
+--
+-- An index part can refer to a value nested in a map or an
+-- array field with a JSON path. A path with "[*]" makes a
+-- multikey index: a tuple is indexed by each item of the array.
+--
+test_run:cmd("setopt delimiter ';'")
+function ids(tuples)
+    local res = {}
+    for _, tuple in ipairs(tuples) do
+        table.insert(res, tuple[1])
+    end
+    return res
+end;
+test_run:cmd("setopt delimiter ''");
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+parts = {{2, 'string', path = 'name.first'}, {2, 'unsigned', path = '.age'}}
+sk = s:create_index('sk', {parts = parts, unique = false})
+sk.parts[1].path
+sk.parts[2].path
+_ = s:insert{1, {name = {first = 'Ivan', last = 'Ivanov'}, age = 30}}
+_ = s:insert{2, {name = {first = 'Anna'}, age = 25}}
+_ = s:insert{3, {name = {first = 'Ivan'}, age = 20}}
+ids(sk:select{'Ivan'})
+ids(sk:select({'Ivan', 25}, {iterator = 'GE'}))
+ids(sk:select({}, {iterator = 'LT'}))
+s:insert{4, {name = {first = 1}, age = 20}}
+s:insert{4, {name = 'Petr', age = 20}}
+s:insert{4, {name = {first = 'Petr'}}}
+s:insert{4, 'Petr'}
+_ = s:update(3, {{'=', 2, {name = {first = 'Anna'}, age = 20}}})
+ids(sk:select{'Anna'})
+ids(sk:select{'Ivan'})
+s:create_index('bad', {parts = {{2, 'string', path = '[1]'}}})
+s:create_index('bad', {parts = {{2, 'string', path = 'name..first'}}})
+s:create_index('bad', {parts = {{2, 'string', path = '[0]'}}})
+--
+-- A nullable path may be absent.
+--
+parts = {{2, 'string', path = 'name.last', is_nullable = true}}
+nk = s:create_index('nk', {parts = parts, unique = false})
+ids(nk:select{})
+ids(nk:select{box.NULL})
+_ = s:insert{4, {name = {first = 'Petr', last = 'Petrov'}, age = 40}}
+ids(nk:select{'Petrov'})
+s:insert{5, {name = {first = 'Petr', last = 5}, age = 40}}
+s:drop()
+--
+-- Multikey index.
+--
+s = box.schema.space.create('test')
+s:format({{'id', 'unsigned'}, {'tags', 'array'}})
+_ = s:create_index('pk')
+_ = s:insert{1, {'a', 'b'}}
+_ = s:insert{2, {'b', 'c', 'b'}}
+_ = s:insert{3, {}}
+tk = s:create_index('tk', {parts = {{'tags[*]', 'string'}}, unique = false})
+tk.parts[1].fieldno
+tk.parts[1].path
+tk:select{}
+tk:select{'b'}
+tk:count()
+s:create_index('uk', {parts = {{'tags[*]', 'string'}}})
+s:delete{2}
+uk = s:create_index('uk', {parts = {{'tags[*]', 'string'}}})
+uk:get{'b'}
+s:insert{4, {'c', 'a'}}
+tk:select{'c'}
+s:insert{4, {'c', 'd', 'c'}}
+uk:select{}
+s:replace{1, {'e'}}
+uk:get{'a'}
+uk:select{}
+s:update(4, {{'=', 2, {'a'}}})
+uk:select{}
+tk:count()
+s:insert{5, {'x', 1}}
+s:create_index('bad', {parts = {{2, 'string', path = 'a'}}})
+s:create_index('bad', {type = 'hash', parts = {{'tags[1]', 'string'}}})
+parts = {{2, 'string', path = '[*]'}, {3, 'string', path = '[*]'}}
+s:create_index('bad', {parts = parts, unique = false})
+s:drop()
+s = box.schema.space.create('test')
+s:create_index('pk', {parts = {{1, 'unsigned', path = '[*]'}}})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+s:create_index('sk', {parts = {{2, 'string', path = 'a'}}})
+s:drop()
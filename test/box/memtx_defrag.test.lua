@@ -0,0 +1,50 @@
+env = require('test_run')
+test_run = env.new()
+fiber = require('fiber')
+
+--
+-- Online defragmentation moves tuples to fewer slabs without
+-- changing the data, and gives the emptied slabs back.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'integer'}})
+pad = string.rep('x', 1000)
+-- Fill a few slabs, then leave a quarter of tuples in each.
+test_run:cmd("setopt delimiter ';'")
+box.begin()
+for i = 1, 16000 do
+    s:replace{i, -i, pad}
+    if i % 1000 == 0 then box.commit() box.begin() end
+end
+box.commit();
+box.begin()
+for i = 1, 16000 do
+    if i % 4 ~= 0 then s:delete{i} end
+    if i % 1000 == 0 then box.commit() box.begin() end
+end
+box.commit();
+function check()
+    local count = 0
+    for _, t in s:pairs() do
+        if t[1] % 4 ~= 0 or t[2] ~= -t[1] or t[3] ~= pad or
+           s.index.sk:get{-t[1]} ~= t then
+            return false
+        end
+        count = count + 1
+    end
+    return count == 4000 and s.index.sk:count() == 4000
+end;
+test_run:cmd("setopt delimiter ''");
+check()
+-- Tuples referenced from Lua aren't relocated.
+_ = collectgarbage('collect')
+stat = box.slab.defrag_info()
+box.cfg{memtx_defrag_min_free = 1024 * 1024, memtx_defrag_threshold = 0.25}
+while box.slab.defrag_info().reclaimed == stat.reclaimed do fiber.sleep(0.01) end
+box.cfg{memtx_defrag_threshold = 0}
+box.slab.defrag_info().relocated > stat.relocated
+box.slab.defrag_info().reclaimed > stat.reclaimed
+check()
+s:drop()
+box.cfg{memtx_defrag_min_free = 16 * 1024 * 1024}
@@ -91,6 +91,18 @@ for k, v in pairs(box.slab.info()) do
     table.insert(t, k)
 end;
 t;
+-- Pages and NUMA policy of the arena.
+box.slab.info().arena_huge_pages;
+box.slab.info().arena_numa_policy;
+box.slab.info().arena_huge_size >= 0;
+box.slab.info().huge_page_size >= 0;
+t = {};
+for k, v in pairs(box.slab.defrag_info()) do
+    table.insert(t, k)
+end;
+table.sort(t);
+t;
+box.slab.defrag_info().fragmentation >= 0;
 box.runtime.info().used > 0;
 box.runtime.info().maxalloc > 0;
 
@@ -754,6 +754,44 @@ box.schema.user.grant('guest','read,write,execute','universe')
 c = net.connect(box.cfg.listen)
 c:call("box.session.type")
 
+--
+-- Responses are decoded in C, tuples of a reply are made
+-- right from the MsgPack body.
+--
+s = box.schema.space.create('decode')
+_ = s:create_index('pk')
+for i = 1, 10 do s:replace{i, 'value ' .. i, {i, {x = i}}} end
+c = net.connect(box.cfg.listen)
+t = c.space.decode:get{1}
+box.tuple.is(t), t[1], t[2], t[3][2].x
+c.space.decode:get{100} == nil
+#c.space.decode:select{100}
+t = c.space.decode:select({9}, {iterator = 'GE'})
+#t, box.tuple.is(t[1]), t[2][1]
+-- CALL and EVAL return arbitrary values.
+function decode_values() return 1, 'two', {3, {4}}, nil, box.tuple.new{5} end
+v1, v2, v3, v4, v5 = c:call('decode_values')
+v1, v2, v3[2][1], v4 == nil, box.tuple.is(v5), v5[1]
+c:eval('return ...', {1, {2}, 'three'})
+c:eval('return')
+-- Errors.
+c.space.decode:insert{1}
+ok, err = pcall(c.space.decode.insert, c.space.decode, {1})
+ok, err.code == box.error.TUPLE_FOUND
+-- A reply, which is bigger than a read from the socket.
+big = string.rep('x', 1024 * 1024)
+_ = s:replace{11, big}
+c.space.decode:get{11}[2] == big
+-- Concurrent requests get their own replies.
+ch = fiber.channel(100)
+for i = 1, 100 do fiber.create(function() ch:put(c.space.decode:get{i % 10 + 1}[1] == i % 10 + 1) end) end
+ok = true
+for i = 1, 100 do ok = ch:get() and ok end
+ok
+c:close()
+decode_values = nil
+s:drop()
+
 -- cleanup
 c:close()
 box.schema.user.revoke('guest','read,write,execute','universe')
@@ -0,0 +1,142 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- A TREE index with covering = true stores a copy of the
+-- indexed fields next to each tuple pointer. Check that it
+-- orders tuples the same way as an ordinary TREE index and
+-- that select with keys_only returns the indexed fields.
+--
+s = box.schema.space.create('test')
+format = {}
+format[1] = {name = 'id', type = 'unsigned'}
+format[2] = {name = 'name', type = 'string'}
+format[3] = {name = 'val', type = 'unsigned', is_nullable = true}
+format[4] = {name = 'code', type = 'unsigned'}
+s:format(format)
+_ = s:create_index('pk')
+parts = {{field = 2, type = 'string'}, {field = 3, type = 'unsigned', is_nullable = true}}
+_ = s:create_index('sk', {parts = parts, unique = false, covering = true})
+_ = s:create_index('sk2', {parts = parts, unique = false})
+_ = s:create_index('uk', {parts = {4, 'unsigned'}, covering = true})
+s.index.sk.covering
+s.index.sk2.covering
+
+test_run:cmd("setopt delimiter ';'")
+function equal(a, b)
+    if #a ~= #b then
+        return false
+    end
+    for i = 1, #a do
+        if a[i][1] ~= b[i][1] then
+            return false
+        end
+    end
+    return true
+end;
+function equal_keys(keys, tuples, fields)
+    if #keys ~= #tuples then
+        return false
+    end
+    for i = 1, #keys do
+        if #keys[i] ~= #fields then
+            return false
+        end
+        for j, field in ipairs(fields) do
+            if keys[i][j] ~= tuples[i][field] then
+                return false
+            end
+        end
+    end
+    return true
+end;
+function check()
+    local types = {'EQ', 'REQ', 'GE', 'GT', 'LE', 'LT', 'ALL'}
+    local keys = {{}, {'n0'}, {'n5'}, {'n5', 3}, {'n9', 6}, {'z'}}
+    for _, t in ipairs(types) do
+        for _, key in ipairs(keys) do
+            local opts = {iterator = t, limit = 100}
+            local res = s.index.sk2:select(key, opts)
+            if not equal(s.index.sk:select(key, opts), res) then
+                return {t, key}
+            end
+            opts.keys_only = true
+            if not equal_keys(s.index.sk:select(key, opts), res,
+                              {2, 3, 1}) or
+               not equal_keys(s.index.sk2:select(key, opts), res,
+                              {2, 3, 1}) then
+                return {t, key, 'keys_only'}
+            end
+        end
+    end
+    local res = s.index.uk:select({}, {iterator = 'GE'})
+    if not equal_keys(s.index.uk:select({}, {keys_only = true}),
+                      res, {4}) then
+        return 'uk'
+    end
+    return true
+end;
+test_run:cmd("setopt delimiter ''");
+
+check()
+for i = 1, 500 do s:insert{i, 'n' .. (i % 17), i % 5 == 0 and box.NULL or i % 7, i * 7919 % 1009} end
+check()
+s.index.sk:select({'n1', 2}, {keys_only = true})
+s.index.uk:select({500}, {iterator = 'GE', limit = 3, keys_only = true})
+s.index.sk:bsize() > s.index.sk2:bsize()
+for i = 1, 500, 3 do s:delete{i} end
+check()
+for i = 2, 500, 5 do s:update({i}, {{'=', 3, i % 3}}) end
+check()
+for i = 1, 500, 3 do s:replace{i, 'n' .. (i % 13), i % 11, 1009 + i} end
+check()
+
+-- The index is rebuilt when the option is changed.
+s.index.sk:alter{covering = false}
+s.index.sk.covering
+check()
+s.index.sk2:alter{covering = true}
+s.index.sk2.covering
+check()
+s:drop()
+
+-- Building a covering index on a non-empty space.
+s = box.schema.space.create('test')
+s:format(format)
+_ = s:create_index('pk')
+for i = 1, 500 do s:insert{i, 'n' .. (i % 17), i % 5 == 0 and box.NULL or i % 7, i * 7919 % 1009} end
+_ = s:create_index('sk', {parts = parts, unique = false, covering = true})
+_ = s:create_index('sk2', {parts = parts, unique = false})
+_ = s:create_index('uk', {parts = {4, 'unsigned'}, covering = true})
+check()
+s:drop()
+
+-- Key copies that don't fit in a tree element are stored
+-- out of it. Mix short and long keys, combine covering with
+-- rank.
+s = box.schema.space.create('test')
+s:format(format)
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = parts, unique = false, covering = true, rank = true})
+_ = s:create_index('sk2', {parts = parts, unique = false})
+_ = s:create_index('uk', {parts = {4, 'unsigned'}, covering = true})
+for i = 1, 500 do s:insert{i, string.rep('n', i % 40) .. (i % 17), i % 5 == 0 and box.NULL or i % 7, i * 7919 % 1009} end
+check()
+s.index.sk:select({string.rep('n', 30) .. '8'}, {keys_only = true})
+for i = 1, 500, 3 do s:delete{i} end
+check()
+for i = 1, 500, 4 do s:replace{i, 'n' .. (i % 13), i % 11, 1009 + i} end
+check()
+key = {string.rep('n', 20)}
+s.index.sk:count(key, {iterator = 'GE'}) == s.index.sk2:count(key, {iterator = 'GE'})
+equal(s.index.sk:select(key, {iterator = 'LT', offset = 50, limit = 10}), s.index.sk2:select(key, {iterator = 'LT', offset = 50, limit = 10}))
+s:drop()
+
+-- Only memtx TREE indexes support covering.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+s:create_index('sk', {type = 'hash', covering = true})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {covering = true})
+s:drop()
@@ -0,0 +1,88 @@
+env = require('test_run')
+test_run = env.new()
+
+--
+-- A TREE index with rank = true maintains subtree element
+-- counts. Check that count(), select() with offset and alter
+-- give the same results as for an ordinary TREE index.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false, rank = true})
+_ = s:create_index('sk2', {parts = {2, 'unsigned'}, unique = false})
+s.index.sk.rank
+s.index.sk2.rank
+
+test_run:cmd("setopt delimiter ';'")
+function equal(a, b)
+    if #a ~= #b then
+        return false
+    end
+    for i = 1, #a do
+        if a[i][1] ~= b[i][1] then
+            return false
+        end
+    end
+    return true
+end;
+function check()
+    local types = {'EQ', 'REQ', 'GE', 'GT', 'LE', 'LT', 'ALL'}
+    local keys = {{}, {0}, {1}, {50}, {99}, {100}}
+    local offsets = {0, 1, 5, 9, 10, 11, 500, 999, 1000, 2000}
+    for _, t in ipairs(types) do
+        for _, key in ipairs(keys) do
+            if s.index.sk:count(key, {iterator = t}) ~=
+               s.index.sk2:count(key, {iterator = t}) then
+                return {t, key}
+            end
+            for _, offset in ipairs(offsets) do
+                local opts = {iterator = t, offset = offset, limit = 3}
+                if not equal(s.index.sk:select(key, opts),
+                             s.index.sk2:select(key, opts)) then
+                    return {t, key, offset}
+                end
+            end
+        end
+    end
+    return true
+end;
+test_run:cmd("setopt delimiter ''");
+
+check()
+for i = 1, 1000 do s:insert{i, i * 7919 % 100} end
+check()
+s.index.sk:count({50}, {iterator = 'LT'})
+s.index.sk:select({50}, {iterator = 'GE', offset = 25, limit = 2})
+s.index.sk:select({50}, {iterator = 'LE', offset = 9, limit = 2})
+s.index.sk:select({50}, {iterator = 'EQ', offset = 10})
+for i = 1, 1000, 3 do s:delete{i} end
+check()
+for i = 2, 1000, 5 do s:update({i}, {{'=', 2, i % 10}}) end
+check()
+
+-- The index is rebuilt when the option is changed.
+s.index.sk:alter{rank = false}
+s.index.sk.rank
+check()
+s.index.sk2:alter{rank = true}
+s.index.sk2.rank
+check()
+s:drop()
+
+-- Building an index with rank on a non-empty space.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 1000 do s:insert{i, i * 7919 % 100} end
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false, rank = true})
+_ = s:create_index('sk2', {parts = {2, 'unsigned'}, unique = false})
+check()
+s:drop()
+
+-- Only memtx TREE indexes support rank.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+s:create_index('sk', {type = 'hash', rank = true})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {rank = true})
+s:drop()
@@ -0,0 +1,70 @@
+test_run = require('test_run').new()
+--
+-- UPDATE, which changes field values keeping their sizes, patches
+-- a copy of the old tuple, or the old tuple itself if nobody else
+-- references it and no indexed field is changed.
+--
+s = box.schema.space.create('test')
+pk = s:create_index('pk')
+sk = s:create_index('sk', {parts = {2, 'unsigned'}})
+s:replace{1, 10, 1000, 'abc', 1.5}
+stat = box.stat.memtx
+test_run:cmd("setopt delimiter ';'")
+function hits()
+    return {stat.UPDATE_PATCH.total, stat.UPDATE_IN_PLACE.total}
+end;
+function diff(a, b)
+    return {b[1] - a[1], b[2] - a[2]}
+end;
+-- Return the number of patched copies and in place updates.
+function update(key, ops)
+    collectgarbage('collect')
+    local h = hits()
+    s:update(key, ops)
+    return diff(h, hits())
+end;
+test_run:cmd("setopt delimiter ''");
+
+-- In place.
+update(1, {{'+', 3, 1}})
+update(1, {{'=', 4, 'xyz'}, {'+', 5, 1}})
+s:get(1)
+-- An indexed field is changed.
+update(1, {{'+', 2, 1}})
+sk:get(10)
+sk:get(11)
+-- Field size is changed.
+update(1, {{'+', 3, 100000}})
+update(1, {{'!', 4, 'abc'}})
+update(1, {{'#', 4, 1}})
+s:get(1)
+-- The old tuple is referenced.
+t = s:get(1)
+update(1, {{'+', 3, 1}})
+t
+s:get(1)
+t = nil
+-- The field type is checked.
+update(1, {{'=', 2, -1}})
+s:get(1)
+
+-- Rollback restores the tuple updated in place.
+collectgarbage('collect')
+h = hits()
+box.begin() s:update(1, {{'+', 3, 1}}) s:update(1, {{'=', 4, 'abc'}}) box.rollback()
+diff(h, hits())
+s:get(1)
+sk:get(11)
+
+-- on_replace triggers get the old tuple.
+test_run:cmd("setopt delimiter ';'")
+function trig(old, new)
+    trig_result = {old[3], new[3]}
+end;
+test_run:cmd("setopt delimiter ''");
+_ = s:on_replace(trig)
+update(1, {{'-', 3, 1}})
+trig_result
+s:on_replace(nil, trig)
+s:get(1)
+s:drop()
@@ -195,12 +195,112 @@ void test_get_set()
 	footer();
 }
 
+static void
+check_bitset(struct bitset *bm, const bool *ref, size_t size)
+{
+	size_t cardinality = 0;
+	for (size_t i = 0; i < size; i++) {
+		fail_unless(bitset_test(bm, i) == ref[i]);
+		cardinality += ref[i];
+	}
+	fail_unless(bitset_cardinality(bm) == cardinality);
+}
+
+static
+void test_containers()
+{
+	header();
+
+	enum { PAGE_BIT = 1 << 16, SIZE = 4 * PAGE_BIT };
+	bool *ref = calloc(SIZE, sizeof(*ref));
+	fail_if(ref == NULL);
+
+	struct bitset bm;
+	bitset_create(&bm, realloc);
+	struct bitset_info info;
+
+	/* Page 0: sparse values */
+	for (size_t i = 0; i < PAGE_BIT; i += 101) {
+		fail_if(bitset_set(&bm, i) != 0);
+		ref[i] = true;
+	}
+	/* Page 1: dense random values */
+	for (size_t i = 0; i < PAGE_BIT / 2; i++) {
+		size_t pos = PAGE_BIT + rand() % PAGE_BIT;
+		fail_if(bitset_set(&bm, pos) < 0);
+		ref[pos] = true;
+	}
+	/* Page 2: a few long runs */
+	for (size_t i = 0; i < PAGE_BIT; i++) {
+		if (i % 10000 < 7000) {
+			fail_if(bitset_set(&bm, 2 * PAGE_BIT + i) != 0);
+			ref[2 * PAGE_BIT + i] = true;
+		}
+	}
+	/* Page 3: all ones */
+	for (size_t i = 0; i < PAGE_BIT; i++) {
+		fail_if(bitset_set(&bm, 3 * PAGE_BIT + i) != 0);
+		ref[3 * PAGE_BIT + i] = true;
+	}
+	check_bitset(&bm, ref, SIZE);
+
+	bitset_info(&bm, &info);
+	fail_unless(info.page_bit == PAGE_BIT);
+	fail_unless(info.pages == 4);
+	fail_unless(info.array_pages == 1);
+	fail_unless(info.bitmap_pages == 1);
+	fail_unless(info.run_pages == 2);
+	/* Run pages take much less memory than bitmaps */
+	fail_unless(info.mem_total < 4 * info.page_data_size);
+
+	/* Split runs */
+	for (size_t i = 3 * PAGE_BIT + 1; i < SIZE; i += 2) {
+		fail_if(bitset_clear(&bm, i) != 1);
+		ref[i] = false;
+	}
+	/* Punch holes in runs */
+	for (size_t i = 2 * PAGE_BIT; i < 3 * PAGE_BIT; i += 3) {
+		fail_if(bitset_clear(&bm, i) < 0);
+		ref[i] = false;
+	}
+	check_bitset(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 4);
+	fail_unless(info.array_pages == 1);
+	fail_unless(info.bitmap_pages == 3);
+
+	/* Make dense pages sparse again */
+	for (size_t i = PAGE_BIT; i < SIZE; i++) {
+		if (ref[i] && i % 64 != 0) {
+			fail_if(bitset_clear(&bm, i) != 1);
+			ref[i] = false;
+		}
+	}
+	check_bitset(&bm, ref, SIZE);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 4);
+	fail_unless(info.array_pages == 4);
+
+	for (size_t i = 0; i < SIZE; i++)
+		fail_if(bitset_clear(&bm, i) != ref[i]);
+	fail_unless(bitset_cardinality(&bm) == 0);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 0);
+	fail_unless(info.mem_total == 0);
+
+	bitset_destroy(&bm);
+	free(ref);
+
+	footer();
+}
+
 int main(int argc, char *argv[])
 {
 	setbuf(stdout, NULL);
 	srand(time(NULL));
 	test_cardinality();
 	test_get_set();
+	test_containers();
 
 	return 0;
 }
@@ -474,6 +474,69 @@ void test_disjunction()
 	footer();
 }
 
+static
+void test_containers_count()
+{
+	header();
+
+	enum { BITSETS_SIZE = 3, PAGE_BIT = 1 << 16, SIZE = 4 * PAGE_BIT };
+	struct bitset **bitsets = bitsets_create(BITSETS_SIZE);
+
+	/*
+	 * Fill bitsets so that their pages are stored in containers
+	 * of different types: sparse, dense, runs.
+	 */
+	for (size_t pos = 0; pos < SIZE; pos++) {
+		size_t page = pos / PAGE_BIT;
+		if ((page % 2 == 0 && pos % 97 == 0) ||
+		    (page % 2 == 1 && rand() % 2 == 0))
+			bitset_set(bitsets[0], pos);
+		if ((page < 2 && pos % 5000 < 3000) ||
+		    (page >= 2 && pos % 113 == 0))
+			bitset_set(bitsets[1], pos);
+		if (page != 1 && rand() % 3 == 0)
+			bitset_set(bitsets[2], pos);
+	}
+
+	/* (b0 AND b1 AND NOT b2) OR (b1 AND b2) */
+	struct bitset_expr expr;
+	bitset_expr_create(&expr, realloc);
+	fail_unless(bitset_expr_add_conj(&expr) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 0, false) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 1, false) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 2, true) == 0);
+	fail_unless(bitset_expr_add_conj(&expr) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 1, false) == 0);
+	fail_unless(bitset_expr_add_param(&expr, 2, false) == 0);
+
+	struct bitset_iterator it;
+	bitset_iterator_create(&it, realloc);
+	fail_unless(bitset_iterator_init(&it, &expr, bitsets,
+					 BITSETS_SIZE) == 0);
+	bitset_expr_destroy(&expr);
+
+	size_t count = 0;
+	for (size_t pos = 0; pos < SIZE; pos++) {
+		bool b0 = bitset_test(bitsets[0], pos);
+		bool b1 = bitset_test(bitsets[1], pos);
+		bool b2 = bitset_test(bitsets[2], pos);
+		if (!((b0 && b1 && !b2) || (b1 && b2)))
+			continue;
+		fail_unless(bitset_iterator_next(&it) == pos);
+		count++;
+	}
+	fail_unless(bitset_iterator_next(&it) == SIZE_MAX);
+
+	fail_unless(bitset_iterator_count(&it) == count);
+	/* The iterator is rewound by count */
+	fail_unless(bitset_iterator_next(&it) != SIZE_MAX);
+
+	bitset_iterator_destroy(&it);
+	bitsets_destroy(bitsets, BITSETS_SIZE);
+
+	footer();
+}
+
 int main(void)
 {
 	setbuf(stdout, NULL);
@@ -489,6 +552,7 @@ int main(void)
 	test_not_empty();
 	test_not_last();
 	test_disjunction();
+	test_containers_count();
 
 	return 0;
 }
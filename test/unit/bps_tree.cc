@@ -70,6 +70,52 @@ compare(type_t a, type_t b);
 #define bps_tree_key_t uint32_t
 #define bps_tree_arg_t int
 #include "salad/bps_tree.h"
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+
+/* tree with order statistics */
+#define BPS_TREE_NAME card
+#define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
+#define BPS_TREE_EXTENT_SIZE 2048 /* value is to low specially for tests */
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define bps_tree_elem_t type_t
+#define bps_tree_key_t type_t
+#define bps_tree_arg_t int
+#define BPS_INNER_CARD
+#include "salad/bps_tree.h"
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+#undef BPS_INNER_CARD
+
+/* tree of elements with a payload ignored by comparison */
+struct payload_elem {
+	type_t key;
+	type_t payload;
+};
+
+#define BPS_TREE_NAME payload
+#define BPS_TREE_BLOCK_SIZE 128 /* value is to low specially for tests */
+#define BPS_TREE_EXTENT_SIZE 2048 /* value is to low specially for tests */
+#define BPS_TREE_COMPARE(a, b, arg) compare((a).key, (b).key)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare((a).key, b)
+#define bps_tree_elem_t struct payload_elem
+#define bps_tree_key_t type_t
+#define bps_tree_arg_t int
+#define BPS_TREE_NO_DEBUG
+#include "salad/bps_tree.h"
 
 #define bps_insert_and_check(tree_name, tree, elem, replaced) \
 {\
@@ -792,6 +838,139 @@ insert_get_iterator()
 	footer();
 }
 
+static void
+delete_get_test()
+{
+	header();
+
+	const type_t count = 5000;
+	payload tree;
+	payload_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	for (type_t i = 0; i < count; i++) {
+		struct payload_elem elem = { i, -i };
+		if (payload_insert(&tree, elem, NULL) != 0)
+			fail("insert failed", "true");
+	}
+	for (type_t i = 0; i < count; i += 2) {
+		struct payload_elem elem = { i, 0 };
+		struct payload_elem deleted = { 0, 0 };
+		if (payload_delete_get(&tree, elem, &deleted) != 0)
+			fail("element not found", "true");
+		if (deleted.key != i || deleted.payload != -i)
+			fail("wrong element deleted", "true");
+	}
+	for (type_t i = 0; i < count; i++) {
+		struct payload_elem *found = payload_find(&tree, i);
+		if ((found != NULL) != (i % 2 != 0))
+			fail("unexpected find result", "true");
+		if (found != NULL && found->payload != -i)
+			fail("wrong payload", "true");
+	}
+	struct payload_elem elem = { 0, 0 };
+	struct payload_elem deleted;
+	if (payload_delete_get(&tree, elem, &deleted) == 0)
+		fail("deleted a missing element", "true");
+	if (payload_size(&tree) != (size_t)count / 2)
+		fail("wrong tree size", "true");
+	payload_destroy(&tree);
+
+	footer();
+}
+
+static void
+card_check_offsets(card *tree, const bool *present, type_t range)
+{
+	if (card_debug_check(tree)) {
+		card_print(tree, TYPE_F);
+		fail("debug check nonzero", "true");
+	}
+	size_t count = 0;
+	for (type_t v = 0; v < range; v++) {
+		size_t offset;
+		card_iterator itr = card_lower_bound_get_offset(tree, v, NULL,
+								&offset);
+		if (offset != count)
+			fail("lower bound offset mismatch", "true");
+		if (present[v]) {
+			type_t *elem = card_iterator_get_elem(tree, &itr);
+			if (elem == NULL || *elem != v)
+				fail("lower bound mismatch", "true");
+			itr = card_iterator_at(tree, count);
+			elem = card_iterator_get_elem(tree, &itr);
+			if (elem == NULL || *elem != v)
+				fail("iterator at offset mismatch", "true");
+			count++;
+		}
+		card_upper_bound_get_offset(tree, v, NULL, &offset);
+		if (offset != count)
+			fail("upper bound offset mismatch", "true");
+	}
+	if (count != card_size(tree))
+		fail("tree size mismatch", "true");
+	card_iterator itr = card_iterator_at(tree, count);
+	if (!card_iterator_is_invalid(&itr))
+		fail("iterator past the end is valid", "true");
+}
+
+static void
+card_test()
+{
+	header();
+
+	const type_t range = 3000;
+	const int rounds = 20000;
+	bool present[range];
+	memset(present, 0, sizeof(present));
+
+	card tree;
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	card_enable_card(&tree);
+	for (int i = 0; i < rounds; i++) {
+		type_t v = rand() % range;
+		/* Grow the tree in the first half, shrink in the second. */
+		bool insert = rand() % 4 != 0;
+		if (i >= rounds / 2)
+			insert = !insert;
+		if (insert) {
+			if (card_insert(&tree, v, NULL) != 0)
+				fail("insert failed", "true");
+			present[v] = true;
+		} else {
+			card_delete(&tree, v);
+			present[v] = false;
+		}
+		if (i % 1000 == 0)
+			card_check_offsets(&tree, present, range);
+		else if (card_debug_check(&tree))
+			fail("debug check nonzero", "true");
+	}
+	card_check_offsets(&tree, present, range);
+	card_destroy(&tree);
+
+	/* Counters of a tree built from an array. */
+	type_t arr[range];
+	for (type_t v = 0; v < range; v++) {
+		arr[v] = v;
+		present[v] = true;
+	}
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	card_enable_card(&tree);
+	if (card_build(&tree, arr, range) != 0)
+		fail("building failed", "true");
+	card_check_offsets(&tree, present, range);
+	card_destroy(&tree);
+
+	/* Counters enabled for a non-empty tree. */
+	card_create(&tree, 0, extent_alloc, extent_free, &extents_count);
+	for (type_t v = range - 1; v >= 0; v--)
+		card_insert(&tree, v, NULL);
+	card_enable_card(&tree);
+	card_check_offsets(&tree, present, range);
+	card_destroy(&tree);
+
+	footer();
+}
+
 int
 main(void)
 {
@@ -803,6 +982,8 @@ main(void)
 	printing_test();
 	white_box_test();
 	approximate_count();
+	card_test();
+	delete_get_test();
 	if (extents_count != 0)
 		fail("memory leak!", "true");
 	insert_get_iterator();
@@ -8,6 +8,7 @@
 #include "memory.h"
 #include "fiber.h"
 #include "cbus.h"
+#include "clock.h"
 #include "unit.h"
 
 /*
@@ -128,7 +129,11 @@ thread_create(struct thread *t, int id)
 	if (cord_costart(&t->cord, t->name, thread_func, t) != 0)
 		unreachable();
 
-	cpipe_create(&t->thread_pipe, t->name);
+	/* Test both kinds of pipes. */
+	if (id % 2 == 0)
+		cpipe_create(&t->thread_pipe, t->name);
+	else
+		cpipe_create_spsc(&t->thread_pipe, t->name);
 }
 
 static int
@@ -312,7 +317,10 @@ thread_func(va_list ap)
 {
 	struct thread *t = va_arg(ap, struct thread *);
 
-	cpipe_create(&t->main_pipe, "main");
+	if (t->id % 2 == 0)
+		cpipe_create(&t->main_pipe, "main");
+	else
+		cpipe_create_spsc(&t->main_pipe, "main");
 
 	struct cbus_endpoint endpoint;
 	cbus_endpoint_create(&endpoint, t->name,
@@ -325,6 +333,132 @@ thread_func(va_list ap)
 	return 0;
 }
 
+/*
+ * Benchmark: bounce messages between the main thread and
+ * a benchmark thread, with many messages in flight to measure
+ * throughput and with one message in flight to measure the
+ * round trip latency. Timings are printed to stderr so that
+ * the test output stays stable.
+ */
+
+/* Number of messages to bounce in the throughput benchmark. */
+static const int bench_msg_count = 1000000;
+
+/* Number of round trips in the latency benchmark. */
+static const int bench_rtt_count = 20000;
+
+/* Max number of messages in flight in the throughput benchmark. */
+static const int bench_window = 1024;
+
+/* Pipe from the main to the benchmark thread. */
+static struct cpipe bench_pipe;
+/* Pipe from the benchmark to the main thread. */
+static struct cpipe bench_reply_pipe;
+
+/* Number of messages sent and returned in the current run. */
+static int bench_sent, bench_done;
+/* Number of messages to send in the current run. */
+static int bench_total;
+
+static void
+bench_msg_send(struct cmsg *msg);
+
+static void
+bench_msg_perform_cb(struct cmsg *msg)
+{
+	(void)msg;
+}
+
+static void
+bench_msg_done_cb(struct cmsg *msg)
+{
+	bench_done++;
+	if (bench_sent < bench_total)
+		bench_msg_send(msg);
+	else
+		free(msg);
+}
+
+static void
+bench_msg_send(struct cmsg *msg)
+{
+	static const struct cmsg_hop route[] = {
+		{ bench_msg_perform_cb, &bench_reply_pipe },
+		{ bench_msg_done_cb, NULL },
+	};
+	cmsg_init(msg, route);
+	cpipe_push(&bench_pipe, msg);
+	bench_sent++;
+}
+
+static int
+bench_thread_func(va_list ap)
+{
+	bool is_spsc = va_arg(ap, int);
+
+	if (is_spsc)
+		cpipe_create_spsc(&bench_reply_pipe, "main");
+	else
+		cpipe_create(&bench_reply_pipe, "main");
+
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, "bench", fiber_schedule_cb, fiber());
+
+	cbus_loop(&endpoint);
+
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	cpipe_destroy(&bench_reply_pipe);
+	return 0;
+}
+
+/* Bounce @count messages with @window of them in flight. */
+static double
+bench_run(struct cbus_endpoint *endpoint, int count, int window)
+{
+	bench_sent = bench_done = 0;
+	bench_total = count;
+	double start = clock_monotonic();
+	for (int i = 0; i < window; i++) {
+		struct cmsg *msg = malloc(sizeof(*msg));
+		assert(msg != NULL);
+		bench_msg_send(msg);
+	}
+	while (bench_done < count) {
+		cbus_process(endpoint);
+		if (bench_done < count)
+			fiber_yield();
+	}
+	assert(bench_sent == count);
+	return clock_monotonic() - start;
+}
+
+static void
+bench(struct cbus_endpoint *endpoint, bool is_spsc)
+{
+	struct cord cord;
+	if (cord_costart(&cord, "bench", bench_thread_func, is_spsc) != 0)
+		unreachable();
+	if (is_spsc)
+		cpipe_create_spsc(&bench_pipe, "bench");
+	else
+		cpipe_create(&bench_pipe, "bench");
+
+	const char *name = is_spsc ? "spsc" : "mutex";
+	double t = bench_run(endpoint, bench_msg_count, bench_window);
+	fprintf(stderr, "%-6s throughput: %.0f msg/sec\n", name,
+		bench_msg_count / t);
+	t = bench_run(endpoint, bench_rtt_count, 1);
+	fprintf(stderr, "%-6s round trip: %.2f usec\n", name,
+		t / bench_rtt_count * 1e6);
+
+	cbus_stop_loop(&bench_pipe);
+	cpipe_destroy(&bench_pipe);
+	if (cord_join(&cord) != 0)
+		unreachable();
+	/* Process the poison of the reply pipe. */
+	cbus_process(endpoint);
+}
+
 static int
 main_func(va_list ap)
 {
@@ -333,6 +467,9 @@ main_func(va_list ap)
 	struct cbus_endpoint endpoint;
 	cbus_endpoint_create(&endpoint, "main", fiber_schedule_cb, fiber());
 
+	bench(&endpoint, false);
+	bench(&endpoint, true);
+
 	threads = calloc(thread_count, sizeof(*threads));
 	assert(threads != NULL);
 
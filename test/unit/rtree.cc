@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 #include <inttypes.h>
 
@@ -276,12 +277,223 @@ neighbor_test()
 	footer();
 }
 
+static void
+rtree_test_random_rect(struct rtree_rect *rect, double size)
+{
+	double x = rand() % 1000, y = rand() % 1000;
+	double w = rand() * size / RAND_MAX, h = rand() * size / RAND_MAX;
+	rtree_set2d(rect, x, y, x + w, y + h);
+}
+
+static size_t
+rtree_test_collect(struct rtree *tree, const struct rtree_rect *rect,
+		   enum spatial_search_op op, record_t *res)
+{
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+	size_t count = 0;
+	rtree_search(tree, rect, op, &iterator);
+	record_t rec;
+	while ((rec = rtree_iterator_next(&iterator)) != NULL)
+		res[count++] = rec;
+	rtree_iterator_destroy(&iterator);
+	return count;
+}
+
+static int
+rtree_test_record_cmp(const void *a, const void *b)
+{
+	record_t r1 = *(const record_t *)a, r2 = *(const record_t *)b;
+	return r1 < r2 ? -1 : r1 > r2 ? 1 : 0;
+}
+
+static double
+rtree_test_distance(const struct rtree_rect *rect,
+		    const struct rtree_rect *point)
+{
+	double result = 0;
+	for (int i = 0; i < 2; i++) {
+		double c = point->coords[2 * i], d = 0;
+		if (c < rect->coords[2 * i])
+			d = rect->coords[2 * i] - c;
+		else if (c > rect->coords[2 * i + 1])
+			d = c - rect->coords[2 * i + 1];
+		result += d * d;
+	}
+	return result;
+}
+
+static bool
+rtree_test_neighbor_order(const struct rtree_rect *arr,
+			  const struct rtree_rect *point,
+			  const record_t *res, size_t count)
+{
+	for (size_t i = 1; i < count; i++) {
+		const struct rtree_rect *prev = &arr[(size_t)res[i - 1] - 1];
+		const struct rtree_rect *curr = &arr[(size_t)res[i] - 1];
+		if (rtree_test_distance(prev, point) >
+		    rtree_test_distance(curr, point))
+			return false;
+	}
+	return true;
+}
+
+static void
+rtree_test_check_equal(struct rtree *tree1, struct rtree *tree2,
+		       const struct rtree_rect *arr, size_t count)
+{
+	static const enum spatial_search_op ops[] = {
+		SOP_ALL, SOP_EQUALS, SOP_CONTAINS, SOP_STRICT_CONTAINS,
+		SOP_OVERLAPS, SOP_BELONGS, SOP_STRICT_BELONGS
+	};
+	record_t *res1 = (record_t *)malloc((count + 1) * sizeof(record_t));
+	record_t *res2 = (record_t *)malloc((count + 1) * sizeof(record_t));
+	for (int i = 0; i < 100; i++) {
+		struct rtree_rect rect;
+		rtree_test_random_rect(&rect, 200);
+		for (size_t j = 0; j < sizeof(ops) / sizeof(ops[0]); j++) {
+			size_t n1 = rtree_test_collect(tree1, &rect,
+						       ops[j], res1);
+			size_t n2 = rtree_test_collect(tree2, &rect,
+						       ops[j], res2);
+			if (n1 != n2)
+				fail("search result count", "false");
+			qsort(res1, n1, sizeof(record_t), rtree_test_record_cmp);
+			qsort(res2, n2, sizeof(record_t), rtree_test_record_cmp);
+			if (memcmp(res1, res2, n1 * sizeof(record_t)) != 0)
+				fail("search result", "false");
+		}
+		/*
+		 * Records at equal distances may be returned in
+		 * any order, so check the order and the set.
+		 */
+		size_t n1 = rtree_test_collect(tree1, &rect,
+					       SOP_NEIGHBOR, res1);
+		size_t n2 = rtree_test_collect(tree2, &rect,
+					       SOP_NEIGHBOR, res2);
+		if (n1 != count || n2 != count)
+			fail("neighbor search result count", "false");
+		if (!rtree_test_neighbor_order(arr, &rect, res1, n1) ||
+		    !rtree_test_neighbor_order(arr, &rect, res2, n2))
+			fail("neighbor search order", "false");
+		qsort(res1, n1, sizeof(record_t), rtree_test_record_cmp);
+		qsort(res2, n2, sizeof(record_t), rtree_test_record_cmp);
+		if (memcmp(res1, res2, n1 * sizeof(record_t)) != 0)
+			fail("neighbor search result", "false");
+	}
+	free(res1);
+	free(res2);
+}
+
+static void
+bulk_load_test()
+{
+	header();
+
+	const size_t counts[] = {0, 1, 5, 36, 37, 1000, 10000};
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		size_t count = counts[c];
+		srand(count);
+		struct rtree_rect *arr = (struct rtree_rect *)
+			malloc((count + 1) * sizeof(*arr));
+		for (size_t i = 0; i < count; i++)
+			rtree_test_random_rect(&arr[i], 20);
+
+		struct rtree tree1, tree2;
+		rtree_init(&tree1, 2, extent_size,
+			   extent_alloc, extent_free, &page_count,
+			   RTREE_EUCLID);
+		rtree_init(&tree2, 2, extent_size,
+			   extent_alloc, extent_free, &page_count,
+			   RTREE_EUCLID);
+		rtree_test_build(&tree1, arr, count);
+		if (rtree_build_reserve(&tree2, count / 2) != 0)
+			fail("build reserve", "false");
+		for (size_t i = 0; i < count; i++) {
+			record_t rec = (record_t)(i + 1);
+			if (rtree_build_add(&tree2, &arr[i], rec) != 0)
+				fail("build add", "false");
+		}
+		rtree_build_end(&tree2);
+		if (rtree_number_of_records(&tree2) != count)
+			fail("Tree count mismatch (1)", "true");
+		if (rtree_used_size(&tree2) > rtree_used_size(&tree1))
+			fail("bulk loaded tree is bigger", "true");
+		rtree_test_check_equal(&tree1, &tree2, arr, count);
+
+		/* Modify the bulk loaded tree. */
+		for (size_t i = 0; i < count; i += 2) {
+			record_t rec = (record_t)(i + 1);
+			if (!rtree_remove(&tree1, &arr[i], rec) ||
+			    !rtree_remove(&tree2, &arr[i], rec))
+				fail("delete element in tree", "false");
+		}
+		rtree_test_check_equal(&tree1, &tree2, arr, count / 2);
+		for (size_t i = 0; i < count; i += 2) {
+			record_t rec = (record_t)(i + 1);
+			rtree_insert(&tree1, &arr[i], rec);
+			rtree_insert(&tree2, &arr[i], rec);
+		}
+		if (rtree_number_of_records(&tree2) != count)
+			fail("Tree count mismatch (2)", "true");
+		rtree_test_check_equal(&tree1, &tree2, arr, count);
+
+		rtree_destroy(&tree1);
+		rtree_destroy(&tree2);
+		free(arr);
+	}
+
+	footer();
+}
+
+/*
+ * Bulk load points with lots of duplicate coordinates, which
+ * make the Sort-Tile-Recursive tiles break ties.
+ */
+static void
+bulk_load_points_test()
+{
+	header();
+
+	const size_t count = 5000;
+	srand(0);
+	struct rtree_rect *arr = (struct rtree_rect *)
+		malloc(count * sizeof(*arr));
+	for (size_t i = 0; i < count; i++)
+		rtree_set2dp(&arr[i], rand() % 50 * 20, rand() % 50 * 20);
+
+	struct rtree tree1, tree2;
+	rtree_init(&tree1, 2, extent_size, extent_alloc, extent_free,
+		   &page_count, RTREE_EUCLID);
+	rtree_init(&tree2, 2, extent_size, extent_alloc, extent_free,
+		   &page_count, RTREE_EUCLID);
+	rtree_test_build(&tree1, arr, count);
+	for (size_t i = 0; i < count; i++) {
+		record_t rec = (record_t)(i + 1);
+		if (rtree_build_add(&tree2, &arr[i], rec) != 0)
+			fail("build add", "false");
+	}
+	rtree_build_end(&tree2);
+	if (rtree_number_of_records(&tree2) != count)
+		fail("Tree count mismatch", "true");
+	if (rtree_used_size(&tree2) >= rtree_used_size(&tree1))
+		fail("bulk loaded tree is not smaller", "true");
+	rtree_test_check_equal(&tree1, &tree2, arr, count);
+
+	rtree_destroy(&tree1);
+	rtree_destroy(&tree2);
+	free(arr);
+
+	footer();
+}
 
 int
 main(void)
 {
 	simple_check();
 	neighbor_test();
+	bulk_load_test();
+	bulk_load_points_test();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "unit.h"
+#include "memory.h"
+#include "fiber.h"
+#include "tuple.h"
+#include "tuple_compare.h"
+#include "tuple_hash.h"
+#include "key_def.h"
+#include "msgpuck.h"
+
+/*
+ * Check on typical key shapes, which have precompiled
+ * comparators and hashers, that the comparator chosen for a
+ * key definition orders tuples the same way as the generic key
+ * comparator, and that a precompiled hasher agrees with the
+ * generic one.
+ */
+
+enum {
+	TUPLE_COUNT = 1000,
+	FIELD_COUNT = 4,
+	CHECK_COUNT = 20000,
+	MAX_PARTS = 4,
+};
+
+struct key_shape {
+	const char *name;
+	uint32_t part_count;
+	uint32_t fieldno[MAX_PARTS];
+	enum field_type type[MAX_PARTS];
+	bool is_nullable[MAX_PARTS];
+};
+
+static const struct key_shape shapes[] = {
+	{"unsigned", 1, {0}, {FIELD_TYPE_UNSIGNED}, {false}},
+	{"string", 1, {0}, {FIELD_TYPE_STRING}, {false}},
+	{"integer", 1, {0}, {FIELD_TYPE_INTEGER}, {false}},
+	{"number", 1, {0}, {FIELD_TYPE_NUMBER}, {false}},
+	{"scalar", 1, {0}, {FIELD_TYPE_SCALAR}, {false}},
+	{"nullable unsigned", 1, {0}, {FIELD_TYPE_UNSIGNED}, {true}},
+	{"unsigned, string", 2, {0, 1},
+	 {FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING}, {false, false}},
+	{"integer, integer", 2, {0, 1},
+	 {FIELD_TYPE_INTEGER, FIELD_TYPE_INTEGER}, {false, false}},
+	{"number, unsigned", 2, {0, 1},
+	 {FIELD_TYPE_NUMBER, FIELD_TYPE_UNSIGNED}, {false, false}},
+	{"secondary integer", 2, {1, 0},
+	 {FIELD_TYPE_INTEGER, FIELD_TYPE_UNSIGNED}, {false, false}},
+	{"secondary nullable string", 2, {1, 0},
+	 {FIELD_TYPE_STRING, FIELD_TYPE_UNSIGNED}, {true, false}},
+	{"4 x unsigned", 4, {0, 1, 2, 3},
+	 {FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED,
+	  FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED},
+	 {false, false, false, false}},
+};
+
+static int
+sign(int r)
+{
+	return r < 0 ? -1 : r > 0;
+}
+
+/** Encode a random value of a key part, NULLs are rare. */
+static char *
+encode_value(char *data, enum field_type type, bool is_nullable)
+{
+	if (is_nullable && rand() % 10 == 0)
+		return mp_encode_nil(data);
+	switch (type) {
+	case FIELD_TYPE_STRING: {
+		char str[16];
+		int len = snprintf(str, sizeof(str), "key%d", rand() % 1000);
+		return mp_encode_str(data, str, len);
+	}
+	case FIELD_TYPE_INTEGER:
+		if (rand() % 2 == 0)
+			return mp_encode_int(data, -(rand() % 1000) - 1);
+		return mp_encode_uint(data, rand() % 1000);
+	case FIELD_TYPE_NUMBER:
+		if (rand() % 2 == 0)
+			return mp_encode_double(data, rand() % 1000 / 3.0);
+		return mp_encode_uint(data, rand() % 1000);
+	case FIELD_TYPE_SCALAR:
+		if (rand() % 2 == 0)
+			return mp_encode_str(data, "scalar", 6);
+		return mp_encode_uint(data, rand() % 1000);
+	default:
+		return mp_encode_uint(data, rand() % 1000);
+	}
+}
+
+static struct tuple *
+tuple_new_random(struct tuple_format *format, const struct key_shape *shape)
+{
+	char buf[128];
+	char *data = mp_encode_array(buf, FIELD_COUNT);
+	for (uint32_t fieldno = 0; fieldno < FIELD_COUNT; fieldno++) {
+		enum field_type type = FIELD_TYPE_UNSIGNED;
+		bool is_nullable = false;
+		for (uint32_t i = 0; i < shape->part_count; i++) {
+			if (shape->fieldno[i] == fieldno) {
+				type = shape->type[i];
+				is_nullable = shape->is_nullable[i];
+			}
+		}
+		data = encode_value(data, type, is_nullable);
+	}
+	struct tuple *tuple = tuple_new(format, buf, data);
+	fail_if(tuple == NULL);
+	tuple_ref(tuple);
+	return tuple;
+}
+
+static void
+check_shape(const struct key_shape *shape)
+{
+	struct key_def *def = key_def_new(shape->part_count);
+	fail_if(def == NULL);
+	for (uint32_t i = 0; i < shape->part_count; i++) {
+		key_def_set_part(def, i, shape->fieldno[i], shape->type[i],
+				 shape->is_nullable[i], NULL, NULL, 0);
+	}
+	struct tuple_format *format = box_tuple_format_new(&def, 1);
+	fail_if(format == NULL);
+	/*
+	 * Nullable key definitions are always served by generic
+	 * hashers, use one to check the precompiled ones.
+	 */
+	struct key_def *generic_def = key_def_new(shape->part_count);
+	fail_if(generic_def == NULL);
+	for (uint32_t i = 0; i < shape->part_count; i++) {
+		key_def_set_part(generic_def, i, shape->fieldno[i],
+				 shape->type[i], true, NULL, NULL, 0);
+	}
+
+	srand(0);
+	struct tuple **tuples = (struct tuple **)
+		malloc(TUPLE_COUNT * sizeof(*tuples));
+	const char **keys = (const char **)
+		malloc(TUPLE_COUNT * sizeof(*keys));
+	fail_if(tuples == NULL || keys == NULL);
+	for (int i = 0; i < TUPLE_COUNT; i++) {
+		tuples[i] = tuple_new_random(format, shape);
+		uint32_t key_size;
+		keys[i] = tuple_extract_key(tuples[i], def, &key_size);
+		fail_if(keys[i] == NULL);
+	}
+
+	for (int n = 0; n < CHECK_COUNT; n++) {
+		int i = rand() % TUPLE_COUNT, j = rand() % TUPLE_COUNT;
+		int expected = sign(key_compare(keys[i], keys[j], def));
+		fail_unless(sign(tuple_compare(tuples[i], tuples[j],
+					       def)) == expected);
+		const char *key = keys[j];
+		uint32_t part_count = mp_decode_array(&key);
+		fail_unless(sign(tuple_compare_with_key(tuples[i], key,
+							part_count,
+							def)) == expected);
+		key = keys[i];
+		mp_decode_array(&key);
+		fail_unless(tuple_hash(tuples[i], def) == key_hash(key, def));
+		fail_unless(tuple_hash_crc32c(tuples[i], def) ==
+			    key_hash_crc32c(key, def));
+		fail_unless(tuple_hash_crc32c(tuples[i], def) ==
+			    tuple_hash_crc32c(tuples[i], generic_def));
+	}
+
+	for (int i = 0; i < TUPLE_COUNT; i++)
+		tuple_unref(tuples[i]);
+	free(keys);
+	free(tuples);
+	region_truncate(&fiber()->gc, 0);
+	box_tuple_format_unref(format);
+	box_key_def_delete(generic_def);
+	box_key_def_delete(def);
+}
+
+static void
+tuple_compare_test()
+{
+	header();
+
+	for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++)
+		check_shape(&shapes[i]);
+
+	footer();
+}
+
+int
+main(void)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	tuple_init(NULL);
+
+	tuple_compare_test();
+
+	tuple_free();
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "unit.h"
+#include "memory.h"
+#include "fiber.h"
+#include "diag.h"
+#include "uring.h"
+
+/*
+ * Check the io_uring wrapper on non-blocking socketpairs, the
+ * way iproto uses it: batched reads and writevs, reads of
+ * sockets with no data and of closed sockets. The tests pass
+ * without checking anything if io_uring is not available, so
+ * that the output is the same on any kernel.
+ */
+
+enum {
+	SOCKET_COUNT = 16,
+	REQUEST_SIZE = 64,
+	BUF_SIZE = 256,
+	IOV_COUNT = 4,
+};
+
+static int client[SOCKET_COUNT];
+static int server[SOCKET_COUNT];
+static char buf[SOCKET_COUNT][BUF_SIZE];
+static char request[REQUEST_SIZE];
+
+/**
+ * Submit the queued requests and fetch their completions,
+ * storing the result of the request with data i in res[i].
+ */
+static void
+submit_and_complete(struct uring *ring, unsigned count, int *res)
+{
+	fail_unless(uring_submit(ring) == count);
+	fail_unless(ring->count == 0);
+	for (unsigned i = 0; i < count; i++)
+		res[i] = INT32_MIN;
+	uint64_t data;
+	int r;
+	unsigned completed = 0;
+	while (completed < count) {
+		if (!uring_complete(ring, &data, &r)) {
+			/* Not completed within the submit call. */
+			struct pollfd pfd = { ring->fd, POLLIN, 0 };
+			fail_unless(poll(&pfd, 1, -1) == 1);
+			continue;
+		}
+		fail_unless(data < count);
+		fail_unless(res[data] == INT32_MIN);
+		res[data] = r;
+		completed++;
+	}
+	fail_unless(!uring_complete(ring, &data, &r));
+}
+
+static void
+read_write_test(struct uring *ring)
+{
+	header();
+	if (ring == NULL) {
+		footer();
+		return;
+	}
+
+	int res[SOCKET_COUNT];
+	for (int i = 0; i < SOCKET_COUNT; i++) {
+		fail_unless(write(client[i], request, REQUEST_SIZE) ==
+			    REQUEST_SIZE);
+	}
+	for (int i = 0; i < SOCKET_COUNT; i++)
+		uring_read(ring, server[i], buf[i], BUF_SIZE, i);
+	fail_unless(ring->count == SOCKET_COUNT);
+	submit_and_complete(ring, SOCKET_COUNT, res);
+	for (int i = 0; i < SOCKET_COUNT; i++) {
+		fail_unless(res[i] == REQUEST_SIZE);
+		fail_unless(memcmp(buf[i], request, REQUEST_SIZE) == 0);
+	}
+
+	/* The data is read up, a read must not block. */
+	for (int i = 0; i < SOCKET_COUNT; i++)
+		uring_read(ring, server[i], buf[i], BUF_SIZE, i);
+	submit_and_complete(ring, SOCKET_COUNT, res);
+	for (int i = 0; i < SOCKET_COUNT; i++)
+		fail_unless(res[i] == -EAGAIN);
+
+	/* Echo the request back, split into a few iovecs. */
+	struct iovec iov[SOCKET_COUNT][IOV_COUNT];
+	for (int i = 0; i < SOCKET_COUNT; i++) {
+		for (int j = 0; j < IOV_COUNT; j++) {
+			iov[i][j].iov_base = buf[i] +
+				j * REQUEST_SIZE / IOV_COUNT;
+			iov[i][j].iov_len = REQUEST_SIZE / IOV_COUNT;
+		}
+		uring_writev(ring, server[i], iov[i], IOV_COUNT, i);
+	}
+	submit_and_complete(ring, SOCKET_COUNT, res);
+	char response[REQUEST_SIZE];
+	for (int i = 0; i < SOCKET_COUNT; i++) {
+		fail_unless(res[i] == REQUEST_SIZE);
+		fail_unless(read(client[i], response, REQUEST_SIZE) ==
+			    REQUEST_SIZE);
+		fail_unless(memcmp(response, request, REQUEST_SIZE) == 0);
+	}
+
+	footer();
+}
+
+static void
+full_ring_test(struct uring *ring)
+{
+	header();
+	if (ring == NULL) {
+		footer();
+		return;
+	}
+
+	/* Reads and writes of one socket are mixed in a batch. */
+	static struct iovec one_byte = { request, 1 };
+	fail_unless(write(client[0], request, REQUEST_SIZE) == REQUEST_SIZE);
+	unsigned count = 0;
+	while (!uring_is_full(ring)) {
+		if (count % 2 == 0) {
+			uring_read(ring, server[0], buf[0],
+				   REQUEST_SIZE / 2, count);
+		} else {
+			uring_writev(ring, server[0], &one_byte, 1, count);
+		}
+		count++;
+	}
+	fail_unless(count == ring->entries);
+	int *res = (int *)calloc(count, sizeof(*res));
+	fail_if(res == NULL);
+	submit_and_complete(ring, count, res);
+	int read_size = 0, write_size = 0;
+	for (unsigned i = 0; i < count; i++) {
+		fail_unless(res[i] >= 0 || res[i] == -EAGAIN);
+		if (res[i] < 0)
+			continue;
+		if (i % 2 == 0)
+			read_size += res[i];
+		else
+			write_size += res[i];
+	}
+	fail_unless(read_size == REQUEST_SIZE);
+	fail_unless(write_size == (int)count / 2);
+	char response[BUF_SIZE];
+	fail_unless(read(client[0], response, BUF_SIZE) == write_size);
+	free(res);
+
+	footer();
+}
+
+static void
+eof_test(struct uring *ring)
+{
+	header();
+	if (ring == NULL) {
+		footer();
+		return;
+	}
+
+	int res[SOCKET_COUNT];
+	for (int i = 0; i < SOCKET_COUNT; i++) {
+		close(client[i]);
+		client[i] = -1;
+		uring_read(ring, server[i], buf[i], BUF_SIZE, i);
+	}
+	submit_and_complete(ring, SOCKET_COUNT, res);
+	for (int i = 0; i < SOCKET_COUNT; i++)
+		fail_unless(res[i] == 0);
+
+	footer();
+}
+
+int
+main(void)
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+
+	for (int i = 0; i < REQUEST_SIZE; i++)
+		request[i] = 'a' + i % 26;
+	for (int i = 0; i < SOCKET_COUNT; i++) {
+		int sv[2];
+		fail_unless(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+		fail_unless(fcntl(sv[1], F_SETFL, O_NONBLOCK) == 0);
+		client[i] = sv[0];
+		server[i] = sv[1];
+	}
+
+	struct uring ring, *p_ring = &ring;
+	if (uring_create(&ring, SOCKET_COUNT) != 0) {
+		/* Old kernel or a build without io_uring. */
+		fprintf(stderr, "io_uring is not available: %s\n",
+			diag_last_error(diag_get())->errmsg);
+		p_ring = NULL;
+	} else {
+		fail_unless(ring.entries >= SOCKET_COUNT);
+	}
+	read_write_test(p_ring);
+	full_ring_test(p_ring);
+	eof_test(p_ring);
+	if (p_ring != NULL)
+		uring_destroy(p_ring);
+
+	for (int i = 0; i < SOCKET_COUNT; i++) {
+		if (client[i] >= 0)
+			close(client[i]);
+		close(server[i]);
+	}
+
+	fiber_free();
+	memory_free();
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "vy_quota.h"
+#include "unit.h"
+
+/** Number of times the quota throttled the caller. */
+static int throttled_count;
+/** Lift the rate limit when the caller is throttled. */
+static bool unlimit_on_throttle;
+
+static void
+quota_exceeded_cb(struct vy_quota *q)
+{
+	(void) q;
+}
+
+/** Simulate a wait which times out. */
+static ev_tstamp
+quota_throttled_cb(struct vy_quota *q, ev_tstamp timeout)
+{
+	(void) timeout;
+	throttled_count++;
+	if (unlimit_on_throttle)
+		vy_quota_set_rate_limit(q, SIZE_MAX);
+	return 0;
+}
+
+static void
+quota_released_cb(struct vy_quota *q)
+{
+	(void) q;
+}
+
+static void
+quota_create(struct vy_quota *q, size_t limit, size_t budget)
+{
+	vy_quota_init(q, quota_exceeded_cb, quota_throttled_cb,
+		      quota_released_cb);
+	vy_quota_set_limit(q, limit);
+	vy_quota_set_rate_limit(q, 1000);
+	vy_quota_refill(q, budget);
+	throttled_count = 0;
+	unlimit_on_throttle = false;
+}
+
+static void
+test_use_ok(void)
+{
+	header();
+	struct vy_quota q;
+	quota_create(&q, 1000, 300);
+	is(vy_quota_use(&q, 100, 1), 0, "use within limits succeeds");
+	is(q.used, 100, "memory is consumed");
+	is(q.rate_budget, 200, "budget is consumed");
+	is(throttled_count, 0, "caller is not throttled");
+	footer();
+}
+
+static void
+test_use_rate_limited(void)
+{
+	header();
+	struct vy_quota q;
+	quota_create(&q, 1000, 50);
+	is(vy_quota_use(&q, 100, 1), 0, "rate limit doesn't fail a use");
+	is(q.used, 100, "memory is consumed");
+	is(q.rate_budget, -50, "budget is consumed");
+	is(throttled_count, 1, "caller is throttled");
+	footer();
+}
+
+static void
+test_use_timeout(void)
+{
+	header();
+	struct vy_quota q;
+	quota_create(&q, 1000, 300);
+	vy_quota_force_use(&q, 950);
+	is(vy_quota_use(&q, 100, 1), -1, "use over the limit times out");
+	is(q.used, 950, "memory is released on timeout");
+	is(q.rate_budget, 300, "budget is restored on timeout");
+	is(q.rate_throttled, 0, "rate throttling is not counted");
+	footer();
+}
+
+static void
+test_use_timeout_unlimited(void)
+{
+	header();
+	struct vy_quota q;
+	quota_create(&q, 1000, 300);
+	vy_quota_force_use(&q, 950);
+	unlimit_on_throttle = true;
+	is(vy_quota_use(&q, 100, 1), -1, "use over the limit times out");
+	is(q.used, 950, "memory is released on timeout");
+	is(q.rate_budget, 0, "budget reset by lifting the limit stays");
+	footer();
+}
+
+int
+main()
+{
+	header();
+	plan(15);
+
+	test_use_ok();
+	test_use_rate_limited();
+	test_use_timeout();
+	test_use_timeout_unlimited();
+
+	footer();
+	check_plan();
+}
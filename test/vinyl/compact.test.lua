@@ -39,5 +39,45 @@ test_run:grep_log('default', 'UPSERT operation failed') ~= nil
 
 space:drop()
 
+--
+-- Leveled compaction: a run must be run_size_ratio times larger
+-- than all newer runs taken together, otherwise they are merged.
+--
+space = box.schema.space.create('vinyl', { engine = 'vinyl' })
+_ = space:create_index('primary', { compaction = 'leveled', run_size_ratio = 10 })
+space.index.primary.options.compaction
+space:create_index('secondary', { compaction = 'foo' })
+for i = 1, 100 do space:replace{i, string.rep('x', 100)} end
+box.snapshot()
+vyinfo().run_count == 1
+-- the new run is much smaller than the old one, no compaction
+space:replace{1}
+box.snapshot()
+vyinfo().run_count == 2
+-- two small runs are merged, the old run is left intact
+space:replace{2}
+box.snapshot()
+while vyinfo().run_count > 2 do fiber.sleep(0.01) end
+vyinfo().run_count == 2
+vyinfo().amplification.read
+space:drop()
+
+--
+-- Unlike the tiered policy with one run per level, the leveled
+-- policy merges runs whose sizes differ less than run_size_ratio
+-- times, so that the number of runs stays logarithmic.
+--
+space = box.schema.space.create('vinyl', { engine = 'vinyl' })
+_ = space:create_index('primary', { compaction = 'leveled', run_size_ratio = 10 })
+_ = space:create_index('secondary', { parts = {2, 'unsigned'}, run_count_per_level = 1, run_size_ratio = 10 })
+for i = 1, 100 do space:replace{i, i, string.rep('x', 100)} end
+box.snapshot()
+for i = 101, 150 do space:replace{i, i, string.rep('x', 100)} end
+box.snapshot()
+while space.index.primary:info().run_count > 1 do fiber.sleep(0.01) end
+space.index.primary:info().run_count
+space.index.secondary:info().run_count
+space:drop()
+
 fiber = nil
 test_run = nil
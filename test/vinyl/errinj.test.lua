@@ -441,3 +441,31 @@ while wait_replace do fiber.sleep(0.01) end
 state, value = gen(param, state)
 value
 s:drop()
+
+--
+-- A request for a cursor is rejected while a pipelined FETCH
+-- of the cursor waits for a disk read.
+--
+net_box = require('net.box')
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+-- A tuple per page, so that every fetch reads the disk.
+for i = 1, 10 do s:replace{i, string.rep('x', 2000)} end
+box.snapshot()
+box.schema.user.grant('guest', 'read', 'space', 'test')
+c = net_box.connect(box.cfg.listen)
+cur = c.space.test.index.pk:cursor(nil, {chunk = 3})
+#cur:fetch()
+cur.id
+errinj.set("ERRINJ_VY_READ_PAGE_TIMEOUT", true)
+ch = fiber.channel(1)
+_ = fiber.create(function() ch:put(#cur:fetch()) end)
+c:_cursor_request('cursor_close', nil, cur.id)
+c:_cursor_request('cursor_fetch', nil, cur.id, 3)
+ch:get()
+errinj.set("ERRINJ_VY_READ_PAGE_TIMEOUT", false)
+cur:close()
+c:_cursor_request('cursor_fetch', nil, 1, 3)
+c:close()
+box.schema.user.revoke('guest', 'read', 'space', 'test')
+s:drop()
@@ -40,6 +40,9 @@ box.snapshot()
 
 box.info.vinyl().memory.used
 
+-- transactions are not paced unless a dump is in progress
+box.info.vinyl().memory.rate_limit
+
 space:select{}
 
 box.info.vinyl().memory.used
@@ -57,6 +57,26 @@ box.info.vinyl().memory.used
 --
 s2:auto_increment{pad}
 
+--
+-- Check that transactions are throttled and compaction is
+-- deferred while a dump doesn't keep up with transactions.
+--
+box.cfg{vinyl_timeout = 60}
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk', {run_count_per_level = 1})
+_ = s:insert{1}
+box.snapshot()
+throttled = box.info.vinyl().performance.tx_rate_throttled
+deferred = box.info.vinyl().performance.compact_deferred
+box.error.injection.set('ERRINJ_VY_RUN_WRITE_TIMEOUT', 0.5)
+pad = string.rep('x', box.cfg.vinyl_memory / 16)
+for i = 2, 48 do s:replace{i, pad} end
+box.info.vinyl().performance.tx_rate_throttled > throttled
+box.info.vinyl().performance.compact_deferred > deferred
+box.error.injection.set('ERRINJ_VY_RUN_WRITE_TIMEOUT', 0)
+s:count()
+s:drop()
+
 test_run:cmd('switch default')
 test_run:cmd("stop server test")
 test_run:cmd("cleanup server test")
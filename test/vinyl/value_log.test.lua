@@ -0,0 +1,75 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- Big non-indexed fields are stored in the value log
+-- and are not rewritten by compaction.
+--
+s = box.schema.space.create('test', {engine = 'vinyl'})
+s:create_index('pk', {value_log_threshold = -1})
+_ = s:create_index('pk', {value_log_threshold = 100, run_count_per_level = 1})
+s.index.pk.options.value_log_threshold
+function blob_info() return s.index.pk:info().disk.blob end
+function run_count() return s.index.pk:info().run_count end
+
+big = string.rep('x', 1000)
+for i = 1, 10 do s:replace{i, big .. i, 'small'} end
+box.snapshot()
+blob_info().count
+blob_info().bytes > 10000
+blob_info().used == blob_info().bytes
+s:get(5)[2] == big .. '5'
+s:get(5)[3]
+#s:select()
+
+-- small values are stored inline
+s:replace{1, 'a'}
+s:replace{2, 'b'}
+-- upsert is applied to a tuple stored in the value log
+s:upsert({3}, {{'=', 3, 'upserted'}})
+box.snapshot()
+while run_count() > 1 do fiber.sleep(0.01) end
+blob_info().count
+s:get(1)
+s:get(3)[2] == big .. '3'
+s:get(3)[3]
+s:get(10)[2] == big .. '10'
+
+-- a blob is dropped once no run refers to it
+for i = 4, 10 do s:replace{i} end
+box.snapshot()
+while run_count() > 1 do fiber.sleep(0.01) end
+blob_info().count
+s:get(3)[2] == big .. '3'
+s:select(4, {iterator = 'GE'})
+
+test_run:cmd('restart server default')
+fiber = require('fiber')
+s = box.space.test
+big = string.rep('x', 1000)
+s.index.pk:info().disk.blob.count
+s:get(3)[2] == big .. '3'
+s:get(3)[3]
+#s:select()
+
+--
+-- A user value that looks like a blob reference is stored
+-- and returned as is, not taken for a reference.
+--
+ffi = require('ffi')
+msgpack = require('msgpack')
+ffi.cdef[[int box_replace(uint32_t space_id, const char *tuple, const char *tuple_end, box_tuple_t **result);]]
+function ref(id) return string.char(0xc7, 20, 0x76, 0, 0, 0, 0, 0, 0, 0, id) .. string.rep('\0', 8) .. string.char(0, 0, 0, 10) end
+refs = {}
+for id = 1, 30 do table.insert(refs, ref(id)) end
+data = string.char(0xdc, 0, 32) .. msgpack.encode(100) .. table.concat(refs) .. msgpack.encode(big)
+p = ffi.cast('const char *', data)
+ffi.C.box_replace(s.id, p, p + #data, nil)
+function raw(t) local buf = ffi.new('char[?]', t:bsize()) ffi.C.box_tuple_to_buf(t, buf, t:bsize()) return ffi.string(buf, t:bsize()) end
+raw(s:get(100)) == data
+-- neither dump nor compaction take it for a reference
+box.snapshot()
+while s.index.pk:info().run_count > 1 do fiber.sleep(0.01) end
+raw(s:get(100)) == data
+
+s:drop()